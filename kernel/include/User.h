@@ -298,15 +298,17 @@ BOOL GetLocalTime(LPDATETIME Time);
 #define SYSCALL_SocketSetOption   0x00000074
 #define SYSCALL_SocketGetPeerName 0x00000075
 #define SYSCALL_SocketGetSocketName 0x00000076
+#define SYSCALL_SocketPoll        0x0000008B
 
 /************************************************************************/
 
-#define SYSCALL_Last 0x0000008B
+#define SYSCALL_Last 0x0000008C
 
 /************************************************************************/
 // Structure limits
 
 #define WAIT_INFO_MAX_OBJECTS 32
+#define SOCKET_POLL_MAX_ENTRIES 64
 #define PROFILE_MAX_ENTRIES   64
 #define PROFILE_NAME_LENGTH   64
 
@@ -819,6 +821,19 @@ typedef struct PACKED tag_SOCKET_SHUTDOWN_INFO {
     U32 How;  // SOCKET_SHUTDOWN_READ, SOCKET_SHUTDOWN_WRITE, SOCKET_SHUTDOWN_BOTH
 } SOCKET_SHUTDOWN_INFO, *LPSOCKET_SHUTDOWN_INFO;
 
+typedef struct PACKED tag_SOCKET_POLL_ENTRY {
+    SOCKET_HANDLE SocketHandle;
+    U32 Events;         // SOCKET_POLL_READ, SOCKET_POLL_WRITE, SOCKET_POLL_ACCEPT
+    U32 ReadyEvents;    // Requested events that are ready, plus SOCKET_POLL_ERROR/HANGUP/INVALID
+} SOCKET_POLL_ENTRY, *LPSOCKET_POLL_ENTRY;
+
+typedef struct PACKED tag_SOCKET_POLL_INFO {
+    ABI_HEADER Header;
+    U32 Count;          // Entries in use
+    U32 TimeOut;        // Milliseconds, 0 to check only, INFINITY to wait for ever
+    SOCKET_POLL_ENTRY Entries[SOCKET_POLL_MAX_ENTRIES];
+} SOCKET_POLL_INFO, *LPSOCKET_POLL_INFO;
+
 /************************************************************************/
 // Socket Address Structures
 
@@ -916,6 +931,7 @@ BOOL DeleteObject(HANDLE Object);
 #define ALLOC_PAGES_WC 0x00000008          // Write-combining (rare; mostly for framebuffers)
 #define ALLOC_PAGES_IO 0x00000010          // Exact PMA mapping for IO (BAR) -> do not touch RAM bitmap
 #define ALLOC_PAGES_AT_OR_OVER 0x00000020  // If a linear address is specified, can allocate anywhere above it
+#define ALLOC_PAGES_LARGE 0x00000040       // Use 2 MiB pages for aligned chunks when the architecture allows it
 
 #define FILE_OPEN_READ 0x00000001
 #define FILE_OPEN_WRITE 0x00000002
@@ -1170,6 +1186,17 @@ BOOL DeleteObject(HANDLE Object);
 #define SOCKET_SHUTDOWN_WRITE     1
 #define SOCKET_SHUTDOWN_BOTH      2
 
+// Socket Send/Receive Flags
+#define SOCKET_MSG_DONTWAIT       0x40  // Fail with SOCKET_ERROR_WOULDBLOCK instead of sleeping
+
+// Socket Poll Events
+#define SOCKET_POLL_READ          0x0001  // Data, end of stream or a pending connection
+#define SOCKET_POLL_WRITE         0x0002  // Send buffer has room
+#define SOCKET_POLL_ERROR         0x0004  // Connection failed, always reported
+#define SOCKET_POLL_ACCEPT        0x0008  // Listening socket has a pending connection
+#define SOCKET_POLL_HANGUP        0x0010  // Peer closed the connection, always reported
+#define SOCKET_POLL_INVALID       0x0020  // Handle is not a socket, always reported
+
 #ifdef __cplusplus
 }
 #endif
@@ -78,7 +78,10 @@
 #define INTEL_CPU_FEAT_RESH 0x40000000
 #define INTEL_CPU_FEAT_RESI 0x80000000
 
+#define INTEL_CPU_FEAT_ECX_TSC_DEADLINE 0x01000000  // CPUID.01H:ECX, LAPIC timer TSC-deadline mode
+
 #define IA32_PAT_MSR 0x00000277
+#define IA32_TSC_DEADLINE_MSR 0x000006E0
 
 /*************************************************************************/
 // Bit layout of CR0 (Control register 0)
@@ -96,6 +99,7 @@
 // Bit layout of CR4 (Control register 4)
 
 #define CR4_PAE 0x00000020                   // Physical Address Extension
+#define CR4_PGE 0x00000080                   // Global pages survive CR3 reloads
 #define CR4_OSFXSR 0x00000200                // OS supports FXSAVE/FXRSTOR
 #define CR4_OSXMMEXCPT 0x00000400            // OS supports SIMD exceptions
 
@@ -191,6 +195,12 @@ void WriteMSR(U32 Msr, U32 Value);
  */
 void WriteMSR64(U32 Msr, U32 ValueLow, U32 ValueHigh);
 
+/**
+ * Read the time-stamp counter.
+ * @return Current TSC value.
+ */
+U64 ReadTimeStampCounter(void);
+
 void InitializePat(void);
 
 #endif  // X86_COMMON_H_INCLUDED
@@ -230,6 +230,8 @@
 /* PIT clock */
 #define CLOCK_COMMAND 0x0043
 #define CLOCK_DATA 0x0040
+#define CLOCK_CHANNEL2_DATA 0x0042  // PIT channel 2, used for calibration
+#define CLOCK_GATE_CONTROL 0x0061   // Bit 0: channel 2 gate, bit 1: speaker, bit 5: channel 2 output
 
 /* Keyboard controller */
 #define KEYBOARD_COMMAND 0x0064  // Keyboard command port
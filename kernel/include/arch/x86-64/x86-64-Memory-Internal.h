@@ -64,6 +64,6 @@ BOOL ReleaseRegionWithFastWalker(LINEAR CanonicalBase, UINT NumPages);
 
 UINT ComputePagesUntilAlignment(LINEAR Base, U64 SpanSize);
 BOOL IsRegionFree(LINEAR Base, UINT Size);
-void FreeEmptyPageTables(void);
+UINT FreeEmptyPageTables(void);
 
 #endif  // X86_64_MEMORY_INTERNAL_H_INCLUDED
@@ -80,6 +80,12 @@
 #define PAGE_PRIVILEGE(Address) \
     (((U64)(Address) >= VMA_USER && (U64)(Address) < VMA_KERNEL) ? PAGE_PRIVILEGE_USER : PAGE_PRIVILEGE_KERNEL)
 
+// Kernel space is identical in every address space, its entries are global
+#define PAGE_GLOBAL(Address) (((U64)(Address) >= VMA_KERNEL) ? 1u : 0u)
+
+#define TLB_FLUSH_BATCH_MAX_RANGES 8    // Ranges recorded before a full flush
+#define TLB_FLUSH_BATCH_MAX_PAGES 32    // Pages invalidated one by one before a full flush
+
 #define PAGE_ALIGN(Address) (((U64)(Address) + PAGE_SIZE - (U64)1) & PAGE_MASK)
 
 /************************************************************************/
@@ -120,6 +126,19 @@ typedef struct tag_ARCH_PAGE_ITERATOR {
     UINT TableIndex;
 } ARCH_PAGE_ITERATOR;
 
+/**
+ * Linear ranges whose translations changed during one region operation.
+ * Small batches are invalidated page by page, large ones with a full flush.
+ */
+typedef struct tag_TLB_FLUSH_BATCH {
+    LINEAR Bases[TLB_FLUSH_BATCH_MAX_RANGES];
+    UINT PageCounts[TLB_FLUSH_BATCH_MAX_RANGES];
+    UINT RangeCount;
+    UINT PageCount;
+    BOOL Full;      // Too many pages or ranges, or paging structures freed
+    BOOL Global;    // At least one range is in kernel space
+} TLB_FLUSH_BATCH, *LPTLB_FLUSH_BATCH;
+
 /************************************************************************/
 // inlines
 
@@ -275,6 +294,14 @@ static inline volatile U64* GetPageTableEntryRawPointer(U64 Address) {
 BOOL ValidatePhysicalTargetRange(PHYSICAL Base, UINT NumPages);
 BOOL TryGetPageTableForIterator(const ARCH_PAGE_ITERATOR* Iterator, LPPAGE_TABLE* OutTable, BOOL* OutLargePage);
 LINEAR AllocPageTable(LINEAR Base);
+BOOL MapLargePage(LINEAR Base, PHYSICAL Physical, U64 Flags);
+BOOL UnmapLargePage(LINEAR Base);
+BOOL SplitLargePage(LINEAR Base);
+void FlushGlobalTLB(void);
+void TlbFlushBatchInit(LPTLB_FLUSH_BATCH Batch);
+void TlbFlushBatchAddRange(LPTLB_FLUSH_BATCH Batch, LINEAR Base, UINT PageCount);
+void TlbFlushBatchRequestFull(LPTLB_FLUSH_BATCH Batch);
+void TlbFlushBatchCommit(LPTLB_FLUSH_BATCH Batch);
 
 static inline ARCH_PAGE_ITERATOR MemoryPageIteratorFromLinear(U64 Linear) {
     ARCH_PAGE_ITERATOR Iterator;
@@ -145,6 +145,8 @@ void DebugLogSyscallFrame(LINEAR SaveArea, UINT FunctionId);
 
 #define CLOCK_COMMAND 0x0043
 #define CLOCK_DATA 0x0040
+#define CLOCK_CHANNEL2_DATA 0x0042  // PIT channel 2, used for calibration
+#define CLOCK_GATE_CONTROL 0x0061   // Bit 0: channel 2 gate, bit 1: speaker, bit 5: channel 2 output
 
 /***************************************************************************/
 
@@ -395,7 +397,11 @@ typedef struct tag_KERNEL_DATA_X86_64 {
             "push %%r14\n\t"                                            \
             "push %%r15\n\t"                                            \
             "movq %%rsp, %0\n\t"                                        \
+            "mov %%cr3, %%rax\n\t"                                      \
+            "cmp %2, %%rax\n\t"                                         \
+            "je 2f\n\t"                                                 \
             "mov %2, %%cr3\n\t"                                         \
+            "2:\n\t"                                                    \
             "movq %3, %%rsp\n\t"                                        \
             "leaq 1f(%%rip), %%rax\n\t"                                 \
             "movq %%rax, %1\n\t"                                        \
@@ -46,8 +46,13 @@ void ListAllTests(void);
 typedef void (*TestFunction)(TEST_RESULTS*);
 
 void TestCopyStack(TEST_RESULTS* Results);
+void TestMemoryStress(TEST_RESULTS* Results);
 void TestCircularBuffer(TEST_RESULTS* Results);
+void TestCache(TEST_RESULTS* Results);
+void TestNetworkChecksum(TEST_RESULTS* Results);
+void TestTimerWheel(TEST_RESULTS* Results);
 void TestBlockList(TEST_RESULTS* Results);
+void TestSlab(TEST_RESULTS* Results);
 void TestRadixTree(TEST_RESULTS* Results);
 void TestRegex(TEST_RESULTS* Results);
 void TestX86_32Disassembler(TEST_RESULTS* Results);
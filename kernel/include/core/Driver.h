@@ -92,7 +92,6 @@
 
 #define USB_KEYBOARD_DISCOVERY_RETRY_DELAY_POLLS 10
 
-#define E1000_TX_TIMEOUT_ITER 100000
 #define E1000_RESET_TIMEOUT_ITER 100000
 
 #define SERIAL_MOUSE_TIMEOUT_LOOPS 0x4000
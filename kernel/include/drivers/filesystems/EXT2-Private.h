@@ -26,6 +26,7 @@
 /************************************************************************/
 
 #include "drivers/filesystems/EXT2.h"
+#include "drivers/filesystems/ReadAhead.h"
 
 #include "core/Kernel.h"
 #include "log/Log.h"
@@ -59,6 +60,9 @@
 #define EXT2_BLOCK_BUFFER_INITIAL_SLABS 1
 #define EXT2_BLOCK_BUFFER_MIN_FREE 8
 
+#define EXT2_BLOCK_MAP_RUNS 32
+#define EXT2_READ_AHEAD_REQUESTS 8      // Runs of one readahead window in flight at once
+
 /************************************************************************/
 
 typedef struct tag_EXT2FILESYSTEM {
@@ -76,10 +80,28 @@ typedef struct tag_EXT2FILESYSTEM {
     MUTEX FilesMutex;
     BUFFER_POOL BlockBufferPool;
     U8* IOBuffer;
+    U32 WriteGeneration;
+    U32 MapGeneration;
 } EXT2FILESYSTEM, *LPEXT2FILESYSTEM;
 
 /************************************************************************/
 
+typedef struct tag_EXT2_BLOCK_RUN {
+    U32 Logical;
+    U32 Physical;
+    U32 Length;
+} EXT2_BLOCK_RUN, *LPEXT2_BLOCK_RUN;
+
+/************************************************************************/
+
+typedef struct tag_EXT2_BLOCK_MAP {
+    EXT2_BLOCK_RUN Runs[EXT2_BLOCK_MAP_RUNS];
+    U32 RunCount;
+    U32 Generation;
+} EXT2_BLOCK_MAP, *LPEXT2_BLOCK_MAP;
+
+/************************************************************************/
+
 typedef struct tag_EXT2FILE {
     FILE Header;
     EXT2INODE Inode;
@@ -91,6 +113,8 @@ typedef struct tag_EXT2FILE {
     U8* DirectoryBlock;
     BOOL DirectoryBlockValid;
     STR Pattern[MAX_FILE_NAME];
+    READ_AHEAD ReadAhead;
+    EXT2_BLOCK_MAP BlockMap;
 } EXT2FILE, *LPEXT2FILE;
 
 /************************************************************************/
@@ -117,6 +141,9 @@ BOOL WriteInode(LPEXT2FILESYSTEM FileSystem, U32 InodeIndex, LPEXT2INODE Inode);
 BOOL GetInodeBlockNumber(LPEXT2FILESYSTEM FileSystem, LPEXT2INODE Inode, U32 BlockIndex, U32* BlockNumber);
 BOOL ResolveInodeBlock(
     LPEXT2FILESYSTEM FileSystem, LPEXT2INODE Inode, U32 BlockIndex, BOOL Allocate, U32* BlockNumber);
+void Ext2BlockMapReset(LPEXT2_BLOCK_MAP Map);
+BOOL Ext2BlockMapLookup(
+    LPEXT2FILESYSTEM FileSystem, LPEXT2FILE File, U32 BlockIndex, U32* BlockNumber, U32* RunLength);
 BOOL FindInodeInDirectory(
     LPEXT2FILESYSTEM FileSystem, LPEXT2INODE Directory, LPCSTR Name, U32* InodeIndex);
 BOOL ResolvePath(
@@ -26,6 +26,7 @@
 #define FAT32_PRIVATE_H_INCLUDED
 
 #include "drivers/filesystems/FAT.h"
+#include "drivers/filesystems/ReadAhead.h"
 #include "fs/FileSystem.h"
 #include "core/Kernel.h"
 #include "log/Log.h"
@@ -36,6 +37,31 @@
 #define VER_MAJOR 1
 #define VER_MINOR 0
 
+#define FAT32_TABLE_WINDOW_SECTORS 8            // FAT sectors per cached window
+#define FAT32_TABLE_WINDOWS 64                  // 256 KB of cached FAT
+#define FAT32_TABLE_SCAN_SECTORS 128            // FAT sectors per read when building the free bitmap
+#define FAT32_TABLE_NO_WINDOW 0xFFFFFFFF
+#define FAT32_FILE_MIN_RUNS 8
+
+/***************************************************************************/
+
+// A window of consecutive sectors of the first FAT
+
+typedef struct tag_FAT32_TABLE_WINDOW {
+    U32 FirstSector;            // Relative to FATStart, FAT32_TABLE_NO_WINDOW if unused
+    U32 Entries[FAT32_TABLE_WINDOW_SECTORS * SECTOR_SIZE / sizeof(U32)];
+} FAT32_TABLE_WINDOW, *LPFAT32_TABLE_WINDOW;
+
+/***************************************************************************/
+
+// Consecutive clusters of a file
+
+typedef struct tag_FAT32_CLUSTER_RUN {
+    U32 Relative;               // Cluster index in the file of the first cluster
+    CLUSTER Cluster;            // Cluster number of the first cluster
+    U32 Length;                 // Number of clusters
+} FAT32_CLUSTER_RUN, *LPFAT32_CLUSTER_RUN;
+
 /***************************************************************************/
 
 // The file system object allocated when mounting
@@ -52,6 +78,13 @@ typedef struct tag_FAT32FILESYSTEM {
     U32 BytesPerCluster;
     U8* IOBuffer;
     U32 IOBufferGeneration;
+    U32 WriteGeneration;
+    MUTEX TableMutex;
+    LPFAT32_TABLE_WINDOW TableWindows;  // NULL when the FAT is read sector by sector
+    U32 ClusterCount;           // FAT entries, the two reserved ones included
+    U32* FreeBitmap;            // One bit per cluster, set when used, NULL if not built
+    U32 FreeClusters;
+    CLUSTER NextFree;           // Where the next free cluster search starts
 } FAT32FILESYSTEM, *LPFAT32FILESYSTEM;
 
 /***************************************************************************/
@@ -62,6 +95,10 @@ typedef struct tag_FATFILE {
     U32 DirectoryBufferCluster;
     U32 DirectoryBufferGeneration;
     BOOL DirectoryBufferValid;
+    LPFAT32_CLUSTER_RUN Runs;   // Mapped part of the chain, sorted by Relative
+    U32 RunCount;
+    U32 RunCapacity;
+    READ_AHEAD ReadAhead;
 } FATFILE, *LPFATFILE;
 
 /***************************************************************************/
@@ -73,9 +110,14 @@ UINT FAT32Commands(UINT Function, UINT Parameter);
 U32 GetNameChecksum(LPSTR Name);
 LPFATFILE NewFATFile(LPFAT32FILESYSTEM FileSystem, LPFATFILELOC FileLoc);
 BOOL ReadCluster(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster, LPVOID Buffer);
+BOOL ReadClusters(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster, U32 Count, LPVOID Buffer);
 BOOL WriteCluster(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster, LPVOID Buffer);
 CLUSTER GetNextClusterInChain(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster);
 BOOL CreateDirEntry(LPFAT32FILESYSTEM FileSystem, CLUSTER FolderCluster, LPSTR Name, U32 Attributes);
 CLUSTER ChainNewCluster(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster);
+void FAT32TableInit(LPFAT32FILESYSTEM FileSystem);
+BOOL FAT32ReadEntry(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster, U32* Value);
+BOOL FAT32WriteEntry(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster, U32 Value);
+CLUSTER FAT32AllocateCluster(LPFAT32FILESYSTEM FileSystem);
 
 #endif
@@ -0,0 +1,128 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    File readahead
+
+\************************************************************************/
+
+#ifndef READAHEAD_H_INCLUDED
+#define READAHEAD_H_INCLUDED
+
+/***************************************************************************/
+
+#include "Base.h"
+
+/***************************************************************************/
+
+#define READ_AHEAD_MIN_BYTES N_16KB     // Window when a stream is detected
+#define READ_AHEAD_MAX_BYTES N_128KB    // Largest window
+
+/***************************************************************************/
+
+/**
+ * Readahead state of one open file. Units are filesystem blocks or
+ * clusters, numbered from the start of the file.
+ */
+typedef struct tag_READ_AHEAD {
+    U32 UnitSize;       // Block or cluster size in bytes
+    U32 MinUnits;       // Window after a random access
+    U32 MaxUnits;       // Largest window
+    U32 Window;         // Units fetched by the next sequential miss
+    U32 NextUnit;       // Unit a sequential reader asks for next
+    U32 First;          // First unit held by Buffer
+    U32 Count;          // Units held by Buffer
+    U32 Capacity;       // Units Buffer can hold
+    U32 Generation;     // Filesystem write generation of the buffered units
+    U8* Buffer;
+} READ_AHEAD, *LPREAD_AHEAD;
+
+/***************************************************************************/
+
+/**
+ * @brief Initialize the readahead state of a file.
+ *
+ * @param ReadAhead State to initialize.
+ * @param UnitSize Block or cluster size in bytes.
+ */
+void ReadAheadInit(LPREAD_AHEAD ReadAhead, U32 UnitSize);
+
+/***************************************************************************/
+
+/**
+ * @brief Release the window buffer of a file.
+ *
+ * @param ReadAhead State to release.
+ */
+void ReadAheadDeinit(LPREAD_AHEAD ReadAhead);
+
+/***************************************************************************/
+
+/**
+ * @brief Drop the buffered units when the filesystem was written since they were read.
+ *
+ * Every handle of a file has its own window, so writers bump a generation
+ * counter of the filesystem instead of invalidating the other handles.
+ *
+ * @param ReadAhead File state.
+ * @param Generation Current write generation of the filesystem.
+ */
+void ReadAheadValidate(LPREAD_AHEAD ReadAhead, U32 Generation);
+
+/***************************************************************************/
+
+/**
+ * @brief Look for a unit in the window buffer.
+ *
+ * @param ReadAhead File state.
+ * @param Unit Unit index in the file.
+ * @return Unit data, or NULL when the unit is not buffered.
+ */
+U8* ReadAheadFind(LPREAD_AHEAD ReadAhead, U32 Unit);
+
+/***************************************************************************/
+
+/**
+ * @brief Get the buffer and the number of units to fetch for a missed unit.
+ *
+ * A miss on the unit that follows the previous one is a sequential access:
+ * the whole window is fetched and the window doubles, up to MaxUnits. Any
+ * other miss fetches one unit and shrinks the window back to MinUnits.
+ *
+ * @param ReadAhead File state.
+ * @param Unit Missed unit.
+ * @param UnitsLeft Units from Unit to the end of the file, at least 1.
+ * @param Buffer Receives the buffer to fill, starting with Unit.
+ * @return Units to fetch, 0 when no buffer can be allocated.
+ */
+U32 ReadAheadPrepare(LPREAD_AHEAD ReadAhead, U32 Unit, U32 UnitsLeft, U8** Buffer);
+
+/***************************************************************************/
+
+/**
+ * @brief Mark the units fetched after ReadAheadPrepare as valid.
+ *
+ * @param ReadAhead File state.
+ * @param Unit First fetched unit.
+ * @param Count Units actually fetched, may be less than requested.
+ */
+void ReadAheadCommit(LPREAD_AHEAD ReadAhead, U32 Unit, U32 Count);
+
+/***************************************************************************/
+
+#endif  // READAHEAD_H_INCLUDED
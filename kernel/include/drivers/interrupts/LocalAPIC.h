@@ -93,6 +93,11 @@
 #define LOCAL_APIC_LVT_TRIGGER_MODE  0x00008000  // Trigger Mode
 #define LOCAL_APIC_LVT_MASK          0x00010000  // Mask
 
+// LVT Timer Register modes
+#define LOCAL_APIC_LVT_TIMER_ONESHOT      0x00000000  // Count down once from the initial count
+#define LOCAL_APIC_LVT_TIMER_PERIODIC     0x00020000  // Reload the initial count on expiry
+#define LOCAL_APIC_LVT_TIMER_TSC_DEADLINE 0x00040000  // Fire when the TSC reaches IA32_TSC_DEADLINE
+
 // ICR Register bits
 #define LOCAL_APIC_ICR_VECTOR_MASK   0x000000FF  // Vector
 #define LOCAL_APIC_ICR_DELIVERY_MASK 0x00000700  // Delivery Mode mask
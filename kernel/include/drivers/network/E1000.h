@@ -79,6 +79,8 @@
 #define E1000_REG_TDH 0x3810   /* TX Desc Head */
 #define E1000_REG_TDT 0x3818   /* TX Desc Tail */
 
+#define E1000_REG_RXCSUM 0x5000 /* RX Checksum Control */
+
 /* Optional (MAC table) */
 #define E1000_REG_RAL0 0x5400 /* Receive Address Low 0 */
 #define E1000_REG_RAH0 0x5404 /* Receive Address High 0 */
@@ -121,6 +123,12 @@
 #define E1000_RCTL_BSIZE_2048 0x00000000
 #define E1000_RCTL_SECRC 0x04000000 /* Strip Ethernet CRC */
 
+/***************************************************************************/
+/* RXCSUM bits                                                             */
+
+#define E1000_RXCSUM_IPOFL 0x00000100 /* IPv4 header checksum offload */
+#define E1000_RXCSUM_TUOFL 0x00000200 /* TCP/UDP checksum offload */
+
 /***************************************************************************/
 /* TCTL bits                                                               */
 
@@ -144,16 +152,40 @@
 
 #define E1000_TX_CMD_EOP 0x01
 #define E1000_TX_CMD_IFCS 0x02
+#define E1000_TX_CMD_TSE 0x04  /* Extended data: TCP segmentation */
 #define E1000_TX_CMD_RS 0x08
 #define E1000_TX_CMD_DEXT 0x20
 
 #define E1000_TX_STA_DD 0x01
 
+/* Extended descriptor type, high nibble of the length byte */
+#define E1000_TX_DTYP_CONTEXT 0x00
+#define E1000_TX_DTYP_DATA 0x10
+
+/* Context descriptor TUCMD bits */
+#define E1000_TX_TUCMD_TCP 0x01
+#define E1000_TX_TUCMD_IP 0x02  /* IPv4 */
+#define E1000_TX_TUCMD_TSE 0x04
+#define E1000_TX_TUCMD_RS 0x08
+#define E1000_TX_TUCMD_DEXT 0x20
+
+/* Data descriptor POPTS bits */
+#define E1000_TX_POPTS_IXSM 0x01 /* Insert IPv4 checksum */
+#define E1000_TX_POPTS_TXSM 0x02 /* Insert TCP/UDP checksum */
+
+#define E1000_IPV4_CHECKSUM_FIELD 10 /* Offset of the checksum in the IPv4 header */
+
 /***************************************************************************/
 /* RX descriptor status bits                                               */
 
 #define E1000_RX_STA_DD 0x01   /* Descriptor Done */
 #define E1000_RX_STA_EOP 0x02  /* End of Packet */
+#define E1000_RX_STA_IXSM 0x04 /* Ignore checksum indication */
+#define E1000_RX_STA_TCPCS 0x20 /* TCP/UDP checksum calculated */
+#define E1000_RX_STA_IPCS 0x40 /* IPv4 checksum calculated */
+
+#define E1000_RX_ERR_TCPE 0x20 /* TCP/UDP checksum error */
+#define E1000_RX_ERR_IPE 0x40  /* IPv4 checksum error */
 
 /***************************************************************************/
 /* Descriptor rings & sizes                                                */
@@ -205,6 +237,34 @@ typedef struct tag_E1000_TXDESC {
     U16 Special;
 } E1000_TXDESC, *LPE1000_TXDESC;
 
+/* Transmit Context Descriptor (TCP/IP offload parameters) */
+typedef struct tag_E1000_TXCONTEXT {
+    U8 IPCSS;           /* IPv4 checksum start */
+    U8 IPCSO;           /* IPv4 checksum offset */
+    U16 IPCSE;          /* IPv4 checksum end, inclusive */
+    U8 TUCSS;           /* TCP checksum start */
+    U8 TUCSO;           /* TCP checksum offset */
+    U16 TUCSE;          /* TCP checksum end, 0 = end of packet */
+    U16 PayloadLow;     /* PAYLEN[15:0] */
+    U8 PayloadHighType; /* PAYLEN[19:16] | DTYP */
+    U8 TUCMD;
+    U8 STA;
+    U8 HDRLEN;
+    U16 MSS;
+} E1000_TXCONTEXT, *LPE1000_TXCONTEXT;
+
+/* Transmit Data Descriptor (extended) */
+typedef struct tag_E1000_TXDATA {
+    U32 BufferAddrLow;
+    U32 BufferAddrHigh;
+    U16 LengthLow;      /* DTALEN[15:0] */
+    U8 LengthHighType;  /* DTALEN[19:16] | DTYP */
+    U8 DCMD;
+    U8 STA;
+    U8 POPTS;
+    U16 Special;
+} E1000_TXDATA, *LPE1000_TXDATA;
+
 /* Sanity sizes (comment only):
    sizeof(E1000_RXDESC) == 16
    sizeof(E1000_TXDESC) == 16
@@ -103,7 +103,19 @@
 #define RTL8169_DESCRIPTOR_CRC_ERROR 0x00080000
 #define RTL8169_DESCRIPTOR_LENGTH_MASK 0x00003FFF
 
-#define RTL8169_CPLUSCMD_DEFAULT 0
+// RX checksum report, valid when RTL8169_CPLUSCMD_RX_CHECKSUM is set
+#define RTL8169_RX_PROTOCOL_TCP 0x00020000
+#define RTL8169_RX_PROTOCOL_UDP 0x00040000
+#define RTL8169_RX_PROTOCOL_IP 0x00060000
+#define RTL8169_RX_PROTOCOL_MASK 0x00060000
+#define RTL8169_RX_IP_CHECKSUM_FAIL 0x00010000
+#define RTL8169_RX_UDP_CHECKSUM_FAIL 0x00008000
+#define RTL8169_RX_TCP_CHECKSUM_FAIL 0x00004000
+#define RTL8169_RX_CHECKSUM_FAIL_MASK \
+    (RTL8169_RX_IP_CHECKSUM_FAIL | RTL8169_RX_UDP_CHECKSUM_FAIL | RTL8169_RX_TCP_CHECKSUM_FAIL)
+
+#define RTL8169_CPLUSCMD_RX_CHECKSUM 0x0020
+#define RTL8169_CPLUSCMD_DEFAULT RTL8169_CPLUSCMD_RX_CHECKSUM
 
 #define RTL8169_PHYSTATUS_LINK_UP 0x02
 #define RTL8169_PHYSTATUS_FULL_DUPLEX 0x01
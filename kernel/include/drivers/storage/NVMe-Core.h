@@ -71,6 +71,16 @@
 #define NVME_CC_IOSQES_SHIFT 16
 #define NVME_CC_IOCQES_SHIFT 20
 
+#define NVME_IO_MAX_SLOTS 32                // Commands in flight on the I/O queue
+#define NVME_IO_SLOT_BITS 5                 // CommandId bits holding the slot index
+#define NVME_MAX_TRANSFER_BYTES N_1MB       // Upper bound of one command, MDTS may lower it
+#define NVME_PRP_LIST_BYTES ((NVME_MAX_TRANSFER_BYTES / N_4KB) * 8)
+#define NVME_BOUNCE_BYTES N_64KB            // Bounce area for buffers that are not dword aligned
+
+#define NVME_IO_SLOT_FREE 0
+#define NVME_IO_SLOT_BUSY 1
+#define NVME_IO_SLOT_DONE 2
+
 /************************************************************************/
 // Type definitions
 
@@ -105,11 +115,20 @@ typedef struct PACKED tag_NVME_COMPLETION {
 
 typedef struct tag_NVME_QUEUE_BUFFER {
     LINEAR Base;
-    LPVOID Raw;
     PHYSICAL Physical;
     U32 Size;
+    U32 AllocatedSize;
 } NVME_QUEUE_BUFFER, *LPNVME_QUEUE_BUFFER;
 
+typedef struct tag_NVME_IO_SLOT {
+    U32* PrpList;               // 64-bit entries stored as low/high pairs
+    PHYSICAL PrpListPhysical;
+    U16 CommandId;
+    volatile U16 Status;        // Completion status, phase bit included
+    volatile U8 State;          // NVME_IO_SLOT_*
+    volatile BOOL Abandoned;    // Timed out, freed when it completes
+} NVME_IO_SLOT, *LPNVME_IO_SLOT;
+
 typedef struct tag_NVME_DEVICE {
     PCI_DEVICE_FIELDS
 
@@ -141,6 +160,12 @@ typedef struct tag_NVME_DEVICE {
     U8 IoCqPhase;
     U16 IoQueueId;
     U16 IoCommandId;
+    U32 IoSlotCount;
+    U32 MaxTransferBytes;
+    NVME_QUEUE_BUFFER IoPoolBuffer;     // PRP lists of every slot, then the bounce area
+    LPVOID BounceBuffer;
+    PHYSICAL BouncePhysical;
+    NVME_IO_SLOT IoSlots[NVME_IO_MAX_SLOTS];
     U32 LogicalBlockSize;
     COOLDOWN IoCompletionMismatchWarningCooldown;
     COOLDOWN IoCompletionTimeoutWarningCooldown;
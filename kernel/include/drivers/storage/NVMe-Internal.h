@@ -44,7 +44,7 @@
 #define NVME_ADMIN_SQ_ENTRY_SIZE 64
 #define NVME_ADMIN_CQ_ENTRY_SIZE 16
 #define NVME_ADMIN_QUEUE_ALIGNMENT N_4KB
-#define NVME_IO_QUEUE_ENTRIES 16
+#define NVME_IO_QUEUE_ENTRIES 64
 #define NVME_IO_SQ_ENTRY_SIZE 64
 #define NVME_IO_CQ_ENTRY_SIZE 16
 #define NVME_IO_QUEUE_ALIGNMENT N_4KB
@@ -84,6 +84,7 @@ BOOL NVMeReadSectors(LPNVME_DEVICE Device, U32 NamespaceId, U64 Lba, U32 SectorC
                      U32 BufferBytes);
 BOOL NVMeWriteSectors(LPNVME_DEVICE Device, U32 NamespaceId, U64 Lba, U32 SectorCount, LPCVOID Buffer,
                       U32 BufferBytes);
+void NVMeSetMaxTransferBytes(LPNVME_DEVICE Device, U8 Mdts);
 BOOL NVMeReadTest(LPNVME_DEVICE Device);
 void NVMeFreeIoQueues(LPNVME_DEVICE Device);
 
@@ -0,0 +1,130 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Block cache
+
+\************************************************************************/
+
+#ifndef BLOCKCACHE_H_INCLUDED
+#define BLOCKCACHE_H_INCLUDED
+
+/***************************************************************************/
+
+#include "../Base.h"
+#include "fs/Disk.h"
+
+/***************************************************************************/
+
+#define BLOCK_CACHE_PAGE_SIZE N_4KB
+#define BLOCK_CACHE_PAGES 512                   // 2 MB of cached data
+#define BLOCK_CACHE_BUCKETS 1024                // Power of two
+#define BLOCK_CACHE_MAX_CACHED_BYTES N_32KB     // Larger requests bypass the cache
+#define BLOCK_CACHE_WRITEBACK_DELAY_MS 1000     // Age of a dirty page before write-back
+
+// Flags for BlockCacheWrite
+#define BLOCK_CACHE_WRITE_BACK 0x0000           // Keep small writes in the cache
+#define BLOCK_CACHE_WRITE_THROUGH 0x0001        // Always reach the device before returning
+
+/***************************************************************************/
+// typedefs
+
+/**
+ * Raw transfer routine of a storage driver, called by the cache for misses,
+ * bypassed requests and write-back.
+ */
+typedef U32 (*BLOCK_CACHE_TRANSFER)(LPIOCONTROL Control, BOOL IsWrite);
+
+typedef struct tag_BLOCK_CACHE_INFO {
+    UINT Capacity;          // Pages
+    UINT UsedPages;
+    UINT DirtyPages;
+    UINT Hits;              // Sectors served by the cache
+    UINT Misses;            // Sectors read from the device through the cache
+    UINT Bypassed;          // Requests sent straight to the device
+    UINT Evictions;
+    UINT WriteBacks;        // Pages written back to the device
+    UINT WriteBackErrors;
+} BLOCK_CACHE_INFO, *LPBLOCK_CACHE_INFO;
+
+/***************************************************************************/
+// External symbols
+
+/**
+ * @brief Read sectors through the block cache.
+ *
+ * @param Control Request, validated by the driver.
+ * @param BytesPerSector Sector size of the disk.
+ * @param Transfer Raw transfer routine of the driver.
+ * @return DF_RETURN_SUCCESS or the error code of the raw transfer.
+ */
+U32 BlockCacheRead(LPIOCONTROL Control, U32 BytesPerSector, BLOCK_CACHE_TRANSFER Transfer);
+
+/***************************************************************************/
+
+/**
+ * @brief Write sectors through the block cache.
+ *
+ * @param Control Request, validated by the driver.
+ * @param BytesPerSector Sector size of the disk.
+ * @param Transfer Raw transfer routine of the driver.
+ * @param Flags BLOCK_CACHE_WRITE_BACK or BLOCK_CACHE_WRITE_THROUGH.
+ * @return DF_RETURN_SUCCESS or the error code of the raw transfer.
+ */
+U32 BlockCacheWrite(LPIOCONTROL Control, U32 BytesPerSector, BLOCK_CACHE_TRANSFER Transfer, U32 Flags);
+
+/***************************************************************************/
+
+/**
+ * @brief Write back the dirty pages of one disk, or of every disk.
+ *
+ * @param Disk Disk to flush, NULL for all disks.
+ * @return TRUE when no dirty page is left.
+ */
+BOOL BlockCacheFlush(LPSTORAGE_UNIT Disk);
+
+/***************************************************************************/
+
+/**
+ * @brief Write back the pages dirty for longer than BLOCK_CACHE_WRITEBACK_DELAY_MS.
+ *
+ * @param Now Current system time in milliseconds.
+ */
+void BlockCacheFlushExpired(U32 Now);
+
+/***************************************************************************/
+
+/**
+ * @brief Drop every page of a disk, dirty data included.
+ *
+ * @param Disk Disk that went away.
+ */
+void BlockCacheInvalidateDisk(LPSTORAGE_UNIT Disk);
+
+/***************************************************************************/
+
+/**
+ * @brief Copy the cache counters.
+ *
+ * @param Info Receives the counters.
+ */
+void BlockCacheGetInfo(LPBLOCK_CACHE_INFO Info);
+
+/***************************************************************************/
+
+#endif  // BLOCKCACHE_H_INCLUDED
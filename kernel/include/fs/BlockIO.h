@@ -0,0 +1,153 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Asynchronous block I/O
+
+\************************************************************************/
+
+#ifndef BLOCKIO_H_INCLUDED
+#define BLOCKIO_H_INCLUDED
+
+/***************************************************************************/
+
+#include "../Base.h"
+#include "core/KernelEvent.h"
+#include "fs/Disk.h"
+#include "sync/Mutex.h"
+
+/***************************************************************************/
+
+#define BLOCK_IO_MAX_QUEUES 8                   // Disks with a request queue
+#define BLOCK_IO_MERGE_BYTES N_256KB            // Largest merged command
+
+// Request states
+#define BLOCK_REQUEST_IDLE 0
+#define BLOCK_REQUEST_QUEUED 1
+#define BLOCK_REQUEST_DONE 2
+
+// Request flags
+#define BLOCK_REQUEST_FLAG_EVENT 0x0001         // Create a completion event
+
+/***************************************************************************/
+// typedefs
+
+typedef struct tag_BLOCK_REQUEST BLOCK_REQUEST, *LPBLOCK_REQUEST;
+
+typedef void (*BLOCK_REQUEST_CALLBACK)(LPBLOCK_REQUEST Request);
+
+/**
+ * One asynchronous transfer. The caller owns the structure and the buffer
+ * until the request is done. Overlapping requests that are in flight at
+ * the same time are not ordered.
+ */
+struct tag_BLOCK_REQUEST {
+    IOCONTROL Control;                  // Disk, sector range and buffer
+    BOOL IsWrite;
+    U32 Flags;
+    volatile U32 State;                 // BLOCK_REQUEST_*
+    volatile U32 Result;                // DF_RETURN_* once done
+    LPKERNEL_EVENT Completion;          // Signaled when done, usable with Wait()
+    BLOCK_REQUEST_CALLBACK Callback;    // Optional, runs in the queue task
+    LPVOID Context;                     // Free for the caller
+    volatile LPTASK Waiter;             // Task sleeping in BlockIOWait
+    LPBLOCK_REQUEST Next;               // Queue link
+};
+
+typedef struct tag_BLOCK_IO_INFO {
+    UINT Submitted;                     // Requests accepted
+    UINT Commands;                      // Driver commands issued
+    UINT Merged;                        // Requests folded into a previous one
+    UINT Pending;                       // Requests waiting in the queue
+} BLOCK_IO_INFO, *LPBLOCK_IO_INFO;
+
+/***************************************************************************/
+// External symbols
+
+/**
+ * @brief Prepare a request.
+ *
+ * @param Request Request to fill.
+ * @param Disk Target disk.
+ * @param SectorLow Low 32 bits of the first sector.
+ * @param SectorHigh High 32 bits of the first sector.
+ * @param NumSectors Number of sectors.
+ * @param Buffer Data buffer.
+ * @param BufferSize Size of Buffer in bytes.
+ * @param IsWrite TRUE for a write, FALSE for a read.
+ * @param Flags BLOCK_REQUEST_FLAG_* values.
+ * @return TRUE on success, FALSE when the event cannot be created.
+ */
+BOOL BlockRequestInit(LPBLOCK_REQUEST Request, LPSTORAGE_UNIT Disk, U32 SectorLow, U32 SectorHigh, U32 NumSectors,
+    LPVOID Buffer, U32 BufferSize, BOOL IsWrite, U32 Flags);
+
+/***************************************************************************/
+
+/**
+ * @brief Wait for a request to finish, then free its event.
+ *
+ * @param Request Request to release.
+ */
+void BlockRequestRelease(LPBLOCK_REQUEST Request);
+
+/***************************************************************************/
+
+/**
+ * @brief Queue a request on the queue of its disk.
+ *
+ * When no queue task can be started, the request is run before returning.
+ *
+ * @param Request Prepared request.
+ * @return DF_RETURN_SUCCESS when accepted, DF_RETURN_BAD_PARAMETER otherwise.
+ */
+U32 BlockIOSubmit(LPBLOCK_REQUEST Request);
+
+/***************************************************************************/
+
+/**
+ * @brief Sleep until a request is done.
+ *
+ * @param Request Submitted request.
+ * @param TimeOut Maximum wait in milliseconds, or INFINITY.
+ * @return TRUE when the request is done, FALSE on timeout.
+ */
+BOOL BlockIOWait(LPBLOCK_REQUEST Request, UINT TimeOut);
+
+/***************************************************************************/
+
+/**
+ * @brief Fail the pending requests of a disk that went away.
+ *
+ * @param Disk Disk that went away.
+ */
+void BlockIODetachDisk(LPSTORAGE_UNIT Disk);
+
+/***************************************************************************/
+
+/**
+ * @brief Copy the counters of the queue of a disk.
+ *
+ * @param Disk Disk to query.
+ * @param Info Receives the counters.
+ * @return TRUE when the disk has a queue.
+ */
+BOOL BlockIOGetInfo(LPSTORAGE_UNIT Disk, LPBLOCK_IO_INFO Info);
+
+/***************************************************************************/
+
+#endif  // BLOCKIO_H_INCLUDED
@@ -113,18 +113,6 @@ typedef struct tag_DISKACCESS {
 
 #define MAX_DISK 4
 #define TIMEOUT 10000
-#define NUM_BUFFERS 32
-#define DISK_CACHE_TTL_MS (5 * 60 * 1000)
-
-/***************************************************************************/
-// Disk sector buffer
-
-typedef struct tag_SECTORBUFFER {
-    U32 SectorLow;
-    U32 SectorHigh;
-    U32 Dirty;
-    U8 Data[SECTOR_SIZE];
-} SECTORBUFFER, *LPSECTORBUFFER;
 
 /***************************************************************************/
 
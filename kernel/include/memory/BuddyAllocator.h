@@ -35,7 +35,11 @@ BOOL BuddyResetAllReserved(void);
 BOOL BuddySetRange(UINT FirstPage, UINT PageCount, UINT Used);
 BOOL BuddyIsRangeFree(UINT FirstPage, UINT PageCount);
 PHYSICAL BuddyAllocPage(void);
+PHYSICAL BuddyAllocPages(UINT Order);
+PHYSICAL BuddyAllocContiguous(UINT PageCount, UINT Alignment, PHYSICAL MaxPhysical);
+UINT BuddyAllocPageBatch(PHYSICAL* Pages, UINT Count);
 BOOL BuddyFreePage(PHYSICAL Page);
+BOOL BuddyIsPageUsed(PHYSICAL Page);
 BOOL BuddyIsReady(void);
 UINT BuddyGetUsedPageCount(void);
 
@@ -48,6 +48,7 @@ typedef BOOL (*HEAP_RESIZE_CALLBACK)(LPVOID Context, LINEAR HeapBase, UINT OldSi
 typedef struct tag_HEAP_BLOCK_HEADER {
     UINT TypeID;
     UINT Size;
+    UINT PreviousSize;      // Size of the physically previous block, 0 for the first block
     UINT Flags;
     struct tag_HEAP_BLOCK_HEADER* Next;
     struct tag_HEAP_BLOCK_HEADER* Prev;
@@ -63,6 +64,8 @@ typedef struct tag_HEAP_CONTROL_BLOCK {
     LPHEAP_BLOCK_HEADER FreeLists[HEAP_NUM_SIZE_CLASSES];
     LPHEAP_BLOCK_HEADER LargeFreeList;
     LPVOID FirstUnallocated;
+    UINT LastBlockSize;     // Size of the block that ends at FirstUnallocated, 0 when none
+    UINT FreeBytes;         // Payload bytes held by free blocks
     LPVOID ResizeContext;
     HEAP_RESIZE_CALLBACK ResizeCallback;
     UINT MaximumSize;
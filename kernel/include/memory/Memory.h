@@ -70,6 +70,15 @@ typedef struct tag_MEMORY_REGION_LIST {
     UINT Count;
 } MEMORY_REGION_LIST, *LPMEMORY_REGION_LIST;
 
+#define PHYSICAL_PAGE_BATCH_SIZE 32
+
+// Pages taken from the physical allocator in one call and handed out one by one
+typedef struct tag_PHYSICAL_PAGE_BATCH {
+    PHYSICAL Pages[PHYSICAL_PAGE_BATCH_SIZE];
+    UINT Count;
+    UINT Next;
+} PHYSICAL_PAGE_BATCH, *LPPHYSICAL_PAGE_BATCH;
+
 /************************************************************************/
 
 LPMEMORY_REGION_LIST GetCurrentMemoryRegionList(void);
@@ -113,9 +122,24 @@ PHYSICAL AllocUserPageDirectory(void);
 // Allocates a physical page
 PHYSICAL AllocPhysicalPage(void);
 
+// Allocates a physically contiguous range of pages
+PHYSICAL AllocPhysicalContiguous(UINT PageCount, UINT Alignment, PHYSICAL MaxPhysical);
+
+// Allocates several physical pages at once, returns the number obtained
+UINT AllocPhysicalPageBatch(PHYSICAL* Pages, UINT Count);
+
 // Frees a physical page
 void FreePhysicalPage(PHYSICAL Page);
 
+// Frees a physically contiguous range of pages
+void FreePhysicalPageRange(PHYSICAL Base, UINT PageCount);
+
+// Hands out the next page of a batch, refilling it with up to Remaining pages
+PHYSICAL PhysicalPageBatchTake(LPPHYSICAL_PAGE_BATCH Batch, UINT Remaining);
+
+// Frees the pages of a batch that were not handed out
+void PhysicalPageBatchRelease(LPPHYSICAL_PAGE_BATCH Batch);
+
 // Returns TRUE if a pointer is an valid address (mapped in the calling process space)
 BOOL IsValidMemory(LINEAR Pointer);
 
@@ -0,0 +1,137 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Per-CPU page frame cache
+
+\************************************************************************/
+
+#ifndef PAGEFRAMECACHE_H_INCLUDED
+#define PAGEFRAMECACHE_H_INCLUDED
+
+/************************************************************************/
+
+#include "Base.h"
+
+/************************************************************************/
+
+#define PAGE_FRAME_CACHE_MAX_CPUS 1     // One cache per CPU, the kernel runs on the BSP only
+#define PAGE_FRAME_CACHE_HIGH 64        // Pages held before a drain
+#define PAGE_FRAME_CACHE_BATCH 16       // Pages moved per refill or drain
+
+/************************************************************************/
+// typedefs
+
+/**
+ * Free pages owned by one CPU. They stay marked used in the buddy allocator.
+ * Pages[Count - 1] is the hottest page, Pages[0] the coldest.
+ */
+typedef struct tag_PAGE_FRAME_CACHE {
+    PHYSICAL Pages[PAGE_FRAME_CACHE_HIGH];
+    UINT Count;
+    UINT Hits;          // Allocations served from the cache
+    UINT Refills;       // Batches taken from the buddy allocator
+    UINT Drains;        // Batches returned to the buddy allocator
+    UINT Frees;         // Pages freed into the cache
+} PAGE_FRAME_CACHE, *LPPAGE_FRAME_CACHE;
+
+typedef struct tag_PAGE_FRAME_CACHE_INFO {
+    UINT Count;
+    UINT Hits;
+    UINT Refills;
+    UINT Drains;
+    UINT Frees;
+} PAGE_FRAME_CACHE_INFO, *LPPAGE_FRAME_CACHE_INFO;
+
+/************************************************************************/
+// External symbols
+
+/**
+ * @brief Allocate one physical page, refilling the CPU cache when empty.
+ *
+ * @return Physical page address, or 0 when memory is exhausted.
+ */
+PHYSICAL PageFrameCacheAlloc(void);
+
+/************************************************************************/
+
+/**
+ * @brief Allocate pages, from the CPU cache first and from the buddy allocator for the rest.
+ *
+ * When the buddy allocator is used, one extra batch refills the cache.
+ *
+ * @param Pages Receives the physical page addresses.
+ * @param Count Number of pages wanted.
+ * @return Number of pages allocated.
+ */
+UINT PageFrameCacheAllocBatch(PHYSICAL* Pages, UINT Count);
+
+/************************************************************************/
+
+/**
+ * @brief Free one physical page into the CPU cache.
+ *
+ * Hot pages are handed out first, cold pages (not recently touched) last.
+ * The coldest pages go back to the buddy allocator when the cache is full.
+ *
+ * @param Page Physical page address.
+ * @param Cold TRUE when the page content is not expected to be in CPU caches.
+ * @return TRUE when the page was released, FALSE when it was already free.
+ */
+BOOL PageFrameCacheFree(PHYSICAL Page, BOOL Cold);
+
+/************************************************************************/
+
+/**
+ * @brief Remove a page from every CPU cache so that its caller owns it.
+ *
+ * @param Page Physical page address.
+ * @return TRUE when a cache held the page.
+ */
+BOOL PageFrameCacheClaim(PHYSICAL Page);
+
+/************************************************************************/
+
+/**
+ * @brief Return every cached page to the buddy allocator.
+ */
+void PageFrameCacheDrainAll(void);
+
+/************************************************************************/
+
+/**
+ * @brief Retrieve the number of pages held by all CPU caches.
+ *
+ * @return Cached page count.
+ */
+UINT PageFrameCacheGetCachedCount(void);
+
+/************************************************************************/
+
+/**
+ * @brief Copy the counters of one CPU cache.
+ *
+ * @param Cpu CPU index, below PAGE_FRAME_CACHE_MAX_CPUS.
+ * @param Info Receives the counters.
+ * @return TRUE on success, FALSE when Cpu is out of range.
+ */
+BOOL PageFrameCacheGetInfo(UINT Cpu, LPPAGE_FRAME_CACHE_INFO Info);
+
+/************************************************************************/
+
+#endif  // PAGEFRAMECACHE_H_INCLUDED
@@ -0,0 +1,162 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Slab caches and magazines
+
+\************************************************************************/
+
+#ifndef SLAB_H_INCLUDED
+#define SLAB_H_INCLUDED
+
+/************************************************************************/
+
+#include "Base.h"
+#include "sync/Mutex.h"
+#include "utils/BlockList.h"
+
+/************************************************************************/
+
+#define SLAB_MAGAZINE_SIZE 8            // Objects held by one magazine
+#define SLAB_MAX_CACHES 16              // Caches listed by SlabGetCacheInfo
+#define SLAB_OBJECT_ALIGNMENT 16        // Same alignment as heap blocks
+#define HEAP_MAGAZINE_CLASSES 8         // One magazine per heap size class
+
+/************************************************************************/
+// typedefs
+
+/**
+ * Small stack of free objects, pushed and popped with interrupts disabled
+ * instead of taking a mutex.
+ */
+typedef struct tag_SLAB_MAGAZINE {
+    UINT Count;
+    LPVOID Objects[SLAB_MAGAZINE_SIZE];
+} SLAB_MAGAZINE, *LPSLAB_MAGAZINE;
+
+typedef struct tag_SLAB_CACHE {
+    LPCSTR Name;
+    UINT ObjectSize;
+    BOOL Ready;
+    MUTEX Mutex;                // Protects Objects
+    BLOCK_LIST Objects;         // Backing slabs
+    SLAB_MAGAZINE Magazine;     // Recently freed objects
+    UINT Hits;                  // Allocations served by the magazine
+    UINT Misses;                // Allocations served by the slabs
+    UINT Fallbacks;             // Allocations served by the kernel heap
+    UINT Frees;
+} SLAB_CACHE, *LPSLAB_CACHE;
+
+typedef struct tag_SLAB_CACHE_INFO {
+    LPCSTR Name;
+    UINT ObjectSize;
+    UINT Hits;
+    UINT Misses;
+    UINT Fallbacks;
+    UINT Frees;
+    UINT InUse;
+    UINT Capacity;
+    UINT SlabCount;
+    UINT MagazineCount;
+} SLAB_CACHE_INFO, *LPSLAB_CACHE_INFO;
+
+// Static initializer, the slabs are created on first allocation
+#define SLAB_CACHE_INIT(CacheName, Size) { \
+    .Name = CacheName, \
+    .ObjectSize = Size, \
+    .Ready = FALSE, \
+    .Mutex = EMPTY_MUTEX \
+}
+
+/************************************************************************/
+// External symbols
+
+/**
+ * @brief Allocate one zeroed object from a slab cache.
+ *
+ * Falls back to the kernel heap when the slabs cannot grow.
+ *
+ * @param Cache Cache to allocate from.
+ * @return Pointer to the object, or NULL on failure.
+ */
+LPVOID SlabCacheAlloc(LPSLAB_CACHE Cache);
+
+/************************************************************************/
+
+/**
+ * @brief Return an object to the slab cache that owns it.
+ *
+ * @param Pointer Object to release.
+ * @return TRUE when a cache owned the object, FALSE otherwise.
+ */
+BOOL SlabCacheFree(LPVOID Pointer);
+
+/************************************************************************/
+
+/**
+ * @brief Retrieve the object size of a slab-owned pointer.
+ *
+ * @param Pointer Object address.
+ * @return Object size in bytes, or 0 when no cache owns the pointer.
+ */
+UINT SlabCacheGetObjectSize(LPCVOID Pointer);
+
+/************************************************************************/
+
+/**
+ * @brief Retrieve the number of registered caches.
+ *
+ * @return Number of caches that allocated at least once.
+ */
+UINT SlabGetCacheCount(void);
+
+/************************************************************************/
+
+/**
+ * @brief Copy the counters of one registered cache.
+ *
+ * @param Index Cache index, below SlabGetCacheCount().
+ * @param Info Receives the counters.
+ * @return TRUE on success, FALSE when Index is out of range.
+ */
+BOOL SlabGetCacheInfo(UINT Index, LPSLAB_CACHE_INFO Info);
+
+/************************************************************************/
+
+/**
+ * @brief Pop one object from a magazine.
+ *
+ * @param Magazine Magazine to pop from.
+ * @return Object pointer, or NULL when the magazine is empty.
+ */
+LPVOID SlabMagazinePop(LPSLAB_MAGAZINE Magazine);
+
+/************************************************************************/
+
+/**
+ * @brief Push one object to a magazine.
+ *
+ * @param Magazine Magazine to push to.
+ * @param Object Object pointer.
+ * @return TRUE when stored, FALSE when the magazine is full or already holds Object.
+ */
+BOOL SlabMagazinePush(LPSLAB_MAGAZINE Magazine, LPVOID Object);
+
+/************************************************************************/
+
+#endif  // SLAB_H_INCLUDED
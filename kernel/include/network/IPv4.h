@@ -61,7 +61,8 @@
 /************************************************************************/
 // Callback type for protocol handlers
 
-typedef void (*IPv4_ProtocolHandler)(const U8* Payload, U32 PayloadLength, U32 SourceIP, U32 DestinationIP);
+// Flags are the NETWORK_RX_* flags of the frame that carried the packet
+typedef void (*IPv4_ProtocolHandler)(const U8* Payload, U32 PayloadLength, U32 SourceIP, U32 DestinationIP, U32 Flags);
 
 /************************************************************************/
 // Words are in network byte order
@@ -99,19 +100,21 @@ typedef struct tag_IPV4_CONTEXT {
     IPV4_PENDING_PACKET PendingPackets[IPV4_MAX_PENDING_PACKETS];
     U32 ARPCallbackRegistered;
     LPNOTIFICATION_CONTEXT NotificationContext;
+    U32 DeviceCaps;         // NETWORK_CAP_* of the driver
 } IPV4_CONTEXT, *LPIPV4_CONTEXT;
 
 /************************************************************************/
 
 LPIPV4_CONTEXT IPv4_GetContext(LPDEVICE Device);
 void IPv4_Initialize(LPDEVICE Device, U32 LocalIPv4_Be);
+U32 IPv4_GetDeviceCaps(LPDEVICE Device);
 void IPv4_Destroy(LPDEVICE Device);
 void IPv4_SetLocalAddress(LPDEVICE Device, U32 LocalIPv4_Be);
 void IPv4_SetNetworkConfig(LPDEVICE Device, U32 LocalIPv4_Be, U32 NetmaskBe, U32 DefaultGatewayBe);
 void IPv4_ClearPendingPackets(LPDEVICE Device);
 void IPv4_RegisterProtocolHandler(LPDEVICE Device, U8 Protocol, IPv4_ProtocolHandler Handler);
 int IPv4_Send(LPDEVICE Device, U32 DestinationIP, U8 Protocol, const U8* Payload, U32 PayloadLength);
-void IPv4_OnEthernetFrame(LPDEVICE Device, const U8* Frame, U32 Length);
+void IPv4_OnEthernetFrame(LPDEVICE Device, const U8* Frame, U32 Length, U32 Flags);
 void IPv4_ARPResolvedCallback(LPNOTIFICATION_DATA NotificationData, LPVOID UserData);
 int IPv4_AddPendingPacket(LPIPV4_CONTEXT Context, U32 DestinationIP, U32 NextHopIP, U8 Protocol, const U8* Payload, U32 PayloadLength);
 void IPv4_ProcessPendingPackets(LPIPV4_CONTEXT Context, U32 ResolvedIP);
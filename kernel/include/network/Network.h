@@ -37,7 +37,7 @@
 
 /************************************************************************/
 
-typedef void (*NT_RXCB)(const U8 *Frame, U32 Length, LPVOID UserData);
+typedef void (*NT_RXCB)(const U8 *Frame, U32 Length, U32 Flags, LPVOID UserData);
 
 #define PROTOCOL_NONE 0x00000000
 #define PROTOCOL_EXOS 0x00000001
@@ -55,6 +55,24 @@ typedef void (*NT_RXCB)(const U8 *Frame, U32 Length, LPVOID UserData);
 #define DF_NT_SEND (DF_FIRST_FUNCTION + 0x02)       /* Send frame (param=ptr, param2=len) */
 #define DF_NT_POLL (DF_FIRST_FUNCTION + 0x03)       /* Poll RX ring */
 #define DF_NT_SETRXCB (DF_FIRST_FUNCTION + 0x04)    /* Set RX callback */
+#define DF_NT_SEND_BATCH (DF_FIRST_FUNCTION + 0x05) /* Send several frames, one doorbell (optional) */
+
+/************************************************************************/
+// Capabilities returned by DF_GET_CAPS
+
+#define NETWORK_CAP_TX_CHECKSUM 0x00000001  /* Inserts the TCP checksum */
+#define NETWORK_CAP_RX_CHECKSUM 0x00000002  /* Reports verified IPv4/TCP/UDP checksums */
+#define NETWORK_CAP_TSO 0x00000004          /* Splits large TCP frames into MSS segments */
+
+// Offloads requested with a frame (NETWORK_OFFLOAD.Flags)
+
+#define NETWORK_OFFLOAD_TRANSPORT_CHECKSUM 0x00000001
+#define NETWORK_OFFLOAD_TCP_SEGMENTATION 0x00000002
+
+// Flags passed to NT_RXCB with a received frame
+
+#define NETWORK_RX_IPV4_CHECKSUM_OK 0x00000001
+#define NETWORK_RX_TRANSPORT_CHECKSUM_OK 0x00000002
 
 /************************************************************************/
 // Generic Network Driver Error Codes
@@ -62,6 +80,7 @@ typedef void (*NT_RXCB)(const U8 *Frame, U32 Length, LPVOID UserData);
 #define DF_RETURN_NT_TX_FAIL (DF_RETURN_FIRST + 0x00) /* Transmission failed */
 #define DF_RETURN_NT_RX_FAIL (DF_RETURN_FIRST + 0x01) /* Reception failed */
 #define DF_RETURN_NT_NO_LINK (DF_RETURN_FIRST + 0x02) /* Link down */
+#define DF_RETURN_NT_TX_BUSY (DF_RETURN_FIRST + 0x03) /* Transmit ring full, retry later */
 
 /************************************************************************/
 
@@ -80,12 +99,40 @@ typedef struct tag_NETWORK_SET_RX_CB {
     LPVOID UserData;
 } NETWORK_SET_RX_CB, *LPNETWORK_SET_RX_CB;
 
+/**
+ * Work left to the NIC for one frame. The checksum field already holds the
+ * folded pseudo-header sum, without the length for segmentation. Offsets
+ * are counted from the start of the Ethernet frame.
+ */
+typedef struct tag_NETWORK_OFFLOAD {
+    U32 Flags;              // NETWORK_OFFLOAD_*
+    U8 NetworkOffset;       // IPv4 header
+    U8 TransportOffset;     // TCP header
+    U8 ChecksumOffset;      // TCP checksum field
+    U8 HeaderLength;        // Ethernet, IPv4 and TCP headers, segmentation only
+    U16 SegmentSize;        // TCP payload bytes per segment, segmentation only
+} NETWORK_OFFLOAD, *LPNETWORK_OFFLOAD;
+
 typedef struct tag_NETWORK_SEND {
     LPPCI_DEVICE Device;
     const U8 *Data;
     U32 Length;
+    const NETWORK_OFFLOAD *Offload;     // NULL when the frame is complete
 } NETWORK_SEND, *LPNETWORK_SEND;
 
+typedef struct tag_NETWORK_FRAME {
+    const U8 *Data;
+    U32 Length;
+    const NETWORK_OFFLOAD *Offload;
+} NETWORK_FRAME, *LPNETWORK_FRAME;
+
+typedef struct tag_NETWORK_SEND_BATCH {
+    LPPCI_DEVICE Device;
+    const NETWORK_FRAME *Frames;
+    U32 Count;
+    U32 Sent;       // Out: frames queued, in order, before the first failure
+} NETWORK_SEND_BATCH, *LPNETWORK_SEND_BATCH;
+
 typedef struct tag_NETWORK_POLL {
     LPPCI_DEVICE Device;
 } NETWORK_POLL, *LPNETWORK_POLL;
@@ -104,6 +151,44 @@ INT Network_SendRawFrame(LPDEVICE Device, const U8 *Data, U32 Length);
 
 /************************************************************************/
 
+/**
+ * @brief Send an Ethernet frame with work left to the NIC.
+ *
+ * @param Device Target network device.
+ * @param Data Pointer to frame buffer.
+ * @param Length Frame length in bytes.
+ * @param Offload Offloads to apply, NULL for none.
+ * @return 1 on success, 0 otherwise.
+ */
+INT Network_SendFrame(LPDEVICE Device, const U8 *Data, U32 Length, const NETWORK_OFFLOAD *Offload);
+
+/************************************************************************/
+
+/**
+ * @brief Query the offload capabilities of a network device.
+ *
+ * @param Device Network device.
+ * @return NETWORK_CAP_* flags, 0 when the driver has none.
+ */
+U32 Network_GetCaps(LPDEVICE Device);
+
+/************************************************************************/
+
+/**
+ * @brief Send several raw Ethernet frames through a network device.
+ *
+ * Uses DF_NT_SEND_BATCH when the driver implements it, otherwise sends
+ * the frames one by one.
+ *
+ * @param Device Target network device.
+ * @param Frames Frames to send, in order.
+ * @param Count Number of frames.
+ * @return Number of frames accepted, counted from the first one.
+ */
+U32 Network_SendRawFrames(LPDEVICE Device, const NETWORK_FRAME *Frames, U32 Count);
+
+/************************************************************************/
+
 #pragma pack(pop)
 
 #endif  // NETWORK_H_INCLUDED
@@ -86,6 +86,8 @@
 
 #define SOL_SOCKET                1
 #define SO_RCVTIMEO               20
+#define IPPROTO_TCP               6
+#define TCP_NODELAY               1
 
 /************************************************************************/
 // Socket Shutdown Types
@@ -94,12 +96,35 @@
 #define SOCKET_SHUTDOWN_WRITE     1
 #define SOCKET_SHUTDOWN_BOTH      2
 
+/************************************************************************/
+// Socket Send/Receive Flags
+
+#define SOCKET_MSG_DONTWAIT       0x40
+
 /************************************************************************/
 // Socket Buffer Structure
 
 #define SOCKET_BUFFER_SIZE 8192
 #define SOCKET_MAXIMUM_BUFFER_SIZE (SOCKET_BUFFER_SIZE * 4)
 
+/************************************************************************/
+// Socket Wait Queue
+
+// Task sleeping until a socket changes, linked on the socket while it waits
+typedef struct tag_SOCKET_WAITER {
+    struct tag_SOCKET_WAITER* Next;
+    LPVOID Socket;              // Socket the waiter is linked on, NULL once unlinked
+    LPVOID Task;                // Sleeping task
+    volatile BOOL Signaled;     // Set by every wake
+} SOCKET_WAITER, *LPSOCKET_WAITER;
+
+// Connection that completed its handshake on a listening socket
+typedef struct tag_SOCKET_PENDING_CONNECTION {
+    LISTNODE_FIELDS
+    LPTCP_CONNECTION TCPConnection;
+    SOCKET_ADDRESS_INET RemoteAddress;
+} SOCKET_PENDING_CONNECTION, *LPSOCKET_PENDING_CONNECTION;
+
 /************************************************************************/
 // Socket Control Block
 
@@ -115,13 +140,19 @@ typedef struct tag_SOCKET {
     // Address binding
     SOCKET_ADDRESS_INET LocalAddress;
     SOCKET_ADDRESS_INET RemoteAddress;
+    struct tag_SOCKET* PortNext;    // Bound port table chain
+    BOOL PortLinked;
 
     // Connection management
     LPTCP_CONNECTION TCPConnection;    // Pointer to TCP connection (if TCP)
     U32 ListenBacklog;      // Maximum pending connections
-    LPLIST PendingConnections; // Queue of pending connections
+    LPLIST PendingConnections; // Queue of SOCKET_PENDING_CONNECTION
+    I32 PendingError;       // Error of a failed connect, reported once
 
-    // Data buffers
+    // Tasks sleeping on the socket
+    LPSOCKET_WAITER Waiters;
+
+    // Data buffers, stream sockets receive in the buffer of their TCP connection
     CIRCULAR_BUFFER ReceiveBuffer;
     U8 ReceiveBufferData[SOCKET_BUFFER_SIZE];
     CIRCULAR_BUFFER SendBuffer;
@@ -136,7 +167,6 @@ typedef struct tag_SOCKET {
     BOOL NoDelay;
     U32  ReceiveTimeout;
     U32  SendTimeout;
-    U32  ReceiveTimeoutStartTime;  // When timeout started
 
     // Statistics
     U32 BytesSent;
@@ -171,6 +201,9 @@ U32 SocketSetOption(SOCKET_HANDLE SocketHandle, U32 Level, U32 OptionName, LPCVO
 U32 SocketGetPeerName(SOCKET_HANDLE SocketHandle, LPSOCKET_ADDRESS Address, U32* AddressLength);
 U32 SocketGetSocketName(SOCKET_HANDLE SocketHandle, LPSOCKET_ADDRESS Address, U32* AddressLength);
 
+// Readiness
+I32 SocketPoll(LPSOCKET_POLL_ENTRY Entries, U32 Count, U32 TimeOut);
+
 // System functions
 void SocketUpdate(void);
 
@@ -181,7 +214,9 @@ U32 SocketAddressGenericToInet(LPSOCKET_ADDRESS GenericAddress, LPSOCKET_ADDRESS
 
 // Internal functions
 void SocketTCPNotificationCallback(LPNOTIFICATION_DATA NotificationData, LPVOID UserData);
-U32 SocketTCPReceiveCallback(LPTCP_CONNECTION TCPConnection, const U8* Data, U32 DataLength);
+void SocketTCPReceiveCallback(LPTCP_CONNECTION TCPConnection, U32 DataLength);
+void SocketTCPStateCallback(LPTCP_CONNECTION TCPConnection);
+BOOL SocketTCPAcceptCallback(LPTCP_CONNECTION Listener, LPTCP_CONNECTION TCPConnection);
 void SocketDestructor(LPVOID Item);
 
 /************************************************************************/
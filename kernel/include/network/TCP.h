@@ -32,6 +32,8 @@
 #include "utils/List.h"
 #include "utils/Hysteresis.h"
 #include "utils/Helpers.h"
+#include "utils/CircularBuffer.h"
+#include "network/TCPDemux.h"
 
 /************************************************************************/
 
@@ -53,6 +55,9 @@
 // TCP Retransmission/Congestion constants
 
 #define TCP_MAX_RETRANSMIT_PAYLOAD 1460
+#define TCP_MAX_SEND_SEGMENTS 64        // Transmitted segments awaiting an ACK
+#define TCP_MAX_SACK_BLOCKS 4           // SACK blocks parsed from one segment
+#define TCP_MAX_RECV_RANGES 8           // Out-of-order ranges held past a hole
 
 /************************************************************************/
 // TCP States (using state machine framework)
@@ -100,6 +105,36 @@ typedef struct tag_TCP_HEADER {
     U16 UrgentPointer;      // Urgent pointer (big-endian)
 } TCP_HEADER, *LPTCP_HEADER;
 
+/************************************************************************/
+// Transmitted segment awaiting acknowledgement
+
+typedef struct tag_TCP_SEGMENT {
+    U32 SequenceStart;      // First sequence number
+    U32 Length;             // Payload bytes, taken from the send buffer
+    U32 SentTime;           // Time of the last transmission (ms)
+    U8 Flags;               // Flags the segment was sent with
+    BOOL Retransmitted;     // Sent more than once, gives no RTT sample
+    BOOL Sacked;            // Reported received by a SACK block
+} TCP_SEGMENT, *LPTCP_SEGMENT;
+
+/************************************************************************/
+// Out-of-order data held in the reorder buffer, [Start, End)
+
+typedef struct tag_TCP_RECV_RANGE {
+    U32 Start;
+    U32 End;
+} TCP_RECV_RANGE, *LPTCP_RECV_RANGE;
+
+/************************************************************************/
+// Receive posted by a reader sleeping on an empty receive buffer
+
+typedef struct tag_TCP_RECV_REQUEST {
+    U8* Buffer;             // Destination filled straight from segments, NULL if none
+    U32 Length;             // Size of Buffer
+    U32 Filled;             // Bytes already stored in Buffer
+    LPVOID Waiter;          // Sleeping task, NULL when no reader waits
+} TCP_RECV_REQUEST, *LPTCP_RECV_REQUEST;
+
 /************************************************************************/
 // TCP Connection Block
 
@@ -119,18 +154,38 @@ typedef struct tag_TCP_CONNECTION {
     U32 RecvNext;           // Next expected sequence number
 
     // Window management
-    U16 SendWindow;         // Send window size
-    U16 RecvWindow;         // Receive window size
+    U32 SendWindow;         // Send window size in bytes, scaled
+    U32 RecvWindow;         // Receive window size
     HYSTERESIS WindowHysteresis;  // Hysteresis for window updates
-    U16 LastAdvertisedWindow;     // Last window size sent to the peer
+    U32 LastAdvertisedWindow;     // Last window size sent to the peer, in bytes
+    U8 SendWindowScale;     // Shift applied to the windows of the peer
+    U8 RecvWindowScale;     // Shift applied to the windows we advertise
+
+    // Negotiated options (RFC 7323)
+    BOOL WindowScaleEnabled;
+    BOOL TimestampsEnabled;
+    U32 TimestampRecent;    // Last timestamp of the peer, echoed back
 
-    // Buffers
+    // Delayed ACK and Nagle
+    U32 AckPendingSegments; // Segments received since the last ACK
+    U32 DelayedAckTimer;    // Time the pending ACK must leave, 0 if none
+    BOOL NoDelay;           // Nagle disabled (TCP_NODELAY)
+
+    // Buffers (SendBuffer starts at the first unacknowledged data byte)
     U8 SendBuffer[TCP_SEND_BUFFER_SIZE];
     UINT SendBufferUsed;
+    UINT SendBufferSent;
     UINT SendBufferCapacity;
-    U8 RecvBuffer[TCP_RECV_BUFFER_SIZE];
-    UINT RecvBufferUsed;
-    UINT RecvBufferCapacity;
+    CIRCULAR_BUFFER RecvBuffer;     // In-order bytes not read yet, the only receive copy
+    U8* RecvBufferData;             // Allocated with the connection, RecvBufferCapacity bytes
+    UINT RecvBufferCapacity;        // Bytes RecvBuffer may hold, the base of the advertised window
+    TCP_RECV_REQUEST RecvRequest;   // Reader sleeping on an empty RecvBuffer
+
+    // Reassembly: bytes past RecvNext, indexed by sequence number modulo RecvBufferCapacity
+    U8* ReorderBuffer;
+    TCP_RECV_RANGE RecvRanges[TCP_MAX_RECV_RANGES];
+    U32 RecvRangeCount;
+    U32 RecvLatestSequence;         // Start of the last out-of-order segment, reported first
 
     // State machine
     STATE_MACHINE StateMachine;
@@ -142,15 +197,13 @@ typedef struct tag_TCP_CONNECTION {
     U32 RetransmitBaseTimeout;
     U32 RetransmitCurrentTimeout;
 
-    // Retransmission tracking
-    U32 RetransmitSequenceStart;
-    U32 RetransmitSequenceEnd;
-    U32 RetransmitTimestamp;
-    U32 RetransmitPayloadLength;
-    U8 RetransmitFlags;
-    BOOL RetransmitPending;
-    BOOL RetransmitWasRetried;
-    U8 RetransmitPayload[TCP_MAX_RETRANSMIT_PAYLOAD];
+    // Retransmission queue, oldest segment first
+    TCP_SEGMENT Segments[TCP_MAX_SEND_SEGMENTS];
+    U32 SegmentCount;
+    BOOL FinPending;        // FIN waits for the queued data
+    BOOL FinReceived;       // The peer sent FIN, acted on once RecvNext reaches FinSequence
+    U32 FinSequence;        // Sequence number of the FIN of the peer
+    BOOL SackPermitted;     // Both ends announced SACK
 
     // ACK/recovery tracking
     U32 DuplicateAckCount;
@@ -164,13 +217,39 @@ typedef struct tag_TCP_CONNECTION {
 
     // Notification context for this connection
     LPNOTIFICATION_CONTEXT NotificationContext;
+
+    // Entry in the lookup tables, and socket that receives the data
+    TCP_DEMUX_NODE Demux;
+    LPVOID Owner;
+
+    // Passive open: listener of a connection not handed to its socket yet
+    LPVOID Listener;
+    U32 HalfOpenCount;      // On a listener, children still in the handshake
 } TCP_CONNECTION, *LPTCP_CONNECTION;
 
+/************************************************************************/
+// TCP Options
+
+typedef struct tag_TCP_OPTIONS {
+    BOOL HasMSS;
+    U16 MSS;
+    BOOL HasWindowScale;
+    U8 WindowScale;
+    BOOL HasTimestamp;
+    U32 TSVal;
+    U32 TSEcr;
+    BOOL SackPermitted;
+    U32 SackCount;
+    U32 SackStart[TCP_MAX_SACK_BLOCKS];
+    U32 SackEnd[TCP_MAX_SACK_BLOCKS];
+} TCP_OPTIONS, *LPTCP_OPTIONS;
+
 /************************************************************************/
 // TCP Packet Event Data
 
 typedef struct tag_TCP_PACKET_EVENT {
     const TCP_HEADER* Header;
+    const TCP_OPTIONS* Options;
     const U8* Payload;
     U32 PayloadLength;
     U32 SourceIP;
@@ -201,6 +280,24 @@ int TCP_Send(LPTCP_CONNECTION Connection, const U8* Data, U32 Length);
 // Receive data
 int TCP_Receive(LPTCP_CONNECTION Connection, U8* Buffer, U32 BufferSize);
 
+// Receive data, sleeping up to TimeOut ms while the receive buffer is empty
+int TCP_WaitReceive(LPTCP_CONNECTION Connection, U8* Buffer, U32 BufferSize, U32 TimeOut);
+
+// Get the number of bytes waiting in the receive buffer
+U32 TCP_GetReceiveAvailable(LPTCP_CONNECTION Connection);
+
+// Tell whether the peer may still send data
+BOOL TCP_CanReceive(LPTCP_CONNECTION Connection);
+
+// Get the number of bytes the send buffer may still take
+U32 TCP_GetSendSpace(LPTCP_CONNECTION Connection);
+
+// Enable or disable the Nagle algorithm (TCP_NODELAY)
+void TCP_SetNoDelay(LPTCP_CONNECTION Connection, BOOL NoDelay);
+
+// Attach the socket that receives the data of a connection
+void TCP_SetOwner(LPTCP_CONNECTION Connection, LPVOID Owner);
+
 // Close connection
 int TCP_Close(LPTCP_CONNECTION Connection);
 
@@ -208,7 +305,7 @@ int TCP_Close(LPTCP_CONNECTION Connection);
 SM_STATE TCP_GetState(LPTCP_CONNECTION Connection);
 
 // Process incoming IPv4 packet (registered as IPv4 protocol handler)
-void TCP_OnIPv4Packet(const U8* Payload, U32 PayloadLength, U32 SourceIP, U32 DestinationIP);
+void TCP_OnIPv4Packet(const U8* Payload, U32 PayloadLength, U32 SourceIP, U32 DestinationIP, U32 Flags);
 
 // Update TCP subsystem (call periodically for timers)
 void TCP_Update(void);
@@ -229,9 +326,18 @@ void TCP_ProcessDataConsumption(LPTCP_CONNECTION Connection, U32 DataConsumed);
 // Check if window update ACK should be sent based on hysteresis
 BOOL TCP_ShouldSendWindowUpdate(LPTCP_CONNECTION Connection);
 
-// Notify TCP stack that application consumed bytes from receive buffer
+// Notify TCP stack that application removed bytes from the receive buffer
 void TCP_HandleApplicationRead(LPTCP_CONNECTION Connection, U32 BytesConsumed);
 
+// Window scale that lets the advertised window cover a receive capacity (RFC 7323)
+U8 TCP_GetWindowScaleForCapacity(UINT Capacity);
+
+// Record the options the peer announced in its SYN
+void TCP_NegotiateOptions(LPTCP_CONNECTION Conn, const TCP_OPTIONS* Options);
+
+// Window field of an outgoing segment, host byte order
+U16 TCP_GetWindowField(LPTCP_CONNECTION Conn, U8 Flags);
+
 // Utility functions
 U16 TCP_CalculateChecksum(TCP_HEADER* Header, const U8* Payload, U32 PayloadLength, U32 SourceIP, U32 DestinationIP);
 int TCP_ValidateChecksum(TCP_HEADER* Header, const U8* Payload, U32 PayloadLength, U32 SourceIP, U32 DestinationIP);
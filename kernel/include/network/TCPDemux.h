@@ -0,0 +1,108 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    TCP Demultiplexing - Connection lookup tables
+
+\************************************************************************/
+
+#ifndef TCPDEMUX_H_INCLUDED
+#define TCPDEMUX_H_INCLUDED
+
+#include "Base.h"
+
+/************************************************************************/
+
+#define TCP_DEMUX_TUPLE_BUCKETS 256     // Power of two
+#define TCP_DEMUX_PORT_BUCKETS 64       // Power of two
+
+/************************************************************************/
+
+/**
+ * Entry of a connection in the lookup tables. Addresses and ports are in
+ * network byte order. An entry whose remote address and port are zero is
+ * a listener and goes to the listener table, any other entry goes to the
+ * 4-tuple and port tables.
+ */
+typedef struct tag_TCP_DEMUX_NODE {
+    struct tag_TCP_DEMUX_NODE* TupleNext;   // 4-tuple bucket chain
+    struct tag_TCP_DEMUX_NODE* PortNext;    // Port or listener bucket chain
+    U32 LocalIP;
+    U32 RemoteIP;
+    U16 LocalPort;
+    U16 RemotePort;
+    BOOL Linked;
+    LPVOID Connection;                      // Owner of the entry
+} TCP_DEMUX_NODE, *LPTCP_DEMUX_NODE;
+
+typedef struct tag_TCP_DEMUX {
+    LPTCP_DEMUX_NODE Tuples[TCP_DEMUX_TUPLE_BUCKETS];  // Entries with a remote endpoint
+    LPTCP_DEMUX_NODE Ports[TCP_DEMUX_PORT_BUCKETS];    // Same entries, by local port
+    LPTCP_DEMUX_NODE Listeners[TCP_DEMUX_PORT_BUCKETS];  // Listeners, by local port
+    UINT Count;
+} TCP_DEMUX, *LPTCP_DEMUX;
+
+/************************************************************************/
+
+/**
+ * @brief Empty the tables.
+ * @param Demux Tables to reset.
+ */
+void TCP_DemuxInit(LPTCP_DEMUX Demux);
+
+/**
+ * @brief Link an entry with the key already stored in it.
+ * @param Demux Tables.
+ * @param Node Entry, ignored when already linked.
+ */
+void TCP_DemuxInsert(LPTCP_DEMUX Demux, LPTCP_DEMUX_NODE Node);
+
+/**
+ * @brief Unlink an entry.
+ * @param Demux Tables.
+ * @param Node Entry, ignored when not linked.
+ */
+void TCP_DemuxRemove(LPTCP_DEMUX Demux, LPTCP_DEMUX_NODE Node);
+
+/**
+ * @brief Find the entry of a received segment.
+ *
+ * The exact 4-tuple wins. Otherwise a listener on the local port whose
+ * local address is the destination, or zero, gets the segment.
+ *
+ * @param Demux Tables.
+ * @param LocalIP Destination address of the segment.
+ * @param LocalPort Destination port of the segment.
+ * @param RemoteIP Source address of the segment.
+ * @param RemotePort Source port of the segment.
+ * @return Matching entry, or NULL.
+ */
+LPTCP_DEMUX_NODE TCP_DemuxLookup(LPTCP_DEMUX Demux, U32 LocalIP, U16 LocalPort, U32 RemoteIP, U16 RemotePort);
+
+/**
+ * @brief Tell whether an entry uses a local address and port.
+ * @param Demux Tables.
+ * @param LocalIP Local address.
+ * @param LocalPort Local port.
+ * @return TRUE when the pair is in use.
+ */
+BOOL TCP_DemuxIsPortInUse(LPTCP_DEMUX Demux, U32 LocalIP, U16 LocalPort);
+
+/************************************************************************/
+
+#endif // TCPDEMUX_H_INCLUDED
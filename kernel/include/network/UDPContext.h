@@ -58,7 +58,7 @@ void UDP_Destroy(LPDEVICE Device);
 void UDP_RegisterPortHandler(LPDEVICE Device, U16 Port, UDP_PortHandler Handler);
 void UDP_UnregisterPortHandler(LPDEVICE Device, U16 Port);
 int UDP_Send(LPDEVICE Device, U32 DestinationIP, U16 SourcePort, U16 DestinationPort, const U8* Payload, U32 PayloadLength);
-void UDP_OnIPv4Packet(const U8* Payload, U32 PayloadLength, U32 SourceIP, U32 DestinationIP);
+void UDP_OnIPv4Packet(const U8* Payload, U32 PayloadLength, U32 SourceIP, U32 DestinationIP, U32 Flags);
 
 /************************************************************************/
 
@@ -33,6 +33,7 @@
 #include "core/ID.h"
 #include "utils/List.h"
 #include "memory/Memory.h"
+#include "memory/Slab.h"
 #include "sync/Mutex.h"
 #include "core/Security.h"
 #include "system/System.h"
@@ -174,6 +175,7 @@ struct tag_PROCESS {
     PHYSICAL PageDirectory;
     LINEAR HeapBase;
     UINT HeapSize;
+    SLAB_MAGAZINE HeapMagazines[HEAP_MAGAZINE_CLASSES];    // Recently freed small heap blocks, per size class
     UINT MaximumAllocatedMemory;
     UINT ExitCode;                                          // Exit code
     STR FileName[MAX_PATH_NAME];
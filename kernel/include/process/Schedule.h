@@ -38,12 +38,28 @@ typedef void (*SCHEDULER_TICK_CALLBACK)(LPVOID Context);
 
 #define SCHEDULER_TICK_INVALID_HANDLE 0xFFFFFFFF
 
+// Scheduler queues (TASK.SchedulerLink.Queue)
+#define SCHEDULER_QUEUE_NONE 0x00
+#define SCHEDULER_QUEUE_READY 0x01
+#define SCHEDULER_QUEUE_SLEEPING 0x02
+#define SCHEDULER_QUEUE_BLOCKED 0x03
+#define SCHEDULER_QUEUE_DEAD 0x04
+
+// Number of ready queue levels, one bit per level in the ready bitmap
+#define SCHEDULER_PRIORITY_LEVELS 32
+
 // Adds a task to the scheduler's queue
 BOOL AddTaskToQueue(LPTASK NewTask);
 
 // Removes a task from scheduler's queue
 BOOL RemoveTaskFromQueue(LPTASK);
 
+// Moves a queued task to the scheduler queue matching its current state
+void SchedulerUpdateTask(LPTASK Task);
+
+// Moves every queued task of a process to the queue matching its current state
+void SchedulerUpdateProcessTasks(LPPROCESS Process);
+
 // Runs the scheduler to activate the next task (preemptive)
 void Scheduler(void);
 
@@ -62,12 +78,18 @@ BOOL UnfreezeScheduler(void);
 // Returns TRUE when the scheduler is frozen
 BOOL IsSchedulerFrozen(void);
 
-// Registers one lightweight scheduler tick callback
+// Registers one lightweight scheduler callback run every scheduler tick period (10 ms)
 U32 SchedulerRegisterTickCallback(SCHEDULER_TICK_CALLBACK Callback, LPVOID Context);
 
-// Unregisters one scheduler tick callback
+// Registers one lightweight scheduler callback run every PeriodMilliSeconds
+U32 SchedulerRegisterPeriodicCallback(SCHEDULER_TICK_CALLBACK Callback, LPVOID Context, UINT PeriodMilliSeconds);
+
+// Unregisters one scheduler tick or periodic callback
 void SchedulerUnregisterTickCallback(U32 Handle);
 
+// Returns the earliest sleeping task wake-up or periodic callback time
+UINT SchedulerGetNextDeadline(void);
+
 // Waits for one or more kernel objects to become signaled
 U32 Wait(LPWAIT_INFO WaitInfo);
 
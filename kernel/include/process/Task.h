@@ -38,6 +38,7 @@
 #include "sync/Mutex.h"
 #include "User.h"
 #include "utils/MessageQueue.h"
+#include "utils/TimerWheel.h"
 
 /************************************************************************/
 
@@ -71,6 +72,21 @@ typedef struct tag_TASK_SCHEDULER_STATE {
     BOOL Suspended;
 } TASK_SCHEDULER_STATE, *LPTASK_SCHEDULER_STATE;
 
+// Scheduler-owned queue linkage
+
+typedef struct tag_TASK_SCHEDULER_LINK {
+    struct tag_TASK* Next;      // Next task in the same scheduler queue
+    struct tag_TASK* Previous;  // Previous task in the same scheduler queue
+    U32 Queue;                  // Scheduler queue holding the task (SCHEDULER_QUEUE_*)
+    U32 Level;                  // Ready queue level when Queue is SCHEDULER_QUEUE_READY
+    U32 ReadySequence;          // Arrival order in the ready queues, oldest runs first
+    TIMER_WHEEL_ENTRY SleepTimer;  // Armed with WakeUpTime while Queue is SCHEDULER_QUEUE_SLEEPING
+} TASK_SCHEDULER_LINK, *LPTASK_SCHEDULER_LINK;
+
+// Condition a task sleeps on in SleepUntil, checked with interrupts disabled
+
+typedef BOOL (*TASK_WAIT_CONDITION)(LPVOID Context);
+
 /************************************************************************/
 // The Task structure
 
@@ -86,6 +102,7 @@ struct tag_TASK {
     U32 Flags;                // Task creation flags
     ARCH_TASK_DATA Arch;      // Architecture-specific task data
     TASK_SCHEDULER_STATE SchedulerState;  // Scheduler-owned ISR-visible state
+    TASK_SCHEDULER_LINK SchedulerLink;    // Scheduler-owned queue linkage
     LPMUTEX WaitingMutex;     // Mutex currently waited by this task
     UINT WaitingSince;        // Time at which the current mutex wait started
     U32 HeldMutexClassDepth;  // Number of held lock classes tracked for diagnostics
@@ -110,6 +127,8 @@ BOOL SetTaskExitCode(LPTASK Task, UINT Code);
 void DeleteDeadTasksAndProcesses(void);
 U32 SetTaskPriority(LPTASK, U32);
 void Sleep(U32);
+BOOL SleepUntil(TASK_WAIT_CONDITION Condition, LPVOID Context, UINT TimeOut);
+void WakeUpTask(LPTASK Task);
 U32 GetTaskStatus(LPTASK Task);
 BOOL GetTaskSchedulerState(LPTASK Task, LPTASK_SCHEDULER_STATE State);
 BOOL IsTaskExecutionSuspended(LPTASK Task);
@@ -48,6 +48,7 @@ U32 CMD_copy(LPSHELLCONTEXT Context);
 U32 CMD_edit(LPSHELLCONTEXT Context);
 U32 CMD_memorymap(LPSHELLCONTEXT Context);
 U32 CMD_disk(LPSHELLCONTEXT Context);
+U32 CMD_diskbench(LPSHELLCONTEXT Context);
 U32 CMD_filesystem(LPSHELLCONTEXT Context);
 U32 CMD_network(LPSHELLCONTEXT Context);
 U32 CMD_pic(LPSHELLCONTEXT Context);
@@ -60,6 +61,7 @@ U32 CMD_logout(LPSHELLCONTEXT Context);
 U32 CMD_whoami(LPSHELLCONTEXT Context);
 U32 CMD_passwd(LPSHELLCONTEXT Context);
 U32 CMD_prof(LPSHELLCONTEXT Context);
+U32 CMD_slab(LPSHELLCONTEXT Context);
 U32 CMD_autotest(LPSHELLCONTEXT Context);
 U32 CMD_usb(LPSHELLCONTEXT Context);
 U32 CMD_nvme(LPSHELLCONTEXT Context);
@@ -33,6 +33,7 @@
 
 void InitializeClock(void);
 UINT GetSystemTime(void);
+U64 GetSystemTimeMicroseconds(void);
 void MarkSystemTimeOperational(void);
 BOOL IsSystemTimeOperational(void);
 BOOL HasOperationTimedOut(UINT StartTime, UINT LoopCount, UINT LoopLimit, UINT TimeoutMilliseconds);
@@ -0,0 +1,74 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Clock events
+
+\************************************************************************/
+#ifndef CLOCKEVENT_H_INCLUDED
+#define CLOCKEVENT_H_INCLUDED
+
+/***************************************************************************/
+
+#include "Base.h"
+
+/***************************************************************************/
+
+// Clock event devices
+#define CLOCK_EVENT_MODE_PIT_PERIODIC 0x00   // 8254 PIT, fixed period
+#define CLOCK_EVENT_MODE_LAPIC_ONESHOT 0x01  // Local APIC timer, one-shot count
+#define CLOCK_EVENT_MODE_TSC_DEADLINE 0x02   // Local APIC timer, TSC-deadline
+
+// Period of the PIT fallback and of the scheduler when frozen
+#define CLOCK_EVENT_PIT_PERIOD_MS 10
+
+// Longest interval between two one-shot events
+#define CLOCK_EVENT_MAX_INTERVAL_MS 500
+
+/***************************************************************************/
+
+// Calibrates the TSC and the local APIC timer against the PIT and selects the event device
+void InitializeClockEvents(void);
+
+// Returns the active event device (CLOCK_EVENT_MODE_*)
+U32 ClockEventGetMode(void);
+
+// Returns TRUE when events are programmed one at a time
+BOOL ClockEventIsOneShot(void);
+
+// Returns the calibrated TSC frequency in kHz, 0 when the TSC is not used
+U32 ClockEventGetTscKHz(void);
+
+// Accounts one clock interrupt and returns the milliseconds elapsed since the previous one
+UINT ClockEventUpdate(void);
+
+// Returns the monotonic time in milliseconds
+UINT ClockEventGetMilliseconds(void);
+
+// Returns the monotonic time in microseconds
+U64 ClockEventGetMicroseconds(void);
+
+// Programs the next one-shot event at an absolute time in milliseconds
+void ClockEventSetNext(UINT Deadline);
+
+// Moves the next one-shot event earlier when Deadline comes first
+void ClockEventRequest(UINT Deadline);
+
+/***************************************************************************/
+
+#endif
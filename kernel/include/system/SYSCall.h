@@ -184,6 +184,7 @@ UINT SysCall_SocketGetOption(UINT Parameter);
 UINT SysCall_SocketSetOption(UINT Parameter);
 UINT SysCall_SocketGetPeerName(UINT Parameter);
 UINT SysCall_SocketGetSocketName(UINT Parameter);
+UINT SysCall_SocketPoll(UINT Parameter);
 
 /************************************************************************/
 
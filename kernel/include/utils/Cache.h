@@ -34,6 +34,8 @@
 /************************************************************************/
 
 #define CACHE_DEFAULT_CAPACITY 256
+#define CACHE_LOCK_STRIPES 16                   // Bucket locks, power of two
+#define CACHE_NO_ENTRY MAX_UINT
 #define CACHE_WRITE_POLICY_READ_ONLY 0
 #define CACHE_WRITE_POLICY_WRITE_THROUGH 1
 #define CACHE_WRITE_POLICY_WRITE_BACK 2
@@ -42,6 +44,7 @@
 
 typedef BOOL (*CACHE_FLUSH_CALLBACK)(LPVOID Data, LPVOID Context);
 typedef void (*CACHE_RELEASE_CALLBACK)(LPVOID Data, BOOL Dirty, LPVOID Context);
+typedef BOOL (*CACHE_MATCHER)(LPVOID Data, LPVOID Context);
 
 /************************************************************************/
 
@@ -49,20 +52,32 @@ typedef struct tag_CACHE_ENTRY {
     LPVOID Data;
     UINT ExpirationTime;
     UINT TTL;
-    UINT Score;
+    U32 Key;                    // Hash supplied by the caller, 0 for CacheAdd
+    UINT Next;                  // Next entry in the bucket or in the free list
+    BOOL Referenced;            // Set by lookups, cleared by the CLOCK hand
     BOOL Dirty;
     BOOL Valid;
 } CACHE_ENTRY, *LPCACHE_ENTRY;
 
+/**
+ * Entries are chained in hash buckets. Lookups only take the lock stripe of
+ * their bucket. Insertion, eviction and flushes take Mutex first, then the
+ * stripe of the entry they link or unlink.
+ */
 typedef struct tag_CACHE {
     LPCACHE_ENTRY Entries;
+    UINT* Buckets;              // First entry of each bucket
+    UINT BucketCount;           // Power of two
     UINT Capacity;
     UINT Count;
+    UINT FreeList;              // First unused entry
+    UINT ClockHand;             // Next entry looked at by eviction
     U32 WritePolicy;
     CACHE_FLUSH_CALLBACK FlushCallback;
     CACHE_RELEASE_CALLBACK ReleaseCallback;
     LPVOID CallbackContext;
     MUTEX Mutex;
+    MUTEX Stripes[CACHE_LOCK_STRIPES];
 } CACHE, *LPCACHE;
 
 /************************************************************************/
@@ -72,7 +87,10 @@ void CacheDeinit(LPCACHE Cache);
 void CacheSetWritePolicy(
     LPCACHE Cache, U32 WritePolicy, CACHE_FLUSH_CALLBACK FlushCallback, CACHE_RELEASE_CALLBACK ReleaseCallback, LPVOID CallbackContext);
 BOOL CacheAdd(LPCACHE Cache, LPVOID Data, UINT TTL_MS);
-LPVOID CacheFind(LPCACHE Cache, BOOL (*Matcher)(LPVOID Data, LPVOID Context), LPVOID Context);
+BOOL CacheAddKey(LPCACHE Cache, U32 Key, LPVOID Data, UINT TTL_MS);
+LPVOID CacheFind(LPCACHE Cache, CACHE_MATCHER Matcher, LPVOID Context);
+LPVOID CacheFindKey(LPCACHE Cache, U32 Key, CACHE_MATCHER Matcher, LPVOID Context);
+U32 CacheHashMix(U32 Hash, U32 Value);
 BOOL CacheMarkEntryDirty(LPCACHE Cache, LPVOID Data);
 BOOL CacheFlushEntry(LPCACHE Cache, LPVOID Data);
 UINT CacheFlushAllEntries(LPCACHE Cache);
@@ -76,7 +76,8 @@
 #define TCP_TIME_WAIT_TIMEOUT             30000         // TCP TIME-WAIT timeout fallback (ms)
 #define TCP_MAX_RETRANSMITS               5             // TCP maximum retransmits fallback
 #define TCP_SEND_BUFFER_SIZE              N_32KB        // TCP send buffer size fallback
-#define TCP_RECV_BUFFER_SIZE              N_32KB        // TCP receive buffer size fallback
+#define TCP_RECV_BUFFER_SIZE              N_256KB       // TCP receive buffer size fallback
+#define TCP_RECV_BUFFER_MAX_SIZE          N_4MB         // TCP receive buffer size limit
 
 /***************************************************************************/
 
@@ -29,8 +29,19 @@
 
 /************************************************************************/
 
+// Shortest buffer worth the SSE2 setup
+#define NETWORK_CHECKSUM_SSE2_THRESHOLD 64
+
+/************************************************************************/
+
 U32 NetworkChecksum_Calculate_Accumulate(const U8* Data, U32 Length, U32 Accumulator);
+U32 NetworkChecksum_Accumulate_Bytes(const U8* Data, U32 Length, U32 Accumulator);
+U32 NetworkChecksum_Accumulate_Wide(const U8* Data, U32 Length, U32 Accumulator);
+#if defined(__EXOS_ARCH_X86_64__)
+U32 NetworkChecksum_Accumulate_Sse2(const U8* Data, U32 Length, U32 Accumulator);
+#endif
 U16 NetworkChecksum_Finalize(U32 Accumulator);
+U16 NetworkChecksum_Fold(U32 Accumulator);
 U16 NetworkChecksum_Calculate(const U8* Data, U32 Length);
 
 /************************************************************************/
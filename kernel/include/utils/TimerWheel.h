@@ -0,0 +1,115 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Hierarchical Timer Wheel
+
+\************************************************************************/
+
+#ifndef TIMERWHEEL_H_INCLUDED
+#define TIMERWHEEL_H_INCLUDED
+
+#include "Base.h"
+
+/************************************************************************/
+
+#define TIMER_WHEEL_LEVELS 5
+#define TIMER_WHEEL_SLOT_BITS 5
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_UNARMED 0xFFFFFFFF
+
+typedef struct tag_TIMER_WHEEL_ENTRY TIMER_WHEEL_ENTRY, *LPTIMER_WHEEL_ENTRY;
+
+typedef void (*TIMER_WHEEL_CALLBACK)(LPTIMER_WHEEL_ENTRY Entry, LPVOID Context);
+
+struct tag_TIMER_WHEEL_ENTRY {
+    LPTIMER_WHEEL_ENTRY Next;
+    LPTIMER_WHEEL_ENTRY Previous;
+    UINT Deadline;                  // Absolute expiry time in milliseconds
+    U32 Slot;                       // Level * TIMER_WHEEL_SLOTS + slot, or TIMER_WHEEL_UNARMED
+    TIMER_WHEEL_CALLBACK Callback;  // Called from TimerWheelAdvance once expired
+    LPVOID Context;
+};
+
+typedef struct tag_TIMER_WHEEL {
+    UINT Resolution;                // Milliseconds per tick
+    UINT CurrentTick;               // Next tick to process
+    UINT Count;                     // Armed entries
+    U32 SlotBitmap[TIMER_WHEEL_LEVELS];  // One bit per non-empty slot
+    LPTIMER_WHEEL_ENTRY Slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} TIMER_WHEEL, *LPTIMER_WHEEL;
+
+/************************************************************************/
+
+/**
+ * @brief Initialize an empty timer wheel
+ * @param Wheel The wheel to initialize
+ * @param Resolution Milliseconds per tick
+ * @param Now Current time in milliseconds
+ */
+void TimerWheelInitialize(LPTIMER_WHEEL Wheel, UINT Resolution, UINT Now);
+
+/**
+ * @brief Initialize an unarmed timer entry
+ * @param Entry The entry to initialize
+ * @param Callback Function called when the entry expires
+ * @param Context Opaque callback context
+ */
+void TimerWheelEntryInitialize(LPTIMER_WHEEL_ENTRY Entry, TIMER_WHEEL_CALLBACK Callback, LPVOID Context);
+
+/**
+ * @brief Arm or re-arm an entry
+ * @param Wheel The wheel holding the entry
+ * @param Entry The entry to arm
+ * @param Deadline Absolute expiry time in milliseconds
+ */
+void TimerWheelArm(LPTIMER_WHEEL Wheel, LPTIMER_WHEEL_ENTRY Entry, UINT Deadline);
+
+/**
+ * @brief Disarm an entry, no-op when it is not armed
+ * @param Wheel The wheel holding the entry
+ * @param Entry The entry to disarm
+ */
+void TimerWheelDisarm(LPTIMER_WHEEL Wheel, LPTIMER_WHEEL_ENTRY Entry);
+
+/**
+ * @brief Tell whether an entry is armed
+ * @param Entry The entry to check
+ * @return TRUE when armed
+ */
+BOOL TimerWheelIsArmed(LPTIMER_WHEEL_ENTRY Entry);
+
+/**
+ * @brief Process every tick up to the current time and run expired callbacks
+ * @param Wheel The wheel to advance
+ * @param Now Current time in milliseconds
+ * @return Number of callbacks run
+ */
+UINT TimerWheelAdvance(LPTIMER_WHEEL Wheel, UINT Now);
+
+/**
+ * @brief Get the earliest armed deadline
+ * @param Wheel The wheel to inspect
+ * @return Deadline in milliseconds, or INFINITY when the wheel is empty
+ */
+UINT TimerWheelGetNextDeadline(LPTIMER_WHEEL Wheel);
+
+/************************************************************************/
+
+#endif // TIMERWHEEL_H_INCLUDED
@@ -82,6 +82,24 @@ void WriteMSR64(U32 Msr, U32 ValueLow, U32 ValueHigh) {
 
 /***************************************************************************/
 
+/**
+ * @brief Read the processor time-stamp counter.
+ * @return Current TSC value.
+ */
+U64 ReadTimeStampCounter(void) {
+    U32 Low;
+    U32 High;
+
+    __asm__ volatile (
+        "rdtsc"
+        : "=a" (Low), "=d" (High)
+    );
+
+    return U64_Make(High, Low);
+}
+
+/***************************************************************************/
+
 void InitializePat(void) {
     LPCPU_INFORMATION CpuInfo = GetKernelCPUInfo();
     if (CpuInfo == NULL) {
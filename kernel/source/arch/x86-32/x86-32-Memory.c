@@ -1180,8 +1180,10 @@ static BOOL PopulateRegionPages(LINEAR Base,
     UINT ReadWrite = (Flags & ALLOC_PAGES_READWRITE) ? 1 : 0;
     UINT PteCacheDisabled = (Flags & ALLOC_PAGES_UC) ? 1 : 0;
     UINT PteWriteThrough = (Flags & ALLOC_PAGES_WC) ? 1 : 0;
+    PHYSICAL_PAGE_BATCH PageBatch;
 
     if (PteCacheDisabled) PteWriteThrough = 0;
+    MemorySet(&PageBatch, 0, sizeof(PageBatch));
 
     for (UINT Index = 0; Index < NumPages; Index++) {
         UINT DirEntry = GetDirectoryEntry(Base);
@@ -1191,6 +1193,7 @@ static BOOL PopulateRegionPages(LINEAR Base,
             if (AllocPageTable(Base) == NULL) {
                 FreeRegion(RollbackBase, (Index << PAGE_SIZE_MUL));
                 DEBUG(TEXT("[%s] AllocPageTable failed"), FunctionName);
+                PhysicalPageBatchRelease(&PageBatch);
                 return FALSE;
             }
         }
@@ -1226,11 +1229,12 @@ static BOOL PopulateRegionPages(LINEAR Base,
                     Table[TabEntry].Address = Physical >> PAGE_SIZE_MUL;
                 }
             } else {
-                Physical = AllocPhysicalPage();
+                Physical = PhysicalPageBatchTake(&PageBatch, NumPages - Index);
 
                 if (Physical == NULL) {
                     ERROR(TEXT("[%s] AllocPhysicalPage failed"), FunctionName);
                     FreeRegion(RollbackBase, (Index << PAGE_SIZE_MUL));
+                    PhysicalPageBatchRelease(&PageBatch);
                     return FALSE;
                 }
 
@@ -1246,6 +1250,7 @@ static BOOL PopulateRegionPages(LINEAR Base,
                 *(volatile U32*)&Table[TabEntry]) == FALSE) {
             FreeRegion(RollbackBase, (Index << PAGE_SIZE_MUL));
             ERROR(TEXT("[%s] Kernel mapping synchronization failed for %p"), FunctionName, (LPVOID)Base);
+            PhysicalPageBatchRelease(&PageBatch);
             return FALSE;
         }
 
@@ -1275,6 +1280,7 @@ static BOOL PopulateRegionPages(LINEAR Base,
  *              - ALLOC_PAGES_UC / ALLOC_PAGES_WC: control cache attributes
  *                (UC has priority over WC).
  *              - ALLOC_PAGES_IO: keep physical pages marked fixed for MMIO.
+ *              - ALLOC_PAGES_LARGE: ignored, regions always use 4 KiB pages.
  * @return Allocated linear base address or 0 on failure.
  */
 LINEAR AllocRegionForProcess(LPPROCESS TrackingProcess, LINEAR Base, PHYSICAL Target, UINT Size, U32 Flags, LPCSTR Tag) {
@@ -324,9 +324,7 @@ LINEAR MapTemporaryPhysicalPage1(PHYSICAL Physical) {
         G_TempLinear1, Physical,
         /*RW*/ 1, PAGE_PRIVILEGE_KERNEL, /*WT*/ 0, /*UC*/ 0, /*Global*/ 0, /*Fixed*/ 1);
 
-    // Ensure the CPU stops using the previous translation before callers touch the
-    // new physical page through the shared temporary slot.
-    FlushTLB();
+    // MapOnePage already invalidated the previous translation of the slot
 
     return G_TempLinear1;
 }
@@ -353,9 +351,7 @@ LINEAR MapTemporaryPhysicalPage2(PHYSICAL Physical) {
         G_TempLinear2, Physical,
         /*RW*/ 1, PAGE_PRIVILEGE_KERNEL, /*WT*/ 0, /*UC*/ 0, /*Global*/ 0, /*Fixed*/ 1);
 
-    // Ensure the CPU stops using the previous translation before callers touch the
-    // new physical page through the shared temporary slot.
-    FlushTLB();
+    // MapOnePage already invalidated the previous translation of the slot
 
     return G_TempLinear2;
 }
@@ -382,9 +378,7 @@ LINEAR MapTemporaryPhysicalPage3(PHYSICAL Physical) {
         G_TempLinear3, Physical,
         /*RW*/ 1, PAGE_PRIVILEGE_KERNEL, /*WT*/ 0, /*UC*/ 0, /*Global*/ 0, /*Fixed*/ 1);
 
-    // Ensure the CPU stops using the previous translation before callers touch the
-    // new physical page through the shared temporary slot.
-    FlushTLB();
+    // MapOnePage already invalidated the previous translation of the slot
 
     return G_TempLinear3;
 }
@@ -411,7 +405,7 @@ LINEAR MapTemporaryPhysicalPage4(PHYSICAL Physical) {
         G_TempLinear4, Physical,
         /*RW*/ 1, PAGE_PRIVILEGE_KERNEL, /*WT*/ 0, /*UC*/ 0, /*Global*/ 0, /*Fixed*/ 1);
 
-    FlushTLB();
+    // MapOnePage already invalidated the previous translation of the slot
 
     return G_TempLinear4;
 }
@@ -438,7 +432,7 @@ LINEAR MapTemporaryPhysicalPage5(PHYSICAL Physical) {
         G_TempLinear5, Physical,
         /*RW*/ 1, PAGE_PRIVILEGE_KERNEL, /*WT*/ 0, /*UC*/ 0, /*Global*/ 0, /*Fixed*/ 1);
 
-    FlushTLB();
+    // MapOnePage already invalidated the previous translation of the slot
 
     return G_TempLinear5;
 }
@@ -465,7 +459,7 @@ LINEAR MapTemporaryPhysicalPage6(PHYSICAL Physical) {
         G_TempLinear6, Physical,
         /*RW*/ 1, PAGE_PRIVILEGE_KERNEL, /*WT*/ 0, /*UC*/ 0, /*Global*/ 0, /*Fixed*/ 1);
 
-    FlushTLB();
+    // MapOnePage already invalidated the previous translation of the slot
 
     return G_TempLinear6;
 }
@@ -540,6 +534,320 @@ LINEAR AllocPageTable(LINEAR Base) {
 
 /************************************************************************/
 
+/**
+ * @brief Map the page directory that covers a linear address.
+ *
+ * Uses temporary slots #1 and #2, the returned pointer stays valid until
+ * one of them is remapped.
+ *
+ * @param Base Canonical linear address.
+ * @param OutDirectory Receives the mapped page directory.
+ * @return TRUE when the PML4 and PDPT levels are present, FALSE otherwise.
+ */
+static BOOL MapPageDirectoryForLinear(LINEAR Base, LPPAGE_DIRECTORY* OutDirectory) {
+    ARCH_PAGE_ITERATOR Iterator = MemoryPageIteratorFromLinear(Base);
+    UINT Pml4Index = MemoryPageIteratorGetPml4Index(&Iterator);
+    UINT PdptIndex = MemoryPageIteratorGetPdptIndex(&Iterator);
+
+    LPPML4 Pml4 = GetCurrentPml4VA();
+    U64 Pml4EntryValue = ReadPageDirectoryEntryValue((LPPAGE_DIRECTORY)Pml4, Pml4Index);
+
+    if ((Pml4EntryValue & PAGE_FLAG_PRESENT) == 0) {
+        return FALSE;
+    }
+
+    PHYSICAL PdptPhysical = (PHYSICAL)(Pml4EntryValue & PAGE_MASK);
+    LPPAGE_DIRECTORY PdptLinear = (LPPAGE_DIRECTORY)MapTemporaryPhysicalPage1(PdptPhysical);
+    U64 PdptEntryValue = ReadPageDirectoryEntryValue(PdptLinear, PdptIndex);
+
+    if ((PdptEntryValue & PAGE_FLAG_PRESENT) == 0 || (PdptEntryValue & PAGE_FLAG_PAGE_SIZE) != 0) {
+        return FALSE;
+    }
+
+    PHYSICAL DirectoryPhysical = (PHYSICAL)(PdptEntryValue & PAGE_MASK);
+    *OutDirectory = (LPPAGE_DIRECTORY)MapTemporaryPhysicalPage2(DirectoryPhysical);
+
+    return TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Physical base of a 2 MiB directory entry.
+ * @param DirectoryEntryValue Raw directory entry with PAGE_FLAG_PAGE_SIZE set.
+ * @return Physical address of the large page.
+ */
+static PHYSICAL LargePageEntryGetPhysical(U64 DirectoryEntryValue) {
+    return (PHYSICAL)(DirectoryEntryValue & PAGE_MASK & ~PAGE_FLAG_NO_EXECUTE & ~PAGE_TABLE_CAPACITY_MASK);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Map one 2 MiB page with a single page directory entry.
+ *
+ * The directory slot must be free. A page table left empty in the slot is
+ * released and replaced.
+ *
+ * @param Base 2 MiB aligned linear address.
+ * @param Physical 2 MiB aligned physical address.
+ * @param Flags Entry flags from BuildPageFlags().
+ * @return TRUE when the entry was written, FALSE otherwise.
+ */
+BOOL MapLargePage(LINEAR Base, PHYSICAL Physical, U64 Flags) {
+    LPPAGE_DIRECTORY Directory = NULL;
+
+    Base = CanonicalizeLinearAddress(Base);
+
+    if ((Base & PAGE_TABLE_CAPACITY_MASK) != 0 || ((U64)Physical & PAGE_TABLE_CAPACITY_MASK) != 0) {
+        return FALSE;
+    }
+
+    if (MapPageDirectoryForLinear(Base, &Directory) == FALSE) {
+        return FALSE;
+    }
+
+    UINT DirEntry = GetDirectoryEntry(Base);
+    U64 DirectoryEntryValue = ReadPageDirectoryEntryValue(Directory, DirEntry);
+    BOOL ReplacedTable = FALSE;
+
+    if ((DirectoryEntryValue & PAGE_FLAG_PRESENT) != 0) {
+        if ((DirectoryEntryValue & PAGE_FLAG_PAGE_SIZE) != 0) {
+            return FALSE;
+        }
+
+        PHYSICAL TablePhysical = (PHYSICAL)(DirectoryEntryValue & PAGE_MASK);
+        LPPAGE_TABLE Table = (LPPAGE_TABLE)MapTemporaryPhysicalPage3(TablePhysical);
+
+        if (PageTableIsEmpty(Table) == FALSE) {
+            return FALSE;
+        }
+
+        SetPhysicalPageMark((UINT)(TablePhysical >> PAGE_SIZE_MUL), 0u);
+        ReplacedTable = TRUE;
+    }
+
+    WritePageDirectoryEntryValue(Directory, DirEntry, MakePageEntryRaw(Physical, Flags | PAGE_FLAG_PAGE_SIZE));
+
+    if (ReplacedTable) {
+        FlushTLB();
+    }
+
+    return TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Remove a 2 MiB page and release its frames unless it is fixed.
+ * @param Base 2 MiB aligned linear address.
+ * @return TRUE when a large page was removed, FALSE otherwise.
+ */
+BOOL UnmapLargePage(LINEAR Base) {
+    LPPAGE_DIRECTORY Directory = NULL;
+
+    Base = CanonicalizeLinearAddress(Base);
+
+    if ((Base & PAGE_TABLE_CAPACITY_MASK) != 0 || MapPageDirectoryForLinear(Base, &Directory) == FALSE) {
+        return FALSE;
+    }
+
+    UINT DirEntry = GetDirectoryEntry(Base);
+    U64 DirectoryEntryValue = ReadPageDirectoryEntryValue(Directory, DirEntry);
+
+    if ((DirectoryEntryValue & PAGE_FLAG_PRESENT) == 0 || (DirectoryEntryValue & PAGE_FLAG_PAGE_SIZE) == 0) {
+        return FALSE;
+    }
+
+    ClearPageDirectoryEntry(Directory, DirEntry);
+
+    if ((DirectoryEntryValue & PAGE_FLAG_FIXED) == 0) {
+        FreePhysicalPageRange(LargePageEntryGetPhysical(DirectoryEntryValue), PAGE_TABLE_NUM_ENTRIES);
+    }
+
+    return TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Replace a 2 MiB page by a page table mapping the same frames.
+ *
+ * Used before a partial unmap: the 512 new entries keep the physical
+ * addresses and the attributes of the large page.
+ *
+ * @param Base Any linear address inside the large page.
+ * @return TRUE when the page was split, FALSE otherwise.
+ */
+BOOL SplitLargePage(LINEAR Base) {
+    LPPAGE_DIRECTORY Directory = NULL;
+
+    Base = CanonicalizeLinearAddress(Base) & ~PAGE_TABLE_CAPACITY_MASK;
+
+    if (MapPageDirectoryForLinear(Base, &Directory) == FALSE) {
+        return FALSE;
+    }
+
+    UINT DirEntry = GetDirectoryEntry(Base);
+    U64 DirectoryEntryValue = ReadPageDirectoryEntryValue(Directory, DirEntry);
+
+    if ((DirectoryEntryValue & PAGE_FLAG_PRESENT) == 0 || (DirectoryEntryValue & PAGE_FLAG_PAGE_SIZE) == 0) {
+        return FALSE;
+    }
+
+    PHYSICAL TablePhysical = AllocPhysicalPage();
+
+    if (TablePhysical == NULL) {
+        ERROR(TEXT("[SplitLargePage] Out of physical pages"));
+        return FALSE;
+    }
+
+    PHYSICAL LargePhysical = LargePageEntryGetPhysical(DirectoryEntryValue);
+    U64 EntryFlags = DirectoryEntryValue & PAGE_SIZE_MASK & ~PAGE_FLAG_PAGE_SIZE;
+    LPPAGE_TABLE Table = (LPPAGE_TABLE)MapTemporaryPhysicalPage3(TablePhysical);
+
+    for (UINT Index = 0; Index < PAGE_TABLE_NUM_ENTRIES; Index++) {
+        WritePageTableEntryValue(
+            Table, Index, MakePageEntryRaw(LargePhysical + ((PHYSICAL)Index << PAGE_SIZE_MUL), EntryFlags));
+    }
+
+    WritePageDirectoryEntryValue(
+        Directory,
+        DirEntry,
+        MakePageDirectoryEntryValue(
+            TablePhysical,
+            /*ReadWrite*/ 1,
+            PAGE_PRIVILEGE(Base),
+            /*WriteThrough*/ 0,
+            /*CacheDisabled*/ 0,
+            /*Global*/ 0,
+            /*Fixed*/ 1));
+
+    // Drop the old 2 MiB translation and any stale view of the new table
+    InvalidatePage(Base);
+    InvalidatePage((LINEAR)GetPageTableVAFor(Base));
+
+    return TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Flush every translation, global ones included.
+ *
+ * Toggling CR4.PGE drops global entries that a CR3 reload keeps.
+ */
+void FlushGlobalTLB(void) {
+    U64 Cr4;
+    U32 Flags;
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    __asm__ volatile("mov %%cr4, %0" : "=r"(Cr4));
+
+    if (Cr4 & CR4_PGE) {
+        __asm__ volatile("mov %0, %%cr4" : : "r"(Cr4 & ~(U64)CR4_PGE) : "memory");
+        __asm__ volatile("mov %0, %%cr4" : : "r"(Cr4) : "memory");
+    } else {
+        FlushTLB();
+    }
+
+    RestoreFlags(&Flags);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Start an empty TLB flush batch.
+ * @param Batch Batch to reset.
+ */
+void TlbFlushBatchInit(LPTLB_FLUSH_BATCH Batch) {
+    MemorySet(Batch, 0, sizeof(TLB_FLUSH_BATCH));
+}
+
+/************************************************************************/
+
+/**
+ * @brief Record a linear range whose translations changed.
+ *
+ * The batch switches to a full flush once it holds more than
+ * TLB_FLUSH_BATCH_MAX_PAGES pages or TLB_FLUSH_BATCH_MAX_RANGES ranges.
+ *
+ * @param Batch Batch to update.
+ * @param Base First linear address of the range.
+ * @param PageCount Number of 4 KiB pages in the range.
+ */
+void TlbFlushBatchAddRange(LPTLB_FLUSH_BATCH Batch, LINEAR Base, UINT PageCount) {
+    if (PageCount == 0) {
+        return;
+    }
+
+    Base = CanonicalizeLinearAddress(Base) & PAGE_MASK;
+
+    if (PAGE_GLOBAL(Base) || PAGE_GLOBAL(Base + ((LINEAR)(PageCount - 1) << PAGE_SIZE_MUL))) {
+        Batch->Global = TRUE;
+    }
+
+    if (Batch->Full) {
+        return;
+    }
+
+    if (Batch->RangeCount >= TLB_FLUSH_BATCH_MAX_RANGES || PageCount > TLB_FLUSH_BATCH_MAX_PAGES ||
+        Batch->PageCount + PageCount > TLB_FLUSH_BATCH_MAX_PAGES) {
+        Batch->Full = TRUE;
+        return;
+    }
+
+    Batch->Bases[Batch->RangeCount] = Base;
+    Batch->PageCounts[Batch->RangeCount] = PageCount;
+    Batch->RangeCount++;
+    Batch->PageCount += PageCount;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Force a full flush, for example after freeing paging structures.
+ * @param Batch Batch to update.
+ */
+void TlbFlushBatchRequestFull(LPTLB_FLUSH_BATCH Batch) {
+    Batch->Full = TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Invalidate the recorded translations and reset the batch.
+ *
+ * Small batches use one invlpg per page. Large batches reload CR3, or toggle
+ * CR4.PGE when kernel (global) ranges are involved.
+ *
+ * @param Batch Batch to commit.
+ */
+void TlbFlushBatchCommit(LPTLB_FLUSH_BATCH Batch) {
+    if (Batch->Full) {
+        if (Batch->Global) {
+            FlushGlobalTLB();
+        } else {
+            FlushTLB();
+        }
+    } else {
+        for (UINT Range = 0; Range < Batch->RangeCount; Range++) {
+            LINEAR Linear = Batch->Bases[Range];
+
+            for (UINT Page = 0; Page < Batch->PageCounts[Range]; Page++) {
+                InvalidatePage(Linear);
+                Linear += PAGE_SIZE;
+            }
+        }
+    }
+
+    TlbFlushBatchInit(Batch);
+}
+
+/************************************************************************/
+
 /**
  * @brief Retrieve the page table referenced by an iterator when present.
  *
@@ -1323,12 +1323,53 @@ LINEAR FindFreeRegion(LINEAR StartBase, UINT Size) {
 
 /************************************************************************/
 
+/**
+ * @brief Find a free linear region suited to 2 MiB pages.
+ *
+ * Candidates advance in 2 MiB steps and keep the same offset inside a 2 MiB
+ * page as the physical target, so that every inner chunk can be mapped by
+ * one directory entry.
+ *
+ * @param StartBase Starting linear address.
+ * @param Size Desired region size.
+ * @param Offset Required offset inside a 2 MiB page.
+ * @return Base of free region or 0.
+ */
+static LINEAR FindFreeLargeRegion(LINEAR StartBase, UINT Size, LINEAR Offset) {
+    LINEAR Base = N_4MB;
+
+    if (StartBase != 0) {
+        LINEAR CanonStart = CanonicalizeLinearAddress(StartBase);
+        if (CanonStart >= Base) {
+            Base = CanonStart;
+        }
+    }
+
+    Base = ((Base + PAGE_TABLE_CAPACITY_MASK) & ~PAGE_TABLE_CAPACITY_MASK) + Offset;
+
+    while (TRUE) {
+        if (IsRegionFree(Base, Size) == TRUE) {
+            return Base;
+        }
+
+        LINEAR NextBase = CanonicalizeLinearAddress(Base + PAGE_TABLE_CAPACITY);
+        if (NextBase <= Base) {
+            return NULL;
+        }
+        Base = NextBase;
+    }
+}
+
+/************************************************************************/
+
 /**
  * @brief Release page tables that no longer contain mappings.
+ * @return Number of page tables released.
  */
-void FreeEmptyPageTables(void) {
+UINT FreeEmptyPageTables(void) {
     LPPML4 Pml4 = GetCurrentPml4VA();
     UINT KernelPml4Index = GetPml4Entry((U64)VMA_KERNEL);
+    UINT FreedCount = 0u;
 
     for (UINT Pml4Index = 0u; Pml4Index < KernelPml4Index; Pml4Index++) {
         if (Pml4Index == PML4_RECURSIVE_SLOT) {
@@ -1382,10 +1423,13 @@ void FreeEmptyPageTables(void) {
                 if (PageTableIsEmpty(Table)) {
                     SetPhysicalPageMark((UINT)(TablePhysical >> PAGE_SIZE_MUL), 0u);
                     ClearPageDirectoryEntry(Directory, DirIndex);
+                    FreedCount++;
                 }
             }
         }
     }
+
+    return FreedCount;
 }
 
 /************************************************************************/
@@ -1402,8 +1446,10 @@ BOOL PopulateRegionPagesLegacy(LINEAR Base,
     U32 PteCacheDisabled = (Flags & ALLOC_PAGES_UC) ? 1 : 0;
     U32 PteWriteThrough = (Flags & ALLOC_PAGES_WC) ? 1 : 0;
     BOOL BootstrapTrace = (G_RegionDescriptorBootstrap == TRUE);
+    PHYSICAL_PAGE_BATCH PageBatch;
 
     if (PteCacheDisabled) PteWriteThrough = 0;
+    MemorySet(&PageBatch, 0, sizeof(PageBatch));
 
     ARCH_PAGE_ITERATOR Iterator = MemoryPageIteratorFromLinear(Base);
 
@@ -1428,6 +1474,7 @@ BOOL PopulateRegionPagesLegacy(LINEAR Base,
                 G_RegionDescriptorBootstrap = TRUE;
                 FreeRegion(RollbackBase, (UINT)(Index << PAGE_SIZE_MUL));
                 G_RegionDescriptorBootstrap = PreviousBootstrap;
+                PhysicalPageBatchRelease(&PageBatch);
                 return FALSE;
             }
 
@@ -1438,6 +1485,7 @@ BOOL PopulateRegionPagesLegacy(LINEAR Base,
                 G_RegionDescriptorBootstrap = TRUE;
                 FreeRegion(RollbackBase, (UINT)(Index << PAGE_SIZE_MUL));
                 G_RegionDescriptorBootstrap = PreviousBootstrap;
+                PhysicalPageBatchRelease(&PageBatch);
                 return FALSE;
             }
 
@@ -1448,6 +1496,7 @@ BOOL PopulateRegionPagesLegacy(LINEAR Base,
                 G_RegionDescriptorBootstrap = TRUE;
                 FreeRegion(RollbackBase, (UINT)(Index << PAGE_SIZE_MUL));
                 G_RegionDescriptorBootstrap = PreviousBootstrap;
+                PhysicalPageBatchRelease(&PageBatch);
                 return FALSE;
             }
             if (BootstrapTrace) {
@@ -1459,7 +1508,7 @@ BOOL PopulateRegionPagesLegacy(LINEAR Base,
 
         U32 Privilege = PAGE_PRIVILEGE(CurrentLinear);
         U32 FixedFlag = (Flags & ALLOC_PAGES_IO) ? 1u : 0u;
-        U32 BaseFlags = BuildPageFlags(ReadWrite, Privilege, PteWriteThrough, PteCacheDisabled, 0, FixedFlag);
+        U32 BaseFlags = BuildPageFlags(ReadWrite, Privilege, PteWriteThrough, PteCacheDisabled, PAGE_GLOBAL(CurrentLinear), FixedFlag);
         U32 ReservedFlags = BaseFlags & ~PAGE_FLAG_PRESENT;
         PHYSICAL ReservedPhysical = (PHYSICAL)(MAX_U32 & ~(PAGE_SIZE - 1));
 
@@ -1485,7 +1534,7 @@ BOOL PopulateRegionPagesLegacy(LINEAR Base,
                             Privilege,
                             PteWriteThrough,
                             PteCacheDisabled,
-                            /*Global*/ 0,
+                            PAGE_GLOBAL(CurrentLinear),
                             /*Fixed*/ 1));
                 } else {
                     SetPhysicalPageMark((UINT)(Physical >> PAGE_SIZE_MUL), 1);
@@ -1498,7 +1547,7 @@ BOOL PopulateRegionPagesLegacy(LINEAR Base,
                             Privilege,
                             PteWriteThrough,
                             PteCacheDisabled,
-                            /*Global*/ 0,
+                            PAGE_GLOBAL(CurrentLinear),
                             /*Fixed*/ 0));
                     if (BootstrapTrace) {
                     }
@@ -1506,7 +1555,7 @@ BOOL PopulateRegionPagesLegacy(LINEAR Base,
             } else {
                 if (BootstrapTrace) {
                 }
-                Physical = AllocPhysicalPage();
+                Physical = PhysicalPageBatchTake(&PageBatch, NumPages - Index);
 
                 if (Physical == NULL) {
                     ERROR(TEXT("[%s] AllocPhysicalPage failed"), FunctionName);
@@ -1514,6 +1563,7 @@ BOOL PopulateRegionPagesLegacy(LINEAR Base,
                     G_RegionDescriptorBootstrap = TRUE;
                     FreeRegion(RollbackBase, (UINT)(Index << PAGE_SIZE_MUL));
                     G_RegionDescriptorBootstrap = PreviousBootstrap;
+                    PhysicalPageBatchRelease(&PageBatch);
                     return FALSE;
                 }
 
@@ -1526,7 +1576,7 @@ BOOL PopulateRegionPagesLegacy(LINEAR Base,
                         Privilege,
                         PteWriteThrough,
                         PteCacheDisabled,
-                        /*Global*/ 0,
+                        PAGE_GLOBAL(CurrentLinear),
                         /*Fixed*/ 0));
                 if (BootstrapTrace) {
                 }
@@ -1546,6 +1596,109 @@ BOOL PopulateRegionPagesLegacy(LINEAR Base,
 
 /************************************************************************/
 
+/**
+ * @brief Map one 2 MiB chunk of a region with a large page.
+ * @param Linear 2 MiB aligned linear address.
+ * @param Target Physical address of the chunk, or 0 to allocate a block.
+ * @param Flags Mapping flags (see AllocRegion).
+ * @return TRUE when mapped, FALSE when the chunk must use 4 KiB pages.
+ */
+static BOOL MapRegionLargeChunk(LINEAR Linear, PHYSICAL Target, U32 Flags) {
+    U32 ReadWrite = (Flags & ALLOC_PAGES_READWRITE) ? 1 : 0;
+    U32 PteCacheDisabled = (Flags & ALLOC_PAGES_UC) ? 1 : 0;
+    U32 PteWriteThrough = (Flags & ALLOC_PAGES_WC) ? 1 : 0;
+    U32 FixedFlag = (Flags & ALLOC_PAGES_IO) ? 1u : 0u;
+    PHYSICAL Physical = Target;
+
+    if (PteCacheDisabled) PteWriteThrough = 0;
+
+    if (Target != 0) {
+        if (((U64)Target & PAGE_TABLE_CAPACITY_MASK) != 0) {
+            return FALSE;
+        }
+    } else {
+        Physical = AllocPhysicalContiguous(PAGE_TABLE_NUM_ENTRIES, PAGE_TABLE_CAPACITY, 0);
+        if (Physical == 0) {
+            return FALSE;
+        }
+    }
+
+    U64 EntryFlags =
+        BuildPageFlags(ReadWrite, PAGE_PRIVILEGE(Linear), PteWriteThrough, PteCacheDisabled, PAGE_GLOBAL(Linear), FixedFlag);
+
+    if (MapLargePage(Linear, Physical, EntryFlags) == FALSE) {
+        if (Target == 0) {
+            FreePhysicalPageRange(Physical, PAGE_TABLE_NUM_ENTRIES);
+        }
+        return FALSE;
+    }
+
+    if (Target != 0 && FixedFlag == 0) {
+        for (UINT Index = 0; Index < PAGE_TABLE_NUM_ENTRIES; Index++) {
+            SetPhysicalPageMark((UINT)(Target >> PAGE_SIZE_MUL) + Index, 1);
+        }
+    }
+
+    return TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Populate a region with 2 MiB pages where alignment allows it.
+ *
+ * Every committed chunk that covers a whole 2 MiB page is mapped by one
+ * directory entry. The unaligned head and tail, and chunks for which no
+ * contiguous block is available, fall back to PopulateRegionPagesLegacy.
+ *
+ * @param Base Linear base of the range to populate.
+ * @param Target Physical base or 0.
+ * @param NumPages Number of 4 KiB pages in the range.
+ * @param Flags Mapping flags (see AllocRegion).
+ * @param FunctionName Caller name for logs.
+ * @return TRUE on success, FALSE after rolling back the whole range.
+ */
+static BOOL PopulateRegionPagesLarge(LINEAR Base, PHYSICAL Target, UINT NumPages, U32 Flags, LPCSTR FunctionName) {
+    UINT Index = 0;
+    UINT LargeCount = 0;
+
+    while (Index < NumPages) {
+        LINEAR Linear = Base + ((LINEAR)Index << PAGE_SIZE_MUL);
+        PHYSICAL ChunkTarget = (Target != 0) ? Target + ((PHYSICAL)Index << PAGE_SIZE_MUL) : 0;
+        UINT Remaining = NumPages - Index;
+        UINT Run;
+
+        if ((Flags & ALLOC_PAGES_COMMIT) && (Linear & PAGE_TABLE_CAPACITY_MASK) == 0 &&
+            Remaining >= PAGE_TABLE_NUM_ENTRIES && MapRegionLargeChunk(Linear, ChunkTarget, Flags)) {
+            Index += PAGE_TABLE_NUM_ENTRIES;
+            LargeCount++;
+            continue;
+        }
+
+        // 4 KiB pages up to the next 2 MiB boundary
+        Run = PAGE_TABLE_NUM_ENTRIES - (UINT)((Linear & PAGE_TABLE_CAPACITY_MASK) >> PAGE_SIZE_MUL);
+        if (Run > Remaining) Run = Remaining;
+
+        if (PopulateRegionPagesLegacy(Linear, ChunkTarget, Run, Flags, Linear, FunctionName) == FALSE) {
+            if (Index != 0) {
+                BOOL PreviousBootstrap = G_RegionDescriptorBootstrap;
+                G_RegionDescriptorBootstrap = TRUE;
+                FreeRegion(Base, (UINT)(Index << PAGE_SIZE_MUL));
+                G_RegionDescriptorBootstrap = PreviousBootstrap;
+            }
+            return FALSE;
+        }
+
+        Index += Run;
+    }
+
+    DEBUG(TEXT("[%s] %p: %u pages, %u large"), FunctionName, (LPVOID)Base, NumPages, LargeCount);
+
+    return TRUE;
+}
+
+/************************************************************************/
+
 /**
  * @brief Allocate and map a physical region into the linear address space.
  * @param Base Desired base address or 0. When zero and ALLOC_PAGES_AT_OR_OVER
@@ -1564,6 +1717,7 @@ BOOL PopulateRegionPagesLegacy(LINEAR Base,
  *              - ALLOC_PAGES_UC / ALLOC_PAGES_WC: control cache attributes
  *                (UC has priority over WC).
  *              - ALLOC_PAGES_IO: keep physical pages marked fixed for MMIO.
+ *              - ALLOC_PAGES_LARGE: map whole 2 MiB chunks with large pages.
  * @return Allocated linear base address or 0 on failure.
  */
 LINEAR AllocRegionForProcess(LPPROCESS TrackingProcess, LINEAR Base, PHYSICAL Target, UINT Size, U32 Flags, LPCSTR Tag) {
@@ -1622,7 +1776,15 @@ LINEAR AllocRegionForProcess(LPPROCESS TrackingProcess, LINEAR Base, PHYSICAL Ta
         if (BootstrapTrace) {
         }
 
-        LINEAR NewBase = FindFreeRegion(Base, Size);
+        LINEAR NewBase = NULL;
+
+        if ((Flags & ALLOC_PAGES_LARGE) && NumPages >= PAGE_TABLE_NUM_ENTRIES) {
+            NewBase = FindFreeLargeRegion(Base, Size, (LINEAR)((U64)Target & PAGE_TABLE_CAPACITY_MASK));
+        }
+
+        if (NewBase == NULL) {
+            NewBase = FindFreeRegion(Base, Size);
+        }
 
         if (NewBase == NULL) {
             return NULL;
@@ -1640,6 +1802,13 @@ LINEAR AllocRegionForProcess(LPPROCESS TrackingProcess, LINEAR Base, PHYSICAL Ta
 
     BOOL FastPathUsed = FALSE;
 
+    if ((Flags & ALLOC_PAGES_LARGE) && NumPages >= PAGE_TABLE_NUM_ENTRIES) {
+        if (PopulateRegionPagesLarge(Base, Target, NumPages, Flags, TEXT("AllocRegion")) == FALSE) {
+            return NULL;
+        }
+        FastPathUsed = TRUE;
+    }
+
     if (FastPathUsed == FALSE) {
         if (BootstrapTrace) {
         }
@@ -1659,8 +1828,11 @@ LINEAR AllocRegionForProcess(LPPROCESS TrackingProcess, LINEAR Base, PHYSICAL Ta
         return NULL;
     }
 
-    // Flush the Translation Look-up Buffer of the CPU
-    FlushTLB();
+    // Invalidate the translations of the new range
+    TLB_FLUSH_BATCH FlushBatch;
+    TlbFlushBatchInit(&FlushBatch);
+    TlbFlushBatchAddRange(&FlushBatch, Pointer, NumPages);
+    TlbFlushBatchCommit(&FlushBatch);
 
     if (BootstrapTrace) {
     }
@@ -1730,6 +1902,14 @@ BOOL ResizeRegionForProcess(LPPROCESS TrackingProcess, LINEAR Base, PHYSICAL Tar
 
         BOOL ExpansionFastPathUsed = FALSE;
 
+        if ((Flags & ALLOC_PAGES_LARGE) && AdditionalPages >= PAGE_TABLE_NUM_ENTRIES) {
+            if (PopulateRegionPagesLarge(NewBase, AdditionalTarget, AdditionalPages, Flags, TEXT("ResizeRegion")) ==
+                FALSE) {
+                return FALSE;
+            }
+            ExpansionFastPathUsed = TRUE;
+        }
+
         if (ExpansionFastPathUsed == FALSE) {
             if (PopulateRegionPagesLegacy(NewBase,
                                           AdditionalTarget,
@@ -1743,7 +1923,10 @@ BOOL ResizeRegionForProcess(LPPROCESS TrackingProcess, LINEAR Base, PHYSICAL Tar
 
         RegionTrackResizeForProcess(TrackingProcess, Base, Size, NewSize, Flags);
 
-        FlushTLB();
+        TLB_FLUSH_BATCH FlushBatch;
+        TlbFlushBatchInit(&FlushBatch);
+        TlbFlushBatchAddRange(&FlushBatch, NewBase, AdditionalPages);
+        TlbFlushBatchCommit(&FlushBatch);
     } else {
         UINT PagesToRelease = CurrentPages - RequestedPages;
         if (PagesToRelease != 0) {
@@ -1792,8 +1975,26 @@ BOOL FreeRegionForProcess(LPPROCESS TrackingProcess, LINEAR Base, UINT Size) {
         UNUSED(DirEntry);
 #endif
         BOOL IsLargePage = FALSE;
+        BOOL HasTable = TryGetPageTableForIterator(&Iterator, &Table, &IsLargePage);
+
+        if (HasTable == FALSE && IsLargePage) {
+            LINEAR Linear = MemoryPageIteratorGetLinear(&Iterator);
 
-        if (TryGetPageTableForIterator(&Iterator, &Table, &IsLargePage) && PageTableEntryIsPresent(Table, TabEntry)) {
+            // A whole 2 MiB page goes away at once
+            if ((Linear & PAGE_TABLE_CAPACITY_MASK) == 0 && NumPages - Index >= PAGE_TABLE_NUM_ENTRIES &&
+                UnmapLargePage(Linear)) {
+                Iterator = MemoryPageIteratorFromLinear(Linear + PAGE_TABLE_CAPACITY);
+                Index += PAGE_TABLE_NUM_ENTRIES - 1;
+                continue;
+            }
+
+            // Partial free: split it into 4 KiB entries first
+            if (SplitLargePage(Linear)) {
+                HasTable = TryGetPageTableForIterator(&Iterator, &Table, &IsLargePage);
+            }
+        }
+
+        if (HasTable && PageTableEntryIsPresent(Table, TabEntry)) {
             PHYSICAL EntryPhysical = PageTableEntryGetPhysical(Table, TabEntry);
             BOOL Fixed = PageTableEntryIsFixed(Table, TabEntry);
 
@@ -1813,8 +2014,17 @@ BOOL FreeRegionForProcess(LPPROCESS TrackingProcess, LINEAR Base, UINT Size) {
     }
 
     RegionTrackFreeForProcess(TrackingProcess, CanonicalBase, NumPages << PAGE_SIZE_MUL);
-    FreeEmptyPageTables();
-    FlushTLB();
+
+    TLB_FLUSH_BATCH FlushBatch;
+    TlbFlushBatchInit(&FlushBatch);
+    TlbFlushBatchAddRange(&FlushBatch, CanonicalBase, NumPages);
+
+    // Freed page tables may still be held in the paging-structure caches
+    if (FreeEmptyPageTables() != 0) {
+        TlbFlushBatchRequestFull(&FlushBatch);
+    }
+
+    TlbFlushBatchCommit(&FlushBatch);
     return TRUE;
 }
 
@@ -1891,7 +2101,7 @@ LINEAR MapFramebufferMemory(PHYSICAL PhysicalBase, UINT Size) {
         AlignedPhysicalBase,
         AdjustedSize,
         ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE | ALLOC_PAGES_WC |
-            ALLOC_PAGES_IO | ALLOC_PAGES_AT_OR_OVER,
+            ALLOC_PAGES_IO | ALLOC_PAGES_AT_OR_OVER | ALLOC_PAGES_LARGE,
         TEXT("Framebuffer")
     );
 
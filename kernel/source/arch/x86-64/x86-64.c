@@ -568,10 +568,10 @@ void PreInitializeKernel(void) {
     __asm__ volatile("mov %0, %%cr0" : : "r"(Cr0));
 
 
-    DEBUG(TEXT("[PreInitializeKernel] CR4 : CR4_OSFXSR and CR4_OSXMMEXCPT on"));
+    DEBUG(TEXT("[PreInitializeKernel] CR4 : CR4_OSFXSR, CR4_OSXMMEXCPT and CR4_PGE on"));
 
     __asm__ volatile("mov %%cr4, %0" : "=r"(Cr4));
-    Cr4 |= (U64)(CR4_OSFXSR | CR4_OSXMMEXCPT);
+    Cr4 |= (U64)(CR4_OSFXSR | CR4_OSXMMEXCPT | CR4_PGE);
     __asm__ volatile("mov %0, %%cr4" : : "r"(Cr4));
 
     __asm__ volatile("fninit");
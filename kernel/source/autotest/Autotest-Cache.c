@@ -0,0 +1,197 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Generic cache - Unit tests and lookup microbenchmark
+
+\************************************************************************/
+
+#include "autotest/Autotest.h"
+#include "Arch.h"
+#include "log/Log.h"
+#include "utils/Cache.h"
+
+/************************************************************************/
+
+#define CACHE_TEST_CAPACITY 256
+#define CACHE_TEST_TTL_MS 600000
+#define CACHE_TEST_HOT_ENTRIES 32
+#define CACHE_TEST_LOOKUPS 4096
+
+typedef struct tag_CACHE_TEST_ITEM {
+    U32 Id;
+} CACHE_TEST_ITEM, *LPCACHE_TEST_ITEM;
+
+/************************************************************************/
+
+/**
+ * @brief Match a test item against an identifier.
+ * @param Data Cached item.
+ * @param Context Pointer to the identifier.
+ * @return TRUE when the identifiers are equal.
+ */
+static BOOL CacheTestMatcher(LPVOID Data, LPVOID Context) {
+    return ((LPCACHE_TEST_ITEM)Data)->Id == *(U32*)Context;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Count released items instead of freeing them, they live on the stack.
+ * @param Data Released item.
+ * @param Dirty Dirty flag of the entry.
+ * @param Context Pointer to the release counter.
+ */
+static void CacheTestRelease(LPVOID Data, BOOL Dirty, LPVOID Context) {
+    UNUSED(Data);
+    UNUSED(Dirty);
+    (*(UINT*)Context)++;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Find an item by key.
+ * @param Cache Cache under test.
+ * @param Id Item identifier.
+ * @return Item pointer or NULL.
+ */
+static LPCACHE_TEST_ITEM CacheTestFind(LPCACHE Cache, U32 Id) {
+    return (LPCACHE_TEST_ITEM)CacheFindKey(Cache, CacheHashMix(0, Id), CacheTestMatcher, &Id);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Generic cache tests and lookup microbenchmark.
+ *
+ * Checks keyed and matcher lookups, then the CLOCK eviction: entries that
+ * were looked up survive when the cache is full. Finally logs the average
+ * cost in TSC cycles of a keyed lookup and of a full matcher scan on a
+ * full cache.
+ *
+ * @param Results Pointer to TEST_RESULTS structure to be filled with test results
+ */
+void TestCache(TEST_RESULTS* Results) {
+    CACHE_TEST_ITEM Items[CACHE_TEST_CAPACITY + 1];
+    CACHE Cache;
+    UINT Released = 0;
+    BOOL Ok;
+    U32 Index;
+    U32 Start;
+    U32 KeyedCycles;
+    U32 ScanCycles;
+
+    if (Results == NULL) {
+        return;
+    }
+
+    Results->TestsRun = 0;
+    Results->TestsPassed = 0;
+
+    CacheInit(&Cache, CACHE_TEST_CAPACITY);
+
+    if (Cache.Entries == NULL) {
+        ERROR(TEXT("[TestCache] Setup failed"));
+        Results->TestsRun++;
+        return;
+    }
+
+    CacheSetWritePolicy(&Cache, CACHE_WRITE_POLICY_READ_ONLY, NULL, CacheTestRelease, &Released);
+
+    for (Index = 0; Index <= CACHE_TEST_CAPACITY; Index++) {
+        Items[Index].Id = 1000 + Index;
+    }
+
+    // Test 1: Keyed entries are found by key and by matcher
+    Results->TestsRun++;
+    Ok = TRUE;
+
+    for (Index = 0; Index < CACHE_TEST_CAPACITY && Ok; Index++) {
+        Ok = CacheAddKey(&Cache, CacheHashMix(0, Items[Index].Id), &(Items[Index]), CACHE_TEST_TTL_MS);
+    }
+
+    for (Index = 0; Index < CACHE_TEST_CAPACITY && Ok; Index++) {
+        Ok = (CacheTestFind(&Cache, Items[Index].Id) == &(Items[Index]));
+    }
+
+    if (Ok) {
+        U32 Id = Items[CACHE_TEST_CAPACITY / 2].Id;
+        Ok = (CacheFind(&Cache, CacheTestMatcher, &Id) == &(Items[CACHE_TEST_CAPACITY / 2]));
+    }
+
+    if (Ok && CacheTestFind(&Cache, 1) == NULL && Cache.Count == CACHE_TEST_CAPACITY) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestCache] Keyed lookup failed (count=%u)"), Cache.Count);
+    }
+
+    // Test 2: A full cache evicts one entry that was not looked up again
+    Results->TestsRun++;
+
+    // Let the hand clear every reference bit, then touch the hot entries
+    for (Index = 0; Index < CACHE_TEST_CAPACITY; Index++) {
+        Cache.Entries[Index].Referenced = FALSE;
+    }
+
+    for (Index = 0; Index < CACHE_TEST_HOT_ENTRIES; Index++) {
+        CacheTestFind(&Cache, Items[Index].Id);
+    }
+
+    Ok = CacheAddKey(&Cache, CacheHashMix(0, Items[CACHE_TEST_CAPACITY].Id), &(Items[CACHE_TEST_CAPACITY]),
+        CACHE_TEST_TTL_MS);
+
+    for (Index = 0; Index < CACHE_TEST_HOT_ENTRIES && Ok; Index++) {
+        Ok = (CacheTestFind(&Cache, Items[Index].Id) != NULL);
+    }
+
+    if (Ok && Released == 1 && CacheTestFind(&Cache, Items[CACHE_TEST_CAPACITY].Id) != NULL) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestCache] CLOCK eviction failed (released=%u)"), Released);
+    }
+
+    // Test 3: Keyed lookups against a full matcher scan
+    Results->TestsRun++;
+    Ok = TRUE;
+
+    Start = U64_Low32(ReadTimeStampCounter());
+    for (Index = 0; Index < CACHE_TEST_LOOKUPS && Ok; Index++) {
+        LPCACHE_TEST_ITEM Item = &(Items[Index % CACHE_TEST_HOT_ENTRIES]);
+        Ok = (CacheTestFind(&Cache, Item->Id) == Item);
+    }
+    KeyedCycles = U64_Low32(ReadTimeStampCounter()) - Start;
+
+    Start = U64_Low32(ReadTimeStampCounter());
+    for (Index = 0; Index < CACHE_TEST_LOOKUPS && Ok; Index++) {
+        LPCACHE_TEST_ITEM Item = &(Items[Index % CACHE_TEST_HOT_ENTRIES]);
+        Ok = (CacheFind(&Cache, CacheTestMatcher, &(Item->Id)) == Item);
+    }
+    ScanCycles = U64_Low32(ReadTimeStampCounter()) - Start;
+
+    if (Ok) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestCache] Lookup benchmark returned a wrong entry"));
+    }
+
+    VERBOSE(TEXT("[TestCache] %u entries: keyed lookup %u cycles, matcher scan %u cycles"), CACHE_TEST_CAPACITY,
+        KeyedCycles / CACHE_TEST_LOOKUPS, ScanCycles / CACHE_TEST_LOOKUPS);
+
+    CacheDeinit(&Cache);
+}
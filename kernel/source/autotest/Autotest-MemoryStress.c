@@ -0,0 +1,241 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Heap memory stress - Latency report
+
+\************************************************************************/
+
+#include "autotest/Autotest.h"
+#include "Arch.h"
+#include "log/Log.h"
+#include "memory/Heap.h"
+#include "memory/Memory.h"
+#include "text/CoreString.h"
+#include "utils/List.h"
+
+/************************************************************************/
+
+#define MEMORY_STRESS_HEAP_SIZE N_4MB
+#define MEMORY_STRESS_SLOTS 256
+#define MEMORY_STRESS_OPERATIONS 8192
+#define MEMORY_STRESS_LARGE_MAX 32768
+
+#define MEMORY_STRESS_SMALL_ALLOC 0
+#define MEMORY_STRESS_SMALL_FREE 1
+#define MEMORY_STRESS_LARGE_ALLOC 2
+#define MEMORY_STRESS_LARGE_FREE 3
+#define MEMORY_STRESS_SERIES_COUNT 4
+
+typedef struct tag_MEMORY_STRESS_SERIES {
+    LPCSTR Name;
+    U32* Samples;
+    UINT Count;
+} MEMORY_STRESS_SERIES, *LPMEMORY_STRESS_SERIES;
+
+/************************************************************************/
+
+/**
+ * @brief Compare two cycle samples for QuickSort.
+ * @param A First sample.
+ * @param B Second sample.
+ * @return Negative, zero or positive.
+ */
+static I32 MemoryStressCompareSamples(LPCVOID A, LPCVOID B) {
+    U32 Left = *(const U32*)A;
+    U32 Right = *(const U32*)B;
+
+    if (Left < Right) return -1;
+    if (Left > Right) return 1;
+    return 0;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Sort one latency series and log its percentiles.
+ * @param Series Series to report.
+ */
+static void MemoryStressReport(LPMEMORY_STRESS_SERIES Series) {
+    UINT Count = Series->Count;
+
+    if (Count == 0) {
+        VERBOSE(TEXT("[TestMemoryStress] %s: no sample"), Series->Name);
+        return;
+    }
+
+    QuickSort(Series->Samples, Count, sizeof(U32), MemoryStressCompareSamples);
+
+    VERBOSE(TEXT("[TestMemoryStress] %s: count=%u p50=%u p90=%u p99=%u max=%u cycles"), Series->Name, Count,
+        Series->Samples[(Count * 50) / 100], Series->Samples[(Count * 90) / 100], Series->Samples[(Count * 99) / 100],
+        Series->Samples[Count - 1]);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Check the fill pattern of a stress block.
+ * @param Pointer Block payload.
+ * @param Size Payload size.
+ * @param Pattern Expected byte.
+ * @return TRUE when intact.
+ */
+static BOOL MemoryStressCheckPattern(const U8* Pointer, UINT Size, U8 Pattern) {
+    return Pointer[0] == Pattern && Pointer[Size / 2] == Pattern && Pointer[Size - 1] == Pattern;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Heap allocation stress with latency percentiles.
+ *
+ * Runs a random mix of small and large allocations and frees on a private
+ * heap, then logs the p50/p90/p99/max cost of each operation in TSC cycles.
+ * The private heap uses the same HeapAlloc_HBHS/HeapFree_HBHS backend as
+ * the process heaps, without magazines or mutexes.
+ *
+ * @param Results Pointer to TEST_RESULTS structure to be filled with test results
+ */
+void TestMemoryStress(TEST_RESULTS* Results) {
+    MEMORY_STRESS_SERIES Series[MEMORY_STRESS_SERIES_COUNT] = {
+        {TEXT("small alloc"), NULL, 0},
+        {TEXT("small free"), NULL, 0},
+        {TEXT("large alloc"), NULL, 0},
+        {TEXT("large free"), NULL, 0},
+    };
+    LPVOID Slots[MEMORY_STRESS_SLOTS];
+    UINT Sizes[MEMORY_STRESS_SLOTS];
+    LPHEAP_CONTROL_BLOCK ControlBlock;
+    LINEAR HeapBase;
+    LINEAR FirstBlock;
+    U32 Seed = 0x1234567;
+    BOOL Intact = TRUE;
+    UINT Index;
+
+    if (Results == NULL) {
+        return;
+    }
+
+    Results->TestsRun = 0;
+    Results->TestsPassed = 0;
+
+    HeapBase = AllocKernelRegion(0, MEMORY_STRESS_HEAP_SIZE, ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE,
+        TEXT("MemoryStress"));
+
+    for (Index = 0; Index < MEMORY_STRESS_SERIES_COUNT; Index++) {
+        Series[Index].Samples = (U32*)KernelHeapAlloc(MEMORY_STRESS_OPERATIONS * sizeof(U32));
+    }
+
+    if (HeapBase == 0 || Series[0].Samples == NULL || Series[1].Samples == NULL || Series[2].Samples == NULL ||
+        Series[3].Samples == NULL) {
+        ERROR(TEXT("[TestMemoryStress] Setup failed"));
+        Results->TestsRun++;
+        goto Out;
+    }
+
+    HeapInit(NULL, HeapBase, MEMORY_STRESS_HEAP_SIZE);
+    ControlBlock = (LPHEAP_CONTROL_BLOCK)HeapBase;
+    FirstBlock = (LINEAR)ControlBlock->FirstUnallocated;
+    MemorySet(Slots, 0, sizeof(Slots));
+
+    // Test 1: Random alloc/free mix keeps every block intact
+    Results->TestsRun++;
+
+    for (UINT Operation = 0; Operation < MEMORY_STRESS_OPERATIONS && Intact; Operation++) {
+        UINT Slot;
+        BOOL Large;
+        U32 Start;
+        U32 Cycles;
+
+        Seed = Seed * 1103515245 + 12345;
+        Slot = (Seed >> 8) % MEMORY_STRESS_SLOTS;
+
+        if (Slots[Slot] != NULL) {
+            Large = (Sizes[Slot] > HEAP_MAX_SMALL_BLOCK_SIZE);
+            Intact = MemoryStressCheckPattern((const U8*)Slots[Slot], Sizes[Slot], (U8)Slot);
+
+            Start = U64_Low32(ReadTimeStampCounter());
+            HeapFree_HBHS(HeapBase, MEMORY_STRESS_HEAP_SIZE, Slots[Slot]);
+            Cycles = U64_Low32(ReadTimeStampCounter()) - Start;
+
+            LPMEMORY_STRESS_SERIES Target = &(Series[Large ? MEMORY_STRESS_LARGE_FREE : MEMORY_STRESS_SMALL_FREE]);
+            Target->Samples[Target->Count++] = Cycles;
+            Slots[Slot] = NULL;
+        } else {
+            Seed = Seed * 1103515245 + 12345;
+            Large = ((Seed >> 16) & 3) == 0;
+
+            if (Large) {
+                Sizes[Slot] = HEAP_MAX_SMALL_BLOCK_SIZE + 1 + ((Seed >> 4) % (MEMORY_STRESS_LARGE_MAX - HEAP_MAX_SMALL_BLOCK_SIZE));
+            } else {
+                Sizes[Slot] = 1 + ((Seed >> 4) % HEAP_MAX_SMALL_BLOCK_SIZE);
+            }
+
+            Start = U64_Low32(ReadTimeStampCounter());
+            Slots[Slot] = HeapAlloc_HBHS(NULL, HeapBase, MEMORY_STRESS_HEAP_SIZE, Sizes[Slot]);
+            Cycles = U64_Low32(ReadTimeStampCounter()) - Start;
+
+            if (Slots[Slot] == NULL) {
+                ERROR(TEXT("[TestMemoryStress] Allocation of %u bytes failed"), Sizes[Slot]);
+                Intact = FALSE;
+                break;
+            }
+
+            LPMEMORY_STRESS_SERIES Target = &(Series[Large ? MEMORY_STRESS_LARGE_ALLOC : MEMORY_STRESS_SMALL_ALLOC]);
+            Target->Samples[Target->Count++] = Cycles;
+            MemorySet(Slots[Slot], (U8)Slot, Sizes[Slot]);
+        }
+    }
+
+    if (Intact) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestMemoryStress] Heap block corrupted or allocation failed"));
+    }
+
+    // Test 2: Freeing everything coalesces the heap back to empty
+    Results->TestsRun++;
+
+    for (Index = 0; Index < MEMORY_STRESS_SLOTS; Index++) {
+        if (Slots[Index] != NULL) {
+            HeapFree_HBHS(HeapBase, MEMORY_STRESS_HEAP_SIZE, Slots[Index]);
+        }
+    }
+
+    if ((LINEAR)ControlBlock->FirstUnallocated == FirstBlock && ControlBlock->FreeBytes == 0) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestMemoryStress] Heap not empty after free (first=%p free=%u)"), ControlBlock->FirstUnallocated,
+            ControlBlock->FreeBytes);
+    }
+
+    for (Index = 0; Index < MEMORY_STRESS_SERIES_COUNT; Index++) {
+        MemoryStressReport(&(Series[Index]));
+    }
+
+Out:
+    for (Index = 0; Index < MEMORY_STRESS_SERIES_COUNT; Index++) {
+        if (Series[Index].Samples != NULL) {
+            KernelHeapFree(Series[Index].Samples);
+        }
+    }
+
+    if (HeapBase != 0) {
+        FreeRegion(HeapBase, MEMORY_STRESS_HEAP_SIZE);
+    }
+}
@@ -0,0 +1,177 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Network checksum - Unit tests and microbenchmark
+
+\************************************************************************/
+
+#include "autotest/Autotest.h"
+#include "Arch.h"
+#include "log/Log.h"
+#include "utils/NetworkChecksum.h"
+
+/************************************************************************/
+
+#define CHECKSUM_TEST_BUFFER_SIZE 1536
+#define CHECKSUM_TEST_MAX_OFFSET 8
+#define CHECKSUM_TEST_SEED 0x1234ABCD
+#define CHECKSUM_TEST_BENCH_LENGTH 1460
+#define CHECKSUM_TEST_BENCH_ROUNDS 256
+
+/************************************************************************/
+
+/**
+ * @brief Compare one implementation against the byte-wise reference.
+ * @param Data Buffer to sum.
+ * @param Length Number of bytes.
+ * @param Accumulate Implementation under test.
+ * @return TRUE when both give the same checksum, with and without a seed.
+ */
+static BOOL ChecksumTestMatches(const U8* Data, U32 Length, U32 (*Accumulate)(const U8*, U32, U32)) {
+    U16 Expected = NetworkChecksum_Finalize(NetworkChecksum_Accumulate_Bytes(Data, Length, 0));
+    U16 ExpectedSeeded = NetworkChecksum_Finalize(NetworkChecksum_Accumulate_Bytes(Data, Length, CHECKSUM_TEST_SEED));
+
+    if (NetworkChecksum_Finalize(Accumulate(Data, Length, 0)) != Expected) return FALSE;
+    if (NetworkChecksum_Finalize(Accumulate(Data, Length, CHECKSUM_TEST_SEED)) != ExpectedSeeded) return FALSE;
+
+    return TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Check an implementation over every length and alignment.
+ * @param Buffer Test pattern.
+ * @param Accumulate Implementation under test.
+ * @param Length Receives the first failing length.
+ * @param Offset Receives the first failing offset.
+ * @return TRUE when every case matches the reference.
+ */
+static BOOL ChecksumTestSweep(const U8* Buffer, U32 (*Accumulate)(const U8*, U32, U32), U32* Length, U32* Offset) {
+    for (*Offset = 0; *Offset < CHECKSUM_TEST_MAX_OFFSET; (*Offset)++) {
+        for (*Length = 0; *Length + *Offset <= CHECKSUM_TEST_BUFFER_SIZE; (*Length)++) {
+            if (ChecksumTestMatches(Buffer + *Offset, *Length, Accumulate) == FALSE) return FALSE;
+
+            // Past the short lengths, a few sizes per step are enough
+            if (*Length >= 256) *Length += 61;
+        }
+    }
+
+    return TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Measure an implementation over a full TCP payload.
+ * @param Data Buffer to sum.
+ * @param Accumulate Implementation under test.
+ * @return Average TSC cycles per call.
+ */
+static U32 ChecksumTestBench(const U8* Data, U32 (*Accumulate)(const U8*, U32, U32)) {
+    U32 Sum = 0;
+    U32 Start = U64_Low32(ReadTimeStampCounter());
+
+    for (U32 Round = 0; Round < CHECKSUM_TEST_BENCH_ROUNDS; Round++) {
+        Sum = Accumulate(Data, CHECKSUM_TEST_BENCH_LENGTH, Sum & 0xFFFF);
+    }
+
+    UNUSED(Sum);
+
+    return (U64_Low32(ReadTimeStampCounter()) - Start) / CHECKSUM_TEST_BENCH_ROUNDS;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Network checksum tests and microbenchmark.
+ *
+ * Compares the word-wide and SSE2 accumulators with the byte-wise
+ * reference over every short length, odd lengths and unaligned starts,
+ * checks a known RFC 1071 value, then logs the cost in TSC cycles of
+ * each implementation over a full TCP payload.
+ *
+ * @param Results Pointer to TEST_RESULTS structure to be filled with test results
+ */
+void TestNetworkChecksum(TEST_RESULTS* Results) {
+    static const U8 Known[] = {0x00, 0x01, 0xF2, 0x03, 0xF4, 0xF5, 0xF6, 0xF7};
+    static U8 DATA_SECTION Buffer[CHECKSUM_TEST_BUFFER_SIZE];
+    U32 Value = 0x9E3779B9;
+    U32 Length;
+    U32 Offset;
+
+    if (Results == NULL) {
+        return;
+    }
+
+    Results->TestsRun = 0;
+    Results->TestsPassed = 0;
+
+    for (U32 Index = 0; Index < CHECKSUM_TEST_BUFFER_SIZE; Index++) {
+        Value = Value * 1103515245 + 12345;
+        Buffer[Index] = (U8)(Value >> 16);
+    }
+
+    // Test 1: RFC 1071 example, the folded sum of these words is 0xDDF2
+    Results->TestsRun++;
+
+    if (NetworkChecksum_Calculate(Known, sizeof(Known)) == Htons((U16)~0xDDF2)) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestNetworkChecksum] Known vector failed: %x"), NetworkChecksum_Calculate(Known, sizeof(Known)));
+    }
+
+    // Test 2: Word-wide accumulator
+    Results->TestsRun++;
+
+    if (ChecksumTestSweep(Buffer, NetworkChecksum_Accumulate_Wide, &Length, &Offset)) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestNetworkChecksum] Wide accumulator failed (length=%u offset=%u)"), Length, Offset);
+    }
+
+    // Test 3: Dispatching accumulator
+    Results->TestsRun++;
+
+    if (ChecksumTestSweep(Buffer, NetworkChecksum_Calculate_Accumulate, &Length, &Offset)) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestNetworkChecksum] Accumulator failed (length=%u offset=%u)"), Length, Offset);
+    }
+
+#if defined(__EXOS_ARCH_X86_64__)
+    // Test 4: SSE2 accumulator
+    Results->TestsRun++;
+
+    if (ChecksumTestSweep(Buffer, NetworkChecksum_Accumulate_Sse2, &Length, &Offset)) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestNetworkChecksum] SSE2 accumulator failed (length=%u offset=%u)"), Length, Offset);
+    }
+
+    VERBOSE(TEXT("[TestNetworkChecksum] %u bytes: bytes %u cycles, wide %u cycles, SSE2 %u cycles"),
+        CHECKSUM_TEST_BENCH_LENGTH, ChecksumTestBench(Buffer, NetworkChecksum_Accumulate_Bytes),
+        ChecksumTestBench(Buffer, NetworkChecksum_Accumulate_Wide),
+        ChecksumTestBench(Buffer, NetworkChecksum_Accumulate_Sse2));
+#else
+    VERBOSE(TEXT("[TestNetworkChecksum] %u bytes: bytes %u cycles, wide %u cycles"), CHECKSUM_TEST_BENCH_LENGTH,
+        ChecksumTestBench(Buffer, NetworkChecksum_Accumulate_Bytes),
+        ChecksumTestBench(Buffer, NetworkChecksum_Accumulate_Wide));
+#endif
+}
@@ -0,0 +1,185 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Slab caches - Unit Tests
+
+\************************************************************************/
+
+#include "autotest/Autotest.h"
+#include "log/Log.h"
+#include "memory/Heap.h"
+#include "memory/Memory.h"
+#include "memory/Slab.h"
+#include "process/Process.h"
+#include "text/CoreString.h"
+
+/************************************************************************/
+
+#define SLAB_TEST_OBJECT_SIZE 40
+#define SLAB_TEST_OBJECTS 24
+#define SLAB_TEST_HEAP_SIZE N_64KB
+
+static SLAB_CACHE DATA_SECTION SlabTestCache = SLAB_CACHE_INIT(TEXT("AutotestSlab"), SLAB_TEST_OBJECT_SIZE);
+
+/************************************************************************/
+
+void TestSlab(TEST_RESULTS* Results) {
+    if (Results == NULL) {
+        return;
+    }
+
+    Results->TestsRun = 0;
+    Results->TestsPassed = 0;
+
+    // Test 1: Magazine is LIFO, bounded and refuses duplicates
+    Results->TestsRun++;
+    {
+        SLAB_MAGAZINE Magazine;
+        U8 Objects[SLAB_MAGAZINE_SIZE + 1];
+        BOOL Ok = TRUE;
+
+        MemorySet(&Magazine, 0, sizeof(Magazine));
+
+        for (UINT Index = 0; Index < SLAB_MAGAZINE_SIZE; Index++) {
+            Ok = Ok && SlabMagazinePush(&Magazine, &(Objects[Index]));
+        }
+
+        Ok = Ok && SlabMagazinePush(&Magazine, &(Objects[SLAB_MAGAZINE_SIZE])) == FALSE;
+        Ok = Ok && SlabMagazinePop(&Magazine) == &(Objects[SLAB_MAGAZINE_SIZE - 1]);
+        Ok = Ok && SlabMagazinePush(&Magazine, &(Objects[0])) == FALSE;
+
+        while (SlabMagazinePop(&Magazine) != NULL) {
+            // Empty the magazine
+        }
+
+        Ok = Ok && Magazine.Count == 0;
+
+        if (Ok) {
+            Results->TestsPassed++;
+        } else {
+            ERROR(TEXT("[TestSlab] Magazine failed (count=%u)"), Magazine.Count);
+        }
+    }
+
+    // Test 2: Cache objects are zeroed, distinct, owned and recycled through the magazine
+    Results->TestsRun++;
+    {
+        LPVOID Objects[SLAB_TEST_OBJECTS];
+        UINT HitsBefore;
+        BOOL Ok = TRUE;
+
+        for (UINT Index = 0; Index < SLAB_TEST_OBJECTS; Index++) {
+            U8* Bytes;
+
+            Objects[Index] = SlabCacheAlloc(&SlabTestCache);
+            Bytes = (U8*)Objects[Index];
+            Ok = Ok && Bytes != NULL && Bytes[0] == 0 && Bytes[SLAB_TEST_OBJECT_SIZE - 1] == 0 &&
+                 SlabCacheGetObjectSize(Objects[Index]) == SLAB_TEST_OBJECT_SIZE;
+
+            SAFE_USE(Bytes) {
+                MemorySet(Bytes, 0xA5, SLAB_TEST_OBJECT_SIZE);
+            }
+
+            for (UINT Other = 0; Other < Index; Other++) {
+                Ok = Ok && Objects[Other] != Objects[Index];
+            }
+        }
+
+        for (UINT Index = 0; Index < SLAB_TEST_OBJECTS; Index++) {
+            Ok = Ok && SlabCacheFree(Objects[Index]);
+        }
+
+        HitsBefore = SlabTestCache.Hits;
+        Objects[0] = SlabCacheAlloc(&SlabTestCache);
+        Ok = Ok && Objects[0] != NULL && SlabTestCache.Hits == HitsBefore + 1 && ((U8*)Objects[0])[0] == 0;
+        Ok = Ok && SlabCacheFree(Objects[0]);
+
+        if (Ok) {
+            Results->TestsPassed++;
+        } else {
+            ERROR(TEXT("[TestSlab] Cache failed (hits=%u misses=%u fallbacks=%u)"), SlabTestCache.Hits,
+                SlabTestCache.Misses, SlabTestCache.Fallbacks);
+        }
+    }
+
+    // Test 3: Heap pointers are not claimed by the caches
+    Results->TestsRun++;
+    {
+        LPVOID Pointer = KernelHeapAlloc(SLAB_TEST_OBJECT_SIZE);
+
+        if (Pointer != NULL && SlabCacheGetObjectSize(Pointer) == 0 && SlabCacheFree(Pointer) == FALSE) {
+            Results->TestsPassed++;
+        } else {
+            ERROR(TEXT("[TestSlab] Heap pointer claimed by a cache"));
+        }
+
+        if (Pointer != NULL) {
+            KernelHeapFree(Pointer);
+        }
+    }
+
+    // Test 4: A process heap rejects slab objects on free and realloc
+    Results->TestsRun++;
+    {
+        LPPROCESS Process = (LPPROCESS)KernelHeapAlloc(sizeof(PROCESS));
+        LINEAR HeapBase = AllocKernelRegion(0, SLAB_TEST_HEAP_SIZE, ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE,
+            TEXT("AutotestSlabHeap"));
+        LPVOID Object = SlabCacheAlloc(&SlabTestCache);
+        LPVOID Other = NULL;
+        BOOL Ok = (Process != NULL && HeapBase != 0 && Object != NULL);
+
+        if (Ok) {
+            MemorySet(Process, 0, sizeof(PROCESS));
+            InitMutex(&(Process->HeapMutex));
+            Process->HeapBase = HeapBase;
+            Process->HeapSize = SLAB_TEST_HEAP_SIZE;
+            Process->MaximumAllocatedMemory = SLAB_TEST_HEAP_SIZE;
+            HeapInit(Process, HeapBase, SLAB_TEST_HEAP_SIZE);
+
+            MemorySet(Object, 0x5A, SLAB_TEST_OBJECT_SIZE);
+            HeapFree_P(Process, Object);
+            Ok = HeapRealloc_P(Process, Object, SLAB_TEST_OBJECT_SIZE * 4) == NULL;
+            Ok = Ok && HeapRealloc_P(Process, Object, 0) == NULL;
+
+            // A freed object would come back first, zeroed
+            Other = SlabCacheAlloc(&SlabTestCache);
+            Ok = Ok && Other != Object && SlabCacheGetObjectSize(Object) == SLAB_TEST_OBJECT_SIZE &&
+                 ((U8*)Object)[0] == 0x5A && ((U8*)Object)[SLAB_TEST_OBJECT_SIZE - 1] == 0x5A;
+        }
+
+        if (Ok) {
+            Results->TestsPassed++;
+        } else {
+            ERROR(TEXT("[TestSlab] Process heap accepted a slab object"));
+        }
+
+        if (Other != NULL && Other != Object) {
+            SlabCacheFree(Other);
+        }
+        if (Object != NULL) {
+            SlabCacheFree(Object);
+        }
+        if (HeapBase != 0) {
+            FreeRegion(HeapBase, SLAB_TEST_HEAP_SIZE);
+        }
+        if (Process != NULL) {
+            KernelHeapFree(Process);
+        }
+    }
+}
@@ -23,14 +23,26 @@
 \************************************************************************/
 
 #include "autotest/Autotest.h"
+#include "Arch.h"
 #include "Base.h"
 #include "log/Log.h"
+#include "memory/Heap.h"
 #include "memory/Memory.h"
 #include "network/TCP.h"
+#include "network/TCPDemux.h"
 #include "text/CoreString.h"
 
 /************************************************************************/
 
+#define TCP_DEMUX_TEST_CONNECTIONS 512
+#define TCP_DEMUX_TEST_LOCAL_IP 0x0F02000A      // 10.0.2.15, network byte order
+#define TCP_DEMUX_TEST_LOOKUPS 4096
+
+static TCP_DEMUX DATA_SECTION TestDemux;
+static TCP_DEMUX_NODE DATA_SECTION TestDemuxNodes[TCP_DEMUX_TEST_CONNECTIONS + 2];
+
+/************************************************************************/
+
 /**
  * @brief Test TCP checksum calculation
  *
@@ -111,6 +123,267 @@ void TestTCPChecksum(TEST_RESULTS* Results) {
 
 /************************************************************************/
 
+/**
+ * @brief Fill the key of a test connection.
+ * @param Index Connection index.
+ */
+static void TCPDemuxTestSetKey(U32 Index) {
+    LPTCP_DEMUX_NODE Node = &(TestDemuxNodes[Index]);
+
+    MemorySet(Node, 0, sizeof(TCP_DEMUX_NODE));
+    Node->LocalIP = TCP_DEMUX_TEST_LOCAL_IP;
+    Node->LocalPort = Htons((U16)((Index & 1) ? 80 : 8000 + Index));
+    Node->RemoteIP = Htonl(0x0A000200 + (Index >> 6));
+    Node->RemotePort = Htons((U16)(40000 + Index));
+    Node->Connection = Node;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Look up a test connection by its key.
+ * @param Index Connection index.
+ * @return Entry found by the tables.
+ */
+static LPTCP_DEMUX_NODE TCPDemuxTestFind(U32 Index) {
+    LPTCP_DEMUX_NODE Node = &(TestDemuxNodes[Index]);
+
+    return TCP_DemuxLookup(&TestDemux, Node->LocalIP, Node->LocalPort, Node->RemoteIP, Node->RemotePort);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Find a test connection the way the connection list was walked.
+ * @param Index Connection index.
+ * @return Matching entry or NULL.
+ */
+static LPTCP_DEMUX_NODE TCPDemuxTestScan(U32 Index) {
+    LPTCP_DEMUX_NODE Key = &(TestDemuxNodes[Index]);
+
+    for (U32 Other = 0; Other < TCP_DEMUX_TEST_CONNECTIONS; Other++) {
+        LPTCP_DEMUX_NODE Node = &(TestDemuxNodes[Other]);
+
+        if (Node->LocalPort == Key->LocalPort && Node->RemotePort == Key->RemotePort &&
+            Node->RemoteIP == Key->RemoteIP && Node->LocalIP == Key->LocalIP) {
+            return Node;
+        }
+    }
+
+    return NULL;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Test the TCP connection lookup tables with many connections.
+ *
+ * Links a few hundred connections, half of them on one server port, plus
+ * a wildcard listener on that port and a bound listener on another one.
+ * Checks exact and listener lookups, port usage and removal, then logs
+ * the cost in TSC cycles of a hashed lookup and of a list walk.
+ *
+ * @param Results Pointer to TEST_RESULTS structure to be filled with test results
+ */
+void TestTCPDemux(TEST_RESULTS* Results) {
+    LPTCP_DEMUX_NODE WildcardListener = &(TestDemuxNodes[TCP_DEMUX_TEST_CONNECTIONS]);
+    LPTCP_DEMUX_NODE BoundListener = &(TestDemuxNodes[TCP_DEMUX_TEST_CONNECTIONS + 1]);
+    U32 UnknownPeer = Htonl(0xC0A80001);
+    BOOL Ok = TRUE;
+    U32 Index;
+    U32 Start;
+    U32 HashedCycles;
+    U32 ScanCycles;
+
+    Results->TestsRun = 0;
+    Results->TestsPassed = 0;
+
+    TCP_DemuxInit(&TestDemux);
+
+    for (Index = 0; Index < TCP_DEMUX_TEST_CONNECTIONS; Index++) {
+        TCPDemuxTestSetKey(Index);
+        TCP_DemuxInsert(&TestDemux, &(TestDemuxNodes[Index]));
+    }
+
+    MemorySet(WildcardListener, 0, sizeof(TCP_DEMUX_NODE));
+    WildcardListener->LocalPort = Htons(80);
+    TCP_DemuxInsert(&TestDemux, WildcardListener);
+
+    MemorySet(BoundListener, 0, sizeof(TCP_DEMUX_NODE));
+    BoundListener->LocalIP = TCP_DEMUX_TEST_LOCAL_IP;
+    BoundListener->LocalPort = Htons(443);
+    TCP_DemuxInsert(&TestDemux, BoundListener);
+
+    // Test 1: Every connection is found by its 4-tuple
+    Results->TestsRun++;
+
+    for (Index = 0; Index < TCP_DEMUX_TEST_CONNECTIONS && Ok; Index++) {
+        Ok = (TCPDemuxTestFind(Index) == &(TestDemuxNodes[Index]));
+    }
+
+    if (Ok && TestDemux.Count == TCP_DEMUX_TEST_CONNECTIONS + 2) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestTCPDemux] 4-tuple lookup failed at %u (count=%u)"), Index, TestDemux.Count);
+    }
+
+    // Test 2: Unknown peers reach the listener of the port
+    Results->TestsRun++;
+
+    if (TCP_DemuxLookup(&TestDemux, TCP_DEMUX_TEST_LOCAL_IP, Htons(80), UnknownPeer, Htons(1234)) == WildcardListener &&
+        TCP_DemuxLookup(&TestDemux, TCP_DEMUX_TEST_LOCAL_IP, Htons(443), UnknownPeer, Htons(1234)) == BoundListener &&
+        TCP_DemuxLookup(&TestDemux, Htonl(0x0A000203), Htons(443), UnknownPeer, Htons(1234)) == NULL &&
+        TCP_DemuxLookup(&TestDemux, TCP_DEMUX_TEST_LOCAL_IP, Htons(22), UnknownPeer, Htons(1234)) == NULL) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestTCPDemux] Listener lookup failed"));
+    }
+
+    // Test 3: Local port usage
+    Results->TestsRun++;
+
+    if (TCP_DemuxIsPortInUse(&TestDemux, TCP_DEMUX_TEST_LOCAL_IP, Htons(80)) &&
+        TCP_DemuxIsPortInUse(&TestDemux, TCP_DEMUX_TEST_LOCAL_IP, Htons(8000)) &&
+        TCP_DemuxIsPortInUse(&TestDemux, TCP_DEMUX_TEST_LOCAL_IP, Htons(8001)) == FALSE) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestTCPDemux] Port usage check failed"));
+    }
+
+    // Test 4: Hashed lookups against a walk of every connection
+    Results->TestsRun++;
+    Ok = TRUE;
+
+    Start = U64_Low32(ReadTimeStampCounter());
+    for (Index = 0; Index < TCP_DEMUX_TEST_LOOKUPS && Ok; Index++) {
+        U32 Target = (Index * 7) % TCP_DEMUX_TEST_CONNECTIONS;
+        Ok = (TCPDemuxTestFind(Target) == &(TestDemuxNodes[Target]));
+    }
+    HashedCycles = U64_Low32(ReadTimeStampCounter()) - Start;
+
+    Start = U64_Low32(ReadTimeStampCounter());
+    for (Index = 0; Index < TCP_DEMUX_TEST_LOOKUPS && Ok; Index++) {
+        U32 Target = (Index * 7) % TCP_DEMUX_TEST_CONNECTIONS;
+        Ok = (TCPDemuxTestScan(Target) == &(TestDemuxNodes[Target]));
+    }
+    ScanCycles = U64_Low32(ReadTimeStampCounter()) - Start;
+
+    if (Ok) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestTCPDemux] Lookup benchmark returned a wrong entry"));
+    }
+
+    VERBOSE(TEXT("[TestTCPDemux] %u connections: hashed lookup %u cycles, list walk %u cycles"),
+        TCP_DEMUX_TEST_CONNECTIONS, HashedCycles / TCP_DEMUX_TEST_LOOKUPS, ScanCycles / TCP_DEMUX_TEST_LOOKUPS);
+
+    // Test 5: Removed connections fall back to the listener or disappear
+    Results->TestsRun++;
+    Ok = TRUE;
+
+    for (Index = 0; Index < TCP_DEMUX_TEST_CONNECTIONS; Index += 2) {
+        TCP_DemuxRemove(&TestDemux, &(TestDemuxNodes[Index]));
+        TCP_DemuxRemove(&TestDemux, &(TestDemuxNodes[Index + 1]));
+    }
+    TCP_DemuxRemove(&TestDemux, BoundListener);
+
+    for (Index = 0; Index < TCP_DEMUX_TEST_CONNECTIONS && Ok; Index++) {
+        LPTCP_DEMUX_NODE Expected = (Index & 1) ? WildcardListener : NULL;
+        Ok = (TCPDemuxTestFind(Index) == Expected);
+    }
+
+    if (Ok && TestDemux.Count == 1 &&
+        TCP_DemuxIsPortInUse(&TestDemux, TCP_DEMUX_TEST_LOCAL_IP, Htons(8000)) == FALSE) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestTCPDemux] Removal failed at %u (count=%u)"), Index, TestDemux.Count);
+    }
+
+    TCP_DemuxRemove(&TestDemux, WildcardListener);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Test window scale negotiation and the advertised window field.
+ *
+ * Uses a detached connection with the default receive capacity, so that
+ * no device is needed.
+ *
+ * @param Results Pointer to TEST_RESULTS structure to be filled with test results
+ */
+void TestTCPWindowScale(TEST_RESULTS* Results) {
+    LPTCP_CONNECTION Conn = (LPTCP_CONNECTION)KernelHeapAlloc(sizeof(TCP_CONNECTION));
+    U8* Data = (U8*)KernelHeapAlloc(TCP_RECV_BUFFER_SIZE);
+    TCP_OPTIONS Options;
+    U8 Scale;
+    U16 Field;
+
+    Results->TestsRun = 0;
+    Results->TestsPassed = 0;
+
+    if (Conn == NULL || Data == NULL) {
+        ERROR(TEXT("[TestTCPWindowScale] Setup failed"));
+        Results->TestsRun++;
+        goto Out;
+    }
+
+    MemorySet(Conn, 0, sizeof(TCP_CONNECTION));
+    Conn->RecvBufferData = Data;
+    Conn->RecvBufferCapacity = TCP_RECV_BUFFER_SIZE;
+    CircularBuffer_Initialize(&(Conn->RecvBuffer), Data, TCP_RECV_BUFFER_SIZE, TCP_RECV_BUFFER_SIZE);
+    Scale = TCP_GetWindowScaleForCapacity(Conn->RecvBufferCapacity);
+
+    // Test 1: A receive buffer over 64 KiB needs a non-zero scale that covers it
+    Results->TestsRun++;
+    if (TCP_RECV_BUFFER_SIZE > 0xFFFFU && Scale > 0 && (TCP_RECV_BUFFER_SIZE >> Scale) <= 0xFFFFU &&
+        TCP_GetWindowScaleForCapacity(0xFFFFU) == 0) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestTCPWindowScale] Scale %u for %u bytes"), Scale, TCP_RECV_BUFFER_SIZE);
+    }
+
+    // Test 2: The scale holds when the peer offers the option, and a scaled window is advertised
+    Results->TestsRun++;
+    MemorySet(&Options, 0, sizeof(TCP_OPTIONS));
+    Options.HasWindowScale = TRUE;
+    Options.WindowScale = 7;
+    Conn->RecvWindowScale = Scale;
+    TCP_NegotiateOptions(Conn, &Options);
+    Field = TCP_GetWindowField(Conn, TCP_FLAG_ACK);
+
+    if (Conn->WindowScaleEnabled && Conn->RecvWindowScale == Scale && Conn->SendWindowScale == 7 &&
+        Field == (U16)(TCP_RECV_BUFFER_SIZE >> Scale) && ((U32)Field << Conn->RecvWindowScale) > 0xFFFFU &&
+        TCP_GetWindowField(Conn, TCP_FLAG_SYN | TCP_FLAG_ACK) == 0xFFFFU) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestTCPWindowScale] Negotiated scale %u, window field %u"), Conn->RecvWindowScale, Field);
+    }
+
+    // Test 3: Without the option from the peer, windows are not scaled
+    Results->TestsRun++;
+    Options.HasWindowScale = FALSE;
+    Conn->RecvWindowScale = Scale;
+    TCP_NegotiateOptions(Conn, &Options);
+
+    if (Conn->WindowScaleEnabled == FALSE && Conn->RecvWindowScale == 0 &&
+        TCP_GetWindowField(Conn, TCP_FLAG_ACK) == 0xFFFFU) {
+        Results->TestsPassed++;
+    } else {
+        ERROR(TEXT("[TestTCPWindowScale] Unnegotiated scale %u"), Conn->RecvWindowScale);
+    }
+
+Out:
+    if (Data != NULL) {
+        KernelHeapFree(Data);
+    }
+    if (Conn != NULL) {
+        KernelHeapFree(Conn);
+    }
+}
+
+/************************************************************************/
+
 /**
  * @brief Main TCP test function that runs all TCP unit tests.
  *
@@ -130,4 +403,14 @@ void TestTCP(TEST_RESULTS* Results) {
     TestTCPChecksum(&SubResults);
     Results->TestsRun += SubResults.TestsRun;
     Results->TestsPassed += SubResults.TestsPassed;
+
+    // Run TCP demultiplexing tests
+    TestTCPDemux(&SubResults);
+    Results->TestsRun += SubResults.TestsRun;
+    Results->TestsPassed += SubResults.TestsPassed;
+
+    // Run TCP window scaling tests
+    TestTCPWindowScale(&SubResults);
+    Results->TestsRun += SubResults.TestsRun;
+    Results->TestsPassed += SubResults.TestsPassed;
 }
@@ -0,0 +1,258 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Timer Wheel - Unit Tests
+
+\************************************************************************/
+
+#include "autotest/Autotest.h"
+#include "log/Log.h"
+#include "utils/TimerWheel.h"
+
+/************************************************************************/
+
+#define TIMER_WHEEL_TEST_ENTRIES 8
+
+typedef struct tag_TIMER_WHEEL_TEST_STATE {
+    UINT FiredCount;
+    UINT FiredAt[TIMER_WHEEL_TEST_ENTRIES];
+    UINT Now;
+    LPTIMER_WHEEL Wheel;
+    UINT Period;
+    UINT Remaining;
+} TIMER_WHEEL_TEST_STATE, *LPTIMER_WHEEL_TEST_STATE;
+
+static TIMER_WHEEL_TEST_STATE TimerWheelTestState;
+
+/************************************************************************/
+
+/**
+ * @brief Record the time at which one test entry fired.
+ * @param Entry Expired entry.
+ * @param Context Entry index.
+ */
+static void TimerWheelTestCallback(LPTIMER_WHEEL_ENTRY Entry, LPVOID Context) {
+    UINT Index = (UINT)(LINEAR)Context;
+
+    UNUSED(Entry);
+
+    if (Index < TIMER_WHEEL_TEST_ENTRIES) {
+        TimerWheelTestState.FiredAt[Index] = TimerWheelTestState.Now;
+    }
+
+    TimerWheelTestState.FiredCount++;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Record one expiry and re-arm the entry one period after its deadline.
+ * @param Entry Expired entry.
+ * @param Context Entry index.
+ */
+static void TimerWheelTestPeriodicCallback(LPTIMER_WHEEL_ENTRY Entry, LPVOID Context) {
+    TimerWheelTestCallback(Entry, Context);
+
+    if (TimerWheelTestState.Remaining > 0) {
+        TimerWheelTestState.Remaining--;
+        TimerWheelArm(TimerWheelTestState.Wheel, Entry, Entry->Deadline + TimerWheelTestState.Period);
+    }
+}
+
+/************************************************************************/
+
+/**
+ * @brief Initialize a wheel and its test entries.
+ * @param Wheel Wheel to initialize.
+ * @param Entries Entry array, TIMER_WHEEL_TEST_ENTRIES long.
+ * @param Now Start time in milliseconds.
+ */
+static void TimerWheelTestSetup(LPTIMER_WHEEL Wheel, LPTIMER_WHEEL_ENTRY Entries, UINT Now) {
+    TimerWheelTestState.FiredCount = 0;
+    TimerWheelTestState.Now = Now;
+    TimerWheelTestState.Wheel = Wheel;
+    TimerWheelTestState.Period = 0;
+    TimerWheelTestState.Remaining = 0;
+
+    for (UINT Index = 0; Index < TIMER_WHEEL_TEST_ENTRIES; Index++) {
+        TimerWheelTestState.FiredAt[Index] = 0;
+        TimerWheelEntryInitialize(&(Entries[Index]), TimerWheelTestCallback, (LPVOID)(LINEAR)Index);
+    }
+
+    TimerWheelInitialize(Wheel, 10, Now);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Advance a test wheel in small steps up to a given time.
+ * @param Wheel Wheel to advance.
+ * @param Target Time to reach in milliseconds.
+ * @param Step Milliseconds per step.
+ */
+static void TimerWheelTestRun(LPTIMER_WHEEL Wheel, UINT Target, UINT Step) {
+    while (TimerWheelTestState.Now < Target) {
+        TimerWheelTestState.Now += Step;
+        if (TimerWheelTestState.Now > Target) TimerWheelTestState.Now = Target;
+        TimerWheelAdvance(Wheel, TimerWheelTestState.Now);
+    }
+}
+
+/************************************************************************/
+
+void TestTimerWheel(TEST_RESULTS* Results) {
+    TIMER_WHEEL Wheel;
+    TIMER_WHEEL_ENTRY Entries[TIMER_WHEEL_TEST_ENTRIES];
+
+    if (Results == NULL) {
+        return;
+    }
+
+    Results->TestsRun = 0;
+    Results->TestsPassed = 0;
+
+    // Test 1: Near deadlines fire in their tick, never before
+    Results->TestsRun++;
+    {
+        BOOL Ok;
+
+        TimerWheelTestSetup(&Wheel, Entries, 1000);
+        TimerWheelArm(&Wheel, &(Entries[0]), 1035);
+        TimerWheelArm(&Wheel, &(Entries[1]), 1100);
+
+        TimerWheelTestRun(&Wheel, 1030, 5);
+        Ok = (TimerWheelTestState.FiredCount == 0);
+
+        TimerWheelTestRun(&Wheel, 1200, 5);
+        Ok = Ok && TimerWheelTestState.FiredCount == 2 &&
+             TimerWheelTestState.FiredAt[0] >= 1035 && TimerWheelTestState.FiredAt[0] < 1045 &&
+             TimerWheelTestState.FiredAt[1] >= 1100 && TimerWheelTestState.FiredAt[1] < 1110 && Wheel.Count == 0;
+
+        if (Ok) {
+            Results->TestsPassed++;
+        } else {
+            ERROR(TEXT("[TestTimerWheel] Near deadlines failed (fired=%u at %u, %u)"), TimerWheelTestState.FiredCount,
+                TimerWheelTestState.FiredAt[0], TimerWheelTestState.FiredAt[1]);
+        }
+    }
+
+    // Test 2: Disarmed entries never fire, re-armed entries follow the new deadline
+    Results->TestsRun++;
+    {
+        BOOL Ok;
+
+        TimerWheelTestSetup(&Wheel, Entries, 0);
+        TimerWheelArm(&Wheel, &(Entries[0]), 50);
+        TimerWheelArm(&Wheel, &(Entries[1]), 60);
+        TimerWheelDisarm(&Wheel, &(Entries[0]));
+        TimerWheelArm(&Wheel, &(Entries[1]), 500);
+
+        TimerWheelTestRun(&Wheel, 400, 10);
+        Ok = (TimerWheelTestState.FiredCount == 0 && TimerWheelIsArmed(&(Entries[0])) == FALSE);
+
+        TimerWheelTestRun(&Wheel, 600, 10);
+        Ok = Ok && TimerWheelTestState.FiredCount == 1 && TimerWheelTestState.FiredAt[1] >= 500 &&
+             TimerWheelIsArmed(&(Entries[1])) == FALSE;
+
+        if (Ok) {
+            Results->TestsPassed++;
+        } else {
+            ERROR(TEXT("[TestTimerWheel] Disarm/re-arm failed (fired=%u at %u)"), TimerWheelTestState.FiredCount,
+                TimerWheelTestState.FiredAt[1]);
+        }
+    }
+
+    // Test 3: Far deadlines cascade down through the upper levels
+    Results->TestsRun++;
+    {
+        UINT Deadlines[4] = {5000, 123456, 4000000, 40000000};
+        BOOL Ok = TRUE;
+
+        TimerWheelTestSetup(&Wheel, Entries, 7);
+
+        for (UINT Index = 0; Index < 4; Index++) {
+            TimerWheelArm(&Wheel, &(Entries[Index]), Deadlines[Index]);
+        }
+
+        for (UINT Index = 0; Index < 4; Index++) {
+            TimerWheelTestRun(&Wheel, Deadlines[Index] - 1, 997);
+            Ok = Ok && (TimerWheelTestState.FiredCount == Index);
+
+            TimerWheelTestRun(&Wheel, Deadlines[Index] + 9, 1);
+            Ok = Ok && (TimerWheelTestState.FiredCount == Index + 1);
+        }
+
+        if (Ok) {
+            Results->TestsPassed++;
+        } else {
+            ERROR(TEXT("[TestTimerWheel] Cascade failed (fired=%u)"), TimerWheelTestState.FiredCount);
+        }
+    }
+
+    // Test 4: Next deadline reports the earliest armed entry
+    Results->TestsRun++;
+    {
+        UINT Empty;
+        UINT First;
+        UINT Second;
+
+        TimerWheelTestSetup(&Wheel, Entries, 320);
+        Empty = TimerWheelGetNextDeadline(&Wheel);
+
+        TimerWheelArm(&Wheel, &(Entries[0]), 90000);
+        TimerWheelArm(&Wheel, &(Entries[1]), 2500);
+        TimerWheelArm(&Wheel, &(Entries[2]), 700);
+        First = TimerWheelGetNextDeadline(&Wheel);
+
+        TimerWheelTestRun(&Wheel, 800, 10);
+        Second = TimerWheelGetNextDeadline(&Wheel);
+
+        if (Empty == INFINITY && First == 700 && Second == 2500) {
+            Results->TestsPassed++;
+        } else {
+            ERROR(TEXT("[TestTimerWheel] Next deadline failed (empty=%u first=%u second=%u)"), Empty, First, Second);
+        }
+    }
+
+    // Test 5: Callbacks re-arming one wheel lap ahead fire once per period
+    Results->TestsRun++;
+    {
+        BOOL Ok;
+
+        TimerWheelTestSetup(&Wheel, Entries, 0);
+        TimerWheelEntryInitialize(&(Entries[0]), TimerWheelTestPeriodicCallback, (LPVOID)(LINEAR)0);
+        TimerWheelTestState.Period = TIMER_WHEEL_SLOTS * Wheel.Resolution;
+        TimerWheelTestState.Remaining = 3;
+        TimerWheelArm(&Wheel, &(Entries[0]), TimerWheelTestState.Period);
+
+        TimerWheelTestRun(&Wheel, TimerWheelTestState.Period * 2 + 5, 1);
+        Ok = (TimerWheelTestState.FiredCount == 2 && TimerWheelIsArmed(&(Entries[0])));
+
+        TimerWheelTestRun(&Wheel, TimerWheelTestState.Period * 10, 7);
+        Ok = Ok && TimerWheelTestState.FiredCount == 4 && TimerWheelIsArmed(&(Entries[0])) == FALSE &&
+             TimerWheelTestState.FiredAt[0] >= TimerWheelTestState.Period * 4 && Wheel.Count == 0;
+
+        if (Ok) {
+            Results->TestsPassed++;
+        } else {
+            ERROR(TEXT("[TestTimerWheel] Periodic re-arm failed (fired=%u at %u)"), TimerWheelTestState.FiredCount,
+                TimerWheelTestState.FiredAt[0]);
+        }
+    }
+}
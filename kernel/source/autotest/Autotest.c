@@ -44,8 +44,13 @@ typedef struct {
 // Test registry - add new tests here
 static TESTENTRY TestRegistry[] = {
     {TEXT("TestCopyStack"), TestCopyStack, FALSE},
+    {TEXT("TestMemoryStress"), TestMemoryStress, FALSE},
     {TEXT("TestCircularBuffer"), TestCircularBuffer, TRUE},
+    {TEXT("TestCache"), TestCache, TRUE},
+    {TEXT("TestNetworkChecksum"), TestNetworkChecksum, TRUE},
+    {TEXT("TestTimerWheel"), TestTimerWheel, TRUE},
     {TEXT("TestBlockList"), TestBlockList, TRUE},
+    {TEXT("TestSlab"), TestSlab, TRUE},
     {TEXT("TestRadixTree"), TestRadixTree, TRUE},
     {TEXT("TestRegex"), TestRegex, TRUE},
     {TEXT("TestX86_32Disassembler"), TestX86_32Disassembler, TRUE},
@@ -26,21 +26,27 @@
 
 #include "autotest/Autotest.h"
 #include "memory/BuddyAllocator.h"
+#include "memory/PageFrameCache.h"
+#include "memory/Slab.h"
 #include "system/Clock.h"
 #include "console/Console.h"
 #include "desktop/Desktop.h"
 #include "DisplaySession.h"
 #include "drivers/platform/ACPI.h"
 #include "drivers/input/Keyboard.h"
+#include "fs/BlockCache.h"
 #include "fs/File.h"
 #include "text/Lang.h"
 #include "log/Log.h"
+#include "network/Socket.h"
+#include "network/TCP.h"
 #include "text/Quotes.h"
 #include "process/Process.h"
 #include "process/Task.h"
 #include "system/SerialPort.h"
 #include "utils/BusyWait.h"
 #include "utils/Helpers.h"
+#include "core/KernelEvent.h"
 #include "utils/TOML.h"
 #include "utils/UUID.h"
 
@@ -76,6 +82,22 @@ typedef char KERNEL_STARTUP_INFO_OFFSET_IRQMASKA1PM_X86_64[
 
 /************************************************************************/
 
+typedef struct tag_KERNEL_OBJECT_CACHE {
+    U32 TypeID;
+    SLAB_CACHE Cache;
+} KERNEL_OBJECT_CACHE, *LPKERNEL_OBJECT_CACHE;
+
+// Slab caches for the kernel objects created and destroyed most often
+static KERNEL_OBJECT_CACHE DATA_SECTION KernelObjectCaches[] = {
+    {KOID_TASK, SLAB_CACHE_INIT(TEXT("Task"), sizeof(TASK))},
+    {KOID_MUTEX, SLAB_CACHE_INIT(TEXT("Mutex"), sizeof(MUTEX))},
+    {KOID_KERNELEVENT, SLAB_CACHE_INIT(TEXT("KernelEvent"), sizeof(KERNEL_EVENT))},
+    {KOID_SOCKET, SLAB_CACHE_INIT(TEXT("Socket"), sizeof(SOCKET))},
+    {KOID_TCP, SLAB_CACHE_INIT(TEXT("TcpConnection"), sizeof(TCP_CONNECTION))},
+};
+
+/************************************************************************/
+
 void SystemDataViewMode(void);
 
 U32 EXOS_End SECTION(".end_mark") = 0x534F5845;
@@ -472,8 +494,8 @@ void KernelObjectDestructor(LPVOID Object) {
 /**
  * @brief Create a kernel object with standard LISTNODE_FIELDS initialization.
  *
- * This function allocates memory for a kernel object and initializes its
- * LISTNODE_FIELDS with the specified ID, References = 1, current process
+ * This function allocates memory for a kernel object, from its slab cache
+ * when the type has one, and initializes its LISTNODE_FIELDS with the specified ID, References = 1, current process
  * as parent, and NULL for Next/Prev pointers.
  *
  * @param Size Size of the object to allocate (e.g., sizeof(TASK))
@@ -481,11 +503,20 @@ void KernelObjectDestructor(LPVOID Object) {
  * @return Pointer to the allocated and initialized object, or NULL on failure
  */
 LPVOID CreateKernelObject(UINT Size, U32 ObjectTypeID) {
-    LPLISTNODE Object;
+    LPLISTNODE Object = NULL;
     U8 Identifier[UUID_BINARY_SIZE];
     U64 ObjectID = U64_0;
 
-    Object = (LPLISTNODE)KernelHeapAlloc(Size);
+    for (UINT Index = 0; Index < ARRAY_COUNT(KernelObjectCaches); Index++) {
+        if (KernelObjectCaches[Index].TypeID == ObjectTypeID && KernelObjectCaches[Index].Cache.ObjectSize == Size) {
+            Object = (LPLISTNODE)SlabCacheAlloc(&(KernelObjectCaches[Index].Cache));
+            break;
+        }
+    }
+
+    if (Object == NULL) {
+        Object = (LPLISTNODE)KernelHeapAlloc(Size);
+    }
 
     if (Object == NULL) {
         ERROR(TEXT("[CreateKernelObject] Failed to allocate memory for object type %d"), ObjectTypeID);
@@ -769,11 +800,16 @@ static void UseConfiguration(void) {
 
 UINT GetPhysicalMemoryUsed(void) {
     UINT NumPages = 0;
+    UINT Cached;
 
     LockMutex(MUTEX_MEMORY, INFINITY);
     NumPages = BuddyGetUsedPageCount();
     UnlockMutex(MUTEX_MEMORY);
 
+    // Pages parked in the CPU page caches are free for the system
+    Cached = PageFrameCacheGetCachedCount();
+    if (Cached < NumPages) NumPages -= Cached;
+
     return (NumPages << PAGE_SIZE_MUL);
 }
 
@@ -895,12 +931,13 @@ static void KillActiveKernelTasks(void);
 /**
  * @brief Common pre-shutdown sequence used by power actions.
  *
- * Kills active userland processes, then kernel tasks, then unloads all
- * drivers in reverse initialization order.
+ * Kills active userland processes, then kernel tasks, writes back the
+ * block cache, then unloads all drivers in reverse initialization order.
  */
 static void PrepareForPowerTransition(void) {
     KillActiveUserlandProcesses();
     KillActiveKernelTasks();
+    BlockCacheFlush(NULL);
     UnloadAllDrivers();
 }
 
@@ -914,6 +951,7 @@ static U32 KernelMonitor(LPVOID Parameter) {
         DeleteDeadTasksAndProcesses();
         DeleteUnreferencedObjects();
         CacheCleanup(GetObjectTerminationCache(), GetSystemTime());
+        BlockCacheFlushExpired(GetSystemTime());
 
         LogCounter++;
         if (LogCounter >= 60) {  // 60 * 500ms = 30 seconds
@@ -246,7 +246,7 @@ static BOOL DesktopEnsureGraphicsShadowBuffer(LPDESKTOP Desktop, LPGRAPHICSCONTE
             VMA_KERNEL,
             0,
             RequiredSize,
-            ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE | ALLOC_PAGES_AT_OR_OVER,
+            ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE | ALLOC_PAGES_AT_OR_OVER | ALLOC_PAGES_LARGE,
             TEXT("DesktopGraphicsShadow"));
         if (Desktop->GraphicsShadowBufferLinear == 0) {
             ERROR(TEXT("[DesktopEnsureGraphicsShadowBuffer] AllocRegion failed size=%u"), RequiredSize);
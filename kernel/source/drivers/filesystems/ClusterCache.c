@@ -60,6 +60,24 @@ static BOOL ClusterCacheFlushBridge(LPVOID Data, LPVOID Context) {
 
 /***************************************************************************/
 
+/**
+ * @brief Compute the cache key of an owner/cluster/size triple.
+ * @param Owner Namespace owner key.
+ * @param ClusterIndex Cluster index key.
+ * @param DataSize Payload size in bytes.
+ * @return Hash key for the generic cache.
+ */
+static U32 ClusterCacheKey(LPCVOID Owner, U64 ClusterIndex, UINT DataSize) {
+    U32 Key = CacheHashMix(0, (U32)(LINEAR)Owner);
+
+    Key = CacheHashMix(Key, U64_Low32(ClusterIndex));
+    Key = CacheHashMix(Key, U64_High32(ClusterIndex));
+
+    return CacheHashMix(Key, DataSize);
+}
+
+/***************************************************************************/
+
 /**
  * @brief Match one cache entry against owner/cluster/size keys.
  *
@@ -105,7 +123,8 @@ static BOOL ClusterCacheStoreInternal(
     Context.ClusterIndex = ClusterIndex;
     Context.DataSize = DataSize;
 
-    Entry = (LPCLUSTER_CACHE_ENTRY)CacheFind(&ClusterCache->Cache, ClusterCacheMatcher, &Context);
+    Entry = (LPCLUSTER_CACHE_ENTRY)CacheFindKey(
+        &ClusterCache->Cache, ClusterCacheKey(Owner, ClusterIndex, Context.DataSize), ClusterCacheMatcher, &Context);
     if (Entry != NULL) {
         MemoryCopy(Entry->Data, Data, DataSize);
     } else {
@@ -118,7 +137,8 @@ static BOOL ClusterCacheStoreInternal(
         Entry->DataSize = DataSize;
         MemoryCopy(Entry->Data, Data, DataSize);
 
-        if (!CacheAdd(&ClusterCache->Cache, Entry, ClusterCache->DefaultTimeToLive)) {
+        if (!CacheAddKey(&ClusterCache->Cache, ClusterCacheKey(Owner, ClusterIndex, DataSize), Entry,
+                ClusterCache->DefaultTimeToLive)) {
             KernelHeapFree(Entry);
             return FALSE;
         }
@@ -255,7 +275,8 @@ BOOL ClusterCacheRead(
     Context.ClusterIndex = ClusterIndex;
     Context.DataSize = BufferSize;
 
-    Entry = (LPCLUSTER_CACHE_ENTRY)CacheFind(&ClusterCache->Cache, ClusterCacheMatcher, &Context);
+    Entry = (LPCLUSTER_CACHE_ENTRY)CacheFindKey(
+        &ClusterCache->Cache, ClusterCacheKey(Owner, ClusterIndex, Context.DataSize), ClusterCacheMatcher, &Context);
     if (Entry == NULL) return FALSE;
 
     MemoryCopy(Buffer, Entry->Data, BufferSize);
@@ -285,7 +306,8 @@ BOOL ClusterCacheFlushCluster(
     Context.ClusterIndex = ClusterIndex;
     Context.DataSize = DataSize;
 
-    Entry = (LPCLUSTER_CACHE_ENTRY)CacheFind(&ClusterCache->Cache, ClusterCacheMatcher, &Context);
+    Entry = (LPCLUSTER_CACHE_ENTRY)CacheFindKey(
+        &ClusterCache->Cache, ClusterCacheKey(Owner, ClusterIndex, Context.DataSize), ClusterCacheMatcher, &Context);
     if (Entry == NULL) return FALSE;
 
     return CacheFlushEntry(&ClusterCache->Cache, Entry);
@@ -98,6 +98,9 @@ BOOL AllocateBlock(LPEXT2FILESYSTEM FileSystem, U32* BlockNumber) {
 
                 Ext2ReleaseBlockBuffer(FileSystem, Zero);
 
+                // Block maps of open files may hold a hole for this block
+                FileSystem->MapGeneration++;
+
                 *BlockNumber = AbsoluteBlock;
                 Ext2ReleaseBlockBuffer(FileSystem, Bitmap);
                 return TRUE;
@@ -156,6 +159,8 @@ BOOL FreeBlock(LPEXT2FILESYSTEM FileSystem, U32 BlockNumber) {
         Bitmap[ByteIndex] &= (U8)~Mask;
     }
 
+    FileSystem->MapGeneration++;
+
     if (WriteBlock(FileSystem, FileSystem->Groups[GroupIndex].BlockBitmap, Bitmap) == FALSE) {
         Ext2ReleaseBlockBuffer(FileSystem, Bitmap);
         return FALSE;
@@ -335,6 +340,9 @@ BOOL TruncateInode(LPEXT2FILESYSTEM FileSystem, LPEXT2INODE Inode) {
 
     if (FileSystem == NULL || Inode == NULL) return FALSE;
 
+    // Freed blocks may be reused, drop the readahead windows
+    FileSystem->WriteGeneration++;
+
     for (Index = 0; Index < EXT2_DIRECT_BLOCKS; Index++) {
         if (Inode->Block[Index] != 0) {
             FreeBlock(FileSystem, Inode->Block[Index]);
@@ -0,0 +1,221 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    EXT2 Block Map
+
+\************************************************************************/
+
+#include "drivers/filesystems/EXT2-Private.h"
+
+/************************************************************************/
+
+/**
+ * @brief Reads the block pointers of the leaf that maps a file block.
+ *
+ * The leaf is the array of direct pointers of the inode, or the indirect
+ * block that holds the entry of BlockIndex. A missing indirect block on the
+ * path makes the whole leaf a hole.
+ * @param FileSystem Pointer to the EXT2 file system instance.
+ * @param Inode Inode of the file.
+ * @param BlockIndex Zero-based data block index within the file.
+ * @param Pointers Receives the pointers, one block buffer in size.
+ * @param FirstIndex Receives the file block index of Pointers[0].
+ * @param Count Receives the number of pointers.
+ * @return TRUE on success, FALSE on error or when BlockIndex is out of range.
+ */
+static BOOL Ext2ReadBlockLeaf(
+    LPEXT2FILESYSTEM FileSystem, LPEXT2INODE Inode, U32 BlockIndex, U32* Pointers, U32* FirstIndex, U32* Count) {
+    U32 EntriesPerBlock = FileSystem->BlockSize / sizeof(U32);
+    U32 SingleSpan = EntriesPerBlock;
+    U32 DoubleSpan = SingleSpan * EntriesPerBlock;
+    U32 LogicalIndex;
+    U32 LeafBlock;
+    U32 Depth;
+    U32 Index;
+
+    if (BlockIndex < EXT2_DIRECT_BLOCKS) {
+        MemoryCopy(Pointers, Inode->Block, EXT2_DIRECT_BLOCKS * sizeof(U32));
+        *FirstIndex = 0;
+        *Count = EXT2_DIRECT_BLOCKS;
+        return TRUE;
+    }
+
+    LogicalIndex = BlockIndex - EXT2_DIRECT_BLOCKS;
+
+    if (LogicalIndex < SingleSpan) {
+        LeafBlock = Inode->Block[EXT2_DIRECT_BLOCKS];
+        Depth = 0;
+        *FirstIndex = EXT2_DIRECT_BLOCKS;
+    } else if (LogicalIndex - SingleSpan < DoubleSpan) {
+        LogicalIndex -= SingleSpan;
+        LeafBlock = Inode->Block[EXT2_DIRECT_BLOCKS + 1];
+        Depth = 1;
+    } else if ((LogicalIndex - SingleSpan - DoubleSpan) / DoubleSpan < EntriesPerBlock) {
+        LogicalIndex -= SingleSpan + DoubleSpan;
+        LeafBlock = Inode->Block[EXT2_DIRECT_BLOCKS + 2];
+        Depth = 2;
+    } else {
+        return FALSE;
+    }
+
+    if (Depth > 0) {
+        *FirstIndex = BlockIndex - (LogicalIndex % SingleSpan);
+    }
+
+    // Walk down to the indirect block holding the entry
+    while (Depth > 0 && LeafBlock != 0) {
+        U32 Span = (Depth == 2) ? DoubleSpan : SingleSpan;
+
+        if (ReadBlock(FileSystem, LeafBlock, Pointers) == FALSE) return FALSE;
+
+        LeafBlock = Pointers[(LogicalIndex / Span) % EntriesPerBlock];
+        LogicalIndex %= Span;
+        Depth--;
+    }
+
+    *Count = EntriesPerBlock;
+
+    if (LeafBlock == 0) {
+        for (Index = 0; Index < EntriesPerBlock; Index++) Pointers[Index] = 0;
+        return TRUE;
+    }
+
+    return ReadBlock(FileSystem, LeafBlock, Pointers);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Appends one file block to the map, extending the last run when possible.
+ * @param Map Block map of an open file.
+ * @param Logical File block index, right after the last mapped block.
+ * @param Physical Disk block, 0 for a hole.
+ * @return TRUE when the block is mapped, FALSE when the map is full.
+ */
+static BOOL Ext2BlockMapAppend(LPEXT2_BLOCK_MAP Map, U32 Logical, U32 Physical) {
+    if (Map->RunCount > 0) {
+        LPEXT2_BLOCK_RUN Last = &(Map->Runs[Map->RunCount - 1]);
+
+        if (Last->Logical + Last->Length == Logical) {
+            if ((Physical == 0 && Last->Physical == 0) ||
+                (Physical != 0 && Last->Physical != 0 && Last->Physical + Last->Length == Physical)) {
+                Last->Length++;
+                return TRUE;
+            }
+        }
+    }
+
+    if (Map->RunCount >= EXT2_BLOCK_MAP_RUNS) return FALSE;
+
+    Map->Runs[Map->RunCount].Logical = Logical;
+    Map->Runs[Map->RunCount].Physical = Physical;
+    Map->Runs[Map->RunCount].Length = 1;
+    Map->RunCount++;
+
+    return TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Drops every run of a block map.
+ * @param Map Block map of an open file.
+ */
+void Ext2BlockMapReset(LPEXT2_BLOCK_MAP Map) {
+    if (Map == NULL) return;
+
+    Map->RunCount = 0;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Maps a file block to a disk block through the run cache of the file.
+ *
+ * On a miss, the leaf holding the block is decoded once into runs of
+ * contiguous blocks, from BlockIndex to the end of the leaf. A miss right
+ * after the last run extends the map, any other miss starts it again. The
+ * map is dropped when blocks were allocated or freed on the filesystem.
+ * @param FileSystem Pointer to the EXT2 file system instance.
+ * @param File Open regular file.
+ * @param BlockIndex Zero-based data block index within the file.
+ * @param BlockNumber Receives the disk block (0 for a hole).
+ * @param RunLength Receives the number of blocks from BlockIndex to the end of its run.
+ * @return TRUE on success, FALSE on error.
+ */
+BOOL Ext2BlockMapLookup(
+    LPEXT2FILESYSTEM FileSystem, LPEXT2FILE File, U32 BlockIndex, U32* BlockNumber, U32* RunLength) {
+    LPEXT2_BLOCK_MAP Map;
+    U32* Pointers;
+    U32 FirstIndex;
+    U32 Count;
+    U32 Index;
+
+    if (FileSystem == NULL || File == NULL || BlockNumber == NULL || RunLength == NULL) return FALSE;
+    if (FileSystem->BlockSize == 0) return FALSE;
+
+    Map = &(File->BlockMap);
+
+    if (Map->Generation != FileSystem->MapGeneration) {
+        Map->RunCount = 0;
+        Map->Generation = FileSystem->MapGeneration;
+    }
+
+    for (Index = 0; Index < Map->RunCount; Index++) {
+        LPEXT2_BLOCK_RUN Run = &(Map->Runs[Index]);
+
+        if (BlockIndex >= Run->Logical && BlockIndex - Run->Logical < Run->Length) {
+            *BlockNumber = (Run->Physical != 0) ? Run->Physical + (BlockIndex - Run->Logical) : 0;
+            *RunLength = Run->Length - (BlockIndex - Run->Logical);
+            return TRUE;
+        }
+    }
+
+    Pointers = (U32*)Ext2AcquireBlockBuffer(FileSystem);
+    if (Pointers == NULL) return FALSE;
+
+    if (Ext2ReadBlockLeaf(FileSystem, &(File->Inode), BlockIndex, Pointers, &FirstIndex, &Count) == FALSE) {
+        Ext2ReleaseBlockBuffer(FileSystem, Pointers);
+        return FALSE;
+    }
+
+    if (Map->RunCount == 0 || Map->RunCount >= EXT2_BLOCK_MAP_RUNS ||
+        Map->Runs[Map->RunCount - 1].Logical + Map->Runs[Map->RunCount - 1].Length != BlockIndex) {
+        Map->RunCount = 0;
+    }
+
+    for (Index = BlockIndex - FirstIndex; Index < Count; Index++) {
+        if (Ext2BlockMapAppend(Map, FirstIndex + Index, Pointers[Index]) == FALSE) break;
+    }
+
+    Ext2ReleaseBlockBuffer(FileSystem, Pointers);
+
+    // The run holding BlockIndex is the last one it could extend or the first one added
+    for (Index = Map->RunCount; Index > 0; Index--) {
+        LPEXT2_BLOCK_RUN Run = &(Map->Runs[Index - 1]);
+
+        if (BlockIndex >= Run->Logical && BlockIndex - Run->Logical < Run->Length) {
+            *BlockNumber = (Run->Physical != 0) ? Run->Physical + (BlockIndex - Run->Logical) : 0;
+            *RunLength = Run->Length - (BlockIndex - Run->Logical);
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
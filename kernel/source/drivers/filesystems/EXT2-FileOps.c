@@ -23,6 +23,8 @@
 
 #include "drivers/filesystems/EXT2-Private.h"
 
+#include "fs/BlockIO.h"
+
 /************************************************************************/
 
 static LPEXT2FILESYSTEM NewEXT2FileSystem(LPSTORAGE_UNIT Disk) {
@@ -86,6 +88,8 @@ static LPEXT2FILE NewEXT2File(LPEXT2FILESYSTEM FileSystem) {
     File->DirectoryBlock = NULL;
     File->DirectoryBlockValid = FALSE;
 
+    ReadAheadInit(&(File->ReadAhead), FileSystem->BlockSize);
+
     return File;
 }
 
@@ -299,6 +303,8 @@ static U32 CloseFile(LPEXT2FILE File) {
         ReleaseDirectoryResources(File);
     }
 
+    ReadAheadDeinit(&(File->ReadAhead));
+
     ReleaseKernelObject(File);
 
     return DF_RETURN_SUCCESS;
@@ -306,6 +312,133 @@ static U32 CloseFile(LPEXT2FILE File) {
 
 /************************************************************************/
 
+/**
+ * @brief Fetches a missed file block and the blocks that follow it.
+ *
+ * Each run of the readahead window is one asynchronous block I/O request,
+ * and up to EXT2_READ_AHEAD_REQUESTS runs are in flight at once. Adjacent
+ * runs merge in the disk queue. A hole run is zero-filled instead. Without
+ * a window buffer, only the missed block is read into IOBuffer.
+ *
+ * @param FileSystem Owning EXT2 filesystem instance.
+ * @param File Regular file being read.
+ * @param BlockIndex Missed block index in the file.
+ * @param Data Receives the data of the missed block.
+ * @return TRUE on success, FALSE on I/O error.
+ */
+static BOOL ReadFileBlocks(LPEXT2FILESYSTEM FileSystem, LPEXT2FILE File, U32 BlockIndex, U8** Data) {
+    BLOCK_REQUEST Requests[EXT2_READ_AHEAD_REQUESTS];
+    U32 RequestFirst[EXT2_READ_AHEAD_REQUESTS];
+    U32 BlockCount = (File->Inode.Size + FileSystem->BlockSize - 1) / FileSystem->BlockSize;
+    U32 FirstBlock;
+    U32 RunLength;
+    U32 Count;
+    U32 Filled;
+    U32 Queued;
+    U8* Buffer = NULL;
+
+    if (Ext2BlockMapLookup(FileSystem, File, BlockIndex, &FirstBlock, &RunLength) == FALSE) return FALSE;
+
+    Count = ReadAheadPrepare(&(File->ReadAhead), BlockIndex, BlockCount - BlockIndex, &Buffer);
+
+    if (Count == 0) {
+        if (FirstBlock == 0) {
+            MemorySet(FileSystem->IOBuffer, 0, FileSystem->BlockSize);
+        } else if (ReadBlock(FileSystem, FirstBlock, FileSystem->IOBuffer) == FALSE) {
+            return FALSE;
+        }
+
+        *Data = FileSystem->IOBuffer;
+        return TRUE;
+    }
+
+    Filled = 0;
+    Queued = 0;
+
+    while (Filled < Count) {
+        U8* Target = Buffer + (Filled * FileSystem->BlockSize);
+        U32 Take;
+
+        if (Filled > 0 && Ext2BlockMapLookup(FileSystem, File, BlockIndex + Filled, &FirstBlock, &RunLength) == FALSE) {
+            break;
+        }
+
+        Take = Count - Filled;
+        if (Take > RunLength) Take = RunLength;
+
+        if (FirstBlock == 0) {
+            MemorySet(Target, 0, Take * FileSystem->BlockSize);
+        } else {
+            LPBLOCK_REQUEST Request = &(Requests[Queued]);
+
+            if (Queued == EXT2_READ_AHEAD_REQUESTS) break;
+
+            if (BlockRequestInit(Request, FileSystem->Disk, FileSystem->PartitionStart +
+                    (FirstBlock * FileSystem->SectorsPerBlock), 0, Take * FileSystem->SectorsPerBlock, Target,
+                    Take * FileSystem->BlockSize, FALSE, 0) == FALSE ||
+                BlockIOSubmit(Request) != DF_RETURN_SUCCESS) {
+                break;
+            }
+
+            RequestFirst[Queued] = Filled;
+            Queued++;
+        }
+
+        Filled += Take;
+    }
+
+    // Keep the blocks before the first failed run
+    for (U32 Index = 0; Index < Queued; Index++) {
+        BlockIOWait(&(Requests[Index]), INFINITY);
+
+        if (Requests[Index].Result != DF_RETURN_SUCCESS && RequestFirst[Index] < Filled) {
+            Filled = RequestFirst[Index];
+        }
+
+        BlockRequestRelease(&(Requests[Index]));
+    }
+
+    if (Filled == 0) return FALSE;
+
+    ReadAheadCommit(&(File->ReadAhead), BlockIndex, Filled);
+
+    *Data = Buffer;
+    return TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Reads whole blocks of one run straight into the caller buffer.
+ * @param FileSystem Owning EXT2 filesystem instance.
+ * @param File Regular file being read, positioned on a block boundary.
+ * @param MaxBlocks Whole blocks left in the request.
+ * @param Blocks Receives the number of blocks read.
+ * @return TRUE on success, FALSE on I/O error.
+ */
+static BOOL ReadFileRun(LPEXT2FILESYSTEM FileSystem, LPEXT2FILE File, U32 MaxBlocks, U32* Blocks) {
+    U32 BlockIndex = File->Header.Position / FileSystem->BlockSize;
+    U8* Target = ((U8*)File->Header.Buffer) + File->Header.BytesTransferred;
+    U32 FirstBlock;
+    U32 Count;
+
+    if (Ext2BlockMapLookup(FileSystem, File, BlockIndex, &FirstBlock, &Count) == FALSE) return FALSE;
+
+    if (Count > MaxBlocks) Count = MaxBlocks;
+
+    if (FirstBlock == 0) {
+        MemorySet(Target, 0, Count * FileSystem->BlockSize);
+    } else if (ReadSectors(FileSystem, FirstBlock * FileSystem->SectorsPerBlock, Count * FileSystem->SectorsPerBlock,
+                   Target) == FALSE) {
+        return FALSE;
+    }
+
+    *Blocks = Count;
+    return TRUE;
+}
+
+/************************************************************************/
+
 /**
  * @brief Reads data from an EXT2 file into the provided buffer.
  * @param File File handle describing the read request.
@@ -350,23 +483,35 @@ static U32 ReadFile(LPEXT2FILE File) {
         Remaining = File->Header.ByteCount;
     }
 
+    ReadAheadValidate(&(File->ReadAhead), FileSystem->WriteGeneration);
+
     while (Remaining > 0) {
         U32 BlockIndex;
         U32 OffsetInBlock;
-        U32 BlockNumber;
         U32 Chunk;
+        U8* Data;
 
         BlockIndex = File->Header.Position / FileSystem->BlockSize;
         OffsetInBlock = File->Header.Position % FileSystem->BlockSize;
 
-        if (GetInodeBlockNumber(FileSystem, &(File->Inode), BlockIndex, &BlockNumber) == FALSE) {
-            UnlockMutex(&(FileSystem->FilesMutex));
-            return DF_RETURN_INPUT_OUTPUT;
+        // Large aligned requests skip the readahead window, one request per run
+        if (OffsetInBlock == 0 && Remaining >= READ_AHEAD_MAX_BYTES) {
+            U32 Blocks;
+
+            if (ReadFileRun(FileSystem, File, Remaining / FileSystem->BlockSize, &Blocks) == FALSE) {
+                UnlockMutex(&(FileSystem->FilesMutex));
+                return DF_RETURN_INPUT_OUTPUT;
+            }
+
+            File->Header.Position += Blocks * FileSystem->BlockSize;
+            File->Header.BytesTransferred += Blocks * FileSystem->BlockSize;
+            Remaining -= Blocks * FileSystem->BlockSize;
+            continue;
         }
 
-        if (BlockNumber == 0) {
-            MemorySet(FileSystem->IOBuffer, 0, FileSystem->BlockSize);
-        } else if (ReadBlock(FileSystem, BlockNumber, FileSystem->IOBuffer) == FALSE) {
+        Data = ReadAheadFind(&(File->ReadAhead), BlockIndex);
+
+        if (Data == NULL && ReadFileBlocks(FileSystem, File, BlockIndex, &Data) == FALSE) {
             UnlockMutex(&(FileSystem->FilesMutex));
             return DF_RETURN_INPUT_OUTPUT;
         }
@@ -376,9 +521,7 @@ static U32 ReadFile(LPEXT2FILE File) {
             Chunk = Remaining;
         }
 
-        MemoryCopy(((U8*)File->Header.Buffer) + File->Header.BytesTransferred,
-            FileSystem->IOBuffer + OffsetInBlock,
-            Chunk);
+        MemoryCopy(((U8*)File->Header.Buffer) + File->Header.BytesTransferred, Data + OffsetInBlock, Chunk);
 
         File->Header.Position += Chunk;
         File->Header.BytesTransferred += Chunk;
@@ -431,6 +574,7 @@ static U32 WriteFile(LPEXT2FILE File) {
     }
 
     Remaining = File->Header.ByteCount;
+    FileSystem->WriteGeneration++;
 
     while (Remaining > 0) {
         U32 BlockIndex;
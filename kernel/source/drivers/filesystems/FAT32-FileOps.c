@@ -654,6 +654,15 @@ static U32 CloseFile(LPFATFILE File) {
 
     FileSystem = (LPFAT32FILESYSTEM)File->Header.FileSystem;
 
+    ReadAheadDeinit(&(File->ReadAhead));
+
+    if (File->Runs != NULL) {
+        KernelHeapFree(File->Runs);
+        File->Runs = NULL;
+        File->RunCount = 0;
+        File->RunCapacity = 0;
+    }
+
     //-------------------------------------
     // Update file information in directory entry
 
@@ -678,6 +687,190 @@ static U32 CloseFile(LPFATFILE File) {
 
 /***************************************************************************/
 
+/**
+ * @brief Append one cluster of the chain to the run list of a file.
+ * @param File Open file.
+ * @param RelativeCluster Cluster index in the file, one past the mapped part.
+ * @param Cluster Cluster number.
+ * @return TRUE on success, FALSE when the run list cannot grow.
+ */
+static BOOL AppendFileCluster(LPFATFILE File, U32 RelativeCluster, CLUSTER Cluster) {
+    LPFAT32_CLUSTER_RUN Run;
+
+    if (File->RunCount != 0) {
+        Run = &(File->Runs[File->RunCount - 1]);
+
+        if (Run->Cluster + Run->Length == Cluster) {
+            Run->Length++;
+            return TRUE;
+        }
+    }
+
+    if (File->RunCount == File->RunCapacity) {
+        U32 Capacity = (File->RunCapacity != 0) ? File->RunCapacity * 2 : FAT32_FILE_MIN_RUNS;
+        U32 Size = Capacity * sizeof(FAT32_CLUSTER_RUN);
+        LPFAT32_CLUSTER_RUN Runs;
+
+        if (File->Runs != NULL) {
+            Runs = (LPFAT32_CLUSTER_RUN)KernelHeapRealloc(File->Runs, Size);
+        } else {
+            Runs = (LPFAT32_CLUSTER_RUN)KernelHeapAlloc(Size);
+        }
+
+        if (Runs == NULL) return FALSE;
+
+        File->Runs = Runs;
+        File->RunCapacity = Capacity;
+    }
+
+    Run = &(File->Runs[File->RunCount++]);
+    Run->Relative = RelativeCluster;
+    Run->Cluster = Cluster;
+    Run->Length = 1;
+
+    return TRUE;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Extend the run list of a file until it covers a relative cluster.
+ *
+ * The chain is followed from the last mapped cluster, so each FAT entry of a
+ * file is read once per handle. FAT32 never shortens a chain, so mapped runs
+ * stay valid while the file grows.
+ *
+ * @param FileSystem Owning file system.
+ * @param File Open file.
+ * @param RelativeCluster Cluster index in the file.
+ * @return TRUE when mapped, FALSE when the chain is shorter or on error.
+ */
+static BOOL MapFileClusters(LPFAT32FILESYSTEM FileSystem, LPFATFILE File, U32 RelativeCluster) {
+    LPFAT32_CLUSTER_RUN Run;
+    CLUSTER Cluster;
+    U32 Mapped;
+
+    if (File->RunCount == 0) {
+        Cluster = File->Location.DataCluster;
+
+        if (Cluster == 0 || Cluster >= FAT32_CLUSTER_RESERVED) return FALSE;
+        if (AppendFileCluster(File, 0, Cluster) == FALSE) return FALSE;
+    }
+
+    Run = &(File->Runs[File->RunCount - 1]);
+    Mapped = Run->Relative + Run->Length;
+    Cluster = Run->Cluster + Run->Length - 1;
+
+    while (Mapped <= RelativeCluster) {
+        Cluster = GetNextClusterInChain(FileSystem, Cluster);
+
+        if (Cluster == 0 || Cluster >= FAT32_CLUSTER_RESERVED) return FALSE;
+        if (AppendFileCluster(File, Mapped, Cluster) == FALSE) return FALSE;
+
+        Mapped++;
+    }
+
+    return TRUE;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Find the cluster number of a relative cluster of a file.
+ *
+ * The run holding the cluster is found by binary search, so a seek costs
+ * O(log runs) once the chain is mapped.
+ *
+ * @param FileSystem Owning file system.
+ * @param File Open file.
+ * @param RelativeCluster Cluster index in the file.
+ * @param Wanted Number of clusters the caller would like to be contiguous.
+ * @param RunLeft Receives the number of contiguous clusters from RelativeCluster, may be NULL.
+ * @return Cluster number, or 0 when the chain is shorter.
+ */
+static CLUSTER FindFileCluster(
+    LPFAT32FILESYSTEM FileSystem, LPFATFILE File, U32 RelativeCluster, U32 Wanted, U32* RunLeft) {
+    LPFAT32_CLUSTER_RUN Run;
+    U32 Low;
+    U32 High;
+
+    if (MapFileClusters(FileSystem, File, RelativeCluster) == FALSE) return 0;
+
+    if (Wanted > 1) {
+        // The chain may end before, the mapped part is enough
+        MapFileClusters(FileSystem, File, RelativeCluster + Wanted - 1);
+    }
+
+    Low = 0;
+    High = File->RunCount - 1;
+
+    while (Low < High) {
+        U32 Middle = (Low + High + 1) / 2;
+
+        if (File->Runs[Middle].Relative <= RelativeCluster) {
+            Low = Middle;
+        } else {
+            High = Middle - 1;
+        }
+    }
+
+    Run = &(File->Runs[Low]);
+
+    if (RunLeft != NULL) {
+        *RunLeft = Run->Relative + Run->Length - RelativeCluster;
+    }
+
+    return Run->Cluster + (RelativeCluster - Run->Relative);
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Read a missed cluster of a file and the clusters that follow it.
+ *
+ * The clusters of the readahead window are read with one disk request as
+ * long as the run holding the missed cluster lasts. Without a window buffer,
+ * only the missed cluster is read into IOBuffer.
+ *
+ * @param FileSystem Owning file system.
+ * @param File Open file.
+ * @param RelativeCluster Missed cluster index in the file.
+ * @param Data Receives the data of the missed cluster.
+ * @return TRUE on success, FALSE on I/O error.
+ */
+static BOOL ReadFileClusters(LPFAT32FILESYSTEM FileSystem, LPFATFILE File, U32 RelativeCluster, U8** Data) {
+    U32 ClusterCount = (File->Header.SizeLow + FileSystem->BytesPerCluster - 1) / FileSystem->BytesPerCluster;
+    U32 UnitsLeft = (RelativeCluster < ClusterCount) ? ClusterCount - RelativeCluster : 1;
+    CLUSTER Cluster;
+    U32 RunLeft;
+    U32 Wanted;
+    U32 Count;
+    U8* Buffer = NULL;
+
+    Wanted = ReadAheadPrepare(&(File->ReadAhead), RelativeCluster, UnitsLeft, &Buffer);
+
+    Cluster = FindFileCluster(FileSystem, File, RelativeCluster, Wanted, &RunLeft);
+    if (Cluster == 0) return FALSE;
+
+    if (Wanted == 0) {
+        if (ReadCluster(FileSystem, Cluster, FileSystem->IOBuffer) == FALSE) return FALSE;
+
+        *Data = FileSystem->IOBuffer;
+        return TRUE;
+    }
+
+    Count = (RunLeft < Wanted) ? RunLeft : Wanted;
+
+    if (ReadClusters(FileSystem, Cluster, Count, Buffer) == FALSE) return FALSE;
+
+    ReadAheadCommit(&(File->ReadAhead), RelativeCluster, Count);
+
+    *Data = Buffer;
+    return TRUE;
+}
+
+/***************************************************************************/
+
 /**
  * @brief Read data from a file.
  * @param File File handle with read parameters.
@@ -686,11 +879,10 @@ static U32 CloseFile(LPFATFILE File) {
 static U32 ReadFile(LPFATFILE File) {
     LPFAT32FILESYSTEM FileSystem;
     CLUSTER RelativeCluster;
-    CLUSTER Cluster;
     U32 OffsetInCluster;
     U32 BytesRemaining;
     U32 ByteCount;
-    U32 Index;
+    U8* Data;
 
     //-------------------------------------
     // Check validity of parameters
@@ -712,21 +904,23 @@ static U32 ReadFile(LPFATFILE File) {
     BytesRemaining = File->Header.ByteCount;
     File->Header.BytesTransferred = 0;
 
-    Cluster = File->Location.DataCluster;
-
-    for (Index = 0; Index < RelativeCluster; Index++) {
-        Cluster = GetNextClusterInChain(FileSystem, Cluster);
-        if (Cluster == 0 || Cluster >= FAT32_CLUSTER_RESERVED) {
-            return DF_RETURN_INPUT_OUTPUT;
-        }
-    }
+    ReadAheadValidate(&(File->ReadAhead), FileSystem->WriteGeneration);
 
     FOREVER {
         //-------------------------------------
-        // Read the current data cluster
+        // Get the current data cluster, from the readahead window if possible
 
-        if (ReadCluster(FileSystem, Cluster, FileSystem->IOBuffer) == FALSE) {
-            return DF_RETURN_INPUT_OUTPUT;
+        Data = ReadAheadFind(&(File->ReadAhead), RelativeCluster);
+
+        if (Data == NULL) {
+            if (MapFileClusters(FileSystem, File, RelativeCluster) == FALSE) {
+                if (File->Header.BytesTransferred == 0) return DF_RETURN_INPUT_OUTPUT;
+                break;
+            }
+
+            if (ReadFileClusters(FileSystem, File, RelativeCluster, &Data) == FALSE) {
+                return DF_RETURN_INPUT_OUTPUT;
+            }
         }
 
         ByteCount = FileSystem->BytesPerCluster - OffsetInCluster;
@@ -735,8 +929,7 @@ static U32 ReadFile(LPFATFILE File) {
         //-------------------------------------
         // Copy the data to the user buffer
 
-        MemoryCopy(
-            ((U8*)File->Header.Buffer) + File->Header.BytesTransferred, FileSystem->IOBuffer + OffsetInCluster, ByteCount);
+        MemoryCopy(((U8*)File->Header.Buffer) + File->Header.BytesTransferred, Data + OffsetInCluster, ByteCount);
 
         //-------------------------------------
         // Update counters
@@ -751,14 +944,7 @@ static U32 ReadFile(LPFATFILE File) {
 
         if (BytesRemaining == 0) break;
 
-        //-------------------------------------
-        // Get the next cluster in the chain
-
-        Cluster = GetNextClusterInChain(FileSystem, Cluster);
-
-        if (Cluster == 0 || Cluster >= FAT32_CLUSTER_RESERVED) {
-            break;
-        }
+        RelativeCluster++;
     }
 
     return DF_RETURN_SUCCESS;
@@ -801,15 +987,33 @@ static U32 WriteFile(LPFATFILE File) {
     ByteCount = FileSystem->BytesPerCluster - OffsetInCluster;
     BytesRemaining = File->Header.ByteCount;
     File->Header.BytesTransferred = 0;
+    FileSystem->WriteGeneration++;
 
     if (ByteCount > BytesRemaining) {
         ByteCount = BytesRemaining;
     }
 
-    Cluster = File->Location.DataCluster;
+    //-------------------------------------
+    // Seek through the run list, then grow the chain if the file is shorter
+
+    Cluster = FindFileCluster(FileSystem, File, RelativeCluster, 1, NULL);
+    Index = RelativeCluster;
+
+    if (Cluster == 0) {
+        Cluster = File->Location.DataCluster;
+        Index = 0;
+
+        if (File->RunCount != 0) {
+            LPFAT32_CLUSTER_RUN Run = &(File->Runs[File->RunCount - 1]);
+
+            Index = Run->Relative + Run->Length - 1;
+            Cluster = Run->Cluster + Run->Length - 1;
+        }
+    }
+
     LastValidCluster = Cluster;
 
-    for (Index = 0; Index < RelativeCluster; Index++) {
+    for (; Index < RelativeCluster; Index++) {
         Cluster = GetNextClusterInChain(FileSystem, Cluster);
 
         if (Cluster == 0 || Cluster >= FAT32_CLUSTER_RESERVED) {
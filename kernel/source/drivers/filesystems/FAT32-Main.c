@@ -101,6 +101,11 @@ LPFATFILE NewFATFile(LPFAT32FILESYSTEM FileSystem, LPFATFILELOC FileLoc) {
     This->DirectoryBufferCluster = 0;
     This->DirectoryBufferGeneration = 0;
     This->DirectoryBufferValid = FALSE;
+    This->Runs = NULL;
+    This->RunCount = 0;
+    This->RunCapacity = 0;
+
+    ReadAheadInit(&(This->ReadAhead), FileSystem->BytesPerCluster);
 
     InitMutex(&(This->Header.Mutex));
     InitSecurity(&(This->Header.Security));
@@ -175,6 +180,11 @@ BOOL MountPartition_FAT32(LPSTORAGE_UNIT Disk, LPBOOT_PARTITION Partition, U32 B
 
     FileSystem->DataStart = FileSystem->FATStart + (FileSystem->Master.NumFATs * FileSystem->Master.NumSectorsPerFAT);
 
+    //-------------------------------------
+    // Cache the FAT and build the free cluster bitmap
+
+    FAT32TableInit(FileSystem);
+
     //-------------------------------------
     // Update global information and register the file system
 
@@ -206,14 +216,16 @@ U32 GetNameChecksum(LPSTR Name) {
 /***************************************************************************/
 
 /**
- * @brief Submit one FAT32 cluster transfer.
+ * @brief Submit one transfer of consecutive FAT32 clusters.
  * @param FileSystem Target file system.
- * @param Cluster Cluster number to transfer.
+ * @param Cluster First cluster number to transfer.
+ * @param Count Number of consecutive clusters.
  * @param Buffer Transfer buffer.
  * @param Command Disk command to execute.
  * @return TRUE on success, FALSE on failure.
  */
-static BOOL FAT32TransferCluster(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster, LPVOID Buffer, UINT Command) {
+static BOOL FAT32TransferClusters(
+    LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster, U32 Count, LPVOID Buffer, UINT Command) {
     SECTOR Sector;
 
     Sector =
@@ -223,9 +235,9 @@ static BOOL FAT32TransferCluster(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster,
                                  FileSystem->PartitionStart,
                                  FileSystem->PartitionSize,
                                  Sector,
-                                 FileSystem->Master.SectorsPerCluster,
+                                 FileSystem->Master.SectorsPerCluster * Count,
                                  Buffer,
-                                 FileSystem->Master.SectorsPerCluster * SECTOR_SIZE,
+                                 FileSystem->Master.SectorsPerCluster * Count * SECTOR_SIZE,
                                  Command) == FALSE) {
         return FALSE;
     }
@@ -245,7 +257,21 @@ static BOOL FAT32TransferCluster(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster,
  * @return TRUE on success, FALSE on failure.
  */
 BOOL ReadCluster(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster, LPVOID Buffer) {
-    return FAT32TransferCluster(FileSystem, Cluster, Buffer, DF_DISK_READ);
+    return FAT32TransferClusters(FileSystem, Cluster, 1, Buffer, DF_DISK_READ);
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Read consecutive clusters from disk with one request.
+ * @param FileSystem Target file system.
+ * @param Cluster First cluster number to read.
+ * @param Count Number of consecutive clusters.
+ * @param Buffer Destination buffer of Count clusters.
+ * @return TRUE on success, FALSE on failure.
+ */
+BOOL ReadClusters(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster, U32 Count, LPVOID Buffer) {
+    return FAT32TransferClusters(FileSystem, Cluster, Count, Buffer, DF_DISK_READ);
 }
 
 /***************************************************************************/
@@ -258,7 +284,7 @@ BOOL ReadCluster(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster, LPVOID Buffer) {
  * @return TRUE on success, FALSE on failure.
  */
 BOOL WriteCluster(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster, LPVOID Buffer) {
-    return FAT32TransferCluster(FileSystem, Cluster, Buffer, DF_DISK_WRITE);
+    return FAT32TransferClusters(FileSystem, Cluster, 1, Buffer, DF_DISK_WRITE);
 }
 
 /***************************************************************************/
@@ -267,35 +293,13 @@ BOOL WriteCluster(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster, LPVOID Buffer)
  * @brief Retrieve the next cluster in a FAT chain.
  * @param FileSystem Target file system.
  * @param Cluster Current cluster in chain.
- * @return Next cluster number or 0 on failure.
+ * @return Next cluster number, FAT32_CLUSTER_LAST on failure.
  */
 CLUSTER GetNextClusterInChain(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster) {
-    U32 Buffer[SECTOR_SIZE / sizeof(U32)];
-    IOCONTROL Control;
-    CLUSTER NextCluster;
-    U32 NumEntriesPerSector;
-    U32 Sector;
-    U32 Offset;
-    U32 Result;
-
-    NextCluster = FAT32_CLUSTER_LAST;
-
-    NumEntriesPerSector = SECTOR_SIZE / sizeof(U32);
-    Sector = Cluster / NumEntriesPerSector;
-    Offset = Cluster % NumEntriesPerSector;
-
-    Control.TypeID = KOID_IOCONTROL;
-    Control.Disk = FileSystem->Disk;
-    Control.SectorLow = FileSystem->FATStart + Sector;
-    Control.SectorHigh = 0;
-    Control.NumSectors = 1;
-    Control.Buffer = Buffer;
-    Control.BufferSize = SECTOR_SIZE;
-
-    Result = FileSystem->Disk->Driver->Command(DF_DISK_READ, (UINT)&Control);
+    U32 NextCluster;
 
-    if (Result == DF_RETURN_SUCCESS) {
-        NextCluster = Buffer[Offset];
+    if (FAT32ReadEntry(FileSystem, Cluster, &NextCluster) == FALSE) {
+        return FAT32_CLUSTER_LAST;
     }
 
     return NextCluster;
@@ -304,103 +308,12 @@ CLUSTER GetNextClusterInChain(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster) {
 /***************************************************************************/
 
 /**
- * @brief Search the FAT for a free cluster.
+ * @brief Search the FAT for a free cluster and mark it used.
  * @param FileSystem Target file system.
  * @return Cluster number or 0 if none available.
  */
 static CLUSTER FindFreeCluster(LPFAT32FILESYSTEM FileSystem) {
-    U32 Buffer[SECTOR_SIZE / sizeof(U32)];
-    IOCONTROL Control;
-    CLUSTER NewCluster;
-    U32 NumEntriesPerSector;
-    U32 CurrentSector;
-    U32 Index;
-    U32 Result;
-
-
-    //-------------------------------------
-    // Setup variables
-
-    Control.TypeID = KOID_IOCONTROL;
-    Control.Disk = FileSystem->Disk;
-    Control.Buffer = Buffer;
-    Control.BufferSize = SECTOR_SIZE;
-    NumEntriesPerSector = SECTOR_SIZE / sizeof(U32);
-    CurrentSector = 0;
-
-
-    FOREVER {
-        Control.SectorLow = FileSystem->FATStart + CurrentSector;
-        Control.SectorHigh = 0;
-        Control.NumSectors = 1;
-
-        Result = FileSystem->Disk->Driver->Command(DF_DISK_READ, (UINT)&Control);
-        if (Result != DF_RETURN_SUCCESS) {
-            goto Out;
-        }
-
-        for (Index = 0; Index < NumEntriesPerSector; Index++) {
-            if (Buffer[Index] == FAT32_CLUSTER_AVAIL) {
-                //-------------------------------------
-                // Mark the cluster as used
-
-                Buffer[Index] = FAT32_CLUSTER_LAST;
-
-                //-------------------------------------
-                // Write the FAT sector
-
-                Control.SectorLow = FileSystem->FATStart + CurrentSector;
-                Control.SectorHigh = 0;
-                Control.NumSectors = 1;
-                Result = FileSystem->Disk->Driver->Command(DF_DISK_WRITE, (UINT)&Control);
-                if (Result != DF_RETURN_SUCCESS) {
-                    goto Out;
-                }
-
-                NewCluster = (CurrentSector * NumEntriesPerSector) + Index;
-
-                if (FileSystem->Master.NumFATs > 1) {
-                    //-------------------------------------
-                    // Read the FAT sector
-
-                    Control.SectorLow = FileSystem->FATStart2 + CurrentSector;
-                    Control.SectorHigh = 0;
-                    Control.NumSectors = 1;
-                    Result = FileSystem->Disk->Driver->Command(DF_DISK_READ, (UINT)&Control);
-                    if (Result != DF_RETURN_SUCCESS) {
-                        goto Out;
-                    }
-
-                    //-------------------------------------
-                    // Mark the cluster as used
-
-                    Buffer[Index] = FAT32_CLUSTER_LAST;
-
-                    //-------------------------------------
-                    // Write the FAT sector
-
-                    Control.SectorLow = FileSystem->FATStart2 + CurrentSector;
-                    Control.SectorHigh = 0;
-                    Control.NumSectors = 1;
-                    Result = FileSystem->Disk->Driver->Command(DF_DISK_WRITE, (UINT)&Control);
-                    if (Result != DF_RETURN_SUCCESS) {
-                        goto Out;
-                    }
-                }
-
-                return NewCluster;
-            }
-        }
-
-        CurrentSector++;
-        if (CurrentSector >= FileSystem->Master.NumSectorsPerFAT) {
-            break;
-        }
-    }
-
-Out:
-
-    return 0;
+    return FAT32AllocateCluster(FileSystem);
 }
 
 /***************************************************************************/
@@ -740,74 +653,14 @@ BOOL CreateDirEntry(LPFAT32FILESYSTEM FileSystem, CLUSTER FolderCluster, LPSTR N
  * @return Number of new cluster or 0 on failure.
  */
 CLUSTER ChainNewCluster(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster) {
-    U32 Buffer[SECTOR_SIZE / sizeof(U32)];
-    IOCONTROL Control;
-    U32 Result;
-    U32 NumEntriesPerSector;
-    U32 CurrentSector;
-    U32 CurrentOffset;
-    U32 CurrentFAT;
-    U32 FATStart;
     CLUSTER NewCluster;
 
-    NumEntriesPerSector = SECTOR_SIZE / sizeof(U32);
-    CurrentSector = 0;
-    NewCluster = 0;
-    Control.TypeID = KOID_IOCONTROL;
-    Control.Disk = FileSystem->Disk;
-    Control.Buffer = Buffer;
-    Control.BufferSize = SECTOR_SIZE;
-
-    FOREVER {
-        Control.SectorLow = FileSystem->FATStart + CurrentSector;
-        Control.SectorHigh = 0;
-        Control.NumSectors = 1;
-
-        Result = FileSystem->Disk->Driver->Command(DF_DISK_READ, (UINT)&Control);
-
-        if (Result != DF_RETURN_SUCCESS) {
-            return NewCluster;
-        }
-
-        for (CurrentOffset = 0; CurrentOffset < NumEntriesPerSector; CurrentOffset++) {
-            if (Buffer[CurrentOffset] == 0) goto Next;
-        }
-
-        CurrentSector++;
-
-        if (CurrentSector >= FileSystem->Master.NumSectorsPerFAT) break;
-    }
-
-    return NewCluster;
-
-Next:
-
-    NewCluster = (CurrentSector * NumEntriesPerSector) + CurrentOffset;
-    CurrentSector = Cluster / NumEntriesPerSector;
-    CurrentOffset = Cluster % NumEntriesPerSector;
-
-    FATStart = FileSystem->FATStart;
-
-    for (CurrentFAT = 0; CurrentFAT < FileSystem->Master.NumFATs; CurrentFAT++) {
-        Control.SectorLow = FATStart + CurrentSector;
-        Control.SectorHigh = 0;
-        Control.NumSectors = 1;
-
-        Result = FileSystem->Disk->Driver->Command(DF_DISK_READ, (UINT)&Control);
-
-        if (Result != DF_RETURN_SUCCESS) {
-            return NewCluster;
-        }
-
-        Buffer[CurrentOffset] = NewCluster;
-
-        Result = FileSystem->Disk->Driver->Command(DF_DISK_WRITE, (UINT)&Control);
-
-        if (Result != DF_RETURN_SUCCESS) {
-            return NewCluster;
-        }
+    NewCluster = FAT32AllocateCluster(FileSystem);
+    if (NewCluster == 0) return 0;
 
-        FATStart += FileSystem->Master.NumSectorsPerFAT;
+    if (FAT32WriteEntry(FileSystem, Cluster, NewCluster) == FALSE) {
+        FAT32WriteEntry(FileSystem, NewCluster, FAT32_CLUSTER_AVAIL);
+        return 0;
     }
 
     return NewCluster;
@@ -0,0 +1,377 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    FAT32 - Allocation table cache and free cluster bitmap
+
+\************************************************************************/
+
+#include "drivers/filesystems/FAT32-Private.h"
+#include "drivers/filesystems/FileSystem-Common.h"
+
+/***************************************************************************/
+
+#define FAT32_ENTRIES_PER_SECTOR (SECTOR_SIZE / sizeof(U32))
+#define FAT32_ENTRIES_PER_WINDOW (FAT32_TABLE_WINDOW_SECTORS * FAT32_ENTRIES_PER_SECTOR)
+
+/***************************************************************************/
+
+/**
+ * @brief Transfer sectors of one copy of the FAT.
+ * @param FileSystem Target file system.
+ * @param Copy Index of the FAT copy.
+ * @param Sector First sector, relative to the start of the copy.
+ * @param Count Number of sectors.
+ * @param Buffer Transfer buffer.
+ * @param Command DF_DISK_READ or DF_DISK_WRITE.
+ * @return TRUE on success, FALSE on failure.
+ */
+static BOOL FAT32TableTransfer(
+    LPFAT32FILESYSTEM FileSystem, U32 Copy, U32 Sector, U32 Count, LPVOID Buffer, UINT Command) {
+    SECTOR Start = FileSystem->FATStart + (Copy * FileSystem->Master.NumSectorsPerFAT) + Sector;
+
+    return PartitionTransferSectors(FileSystem->Disk,
+                                    FileSystem->PartitionStart,
+                                    FileSystem->PartitionSize,
+                                    Start,
+                                    Count,
+                                    Buffer,
+                                    Count * SECTOR_SIZE,
+                                    Command);
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Mark a cluster used or free in the bitmap.
+ * @param FileSystem Target file system.
+ * @param Cluster Cluster number.
+ * @param Used TRUE when the cluster is used.
+ */
+static void FAT32BitmapSet(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster, BOOL Used) {
+    U32 Mask;
+    U32* Word;
+
+    if (FileSystem->FreeBitmap == NULL || Cluster >= FileSystem->ClusterCount) return;
+
+    Word = &(FileSystem->FreeBitmap[Cluster / 32]);
+    Mask = 1u << (Cluster % 32);
+
+    if (Used) {
+        if ((*Word & Mask) == 0) {
+            *Word |= Mask;
+            FileSystem->FreeClusters--;
+        }
+    } else {
+        if (*Word & Mask) {
+            *Word &= ~Mask;
+            FileSystem->FreeClusters++;
+        }
+    }
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Return the cached window holding a FAT sector, loading it on a miss.
+ * @param FileSystem Target file system with a window array.
+ * @param Sector FAT sector, relative to FATStart.
+ * @return Window pointer or NULL on I/O error.
+ */
+static LPFAT32_TABLE_WINDOW FAT32GetWindow(LPFAT32FILESYSTEM FileSystem, U32 Sector) {
+    U32 FirstSector = Sector - (Sector % FAT32_TABLE_WINDOW_SECTORS);
+    U32 Slot = (Sector / FAT32_TABLE_WINDOW_SECTORS) % FAT32_TABLE_WINDOWS;
+    LPFAT32_TABLE_WINDOW Window = &(FileSystem->TableWindows[Slot]);
+    U32 Count;
+
+    if (Window->FirstSector == FirstSector) return Window;
+
+    Count = FileSystem->Master.NumSectorsPerFAT - FirstSector;
+    if (Count > FAT32_TABLE_WINDOW_SECTORS) Count = FAT32_TABLE_WINDOW_SECTORS;
+
+    Window->FirstSector = FAT32_TABLE_NO_WINDOW;
+
+    if (FAT32TableTransfer(FileSystem, 0, FirstSector, Count, Window->Entries, DF_DISK_READ) == FALSE) {
+        return NULL;
+    }
+
+    Window->FirstSector = FirstSector;
+
+    return Window;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Build the free cluster bitmap from the first FAT.
+ *
+ * The FAT is read FAT32_TABLE_SCAN_SECTORS at a time. When memory is short
+ * or a read fails, the bitmap is left out and allocation scans the FAT.
+ *
+ * @param FileSystem Target file system.
+ */
+static void FAT32BuildFreeBitmap(LPFAT32FILESYSTEM FileSystem) {
+    U32 BitmapBytes = ((FileSystem->ClusterCount + 31) / 32) * sizeof(U32);
+    U32* Buffer;
+    U32 Sector;
+    U32 Count;
+    U32 Index;
+    CLUSTER Cluster;
+
+    FileSystem->FreeBitmap = (U32*)KernelHeapAlloc(BitmapBytes);
+    if (FileSystem->FreeBitmap == NULL) return;
+
+    Buffer = (U32*)KernelHeapAlloc(FAT32_TABLE_SCAN_SECTORS * SECTOR_SIZE);
+    if (Buffer == NULL) {
+        KernelHeapFree(FileSystem->FreeBitmap);
+        FileSystem->FreeBitmap = NULL;
+        return;
+    }
+
+    MemorySet(FileSystem->FreeBitmap, 0, BitmapBytes);
+    FileSystem->FreeClusters = 0;
+    Cluster = 0;
+
+    for (Sector = 0; Cluster < FileSystem->ClusterCount; Sector += Count) {
+        Count = FileSystem->Master.NumSectorsPerFAT - Sector;
+        if (Count > FAT32_TABLE_SCAN_SECTORS) Count = FAT32_TABLE_SCAN_SECTORS;
+
+        if (FAT32TableTransfer(FileSystem, 0, Sector, Count, Buffer, DF_DISK_READ) == FALSE) {
+            WARNING(TEXT("[FAT32BuildFreeBitmap] FAT read failed at sector %u"), Sector);
+            KernelHeapFree(FileSystem->FreeBitmap);
+            FileSystem->FreeBitmap = NULL;
+            break;
+        }
+
+        for (Index = 0; Index < Count * FAT32_ENTRIES_PER_SECTOR && Cluster < FileSystem->ClusterCount;
+             Index++, Cluster++) {
+            if (Cluster < 2 || (Buffer[Index] & 0x0FFFFFFF) != FAT32_CLUSTER_AVAIL) {
+                FileSystem->FreeBitmap[Cluster / 32] |= 1u << (Cluster % 32);
+            } else {
+                FileSystem->FreeClusters++;
+            }
+        }
+    }
+
+    KernelHeapFree(Buffer);
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Set up the FAT cache and the free cluster bitmap of a mounted FAT32.
+ * @param FileSystem File system whose geometry is known.
+ */
+void FAT32TableInit(LPFAT32FILESYSTEM FileSystem) {
+    U32 DataClusters = 0;
+    U32 Index;
+
+    InitMutex(&(FileSystem->TableMutex));
+
+    //-------------------------------------
+    // Count the entries that map data clusters
+
+    if (FileSystem->Master.SectorsPerCluster != 0 &&
+        FileSystem->PartitionStart + FileSystem->PartitionSize > FileSystem->DataStart) {
+        DataClusters = (FileSystem->PartitionStart + FileSystem->PartitionSize - FileSystem->DataStart) /
+                       FileSystem->Master.SectorsPerCluster;
+    }
+
+    FileSystem->ClusterCount = DataClusters + 2;
+
+    if (FileSystem->ClusterCount > FileSystem->Master.NumSectorsPerFAT * FAT32_ENTRIES_PER_SECTOR) {
+        FileSystem->ClusterCount = FileSystem->Master.NumSectorsPerFAT * FAT32_ENTRIES_PER_SECTOR;
+    }
+
+    FileSystem->NextFree = 2;
+
+    //-------------------------------------
+    // Allocate the windows
+
+    FileSystem->TableWindows = (LPFAT32_TABLE_WINDOW)KernelHeapAlloc(sizeof(FAT32_TABLE_WINDOW) * FAT32_TABLE_WINDOWS);
+
+    if (FileSystem->TableWindows != NULL) {
+        for (Index = 0; Index < FAT32_TABLE_WINDOWS; Index++) {
+            FileSystem->TableWindows[Index].FirstSector = FAT32_TABLE_NO_WINDOW;
+        }
+    } else {
+        WARNING(TEXT("[FAT32TableInit] No memory for the FAT cache"));
+    }
+
+    FAT32BuildFreeBitmap(FileSystem);
+
+    DEBUG(TEXT("[FAT32TableInit] %u clusters, %u free, bitmap %s"), FileSystem->ClusterCount, FileSystem->FreeClusters,
+        FileSystem->FreeBitmap ? TEXT("on") : TEXT("off"));
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Read one FAT entry.
+ * @param FileSystem Target file system.
+ * @param Cluster Cluster number.
+ * @param Value Receives the entry.
+ * @return TRUE on success, FALSE on I/O error or out of range cluster.
+ */
+BOOL FAT32ReadEntry(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster, U32* Value) {
+    U32 Buffer[FAT32_ENTRIES_PER_SECTOR];
+    U32 Sector = Cluster / FAT32_ENTRIES_PER_SECTOR;
+    LPFAT32_TABLE_WINDOW Window;
+    BOOL Success = FALSE;
+
+    if (Sector >= FileSystem->Master.NumSectorsPerFAT) return FALSE;
+
+    LockMutex(&(FileSystem->TableMutex), INFINITY);
+
+    if (FileSystem->TableWindows != NULL) {
+        Window = FAT32GetWindow(FileSystem, Sector);
+
+        if (Window != NULL) {
+            *Value = Window->Entries[Cluster % FAT32_ENTRIES_PER_WINDOW];
+            Success = TRUE;
+        }
+    } else if (FAT32TableTransfer(FileSystem, 0, Sector, 1, Buffer, DF_DISK_READ)) {
+        *Value = Buffer[Cluster % FAT32_ENTRIES_PER_SECTOR];
+        Success = TRUE;
+    }
+
+    UnlockMutex(&(FileSystem->TableMutex));
+
+    return Success;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Write one FAT entry to every copy of the FAT.
+ *
+ * The sector holding the entry is updated in the cache and written through,
+ * so the disk never lags behind the cache.
+ *
+ * @param FileSystem Target file system.
+ * @param Cluster Cluster number.
+ * @param Value New entry.
+ * @return TRUE on success, FALSE on I/O error or out of range cluster.
+ */
+BOOL FAT32WriteEntry(LPFAT32FILESYSTEM FileSystem, CLUSTER Cluster, U32 Value) {
+    U32 Buffer[FAT32_ENTRIES_PER_SECTOR];
+    U32 Sector = Cluster / FAT32_ENTRIES_PER_SECTOR;
+    LPFAT32_TABLE_WINDOW Window = NULL;
+    U32* Entries = Buffer;
+    BOOL Success = FALSE;
+    U32 Copy;
+
+    if (Sector >= FileSystem->Master.NumSectorsPerFAT) return FALSE;
+
+    LockMutex(&(FileSystem->TableMutex), INFINITY);
+
+    if (FileSystem->TableWindows != NULL) {
+        Window = FAT32GetWindow(FileSystem, Sector);
+        if (Window == NULL) goto Out;
+
+        Entries = Window->Entries + (Sector - Window->FirstSector) * FAT32_ENTRIES_PER_SECTOR;
+    } else if (FAT32TableTransfer(FileSystem, 0, Sector, 1, Buffer, DF_DISK_READ) == FALSE) {
+        goto Out;
+    }
+
+    Entries[Cluster % FAT32_ENTRIES_PER_SECTOR] = Value;
+
+    for (Copy = 0; Copy < FileSystem->Master.NumFATs; Copy++) {
+        if (FAT32TableTransfer(FileSystem, Copy, Sector, 1, Entries, DF_DISK_WRITE) == FALSE) {
+            if (Window != NULL) Window->FirstSector = FAT32_TABLE_NO_WINDOW;
+            goto Out;
+        }
+    }
+
+    FAT32BitmapSet(FileSystem, Cluster, Value != FAT32_CLUSTER_AVAIL);
+
+    if (Value == FAT32_CLUSTER_AVAIL && Cluster < FileSystem->NextFree) {
+        FileSystem->NextFree = Cluster;
+    }
+
+    Success = TRUE;
+
+Out:
+    UnlockMutex(&(FileSystem->TableMutex));
+
+    return Success;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Find a free cluster from the next-free hint and mark it as the end of a chain.
+ *
+ * The free bitmap is searched 32 clusters at a time. Without a bitmap, the
+ * FAT entries are read through the cache.
+ *
+ * @param FileSystem Target file system.
+ * @return Cluster number or 0 if none available.
+ */
+CLUSTER FAT32AllocateCluster(LPFAT32FILESYSTEM FileSystem) {
+    CLUSTER Cluster = 0;
+    CLUSTER Candidate;
+    U32 Scanned;
+    U32 Value;
+
+    if (FileSystem->ClusterCount <= 2) return 0;
+
+    LockMutex(&(FileSystem->TableMutex), INFINITY);
+
+    Candidate = FileSystem->NextFree;
+    if (Candidate < 2 || Candidate >= FileSystem->ClusterCount) Candidate = 2;
+
+    for (Scanned = 0; Scanned < FileSystem->ClusterCount - 2; Scanned++) {
+        if (FileSystem->FreeBitmap != NULL) {
+            U32 Word = FileSystem->FreeBitmap[Candidate / 32];
+
+            if (Word == 0xFFFFFFFF && (Candidate % 32) == 0) {
+                // Skip a fully used word at once
+                Scanned += 31;
+                Candidate += 32;
+                if (Candidate >= FileSystem->ClusterCount) Candidate = 2;
+                continue;
+            }
+
+            if ((Word & (1u << (Candidate % 32))) == 0) {
+                Cluster = Candidate;
+                break;
+            }
+        } else if (FAT32ReadEntry(FileSystem, Candidate, &Value) == FALSE) {
+            break;
+        } else if (Value == FAT32_CLUSTER_AVAIL) {
+            Cluster = Candidate;
+            break;
+        }
+
+        Candidate++;
+        if (Candidate >= FileSystem->ClusterCount) Candidate = 2;
+    }
+
+    if (Cluster != 0) {
+        if (FAT32WriteEntry(FileSystem, Cluster, FAT32_CLUSTER_LAST)) {
+            FileSystem->NextFree = Cluster + 1;
+        } else {
+            Cluster = 0;
+        }
+    }
+
+    UnlockMutex(&(FileSystem->TableMutex));
+
+    return Cluster;
+}
@@ -27,6 +27,7 @@
 /***************************************************************************/
 
 #include "drivers/filesystems/NTFS.h"
+#include "drivers/filesystems/ReadAhead.h"
 #include "text/CoreString.h"
 #include "core/Kernel.h"
 #include "log/Log.h"
@@ -106,6 +107,7 @@ typedef struct tag_NTFSFILE {
     U32 EnumerationIndex;
     U32 EnumerationCount;
     LPNTFS_FOLDER_ENTRY_INFO EnumerationEntries;
+    READ_AHEAD ReadAhead;
 } NTFSFILE, *LPNTFSFILE;
 
 /***************************************************************************/
@@ -919,6 +919,23 @@ BOOL NtfsReadNonResidentDataAttributeRange(
                 U32 Chunk = BytesPerSector - OffsetInSector;
                 if (Chunk > RemainingCopy) Chunk = RemainingCopy;
 
+                if (OffsetInSector == 0 && RemainingCopy >= BytesPerSector) {
+                    // Whole sectors of the run go to the destination with one request
+                    U32 SectorCount = RemainingCopy / BytesPerSector;
+
+                    Chunk = SectorCount * BytesPerSector;
+                    if (!NtfsReadSectors(
+                            FileSystem, StartSector, SectorCount, ((U8*)Buffer) + DestinationOffset, Chunk)) {
+                        KernelHeapFree(SectorBuffer);
+                        return FALSE;
+                    }
+
+                    DestinationOffset += Chunk;
+                    RemainingCopy -= Chunk;
+                    StartSector += SectorCount;
+                    continue;
+                }
+
                 if (!NtfsReadSectors(FileSystem, StartSector, 1, SectorBuffer, BytesPerSector)) {
                     KernelHeapFree(SectorBuffer);
                     return FALSE;
@@ -309,6 +309,8 @@ static LPNTFSFILE NtfsCreateFileHandle(LPFILESYSTEM FileSystem) {
     File->EnumerationCount = 0;
     File->EnumerationEntries = NULL;
 
+    ReadAheadInit(&(File->ReadAhead), ((LPNTFSFILESYSTEM)FileSystem)->BytesPerCluster);
+
     return File;
 }
 
@@ -453,15 +455,70 @@ U32 NtfsCloseFile(LPNTFSFILE File) {
         File->EnumerationEntries = NULL;
     }
 
+    ReadAheadDeinit(&(File->ReadAhead));
+
     ReleaseKernelObject(File);
     return DF_RETURN_SUCCESS;
 }
 
 /***************************************************************************/
 
+/**
+ * @brief Fill the readahead window of a file from a missed cluster.
+ *
+ * @param File Open NTFS file handle.
+ * @param Unit Missed cluster index in the file.
+ * @param FileSize64 File size in bytes.
+ * @param Data Receives the data of the missed cluster, NULL past the end of the stream.
+ * @return DF_RETURN_SUCCESS, DF_RETURN_NO_MEMORY without window buffer, or DF_RETURN_INPUT_OUTPUT.
+ */
+static U32 NtfsReadFileUnits(LPNTFSFILE File, U32 Unit, U64 FileSize64, U8** Data) {
+    U32 UnitSize = File->ReadAhead.UnitSize;
+    U64 UnitStart64 = U64_FromUINT((UINT)Unit * UnitSize);
+    U64 Left64 = U64_Sub(FileSize64, UnitStart64);
+    U32 UnitsLeft;
+    U32 Wanted;
+    U32 Count;
+    U32 BytesRead;
+    U8* Buffer = NULL;
+
+    *Data = NULL;
+
+    if (U64_High32(Left64) != 0) {
+        UnitsLeft = 0xFFFFFFFF;
+    } else {
+        UnitsLeft = (U64_Low32(Left64) / UnitSize) + ((U64_Low32(Left64) % UnitSize) != 0);
+    }
+
+    Wanted = ReadAheadPrepare(&(File->ReadAhead), Unit, UnitsLeft, &Buffer);
+    if (Wanted == 0) return DF_RETURN_NO_MEMORY;
+
+    if (!NtfsReadFileDataRangeByIndex(
+            File->Header.FileSystem, File->FileRecordIndex, UnitStart64, Buffer, Wanted * UnitSize, &BytesRead)) {
+        return DF_RETURN_INPUT_OUTPUT;
+    }
+
+    if (BytesRead == 0) return DF_RETURN_SUCCESS;
+
+    // Never expose stale bytes after the end of the stream
+    Count = (BytesRead + UnitSize - 1) / UnitSize;
+    MemorySet(Buffer + BytesRead, 0, (Count * UnitSize) - BytesRead);
+
+    ReadAheadCommit(&(File->ReadAhead), Unit, Count);
+
+    *Data = Buffer;
+    return DF_RETURN_SUCCESS;
+}
+
+/***************************************************************************/
+
 /**
  * @brief Read from an NTFS file handle.
  *
+ * Small reads go through the readahead window of the handle, so that a
+ * sequential reader does not parse the file record again for every call.
+ * Reads of at least READ_AHEAD_MAX_BYTES go straight to the caller buffer.
+ *
  * @param File Open NTFS file handle.
  * @return DF_RETURN_SUCCESS on success or an error status.
  */
@@ -471,6 +528,8 @@ U32 NtfsReadFile(LPNTFSFILE File) {
     U64 Remaining64;
     U32 ReadSize;
     U32 BytesRead;
+    U32 UnitSize;
+    BOOL UseWindow;
 
     if (File == NULL) return DF_RETURN_BAD_PARAMETER;
     if (File->Header.TypeID != KOID_FILE) return DF_RETURN_BAD_PARAMETER;
@@ -506,18 +565,60 @@ U32 NtfsReadFile(LPNTFSFILE File) {
         return DF_RETURN_SUCCESS;
     }
 
-    if (!NtfsReadFileDataRangeByIndex(
-            File->Header.FileSystem,
-            File->FileRecordIndex,
-            Position64,
-            File->Header.Buffer,
-            ReadSize,
-            &BytesRead)) {
-        return DF_RETURN_INPUT_OUTPUT;
+    UnitSize = File->ReadAhead.UnitSize;
+    UseWindow = (ReadSize < READ_AHEAD_MAX_BYTES && UnitSize != 0);
+
+    while (UseWindow && File->Header.BytesTransferred < ReadSize) {
+        U32 Unit = (U32)(File->Header.Position / UnitSize);
+        U32 OffsetInUnit = (U32)(File->Header.Position % UnitSize);
+        U32 Chunk;
+        U8* Data;
+
+        Data = ReadAheadFind(&(File->ReadAhead), Unit);
+
+        if (Data == NULL) {
+            U32 Result = NtfsReadFileUnits(File, Unit, FileSize64, &Data);
+
+            if (Result == DF_RETURN_NO_MEMORY) {
+                UseWindow = FALSE;
+                break;
+            }
+
+            if (Result != DF_RETURN_SUCCESS) return Result;
+            if (Data == NULL) return DF_RETURN_SUCCESS;
+        }
+
+        Chunk = UnitSize - OffsetInUnit;
+        if (Chunk > ReadSize - File->Header.BytesTransferred) {
+            Chunk = ReadSize - File->Header.BytesTransferred;
+        }
+
+        MemoryCopy(((U8*)File->Header.Buffer) + File->Header.BytesTransferred, Data + OffsetInUnit, Chunk);
+
+        File->Header.BytesTransferred += Chunk;
+        File->Header.Position += Chunk;
     }
 
-    File->Header.BytesTransferred = BytesRead;
-    File->Header.Position += File->Header.BytesTransferred;
+    if (UseWindow == FALSE) {
+        // Large request or no window: read straight into the caller buffer
+#ifdef __EXOS_64__
+        Position64 = U64_FromUINT(File->Header.Position);
+#else
+        Position64 = U64_FromU32(File->Header.Position);
+#endif
+        if (!NtfsReadFileDataRangeByIndex(
+                File->Header.FileSystem,
+                File->FileRecordIndex,
+                Position64,
+                ((U8*)File->Header.Buffer) + File->Header.BytesTransferred,
+                ReadSize - File->Header.BytesTransferred,
+                &BytesRead)) {
+            return DF_RETURN_INPUT_OUTPUT;
+        }
+
+        File->Header.BytesTransferred += BytesRead;
+        File->Header.Position += BytesRead;
+    }
 
     return DF_RETURN_SUCCESS;
 }
@@ -0,0 +1,173 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    File readahead
+
+\************************************************************************/
+
+#include "drivers/filesystems/ReadAhead.h"
+#include "memory/Heap.h"
+#include "text/CoreString.h"
+
+/***************************************************************************/
+
+/**
+ * @brief Initialize the readahead state of a file.
+ *
+ * @param ReadAhead State to initialize.
+ * @param UnitSize Block or cluster size in bytes.
+ */
+void ReadAheadInit(LPREAD_AHEAD ReadAhead, U32 UnitSize) {
+    if (ReadAhead == NULL) return;
+
+    MemorySet(ReadAhead, 0, sizeof(READ_AHEAD));
+
+    if (UnitSize == 0) return;
+
+    ReadAhead->UnitSize = UnitSize;
+    ReadAhead->MaxUnits = READ_AHEAD_MAX_BYTES / UnitSize;
+    ReadAhead->MinUnits = READ_AHEAD_MIN_BYTES / UnitSize;
+
+    if (ReadAhead->MaxUnits == 0) ReadAhead->MaxUnits = 1;
+    if (ReadAhead->MinUnits == 0) ReadAhead->MinUnits = 1;
+
+    ReadAhead->Window = ReadAhead->MinUnits;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Release the window buffer of a file.
+ *
+ * @param ReadAhead State to release.
+ */
+void ReadAheadDeinit(LPREAD_AHEAD ReadAhead) {
+    if (ReadAhead == NULL) return;
+
+    if (ReadAhead->Buffer != NULL) {
+        KernelHeapFree(ReadAhead->Buffer);
+    }
+
+    ReadAhead->Buffer = NULL;
+    ReadAhead->Capacity = 0;
+    ReadAhead->Count = 0;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Drop the buffered units when the filesystem was written since they were read.
+ *
+ * @param ReadAhead File state.
+ * @param Generation Current write generation of the filesystem.
+ */
+void ReadAheadValidate(LPREAD_AHEAD ReadAhead, U32 Generation) {
+    if (ReadAhead == NULL) return;
+
+    if (ReadAhead->Generation != Generation) {
+        ReadAhead->Count = 0;
+        ReadAhead->Generation = Generation;
+    }
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Look for a unit in the window buffer.
+ *
+ * @param ReadAhead File state.
+ * @param Unit Unit index in the file.
+ * @return Unit data, or NULL when the unit is not buffered.
+ */
+U8* ReadAheadFind(LPREAD_AHEAD ReadAhead, U32 Unit) {
+    if (ReadAhead == NULL || ReadAhead->Count == 0) return NULL;
+    if (Unit < ReadAhead->First || Unit - ReadAhead->First >= ReadAhead->Count) return NULL;
+
+    ReadAhead->NextUnit = Unit + 1;
+
+    return ReadAhead->Buffer + ((Unit - ReadAhead->First) * ReadAhead->UnitSize);
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Get the buffer and the number of units to fetch for a missed unit.
+ *
+ * @param ReadAhead File state.
+ * @param Unit Missed unit.
+ * @param UnitsLeft Units from Unit to the end of the file, at least 1.
+ * @param Buffer Receives the buffer to fill, starting with Unit.
+ * @return Units to fetch, 0 when no buffer can be allocated.
+ */
+U32 ReadAheadPrepare(LPREAD_AHEAD ReadAhead, U32 Unit, U32 UnitsLeft, U8** Buffer) {
+    U32 Count;
+
+    if (ReadAhead == NULL || Buffer == NULL || ReadAhead->UnitSize == 0) return 0;
+
+    if (Unit == ReadAhead->NextUnit) {
+        Count = ReadAhead->Window;
+
+        ReadAhead->Window *= 2;
+        if (ReadAhead->Window > ReadAhead->MaxUnits) ReadAhead->Window = ReadAhead->MaxUnits;
+    } else {
+        Count = 1;
+        ReadAhead->Window = ReadAhead->MinUnits;
+    }
+
+    if (UnitsLeft == 0) UnitsLeft = 1;
+    if (Count > UnitsLeft) Count = UnitsLeft;
+
+    ReadAhead->Count = 0;
+
+    if (Count > ReadAhead->Capacity) {
+        // Allocate the full window once, the stream is likely to need it
+        U32 Capacity = (Count > ReadAhead->MinUnits) ? ReadAhead->MaxUnits : ReadAhead->MinUnits;
+        U8* NewBuffer = (U8*)KernelHeapAlloc(Capacity * ReadAhead->UnitSize);
+
+        if (NewBuffer == NULL) return 0;
+
+        if (ReadAhead->Buffer != NULL) KernelHeapFree(ReadAhead->Buffer);
+
+        ReadAhead->Buffer = NewBuffer;
+        ReadAhead->Capacity = Capacity;
+    }
+
+    *Buffer = ReadAhead->Buffer;
+
+    return Count;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Mark the units fetched after ReadAheadPrepare as valid.
+ *
+ * @param ReadAhead File state.
+ * @param Unit First fetched unit.
+ * @param Count Units actually fetched, may be less than requested.
+ */
+void ReadAheadCommit(LPREAD_AHEAD ReadAhead, U32 Unit, U32 Count) {
+    if (ReadAhead == NULL) return;
+
+    if (Count > ReadAhead->Capacity) Count = ReadAhead->Capacity;
+
+    ReadAhead->First = Unit;
+    ReadAhead->Count = Count;
+    ReadAhead->NextUnit = Unit + 1;
+}
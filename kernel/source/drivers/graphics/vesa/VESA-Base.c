@@ -605,9 +605,9 @@ static U32 SetVideoMode(LPGRAPHICS_MODE_INFO Info) {
     }
 
     VESAContext.FrameBufferPhysical = (PHYSICAL)VESAContext.ModeInfo.PhysBasePtr;
-    LinearBase = MapIOMemory(VESAContext.FrameBufferPhysical, FrameBufferSize);
+    LinearBase = MapFramebufferMemory(VESAContext.FrameBufferPhysical, FrameBufferSize);
     if (LinearBase == 0) {
-        ERROR(TEXT("[SetVideoMode] MapIOMemory failed for LFB base %p size %u"),
+        ERROR(TEXT("[SetVideoMode] MapFramebufferMemory failed for LFB base %p size %u"),
             (LPVOID)(LINEAR)VESAContext.FrameBufferPhysical, FrameBufferSize);
         VESAContext.FrameBufferPhysical = 0;
         return DF_RETURN_GENERIC;
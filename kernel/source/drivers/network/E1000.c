@@ -118,6 +118,9 @@
 #define E1000_ReadReg32(Base, Off) (*(volatile U32 *)((U8 *)(Base) + (Off)))
 #define E1000_WriteReg32(Base, Off, Val) (*(volatile U32 *)((U8 *)(Base) + (Off)) = (U32)(Val))
 
+// Keeps descriptor stores before the doorbell and status loads fresh
+#define E1000_DescriptorBarrier() __asm__ __volatile__("" ::: "memory")
+
 typedef struct tag_E1000DEVICE E1000DEVICE, *LPE1000DEVICE;
 
 #pragma pack(push, 1)
@@ -141,8 +144,12 @@ struct tag_E1000DEVICE {
     // TX ring
     DMA_BUFFER TxRingBuffer;
     U32 TxRingCount;
-    U32 TxHead;
-    U32 TxTail;
+    U32 TxHead;     // Oldest descriptor not reclaimed yet
+    U32 TxTail;     // Next descriptor to fill
+
+    // Checksum-only context last written to the ring
+    NETWORK_OFFLOAD TxContext;
+    BOOL TxContextValid;
 
     // Pooled DMA areas (one big allocation each)
     DMA_BUFFER RxBufferPool;
@@ -172,6 +179,7 @@ static BOOL E1000_InterruptTopHalf(LPDEVICE Device, LPVOID Context);
 static void E1000_DeferredRoutine(LPDEVICE Device, LPVOID Context);
 static void E1000_PollRoutine(LPDEVICE Device, LPVOID Context);
 static U32 E1000_ReceivePoll(LPE1000DEVICE Device);
+static U32 E1000_TransmitReclaim(LPE1000DEVICE Device);
 static void E1000_ReleaseDMAResources(LPE1000DEVICE Device);
 
 /************************************************************************/
@@ -399,7 +407,7 @@ static BOOL E1000_SetupReceive(LPE1000DEVICE Device) {
     if (!DMABufferAllocate(
             &Device->RxRingBuffer,
             Device->RxRingCount * sizeof(E1000_RXDESC),
-            FALSE,
+            TRUE,
             TEXT("E1000RxRing"))) {
         ERROR(TEXT("[E1000_SetupReceive] RX ring allocation failed"));
         return FALSE;
@@ -473,6 +481,9 @@ static BOOL E1000_SetupReceive(LPE1000DEVICE Device) {
                (E1000_TCTL_COLD_DEFAULT << E1000_TCTL_COLD_SHIFT);
     E1000_WriteReg32(Device->MmioBase, E1000_REG_TCTL, Tctl);
 
+    // Let the hardware validate IPv4 and TCP/UDP checksums
+    E1000_WriteReg32(Device->MmioBase, E1000_REG_RXCSUM, E1000_RXCSUM_IPOFL | E1000_RXCSUM_TUOFL);
+
     {
         // Force promiscuous mode to capture all packets
         U32 Rctl = E1000_RCTL_EN | E1000_RCTL_BAM | E1000_RCTL_UPE | E1000_RCTL_MPE | E1000_RCTL_BSIZE_2048 | E1000_RCTL_SECRC;
@@ -522,7 +533,7 @@ static BOOL E1000_SetupTransmit(LPE1000DEVICE Device) {
     if (!DMABufferAllocate(
             &Device->TxRingBuffer,
             Device->TxRingCount * sizeof(E1000_TXDESC),
-            FALSE,
+            TRUE,
             TEXT("E1000TxRing"))) {
         ERROR(TEXT("[E1000_SetupTransmit] TX ring allocation failed"));
         return FALSE;
@@ -576,6 +587,7 @@ static BOOL E1000_SetupTransmit(LPE1000DEVICE Device) {
     // Initialize head and tail pointers
     Device->TxHead = 0;
     Device->TxTail = 0;
+    Device->TxContextValid = FALSE;
     E1000_WriteReg32(Device->MmioBase, E1000_REG_TDH, Device->TxHead);
     E1000_WriteReg32(Device->MmioBase, E1000_REG_TDT, Device->TxTail);
 
@@ -898,6 +910,11 @@ static void E1000_DeferredRoutine(LPDEVICE DevicePointer, LPVOID Context) {
     SAFE_USE_VALID_ID(Device, KOID_PCIDEVICE) {
         E1000_ReceivePoll(Device);
 
+        // Senders reclaim under the same mutex when the ring fills up
+        LockMutex(&(Device->Mutex), INFINITY);
+        E1000_TransmitReclaim(Device);
+        UnlockMutex(&(Device->Mutex));
+
         LPNETWORK_DEVICE_CONTEXT NetContext = (LPNETWORK_DEVICE_CONTEXT)Device->RxUserData;
         SAFE_USE_VALID_ID(NetContext, KOID_NETWORKDEVICE) {
             NetworkManager_MaintenanceTick(NetContext);
@@ -921,47 +938,345 @@ static void E1000_PollRoutine(LPDEVICE DevicePointer, LPVOID Context) {
 // Receive/Transmit operations
 
 /**
- * @brief Send a frame using the transmit ring.
+ * @brief Reclaim the transmit descriptors the hardware has finished with.
+ *
+ * Walks from TxHead toward TxTail and stops at the first descriptor whose
+ * DD bit is still clear. Callers hold the device mutex.
+ *
+ * @param Device Target E1000 device.
+ * @return Number of descriptors reclaimed.
+ */
+static U32 E1000_TransmitReclaim(LPE1000DEVICE Device) {
+    LPE1000_TXDESC Ring = (LPE1000_TXDESC)Device->TxRingBuffer.LinearBase;
+    U32 Reclaimed = 0;
+
+    while (Device->TxHead != Device->TxTail) {
+        E1000_DescriptorBarrier();
+
+        if ((Ring[Device->TxHead].STA & E1000_TX_STA_DD) == 0) {
+            break;
+        }
+
+        Device->TxHead = (Device->TxHead + 1) % Device->TxRingCount;
+        Reclaimed++;
+    }
+
+    return Reclaimed;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Count the descriptors that can be filled.
+ *
+ * One slot always stays empty so that TxHead == TxTail means an empty ring.
+ *
+ * @param Device Target E1000 device.
+ * @return Number of free descriptors.
+ */
+static U32 E1000_TransmitFreeSlots(LPE1000DEVICE Device) {
+    U32 Used = (Device->TxTail + Device->TxRingCount - Device->TxHead) % Device->TxRingCount;
+
+    return Device->TxRingCount - 1 - Used;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Make room for a number of descriptors, reclaiming completed ones.
  * @param Device Target E1000 device.
+ * @param Needed Number of descriptors.
+ * @return TRUE when the descriptors are free.
+ */
+static BOOL E1000_TransmitReserve(LPE1000DEVICE Device, U32 Needed) {
+    if (E1000_TransmitFreeSlots(Device) >= Needed) return TRUE;
+
+    E1000_TransmitReclaim(Device);
+
+    return E1000_TransmitFreeSlots(Device) >= Needed;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Tell whether the last context descriptor matches a checksum offload.
+ * @param Device Target E1000 device.
+ * @param Offload Requested offload.
+ * @return TRUE when no new context descriptor is needed.
+ */
+static BOOL E1000_TransmitContextMatches(LPE1000DEVICE Device, const NETWORK_OFFLOAD *Offload) {
+    if (Device->TxContextValid == FALSE) return FALSE;
+
+    return Device->TxContext.NetworkOffset == Offload->NetworkOffset &&
+           Device->TxContext.TransportOffset == Offload->TransportOffset &&
+           Device->TxContext.ChecksumOffset == Offload->ChecksumOffset;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Fill a context descriptor for TCP checksum insertion or segmentation.
+ *
+ * The context stays active in the hardware for the following data
+ * descriptors, so a checksum-only context is reused while the offsets do
+ * not change. A segmentation context carries the payload length and is
+ * never reused.
+ *
+ * @param Device Target E1000 device, with at least one free descriptor.
+ * @param Offload Requested offload.
+ * @param Length Length of the whole frame in bytes.
+ */
+static void E1000_TransmitWriteContext(LPE1000DEVICE Device, const NETWORK_OFFLOAD *Offload, U32 Length) {
+    LPE1000_TXDESC Ring = (LPE1000_TXDESC)Device->TxRingBuffer.LinearBase;
+    LPE1000_TXCONTEXT Context = (LPE1000_TXCONTEXT)&Ring[Device->TxTail];
+    BOOL Segment = (Offload->Flags & NETWORK_OFFLOAD_TCP_SEGMENTATION) != 0;
+    U32 Payload = Segment ? Length - Offload->HeaderLength : 0;
+
+    Context->IPCSS = Offload->NetworkOffset;
+    Context->IPCSO = (U8)(Offload->NetworkOffset + E1000_IPV4_CHECKSUM_FIELD);
+    Context->IPCSE = (U16)(Offload->TransportOffset - 1);
+    Context->TUCSS = Offload->TransportOffset;
+    Context->TUCSO = Offload->ChecksumOffset;
+    Context->TUCSE = 0;
+    Context->PayloadLow = (U16)(Payload & 0xFFFF);
+    Context->PayloadHighType = (U8)(((Payload >> 16) & 0x0F) | E1000_TX_DTYP_CONTEXT);
+    Context->TUCMD = E1000_TX_TUCMD_DEXT | E1000_TX_TUCMD_RS | E1000_TX_TUCMD_TCP | E1000_TX_TUCMD_IP;
+    Context->STA = 0;
+    Context->HDRLEN = Segment ? Offload->HeaderLength : 0;
+    Context->MSS = Segment ? Offload->SegmentSize : 0;
+
+    if (Segment) {
+        Context->TUCMD |= E1000_TX_TUCMD_TSE;
+    }
+
+    Device->TxContext = *Offload;
+    Device->TxContextValid = !Segment;
+    Device->TxTail = (Device->TxTail + 1) % Device->TxRingCount;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Fill the data descriptors of an offloaded frame.
+ *
+ * The frame is copied into consecutive slot buffers, one page per
+ * descriptor, so a segmentation frame may span several slots.
+ *
+ * @param Device Target E1000 device, with enough free descriptors.
  * @param Data Pointer to frame data.
  * @param Length Length of frame in bytes.
- * @return DF_RETURN_SUCCESS on success or error code.
+ * @param Offload Requested offload.
+ * @return DF_RETURN_SUCCESS or DF_RETURN_INPUT_OUTPUT.
  */
-static U32 E1000_TransmitSend(LPE1000DEVICE Device, const U8 *Data, U32 Length) {
-    if (Length == 0 || Length > E1000_TX_BUF_SIZE) return DF_RETURN_BAD_PARAMETER;
+static U32 E1000_TransmitWriteData(LPE1000DEVICE Device, const U8 *Data, U32 Length, const NETWORK_OFFLOAD *Offload) {
+    LPE1000_TXDESC Ring = (LPE1000_TXDESC)Device->TxRingBuffer.LinearBase;
+    BOOL Segment = (Offload->Flags & NETWORK_OFFLOAD_TCP_SEGMENTATION) != 0;
+    U32 Offset = 0;
 
+    while (Offset < Length) {
+        U32 Index = Device->TxTail;
+        U32 Chunk = Length - Offset;
+        LINEAR BufferLinear = DMABufferGetIndexedLinear(&Device->TxBufferPool, Index, PAGE_SIZE);
+        PHYSICAL BufferPhys = DMABufferGetIndexedPhysical(&Device->TxBufferPool, Index, PAGE_SIZE);
+        LPE1000_TXDATA Descriptor = (LPE1000_TXDATA)&Ring[Index];
+
+        if (BufferLinear == 0 || BufferPhys == 0) {
+            return DF_RETURN_INPUT_OUTPUT;
+        }
+
+        if (Chunk > PAGE_SIZE) Chunk = PAGE_SIZE;
+
+        MemoryCopy((LPVOID)BufferLinear, (LPVOID)(Data + Offset), Chunk);
+        Offset += Chunk;
+
+        // The slot may have held a context descriptor, rewrite every field
+        Descriptor->BufferAddrLow = (U32)(BufferPhys & MAX_U32);
+        Descriptor->BufferAddrHigh = 0;
+        Descriptor->LengthLow = (U16)Chunk;
+        Descriptor->LengthHighType = E1000_TX_DTYP_DATA;
+        Descriptor->DCMD = E1000_TX_CMD_DEXT | E1000_TX_CMD_IFCS | E1000_TX_CMD_RS;
+        Descriptor->STA = 0;
+        Descriptor->POPTS = E1000_TX_POPTS_TXSM;
+        Descriptor->Special = 0;
+
+        if (Segment) {
+            Descriptor->DCMD |= E1000_TX_CMD_TSE;
+            Descriptor->POPTS |= E1000_TX_POPTS_IXSM;
+        }
+
+        if (Offset == Length) {
+            Descriptor->DCMD |= E1000_TX_CMD_EOP;
+        }
+
+        Device->TxTail = (Index + 1) % Device->TxRingCount;
+    }
+
+    return DF_RETURN_SUCCESS;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Fill the transmit descriptors of a frame without ringing the doorbell.
+ *
+ * Frames without offload use one legacy descriptor. Offloaded frames use
+ * a context descriptor when the context changes, then extended data
+ * descriptors. When the ring is full, completed descriptors are reclaimed
+ * first.
+ *
+ * @param Device Target E1000 device.
+ * @param Data Pointer to frame data, copied into the slot buffers.
+ * @param Length Length of frame in bytes.
+ * @param Offload Requested offload, or NULL.
+ * @return DF_RETURN_SUCCESS, or DF_RETURN_NT_TX_BUSY when the ring is full.
+ */
+static U32 E1000_TransmitQueue(LPE1000DEVICE Device, const U8 *Data, U32 Length, const NETWORK_OFFLOAD *Offload) {
+    if (Data == NULL || Length == 0) return DF_RETURN_BAD_PARAMETER;
 
-    U32 Index = Device->TxTail;
     LPE1000_TXDESC Ring = (LPE1000_TXDESC)Device->TxRingBuffer.LinearBase;
+
+    if (Offload != NULL && Offload->Flags != 0) {
+        BOOL Segment = (Offload->Flags & NETWORK_OFFLOAD_TCP_SEGMENTATION) != 0;
+        BOOL NeedContext = Segment || !E1000_TransmitContextMatches(Device, Offload);
+        U32 Needed = (Length + PAGE_SIZE - 1) / PAGE_SIZE + (NeedContext ? 1 : 0);
+
+        if (Segment == FALSE && Length > E1000_TX_BUF_SIZE) return DF_RETURN_BAD_PARAMETER;
+        if (Segment && (Offload->HeaderLength >= Length || Offload->SegmentSize == 0)) {
+            return DF_RETURN_BAD_PARAMETER;
+        }
+        if (Needed >= Device->TxRingCount) return DF_RETURN_BAD_PARAMETER;
+
+        if (E1000_TransmitReserve(Device, Needed) == FALSE) {
+            return DF_RETURN_NT_TX_BUSY;
+        }
+
+        if (NeedContext) {
+            E1000_TransmitWriteContext(Device, Offload, Length);
+        }
+
+        return E1000_TransmitWriteData(Device, Data, Length, Offload);
+    }
+
+    if (Length > E1000_TX_BUF_SIZE) return DF_RETURN_BAD_PARAMETER;
+
+    if (E1000_TransmitReserve(Device, 1) == FALSE) {
+        return DF_RETURN_NT_TX_BUSY;
+    }
+
+    U32 Index = Device->TxTail;
     LINEAR BufferLinear = DMABufferGetIndexedLinear(&Device->TxBufferPool, Index, PAGE_SIZE);
+    PHYSICAL BufferPhys = DMABufferGetIndexedPhysical(&Device->TxBufferPool, Index, PAGE_SIZE);
 
-    if (BufferLinear == 0) {
+    if (BufferLinear == 0 || BufferPhys == 0) {
         return DF_RETURN_INPUT_OUTPUT;
     }
 
-    // Copy into pre-allocated TX buffer
+    // Copy into pre-allocated TX buffer, the caller keeps its own
     MemoryCopy((LPVOID)BufferLinear, (LPVOID)Data, Length);
 
+    // The slot may have held an extended descriptor, rewrite every field
+    Ring[Index].BufferAddrLow = (U32)(BufferPhys & MAX_U32);
+    Ring[Index].BufferAddrHigh = 0;
     Ring[Index].Length = (U16)Length;
+    Ring[Index].CSO = 0;
     Ring[Index].CMD = (E1000_TX_CMD_EOP | E1000_TX_CMD_IFCS | E1000_TX_CMD_RS);
     Ring[Index].STA = 0;
+    Ring[Index].CSS = 0;
+    Ring[Index].Special = 0;
+
+    Device->TxTail = (Index + 1) % Device->TxRingCount;
+
+    return DF_RETURN_SUCCESS;
+}
+
+/************************************************************************/
 
-    // Advance tail
-    U32 NewTail = (Index + 1) % Device->TxRingCount;
-    Device->TxTail = NewTail;
-    E1000_WriteReg32(Device->MmioBase, E1000_REG_TDT, NewTail);
+/**
+ * @brief Hand the filled transmit descriptors to the hardware.
+ * @param Device Target E1000 device.
+ */
+static void E1000_TransmitDoorbell(LPE1000DEVICE Device) {
+    E1000_DescriptorBarrier();
+    E1000_WriteReg32(Device->MmioBase, E1000_REG_TDT, Device->TxTail);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Send a frame using the transmit ring.
+ *
+ * Returns as soon as the frame is queued, completion is picked up later
+ * by E1000_TransmitReclaim.
+ *
+ * @param Device Target E1000 device.
+ * @param Data Pointer to frame data.
+ * @param Length Length of frame in bytes.
+ * @param Offload Requested offload, or NULL.
+ * @return DF_RETURN_SUCCESS on success or error code.
+ */
+static U32 E1000_TransmitSend(LPE1000DEVICE Device, const U8 *Data, U32 Length, const NETWORK_OFFLOAD *Offload) {
+    U32 Result = E1000_TransmitQueue(Device, Data, Length, Offload);
 
-    // Simple spin for DD
-    U32 Wait = 0;
-    while (((Ring[Index].STA & E1000_TX_STA_DD) == 0) && (Wait++ < E1000_TX_TIMEOUT_ITER)) {
+    if (Result == DF_RETURN_SUCCESS) {
+        E1000_TransmitDoorbell(Device);
     }
 
-    if (Wait >= E1000_TX_TIMEOUT_ITER) {
-        ERROR(TEXT("[E1000_TransmitSend] TX timeout - packet transmission failed"));
-        return DF_RETURN_NT_TX_FAIL;
+    return Result;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Send several frames with a single TDT write.
+ *
+ * Stops at the first frame that cannot be queued. The frames queued
+ * before it are still sent.
+ *
+ * @param Device Target E1000 device.
+ * @param Frames Frames to send.
+ * @param Count Number of frames.
+ * @param Sent Receives the number of frames queued.
+ * @return DF_RETURN_SUCCESS when every frame was queued, otherwise the error of the first refused one.
+ */
+static U32 E1000_TransmitBatch(LPE1000DEVICE Device, const NETWORK_FRAME *Frames, U32 Count, U32 *Sent) {
+    U32 Result = DF_RETURN_SUCCESS;
+    U32 Index;
+
+    for (Index = 0; Index < Count; Index++) {
+        Result = E1000_TransmitQueue(Device, Frames[Index].Data, Frames[Index].Length, Frames[Index].Offload);
+        if (Result != DF_RETURN_SUCCESS) break;
     }
 
-    return DF_RETURN_SUCCESS;
+    if (Index > 0) {
+        E1000_TransmitDoorbell(Device);
+    }
+
+    *Sent = Index;
+    return Result;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Translate the checksum report of a receive descriptor.
+ * @param Status Descriptor status byte.
+ * @param Errors Descriptor errors byte.
+ * @return NETWORK_RX_* flags for checksums the hardware found valid.
+ */
+static U32 E1000_GetReceiveChecksumFlags(U8 Status, U8 Errors) {
+    U32 Flags = 0;
+
+    if ((Status & E1000_RX_STA_IXSM) != 0) return 0;
+
+    if ((Status & E1000_RX_STA_IPCS) != 0 && (Errors & E1000_RX_ERR_IPE) == 0) {
+        Flags |= NETWORK_RX_IPV4_CHECKSUM_OK;
+    }
+
+    if ((Status & E1000_RX_STA_TCPCS) != 0 && (Errors & E1000_RX_ERR_TCPE) == 0) {
+        Flags |= NETWORK_RX_TRANSPORT_CHECKSUM_OK;
+    }
+
+    return Flags;
 }
 
 /************************************************************************/
@@ -1013,26 +1328,29 @@ static U32 E1000_ReceivePoll(LPE1000DEVICE Device) {
             U16 Length = Ring[NextIndex].Length;
             const U8 *Frame = (const U8 *)DMABufferGetIndexedLinear(&Device->RxBufferPool, NextIndex, PAGE_SIZE);
 
+            U32 Flags = E1000_GetReceiveChecksumFlags(Status, Ring[NextIndex].Errors);
+
             if (Frame != NULL && Device->RxCallback) {
-                Device->RxCallback(Frame, (U32)Length, Device->RxUserData);
-            } else {
+                Device->RxCallback(Frame, (U32)Length, Flags, Device->RxUserData);
             }
         }
 
-        // Advance head
-        Device->RxHead = (NextIndex + 1) % Device->RxRingCount;
+        // Clear the status before the descriptor goes back to the hardware
+        Ring[NextIndex].Status = 0;
 
-        // RDT must point to the last descriptor that the hardware can use
-        // Make the processed descriptor available again by updating RDT to point to it
+        // Advance head, RDT follows once for the whole batch
+        Device->RxHead = (NextIndex + 1) % Device->RxRingCount;
         Device->RxTail = NextIndex;
-        E1000_WriteReg32(Device->MmioBase, E1000_REG_RDT, NextIndex);
-
-        // Clear descriptor status AFTER updating RDT to avoid race condition
-        Ring[NextIndex].Status = 0;
 
         Count++;
     }
 
+    if (Count > 0) {
+        // RDT must point to the last descriptor that the hardware can use
+        E1000_DescriptorBarrier();
+        E1000_WriteReg32(Device->MmioBase, E1000_REG_RDT, Device->RxTail);
+    }
+
     if (Count >= MaxIterations) {
         WARNING(TEXT("[E1000_ReceivePoll] Hit maximum iteration limit (%u), potential infinite loop prevented"), MaxIterations);
     }
@@ -1175,12 +1493,26 @@ static U32 E1000_OnSend(const NETWORK_SEND *Send) {
     if (Send == NULL || Send->Device == NULL || Send->Data == NULL || Send->Length == 0) {
         return DF_RETURN_BAD_PARAMETER;
     }
-    U32 result = E1000_TransmitSend((LPE1000DEVICE)Send->Device, Send->Data, Send->Length);
+    U32 result = E1000_TransmitSend((LPE1000DEVICE)Send->Device, Send->Data, Send->Length, Send->Offload);
     return result;
 }
 
 /************************************************************************/
 
+/**
+ * @brief Send several frames through network stack interface.
+ * @param Batch Frames to send, receives the number queued.
+ * @return DF_RETURN_SUCCESS on success or error code.
+ */
+static U32 E1000_OnSendBatch(LPNETWORK_SEND_BATCH Batch) {
+    if (Batch == NULL || Batch->Device == NULL || Batch->Frames == NULL || Batch->Count == 0) {
+        return DF_RETURN_BAD_PARAMETER;
+    }
+    return E1000_TransmitBatch((LPE1000DEVICE)Batch->Device, Batch->Frames, Batch->Count, &Batch->Sent);
+}
+
+/************************************************************************/
+
 /**
  * @brief Poll device for received frames through network stack interface.
  * @param Poll Poll parameters.
@@ -1188,7 +1520,13 @@ static U32 E1000_OnSend(const NETWORK_SEND *Send) {
  */
 static U32 E1000_OnPoll(const NETWORK_POLL *Poll) {
     if (Poll == NULL || Poll->Device == NULL) return DF_RETURN_BAD_PARAMETER;
-    return E1000_ReceivePoll((LPE1000DEVICE)Poll->Device);
+    LPE1000DEVICE Device = (LPE1000DEVICE)Poll->Device;
+
+    LockMutex(&(Device->Mutex), INFINITY);
+    E1000_TransmitReclaim(Device);
+    UnlockMutex(&(Device->Mutex));
+
+    return E1000_ReceivePoll(Device);
 }
 
 /************************************************************************/
@@ -1222,7 +1560,7 @@ static U32 E1000_OnGetVersion(void) { return MAKE_VERSION(VER_MAJOR, VER_MINOR);
  * @brief Report driver capabilities bitmask.
  * @return Capability flags, zero if none.
  */
-static U32 E1000_OnGetCaps(void) { return 0; }
+static U32 E1000_OnGetCaps(void) { return NETWORK_CAP_TX_CHECKSUM | NETWORK_CAP_RX_CHECKSUM | NETWORK_CAP_TSO; }
 
 /************************************************************************/
 
@@ -1271,6 +1609,8 @@ static UINT E1000Commands(UINT Function, UINT Param) {
             return E1000_OnDisableInterrupts((DEVICE_INTERRUPT_CONFIG *)(LPVOID)Param);
         case DF_NT_SEND:
             return E1000_OnSend((const NETWORK_SEND *)(LPVOID)Param);
+        case DF_NT_SEND_BATCH:
+            return E1000_OnSendBatch((LPNETWORK_SEND_BATCH)(LPVOID)Param);
         case DF_NT_POLL:
             return E1000_OnPoll((const NETWORK_POLL *)(LPVOID)Param);
     }
@@ -604,7 +604,8 @@ static U32 RTL8139PollReceive(LPRTL8139_DEVICE Device) {
         RealtekNetworkDeliverReceivedFrame(
             (LPREALTEK_NETWORK_COMMON_DEVICE)Device,
             (const U8*)((LPVOID)(Device->RxBuffer.LinearBase + Device->RxReadOffset + sizeof(RTL8139_RX_PACKET_HEADER))),
-            FrameLength);
+            FrameLength,
+            0);
 
         NextOffset = (Device->RxReadOffset + sizeof(RTL8139_RX_PACKET_HEADER) + ReceiveLength + 3) & ~3;
         Device->RxReadOffset = NextOffset % RTL8139_RX_RING_SIZE;
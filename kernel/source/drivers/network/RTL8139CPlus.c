@@ -648,7 +648,7 @@ static U32 RTL8139CPlusPollReceive(LPRTL8139CPLUS_DEVICE Device) {
                     FrameLength);
         } else {
             Frame = (U8*)(LPVOID)(Device->RxBufferPool.LinearBase + (Device->RxNextDescriptor << PAGE_SIZE_MUL));
-            RealtekNetworkDeliverReceivedFrame((LPREALTEK_NETWORK_COMMON_DEVICE)Device, Frame, FrameLength - 4);
+            RealtekNetworkDeliverReceivedFrame((LPREALTEK_NETWORK_COMMON_DEVICE)Device, Frame, FrameLength - 4, 0);
         }
 
         BufferPhysical = DMABufferGetPhysical(&Device->RxBufferPool, Device->RxNextDescriptor << PAGE_SIZE_MUL);
@@ -73,6 +73,7 @@ static U32 RTL8169PollDevice(LPREALTEK_NETWORK_COMMON_DEVICE Device);
 static U32 RTL8169OnSend(const NETWORK_SEND* Send);
 static U32 RTL8169OnPoll(const NETWORK_POLL* Poll);
 static U32 RTL8169OnGetVersion(void);
+static U32 RTL8169OnGetCaps(void);
 
 /************************************************************************/
 
@@ -657,6 +658,31 @@ static U32 RTL8169InitializeRegisterAccess(LPRTL8169_DEVICE Device) {
 
 /************************************************************************/
 
+/**
+ * @brief Translate the checksum report of an RX descriptor.
+ *
+ * The protocol field says which checksums the chip computed, the fail bits
+ * which of them were wrong.
+ *
+ * @param DescriptorStatus First word of the RX descriptor.
+ * @return NETWORK_RX_* flags.
+ */
+static U32 RTL8169GetReceiveChecksumFlags(U32 DescriptorStatus) {
+    U32 Protocol = DescriptorStatus & RTL8169_RX_PROTOCOL_MASK;
+
+    if ((DescriptorStatus & RTL8169_RX_CHECKSUM_FAIL_MASK) != 0 || Protocol == 0) {
+        return 0;
+    }
+
+    if (Protocol == RTL8169_RX_PROTOCOL_IP) {
+        return NETWORK_RX_IPV4_CHECKSUM_OK;
+    }
+
+    return NETWORK_RX_IPV4_CHECKSUM_OK | NETWORK_RX_TRANSPORT_CHECKSUM_OK;
+}
+
+/************************************************************************/
+
 /**
  * @brief Drain received packets from the RTL8169 RX descriptor ring.
  * @param Device Target RTL8169 device context.
@@ -694,7 +720,11 @@ static U32 RTL8169PollReceive(LPRTL8169_DEVICE Device) {
                     FrameLength);
         } else {
             Frame = (U8*)(LPVOID)(Device->RxBufferPool.LinearBase + (Device->RxNextDescriptor << PAGE_SIZE_MUL));
-            RealtekNetworkDeliverReceivedFrame((LPREALTEK_NETWORK_COMMON_DEVICE)Device, Frame, FrameLength - 4);
+            RealtekNetworkDeliverReceivedFrame(
+                (LPREALTEK_NETWORK_COMMON_DEVICE)Device,
+                Frame,
+                FrameLength - 4,
+                RTL8169GetReceiveChecksumFlags(DescriptorStatus));
         }
 
         BufferPhysical = DMABufferGetPhysical(&Device->RxBufferPool, Device->RxNextDescriptor << PAGE_SIZE_MUL);
@@ -806,6 +836,20 @@ static U32 RTL8169OnGetVersion(void) {
 
 /************************************************************************/
 
+/**
+ * @brief Reports the offloads of the RTL8169 family.
+ *
+ * Only RX checksum validation is exposed: its descriptor bits are the same
+ * on every supported chip, unlike the TX checksum and large-send bits.
+ *
+ * @return NETWORK_CAP_* flags.
+ */
+static U32 RTL8169OnGetCaps(void) {
+    return NETWORK_CAP_RX_CHECKSUM;
+}
+
+/************************************************************************/
+
 /**
  * @brief Dispatches RTL8169 driver commands.
  * @param Function Requested driver function.
@@ -821,7 +865,7 @@ static UINT RTL8169Commands(UINT Function, UINT Parameter) {
         case DF_GET_VERSION:
             return RTL8169OnGetVersion();
         case DF_GET_CAPS:
-            return RealtekNetworkOnGetCaps();
+            return RTL8169OnGetCaps();
         case DF_GET_LAST_FUNCTION:
             return RealtekNetworkOnGetLastFunction();
         case DF_PROBE:
@@ -781,17 +781,19 @@ U32 RealtekNetworkOnGetInfo(
  * @param Device Target common device state.
  * @param Frame Received frame payload.
  * @param Length Frame length in bytes.
+ * @param Flags NETWORK_RX_* flags reported by the hardware.
  */
 void RealtekNetworkDeliverReceivedFrame(
     LPREALTEK_NETWORK_COMMON_DEVICE Device,
     const U8* Frame,
-    U32 Length) {
+    U32 Length,
+    U32 Flags) {
     if (Device == NULL || Frame == NULL || Length == 0) {
         return;
     }
 
     if (Device->RxCallback != NULL) {
-        Device->RxCallback(Frame, Length, Device->RxUserData);
+        Device->RxCallback(Frame, Length, Flags, Device->RxUserData);
     }
 }
 
@@ -31,8 +31,7 @@
 #include "drivers/interrupts/InterruptController.h"
 #include "system/System.h"
 #include "core/DriverEnum.h"
-#include "utils/BufferPool.h"
-#include "utils/Cache.h"
+#include "fs/BlockCache.h"
 
 /***************************************************************************/
 // Version
@@ -40,14 +39,6 @@
 #define VER_MAJOR 1
 #define VER_MINOR 0
 
-/***************************************************************************/
-// Buffer pool configuration
-
-#define ATA_POOL_ALLOC_FLAGS (ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE)
-#define ATA_SECTOR_BUFFER_OBJECTS_PER_SLAB NUM_BUFFERS
-#define ATA_SECTOR_BUFFER_INITIAL_SLABS 1
-#define ATA_SECTOR_BUFFER_MIN_FREE NUM_BUFFERS
-
 /***************************************************************************/
 
 UINT ATADiskCommands(UINT, UINT);
@@ -91,58 +82,10 @@ typedef struct tag_ATADISK {
     U32 IOPort;  // 0x01F0 or 0x0170
     U32 IRQ;     // 0x0E
     U32 Drive;   // 0 or 1
-    CACHE SectorCache;
-    BUFFER_POOL SectorBufferPool;
 } ATADISK, *LPATADISK;
 
 /***************************************************************************/
 
-typedef struct tag_SECTOR_CACHE_CONTEXT {
-    U32 SectorLow;
-    U32 SectorHigh;
-} SECTOR_CACHE_CONTEXT, *LPSECTOR_CACHE_CONTEXT;
-
-/***************************************************************************/
-
-static BOOL SectorCacheMatcher(LPVOID Data, LPVOID Context) {
-    LPSECTORBUFFER Buffer = (LPSECTORBUFFER)Data;
-    LPSECTOR_CACHE_CONTEXT Match = (LPSECTOR_CACHE_CONTEXT)Context;
-
-    if (Buffer == NULL || Match == NULL) {
-        return FALSE;
-    }
-
-    return Buffer->SectorLow == Match->SectorLow && Buffer->SectorHigh == Match->SectorHigh;
-}
-
-/***************************************************************************/
-
-/**
- * @brief Release callback for ATA sector cache entries.
- *
- * @param Data Cache entry payload (LPSECTORBUFFER).
- * @param Dirty Dirty flag from cache entry.
- * @param Context Buffer pool context pointer.
- */
-static void ATACacheRelease(LPVOID Data, BOOL Dirty, LPVOID Context) {
-    LPBUFFER_POOL Pool = (LPBUFFER_POOL)Context;
-
-    UNUSED(Dirty);
-
-    if (Data == NULL) {
-        return;
-    }
-
-    if (Pool == NULL) {
-        KernelHeapFree(Data);
-        return;
-    }
-
-    BufferPoolRelease(Pool, Data);
-}
-
-/***************************************************************************/
-
 static LPATADISK NewATADisk(void) {
     LPATADISK This;
 
@@ -261,32 +204,6 @@ static BOOL InitializeATA(void) {
                 Disk->IOPort = RealPort;
                 Disk->IRQ = IRQ_ATA;
                 Disk->Drive = Drive;
-                if (!BufferPoolInit(&Disk->SectorBufferPool,
-                                    (UINT)sizeof(SECTORBUFFER),
-                                    ATA_SECTOR_BUFFER_OBJECTS_PER_SLAB,
-                                    ATA_SECTOR_BUFFER_INITIAL_SLABS,
-                                    ATA_POOL_ALLOC_FLAGS)) {
-                    KernelHeapFree(Disk);
-                    continue;
-                }
-
-                if (!BufferPoolReserve(&Disk->SectorBufferPool, ATA_SECTOR_BUFFER_MIN_FREE)) {
-                    BufferPoolDeinit(&Disk->SectorBufferPool);
-                    KernelHeapFree(Disk);
-                    continue;
-                }
-
-                CacheInit(&Disk->SectorCache, NUM_BUFFERS);
-
-                if (Disk->SectorCache.Entries == NULL) {
-                    BufferPoolDeinit(&Disk->SectorBufferPool);
-                    KernelHeapFree(Disk);
-                    continue;
-                }
-
-                CacheSetWritePolicy(
-                    &Disk->SectorCache, CACHE_WRITE_POLICY_READ_ONLY, NULL, ATACacheRelease, &Disk->SectorBufferPool);
-
                 ListAddItem(GetDiskList(), Disk);
                 DisksFound++;
             }
@@ -406,11 +323,43 @@ Out:
 
 /***************************************************************************/
 
-static U32 Read(LPIOCONTROL Control) {
-    LPATADISK Disk;
+/**
+ * @brief Transfer sectors between the drive and a buffer, one command per sector.
+ *
+ * Raw transfer routine used by the block cache.
+ *
+ * @param Control IO control structure describing the transfer.
+ * @param IsWrite TRUE for write, FALSE for read.
+ * @return DF_RETURN_SUCCESS or error code.
+ */
+static U32 ATATransfer(LPIOCONTROL Control, BOOL IsWrite) {
+    LPATADISK Disk = (LPATADISK)Control->Disk;
+    U32 Command = IsWrite ? HD_COMMAND_WRITE : HD_COMMAND_READ;
     BLOCKPARAMS Params;
     U32 Current;
 
+    if (Control->SectorHigh != 0) return DF_RETURN_BAD_PARAMETER;
+
+    DisableInterrupt(Disk->IRQ);
+
+    for (Current = 0; Current < Control->NumSectors; Current++) {
+        SectorToBlockParams(&(Disk->Geometry), Control->SectorLow + Current, &Params);
+
+        ATADriveOut(
+            Disk->IOPort, Disk->Drive, Command, ((U8*)Control->Buffer) + (Current * SECTOR_SIZE), Params.Cylinder,
+            Params.Head, Params.Sector, 1);
+    }
+
+    EnableInterrupt(Disk->IRQ);
+
+    return DF_RETURN_SUCCESS;
+}
+
+/***************************************************************************/
+
+static U32 Read(LPIOCONTROL Control) {
+    LPATADISK Disk;
+
     //-------------------------------------
     // Check validity of parameters
 
@@ -428,53 +377,15 @@ static U32 Read(LPIOCONTROL Control) {
     if (Disk->Header.TypeID != KOID_DISK) return DF_RETURN_BAD_PARAMETER;
     if (Disk->IOPort == 0) return DF_RETURN_BAD_PARAMETER;
     if (Disk->IRQ == 0) return DF_RETURN_BAD_PARAMETER;
+    if (Control->Buffer == NULL) return DF_RETURN_BAD_PARAMETER;
 
-    CacheCleanup(&Disk->SectorCache, GetSystemTime());
-
-    for (Current = 0; Current < Control->NumSectors; Current++) {
-        SECTOR_CACHE_CONTEXT Context = {Control->SectorLow + Current, 0};
-        LPSECTORBUFFER Buffer = (LPSECTORBUFFER)CacheFind(&Disk->SectorCache, SectorCacheMatcher, &Context);
-
-        if (Buffer == NULL) {
-            Buffer = (LPSECTORBUFFER)BufferPoolAcquire(&Disk->SectorBufferPool);
-
-            if (Buffer == NULL) return DF_RETURN_UNEXPECTED;
-
-            Buffer->SectorLow = Context.SectorLow;
-            Buffer->SectorHigh = Context.SectorHigh;
-            Buffer->Dirty = 0;
-
-            //-------------------------------------
-            // We must now do a physical disk access
-
-            DisableInterrupt(Disk->IRQ);
-
-            SectorToBlockParams(&(Disk->Geometry), Context.SectorLow, &Params);
-
-            ATADriveOut(
-                Disk->IOPort, Disk->Drive, HD_COMMAND_READ, Buffer->Data, Params.Cylinder, Params.Head, Params.Sector,
-                1);
-
-            EnableInterrupt(Disk->IRQ);
-
-            if (!CacheAdd(&Disk->SectorCache, Buffer, DISK_CACHE_TTL_MS)) {
-                BufferPoolRelease(&Disk->SectorBufferPool, Buffer);
-                return DF_RETURN_UNEXPECTED;
-            }
-        }
-
-        MemoryCopy(((U8*)Control->Buffer) + (Current * SECTOR_SIZE), Buffer->Data, SECTOR_SIZE);
-    }
-
-    return DF_RETURN_SUCCESS;
+    return BlockCacheRead(Control, SECTOR_SIZE, ATATransfer);
 }
 
 /***************************************************************************/
 
 static U32 Write(LPIOCONTROL Control) {
     LPATADISK Disk;
-    BLOCKPARAMS Params;
-    U32 Current;
 
     //-------------------------------------
     // Check validity of parameters
@@ -493,56 +404,14 @@ static U32 Write(LPIOCONTROL Control) {
     if (Disk->Header.TypeID != KOID_DISK) return DF_RETURN_BAD_PARAMETER;
     if (Disk->IOPort == 0) return DF_RETURN_BAD_PARAMETER;
     if (Disk->IRQ == 0) return DF_RETURN_BAD_PARAMETER;
+    if (Control->Buffer == NULL) return DF_RETURN_BAD_PARAMETER;
 
     //-------------------------------------
     // Check access permissions
 
     if (Disk->Access & DISK_ACCESS_READONLY) return DF_RETURN_NO_PERMISSION;
 
-    CacheCleanup(&Disk->SectorCache, GetSystemTime());
-
-    for (Current = 0; Current < Control->NumSectors; Current++) {
-        SECTOR_CACHE_CONTEXT Context = {Control->SectorLow + Current, 0};
-        LPSECTORBUFFER Buffer = (LPSECTORBUFFER)CacheFind(&Disk->SectorCache, SectorCacheMatcher, &Context);
-        BOOL AddedToCache = FALSE;
-
-        if (Buffer == NULL) {
-            Buffer = (LPSECTORBUFFER)BufferPoolAcquire(&Disk->SectorBufferPool);
-
-            if (Buffer == NULL) return DF_RETURN_UNEXPECTED;
-
-            Buffer->SectorLow = Context.SectorLow;
-            Buffer->SectorHigh = Context.SectorHigh;
-            Buffer->Dirty = 0;
-            AddedToCache = TRUE;
-        }
-
-        MemoryCopy(Buffer->Data, ((U8*)Control->Buffer) + (Current * SECTOR_SIZE), SECTOR_SIZE);
-        Buffer->Dirty = 1;
-
-        //-------------------------------------
-        // Write to physical disk
-
-        DisableInterrupt(Disk->IRQ);
-
-        SectorToBlockParams(&(Disk->Geometry), Context.SectorLow, &Params);
-
-        ATADriveOut(
-            Disk->IOPort, Disk->Drive, HD_COMMAND_WRITE, Buffer->Data, Params.Cylinder, Params.Head, Params.Sector, 1);
-
-        EnableInterrupt(Disk->IRQ);
-
-        Buffer->Dirty = 0;
-
-        if (AddedToCache) {
-            if (!CacheAdd(&Disk->SectorCache, Buffer, DISK_CACHE_TTL_MS)) {
-                BufferPoolRelease(&Disk->SectorBufferPool, Buffer);
-                return DF_RETURN_UNEXPECTED;
-            }
-        }
-    }
-
-    return DF_RETURN_SUCCESS;
+    return BlockCacheWrite(Control, SECTOR_SIZE, ATATransfer, BLOCK_CACHE_WRITE_BACK);
 }
 
 /***************************************************************************/
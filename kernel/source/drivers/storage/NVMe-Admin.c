@@ -330,6 +330,8 @@ BOOL NVMeIdentifyController(LPNVME_DEVICE Device) {
     }
     Firmware[8] = STR_NULL;
 
+    NVMeSetMaxTransferBytes(Device, Data[77]);
+
     NVMeTrimString(Serial, 20);
     NVMeTrimString(Model, 40);
     NVMeTrimString(Firmware, 8);
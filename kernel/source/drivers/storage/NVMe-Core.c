@@ -83,20 +83,20 @@ void NVMeFreeQueueBuffer(LPNVME_QUEUE_BUFFER Queue) {
         return;
     }
 
-    if (Queue->Raw != NULL) {
-        KernelHeapFree(Queue->Raw);
+    if (Queue->Base != 0 && Queue->AllocatedSize != 0) {
+        FreeRegion(Queue->Base, Queue->AllocatedSize);
     }
 
-    Queue->Raw = NULL;
     Queue->Base = 0;
     Queue->Physical = 0;
     Queue->Size = 0;
+    Queue->AllocatedSize = 0;
 }
 
 /************************************************************************/
 
 /**
- * @brief Allocate one aligned queue buffer and validate physical contiguity.
+ * @brief Allocate one aligned, physically contiguous queue buffer.
  *
  * @param Queue Queue descriptor output.
  * @param QueueSize Requested queue size in bytes.
@@ -109,42 +109,31 @@ BOOL NVMeAllocateQueueBuffer(LPNVME_QUEUE_BUFFER Queue, U32 QueueSize, UINT Queu
         return FALSE;
     }
 
-    UINT RawSize = (UINT)QueueSize + QueueAlignment;
-    Queue->Raw = KernelHeapAlloc(RawSize);
-    if (Queue->Raw == NULL) {
-        ERROR(TEXT("[NVMeAllocateQueueBuffer] KernelHeapAlloc failed for %s (raw_size=%u)"), QueueName, RawSize);
+    U32 AllocatedSize = (U32)PAGE_ALIGN(QueueSize);
+    PHYSICAL Physical = AllocPhysicalContiguous(AllocatedSize >> PAGE_SIZE_MUL, QueueAlignment, 0);
+    if (Physical == 0) {
+        ERROR(TEXT("[NVMeAllocateQueueBuffer] No contiguous range for %s (size=%u align=%u)"),
+              QueueName,
+              AllocatedSize,
+              QueueAlignment);
         return FALSE;
     }
 
-    LINEAR RawBase = (LINEAR)Queue->Raw;
-    Queue->Base = (LINEAR)((RawBase + (QueueAlignment - 1)) & ~(QueueAlignment - 1));
-    Queue->Size = QueueSize;
-    MemorySet((LPVOID)Queue->Base, 0, Queue->Size);
-
-    Queue->Physical = MapLinearToPhysical(Queue->Base);
-    if (Queue->Physical == 0) {
-        ERROR(TEXT("[NVMeAllocateQueueBuffer] MapLinearToPhysical failed for %s base=%p"),
+    LINEAR Base = AllocKernelRegion(Physical, AllocatedSize, ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE, QueueName);
+    if (Base == 0) {
+        ERROR(TEXT("[NVMeAllocateQueueBuffer] AllocKernelRegion failed for %s (pa=%p size=%u)"),
               QueueName,
-              (LPVOID)Queue->Base);
-        NVMeFreeQueueBuffer(Queue);
+              (LPVOID)(LINEAR)Physical,
+              AllocatedSize);
+        FreePhysicalPageRange(Physical, AllocatedSize >> PAGE_SIZE_MUL);
         return FALSE;
     }
 
-    for (UINT Offset = 0; Offset < Queue->Size; Offset += N_4KB) {
-        LINEAR Linear = Queue->Base + (LINEAR)Offset;
-        PHYSICAL Physical = MapLinearToPhysical(Linear);
-        PHYSICAL Expected = Queue->Physical + (PHYSICAL)Offset;
-        if (Physical != Expected) {
-            ERROR(TEXT("[NVMeAllocateQueueBuffer] Non contiguous %s (base_pa=%p offset=%u pa=%p expected=%p)"),
-                  QueueName,
-                  (LPVOID)(LINEAR)Queue->Physical,
-                  Offset,
-                  (LPVOID)(LINEAR)Physical,
-                  (LPVOID)(LINEAR)Expected);
-            NVMeFreeQueueBuffer(Queue);
-            return FALSE;
-        }
-    }
+    Queue->Base = Base;
+    Queue->Physical = Physical;
+    Queue->Size = QueueSize;
+    Queue->AllocatedSize = AllocatedSize;
+    MemorySet((LPVOID)Queue->Base, 0, Queue->AllocatedSize);
 
     return TRUE;
 }
@@ -26,6 +26,7 @@
 #include "text/CoreString.h"
 #include "fs/FileSystem.h"
 #include "core/KernelData.h"
+#include "fs/BlockCache.h"
 
 /************************************************************************/
 
@@ -37,6 +38,7 @@
 static UINT NVMeDiskCommands(UINT Function, UINT Parameter);
 static UINT NVMeDiskRead(LPIOCONTROL Control);
 static UINT NVMeDiskWrite(LPIOCONTROL Control);
+static U32 NVMeDiskTransfer(LPIOCONTROL Control, BOOL IsWrite);
 static UINT NVMeDiskGetInfo(LPDISKINFO Info);
 static UINT NVMeDiskSetAccess(LPDISKACCESS Access);
 
@@ -65,48 +67,22 @@ void NVMeInitDiskDriver(LPNVME_DEVICE Device) {
 /************************************************************************/
 
 /**
- * @brief Check whether a buffer is 4 KiB aligned.
+ * @brief Check whether a buffer can be described with PRPs.
  * @param Buffer Buffer pointer.
- * @return TRUE when aligned, FALSE otherwise.
+ * @return TRUE when dword aligned, FALSE otherwise.
  */
-static BOOL NVMeIsAlignedBuffer(LPVOID Buffer) {
-    return (((LINEAR)Buffer & (N_4KB - 1)) == 0);
+static BOOL NVMeIsAlignedBuffer(LPCVOID Buffer) {
+    return (((LINEAR)Buffer & 3) == 0);
 }
 
 /************************************************************************/
 
 /**
- * @brief Check whether a buffer is physically contiguous.
- * @param Buffer Buffer pointer.
- * @param TransferBytes Byte count.
- * @return TRUE when contiguous, FALSE otherwise.
- */
-static BOOL NVMeIsContiguousBuffer(LPVOID Buffer, U32 TransferBytes) {
-    if (Buffer == NULL || TransferBytes == 0) {
-        return FALSE;
-    }
-
-    LINEAR BufferLinear = (LINEAR)Buffer;
-    PHYSICAL BasePhys = MapLinearToPhysical(BufferLinear);
-    if (BasePhys == 0) {
-        return FALSE;
-    }
-
-    for (UINT Offset = 0; Offset < TransferBytes; Offset += N_4KB) {
-        LINEAR Linear = BufferLinear + (LINEAR)Offset;
-        PHYSICAL Physical = MapLinearToPhysical(Linear);
-        if (Physical != (BasePhys + (PHYSICAL)Offset)) {
-            return FALSE;
-        }
-    }
-
-    return TRUE;
-}
-
-/************************************************************************/
-
-/**
- * @brief Read sectors with a bounce buffer when needed.
+ * @brief Read sectors through the bounce area when needed.
+ *
+ * Aligned buffers are read in place, with one command per MDTS-sized chunk.
+ * Other buffers go through the preallocated bounce area of the controller.
+ *
  * @param Device NVMe device.
  * @param NamespaceId Namespace identifier.
  * @param Lba Starting logical block address.
@@ -130,38 +106,48 @@ static BOOL NVMeReadSectorsBuffered(LPNVME_DEVICE Device, U32 NamespaceId, U64 L
         return FALSE;
     }
 
-    if (TransferBytes > (2 * N_4KB)) {
-        return FALSE;
-    }
-
-    if (NVMeIsAlignedBuffer(Buffer) && NVMeIsContiguousBuffer(Buffer, TransferBytes)) {
+    if (NVMeIsAlignedBuffer(Buffer)) {
         return NVMeReadSectors(Device, NamespaceId, Lba, SectorCount, Buffer, BufferBytes);
     }
 
-    U32 RawSize = TransferBytes + N_4KB;
-    LPVOID Raw = KernelHeapAlloc(RawSize);
-    if (Raw == NULL) {
+    U32 BounceSectors = NVME_BOUNCE_BYTES / BytesPerSector;
+    if (Device->BounceBuffer == NULL || BounceSectors == 0) {
         return FALSE;
     }
 
-    LINEAR RawBase = (LINEAR)Raw;
-    LINEAR AlignedBase = (LINEAR)((RawBase + (N_4KB - 1)) & ~(N_4KB - 1));
-    LPVOID AlignedBuffer = (LPVOID)AlignedBase;
-    MemorySet(AlignedBuffer, 0, TransferBytes);
+    U8* Out = (U8*)Buffer;
+    BOOL Result = TRUE;
+
+    // The bounce area is shared, the (recursive) device mutex covers the copies too
+    LockMutex(&(Device->Mutex), INFINITY);
+
+    while (Result && SectorCount > 0) {
+        U32 Chunk = SectorCount > BounceSectors ? BounceSectors : SectorCount;
+        U32 ChunkBytes = Chunk * BytesPerSector;
+
+        Result = NVMeReadSectors(Device, NamespaceId, Lba, Chunk, Device->BounceBuffer, ChunkBytes);
+        if (Result) {
+            MemoryCopy(Out, Device->BounceBuffer, ChunkBytes);
+        }
 
-    BOOL Result = NVMeReadSectors(Device, NamespaceId, Lba, SectorCount, AlignedBuffer, TransferBytes);
-    if (Result) {
-        MemoryCopy(Buffer, AlignedBuffer, TransferBytes);
+        Lba = U64_Add(Lba, U64_FromU32(Chunk));
+        Out += ChunkBytes;
+        SectorCount -= Chunk;
     }
 
-    KernelHeapFree(Raw);
+    UnlockMutex(&(Device->Mutex));
     return Result;
 }
 
 /************************************************************************/
 
 /**
- * @brief Write sectors with a bounce buffer when needed.
+ * @brief Write sectors through the bounce area when needed.
+ *
+ * Aligned buffers are written in place, with one command per MDTS-sized
+ * chunk. Other buffers go through the preallocated bounce area of the
+ * controller.
+ *
  * @param Device NVMe device.
  * @param NamespaceId Namespace identifier.
  * @param Lba Starting logical block address.
@@ -185,32 +171,36 @@ static BOOL NVMeWriteSectorsBuffered(LPNVME_DEVICE Device, U32 NamespaceId, U64
         return FALSE;
     }
 
-    if (TransferBytes > (2 * N_4KB)) {
-        return FALSE;
-    }
-
-    if (NVMeIsAlignedBuffer((LPVOID)Buffer) && NVMeIsContiguousBuffer((LPVOID)Buffer, TransferBytes)) {
+    if (NVMeIsAlignedBuffer(Buffer)) {
         return NVMeWriteSectors(Device, NamespaceId, Lba, SectorCount, Buffer, BufferBytes);
     }
 
-    U32 RawSize = TransferBytes + N_4KB;
-    LPVOID Raw = KernelHeapAlloc(RawSize);
-    if (Raw == NULL) {
+    U32 BounceSectors = NVME_BOUNCE_BYTES / BytesPerSector;
+    if (Device->BounceBuffer == NULL || BounceSectors == 0) {
         return FALSE;
     }
 
-    LINEAR RawBase = (LINEAR)Raw;
-    LINEAR AlignedBase = (LINEAR)((RawBase + (N_4KB - 1)) & ~(N_4KB - 1));
-    LPVOID AlignedBuffer = (LPVOID)AlignedBase;
-    MemorySet(AlignedBuffer, 0, TransferBytes);
-    MemoryCopy(AlignedBuffer, Buffer, TransferBytes);
+    const U8* In = (const U8*)Buffer;
+    BOOL Result = TRUE;
+
+    // The bounce area is shared, the (recursive) device mutex covers the copies too
+    LockMutex(&(Device->Mutex), INFINITY);
+
+    while (Result && SectorCount > 0) {
+        U32 Chunk = SectorCount > BounceSectors ? BounceSectors : SectorCount;
+        U32 ChunkBytes = Chunk * BytesPerSector;
 
-    BOOL Result = NVMeWriteSectors(Device, NamespaceId, Lba, SectorCount, AlignedBuffer, TransferBytes);
+        MemoryCopy(Device->BounceBuffer, In, ChunkBytes);
+        Result = NVMeWriteSectors(Device, NamespaceId, Lba, Chunk, Device->BounceBuffer, ChunkBytes);
 
-    KernelHeapFree(Raw);
+        Lba = U64_Add(Lba, U64_FromU32(Chunk));
+        In += ChunkBytes;
+        SectorCount -= Chunk;
+    }
+
+    UnlockMutex(&(Device->Mutex));
     return Result;
 }
-
 /************************************************************************/
 
 /**
@@ -348,11 +338,11 @@ static UINT NVMeDiskCommands(UINT Function, UINT Parameter) {
 /************************************************************************/
 
 /**
- * @brief Read sectors from an NVMe disk.
+ * @brief Check a request against an NVMe namespace.
  * @param Control IO control structure describing request.
- * @return DF_RETURN_SUCCESS on success, error code otherwise.
+ * @return DF_RETURN_SUCCESS when the request can be transferred.
  */
-static UINT NVMeDiskRead(LPIOCONTROL Control) {
+static U32 NVMeDiskValidate(LPIOCONTROL Control) {
     if (Control == NULL || Control->Disk == NULL || Control->Buffer == NULL) {
         return DF_RETURN_BAD_PARAMETER;
     }
@@ -368,42 +358,10 @@ static UINT NVMeDiskRead(LPIOCONTROL Control) {
                 return DF_RETURN_BAD_PARAMETER;
             }
 
-            U32 TotalBytes = Control->NumSectors * Disk->BytesPerSector;
-            if (Control->BufferSize < TotalBytes) {
+            if (Control->BufferSize < Control->NumSectors * Disk->BytesPerSector) {
                 return DF_RETURN_BAD_PARAMETER;
             }
 
-            U32 MaxSectors = (2 * N_4KB) / Disk->BytesPerSector;
-            if (MaxSectors == 0) {
-                return DF_RETURN_BAD_PARAMETER;
-            }
-            U32 Remaining = Control->NumSectors;
-            U8* Out = (U8*)Control->Buffer;
-            U64 Lba = U64_Make(Control->SectorHigh, Control->SectorLow);
-
-            while (Remaining > 0) {
-                U32 Chunk = Remaining > MaxSectors ? MaxSectors : Remaining;
-                U32 ChunkBytes = Chunk * Disk->BytesPerSector;
-
-                if (!NVMeReadSectorsBuffered(Disk->Controller,
-                                             Disk->NamespaceId,
-                                             Lba,
-                                             Chunk,
-                                             Disk->BytesPerSector,
-                                             Out,
-                                             ChunkBytes)) {
-                    WARNING(TEXT("[NVMeDiskRead] Read failed LBA=%x:%x sectors=%u"),
-                            (U32)U64_High32(Lba),
-                            (U32)U64_Low32(Lba),
-                            (U32)Chunk);
-                    return DF_RETURN_UNEXPECTED;
-                }
-
-                Lba = U64_Add(Lba, U64_FromU32(Chunk));
-                Out += ChunkBytes;
-                Remaining -= Chunk;
-            }
-
             return DF_RETURN_SUCCESS;
         }
     }
@@ -414,71 +372,85 @@ static UINT NVMeDiskRead(LPIOCONTROL Control) {
 /************************************************************************/
 
 /**
- * @brief Write sectors to an NVMe disk.
- * @param Control IO control structure describing request.
- * @return DF_RETURN_* code.
+ * @brief Transfer sectors of a validated request, used by the block cache.
+ * @param Control IO control structure describing the transfer.
+ * @param IsWrite TRUE for write, FALSE for read.
+ * @return DF_RETURN_SUCCESS on success, error code otherwise.
  */
-static UINT NVMeDiskWrite(LPIOCONTROL Control) {
-    if (Control == NULL || Control->Disk == NULL || Control->Buffer == NULL) {
-        return DF_RETURN_BAD_PARAMETER;
+static U32 NVMeDiskTransfer(LPIOCONTROL Control, BOOL IsWrite) {
+    LPNVME_DISK Disk = (LPNVME_DISK)Control->Disk;
+    U32 TotalBytes = Control->NumSectors * Disk->BytesPerSector;
+    U64 Lba = U64_Make(Control->SectorHigh, Control->SectorLow);
+    BOOL Success;
+
+    if (IsWrite) {
+        Success = NVMeWriteSectorsBuffered(Disk->Controller,
+                                           Disk->NamespaceId,
+                                           Lba,
+                                           Control->NumSectors,
+                                           Disk->BytesPerSector,
+                                           Control->Buffer,
+                                           TotalBytes);
+    } else {
+        Success = NVMeReadSectorsBuffered(Disk->Controller,
+                                          Disk->NamespaceId,
+                                          Lba,
+                                          Control->NumSectors,
+                                          Disk->BytesPerSector,
+                                          Control->Buffer,
+                                          TotalBytes);
     }
 
-    LPNVME_DISK Disk = (LPNVME_DISK)Control->Disk;
-    SAFE_USE_VALID_ID((LPLISTNODE)Disk, KOID_DISK) {
-        if (Disk->Controller == NULL || Control->NumSectors == 0) {
-            return DF_RETURN_BAD_PARAMETER;
-        }
+    if (!Success) {
+        WARNING(TEXT("[NVMeDiskTransfer] %s failed LBA=%x:%x sectors=%u"),
+                IsWrite ? TEXT("Write") : TEXT("Read"),
+                (U32)U64_High32(Lba),
+                (U32)U64_Low32(Lba),
+                (U32)Control->NumSectors);
+        return DF_RETURN_UNEXPECTED;
+    }
 
-        if (Disk->Access & DISK_ACCESS_READONLY) {
-            return DF_RETURN_NO_PERMISSION;
-        }
+    return DF_RETURN_SUCCESS;
+}
 
-        SAFE_USE_VALID_ID(Disk->Controller, KOID_PCIDEVICE) {
-            if (Disk->BytesPerSector == 0 || Control->NumSectors > (0xFFFFFFFF / Disk->BytesPerSector)) {
-                return DF_RETURN_BAD_PARAMETER;
-            }
+/************************************************************************/
 
-            U32 TotalBytes = Control->NumSectors * Disk->BytesPerSector;
-            if (Control->BufferSize < TotalBytes) {
-                return DF_RETURN_BAD_PARAMETER;
-            }
+/**
+ * @brief Read sectors from an NVMe disk.
+ * @param Control IO control structure describing request.
+ * @return DF_RETURN_SUCCESS on success, error code otherwise.
+ */
+static UINT NVMeDiskRead(LPIOCONTROL Control) {
+    U32 Result = NVMeDiskValidate(Control);
 
-            U32 MaxSectors = (2 * N_4KB) / Disk->BytesPerSector;
-            if (MaxSectors == 0) {
-                return DF_RETURN_BAD_PARAMETER;
-            }
-            U32 Remaining = Control->NumSectors;
-            U8* In = (U8*)Control->Buffer;
-            U64 Lba = U64_Make(Control->SectorHigh, Control->SectorLow);
-
-            while (Remaining > 0) {
-                U32 Chunk = Remaining > MaxSectors ? MaxSectors : Remaining;
-                U32 ChunkBytes = Chunk * Disk->BytesPerSector;
-
-                if (!NVMeWriteSectorsBuffered(Disk->Controller,
-                                              Disk->NamespaceId,
-                                              Lba,
-                                              Chunk,
-                                              Disk->BytesPerSector,
-                                              In,
-                                              ChunkBytes)) {
-                    WARNING(TEXT("[NVMeDiskWrite] Write failed LBA=%x:%x sectors=%u"),
-                            (U32)U64_High32(Lba),
-                            (U32)U64_Low32(Lba),
-                            (U32)Chunk);
-                    return DF_RETURN_UNEXPECTED;
-                }
+    if (Result != DF_RETURN_SUCCESS) {
+        return Result;
+    }
 
-                Lba = U64_Add(Lba, U64_FromU32(Chunk));
-                In += ChunkBytes;
-                Remaining -= Chunk;
-            }
+    return BlockCacheRead(Control, ((LPNVME_DISK)Control->Disk)->BytesPerSector, NVMeDiskTransfer);
+}
 
-            return DF_RETURN_SUCCESS;
-        }
+/************************************************************************/
+
+/**
+ * @brief Write sectors to an NVMe disk.
+ * @param Control IO control structure describing request.
+ * @return DF_RETURN_* code.
+ */
+static UINT NVMeDiskWrite(LPIOCONTROL Control) {
+    U32 Result = NVMeDiskValidate(Control);
+
+    if (Result != DF_RETURN_SUCCESS) {
+        return Result;
     }
 
-    return DF_RETURN_BAD_PARAMETER;
+    LPNVME_DISK Disk = (LPNVME_DISK)Control->Disk;
+
+    if (Disk->Access & DISK_ACCESS_READONLY) {
+        return DF_RETURN_NO_PERMISSION;
+    }
+
+    return BlockCacheWrite(Control, Disk->BytesPerSector, NVMeDiskTransfer, BLOCK_CACHE_WRITE_BACK);
 }
 
 /************************************************************************/
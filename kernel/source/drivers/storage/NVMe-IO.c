@@ -40,75 +40,300 @@ static BOOL NVMeShouldEmitIoWarning(LPCOOLDOWN Cooldown) {
     return CooldownTryArm(Cooldown, GetSystemTime());
 }
 
+/************************************************************************/
+
 /**
- * @brief Validate one I/O transfer buffer and resolve its physical base.
+ * @brief Retrieve the upper 32 bits of a physical address.
+ *
+ * @param Physical Physical address.
+ * @return Upper half, always 0 on 32-bit builds.
+ */
+static U32 NVMePhysicalHigh(PHYSICAL Physical) {
+#ifdef __EXOS_64__
+    return (U32)((Physical >> 32) & 0xFFFFFFFF);
+#else
+    UNUSED(Physical);
+    return 0;
+#endif
+}
+
+/************************************************************************/
+
+/**
+ * @brief Log a failed I/O completion status.
  *
- * @param Device NVMe device.
- * @param SectorCount Number of sectors to transfer.
- * @param Buffer Transfer buffer.
- * @param BufferBytes Buffer size in bytes.
  * @param FunctionName Caller function name for logs.
- * @param TransferBytesOut Receives validated transfer size in bytes.
- * @param BasePhysOut Receives contiguous physical base address.
- * @return TRUE on success, FALSE on failure.
+ * @param Status Completion status without the phase bit.
  */
-static BOOL NVMePrepareIoTransfer(LPNVME_DEVICE Device, U32 SectorCount, LPCVOID Buffer, U32 BufferBytes,
-                                  LPCSTR FunctionName, U32* TransferBytesOut, PHYSICAL* BasePhysOut) {
-    U32 BytesPerSector;
-    LINEAR BufferLinear;
-    PHYSICAL BasePhys;
+static void NVMeLogIoStatus(LPCSTR FunctionName, U16 Status) {
+    U16 Sc = (U16)(Status & 0xFF);
+    U16 Sct = (U16)((Status >> 8) & 0x7);
+    U16 Dnr = (U16)((Status >> 14) & 0x1);
+
+    WARNING(TEXT("[%s] Status=%x SCT=%x SC=%x DNR=%x"),
+            FunctionName,
+            (U32)Status,
+            (U32)Sct,
+            (U32)Sc,
+            (U32)Dnr);
+}
+
+/************************************************************************/
 
-    if (Device == NULL || Device->IoSq == NULL || Device->IoCq == NULL || Buffer == NULL ||
-        SectorCount == 0 || BufferBytes == 0 || TransferBytesOut == NULL || BasePhysOut == NULL) {
+/**
+ * @brief Describe a transfer buffer with PRP1, PRP2 and the PRP list of a slot.
+ *
+ * PRP1 may carry an offset inside the first page, every other entry is page
+ * aligned. Transfers spanning more than two pages use the slot PRP list.
+ *
+ * @param Slot Slot owning the PRP list.
+ * @param Buffer Transfer buffer, dword aligned.
+ * @param TransferBytes Transfer size, at most NVME_MAX_TRANSFER_BYTES.
+ * @param Command Command whose PRP fields are filled.
+ * @return TRUE on success, FALSE when a page is not mapped.
+ */
+static BOOL NVMeBuildPrp(LPNVME_IO_SLOT Slot, LINEAR Buffer, U32 TransferBytes, LPNVME_COMMAND Command) {
+    LINEAR End = Buffer + (LINEAR)TransferBytes;
+    LINEAR PageLinear = (Buffer & ~((LINEAR)N_4KB - 1)) + N_4KB;
+    PHYSICAL Physical = MapLinearToPhysical(Buffer);
+    UINT Entries = 0;
+
+    if (Physical == 0) {
         return FALSE;
     }
 
-    BytesPerSector = Device->LogicalBlockSize;
-    if (BytesPerSector == 0) {
-        BytesPerSector = SECTOR_SIZE;
+    Command->Prp1Low = (U32)(Physical & 0xFFFFFFFF);
+    Command->Prp1High = NVMePhysicalHigh(Physical);
+
+    if (PageLinear >= End) {
+        return TRUE;
     }
 
-    if (SectorCount > (0xFFFFFFFF / BytesPerSector)) {
-        return FALSE;
+    if (PageLinear + N_4KB >= End) {
+        Physical = MapLinearToPhysical(PageLinear);
+        if (Physical == 0) {
+            return FALSE;
+        }
+
+        Command->Prp2Low = (U32)(Physical & 0xFFFFFFFF);
+        Command->Prp2High = NVMePhysicalHigh(Physical);
+        return TRUE;
     }
 
-    *TransferBytesOut = SectorCount * BytesPerSector;
-    if (BufferBytes < *TransferBytesOut) {
-        return FALSE;
+    for (; PageLinear < End; PageLinear += N_4KB) {
+        Physical = MapLinearToPhysical(PageLinear);
+        if (Physical == 0) {
+            return FALSE;
+        }
+
+        Slot->PrpList[Entries * 2] = (U32)(Physical & 0xFFFFFFFF);
+        Slot->PrpList[(Entries * 2) + 1] = NVMePhysicalHigh(Physical);
+        Entries++;
     }
 
-    if (*TransferBytesOut > (2 * N_4KB)) {
-        WARNING(TEXT("[%s] Transfer too large for PRP1/PRP2 %u bytes"), FunctionName, (U32)*TransferBytesOut);
-        return FALSE;
+    Command->Prp2Low = (U32)(Slot->PrpListPhysical & 0xFFFFFFFF);
+    Command->Prp2High = NVMePhysicalHigh(Slot->PrpListPhysical);
+    return TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Drain the I/O completion queue into the slot table.
+ *
+ * Called by waiters and by the MSI-X handler. Runs with interrupts disabled
+ * so that both never consume the same entry.
+ *
+ * @param Device NVMe device.
+ * @return Number of completions consumed.
+ */
+static UINT NVMeReapIoCompletions(LPNVME_DEVICE Device) {
+    volatile U32* Doorbell = NVMeGetDoorbellBase(Device);
+    volatile LPNVME_COMPLETION Cq;
+    UINT DbStride;
+    UINT QueueId;
+    UINT Count = 0;
+    U32 Flags;
+
+    if (Device == NULL || Device->IoCq == NULL || Doorbell == NULL) {
+        return 0;
     }
 
-    if (SectorCount > 0x10000) {
-        WARNING(TEXT("[%s] Too many sectors %u"), FunctionName, (U32)SectorCount);
-        return FALSE;
+    DbStride = (UINT)(Device->DoorbellStride / 4);
+    QueueId = (UINT)Device->IoQueueId;
+    Cq = (volatile LPNVME_COMPLETION)Device->IoCq;
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    FOREVER {
+        volatile LPNVME_COMPLETION Entry = &Cq[Device->IoCqHead];
+        U16 EntryStatus = Entry->Status;
+        U16 CommandId;
+        UINT SlotIndex;
+        LPNVME_IO_SLOT Slot;
+
+        if ((U8)(EntryStatus & 0x1) != Device->IoCqPhase) {
+            break;
+        }
+
+        CommandId = Entry->CommandId;
+
+        if (Entry->SubmissionQueueId != QueueId &&
+            NVMeShouldEmitIoWarning(&Device->IoCompletionCoherencyWarningCooldown)) {
+            WARNING(TEXT("[NVMeReapIoCompletions] Unexpected SQID=%x expected=%x"),
+                (U32)Entry->SubmissionQueueId,
+                (U32)QueueId);
+        }
+
+        Device->IoCqHead++;
+        if (Device->IoCqHead >= Device->IoCqEntries) {
+            Device->IoCqHead = 0;
+            Device->IoCqPhase ^= 1;
+        }
+        Count++;
+
+        SlotIndex = (UINT)(CommandId & ((1 << NVME_IO_SLOT_BITS) - 1));
+        Slot = &(Device->IoSlots[SlotIndex]);
+
+        if (SlotIndex >= Device->IoSlotCount || Slot->State != NVME_IO_SLOT_BUSY || Slot->CommandId != CommandId) {
+            if (NVMeShouldEmitIoWarning(&Device->IoCompletionMismatchWarningCooldown)) {
+                WARNING(TEXT("[NVMeReapIoCompletions] Unexpected completion ID=%x"), (U32)CommandId);
+            }
+            continue;
+        }
+
+        if (Slot->Abandoned) {
+            Slot->Abandoned = FALSE;
+            Slot->State = NVME_IO_SLOT_FREE;
+            continue;
+        }
+
+        Slot->Status = EntryStatus;
+        Slot->State = NVME_IO_SLOT_DONE;
     }
 
-    BufferLinear = (LINEAR)Buffer;
-    if ((BufferLinear & (N_4KB - 1)) != 0) {
-        WARNING(TEXT("[%s] Buffer not 4 KiB aligned %p"), FunctionName, Buffer);
-        return FALSE;
+    if (Count != 0) {
+        Doorbell[((QueueId * 2) + 1) * DbStride] = (U32)Device->IoCqHead;
     }
 
-    BasePhys = MapLinearToPhysical(BufferLinear);
-    if (BasePhys == 0) {
-        return FALSE;
+    RestoreFlags(&Flags);
+
+    return Count;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Reserve a free I/O slot and give it a fresh CommandId.
+ *
+ * Must be called with the device mutex held.
+ *
+ * @param Device NVMe device.
+ * @return Slot index, or NVME_IO_MAX_SLOTS when every slot is in flight.
+ */
+static UINT NVMeAcquireIoSlot(LPNVME_DEVICE Device) {
+    for (UINT Index = 0; Index < Device->IoSlotCount; Index++) {
+        LPNVME_IO_SLOT Slot = &(Device->IoSlots[Index]);
+
+        if (Slot->State == NVME_IO_SLOT_FREE) {
+            Slot->CommandId = (U16)((Device->IoCommandId << NVME_IO_SLOT_BITS) | Index);
+            Slot->Status = 0;
+            Slot->Abandoned = FALSE;
+            Slot->State = NVME_IO_SLOT_BUSY;
+            Device->IoCommandId++;
+            return Index;
+        }
     }
 
-    for (UINT Offset = 0; Offset < *TransferBytesOut; Offset += N_4KB) {
-        LINEAR Linear = BufferLinear + (LINEAR)Offset;
-        PHYSICAL Physical = MapLinearToPhysical(Linear);
-        if (Physical != (BasePhys + (PHYSICAL)Offset)) {
-            WARNING(TEXT("[%s] Buffer not contiguous at %x"), FunctionName, (U32)Offset);
-            return FALSE;
+    return NVME_IO_MAX_SLOTS;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Copy a command into the I/O submission queue without ringing the doorbell.
+ *
+ * @param Device NVMe device.
+ * @param Command Command to queue.
+ * @param SlotIndex Slot that tracks the command.
+ */
+static void NVMeQueueIoCommand(LPNVME_DEVICE Device, const NVME_COMMAND* Command, UINT SlotIndex) {
+    LPNVME_COMMAND Sq = (LPNVME_COMMAND)Device->IoSq;
+    UINT Tail = Device->IoSqTail;
+
+    MemoryCopy(&Sq[Tail], Command, sizeof(NVME_COMMAND));
+    Sq[Tail].CommandId = Device->IoSlots[SlotIndex].CommandId;
+    Device->IoSqTail = (Tail + 1) % Device->IoSqEntries;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Publish the queued commands to the controller.
+ *
+ * @param Device NVMe device.
+ */
+static void NVMeRingIoSubmissionDoorbell(LPNVME_DEVICE Device) {
+    volatile U32* Doorbell = NVMeGetDoorbellBase(Device);
+    UINT DbStride = (UINT)(Device->DoorbellStride / 4);
+
+    if (Doorbell == NULL) {
+        return;
+    }
+
+    __asm__ __volatile__("" ::: "memory");
+    Doorbell[((UINT)Device->IoQueueId * 2) * DbStride] = (U32)Device->IoSqTail;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Wait for the completion of one slot and free it.
+ *
+ * A slot that times out is abandoned: it stays reserved until its
+ * completion shows up, so that its PRP list is never reused too early.
+ *
+ * @param Device NVMe device.
+ * @param SlotIndex Slot to wait for.
+ * @param StatusOut Receives the completion status without the phase bit.
+ * @return TRUE when the command completed, FALSE on timeout.
+ */
+static BOOL NVMeWaitIoSlot(LPNVME_DEVICE Device, UINT SlotIndex, U16* StatusOut) {
+    LPNVME_IO_SLOT Slot = &(Device->IoSlots[SlotIndex]);
+    UINT StartTime = GetSystemTime();
+    U32 Flags;
+
+    for (UINT Loop = 0; HasOperationTimedOut(StartTime, Loop, NVME_COMMAND_TIMEOUT_LOOPS, NVME_COMMAND_TIMEOUT_MS) == FALSE; Loop++) {
+        if (Slot->State != NVME_IO_SLOT_DONE) {
+            NVMeReapIoCompletions(Device);
+        }
+
+        if (Slot->State == NVME_IO_SLOT_DONE) {
+            *StatusOut = (U16)(Slot->Status >> 1);
+            Slot->State = NVME_IO_SLOT_FREE;
+            return TRUE;
         }
     }
 
-    *BasePhysOut = BasePhys;
-    return TRUE;
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    if (Slot->State == NVME_IO_SLOT_DONE) {
+        *StatusOut = (U16)(Slot->Status >> 1);
+        Slot->State = NVME_IO_SLOT_FREE;
+        RestoreFlags(&Flags);
+        return TRUE;
+    }
+
+    Slot->Abandoned = TRUE;
+    RestoreFlags(&Flags);
+
+    if (NVMeShouldEmitIoWarning(&Device->IoCompletionTimeoutWarningCooldown)) {
+        WARNING(TEXT("[NVMeWaitIoSlot] Timeout waiting for completion ID=%x"), (U32)Slot->CommandId);
+    }
+
+    return FALSE;
 }
 
 /************************************************************************/
@@ -125,6 +350,11 @@ void NVMeFreeIoQueues(LPNVME_DEVICE Device) {
 
     NVMeFreeQueueBuffer(&Device->IoSqBuffer);
     NVMeFreeQueueBuffer(&Device->IoCqBuffer);
+    NVMeFreeQueueBuffer(&Device->IoPoolBuffer);
+    MemorySet(Device->IoSlots, 0, sizeof(Device->IoSlots));
+    Device->IoSlotCount = 0;
+    Device->BounceBuffer = NULL;
+    Device->BouncePhysical = 0;
     Device->IoSqEntries = 0;
     Device->IoCqEntries = 0;
     Device->IoSq = NULL;
@@ -183,6 +413,37 @@ static BOOL NVMeSetupIoQueues(LPNVME_DEVICE Device) {
         return FALSE;
     }
 
+    // One slot per command in flight, the SQ must keep one entry empty
+    Device->IoSlotCount = Device->IoSqEntries - 1;
+    if (Device->IoSlotCount > NVME_IO_MAX_SLOTS) {
+        Device->IoSlotCount = NVME_IO_MAX_SLOTS;
+    }
+
+    U32 PrpListsSize = (U32)PAGE_ALIGN(Device->IoSlotCount * NVME_PRP_LIST_BYTES);
+
+    if (NVMeAllocateQueueBuffer(&Device->IoPoolBuffer,
+                                PrpListsSize + NVME_BOUNCE_BYTES,
+                                N_4KB,
+                                TEXT("NVMeIoPool")) == FALSE) {
+        NVMeFreeIoQueues(Device);
+        return FALSE;
+    }
+
+    for (UINT Index = 0; Index < Device->IoSlotCount; Index++) {
+        U32 Offset = Index * NVME_PRP_LIST_BYTES;
+
+        Device->IoSlots[Index].PrpList = (U32*)(Device->IoPoolBuffer.Base + (LINEAR)Offset);
+        Device->IoSlots[Index].PrpListPhysical = Device->IoPoolBuffer.Physical + (PHYSICAL)Offset;
+        Device->IoSlots[Index].State = NVME_IO_SLOT_FREE;
+    }
+
+    Device->BounceBuffer = (LPVOID)(Device->IoPoolBuffer.Base + (LINEAR)PrpListsSize);
+    Device->BouncePhysical = Device->IoPoolBuffer.Physical + (PHYSICAL)PrpListsSize;
+
+    if (Device->MaxTransferBytes == 0) {
+        Device->MaxTransferBytes = NVME_MAX_TRANSFER_BYTES;
+    }
+
     Device->IoSq = (U8*)Device->IoSqBuffer.Base;
     Device->IoCq = (U8*)Device->IoCqBuffer.Base;
     Device->IoSqTail = 0;
@@ -209,16 +470,21 @@ volatile U32* NVMeGetDoorbellBase(LPNVME_DEVICE Device) {
     return (volatile U32*)((U8*)Device->MmioBase + 0x1000);
 }
 
+/************************************************************************/
+
 /**
  * @brief NVMe interrupt handler (top-half).
  *
+ * Moves I/O completions to their slots so that waiters find them done.
+ *
  * @param Device Device pointer.
  * @param Context Optional context pointer.
  * @return TRUE to signal deferred work, FALSE to suppress.
  */
 static BOOL NVMeInterruptHandler(LPDEVICE Device, LPVOID Context) {
     UNUSED(Device);
-    UNUSED(Context);
+
+    NVMeReapIoCompletions((LPNVME_DEVICE)Context);
 
     return FALSE;
 }
@@ -343,177 +609,134 @@ BOOL NVMeSetupInterrupts(LPNVME_DEVICE Device) {
  *
  * @param Device NVMe device.
  * @param Command I/O command to submit.
- * @param CompletionOut Completion output (optional).
- * @return TRUE on success, FALSE on failure.
+ * @param StatusOut Receives the completion status without the phase bit.
+ * @return TRUE when the command completed, FALSE on failure.
  */
-static BOOL NVMeSubmitIoCommand(LPNVME_DEVICE Device, const NVME_COMMAND* Command, NVME_COMPLETION* CompletionOut) {
-    if (Device == NULL || Command == NULL || Device->IoSq == NULL || Device->IoCq == NULL) {
+static BOOL NVMeSubmitIoCommand(LPNVME_DEVICE Device, const NVME_COMMAND* Command, U16* StatusOut) {
+    UINT SlotIndex;
+    BOOL Result;
+
+    if (Device == NULL || Command == NULL || StatusOut == NULL || Device->IoSq == NULL || Device->IoCq == NULL) {
         return FALSE;
     }
 
     LockMutex(&(Device->Mutex), INFINITY);
 
-    if (Device->IoCommandId == 0) {
-        Device->IoCommandId = 1;
-    }
-
-    NVME_COMMAND LocalCommand = *Command;
-    U16 CommandId = Device->IoCommandId;
-    Device->IoCommandId = (U16)(Device->IoCommandId + 1);
-    if (Device->IoCommandId == 0) {
-        Device->IoCommandId = 1;
-    }
-    LocalCommand.CommandId = CommandId;
-
-    UINT Tail = Device->IoSqTail;
-    LPNVME_COMMAND Sq = (LPNVME_COMMAND)Device->IoSq;
-    MemoryCopy(&Sq[Tail], &LocalCommand, sizeof(NVME_COMMAND));
-    Device->IoSqTail = (Tail + 1) % Device->IoSqEntries;
-
-    volatile U32* Doorbell = NVMeGetDoorbellBase(Device);
-    if (Doorbell == NULL) {
+    SlotIndex = NVMeAcquireIoSlot(Device);
+    if (SlotIndex == NVME_IO_MAX_SLOTS) {
         UnlockMutex(&(Device->Mutex));
         return FALSE;
     }
 
-    UINT DbStride = (UINT)(Device->DoorbellStride / 4);
-    UINT QueueId = (UINT)Device->IoQueueId;
-    UINT SqDoorbellIndex = (QueueId * 2) * DbStride;
-    __asm__ __volatile__("" ::: "memory");
-    Doorbell[SqDoorbellIndex] = (U32)Device->IoSqTail;
+    NVMeQueueIoCommand(Device, Command, SlotIndex);
+    NVMeRingIoSubmissionDoorbell(Device);
+    Result = NVMeWaitIoSlot(Device, SlotIndex, StatusOut);
 
-    volatile LPNVME_COMPLETION Cq = (volatile LPNVME_COMPLETION)Device->IoCq;
-    UINT Head = Device->IoCqHead;
-    U8 Phase = Device->IoCqPhase;
-    UINT StartTime = GetSystemTime();
-    for (UINT Loop = 0; HasOperationTimedOut(StartTime, Loop, NVME_COMMAND_TIMEOUT_LOOPS, NVME_COMMAND_TIMEOUT_MS) == FALSE; Loop++) {
-        volatile LPNVME_COMPLETION Entry = &Cq[Head];
-        U16 EntryStatus = Entry->Status;
-        U8 EntryPhase = (U8)(EntryStatus & 0x1);
-        if (EntryPhase != Phase) {
-            continue;
-        }
-
-        NVME_COMPLETION Completion = {0};
-        Completion.Result = Entry->Result;
-        Completion.Reserved = Entry->Reserved;
-        Completion.SubmissionQueueHead = Entry->SubmissionQueueHead;
-        Completion.SubmissionQueueId = Entry->SubmissionQueueId;
-        Completion.CommandId = Entry->CommandId;
-        Completion.Status = EntryStatus;
-
-        if (Completion.SubmissionQueueId != QueueId && NVMeShouldEmitIoWarning(&Device->IoCompletionCoherencyWarningCooldown)) {
-            WARNING(TEXT("[NVMeSubmitIoCommand] Unexpected SQID=%x expected=%x"),
-                (U32)Completion.SubmissionQueueId,
-                (U32)QueueId);
-        }
-
-        if (Completion.SubmissionQueueHead >= Device->IoSqEntries &&
-            NVMeShouldEmitIoWarning(&Device->IoCompletionCoherencyWarningCooldown)) {
-            WARNING(TEXT("[NVMeSubmitIoCommand] Invalid SQ head=%x entries=%x"),
-                (U32)Completion.SubmissionQueueHead,
-                (U32)Device->IoSqEntries);
-        }
-
-        Head++;
-        if (Head >= Device->IoCqEntries) {
-            Head = 0;
-            Phase ^= 1;
-        }
-
-        Device->IoCqHead = Head;
-        Device->IoCqPhase = Phase;
-
-        UINT CqDoorbellIndex = ((QueueId * 2) + 1) * DbStride;
-        Doorbell[CqDoorbellIndex] = (U32)Head;
-
-        if (Completion.CommandId != CommandId) {
-            if (NVMeShouldEmitIoWarning(&Device->IoCompletionMismatchWarningCooldown)) {
-                WARNING(TEXT("[NVMeSubmitIoCommand] Unexpected completion ID=%x expected=%x"),
-                    (U32)Completion.CommandId,
-                    (U32)CommandId);
-            }
-            continue;
-        }
-
-        if (CompletionOut != NULL) {
-            *CompletionOut = Completion;
-        }
-
-        UnlockMutex(&(Device->Mutex));
-        return TRUE;
-    }
-
-    if (NVMeShouldEmitIoWarning(&Device->IoCompletionTimeoutWarningCooldown)) {
-        WARNING(TEXT("[NVMeSubmitIoCommand] Timeout waiting for completion"));
-    }
     UnlockMutex(&(Device->Mutex));
-    return FALSE;
+    return Result;
 }
 
 /************************************************************************/
 
 /**
- * @brief Submit one read or write I/O command for a prepared transfer.
+ * @brief Transfer consecutive sectors with as many commands in flight as slots allow.
+ *
+ * The request is cut in commands of at most MaxTransferBytes. The queue is
+ * filled, the doorbell rung once, then completions are reaped in
+ * submission order and each freed slot takes the next command.
  *
  * @param Device NVMe device.
  * @param Opcode I/O opcode.
  * @param NamespaceId Namespace identifier.
  * @param Lba Starting logical block address.
  * @param SectorCount Number of sectors to transfer.
- * @param TransferBytes Prepared transfer size in bytes.
- * @param BasePhys Contiguous physical base address of the transfer buffer.
+ * @param Buffer Transfer buffer, dword aligned.
  * @param FunctionName Caller function name for logs.
  * @return TRUE on success, FALSE on failure.
  */
-static BOOL NVMeSubmitReadWriteCommand(LPNVME_DEVICE Device, U8 Opcode, U32 NamespaceId, U64 Lba,
-                                       U32 SectorCount, U32 TransferBytes, PHYSICAL BasePhys,
-                                       LPCSTR FunctionName) {
-    NVME_COMMAND Command;
-    NVME_COMPLETION Completion;
-    U16 Status;
-
-    MemorySet(&Command, 0, sizeof(Command));
-    Command.Opcode = Opcode;
-    Command.NamespaceId = NamespaceId;
-    Command.Prp1Low = (U32)(BasePhys & 0xFFFFFFFF);
-    Command.Prp1High = 0;
-#ifdef __EXOS_64__
-    Command.Prp1High = (U32)((BasePhys >> 32) & 0xFFFFFFFF);
-#endif
+static BOOL NVMeTransferSectors(LPNVME_DEVICE Device, U8 Opcode, U32 NamespaceId, U64 Lba, U32 SectorCount,
+                                LINEAR Buffer, LPCSTR FunctionName) {
+    UINT Pending[NVME_IO_MAX_SLOTS];
+    UINT PendingHead = 0;
+    UINT PendingCount = 0;
+    U32 BytesPerSector;
+    U32 ChunkSectors;
+    BOOL Success = TRUE;
 
-    if (TransferBytes > N_4KB) {
-        PHYSICAL SecondPage = BasePhys + N_4KB;
-        Command.Prp2Low = (U32)(SecondPage & 0xFFFFFFFF);
-        Command.Prp2High = 0;
-#ifdef __EXOS_64__
-        Command.Prp2High = (U32)((SecondPage >> 32) & 0xFFFFFFFF);
-#endif
+    BytesPerSector = Device->LogicalBlockSize;
+    if (BytesPerSector == 0) {
+        BytesPerSector = SECTOR_SIZE;
     }
 
-    Command.CommandDword10 = U64_Low32(Lba);
-    Command.CommandDword11 = U64_High32(Lba);
-    Command.CommandDword12 = (U32)((SectorCount - 1) & 0xFFFF);
-
-    if (!NVMeSubmitIoCommand(Device, &Command, &Completion)) {
+    ChunkSectors = Device->MaxTransferBytes / BytesPerSector;
+    if (ChunkSectors > 0x10000) {
+        ChunkSectors = 0x10000;
+    }
+    if (ChunkSectors == 0) {
+        WARNING(TEXT("[%s] Sector size %u above transfer limit"), FunctionName, BytesPerSector);
         return FALSE;
     }
 
-    Status = (U16)(Completion.Status >> 1);
-    if (Status != 0) {
-        U16 Sc = (U16)(Status & 0xFF);
-        U16 Sct = (U16)((Status >> 8) & 0x7);
-        U16 Dnr = (U16)((Status >> 14) & 0x1);
-        WARNING(TEXT("[%s] Status=%x SCT=%x SC=%x DNR=%x"),
-                FunctionName,
-                (U32)Status,
-                (U32)Sct,
-                (U32)Sc,
-                (U32)Dnr);
-        return FALSE;
+    LockMutex(&(Device->Mutex), INFINITY);
+
+    FOREVER {
+        UINT Queued = 0;
+        UINT SlotIndex;
+        U16 Status;
+
+        while (Success && SectorCount > 0) {
+            NVME_COMMAND Command;
+            U32 Count = (SectorCount > ChunkSectors) ? ChunkSectors : SectorCount;
+
+            SlotIndex = NVMeAcquireIoSlot(Device);
+            if (SlotIndex == NVME_IO_MAX_SLOTS) break;
+
+            MemorySet(&Command, 0, sizeof(Command));
+            Command.Opcode = Opcode;
+            Command.NamespaceId = NamespaceId;
+            Command.CommandDword10 = U64_Low32(Lba);
+            Command.CommandDword11 = U64_High32(Lba);
+            Command.CommandDword12 = (U32)((Count - 1) & 0xFFFF);
+
+            if (!NVMeBuildPrp(&(Device->IoSlots[SlotIndex]), Buffer, Count * BytesPerSector, &Command)) {
+                WARNING(TEXT("[%s] Buffer not mapped at %p"), FunctionName, (LPVOID)Buffer);
+                Device->IoSlots[SlotIndex].State = NVME_IO_SLOT_FREE;
+                Success = FALSE;
+                break;
+            }
+
+            NVMeQueueIoCommand(Device, &Command, SlotIndex);
+            Pending[(PendingHead + PendingCount) % NVME_IO_MAX_SLOTS] = SlotIndex;
+            PendingCount++;
+            Queued++;
+
+            Lba = U64_Add(Lba, U64_FromU32(Count));
+            Buffer += (LINEAR)(Count * BytesPerSector);
+            SectorCount -= Count;
+        }
+
+        if (Queued != 0) {
+            NVMeRingIoSubmissionDoorbell(Device);
+        }
+
+        if (PendingCount == 0) break;
+
+        // Even after a failure, wait for every command so that no DMA outlives the call
+        SlotIndex = Pending[PendingHead];
+        PendingHead = (PendingHead + 1) % NVME_IO_MAX_SLOTS;
+        PendingCount--;
+
+        if (!NVMeWaitIoSlot(Device, SlotIndex, &Status)) {
+            Success = FALSE;
+        } else if (Status != 0) {
+            NVMeLogIoStatus(FunctionName, Status);
+            Success = FALSE;
+        }
     }
 
-    return TRUE;
+    UnlockMutex(&(Device->Mutex));
+
+    return Success && SectorCount == 0;
 }
 
 /************************************************************************/
@@ -533,21 +756,13 @@ BOOL NVMeSubmitIoNoop(LPNVME_DEVICE Device) {
     MemorySet(&Command, 0, sizeof(Command));
     Command.Opcode = NVME_IO_OP_NOOP;
     Command.NamespaceId = 1;
-    NVME_COMPLETION Completion;
-    if (!NVMeSubmitIoCommand(Device, &Command, &Completion)) {
+    U16 Status;
+    if (!NVMeSubmitIoCommand(Device, &Command, &Status)) {
         return FALSE;
     }
 
-    U16 Status = (U16)(Completion.Status >> 1);
     if (Status != 0) {
-        U16 Sc = (U16)(Status & 0xFF);
-        U16 Sct = (U16)((Status >> 8) & 0x7);
-        U16 Dnr = (U16)((Status >> 14) & 0x1);
-        WARNING(TEXT("[NVMeSubmitIoNoop] Status=%x SCT=%x SC=%x DNR=%x"),
-                (U32)Status,
-                (U32)Sct,
-                (U32)Sc,
-                (U32)Dnr);
+        NVMeLogIoStatus(TEXT("NVMeSubmitIoNoop"), Status);
         return FALSE;
     }
 
@@ -558,6 +773,44 @@ BOOL NVMeSubmitIoNoop(LPNVME_DEVICE Device) {
 
 /************************************************************************/
 
+/**
+ * @brief Validate the buffer of a read or write request.
+ *
+ * @param Device NVMe device.
+ * @param SectorCount Number of sectors to transfer.
+ * @param Buffer Transfer buffer.
+ * @param BufferBytes Buffer size in bytes.
+ * @param FunctionName Caller function name for logs.
+ * @return TRUE when the transfer can be described with PRPs.
+ */
+static BOOL NVMeCheckIoTransfer(LPNVME_DEVICE Device, U32 SectorCount, LPCVOID Buffer, U32 BufferBytes,
+                                LPCSTR FunctionName) {
+    U32 BytesPerSector;
+
+    if (Device == NULL || Device->IoSq == NULL || Device->IoCq == NULL || Device->IoSlotCount == 0 ||
+        Buffer == NULL || SectorCount == 0) {
+        return FALSE;
+    }
+
+    BytesPerSector = Device->LogicalBlockSize;
+    if (BytesPerSector == 0) {
+        BytesPerSector = SECTOR_SIZE;
+    }
+
+    if (SectorCount > (0xFFFFFFFF / BytesPerSector) || BufferBytes < SectorCount * BytesPerSector) {
+        return FALSE;
+    }
+
+    if (((LINEAR)Buffer & 3) != 0) {
+        WARNING(TEXT("[%s] Buffer not dword aligned %p"), FunctionName, Buffer);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/************************************************************************/
+
 /**
  * @brief Read sectors using the I/O queue.
  *
@@ -565,33 +818,23 @@ BOOL NVMeSubmitIoNoop(LPNVME_DEVICE Device) {
  * @param NamespaceId Namespace identifier.
  * @param Lba Starting logical block address.
  * @param SectorCount Number of sectors to read.
- * @param Buffer Destination buffer (4 KiB aligned).
+ * @param Buffer Destination buffer (dword aligned).
  * @param BufferBytes Buffer size in bytes.
  * @return TRUE on success, FALSE on failure.
  */
 BOOL NVMeReadSectors(LPNVME_DEVICE Device, U32 NamespaceId, U64 Lba, U32 SectorCount, LPVOID Buffer,
                      U32 BufferBytes) {
-    U32 TransferBytes;
-    PHYSICAL BasePhys;
+    if (!NVMeCheckIoTransfer(Device, SectorCount, Buffer, BufferBytes, TEXT("NVMeReadSectors"))) {
+        return FALSE;
+    }
 
-    if (!NVMePrepareIoTransfer(Device,
+    return NVMeTransferSectors(Device,
+                               NVME_IO_OP_READ,
+                               NamespaceId,
+                               Lba,
                                SectorCount,
-                               Buffer,
-                               BufferBytes,
-                               TEXT("NVMeReadSectors"),
-                               &TransferBytes,
-                               &BasePhys)) {
-        return FALSE;
-    }
-
-    return NVMeSubmitReadWriteCommand(Device,
-                                      NVME_IO_OP_READ,
-                                      NamespaceId,
-                                      Lba,
-                                      SectorCount,
-                                      TransferBytes,
-                                      BasePhys,
-                                      TEXT("NVMeReadSectors"));
+                               (LINEAR)Buffer,
+                               TEXT("NVMeReadSectors"));
 }
 
 /************************************************************************/
@@ -603,37 +846,63 @@ BOOL NVMeReadSectors(LPNVME_DEVICE Device, U32 NamespaceId, U64 Lba, U32 SectorC
  * @param NamespaceId Namespace identifier.
  * @param Lba Starting logical block address.
  * @param SectorCount Number of sectors to write.
- * @param Buffer Source buffer (4 KiB aligned).
+ * @param Buffer Source buffer (dword aligned).
  * @param BufferBytes Buffer size in bytes.
  * @return TRUE on success, FALSE on failure.
  */
 BOOL NVMeWriteSectors(LPNVME_DEVICE Device, U32 NamespaceId, U64 Lba, U32 SectorCount, LPCVOID Buffer,
                       U32 BufferBytes) {
-    U32 TransferBytes;
-    PHYSICAL BasePhys;
+    if (!NVMeCheckIoTransfer(Device, SectorCount, Buffer, BufferBytes, TEXT("NVMeWriteSectors"))) {
+        return FALSE;
+    }
 
-    if (!NVMePrepareIoTransfer(Device,
+    return NVMeTransferSectors(Device,
+                               NVME_IO_OP_WRITE,
+                               NamespaceId,
+                               Lba,
                                SectorCount,
-                               Buffer,
-                               BufferBytes,
-                               TEXT("NVMeWriteSectors"),
-                               &TransferBytes,
-                               &BasePhys)) {
-        return FALSE;
-    }
-
-    return NVMeSubmitReadWriteCommand(Device,
-                                      NVME_IO_OP_WRITE,
-                                      NamespaceId,
-                                      Lba,
-                                      SectorCount,
-                                      TransferBytes,
-                                      BasePhys,
-                                      TEXT("NVMeWriteSectors"));
+                               (LINEAR)Buffer,
+                               TEXT("NVMeWriteSectors"));
 }
 
 /************************************************************************/
 
+/**
+ * @brief Derive the per-command transfer limit from the controller MDTS.
+ *
+ * MDTS is a power of two in units of the minimum memory page size, 0 means
+ * no limit. The result is capped by the size of the slot PRP lists.
+ *
+ * @param Device NVMe device.
+ * @param Mdts Maximum data transfer size field of Identify Controller.
+ */
+void NVMeSetMaxTransferBytes(LPNVME_DEVICE Device, U8 Mdts) {
+    U32 Bytes = NVME_MAX_TRANSFER_BYTES;
+
+    if (Device == NULL || Device->MmioBase == 0) {
+        return;
+    }
+
+    if (Mdts != 0) {
+        volatile U32* Regs = (volatile U32*)Device->MmioBase;
+        U32 CapHigh = Regs[(NVME_REG_CAP + 4) / 4];
+
+        Bytes = N_4KB << ((CapHigh >> 16) & 0xF);
+        for (UINT Shift = 0; Shift < Mdts && Bytes < NVME_MAX_TRANSFER_BYTES; Shift++) {
+            Bytes <<= 1;
+        }
+
+        if (Bytes > NVME_MAX_TRANSFER_BYTES) {
+            Bytes = NVME_MAX_TRANSFER_BYTES;
+        }
+    }
+
+    Device->MaxTransferBytes = Bytes;
+
+    DEBUG(TEXT("[NVMeSetMaxTransferBytes] MDTS=%u max transfer=%u bytes"), (U32)Mdts, Bytes);
+}
+/************************************************************************/
+
 /**
  * @brief Read LBA 0 and log the MBR signature.
  *
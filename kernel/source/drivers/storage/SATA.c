@@ -33,7 +33,7 @@
 #include "drivers/bus/PCI.h"
 #include "User.h"
 #include "utils/BufferPool.h"
-#include "utils/Cache.h"
+#include "fs/BlockCache.h"
 
 /***************************************************************************/
 // Version
@@ -54,16 +54,16 @@
 #define AHCI_MAX_PORTS 32
 #define AHCI_CMD_LIST_SIZE 1024  // 32 command headers * 32 bytes each
 #define AHCI_FIS_SIZE 256        // FIS receive area size
-#define AHCI_CMD_TBL_SIZE 256    // Command table size (including PRDT)
-#define AHCI_MAX_PRDT 8          // Max PRDT entries per command
+#define AHCI_MAX_PRDT 128        // Max PRDT entries per command
+#define AHCI_CMD_TBL_SIZE (0x80 + AHCI_MAX_PRDT * sizeof(AHCI_PRDT_ENTRY))  // Command table size (including PRDT)
+#define AHCI_PRDT_MAX_BYTES N_4MB                // Max bytes described by one PRDT entry
+#define AHCI_MAX_SECTORS_PER_COMMAND 65535       // 16-bit sector count of READ/WRITE DMA EXT
+#define AHCI_COMPLETION_SPINS_PER_SECTOR 2000    // Extra completion polls granted per sector
 
 /***************************************************************************/
 // Buffer pool configuration
 
 #define SATA_POOL_ALLOC_FLAGS (ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE)
-#define SATA_SECTOR_BUFFER_OBJECTS_PER_SLAB NUM_BUFFERS
-#define SATA_SECTOR_BUFFER_INITIAL_SLABS 1
-#define SATA_SECTOR_BUFFER_MIN_FREE NUM_BUFFERS
 #define SATA_BOUNCE_BUFFER_BYTES (N_4KB + N_4KB)
 #define SATA_BOUNCE_BUFFER_OBJECTS_PER_SLAB 8
 #define SATA_BOUNCE_BUFFER_INITIAL_SLABS 1
@@ -86,8 +86,6 @@ typedef struct tag_AHCI_PORT {
     LPAHCI_CMD_TBL CommandTable;    // Command table
 
     // Buffer management
-    CACHE SectorCache;
-    BUFFER_POOL SectorBufferPool;
     BUFFER_POOL BounceBufferPool;
 
     volatile U32 PendingInterrupts;
@@ -119,12 +117,6 @@ static AHCI_STATE AHCIState = {
 
 /***************************************************************************/
 
-typedef struct tag_SATA_CACHE_CONTEXT {
-    U32 SectorLow;
-    U32 SectorHigh;
-} SATA_CACHE_CONTEXT, *LPSATA_CACHE_CONTEXT;
-
-/***************************************************************************/
 // AHCI PCI Driver
 
 static UINT AHCIProbe(UINT Function, UINT Parameter);
@@ -205,52 +197,6 @@ LPDRIVER SATADiskGetDriver(void) {
 
 /***************************************************************************/
 
-/**
- * @brief Matcher callback for SATA sector cache entries.
- *
- * @param Data Cache entry (LPSECTORBUFFER).
- * @param Context Matching context with sector range.
- * @return TRUE if entry matches requested sector range.
- */
-static BOOL SATACacheMatcher(LPVOID Data, LPVOID Context) {
-    LPSECTORBUFFER Buffer = (LPSECTORBUFFER)Data;
-    LPSATA_CACHE_CONTEXT Match = (LPSATA_CACHE_CONTEXT)Context;
-
-    if (Buffer == NULL || Match == NULL) {
-        return FALSE;
-    }
-
-    return Buffer->SectorLow == Match->SectorLow && Buffer->SectorHigh == Match->SectorHigh;
-}
-
-/***************************************************************************/
-
-/**
- * @brief Release callback for SATA sector cache entries.
- *
- * @param Data Cache entry payload (LPSECTORBUFFER).
- * @param Dirty Dirty flag from cache entry.
- * @param Context Buffer pool context pointer.
- */
-static void SATACacheRelease(LPVOID Data, BOOL Dirty, LPVOID Context) {
-    LPBUFFER_POOL Pool = (LPBUFFER_POOL)Context;
-
-    UNUSED(Dirty);
-
-    if (Data == NULL) {
-        return;
-    }
-
-    if (Pool == NULL) {
-        KernelHeapFree(Data);
-        return;
-    }
-
-    BufferPoolRelease(Pool, Data);
-}
-
-/***************************************************************************/
-
 /**
  * @brief Allocate and initialize an AHCI port structure.
  *
@@ -437,26 +383,14 @@ static BOOL InitializeAHCIPort(LPAHCI_PORT AHCIPort, U32 PortNum) {
     }
     MemorySet(AHCIPort->FISBase, 0, AHCI_FIS_SIZE);
 
-    // Allocate command table
-    AHCIPort->CommandTable = (LPAHCI_CMD_TBL)KernelHeapAlloc(AHCI_CMD_TBL_SIZE);
+    // Allocate command table, one page keeps it 128-byte aligned and physically contiguous
+    AHCIPort->CommandTable = (LPAHCI_CMD_TBL)AllocKernelRegion(
+        0, N_4KB, ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE, TEXT("AHCICommandTable"));
     if (AHCIPort->CommandTable == NULL) {
         return FALSE;
     }
     MemorySet(AHCIPort->CommandTable, 0, AHCI_CMD_TBL_SIZE);
 
-    if (!BufferPoolInit(&AHCIPort->SectorBufferPool,
-                        (UINT)sizeof(SECTORBUFFER),
-                        SATA_SECTOR_BUFFER_OBJECTS_PER_SLAB,
-                        SATA_SECTOR_BUFFER_INITIAL_SLABS,
-                        SATA_POOL_ALLOC_FLAGS)) {
-        return FALSE;
-    }
-
-    if (!BufferPoolReserve(&AHCIPort->SectorBufferPool, SATA_SECTOR_BUFFER_MIN_FREE)) {
-        BufferPoolDeinit(&AHCIPort->SectorBufferPool);
-        return FALSE;
-    }
-
     if (!BufferPoolInit(&AHCIPort->BounceBufferPool,
                         SATA_BOUNCE_BUFFER_BYTES,
                         SATA_BOUNCE_BUFFER_OBJECTS_PER_SLAB,
@@ -470,14 +404,6 @@ static BOOL InitializeAHCIPort(LPAHCI_PORT AHCIPort, U32 PortNum) {
         return FALSE;
     }
 
-    CacheInit(&AHCIPort->SectorCache, NUM_BUFFERS);
-    if (AHCIPort->SectorCache.Entries == NULL) {
-        return FALSE;
-    }
-
-    CacheSetWritePolicy(
-        &AHCIPort->SectorCache, CACHE_WRITE_POLICY_READ_ONLY, NULL, SATACacheRelease, &AHCIPort->SectorBufferPool);
-
     // Set up port registers with physical addresses for DMA
     PHYSICAL CommandListPhys = MapLinearToPhysical((LINEAR)AHCIPort->CommandList);
     PHYSICAL FISBasePhys = MapLinearToPhysical((LINEAR)AHCIPort->FISBase);
@@ -687,38 +613,119 @@ static U32 InitializeAHCIController(void) {
 
 /***************************************************************************/
 
+/**
+ * @brief Describe a linear buffer in the PRDT of a command table.
+ *
+ * Walks the buffer page by page and merges physically adjacent pages into
+ * one entry of at most 4 MB. When the table is full, or a page is not
+ * mapped, the description stops early and is trimmed to whole sectors.
+ *
+ * @param Table Command table to fill.
+ * @param Buffer Linear address of the data, 2-byte aligned.
+ * @param Bytes Number of bytes to describe.
+ * @param EntryCount Receives the number of PRDT entries used.
+ * @return Number of bytes described, a multiple of SECTOR_SIZE.
+ */
+static U32 AHCIBuildPRDT(LPAHCI_CMD_TBL Table, LINEAR Buffer, U32 Bytes, U32* EntryCount) {
+    LPAHCI_PRDT_ENTRY Entries = Table->prdt_entry;
+    PHYSICAL RunEnd = 0;
+    U32 EntryBytes = 0;
+    U32 Count = 0;
+    U32 Covered = 0;
+    U32 Excess;
+
+    while (Covered < Bytes) {
+        LINEAR Address = Buffer + Covered;
+        U32 Chunk = N_4KB - (U32)(Address & (N_4KB - 1));
+        PHYSICAL Physical = MapLinearToPhysical(Address);
+
+        if (Physical == 0) break;
+        if (Chunk > Bytes - Covered) Chunk = Bytes - Covered;
+
+        if (Count > 0 && Physical == RunEnd && EntryBytes + Chunk <= AHCI_PRDT_MAX_BYTES) {
+            EntryBytes += Chunk;
+        } else {
+            if (Count == AHCI_MAX_PRDT) break;
+
+            MemorySet(&(Entries[Count]), 0, sizeof(AHCI_PRDT_ENTRY));
+            Entries[Count].dba = (U32)(Physical & 0xFFFFFFFF);
+#ifdef __EXOS_64__
+            Entries[Count].dbau = (U32)((Physical >> 32) & 0xFFFFFFFF);
+#endif
+            EntryBytes = Chunk;
+            Count++;
+        }
+
+        Entries[Count - 1].dbc = EntryBytes - 1;
+        RunEnd = Physical + Chunk;
+        Covered += Chunk;
+    }
+
+    // A partial sector cannot be transferred, drop it from the tail
+    Excess = Covered % SECTOR_SIZE;
+    Covered -= Excess;
+
+    while (Excess > 0 && Count > 0) {
+        U32 LastBytes = (U32)Entries[Count - 1].dbc + 1;
+
+        if (LastBytes > Excess) {
+            Entries[Count - 1].dbc = LastBytes - Excess - 1;
+            break;
+        }
+
+        Excess -= LastBytes;
+        Count--;
+    }
+
+    *EntryCount = Count;
+    return Covered;
+}
+
+/***************************************************************************/
+
 /**
  * @brief Issue an AHCI command (read/write) on a port.
  *
+ * The PRDT points straight at Buffer, so a single command moves up to
+ * AHCI_MAX_SECTORS_PER_COMMAND sectors. Only buffers that are not 2-byte
+ * aligned go through a bounce buffer, one page at a time. The command may
+ * move fewer sectors than requested; SectorsDone reports how many.
+ *
  * @param AHCIPort Target port.
  * @param Command ATA command byte.
  * @param LBA Logical block address.
  * @param SectorCount Number of sectors to transfer.
  * @param Buffer Data buffer.
  * @param IsWrite TRUE for write, FALSE for read.
+ * @param SectorsDone Receives the number of sectors transferred.
  * @return DF_RETURN_SUCCESS or error code.
  */
-static U32 AHCICommand(LPAHCI_PORT AHCIPort, U8 Command, U32 LBA, U16 SectorCount, LPVOID Buffer, BOOL IsWrite) {
+static U32 AHCICommand(
+    LPAHCI_PORT AHCIPort, U8 Command, U32 LBA, U32 SectorCount, LPVOID Buffer, BOOL IsWrite, U32* SectorsDone) {
     U32 TransferBytes;
+    U32 EntryCount;
     LPVOID EffectiveBuffer;
     LPVOID BounceRaw;
-    LPVOID BounceAligned;
     LINEAR BounceBase;
-    U32 BounceSize;
 
-    if (AHCIPort == NULL || Buffer == NULL) {
+    if (AHCIPort == NULL || Buffer == NULL || SectorsDone == NULL) {
         return DF_RETURN_BAD_PARAMETER;
     }
 
-    TransferBytes = (U32)SectorCount * SECTOR_SIZE;
+    *SectorsDone = 0;
+
+    if (SectorCount > AHCI_MAX_SECTORS_PER_COMMAND) {
+        SectorCount = AHCI_MAX_SECTORS_PER_COMMAND;
+    }
+
+    TransferBytes = SectorCount * SECTOR_SIZE;
     EffectiveBuffer = Buffer;
     BounceRaw = NULL;
-    BounceAligned = NULL;
 
-    if (TransferBytes <= N_4KB) {
-        BounceSize = TransferBytes + N_4KB;
-        if (BounceSize > SATA_BOUNCE_BUFFER_BYTES) {
-            return DF_RETURN_UNEXPECTED;
+    if (((LINEAR)Buffer & 1) != 0) {
+        // PRDT data addresses must be word aligned
+        if (TransferBytes > SATA_BOUNCE_BUFFER_BYTES - N_4KB) {
+            TransferBytes = SATA_BOUNCE_BUFFER_BYTES - N_4KB;
         }
 
         BounceRaw = BufferPoolAcquire(&AHCIPort->BounceBufferPool);
@@ -727,13 +734,10 @@ static U32 AHCICommand(LPAHCI_PORT AHCIPort, U8 Command, U32 LBA, U16 SectorCoun
         }
 
         BounceBase = (LINEAR)BounceRaw;
-        BounceAligned = (LPVOID)((BounceBase + (N_4KB - 1)) & ~(N_4KB - 1));
-        EffectiveBuffer = BounceAligned;
+        EffectiveBuffer = (LPVOID)((BounceBase + (N_4KB - 1)) & ~(N_4KB - 1));
 
         if (IsWrite) {
             MemoryCopy(EffectiveBuffer, Buffer, TransferBytes);
-        } else {
-            MemorySet(EffectiveBuffer, 0, TransferBytes);
         }
     }
 
@@ -754,6 +758,20 @@ static U32 AHCICommand(LPAHCI_PORT AHCIPort, U8 Command, U32 LBA, U16 SectorCoun
         return DF_RETURN_TIMEOUT;
     }
 
+    // Set up command table, AHCIBuildPRDT clears the entries it uses
+    LPAHCI_CMD_TBL cmdtbl = AHCIPort->CommandTable;
+    MemorySet(cmdtbl, 0, sizeof(AHCI_CMD_TBL) - sizeof(AHCI_PRDT_ENTRY));
+
+    // Set up PRDT entries
+    TransferBytes = AHCIBuildPRDT(cmdtbl, (LINEAR)EffectiveBuffer, TransferBytes, &EntryCount);
+    if (TransferBytes == 0) {
+        ERROR(TEXT("[AHCICommand] MapLinearToPhysical failed buffer=%p"), EffectiveBuffer);
+        if (BounceRaw != NULL) BufferPoolRelease(&AHCIPort->BounceBufferPool, BounceRaw);
+        return DF_RETURN_HARDWARE;
+    }
+
+    SectorCount = TransferBytes / SECTOR_SIZE;
+
     // Clear pending interrupts
     Port->is = 0xFFFFFFFF;
 
@@ -761,11 +779,8 @@ static U32 AHCICommand(LPAHCI_PORT AHCIPort, U8 Command, U32 LBA, U16 SectorCoun
     LPAHCI_CMD_HEADER cmdheader = &AHCIPort->CommandList[0];
     cmdheader->cfl = sizeof(FIS_REG_H2D) / 4; // FIS length in DWORDs
     cmdheader->w = IsWrite ? 1 : 0;           // Write flag
-    cmdheader->prdtl = 1;                     // One PRDT entry
-
-    // Set up command table
-    LPAHCI_CMD_TBL cmdtbl = AHCIPort->CommandTable;
-    MemorySet(cmdtbl, 0, sizeof(AHCI_CMD_TBL));
+    cmdheader->prdtl = (U16)EntryCount;       // PRDT entries
+    cmdheader->prdbc = 0;
 
     // Set up FIS
     FIS_REG_H2D *cmdfis = (FIS_REG_H2D*)cmdtbl->cfis;
@@ -782,27 +797,11 @@ static U32 AHCICommand(LPAHCI_PORT AHCIPort, U8 Command, U32 LBA, U16 SectorCoun
     cmdfis->countl = SectorCount & 0xFF;
     cmdfis->counth = (SectorCount >> 8) & 0xFF;
 
-    // Set up PRDT entry
-    PHYSICAL bufferPhys = MapLinearToPhysical((LINEAR)EffectiveBuffer);
-    if (bufferPhys == 0) {
-        ERROR(TEXT("[AHCICommand] MapLinearToPhysical failed buffer=%p"), EffectiveBuffer);
-        if (BounceRaw != NULL) BufferPoolRelease(&AHCIPort->BounceBufferPool, BounceRaw);
-        return DF_RETURN_HARDWARE;
-    }
-
-    cmdtbl->prdt_entry[0].dba = (U32)(bufferPhys & 0xFFFFFFFF);
-    cmdtbl->prdt_entry[0].dbau = 0;
-#ifdef __EXOS_64__
-    cmdtbl->prdt_entry[0].dbau = (U32)((bufferPhys >> 32) & 0xFFFFFFFF);
-#endif
-    cmdtbl->prdt_entry[0].dbc = (SectorCount * 512) - 1; // Byte count - 1
-    cmdtbl->prdt_entry[0].i = 0; // No interrupt on completion for this entry
-
     // Issue command
     Port->ci = 1; // Issue command slot 0
 
-    // Wait for completion
-    timeout = 1000000;
+    // Wait for completion, longer transfers get a longer budget
+    timeout = 1000000 + SectorCount * AHCI_COMPLETION_SPINS_PER_SECTOR;
     while ((Port->ci & 1) && timeout > 0) {
         if (Port->is & AHCI_PORT_IS_TFES) {
             ERROR(TEXT("[AHCICommand] Task file error ci=%x is=%x tfd=%x"), Port->ci, Port->is, Port->tfd);
@@ -831,11 +830,57 @@ static U32 AHCICommand(LPAHCI_PORT AHCIPort, U8 Command, U32 LBA, U16 SectorCoun
 
     if (BounceRaw != NULL) BufferPoolRelease(&AHCIPort->BounceBufferPool, BounceRaw);
 
+    *SectorsDone = SectorCount;
+
+    return DF_RETURN_SUCCESS;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Transfer a run of consecutive sectors, as few commands as possible.
+ *
+ * @param AHCIPort Target port.
+ * @param LBA First sector.
+ * @param SectorCount Number of sectors.
+ * @param Buffer Caller buffer.
+ * @param IsWrite TRUE for write, FALSE for read.
+ * @return DF_RETURN_SUCCESS or error code.
+ */
+static U32 SATATransferSectors(LPAHCI_PORT AHCIPort, U32 LBA, U32 SectorCount, U8* Buffer, BOOL IsWrite) {
+    U8 Command = IsWrite ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_READ_DMA_EXT;
+
+    while (SectorCount > 0) {
+        U32 Done = 0;
+        U32 Result = AHCICommand(AHCIPort, Command, LBA, SectorCount, Buffer, IsWrite, &Done);
+
+        if (Result != DF_RETURN_SUCCESS) return Result;
+        if (Done == 0) return DF_RETURN_UNEXPECTED;
+
+        LBA += Done;
+        SectorCount -= Done;
+        Buffer += Done * SECTOR_SIZE;
+    }
+
     return DF_RETURN_SUCCESS;
 }
 
 /***************************************************************************/
 
+/**
+ * @brief Raw transfer routine used by the block cache.
+ *
+ * @param Control IO control structure describing the transfer.
+ * @param IsWrite TRUE for write, FALSE for read.
+ * @return DF_RETURN_SUCCESS or error code.
+ */
+static U32 SATATransfer(LPIOCONTROL Control, BOOL IsWrite) {
+    return SATATransferSectors(
+        (LPAHCI_PORT)Control->Disk, Control->SectorLow, Control->NumSectors, (U8*)Control->Buffer, IsWrite);
+}
+
+/***************************************************************************/
+
 /**
  * @brief Read sectors from a SATA disk using AHCI.
  *
@@ -844,8 +889,6 @@ static U32 AHCICommand(LPAHCI_PORT AHCIPort, U8 Command, U32 LBA, U16 SectorCoun
  */
 static U32 Read(LPIOCONTROL Control) {
     LPAHCI_PORT AHCIPort;
-    U32 Current;
-    U32 Result;
 
     // Check validity of parameters
     if (Control == NULL) return DF_RETURN_BAD_PARAMETER;
@@ -856,40 +899,9 @@ static U32 Read(LPIOCONTROL Control) {
 
     // Check validity of parameters
     if (AHCIPort->Header.TypeID != KOID_DISK) return DF_RETURN_BAD_PARAMETER;
+    if (Control->Buffer == NULL) return DF_RETURN_BAD_PARAMETER;
 
-    CacheCleanup(&AHCIPort->SectorCache, GetSystemTime());
-
-    for (Current = 0; Current < Control->NumSectors; Current++) {
-        SATA_CACHE_CONTEXT Context = {Control->SectorLow + Current, 0};
-        LPSECTORBUFFER Buffer = (LPSECTORBUFFER)CacheFind(&AHCIPort->SectorCache, SATACacheMatcher, &Context);
-
-        if (Buffer == NULL) {
-            Buffer = (LPSECTORBUFFER)BufferPoolAcquire(&AHCIPort->SectorBufferPool);
-
-            if (Buffer == NULL) return DF_RETURN_UNEXPECTED;
-
-            Buffer->SectorLow = Context.SectorLow;
-            Buffer->SectorHigh = Context.SectorHigh;
-            Buffer->Dirty = 0;
-
-            Result = AHCICommand(
-                AHCIPort, ATA_CMD_READ_DMA_EXT, Context.SectorLow, 1, Buffer->Data, FALSE);
-
-            if (Result != DF_RETURN_SUCCESS) {
-                BufferPoolRelease(&AHCIPort->SectorBufferPool, Buffer);
-                return Result;
-            }
-
-            if (!CacheAdd(&AHCIPort->SectorCache, Buffer, DISK_CACHE_TTL_MS)) {
-                BufferPoolRelease(&AHCIPort->SectorBufferPool, Buffer);
-                return DF_RETURN_UNEXPECTED;
-            }
-        }
-
-        MemoryCopy(((U8*)Control->Buffer) + (Current * SECTOR_SIZE), Buffer->Data, SECTOR_SIZE);
-    }
-
-    return DF_RETURN_SUCCESS;
+    return BlockCacheRead(Control, SECTOR_SIZE, SATATransfer);
 }
 
 /***************************************************************************/
@@ -902,8 +914,6 @@ static U32 Read(LPIOCONTROL Control) {
  */
 static U32 Write(LPIOCONTROL Control) {
     LPAHCI_PORT AHCIPort;
-    U32 Current;
-    U32 Result;
 
     // Check validity of parameters
     if (Control == NULL) return DF_RETURN_BAD_PARAMETER;
@@ -918,48 +928,9 @@ static U32 Write(LPIOCONTROL Control) {
     // Check access permissions
     if (AHCIPort->Access & DISK_ACCESS_READONLY) return DF_RETURN_NO_PERMISSION;
 
-    CacheCleanup(&AHCIPort->SectorCache, GetSystemTime());
-
-    for (Current = 0; Current < Control->NumSectors; Current++) {
-        SATA_CACHE_CONTEXT Context = {Control->SectorLow + Current, 0};
-        LPSECTORBUFFER Buffer = (LPSECTORBUFFER)CacheFind(&AHCIPort->SectorCache, SATACacheMatcher, &Context);
-        BOOL AddedToCache = FALSE;
-
-        if (Buffer == NULL) {
-            Buffer = (LPSECTORBUFFER)BufferPoolAcquire(&AHCIPort->SectorBufferPool);
+    if (Control->Buffer == NULL) return DF_RETURN_BAD_PARAMETER;
 
-            if (Buffer == NULL) return DF_RETURN_UNEXPECTED;
-
-            Buffer->SectorLow = Context.SectorLow;
-            Buffer->SectorHigh = Context.SectorHigh;
-            Buffer->Dirty = 0;
-            AddedToCache = TRUE;
-        }
-
-        MemoryCopy(Buffer->Data, ((U8*)Control->Buffer) + (Current * SECTOR_SIZE), SECTOR_SIZE);
-        Buffer->Dirty = 1;
-
-        Result = AHCICommand(
-            AHCIPort, ATA_CMD_WRITE_DMA_EXT, Context.SectorLow, 1, Buffer->Data, TRUE);
-
-        if (Result != DF_RETURN_SUCCESS) {
-            if (AddedToCache) {
-                BufferPoolRelease(&AHCIPort->SectorBufferPool, Buffer);
-            }
-            return Result;
-        }
-
-        Buffer->Dirty = 0;
-
-        if (AddedToCache) {
-            if (!CacheAdd(&AHCIPort->SectorCache, Buffer, DISK_CACHE_TTL_MS)) {
-                BufferPoolRelease(&AHCIPort->SectorBufferPool, Buffer);
-                return DF_RETURN_UNEXPECTED;
-            }
-        }
-    }
-
-    return DF_RETURN_SUCCESS;
+    return BlockCacheWrite(Control, SECTOR_SIZE, SATATransfer, BLOCK_CACHE_WRITE_BACK);
 }
 
 /***************************************************************************/
@@ -27,6 +27,8 @@
 #include "system/Clock.h"
 #include "sync/DeferredWork.h"
 #include "text/CoreString.h"
+#include "fs/BlockCache.h"
+#include "fs/BlockIO.h"
 #include "fs/FileSystem.h"
 #include "core/Kernel.h"
 #include "log/Log.h"
@@ -238,6 +240,9 @@ static void USBStorageDetachDevice(LPUSB_MASS_STORAGE_DEVICE Device) {
         USBStorageDetachFileSystems((LPSTORAGE_UNIT)Device, 0);
     }
 
+    BlockIODetachDisk((LPSTORAGE_UNIT)Device);
+    BlockCacheInvalidateDisk((LPSTORAGE_UNIT)Device);
+
     if (Device->InputOutputBufferLinear != 0) {
         FreeRegion(Device->InputOutputBufferLinear, PAGE_SIZE);
         Device->InputOutputBufferLinear = 0;
@@ -845,24 +850,60 @@ static U32 USBStorageTransfer(LPIOCONTROL Control, BOOL DirectionIn) {
 
 /************************************************************************/
 
+/**
+ * @brief Raw transfer routine used by the block cache.
+ * @param Control I/O control structure.
+ * @param IsWrite TRUE for write, FALSE for read.
+ * @return DF_RETURN_SUCCESS on success or error code.
+ */
+static U32 USBStorageCacheTransfer(LPIOCONTROL Control, BOOL IsWrite) {
+    return USBStorageTransfer(Control, IsWrite == FALSE);
+}
+
+/************************************************************************/
+
 /**
  * @brief Read sectors from a USB mass storage device.
  * @param Control I/O control structure.
  * @return DF_RETURN_SUCCESS on success or error code.
  */
 static U32 USBStorageRead(LPIOCONTROL Control) {
-    return USBStorageTransfer(Control, TRUE);
+    LPUSB_MASS_STORAGE_DEVICE Device = NULL;
+    UINT TotalBytes = 0;
+    U32 Validation = USBStorageValidateIoControl(&Device, Control, &TotalBytes);
+
+    if (Validation != DF_RETURN_SUCCESS) {
+        return Validation;
+    }
+
+    return BlockCacheRead(Control, Device->BlockSize, USBStorageCacheTransfer);
 }
 
 /************************************************************************/
 
 /**
  * @brief Write sectors to a USB mass storage device.
+ *
+ * Removable media can go away at any time, so writes always reach the
+ * device before returning.
+ *
  * @param Control I/O control structure.
  * @return DF_RETURN_SUCCESS on success or error code.
  */
 static U32 USBStorageWrite(LPIOCONTROL Control) {
-    return USBStorageTransfer(Control, FALSE);
+    LPUSB_MASS_STORAGE_DEVICE Device = NULL;
+    UINT TotalBytes = 0;
+    U32 Validation = USBStorageValidateIoControl(&Device, Control, &TotalBytes);
+
+    if (Validation != DF_RETURN_SUCCESS) {
+        return Validation;
+    }
+
+    if ((Device->Access & DISK_ACCESS_READONLY) != 0) {
+        return DF_RETURN_NO_PERMISSION;
+    }
+
+    return BlockCacheWrite(Control, Device->BlockSize, USBStorageCacheTransfer, BLOCK_CACHE_WRITE_THROUGH);
 }
 
 /************************************************************************/
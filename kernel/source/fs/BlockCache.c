@@ -0,0 +1,995 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Block cache
+
+\************************************************************************/
+
+#include "fs/BlockCache.h"
+
+#include "core/Kernel.h"
+#include "log/Log.h"
+#include "memory/Heap.h"
+#include "memory/Memory.h"
+#include "process/Task.h"
+#include "sync/Mutex.h"
+#include "system/Clock.h"
+
+/***************************************************************************/
+
+#define BLOCK_CACHE_NO_ENTRY 0xFFFF
+#define BLOCK_CACHE_MIN_SECTOR_SIZE (BLOCK_CACHE_PAGE_SIZE / 32)  // One mask bit per sector
+#define BLOCK_CACHE_IDLE_WAIT_MS 1                              // Poll interval on a busy page or sector range
+
+/***************************************************************************/
+
+// One cached page, the sectors of a 4 KB aligned block of the disk
+
+typedef struct tag_BLOCK_CACHE_ENTRY {
+    LPSTORAGE_UNIT Disk;                // NULL when the entry is free
+    BLOCK_CACHE_TRANSFER Transfer;      // Used for write-back
+    U32 PageLow;                        // Page number, LBA / sectors per page
+    U32 PageHigh;
+    U32 BytesPerSector;
+    U32 ValidMask;                      // One bit per sector of the page
+    U32 DirtyMask;
+    U32 DirtySince;                     // Time of the first unsaved write
+    U16 Next;                           // Next entry in bucket or in free list
+    U8 Referenced;                      // CLOCK second chance
+    U8 InFlight;                        // Write-back running unlocked, the page cannot be evicted
+} BLOCK_CACHE_ENTRY, *LPBLOCK_CACHE_ENTRY;
+
+// One device transfer running with the cache mutex released
+
+typedef struct tag_BLOCK_CACHE_IO BLOCK_CACHE_IO, *LPBLOCK_CACHE_IO;
+
+struct tag_BLOCK_CACHE_IO {
+    LPBLOCK_CACHE_IO Next;
+    LPSTORAGE_UNIT Disk;
+    U64 First;                          // First sector
+    U64 End;                            // Sector after the last one
+    BOOL IsWrite;
+    BOOL Stale;                         // Read overlapped by a write started after it
+};
+
+typedef struct tag_BLOCK_CACHE_STATE {
+    MUTEX Mutex;
+    BOOL Ready;
+    BOOL Failed;
+    LINEAR Data;
+    LPBLOCK_CACHE_ENTRY Entries;
+    U16* Buckets;
+    U16 FreeHead;
+    UINT UsedPages;
+    UINT ClockHand;
+    UINT Hits;
+    UINT Misses;
+    UINT Bypassed;
+    UINT Evictions;
+    UINT WriteBacks;
+    UINT WriteBackErrors;
+    LPBLOCK_CACHE_IO Running;           // Device transfers not finished yet
+} BLOCK_CACHE_STATE, *LPBLOCK_CACHE_STATE;
+
+// Position of a sector inside the cache
+typedef struct tag_BLOCK_CACHE_CURSOR {
+    U32 PageLow;
+    U32 PageHigh;
+    U32 Slot;
+    U32 SectorsPerPage;
+} BLOCK_CACHE_CURSOR, *LPBLOCK_CACHE_CURSOR;
+
+static BLOCK_CACHE_STATE DATA_SECTION BlockCache = {
+    .Mutex = EMPTY_MUTEX,
+    .Ready = FALSE,
+    .Failed = FALSE,
+    .Data = 0,
+    .Entries = NULL,
+    .Buckets = NULL,
+    .FreeHead = BLOCK_CACHE_NO_ENTRY,
+    .UsedPages = 0,
+    .ClockHand = 0,
+    .Running = NULL};
+
+/***************************************************************************/
+
+/**
+ * @brief Allocate the page pool and the hash table, once.
+ *
+ * Must be called with the cache mutex held.
+ *
+ * @return TRUE when the cache can be used.
+ */
+static BOOL BlockCacheEnsureReady(void) {
+    UINT Index;
+
+    if (BlockCache.Ready) return TRUE;
+    if (BlockCache.Failed) return FALSE;
+
+    BlockCache.Data = AllocKernelRegion(0, BLOCK_CACHE_PAGES * BLOCK_CACHE_PAGE_SIZE,
+        ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE, TEXT("BlockCache"));
+    BlockCache.Entries = (LPBLOCK_CACHE_ENTRY)KernelHeapAlloc(BLOCK_CACHE_PAGES * sizeof(BLOCK_CACHE_ENTRY));
+    BlockCache.Buckets = (U16*)KernelHeapAlloc(BLOCK_CACHE_BUCKETS * sizeof(U16));
+
+    if (BlockCache.Data == 0 || BlockCache.Entries == NULL || BlockCache.Buckets == NULL) {
+        ERROR(TEXT("[BlockCacheEnsureReady] Allocation failed, disks run uncached"));
+
+        if (BlockCache.Data != 0) FreeRegion(BlockCache.Data, BLOCK_CACHE_PAGES * BLOCK_CACHE_PAGE_SIZE);
+        if (BlockCache.Entries != NULL) KernelHeapFree(BlockCache.Entries);
+        if (BlockCache.Buckets != NULL) KernelHeapFree(BlockCache.Buckets);
+
+        BlockCache.Data = 0;
+        BlockCache.Entries = NULL;
+        BlockCache.Buckets = NULL;
+        BlockCache.Failed = TRUE;
+        return FALSE;
+    }
+
+    MemorySet(BlockCache.Entries, 0, BLOCK_CACHE_PAGES * sizeof(BLOCK_CACHE_ENTRY));
+
+    for (Index = 0; Index < BLOCK_CACHE_BUCKETS; Index++) {
+        BlockCache.Buckets[Index] = BLOCK_CACHE_NO_ENTRY;
+    }
+
+    for (Index = 0; Index < BLOCK_CACHE_PAGES; Index++) {
+        BlockCache.Entries[Index].Next = (Index + 1 < BLOCK_CACHE_PAGES) ? (U16)(Index + 1) : BLOCK_CACHE_NO_ENTRY;
+    }
+
+    BlockCache.FreeHead = 0;
+    BlockCache.Ready = TRUE;
+
+    DEBUG(TEXT("[BlockCacheEnsureReady] %u pages at %p"), BLOCK_CACHE_PAGES, (LPVOID)BlockCache.Data);
+
+    return TRUE;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Compute the number of sectors held by one page.
+ * @param BytesPerSector Sector size of the disk.
+ * @return Sectors per page, or 0 when the sector size cannot be cached.
+ */
+static U32 BlockCacheSectorsPerPage(U32 BytesPerSector) {
+    if (BytesPerSector < BLOCK_CACHE_MIN_SECTOR_SIZE || BytesPerSector > BLOCK_CACHE_PAGE_SIZE) return 0;
+    if ((BytesPerSector & (BytesPerSector - 1)) != 0) return 0;
+
+    return BLOCK_CACHE_PAGE_SIZE / BytesPerSector;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Position a cursor on a sector.
+ * @param Cursor Cursor to set.
+ * @param SectorLow Low 32 bits of the LBA.
+ * @param SectorHigh High 32 bits of the LBA.
+ * @param SectorsPerPage Sectors per page, a power of two.
+ */
+static void BlockCacheCursorSet(LPBLOCK_CACHE_CURSOR Cursor, U32 SectorLow, U32 SectorHigh, U32 SectorsPerPage) {
+    U32 Shift = 0;
+
+    while (((U32)1 << Shift) < SectorsPerPage) Shift++;
+
+    Cursor->SectorsPerPage = SectorsPerPage;
+    Cursor->Slot = SectorLow & (SectorsPerPage - 1);
+    Cursor->PageLow = SectorLow >> Shift;
+    Cursor->PageHigh = SectorHigh >> Shift;
+
+    if (Shift != 0) {
+        Cursor->PageLow |= SectorHigh << (32 - Shift);
+    }
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Move a cursor to the next sector.
+ * @param Cursor Cursor to advance.
+ */
+static void BlockCacheCursorNext(LPBLOCK_CACHE_CURSOR Cursor) {
+    Cursor->Slot++;
+
+    if (Cursor->Slot == Cursor->SectorsPerPage) {
+        Cursor->Slot = 0;
+        Cursor->PageLow++;
+        if (Cursor->PageLow == 0) Cursor->PageHigh++;
+    }
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Hash a page key.
+ * @param Disk Disk of the page.
+ * @param PageLow Low 32 bits of the page number.
+ * @param PageHigh High 32 bits of the page number.
+ * @return Bucket index.
+ */
+static UINT BlockCacheHash(LPSTORAGE_UNIT Disk, U32 PageLow, U32 PageHigh) {
+    U32 Hash = (U32)((LINEAR)Disk >> 4);
+
+    Hash ^= PageLow * 0x9E3779B1;
+    Hash ^= PageHigh * 0x85EBCA6B;
+    Hash ^= Hash >> 15;
+
+    return Hash & (BLOCK_CACHE_BUCKETS - 1);
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Retrieve the data of a cache entry.
+ * @param Index Entry index.
+ * @return Pointer to the page data.
+ */
+static U8* BlockCachePageData(UINT Index) {
+    return (U8*)(BlockCache.Data + (Index * BLOCK_CACHE_PAGE_SIZE));
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Look up a page in the hash table.
+ *
+ * Must be called with the cache mutex held.
+ *
+ * @param Disk Disk of the page.
+ * @param Cursor Page to look for.
+ * @return Entry index, or BLOCK_CACHE_NO_ENTRY.
+ */
+static UINT BlockCacheFind(LPSTORAGE_UNIT Disk, LPBLOCK_CACHE_CURSOR Cursor) {
+    UINT Index = BlockCache.Buckets[BlockCacheHash(Disk, Cursor->PageLow, Cursor->PageHigh)];
+
+    while (Index != BLOCK_CACHE_NO_ENTRY) {
+        LPBLOCK_CACHE_ENTRY Entry = &(BlockCache.Entries[Index]);
+
+        if (Entry->Disk == Disk && Entry->PageLow == Cursor->PageLow && Entry->PageHigh == Cursor->PageHigh) {
+            return Index;
+        }
+
+        Index = Entry->Next;
+    }
+
+    return BLOCK_CACHE_NO_ENTRY;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Tell whether a device write to a sector range is running.
+ *
+ * Must be called with the cache mutex held.
+ *
+ * @param Io Transfer whose range is checked.
+ * @return TRUE when a running write overlaps the range.
+ */
+static BOOL BlockCacheWriteOverlaps(LPBLOCK_CACHE_IO Io) {
+    for (LPBLOCK_CACHE_IO Other = BlockCache.Running; Other != NULL; Other = Other->Next) {
+        if (Other->IsWrite && Other->Disk == Io->Disk && U64_Cmp(Io->First, Other->End) < 0 &&
+            U64_Cmp(Other->First, Io->End) < 0) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Run one raw transfer with the cache mutex released.
+ *
+ * Requests on other pages and other disks keep using the cache during the
+ * transfer. A transfer first waits for the running writes it overlaps, so
+ * device writes to the same sectors land in the order the cache saw them.
+ * A write started during an overlapping read may land before or after the
+ * read, or write back and evict a newer page, so such a read is retried.
+ * Must be called with the cache mutex held, returns with it held.
+ *
+ * @param Transfer Raw transfer routine of the disk.
+ * @param Control Request to send.
+ * @param IsWrite TRUE for a write.
+ * @return DF_RETURN_SUCCESS or error code.
+ */
+static U32 BlockCacheTransferUnlocked(BLOCK_CACHE_TRANSFER Transfer, LPIOCONTROL Control, BOOL IsWrite) {
+    BLOCK_CACHE_IO Io;
+    U32 Result;
+
+    Io.Disk = Control->Disk;
+    Io.First = U64_Make(Control->SectorHigh, Control->SectorLow);
+    Io.End = U64_Add(Io.First, U64_FromU32(Control->NumSectors));
+    Io.IsWrite = IsWrite;
+
+    FOREVER {
+        LPBLOCK_CACHE_IO* Link;
+
+        while (BlockCacheWriteOverlaps(&Io)) {
+            UnlockMutex(&(BlockCache.Mutex));
+            Sleep(BLOCK_CACHE_IDLE_WAIT_MS);
+            LockMutex(&(BlockCache.Mutex), INFINITY);
+        }
+
+        if (IsWrite) {
+            for (LPBLOCK_CACHE_IO Other = BlockCache.Running; Other != NULL; Other = Other->Next) {
+                if (Other->Disk == Io.Disk && U64_Cmp(Io.First, Other->End) < 0 && U64_Cmp(Other->First, Io.End) < 0) {
+                    Other->Stale = TRUE;
+                }
+            }
+        }
+
+        Io.Stale = FALSE;
+        Io.Next = BlockCache.Running;
+        BlockCache.Running = &Io;
+
+        UnlockMutex(&(BlockCache.Mutex));
+        Result = Transfer(Control, IsWrite);
+        LockMutex(&(BlockCache.Mutex), INFINITY);
+
+        for (Link = &(BlockCache.Running); *Link != &Io; Link = &((*Link)->Next)) {
+        }
+        *Link = Io.Next;
+
+        if (IsWrite || Io.Stale == FALSE || Result != DF_RETURN_SUCCESS) return Result;
+    }
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Wait until no write-back runs on an entry.
+ *
+ * Must be called with the cache mutex held. The mutex is released while
+ * waiting, so the caller must check the entry again afterwards.
+ *
+ * @param Index Entry index.
+ */
+static void BlockCacheWaitIdle(UINT Index) {
+    while (BlockCache.Entries[Index].InFlight) {
+        UnlockMutex(&(BlockCache.Mutex));
+        Sleep(BLOCK_CACHE_IDLE_WAIT_MS);
+        LockMutex(&(BlockCache.Mutex), INFINITY);
+    }
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Remove an entry from its hash chain and put it in the free list.
+ *
+ * Must be called with the cache mutex held.
+ *
+ * @param Index Entry index.
+ */
+static void BlockCacheRelease(UINT Index) {
+    LPBLOCK_CACHE_ENTRY Entry = &(BlockCache.Entries[Index]);
+    U16* Link = &(BlockCache.Buckets[BlockCacheHash(Entry->Disk, Entry->PageLow, Entry->PageHigh)]);
+
+    while (*Link != BLOCK_CACHE_NO_ENTRY) {
+        if (*Link == Index) {
+            *Link = Entry->Next;
+            break;
+        }
+
+        Link = &(BlockCache.Entries[*Link].Next);
+    }
+
+    MemorySet(Entry, 0, sizeof(BLOCK_CACHE_ENTRY));
+    Entry->Next = BlockCache.FreeHead;
+    BlockCache.FreeHead = (U16)Index;
+    BlockCache.UsedPages--;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Write the dirty sectors of a page to its disk.
+ *
+ * Consecutive dirty sectors are sent with a single request. The page is
+ * marked in flight and the mutex is released during each transfer. Its
+ * dirty bits are cleared up front, so sectors written meanwhile stay dirty
+ * for the next write-back. Must be called with the cache mutex held.
+ *
+ * @param Index Entry index.
+ * @return TRUE when the page is clean.
+ */
+static BOOL BlockCacheWriteBack(UINT Index) {
+    LPBLOCK_CACHE_ENTRY Entry = &(BlockCache.Entries[Index]);
+    U32 SectorsPerPage = BLOCK_CACHE_PAGE_SIZE / Entry->BytesPerSector;
+    U32 Shift = 0;
+    U32 Slot = 0;
+    U32 Pending;
+    BOOL Written = TRUE;
+
+    if (Entry->DirtyMask == 0) return TRUE;
+    if (Entry->InFlight) return FALSE;
+
+    while (((U32)1 << Shift) < SectorsPerPage) Shift++;
+
+    Pending = Entry->DirtyMask;
+    Entry->DirtyMask = 0;
+    Entry->InFlight = 1;
+
+    while (Slot < SectorsPerPage) {
+        IOCONTROL Control;
+        U32 First;
+        U32 Result;
+
+        if ((Pending & ((U32)1 << Slot)) == 0) {
+            Slot++;
+            continue;
+        }
+
+        First = Slot;
+        while (Slot < SectorsPerPage && (Pending & ((U32)1 << Slot)) != 0) Slot++;
+
+        MemorySet(&Control, 0, sizeof(Control));
+        Control.TypeID = KOID_IOCONTROL;
+        Control.Disk = Entry->Disk;
+        Control.SectorLow = (Entry->PageLow << Shift) | First;
+        Control.SectorHigh = (Entry->PageHigh << Shift);
+        if (Shift != 0) Control.SectorHigh |= Entry->PageLow >> (32 - Shift);
+        Control.NumSectors = Slot - First;
+        Control.Buffer = BlockCachePageData(Index) + (First * Entry->BytesPerSector);
+        Control.BufferSize = Control.NumSectors * Entry->BytesPerSector;
+
+        Result = BlockCacheTransferUnlocked(Entry->Transfer, &Control, TRUE);
+
+        if (Result != DF_RETURN_SUCCESS) {
+            BlockCache.WriteBackErrors++;
+            WARNING(TEXT("[BlockCacheWriteBack] Disk %p sector %x:%x count %u failed (%u)"), Entry->Disk,
+                Control.SectorHigh, Control.SectorLow, Control.NumSectors, Result);
+
+            // The failed run and the ones not sent yet stay dirty
+            Entry->DirtyMask |= Pending;
+            Written = FALSE;
+            break;
+        }
+
+        for (U32 Clear = First; Clear < Slot; Clear++) {
+            Pending &= ~((U32)1 << Clear);
+        }
+    }
+
+    Entry->InFlight = 0;
+
+    if (Written) BlockCache.WriteBacks++;
+
+    return (Written && Entry->DirtyMask == 0);
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Take a free entry, evicting one with CLOCK when the cache is full.
+ *
+ * Referenced pages get a second chance and pages being written back are
+ * skipped. A dirty victim is written back before reuse, with the mutex
+ * released, and skipped when the write fails or when the page was used
+ * again meanwhile. Must be called with the cache mutex held.
+ *
+ * @param CleanOnly TRUE to only reuse clean pages, the mutex is then never released.
+ * @return Entry index, or BLOCK_CACHE_NO_ENTRY.
+ */
+static UINT BlockCacheAllocate(BOOL CleanOnly) {
+    UINT Index = BlockCache.FreeHead;
+
+    if (Index == BLOCK_CACHE_NO_ENTRY) {
+        for (UINT Step = 0; Step < BLOCK_CACHE_PAGES * 3; Step++) {
+            UINT Candidate = BlockCache.ClockHand;
+            LPBLOCK_CACHE_ENTRY Entry = &(BlockCache.Entries[Candidate]);
+
+            // A page was freed while the mutex was released
+            if (BlockCache.FreeHead != BLOCK_CACHE_NO_ENTRY) break;
+
+            BlockCache.ClockHand = (BlockCache.ClockHand + 1) % BLOCK_CACHE_PAGES;
+
+            if (Entry->InFlight) continue;
+
+            if (Entry->Referenced) {
+                Entry->Referenced = 0;
+                continue;
+            }
+
+            if (CleanOnly && Entry->DirtyMask != 0) continue;
+
+            if (BlockCacheWriteBack(Candidate) == FALSE || Entry->Referenced) continue;
+
+            BlockCacheRelease(Candidate);
+            BlockCache.Evictions++;
+            break;
+        }
+
+        Index = BlockCache.FreeHead;
+        if (Index == BLOCK_CACHE_NO_ENTRY) return BLOCK_CACHE_NO_ENTRY;
+    }
+
+    BlockCache.FreeHead = BlockCache.Entries[Index].Next;
+    BlockCache.UsedPages++;
+
+    return Index;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Find the page of a sector, optionally creating it.
+ *
+ * Must be called with the cache mutex held. Creating a page may release the
+ * mutex to write back a victim.
+ *
+ * @param Disk Disk of the page.
+ * @param Cursor Page to look for.
+ * @param BytesPerSector Sector size of the disk.
+ * @param Transfer Raw transfer routine of the disk.
+ * @param Create TRUE to create a missing page.
+ * @param CleanOnly TRUE to create it without writing back a dirty victim.
+ * @return Entry index, or BLOCK_CACHE_NO_ENTRY.
+ */
+static UINT BlockCacheGetPage(LPSTORAGE_UNIT Disk, LPBLOCK_CACHE_CURSOR Cursor, U32 BytesPerSector,
+    BLOCK_CACHE_TRANSFER Transfer, BOOL Create, BOOL CleanOnly) {
+    UINT Index = BlockCacheFind(Disk, Cursor);
+    UINT Existing;
+    UINT Bucket;
+    LPBLOCK_CACHE_ENTRY Entry;
+
+    if (Index != BLOCK_CACHE_NO_ENTRY || Create == FALSE) return Index;
+
+    Index = BlockCacheAllocate(CleanOnly);
+    if (Index == BLOCK_CACHE_NO_ENTRY) return Index;
+
+    // Another request may have created the page while the mutex was released
+    Existing = BlockCacheFind(Disk, Cursor);
+
+    if (Existing != BLOCK_CACHE_NO_ENTRY) {
+        BlockCache.Entries[Index].Next = BlockCache.FreeHead;
+        BlockCache.FreeHead = (U16)Index;
+        BlockCache.UsedPages--;
+        return Existing;
+    }
+
+    Bucket = BlockCacheHash(Disk, Cursor->PageLow, Cursor->PageHigh);
+    Entry = &(BlockCache.Entries[Index]);
+    Entry->Disk = Disk;
+    Entry->Transfer = Transfer;
+    Entry->PageLow = Cursor->PageLow;
+    Entry->PageHigh = Cursor->PageHigh;
+    Entry->BytesPerSector = BytesPerSector;
+    Entry->ValidMask = 0;
+    Entry->DirtyMask = 0;
+    Entry->Referenced = 0;
+    Entry->Next = BlockCache.Buckets[Bucket];
+    BlockCache.Buckets[Bucket] = (U16)Index;
+
+    return Index;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Copy sectors that reached or came from the device into the cache.
+ *
+ * Sectors already valid in the cache are newer than the device for reads,
+ * so they are only overwritten when Overwrite is set (writes). Reads only
+ * take clean pages, so the mutex stays held and the data cannot go stale
+ * while it is stored. Must be called with the cache mutex held.
+ *
+ * @param Control Request the data belongs to.
+ * @param First Index of the first sector in the request.
+ * @param Count Number of sectors.
+ * @param BytesPerSector Sector size of the disk.
+ * @param Transfer Raw transfer routine of the disk.
+ * @param Create TRUE to create missing pages.
+ * @param Overwrite TRUE when the data supersedes the cached copy.
+ */
+static void BlockCacheStore(LPIOCONTROL Control, U32 First, U32 Count, U32 BytesPerSector,
+    BLOCK_CACHE_TRANSFER Transfer, BOOL Create, BOOL Overwrite) {
+    U64 Sector = U64_Add(U64_Make(Control->SectorHigh, Control->SectorLow), U64_FromU32(First));
+    const U8* Source = (const U8*)Control->Buffer + (First * BytesPerSector);
+    BLOCK_CACHE_CURSOR Cursor;
+    UINT Index = BLOCK_CACHE_NO_ENTRY;
+
+    BlockCacheCursorSet(&Cursor, U64_Low32(Sector), U64_High32(Sector), BLOCK_CACHE_PAGE_SIZE / BytesPerSector);
+
+    for (U32 Current = 0; Current < Count; Current++, BlockCacheCursorNext(&Cursor)) {
+        U32 Bit = (U32)1 << Cursor.Slot;
+
+        if (Current == 0 || Cursor.Slot == 0) {
+            Index = BlockCacheGetPage(Control->Disk, &Cursor, BytesPerSector, Transfer, Create, Overwrite == FALSE);
+        }
+
+        if (Index == BLOCK_CACHE_NO_ENTRY) continue;
+
+        LPBLOCK_CACHE_ENTRY Entry = &(BlockCache.Entries[Index]);
+
+        if ((Entry->ValidMask & Bit) == 0 || Overwrite) {
+            MemoryCopy(BlockCachePageData(Index) + (Cursor.Slot * BytesPerSector),
+                Source + (Current * BytesPerSector), BytesPerSector);
+            Entry->ValidMask |= Bit;
+            if (Overwrite) Entry->DirtyMask &= ~Bit;
+        }
+    }
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Copy the cached sectors of a range over data read from the device.
+ *
+ * A cached sector is never older than the device, so it wins over a read
+ * done without the cache mutex. Must be called with the cache mutex held.
+ *
+ * @param Control Request that was read.
+ * @param BytesPerSector Sector size of the disk.
+ */
+static void BlockCacheOverlay(LPIOCONTROL Control, U32 BytesPerSector) {
+    BLOCK_CACHE_CURSOR Cursor;
+    U8* Destination = (U8*)Control->Buffer;
+    UINT Index = BLOCK_CACHE_NO_ENTRY;
+
+    if (BlockCache.UsedPages == 0) return;
+
+    BlockCacheCursorSet(&Cursor, Control->SectorLow, Control->SectorHigh, BLOCK_CACHE_PAGE_SIZE / BytesPerSector);
+
+    for (U32 Current = 0; Current < Control->NumSectors; Current++, BlockCacheCursorNext(&Cursor)) {
+        if (Current == 0 || Cursor.Slot == 0) {
+            Index = BlockCacheFind(Control->Disk, &Cursor);
+        }
+
+        if (Index == BLOCK_CACHE_NO_ENTRY) continue;
+
+        if (BlockCache.Entries[Index].ValidMask & ((U32)1 << Cursor.Slot)) {
+            MemoryCopy(Destination + (Current * BytesPerSector),
+                BlockCachePageData(Index) + (Cursor.Slot * BytesPerSector), BytesPerSector);
+        }
+    }
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Read a run of missing sectors into the caller buffer and cache them.
+ *
+ * The device is read with the mutex released. Sectors cached meanwhile are
+ * newer and replace what the device returned. Must be called with the cache
+ * mutex held.
+ *
+ * @param Control Caller request.
+ * @param First Index of the first sector in the request.
+ * @param Count Number of sectors.
+ * @param BytesPerSector Sector size of the disk.
+ * @param Transfer Raw transfer routine of the disk.
+ * @return DF_RETURN_SUCCESS or error code.
+ */
+static U32 BlockCacheReadRun(LPIOCONTROL Control, U32 First, U32 Count, U32 BytesPerSector,
+    BLOCK_CACHE_TRANSFER Transfer) {
+    U64 Sector = U64_Add(U64_Make(Control->SectorHigh, Control->SectorLow), U64_FromU32(First));
+    IOCONTROL Run;
+    U32 Result;
+
+    MemorySet(&Run, 0, sizeof(Run));
+    Run.TypeID = KOID_IOCONTROL;
+    Run.Disk = Control->Disk;
+    Run.SectorLow = U64_Low32(Sector);
+    Run.SectorHigh = U64_High32(Sector);
+    Run.NumSectors = Count;
+    Run.Buffer = (U8*)Control->Buffer + (First * BytesPerSector);
+    Run.BufferSize = Count * BytesPerSector;
+
+    Result = BlockCacheTransferUnlocked(Transfer, &Run, FALSE);
+
+    if (Result == DF_RETURN_SUCCESS) {
+        BlockCache.Misses += Count;
+        BlockCacheStore(Control, First, Count, BytesPerSector, Transfer, TRUE, FALSE);
+        BlockCacheOverlay(&Run, BytesPerSector);
+    }
+
+    return Result;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Forget the cached sectors of a range.
+ *
+ * Used when a write to the device failed after the cache took its data.
+ * Must be called with the cache mutex held.
+ *
+ * @param Control Request that failed.
+ * @param BytesPerSector Sector size of the disk.
+ */
+static void BlockCacheDiscard(LPIOCONTROL Control, U32 BytesPerSector) {
+    BLOCK_CACHE_CURSOR Cursor;
+    UINT Index = BLOCK_CACHE_NO_ENTRY;
+
+    BlockCacheCursorSet(&Cursor, Control->SectorLow, Control->SectorHigh, BLOCK_CACHE_PAGE_SIZE / BytesPerSector);
+
+    for (U32 Current = 0; Current < Control->NumSectors; Current++, BlockCacheCursorNext(&Cursor)) {
+        U32 Bit = (U32)1 << Cursor.Slot;
+
+        if (Current == 0 || Cursor.Slot == 0) {
+            Index = BlockCacheFind(Control->Disk, &Cursor);
+        }
+
+        if (Index == BLOCK_CACHE_NO_ENTRY) continue;
+
+        BlockCache.Entries[Index].ValidMask &= ~Bit;
+        BlockCache.Entries[Index].DirtyMask &= ~Bit;
+    }
+}
+
+/***************************************************************************/
+
+U32 BlockCacheRead(LPIOCONTROL Control, U32 BytesPerSector, BLOCK_CACHE_TRANSFER Transfer) {
+    BLOCK_CACHE_CURSOR Cursor;
+    U8* Destination;
+    U32 SectorsPerPage;
+    U32 RunStart = 0;
+    U32 RunLength = 0;
+    U32 Result = DF_RETURN_SUCCESS;
+    UINT Index = BLOCK_CACHE_NO_ENTRY;
+    BOOL Lookup = TRUE;
+
+    if (Control == NULL || Transfer == NULL) return DF_RETURN_BAD_PARAMETER;
+
+    SectorsPerPage = BlockCacheSectorsPerPage(BytesPerSector);
+    if (SectorsPerPage == 0) return Transfer(Control, FALSE);
+
+    Destination = (U8*)Control->Buffer;
+
+    if (Destination == NULL || Control->NumSectors == 0 ||
+        Control->NumSectors > BLOCK_CACHE_MAX_CACHED_BYTES / BytesPerSector) {
+        BlockCache.Bypassed++;
+
+        if (Destination == NULL || BlockCache.Ready == FALSE) return Transfer(Control, FALSE);
+
+        LockMutex(&(BlockCache.Mutex), INFINITY);
+
+        Result = BlockCacheTransferUnlocked(Transfer, Control, FALSE);
+        if (Result == DF_RETURN_SUCCESS) BlockCacheOverlay(Control, BytesPerSector);
+
+        UnlockMutex(&(BlockCache.Mutex));
+
+        return Result;
+    }
+
+    LockMutex(&(BlockCache.Mutex), INFINITY);
+
+    if (BlockCacheEnsureReady() == FALSE) {
+        UnlockMutex(&(BlockCache.Mutex));
+        return Transfer(Control, FALSE);
+    }
+
+    BlockCacheCursorSet(&Cursor, Control->SectorLow, Control->SectorHigh, SectorsPerPage);
+
+    for (U32 Current = 0; Current < Control->NumSectors; Current++, BlockCacheCursorNext(&Cursor)) {
+        U32 Bit = (U32)1 << Cursor.Slot;
+
+        if (Lookup || Cursor.Slot == 0) {
+            Index = BlockCacheFind(Control->Disk, &Cursor);
+            Lookup = FALSE;
+        }
+
+        if (Index == BLOCK_CACHE_NO_ENTRY || (BlockCache.Entries[Index].ValidMask & Bit) == 0) {
+            if (RunLength == 0) RunStart = Current;
+            RunLength++;
+            continue;
+        }
+
+        // Copy the hit first, reading the pending run may evict it
+        MemoryCopy(Destination + (Current * BytesPerSector),
+            BlockCachePageData(Index) + (Cursor.Slot * BytesPerSector), BytesPerSector);
+        BlockCache.Entries[Index].Referenced = 1;
+        BlockCache.Hits++;
+
+        if (RunLength != 0) {
+            Result = BlockCacheReadRun(Control, RunStart, RunLength, BytesPerSector, Transfer);
+            if (Result != DF_RETURN_SUCCESS) break;
+            RunLength = 0;
+            Lookup = TRUE;
+        }
+    }
+
+    if (Result == DF_RETURN_SUCCESS && RunLength != 0) {
+        Result = BlockCacheReadRun(Control, RunStart, RunLength, BytesPerSector, Transfer);
+    }
+
+    UnlockMutex(&(BlockCache.Mutex));
+
+    return Result;
+}
+
+/***************************************************************************/
+
+U32 BlockCacheWrite(LPIOCONTROL Control, U32 BytesPerSector, BLOCK_CACHE_TRANSFER Transfer, U32 Flags) {
+    BLOCK_CACHE_CURSOR Cursor;
+    const U8* Source;
+    U32 SectorsPerPage;
+    U32 Result;
+    UINT Index = BLOCK_CACHE_NO_ENTRY;
+    BOOL Small;
+
+    if (Control == NULL || Transfer == NULL) return DF_RETURN_BAD_PARAMETER;
+
+    SectorsPerPage = BlockCacheSectorsPerPage(BytesPerSector);
+    Source = (const U8*)Control->Buffer;
+
+    if (SectorsPerPage == 0 || Source == NULL || Control->NumSectors == 0) return Transfer(Control, TRUE);
+
+    Small = (Control->NumSectors <= BLOCK_CACHE_MAX_CACHED_BYTES / BytesPerSector);
+    if (Small == FALSE) BlockCache.Bypassed++;
+
+    LockMutex(&(BlockCache.Mutex), INFINITY);
+
+    if (BlockCacheEnsureReady() == FALSE) {
+        UnlockMutex(&(BlockCache.Mutex));
+        return Transfer(Control, TRUE);
+    }
+
+    if (Small && (Flags & BLOCK_CACHE_WRITE_THROUGH) == 0) {
+        U32 Now = GetSystemTime();
+        U32 Current;
+
+        BlockCacheCursorSet(&Cursor, Control->SectorLow, Control->SectorHigh, SectorsPerPage);
+
+        for (Current = 0; Current < Control->NumSectors; Current++, BlockCacheCursorNext(&Cursor)) {
+            U32 Bit = (U32)1 << Cursor.Slot;
+
+            if (Current == 0 || Cursor.Slot == 0) {
+                Index = BlockCacheGetPage(Control->Disk, &Cursor, BytesPerSector, Transfer, TRUE, FALSE);
+                if (Index == BLOCK_CACHE_NO_ENTRY) break;
+            }
+
+            LPBLOCK_CACHE_ENTRY Entry = &(BlockCache.Entries[Index]);
+
+            MemoryCopy(BlockCachePageData(Index) + (Cursor.Slot * BytesPerSector),
+                Source + (Current * BytesPerSector), BytesPerSector);
+
+            if (Entry->DirtyMask == 0) Entry->DirtySince = Now;
+            Entry->ValidMask |= Bit;
+            Entry->DirtyMask |= Bit;
+            Entry->Referenced = 1;
+        }
+
+        if (Current == Control->NumSectors) {
+            UnlockMutex(&(BlockCache.Mutex));
+            return DF_RETURN_SUCCESS;
+        }
+
+        // No page left, write the whole request through
+    }
+
+    // Supersede the cached copies first, so no later write-back carries older
+    // data. Write-backs already running land before this write.
+    BlockCacheStore(Control, 0, Control->NumSectors, BytesPerSector, Transfer, Small, TRUE);
+
+    Result = BlockCacheTransferUnlocked(Transfer, Control, TRUE);
+
+    if (Result != DF_RETURN_SUCCESS) {
+        BlockCacheDiscard(Control, BytesPerSector);
+    }
+
+    UnlockMutex(&(BlockCache.Mutex));
+
+    return Result;
+}
+
+/***************************************************************************/
+
+BOOL BlockCacheFlush(LPSTORAGE_UNIT Disk) {
+    BOOL Clean = TRUE;
+
+    if (BlockCache.Ready == FALSE) return TRUE;
+
+    LockMutex(&(BlockCache.Mutex), INFINITY);
+
+    for (UINT Index = 0; Index < BLOCK_CACHE_PAGES; Index++) {
+        LPBLOCK_CACHE_ENTRY Entry = &(BlockCache.Entries[Index]);
+
+        if (Entry->Disk == NULL || (Entry->DirtyMask == 0 && Entry->InFlight == 0)) continue;
+        if (Disk != NULL && Entry->Disk != Disk) continue;
+
+        // Let a running write-back finish, the page may have changed meanwhile
+        BlockCacheWaitIdle(Index);
+        if (Entry->Disk == NULL || (Disk != NULL && Entry->Disk != Disk)) continue;
+
+        if (BlockCacheWriteBack(Index) == FALSE) Clean = FALSE;
+    }
+
+    UnlockMutex(&(BlockCache.Mutex));
+
+    return Clean;
+}
+
+/***************************************************************************/
+
+void BlockCacheFlushExpired(U32 Now) {
+    if (BlockCache.Ready == FALSE) return;
+
+    LockMutex(&(BlockCache.Mutex), INFINITY);
+
+    for (UINT Index = 0; Index < BLOCK_CACHE_PAGES; Index++) {
+        LPBLOCK_CACHE_ENTRY Entry = &(BlockCache.Entries[Index]);
+
+        if (Entry->Disk == NULL || Entry->DirtyMask == 0 || Entry->InFlight) continue;
+        if (Now - Entry->DirtySince < BLOCK_CACHE_WRITEBACK_DELAY_MS) continue;
+
+        // On failure, retry on a later pass
+        if (BlockCacheWriteBack(Index) == FALSE) Entry->DirtySince = Now;
+    }
+
+    UnlockMutex(&(BlockCache.Mutex));
+}
+
+/***************************************************************************/
+
+void BlockCacheInvalidateDisk(LPSTORAGE_UNIT Disk) {
+    UINT Dropped = 0;
+
+    if (BlockCache.Ready == FALSE || Disk == NULL) return;
+
+    LockMutex(&(BlockCache.Mutex), INFINITY);
+
+    for (UINT Index = 0; Index < BLOCK_CACHE_PAGES; Index++) {
+        LPBLOCK_CACHE_ENTRY Entry = &(BlockCache.Entries[Index]);
+
+        if (Entry->Disk != Disk) continue;
+
+        // The page data is in use until its write-back returns
+        BlockCacheWaitIdle(Index);
+
+        if (Entry->Disk != Disk) continue;
+        if (Entry->DirtyMask != 0) Dropped++;
+
+        BlockCacheRelease(Index);
+    }
+
+    UnlockMutex(&(BlockCache.Mutex));
+
+    if (Dropped != 0) {
+        WARNING(TEXT("[BlockCacheInvalidateDisk] Disk %p: %u dirty pages lost"), Disk, Dropped);
+    }
+}
+
+/***************************************************************************/
+
+void BlockCacheGetInfo(LPBLOCK_CACHE_INFO Info) {
+    if (Info == NULL) return;
+
+    MemorySet(Info, 0, sizeof(BLOCK_CACHE_INFO));
+
+    if (BlockCache.Ready == FALSE) return;
+
+    LockMutex(&(BlockCache.Mutex), INFINITY);
+
+    Info->Capacity = BLOCK_CACHE_PAGES;
+    Info->UsedPages = BlockCache.UsedPages;
+    Info->Hits = BlockCache.Hits;
+    Info->Misses = BlockCache.Misses;
+    Info->Bypassed = BlockCache.Bypassed;
+    Info->Evictions = BlockCache.Evictions;
+    Info->WriteBacks = BlockCache.WriteBacks;
+    Info->WriteBackErrors = BlockCache.WriteBackErrors;
+
+    for (UINT Index = 0; Index < BLOCK_CACHE_PAGES; Index++) {
+        if (BlockCache.Entries[Index].DirtyMask != 0) Info->DirtyPages++;
+    }
+
+    UnlockMutex(&(BlockCache.Mutex));
+}
@@ -0,0 +1,552 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Asynchronous block I/O
+
+\************************************************************************/
+
+#include "fs/BlockIO.h"
+
+#include "core/Kernel.h"
+#include "log/Log.h"
+#include "memory/Memory.h"
+#include "process/Process.h"
+#include "process/Schedule.h"
+#include "process/Task.h"
+#include "system/Clock.h"
+#include "text/CoreString.h"
+
+/***************************************************************************/
+
+// Per-disk request queue, served by its own kernel task
+
+typedef struct tag_BLOCK_IO_QUEUE {
+    LPSTORAGE_UNIT Disk;                // NULL when the slot is free
+    MUTEX Mutex;                        // Protects Pending and Head
+    LPBLOCK_REQUEST Pending;            // Sorted by first sector
+    U64 Head;                           // Sector following the last dispatch
+    U32 BytesPerSector;
+    LINEAR Staging;                     // Bounce area of merged commands
+    LPTASK Task;
+    BOOL Used;                          // Slot has a mutex and a task
+    BLOCK_IO_INFO Info;
+} BLOCK_IO_QUEUE, *LPBLOCK_IO_QUEUE;
+
+static MUTEX DATA_SECTION BlockIOMutex = EMPTY_MUTEX;
+static BLOCK_IO_QUEUE DATA_SECTION BlockIOQueues[BLOCK_IO_MAX_QUEUES];
+
+/***************************************************************************/
+
+/**
+ * @brief Retrieve the first sector of a request.
+ * @param Request Request.
+ * @return First sector.
+ */
+static U64 BlockRequestStart(LPBLOCK_REQUEST Request) {
+    return U64_Make(Request->Control.SectorHigh, Request->Control.SectorLow);
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Tell whether a request is done, SleepUntil condition.
+ * @param Context Request.
+ * @return TRUE once the request left the queued state.
+ */
+static BOOL BlockRequestIsDone(LPVOID Context) {
+    return ((LPBLOCK_REQUEST)Context)->State != BLOCK_REQUEST_QUEUED;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Tell whether a queue holds requests, SleepUntil condition.
+ * @param Context Queue.
+ * @return TRUE when a request is pending.
+ */
+static BOOL BlockIOQueueHasWork(LPVOID Context) {
+    return ((LPBLOCK_IO_QUEUE)Context)->Pending != NULL;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Publish the result of a request and wake whoever waits for it.
+ *
+ * The event is signaled and the callback runs before the state changes to
+ * done, so that the caller may reuse the request as soon as it sees it done.
+ * The state changes and the waiter is woken with interrupts disabled, so a
+ * waiter either sees the request done or is sleeping when the wake comes.
+ *
+ * @param Request Finished request.
+ * @param Result DF_RETURN_* code.
+ */
+static void BlockRequestComplete(LPBLOCK_REQUEST Request, U32 Result) {
+    U32 Flags;
+
+    Request->Result = Result;
+    Request->Next = NULL;
+
+    SAFE_USE(Request->Completion) {
+        SignalKernelEvent(Request->Completion);
+    }
+
+    SAFE_USE(Request->Callback) {
+        Request->Callback(Request);
+    }
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    Request->State = BLOCK_REQUEST_DONE;
+    WakeUpTask(Request->Waiter);
+
+    RestoreFlags(&Flags);
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Send one request to the disk driver.
+ * @param Request Request to run.
+ * @return DF_RETURN_* code of the driver.
+ */
+static U32 BlockIORunRequest(LPBLOCK_REQUEST Request) {
+    LPSTORAGE_UNIT Disk = Request->Control.Disk;
+
+    return Disk->Driver->Command(Request->IsWrite ? DF_DISK_WRITE : DF_DISK_READ, (UINT)&(Request->Control));
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Take the next batch of the queue, C-LOOK order.
+ *
+ * The first request at or after the head position is taken, or the lowest
+ * one when the head passed every request. Following requests in the same
+ * direction whose first sector is the end of the batch are appended, as
+ * long as the batch fits the staging area.
+ *
+ * @param Queue Queue to serve.
+ * @return Chain of requests linked by Next, or NULL when the queue is empty.
+ */
+static LPBLOCK_REQUEST BlockIOTakeBatch(LPBLOCK_IO_QUEUE Queue) {
+    LPBLOCK_REQUEST* Link;
+    LPBLOCK_REQUEST First;
+    LPBLOCK_REQUEST Last;
+    U64 End;
+    U32 Bytes;
+    U32 Limit;
+
+    LockMutex(&(Queue->Mutex), INFINITY);
+
+    if (Queue->Pending == NULL) {
+        UnlockMutex(&(Queue->Mutex));
+        return NULL;
+    }
+
+    Link = &(Queue->Pending);
+    while (*Link != NULL && U64_Cmp(BlockRequestStart(*Link), Queue->Head) < 0) {
+        Link = &((*Link)->Next);
+    }
+
+    if (*Link == NULL) Link = &(Queue->Pending);
+
+    First = *Link;
+    *Link = First->Next;
+    First->Next = NULL;
+    Last = First;
+
+    End = U64_Add(BlockRequestStart(First), U64_FromU32(First->Control.NumSectors));
+    Bytes = First->Control.NumSectors * Queue->BytesPerSector;
+    Limit = (Queue->Staging != 0) ? BLOCK_IO_MERGE_BYTES : 0;
+
+    // Link now points to the request that followed First
+    while (*Link != NULL) {
+        LPBLOCK_REQUEST Candidate = *Link;
+        U32 CandidateBytes = Candidate->Control.NumSectors * Queue->BytesPerSector;
+
+        if (Candidate->IsWrite != First->IsWrite) break;
+        if (U64_Cmp(BlockRequestStart(Candidate), End) != 0) break;
+        if (Bytes + CandidateBytes > Limit) break;
+
+        *Link = Candidate->Next;
+        Candidate->Next = NULL;
+        Last->Next = Candidate;
+        Last = Candidate;
+
+        End = U64_Add(End, U64_FromU32(Candidate->Control.NumSectors));
+        Bytes += CandidateBytes;
+        Queue->Info.Merged++;
+    }
+
+    Queue->Head = End;
+    Queue->Info.Pending--;
+    for (LPBLOCK_REQUEST Request = First->Next; Request != NULL; Request = Request->Next) {
+        Queue->Info.Pending--;
+    }
+
+    UnlockMutex(&(Queue->Mutex));
+
+    return First;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Run a batch as one driver command and complete its requests.
+ *
+ * A single request uses its own buffer. A merged batch goes through the
+ * staging area: writes are gathered before the command, reads are
+ * scattered after it.
+ *
+ * @param Queue Queue that owns the batch.
+ * @param Batch Chain of requests from BlockIOTakeBatch.
+ */
+static void BlockIODispatch(LPBLOCK_IO_QUEUE Queue, LPBLOCK_REQUEST Batch) {
+    LPBLOCK_REQUEST Request;
+    LPBLOCK_REQUEST Next;
+    IOCONTROL Control;
+    U8* Staging = (U8*)Queue->Staging;
+    U32 Offset;
+    U32 Result;
+
+    Queue->Info.Commands++;
+
+    if (Batch->Next == NULL) {
+        BlockRequestComplete(Batch, BlockIORunRequest(Batch));
+        return;
+    }
+
+    MemorySet(&Control, 0, sizeof(Control));
+    Control.TypeID = KOID_IOCONTROL;
+    Control.Disk = Batch->Control.Disk;
+    Control.SectorLow = Batch->Control.SectorLow;
+    Control.SectorHigh = Batch->Control.SectorHigh;
+    Control.Buffer = Staging;
+
+    Offset = 0;
+    for (Request = Batch; Request != NULL; Request = Request->Next) {
+        U32 Bytes = Request->Control.NumSectors * Queue->BytesPerSector;
+
+        if (Batch->IsWrite) MemoryCopy(Staging + Offset, Request->Control.Buffer, Bytes);
+
+        Control.NumSectors += Request->Control.NumSectors;
+        Offset += Bytes;
+    }
+
+    Control.BufferSize = Offset;
+
+    Result = Control.Disk->Driver->Command(Batch->IsWrite ? DF_DISK_WRITE : DF_DISK_READ, (UINT)&Control);
+
+    Offset = 0;
+    for (Request = Batch; Request != NULL; Request = Next) {
+        U32 Bytes = Request->Control.NumSectors * Queue->BytesPerSector;
+
+        Next = Request->Next;
+
+        if (Batch->IsWrite == FALSE && Result == DF_RETURN_SUCCESS) {
+            MemoryCopy(Request->Control.Buffer, Staging + Offset, Bytes);
+        }
+
+        Offset += Bytes;
+        BlockRequestComplete(Request, Result);
+    }
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Queue task, serves one disk forever.
+ *
+ * The task sleeps without deadline while the queue is empty, BlockIOSubmit
+ * wakes it.
+ *
+ * @param Parameter Queue to serve.
+ * @return Never returns.
+ */
+static U32 BlockIOQueueTask(LPVOID Parameter) {
+    LPBLOCK_IO_QUEUE Queue = (LPBLOCK_IO_QUEUE)Parameter;
+
+    FOREVER {
+        LPBLOCK_REQUEST Batch = BlockIOTakeBatch(Queue);
+
+        if (Batch == NULL) {
+            SleepUntil(BlockIOQueueHasWork, Queue, INFINITY);
+            continue;
+        }
+
+        BlockIODispatch(Queue, Batch);
+    }
+
+    return 0;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Find the queue of a disk, creating it when Create is set.
+ *
+ * A slot freed by BlockIODetachDisk keeps its task and is reused.
+ *
+ * @param Disk Disk to look for.
+ * @param Create TRUE to create a missing queue.
+ * @return Queue, or NULL.
+ */
+static LPBLOCK_IO_QUEUE BlockIOGetQueue(LPSTORAGE_UNIT Disk, BOOL Create) {
+    LPBLOCK_IO_QUEUE Queue = NULL;
+    DISKINFO DiskInfo;
+
+    LockMutex(&BlockIOMutex, INFINITY);
+
+    for (UINT Index = 0; Index < BLOCK_IO_MAX_QUEUES; Index++) {
+        if (BlockIOQueues[Index].Disk == Disk) {
+            UnlockMutex(&BlockIOMutex);
+            return &(BlockIOQueues[Index]);
+        }
+    }
+
+    if (Create == FALSE) {
+        UnlockMutex(&BlockIOMutex);
+        return NULL;
+    }
+
+    MemorySet(&DiskInfo, 0, sizeof(DiskInfo));
+    DiskInfo.TypeID = KOID_IOCONTROL;
+    DiskInfo.Disk = Disk;
+
+    if (Disk->Driver->Command(DF_DISK_GETINFO, (UINT)&DiskInfo) != DF_RETURN_SUCCESS ||
+        DiskInfo.BytesPerSector == 0) {
+        UnlockMutex(&BlockIOMutex);
+        return NULL;
+    }
+
+    // Prefer a slot that already has a task
+    for (UINT Index = 0; Index < BLOCK_IO_MAX_QUEUES && Queue == NULL; Index++) {
+        if (BlockIOQueues[Index].Disk == NULL && BlockIOQueues[Index].Used) Queue = &(BlockIOQueues[Index]);
+    }
+
+    for (UINT Index = 0; Index < BLOCK_IO_MAX_QUEUES && Queue == NULL; Index++) {
+        if (BlockIOQueues[Index].Used == FALSE) Queue = &(BlockIOQueues[Index]);
+    }
+
+    if (Queue == NULL) {
+        UnlockMutex(&BlockIOMutex);
+        return NULL;
+    }
+
+    if (Queue->Used == FALSE) {
+        TASK_INFO TaskInfo;
+
+        MemorySet(Queue, 0, sizeof(BLOCK_IO_QUEUE));
+        InitMutex(&(Queue->Mutex));
+
+        Queue->Staging = AllocKernelRegion(
+            0, BLOCK_IO_MERGE_BYTES, ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE, TEXT("BlockIOStaging"));
+
+        if (Queue->Staging == 0) {
+            WARNING(TEXT("[BlockIOGetQueue] No staging area, requests will not be merged"));
+        }
+
+        MemorySet(&TaskInfo, 0, sizeof(TaskInfo));
+        TaskInfo.Header.Size = sizeof(TASK_INFO);
+        TaskInfo.Header.Version = EXOS_ABI_VERSION;
+        TaskInfo.Func = BlockIOQueueTask;
+        TaskInfo.Parameter = (LPVOID)Queue;
+        TaskInfo.StackSize = TASK_MINIMUM_TASK_STACK_SIZE;
+        TaskInfo.Priority = TASK_PRIORITY_MEDIUM;
+        TaskInfo.Flags = 0;
+        StringCopy(TaskInfo.Name, TEXT("BlockIO"));
+
+        Queue->Task = CreateTask(&KernelProcess, &TaskInfo);
+
+        if (Queue->Task == NULL) {
+            ERROR(TEXT("[BlockIOGetQueue] Failed to create queue task"));
+
+            if (Queue->Staging != 0) FreeRegion(Queue->Staging, BLOCK_IO_MERGE_BYTES);
+            Queue->Staging = 0;
+
+            UnlockMutex(&BlockIOMutex);
+            return NULL;
+        }
+
+        Queue->Used = TRUE;
+    }
+
+    LockMutex(&(Queue->Mutex), INFINITY);
+    Queue->BytesPerSector = DiskInfo.BytesPerSector;
+    Queue->Head = U64_FromU32(0);
+    MemorySet(&(Queue->Info), 0, sizeof(BLOCK_IO_INFO));
+    Queue->Disk = Disk;
+    UnlockMutex(&(Queue->Mutex));
+
+    UnlockMutex(&BlockIOMutex);
+
+    DEBUG(TEXT("[BlockIOGetQueue] Disk %p served by task %p"), Disk, Queue->Task);
+
+    return Queue;
+}
+
+/***************************************************************************/
+
+BOOL BlockRequestInit(LPBLOCK_REQUEST Request, LPSTORAGE_UNIT Disk, U32 SectorLow, U32 SectorHigh, U32 NumSectors,
+    LPVOID Buffer, U32 BufferSize, BOOL IsWrite, U32 Flags) {
+    if (Request == NULL) return FALSE;
+
+    MemorySet(Request, 0, sizeof(BLOCK_REQUEST));
+    Request->Control.TypeID = KOID_IOCONTROL;
+    Request->Control.Disk = Disk;
+    Request->Control.SectorLow = SectorLow;
+    Request->Control.SectorHigh = SectorHigh;
+    Request->Control.NumSectors = NumSectors;
+    Request->Control.Buffer = Buffer;
+    Request->Control.BufferSize = BufferSize;
+    Request->IsWrite = IsWrite;
+    Request->Flags = Flags;
+    Request->State = BLOCK_REQUEST_IDLE;
+    Request->Result = DF_RETURN_SUCCESS;
+
+    if (Flags & BLOCK_REQUEST_FLAG_EVENT) {
+        Request->Completion = CreateKernelEvent();
+        if (Request->Completion == NULL) return FALSE;
+    }
+
+    return TRUE;
+}
+
+/***************************************************************************/
+
+void BlockRequestRelease(LPBLOCK_REQUEST Request) {
+    if (Request == NULL) return;
+
+    if (Request->State == BLOCK_REQUEST_QUEUED) {
+        BlockIOWait(Request, INFINITY);
+    }
+
+    SAFE_USE(Request->Completion) {
+        DeleteKernelEvent(Request->Completion);
+        Request->Completion = NULL;
+    }
+}
+
+/***************************************************************************/
+
+U32 BlockIOSubmit(LPBLOCK_REQUEST Request) {
+    LPBLOCK_IO_QUEUE Queue;
+    LPBLOCK_REQUEST* Link;
+    U64 Start;
+
+    if (Request == NULL || Request->State == BLOCK_REQUEST_QUEUED) return DF_RETURN_BAD_PARAMETER;
+    if (Request->Control.Disk == NULL || Request->Control.Disk->Driver == NULL) return DF_RETURN_BAD_PARAMETER;
+    if (Request->Control.Buffer == NULL || Request->Control.NumSectors == 0) return DF_RETURN_BAD_PARAMETER;
+
+    SAFE_USE(Request->Completion) {
+        ResetKernelEvent(Request->Completion);
+    }
+
+    Request->State = BLOCK_REQUEST_QUEUED;
+    Request->Result = DF_RETURN_SUCCESS;
+    Request->Waiter = NULL;
+    Request->Next = NULL;
+
+    Queue = BlockIOGetQueue(Request->Control.Disk, TRUE);
+
+    if (Queue == NULL) {
+        BlockRequestComplete(Request, BlockIORunRequest(Request));
+        return DF_RETURN_SUCCESS;
+    }
+
+    Start = BlockRequestStart(Request);
+
+    LockMutex(&(Queue->Mutex), INFINITY);
+
+    // Keep submission order among requests that start on the same sector
+    Link = &(Queue->Pending);
+    while (*Link != NULL && U64_Cmp(BlockRequestStart(*Link), Start) <= 0) {
+        Link = &((*Link)->Next);
+    }
+
+    Request->Next = *Link;
+    *Link = Request;
+
+    Queue->Info.Submitted++;
+    Queue->Info.Pending++;
+
+    UnlockMutex(&(Queue->Mutex));
+
+    WakeUpTask(Queue->Task);
+
+    return DF_RETURN_SUCCESS;
+}
+
+/***************************************************************************/
+
+BOOL BlockIOWait(LPBLOCK_REQUEST Request, UINT TimeOut) {
+    BOOL Done;
+
+    if (Request == NULL) return FALSE;
+    if (Request->State != BLOCK_REQUEST_QUEUED) return TRUE;
+
+    // The queue task wakes the waiter when the request completes
+    Request->Waiter = GetCurrentTask();
+    Done = SleepUntil(BlockRequestIsDone, Request, TimeOut);
+    Request->Waiter = NULL;
+
+    return Done;
+}
+
+/***************************************************************************/
+
+void BlockIODetachDisk(LPSTORAGE_UNIT Disk) {
+    LPBLOCK_IO_QUEUE Queue = BlockIOGetQueue(Disk, FALSE);
+    LPBLOCK_REQUEST Pending;
+
+    if (Queue == NULL) return;
+
+    LockMutex(&(Queue->Mutex), INFINITY);
+    Pending = Queue->Pending;
+    Queue->Pending = NULL;
+    Queue->Info.Pending = 0;
+    Queue->Disk = NULL;
+    UnlockMutex(&(Queue->Mutex));
+
+    while (Pending != NULL) {
+        LPBLOCK_REQUEST Next = Pending->Next;
+
+        BlockRequestComplete(Pending, DF_RETURN_HARDWARE_ABSENT);
+        Pending = Next;
+    }
+}
+
+/***************************************************************************/
+
+BOOL BlockIOGetInfo(LPSTORAGE_UNIT Disk, LPBLOCK_IO_INFO Info) {
+    LPBLOCK_IO_QUEUE Queue;
+
+    if (Disk == NULL || Info == NULL) return FALSE;
+
+    Queue = BlockIOGetQueue(Disk, FALSE);
+    if (Queue == NULL) return FALSE;
+
+    LockMutex(&(Queue->Mutex), INFINITY);
+    *Info = Queue->Info;
+    UnlockMutex(&(Queue->Mutex));
+
+    return TRUE;
+}
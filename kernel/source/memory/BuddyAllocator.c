@@ -41,6 +41,7 @@ typedef struct tag_BUDDY_HEADER {
     UINT MaxOrder;
     UINT UsedPages;
     UINT Ready;
+    UINT FreeOrderMask;     // Bit N set when order N has at least one free block
 } BUDDY_HEADER, *LPBUDDY_HEADER;
 
 typedef struct tag_BUDDY_NODE {
@@ -55,6 +56,23 @@ static inline UINT BuddyBlockPages(UINT Order) {
     return ((UINT)1) << Order;
 }
 
+/************************************************************************/
+
+/**
+ * @brief Return the smallest order whose block holds the page count.
+ * @param PageCount Number of pages.
+ * @return Buddy order.
+ */
+static inline UINT BuddyOrderForPages(UINT PageCount) {
+    UINT Order = 0;
+
+    while (BuddyBlockPages(Order) < PageCount) {
+        Order++;
+    }
+
+    return Order;
+}
+
 /************************************************************************/
 // external symbols
 
@@ -63,6 +81,7 @@ static inline UINT BuddyBlockPages(UINT Order) {
 
 static LPBUDDY_HEADER DATA_SECTION G_BuddyHeader = NULL;
 static UINT* DATA_SECTION G_OrderHeads = NULL;
+static UINT* DATA_SECTION G_OrderCounts = NULL;
 static LPBUDDY_NODE DATA_SECTION G_BlockLinks = NULL;
 static U8* DATA_SECTION G_BlockOrder = NULL;
 static U8* DATA_SECTION G_PageUsed = NULL;
@@ -122,6 +141,8 @@ static void AddFreeBlock(UINT Index, UINT Order) {
     }
 
     G_OrderHeads[Order] = Index;
+    G_OrderCounts[Order]++;
+    G_BuddyHeader->FreeOrderMask |= BuddyBlockPages(Order);
 }
 
 /************************************************************************/
@@ -146,6 +167,62 @@ static void RemoveFreeBlock(UINT Index, UINT Order) {
 
     G_BlockLinks[Index].Prev = BUDDY_INVALID_INDEX;
     G_BlockLinks[Index].Next = BUDDY_INVALID_INDEX;
+
+    if (G_OrderCounts[Order] != 0) {
+        G_OrderCounts[Order]--;
+    }
+
+    if (G_OrderCounts[Order] == 0) {
+        G_BuddyHeader->FreeOrderMask &= ~BuddyBlockPages(Order);
+    }
+}
+
+/************************************************************************/
+/**
+ * @brief Return the lowest order at or above a minimum that has a free block.
+ * @param MinimumOrder Smallest acceptable order.
+ * @return Order, or BUDDY_INVALID_INDEX when no block is large enough.
+ */
+static UINT FindFreeOrder(UINT MinimumOrder) {
+    UINT Mask;
+    UINT Order = MinimumOrder;
+
+    if (MinimumOrder > G_BuddyHeader->MaxOrder) {
+        return BUDDY_INVALID_INDEX;
+    }
+
+    Mask = G_BuddyHeader->FreeOrderMask >> MinimumOrder;
+
+    if (Mask == 0) {
+        return BUDDY_INVALID_INDEX;
+    }
+
+    while ((Mask & 1) == 0) {
+        Mask = Mask >> 1;
+        Order++;
+    }
+
+    return Order;
+}
+
+/************************************************************************/
+/**
+ * @brief Return the highest order below a limit that has a free block.
+ * @param LimitOrder Exclusive upper order.
+ * @return Order, or BUDDY_INVALID_INDEX when every order below the limit is empty.
+ */
+static UINT FindLargestFreeOrderBelow(UINT LimitOrder) {
+    UINT Order = LimitOrder;
+
+    while (Order > 0) {
+        Order--;
+
+        if (G_OrderCounts[Order] != 0) {
+            return Order;
+        }
+    }
+
+    return BUDDY_INVALID_INDEX;
 }
 
 /************************************************************************/
@@ -180,8 +257,11 @@ static BOOL ResetToAllFree(void) {
 
     for (UINT Order = 0; Order <= MaxOrder; Order++) {
         G_OrderHeads[Order] = BUDDY_INVALID_INDEX;
+        G_OrderCounts[Order] = 0;
     }
 
+    G_BuddyHeader->FreeOrderMask = 0;
+
     for (UINT Index = 0; Index < TotalPages; Index++) {
         G_BlockLinks[Index].Prev = BUDDY_INVALID_INDEX;
         G_BlockLinks[Index].Next = BUDDY_INVALID_INDEX;
@@ -354,6 +434,9 @@ UINT BuddyGetMetadataSize(UINT TotalPages) {
     Size += (MaxOrder + 1) * (UINT)sizeof(UINT);
     Size = AlignUp(Size, (UINT)sizeof(UINT));
 
+    Size += (MaxOrder + 1) * (UINT)sizeof(UINT);
+    Size = AlignUp(Size, (UINT)sizeof(UINT));
+
     Size += TotalPages * (UINT)sizeof(BUDDY_NODE);
     Size = AlignUp(Size, (UINT)sizeof(UINT));
 
@@ -398,6 +481,10 @@ BOOL BuddyInitialize(LINEAR MetadataAddress, UINT MetadataSize, UINT TotalPages)
     Offset += (MaxOrder + 1) * (UINT)sizeof(UINT);
     Offset = AlignUp(Offset, (UINT)sizeof(UINT));
 
+    G_OrderCounts = (UINT*)(Base + Offset);
+    Offset += (MaxOrder + 1) * (UINT)sizeof(UINT);
+    Offset = AlignUp(Offset, (UINT)sizeof(UINT));
+
     G_BlockLinks = (LPBUDDY_NODE)(Base + Offset);
     Offset += TotalPages * (UINT)sizeof(BUDDY_NODE);
     Offset = AlignUp(Offset, (UINT)sizeof(UINT));
@@ -496,44 +583,200 @@ BOOL BuddyIsRangeFree(UINT FirstPage, UINT PageCount) {
     return TRUE;
 }
 
+/************************************************************************/
+/**
+ * @brief Take one free block of at least the given order and split it down.
+ *
+ * The low half is kept at each split, so the returned block starts at the
+ * start of the block taken from the free list. Every page of the block is
+ * marked used with order 0, so pages can later be released one by one.
+ *
+ * @param Start Start page index of a free block of order FreeOrder.
+ * @param FreeOrder Order of the free block.
+ * @param Order Order of the block to keep.
+ * @return Start page index of the kept block.
+ */
+static UINT TakeFreeBlock(UINT Start, UINT FreeOrder, UINT Order) {
+    UINT Pages = BuddyBlockPages(Order);
+
+    RemoveFreeBlock(Start, FreeOrder);
+
+    while (FreeOrder > Order) {
+        FreeOrder--;
+        AddFreeBlock(Start + BuddyBlockPages(FreeOrder), FreeOrder);
+    }
+
+    for (UINT Index = Start; Index < Start + Pages; Index++) {
+        G_BlockOrder[Index] = 0;
+        G_PageUsed[Index] = 1;
+    }
+
+    G_BuddyHeader->UsedPages += Pages;
+
+    return Start;
+}
+
+/************************************************************************/
+/**
+ * @brief Allocate one block of the given order.
+ * @param Order Buddy order.
+ * @return Start page index, or BUDDY_INVALID_INDEX on failure.
+ */
+static UINT AllocBlock(UINT Order) {
+    UINT FreeOrder = FindFreeOrder(Order);
+
+    if (FreeOrder == BUDDY_INVALID_INDEX) {
+        return BUDDY_INVALID_INDEX;
+    }
+
+    return TakeFreeBlock(G_OrderHeads[FreeOrder], FreeOrder, Order);
+}
+
 /************************************************************************/
 /**
  * @brief Allocate one 4K physical page.
  * @return Physical address of allocated page, 0 on failure.
  */
 PHYSICAL BuddyAllocPage(void) {
+    return BuddyAllocPages(0);
+}
+
+/************************************************************************/
+/**
+ * @brief Allocate 2^Order physically contiguous pages.
+ *
+ * The block is naturally aligned on its own size. Its pages are released
+ * individually with BuddyFreePage().
+ *
+ * @param Order Buddy order.
+ * @return Physical address of the first page, 0 on failure.
+ */
+PHYSICAL BuddyAllocPages(UINT Order) {
+    UINT Start;
+
     if (BuddyIsReady() == FALSE) {
         return 0;
     }
 
-    UINT CandidateOrder = BUDDY_INVALID_INDEX;
+    Start = AllocBlock(Order);
+
+    if (Start == BUDDY_INVALID_INDEX) {
+        return 0;
+    }
+
+    return (PHYSICAL)(Start << PAGE_SIZE_MUL);
+}
+
+/************************************************************************/
+/**
+ * @brief Allocate a physically contiguous page range.
+ *
+ * The range is carved from the start of the smallest suitable buddy block
+ * and the unused tail of that block is returned to the free lists.
+ *
+ * @param PageCount Number of pages.
+ * @param Alignment Physical alignment in bytes, a power of two (0 for page alignment).
+ * @param MaxPhysical Highest physical address the range may touch (0 for no limit).
+ * @return Physical address of the first page, 0 on failure.
+ */
+PHYSICAL BuddyAllocContiguous(UINT PageCount, UINT Alignment, PHYSICAL MaxPhysical) {
+    UINT Order;
+    UINT AlignmentPages;
+    UINT LimitPage = BUDDY_INVALID_INDEX;
+    UINT Start = BUDDY_INVALID_INDEX;
+
+    if (BuddyIsReady() == FALSE || PageCount == 0 || PageCount > G_BuddyHeader->TotalPages) {
+        return 0;
+    }
+
+    AlignmentPages = Alignment >> PAGE_SIZE_MUL;
+    Order = BuddyOrderForPages(PageCount);
+
+    if (AlignmentPages > BuddyBlockPages(Order)) {
+        Order = BuddyOrderForPages(AlignmentPages);
+    }
+
+    if (MaxPhysical != 0) {
+        LimitPage = (UINT)(MaxPhysical >> PAGE_SIZE_MUL);
+    }
+
+    for (UINT FreeOrder = FindFreeOrder(Order); FreeOrder != BUDDY_INVALID_INDEX && FreeOrder <= G_BuddyHeader->MaxOrder;
+         FreeOrder++) {
+        UINT Cursor = G_OrderHeads[FreeOrder];
+
+        while (Cursor != BUDDY_INVALID_INDEX) {
+            if (LimitPage == BUDDY_INVALID_INDEX || Cursor + PageCount - 1 <= LimitPage) {
+                Start = TakeFreeBlock(Cursor, FreeOrder, Order);
+                break;
+            }
+
+            Cursor = G_BlockLinks[Cursor].Next;
+        }
 
-    for (UINT Order = 0; Order <= G_BuddyHeader->MaxOrder; Order++) {
-        if (G_OrderHeads[Order] != BUDDY_INVALID_INDEX) {
-            CandidateOrder = Order;
+        if (Start != BUDDY_INVALID_INDEX) {
             break;
         }
     }
 
-    if (CandidateOrder == BUDDY_INVALID_INDEX) {
+    if (Start == BUDDY_INVALID_INDEX) {
         return 0;
     }
 
-    UINT BlockStart = G_OrderHeads[CandidateOrder];
-    RemoveFreeBlock(BlockStart, CandidateOrder);
+    for (UINT Index = Start + PageCount; Index < Start + BuddyBlockPages(Order); Index++) {
+        ReleaseOnePage(Index);
+    }
+
+    return (PHYSICAL)(Start << PAGE_SIZE_MUL);
+}
 
-    while (CandidateOrder > 0) {
-        CandidateOrder--;
-        UINT HalfPages = BuddyBlockPages(CandidateOrder);
-        UINT BuddyStart = BlockStart + HalfPages;
-        AddFreeBlock(BuddyStart, CandidateOrder);
+/************************************************************************/
+/**
+ * @brief Allocate several pages in one call, preferring large contiguous runs.
+ *
+ * Each round takes the largest block that does not exceed the remaining
+ * count, so the pages come back in physically ascending runs.
+ *
+ * @param Pages Receives the physical address of each allocated page.
+ * @param Count Number of pages wanted.
+ * @return Number of pages allocated, lower than Count when memory runs out.
+ */
+UINT BuddyAllocPageBatch(PHYSICAL* Pages, UINT Count) {
+    UINT Filled = 0;
+
+    if (BuddyIsReady() == FALSE || Pages == NULL) {
+        return 0;
     }
 
-    G_BlockOrder[BlockStart] = 0;
-    G_PageUsed[BlockStart] = 1;
-    G_BuddyHeader->UsedPages++;
+    while (Filled < Count) {
+        UINT Remaining = Count - Filled;
+        UINT Order = 0;
+        UINT Start;
+
+        while (Order < G_BuddyHeader->MaxOrder && BuddyBlockPages(Order + 1) <= Remaining) {
+            Order++;
+        }
+
+        if (FindFreeOrder(Order) == BUDDY_INVALID_INDEX) {
+            Order = FindLargestFreeOrderBelow(Order);
+
+            if (Order == BUDDY_INVALID_INDEX) {
+                break;
+            }
+        }
+
+        Start = AllocBlock(Order);
 
-    return (PHYSICAL)(BlockStart << PAGE_SIZE_MUL);
+        if (Start == BUDDY_INVALID_INDEX) {
+            break;
+        }
+
+        for (UINT Index = 0; Index < BuddyBlockPages(Order); Index++) {
+            Pages[Filled] = (PHYSICAL)((Start + Index) << PAGE_SIZE_MUL);
+            Filled++;
+        }
+    }
+
+    return Filled;
 }
 
 /************************************************************************/
@@ -555,6 +798,22 @@ BOOL BuddyFreePage(PHYSICAL Page) {
     return ReleaseOnePage(PageIndex);
 }
 
+/************************************************************************/
+/**
+ * @brief Return whether one page is currently reserved.
+ * @param Page Physical page address.
+ * @return TRUE when the page is reserved, FALSE when free or out of range.
+ */
+BOOL BuddyIsPageUsed(PHYSICAL Page) {
+    UINT PageIndex = (UINT)(Page >> PAGE_SIZE_MUL);
+
+    if (BuddyIsReady() == FALSE || PageIndex >= G_BuddyHeader->TotalPages) {
+        return FALSE;
+    }
+
+    return (G_PageUsed[PageIndex] != 0);
+}
+
 /************************************************************************/
 /**
  * @brief Return whether the allocator has been initialized.
@@ -28,6 +28,13 @@
 #include "log/Log.h"
 #include "process/Process.h"
 #include "memory/Memory.h"
+#include "memory/Slab.h"
+
+/************************************************************************/
+
+#if HEAP_MAGAZINE_CLASSES != HEAP_NUM_SIZE_CLASSES
+#error "HEAP_MAGAZINE_CLASSES must match HEAP_NUM_SIZE_CLASSES"
+#endif
 
 /************************************************************************/
 
@@ -150,81 +157,53 @@ static BOOL IsBlockInHeap(LPHEAP_CONTROL_BLOCK ControlBlock, LPHEAP_BLOCK_HEADER
 /************************************************************************/
 
 /**
- * @brief Finds the physical predecessor block of a target block.
+ * @brief Returns the physical predecessor of a block from its boundary tag.
  * @param ControlBlock Heap control block.
  * @param Target Target block.
- * @return Previous adjacent block, or NULL.
+ * @return Previous adjacent block, or NULL for the first block.
  */
-static LPHEAP_BLOCK_HEADER FindPreviousPhysicalBlock(LPHEAP_CONTROL_BLOCK ControlBlock, LPHEAP_BLOCK_HEADER Target) {
-    LINEAR Cursor;
-    LINEAR FirstBlock;
-    LINEAR FirstUnallocated;
-    LPHEAP_BLOCK_HEADER Block;
+static LPHEAP_BLOCK_HEADER GetPreviousPhysicalBlock(LPHEAP_CONTROL_BLOCK ControlBlock, LPHEAP_BLOCK_HEADER Target) {
     LPHEAP_BLOCK_HEADER Previous;
 
-    if (ControlBlock == NULL || Target == NULL) {
+    if (ControlBlock == NULL || Target == NULL || Target->PreviousSize == 0) {
         return NULL;
     }
 
-    FirstBlock = (ControlBlock->HeapBase + sizeof(HEAP_CONTROL_BLOCK) + 15) & ~15;
-    FirstUnallocated = (LINEAR)ControlBlock->FirstUnallocated;
-    Cursor = FirstBlock;
-    Previous = NULL;
-
-    while (Cursor < FirstUnallocated) {
-        Block = (LPHEAP_BLOCK_HEADER)Cursor;
-
-        if (Block == Target) {
-            return Previous;
-        }
+    if ((LINEAR)Target - ControlBlock->HeapBase < Target->PreviousSize) {
+        return NULL;
+    }
 
-        if (IsBlockInHeap(ControlBlock, Block) == FALSE) {
-            return NULL;
-        }
+    Previous = (LPHEAP_BLOCK_HEADER)((LINEAR)Target - Target->PreviousSize);
 
-        Previous = Block;
-        Cursor += Block->Size;
+    if (IsBlockInHeap(ControlBlock, Previous) == FALSE || Previous->Size != Target->PreviousSize) {
+        ERROR(TEXT("[GetPreviousPhysicalBlock] Corrupted boundary tag at %p"), Target);
+        return NULL;
     }
 
-    return NULL;
+    return Previous;
 }
 
 /************************************************************************/
 
 /**
- * @brief Count total bytes held by free blocks inside an initialized heap.
+ * @brief Sets the size of a block and the boundary tag of its successor.
  * @param ControlBlock Heap control block.
- * @return Total free payload bytes across all free blocks.
+ * @param Block Block to resize.
+ * @param Size New block size, header included.
+ *
+ * When the block is the last one, the tag is kept in LastBlockSize so
+ * that the next block carved from the unallocated space gets it.
  */
-static UINT CountFreePayloadBytes(LPHEAP_CONTROL_BLOCK ControlBlock) {
-    LINEAR Cursor;
-    LINEAR FirstBlock;
-    LINEAR FirstUnallocated;
-    LPHEAP_BLOCK_HEADER Block;
-    UINT TotalFreeBytes = 0;
+static void SetBlockSize(LPHEAP_CONTROL_BLOCK ControlBlock, LPHEAP_BLOCK_HEADER Block, UINT Size) {
+    LINEAR NextAddress = (LINEAR)Block + Size;
 
-    if (ControlBlock == NULL) {
-        return 0;
-    }
-
-    FirstBlock = (ControlBlock->HeapBase + sizeof(HEAP_CONTROL_BLOCK) + 15) & ~15;
-    FirstUnallocated = (LINEAR)ControlBlock->FirstUnallocated;
-    Cursor = FirstBlock;
+    Block->Size = Size;
 
-    while (Cursor < FirstUnallocated) {
-        Block = (LPHEAP_BLOCK_HEADER)Cursor;
-        if (IsBlockInHeap(ControlBlock, Block) == FALSE) {
-            return 0;
-        }
-
-        if (IsBlockFree(Block) && Block->Size > sizeof(HEAP_BLOCK_HEADER)) {
-            TotalFreeBytes += Block->Size - sizeof(HEAP_BLOCK_HEADER);
-        }
-
-        Cursor += Block->Size;
+    if (NextAddress < (LINEAR)ControlBlock->FirstUnallocated) {
+        ((LPHEAP_BLOCK_HEADER)NextAddress)->PreviousSize = Size;
+    } else {
+        ControlBlock->LastBlockSize = Size;
     }
-
-    return TotalFreeBytes;
 }
 
 /************************************************************************/
@@ -245,6 +224,7 @@ static void AddToFreeList(LPHEAP_CONTROL_BLOCK ControlBlock, LPHEAP_BLOCK_HEADER
     }
 
     Block->Flags |= HEAP_BLOCK_FLAG_FREE;
+    ControlBlock->FreeBytes += Block->Size - sizeof(HEAP_BLOCK_HEADER);
 
     if (SizeClass == 0xFF) {
         // Large block
@@ -295,6 +275,7 @@ static void RemoveFromFreeList(LPHEAP_CONTROL_BLOCK ControlBlock, LPHEAP_BLOCK_H
     Block->Next = NULL;
     Block->Prev = NULL;
     Block->Flags &= ~HEAP_BLOCK_FLAG_FREE;
+    ControlBlock->FreeBytes -= Block->Size - sizeof(HEAP_BLOCK_HEADER);
 }
 
 /************************************************************************/
@@ -319,6 +300,10 @@ void HeapInit(LPPROCESS Process, LINEAR HeapBase, UINT HeapSize) {
     ControlBlock->HeapSize = HeapSize;
     ControlBlock->Owner = Process;
 
+    if (Process != NULL) {
+        MemorySet(Process->HeapMagazines, 0, sizeof(Process->HeapMagazines));
+    }
+
     // Initialize all freelists to NULL
     for (UINT i = 0; i < HEAP_NUM_SIZE_CLASSES; i++) {
         ControlBlock->FreeLists[i] = NULL;
@@ -330,7 +315,8 @@ void HeapInit(LPPROCESS Process, LINEAR HeapBase, UINT HeapSize) {
     ControlBlock->ResizeContext = Process;
     ControlBlock->ResizeCallback = HeapResizeProcess;
     ControlBlock->MaximumSize = (Process != NULL) ? Process->MaximumAllocatedMemory : HeapSize;
-    ControlBlock->RegionFlags = ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE;
+    // Let heap growth map whole 2 MiB chunks with large pages
+    ControlBlock->RegionFlags = ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE | ALLOC_PAGES_LARGE;
     if (Process != NULL && Process->Privilege == CPU_PRIVILEGE_KERNEL) {
         ControlBlock->RegionFlags |= ALLOC_PAGES_AT_OR_OVER;
     }
@@ -487,10 +473,11 @@ LPVOID HeapAlloc_HBHS(LPPROCESS Process, LINEAR HeapBase, UINT HeapSize, UINT Si
                     if (RemainingSize >= sizeof(HEAP_BLOCK_HEADER) + HEAP_MIN_BLOCK_SIZE) {
                         LPHEAP_BLOCK_HEADER SplitBlock = (LPHEAP_BLOCK_HEADER)((LINEAR)Block + TotalSize);
                         SplitBlock->TypeID = KOID_HEAP;
-                        SplitBlock->Size = RemainingSize;
+                        SplitBlock->PreviousSize = TotalSize;
                         SplitBlock->Flags = 0;
                         SplitBlock->Next = NULL;
                         SplitBlock->Prev = NULL;
+                        SetBlockSize(ControlBlock, SplitBlock, RemainingSize);
 
                         UINT SplitSizeClass = GetSizeClass(RemainingSize - sizeof(HEAP_BLOCK_HEADER));
                         AddToFreeList(ControlBlock, SplitBlock, SplitSizeClass);
@@ -516,10 +503,11 @@ LPVOID HeapAlloc_HBHS(LPPROCESS Process, LINEAR HeapBase, UINT HeapSize, UINT Si
                     if (RemainingSize >= sizeof(HEAP_BLOCK_HEADER) + HEAP_MIN_BLOCK_SIZE) {
                         LPHEAP_BLOCK_HEADER SplitBlock = (LPHEAP_BLOCK_HEADER)((LINEAR)Block + TotalSize);
                         SplitBlock->TypeID = KOID_HEAP;
-                        SplitBlock->Size = RemainingSize;
+                        SplitBlock->PreviousSize = TotalSize;
                         SplitBlock->Flags = 0;
                         SplitBlock->Next = NULL;
                         SplitBlock->Prev = NULL;
+                        SetBlockSize(ControlBlock, SplitBlock, RemainingSize);
 
                         UINT SplitSizeClass = GetSizeClass(RemainingSize - sizeof(HEAP_BLOCK_HEADER));
                         AddToFreeList(ControlBlock, SplitBlock, SplitSizeClass);
@@ -551,11 +539,13 @@ LPVOID HeapAlloc_HBHS(LPPROCESS Process, LINEAR HeapBase, UINT HeapSize, UINT Si
     Block = (LPHEAP_BLOCK_HEADER)NewBlockAddr;
     Block->TypeID = KOID_HEAP;
     Block->Size = TotalSize;
+    Block->PreviousSize = ControlBlock->LastBlockSize;
     Block->Flags = 0;
     Block->Next = NULL;
     Block->Prev = NULL;
 
     ControlBlock->FirstUnallocated = (LPVOID)(NewBlockAddr + TotalSize);
+    ControlBlock->LastBlockSize = TotalSize;
 
     return (LPVOID)(NewBlockAddr + sizeof(HEAP_BLOCK_HEADER));
 }
@@ -591,10 +581,10 @@ LPVOID HeapRealloc_HBHS(LPPROCESS Process, LINEAR HeapBase, UINT HeapSize, LPVOI
     }
     if (ControlBlock == NULL || ControlBlock->TypeID != KOID_HEAP) return NULL;
 
-    // Get the block header
+    // Get the block header, checking its bounds before reading it
     LPHEAP_BLOCK_HEADER Block = (LPHEAP_BLOCK_HEADER)((LINEAR)Pointer - sizeof(HEAP_BLOCK_HEADER));
-    if (Block->TypeID != KOID_HEAP) {
-        ERROR(TEXT("[HeapRealloc_HBHS] Invalid block header ID"));
+    if (IsBlockInHeap(ControlBlock, Block) == FALSE) {
+        ERROR(TEXT("[HeapRealloc_HBHS] Block outside heap bounds"));
         return NULL;
     }
 
@@ -628,7 +618,8 @@ LPVOID HeapRealloc_HBHS(LPPROCESS Process, LINEAR HeapBase, UINT HeapSize, LPVOI
  * @param HeapSize Size of the heap in bytes (unused but kept for consistency)
  * @param Pointer Pointer to memory to free
  *
- * This function frees a block and attempts to coalesce with adjacent free blocks.
+ * This function frees a block and coalesces it with adjacent free blocks in
+ * constant time, the previous block being found through its boundary tag.
  */
 void HeapFree_HBHS(LINEAR HeapBase, UINT HeapSize, LPVOID Pointer) {
     UNUSED(HeapSize);
@@ -637,7 +628,6 @@ void HeapFree_HBHS(LINEAR HeapBase, UINT HeapSize, LPVOID Pointer) {
     LPHEAP_BLOCK_HEADER Block = NULL;
     LPHEAP_BLOCK_HEADER Previous = NULL;
     LPHEAP_BLOCK_HEADER Next = NULL;
-    BOOL Merged;
     UINT SizeClass = 0;
 
     if (Pointer == NULL) return;
@@ -645,13 +635,8 @@ void HeapFree_HBHS(LINEAR HeapBase, UINT HeapSize, LPVOID Pointer) {
 
     // DEBUG("[HeapFree_HBHS] Freeing pointer %x", Pointer);
 
-    // Get the block header
+    // Get the block header, checking its bounds before reading it
     Block = (LPHEAP_BLOCK_HEADER)((LINEAR)Pointer - sizeof(HEAP_BLOCK_HEADER));
-    if (Block->TypeID != KOID_HEAP) {
-        ERROR(TEXT("[HeapFree_HBHS] Invalid block header ID"));
-        return;
-    }
-
     if (IsBlockInHeap(ControlBlock, Block) == FALSE) {
         ERROR(TEXT("[HeapFree_HBHS] Block outside heap bounds"));
         return;
@@ -664,48 +649,26 @@ void HeapFree_HBHS(LINEAR HeapBase, UINT HeapSize, LPVOID Pointer) {
 
     // DEBUG("[HeapFree_HBHS] Freeing block at %x, size %x", Block, Block->Size);
 
-    FOREVER {
-        Merged = FALSE;
-
-        Next = (LPHEAP_BLOCK_HEADER)((LINEAR)Block + Block->Size);
-        if ((LINEAR)Next < (LINEAR)ControlBlock->FirstUnallocated &&
-            IsBlockInHeap(ControlBlock, Next) &&
-            IsBlockFree(Next)) {
-            RemoveFromFreeList(ControlBlock, Next, GetBlockSizeClass(Next));
-            Block->Size += Next->Size;
-            Merged = TRUE;
-        }
-
-        Previous = FindPreviousPhysicalBlock(ControlBlock, Block);
-        if (Previous != NULL &&
-            IsBlockInHeap(ControlBlock, Previous) &&
-            IsBlockFree(Previous)) {
-            RemoveFromFreeList(ControlBlock, Previous, GetBlockSizeClass(Previous));
-            Previous->Size += Block->Size;
-            Block = Previous;
-            Merged = TRUE;
-        }
+    // Free neighbors are always merged, so one step on each side is enough
+    Next = (LPHEAP_BLOCK_HEADER)((LINEAR)Block + Block->Size);
+    if ((LINEAR)Next < (LINEAR)ControlBlock->FirstUnallocated &&
+        IsBlockInHeap(ControlBlock, Next) &&
+        IsBlockFree(Next)) {
+        RemoveFromFreeList(ControlBlock, Next, GetBlockSizeClass(Next));
+        SetBlockSize(ControlBlock, Block, Block->Size + Next->Size);
+    }
 
-        if (Merged == FALSE) {
-            break;
-        }
+    Previous = GetPreviousPhysicalBlock(ControlBlock, Block);
+    if (Previous != NULL && IsBlockFree(Previous)) {
+        RemoveFromFreeList(ControlBlock, Previous, GetBlockSizeClass(Previous));
+        SetBlockSize(ControlBlock, Previous, Previous->Size + Block->Size);
+        Block = Previous;
     }
 
     if ((LINEAR)Block + Block->Size == (LINEAR)ControlBlock->FirstUnallocated) {
+        // Give the tail back to the unallocated space
         ControlBlock->FirstUnallocated = (LPVOID)Block;
-
-        FOREVER {
-            LPHEAP_BLOCK_HEADER Tail = (LPHEAP_BLOCK_HEADER)ControlBlock->FirstUnallocated;
-            LPHEAP_BLOCK_HEADER TailPrevious = FindPreviousPhysicalBlock(ControlBlock, Tail);
-
-            if (TailPrevious == NULL || IsBlockInHeap(ControlBlock, TailPrevious) == FALSE || IsBlockFree(TailPrevious) == FALSE) {
-                break;
-            }
-
-            RemoveFromFreeList(ControlBlock, TailPrevious, GetBlockSizeClass(TailPrevious));
-            ControlBlock->FirstUnallocated = (LPVOID)TailPrevious;
-        }
-
+        ControlBlock->LastBlockSize = Block->PreviousSize;
         return;
     }
 
@@ -752,7 +715,11 @@ BOOL HeapQueryProcessMemoryInfo(LPPROCESS Process, LPPROCESS_MEMORY_INFO Info) {
     }
 
     TotalPayloadBytes = FirstUnallocatedOffset - HeapHeaderEndOffset;
-    FreePayloadBytes = CountFreePayloadBytes(ControlBlock);
+    FreePayloadBytes = ControlBlock->FreeBytes;
+
+    for (UINT SizeClass = 0; SizeClass < HEAP_NUM_SIZE_CLASSES; SizeClass++) {
+        FreePayloadBytes += Process->HeapMagazines[SizeClass].Count * GetSizeForClass(SizeClass);
+    }
     if (FreePayloadBytes > TotalPayloadBytes) {
         UnlockMutex(&(Process->HeapMutex));
         return FALSE;
@@ -771,6 +738,59 @@ BOOL HeapQueryProcessMemoryInfo(LPPROCESS Process, LPPROCESS_MEMORY_INFO Info) {
 
 /************************************************************************/
 
+/**
+ * @brief Parks a freed small block in the process magazine of its size class.
+ * @param Process Pointer to the process structure
+ * @param Pointer Pointer to memory to free
+ * @param FullClass Receives the size class when its magazine refused the block, 0xFF otherwise
+ * @return TRUE if the block was parked, FALSE if it must go through HeapFree_HBHS
+ *
+ * Only blocks whose payload is exactly a size class are parked, so that any
+ * request of that class fits. Parked blocks stay allocated for the heap and
+ * never coalesce.
+ */
+static BOOL HeapMagazineFree(LPPROCESS Process, LPVOID Pointer, UINT* FullClass) {
+    LPHEAP_BLOCK_HEADER Block;
+    LINEAR Address = (LINEAR)Pointer;
+    UINT DataSize;
+    UINT SizeClass;
+
+    *FullClass = 0xFF;
+
+    if (Pointer == NULL || Process->HeapBase == 0) return FALSE;
+    if (Address < Process->HeapBase + sizeof(HEAP_CONTROL_BLOCK) + sizeof(HEAP_BLOCK_HEADER)) return FALSE;
+
+    Block = (LPHEAP_BLOCK_HEADER)(Address - sizeof(HEAP_BLOCK_HEADER));
+    if (IsBlockInHeap((LPHEAP_CONTROL_BLOCK)Process->HeapBase, Block) == FALSE) return FALSE;
+    if (IsBlockFree(Block) || Block->Size <= sizeof(HEAP_BLOCK_HEADER)) return FALSE;
+
+    DataSize = Block->Size - sizeof(HEAP_BLOCK_HEADER);
+    SizeClass = GetSizeClass(DataSize);
+    if (SizeClass == 0xFF || GetSizeForClass(SizeClass) != DataSize) return FALSE;
+
+    if (SlabMagazinePush(&(Process->HeapMagazines[SizeClass]), Pointer)) return TRUE;
+
+    *FullClass = SizeClass;
+    return FALSE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Returns every parked block of one size class to the heap.
+ * @param Process Pointer to the process structure, heap mutex held
+ * @param SizeClass Size class to drain
+ */
+static void HeapMagazineDrain(LPPROCESS Process, UINT SizeClass) {
+    LPVOID Parked;
+
+    while ((Parked = SlabMagazinePop(&(Process->HeapMagazines[SizeClass]))) != NULL) {
+        HeapFree_HBHS(Process->HeapBase, Process->HeapSize, Parked);
+    }
+}
+
+/************************************************************************/
+
 /**
  * @brief Allocates memory from a process's heap with mutex protection
  * @param Process Pointer to the process structure
@@ -779,15 +799,26 @@ BOOL HeapQueryProcessMemoryInfo(LPPROCESS Process, LPPROCESS_MEMORY_INFO Info) {
  *
  * This function provides thread-safe memory allocation by acquiring the
  * process's heap mutex before calling the core allocation function.
+ * Small requests are first served from the process magazines without
+ * taking the mutex.
  */
 LPVOID HeapAlloc_P(LPPROCESS Process, UINT Size) {
     LPVOID Pointer = NULL;
+    UINT SizeClass;
 
     if (Process == NULL) {
         ERROR(TEXT("[HeapAlloc_P] Process pointer is NULL"));
         return NULL;
     }
 
+    SizeClass = GetSizeClass(Size);
+    if (Size != 0 && SizeClass != 0xFF) {
+        Pointer = SlabMagazinePop(&(Process->HeapMagazines[SizeClass]));
+        if (Pointer != NULL) {
+            return Pointer;
+        }
+    }
+
     LockMutex(&(Process->HeapMutex), INFINITY);
     Pointer = HeapAlloc_HBHS(Process, Process->HeapBase, Process->HeapSize, Size);
     UnlockMutex(&(Process->HeapMutex));
@@ -806,9 +837,37 @@ LPVOID HeapAlloc_P(LPPROCESS Process, UINT Size) {
  *
  * This function provides thread-safe memory reallocation by acquiring the
  * process's heap mutex before calling the core reallocation function.
+ * Only the kernel heap takes slab objects; any other heap rejects a
+ * pointer that is not one of its own blocks.
  */
 LPVOID HeapRealloc_P(LPPROCESS Process, LPVOID Pointer, UINT Size) {
     LPVOID NewPointer = NULL;
+    UINT SlabSize = 0;
+
+    // Slab objects belong to the kernel, other heaps never look them up
+    if (Process == &KernelProcess) {
+        SlabSize = SlabCacheGetObjectSize(Pointer);
+    }
+
+    if (SlabSize != 0) {
+        // Object from a slab cache: slabs do not resize, move it to the heap
+        if (Size == 0) {
+            SlabCacheFree(Pointer);
+            return NULL;
+        }
+
+        if (Size <= SlabSize) {
+            return Pointer;
+        }
+
+        NewPointer = HeapAlloc_P(Process, Size);
+        SAFE_USE(NewPointer) {
+            MemoryCopy(NewPointer, Pointer, SlabSize);
+            SlabCacheFree(Pointer);
+        }
+        return NewPointer;
+    }
+
     LockMutex(&(Process->HeapMutex), INFINITY);
     NewPointer = HeapRealloc_HBHS(Process, Process->HeapBase, Process->HeapSize, Pointer, Size);
     UnlockMutex(&(Process->HeapMutex));
@@ -824,9 +883,29 @@ LPVOID HeapRealloc_P(LPPROCESS Process, LPVOID Pointer, UINT Size) {
  *
  * This function provides thread-safe memory deallocation by acquiring the
  * process's heap mutex before calling the core deallocation function.
+ * Slab objects go back to their cache when freed through the kernel heap,
+ * small blocks are parked in the process magazines, and a full magazine is
+ * drained to the heap. Pointers outside the heap are rejected.
  */
 void HeapFree_P(LPPROCESS Process, LPVOID Pointer) {
+    UINT FullClass;
+
+    // Slab objects belong to the kernel, other heaps never look them up
+    if (Process == &KernelProcess && SlabCacheFree(Pointer)) {
+        return;
+    }
+
+    if (HeapMagazineFree(Process, Pointer, &FullClass)) {
+        return;
+    }
+
     LockMutex(&(Process->HeapMutex), INFINITY);
+
+    // Also catches a block freed twice while still parked
+    if (FullClass != 0xFF) {
+        HeapMagazineDrain(Process, FullClass);
+    }
+
     HeapFree_HBHS(Process->HeapBase, Process->HeapSize, Pointer);
     UnlockMutex(&(Process->HeapMutex));
 }
@@ -26,6 +26,7 @@
 #include "Arch.h"
 #include "Base.h"
 #include "memory/BuddyAllocator.h"
+#include "memory/PageFrameCache.h"
 #include "text/CoreString.h"
 #include "console/Console-EarlyBoot.h"
 #include "core/Kernel.h"
@@ -104,6 +105,13 @@ void SetPhysicalPageMark(UINT Page, UINT Used) {
         return;
     }
 
+    if (Used == 0) {
+        PageFrameCacheFree((PHYSICAL)Page << PAGE_SIZE_MUL, FALSE);
+        return;
+    }
+
+    PageFrameCacheClaim((PHYSICAL)Page << PAGE_SIZE_MUL);
+
     LockMutex(MUTEX_MEMORY, INFINITY);
     BuddySetRange(Page, 1, Used);
     UnlockMutex(MUTEX_MEMORY);
@@ -482,9 +490,7 @@ PHYSICAL AllocPhysicalPage(void) {
         return 0;
     }
 
-    LockMutex(MUTEX_MEMORY, INFINITY);
-    Result = BuddyAllocPage();
-    UnlockMutex(MUTEX_MEMORY);
+    Result = PageFrameCacheAlloc();
 
     if (G_AllocPhysicalPageTraceEnabled) {
         EarlyBootConsoleWriteLine(TEXT("[AllocPhysicalPage] Return"));
@@ -495,6 +501,119 @@ PHYSICAL AllocPhysicalPage(void) {
 
 /************************************************************************/
 
+/**
+ * @brief Allocate a physically contiguous page range.
+ * @param PageCount Number of pages.
+ * @param Alignment Physical alignment in bytes, a power of two (0 for page alignment).
+ * @param MaxPhysical Highest physical address the range may touch (0 for no limit).
+ * @return Physical address of the first page or 0 on failure.
+ */
+PHYSICAL AllocPhysicalContiguous(UINT PageCount, UINT Alignment, PHYSICAL MaxPhysical) {
+    PHYSICAL Result = 0;
+
+    if (BuddyIsReady() == FALSE) {
+        return 0;
+    }
+
+    LockMutex(MUTEX_MEMORY, INFINITY);
+    Result = BuddyAllocContiguous(PageCount, Alignment, MaxPhysical);
+    UnlockMutex(MUTEX_MEMORY);
+
+    if (Result == 0) {
+        // Cached pages are held back from the buddy lists and may split the range we need
+        PageFrameCacheDrainAll();
+
+        LockMutex(MUTEX_MEMORY, INFINITY);
+        Result = BuddyAllocContiguous(PageCount, Alignment, MaxPhysical);
+        UnlockMutex(MUTEX_MEMORY);
+    }
+
+    return Result;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Allocate several physical pages, from the CPU page cache first.
+ * @param Pages Receives the physical address of each page.
+ * @param Count Number of pages wanted.
+ * @return Number of pages allocated.
+ */
+UINT AllocPhysicalPageBatch(PHYSICAL* Pages, UINT Count) {
+    return PageFrameCacheAllocBatch(Pages, Count);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Release a physically contiguous page range.
+ * @param Base Physical address of the first page.
+ * @param PageCount Number of pages.
+ */
+void FreePhysicalPageRange(PHYSICAL Base, UINT PageCount) {
+    if ((Base & (PAGE_SIZE - 1)) != 0) {
+        ERROR(TEXT("[FreePhysicalPageRange] Physical address not page-aligned (%x)"), Base);
+        return;
+    }
+
+    if (Base < RESERVED_LOW_MEMORY || PageCount == 0) {
+        return;
+    }
+
+    LockMutex(MUTEX_MEMORY, INFINITY);
+    BuddySetRange((UINT)(Base >> PAGE_SIZE_MUL), PageCount, 0);
+    UnlockMutex(MUTEX_MEMORY);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Hand out the next page of a batch, refilling the batch when empty.
+ * @param Batch Page batch, zeroed before first use.
+ * @param Remaining Number of pages the caller still needs, including this one.
+ * @return Physical page address or 0 when memory is exhausted.
+ */
+PHYSICAL PhysicalPageBatchTake(LPPHYSICAL_PAGE_BATCH Batch, UINT Remaining) {
+    if (Batch == NULL) {
+        return 0;
+    }
+
+    if (Batch->Next >= Batch->Count) {
+        UINT Wanted = Remaining;
+
+        if (Wanted == 0) Wanted = 1;
+        if (Wanted > PHYSICAL_PAGE_BATCH_SIZE) Wanted = PHYSICAL_PAGE_BATCH_SIZE;
+
+        Batch->Count = AllocPhysicalPageBatch(Batch->Pages, Wanted);
+        Batch->Next = 0;
+
+        if (Batch->Count == 0) {
+            return 0;
+        }
+    }
+
+    return Batch->Pages[Batch->Next++];
+}
+
+/************************************************************************/
+
+/**
+ * @brief Free the pages of a batch that were not handed out.
+ * @param Batch Page batch.
+ */
+void PhysicalPageBatchRelease(LPPHYSICAL_PAGE_BATCH Batch) {
+    if (Batch == NULL) {
+        return;
+    }
+
+    while (Batch->Next < Batch->Count) {
+        PageFrameCacheFree(Batch->Pages[Batch->Next], FALSE);
+        Batch->Next++;
+    }
+}
+
+/************************************************************************/
+
 /**
  * @brief Release a previously allocated physical page.
  * @param Page Page address to free.
@@ -524,11 +643,8 @@ void FreePhysicalPage(PHYSICAL Page) {
         return;
     }
 
-    LockMutex(MUTEX_MEMORY, INFINITY);
-    if (BuddyFreePage(Page) == FALSE) {
-        UnlockMutex(MUTEX_MEMORY);
+    if (PageFrameCacheFree(Page, FALSE) == FALSE) {
         DEBUG(TEXT("[FreePhysicalPage] Page already free or invalid (PA=%x)"), Page);
         return;
     }
-    UnlockMutex(MUTEX_MEMORY);
 }
@@ -0,0 +1,292 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Per-CPU page frame cache
+
+\************************************************************************/
+
+#include "memory/PageFrameCache.h"
+
+#include "Arch.h"
+#include "core/Kernel.h"
+#include "memory/BuddyAllocator.h"
+#include "text/CoreString.h"
+
+/************************************************************************/
+
+static PAGE_FRAME_CACHE DATA_SECTION PageFrameCaches[PAGE_FRAME_CACHE_MAX_CPUS];
+
+/************************************************************************/
+
+/**
+ * @brief Return the cache of the executing CPU.
+ *
+ * Must be called with interrupts disabled so that the task cannot migrate.
+ *
+ * @return Page frame cache.
+ */
+static LPPAGE_FRAME_CACHE PageFrameCacheGetCurrent(void) {
+    // Only the bootstrap processor runs kernel code for now
+    return &(PageFrameCaches[0]);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Find a page in a cache.
+ * @param Cache Cache to search.
+ * @param Page Physical page address.
+ * @return Slot index, or Cache->Count when absent.
+ */
+static UINT PageFrameCacheFind(LPPAGE_FRAME_CACHE Cache, PHYSICAL Page) {
+    UINT Index;
+
+    for (Index = 0; Index < Cache->Count; Index++) {
+        if (Cache->Pages[Index] == Page) {
+            break;
+        }
+    }
+
+    return Index;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Return pages to the buddy allocator.
+ * @param Pages Physical page addresses.
+ * @param Count Number of pages.
+ */
+static void PageFrameCacheReleaseToBuddy(const PHYSICAL* Pages, UINT Count) {
+    if (Count == 0) {
+        return;
+    }
+
+    LockMutex(MUTEX_MEMORY, INFINITY);
+
+    for (UINT Index = 0; Index < Count; Index++) {
+        BuddyFreePage(Pages[Index]);
+    }
+
+    UnlockMutex(MUTEX_MEMORY);
+}
+
+/************************************************************************/
+
+UINT PageFrameCacheAllocBatch(PHYSICAL* Pages, UINT Count) {
+    LPPAGE_FRAME_CACHE Cache;
+    PHYSICAL Refill[PAGE_FRAME_CACHE_BATCH];
+    UINT RefillCount = 0;
+    UINT Filled = 0;
+    U32 Flags;
+
+    if (Pages == NULL || Count == 0 || BuddyIsReady() == FALSE) {
+        return 0;
+    }
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    Cache = PageFrameCacheGetCurrent();
+
+    while (Filled < Count && Cache->Count > 0) {
+        Cache->Count--;
+        Pages[Filled] = Cache->Pages[Cache->Count];
+        Filled++;
+        Cache->Hits++;
+    }
+
+    RestoreFlags(&Flags);
+
+    if (Filled == Count) {
+        return Filled;
+    }
+
+    LockMutex(MUTEX_MEMORY, INFINITY);
+    Filled += BuddyAllocPageBatch(Pages + Filled, Count - Filled);
+    RefillCount = BuddyAllocPageBatch(Refill, PAGE_FRAME_CACHE_BATCH);
+    UnlockMutex(MUTEX_MEMORY);
+
+    if (RefillCount == 0) {
+        return Filled;
+    }
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    Cache = PageFrameCacheGetCurrent();
+    Cache->Refills++;
+
+    // Keep ascending addresses on the hot end so that consecutive allocations stay contiguous
+    while (RefillCount > 0 && Cache->Count < PAGE_FRAME_CACHE_HIGH) {
+        RefillCount--;
+        Cache->Pages[Cache->Count] = Refill[RefillCount];
+        Cache->Count++;
+    }
+
+    RestoreFlags(&Flags);
+
+    PageFrameCacheReleaseToBuddy(Refill, RefillCount);
+
+    return Filled;
+}
+
+/************************************************************************/
+
+PHYSICAL PageFrameCacheAlloc(void) {
+    PHYSICAL Page = 0;
+
+    if (PageFrameCacheAllocBatch(&Page, 1) == 0) {
+        return 0;
+    }
+
+    return Page;
+}
+
+/************************************************************************/
+
+BOOL PageFrameCacheFree(PHYSICAL Page, BOOL Cold) {
+    LPPAGE_FRAME_CACHE Cache;
+    PHYSICAL Drained[PAGE_FRAME_CACHE_BATCH];
+    UINT DrainCount = 0;
+    BOOL Result = TRUE;
+    U32 Flags;
+
+    if (BuddyIsReady() == FALSE) {
+        return FALSE;
+    }
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    Cache = PageFrameCacheGetCurrent();
+
+    if (BuddyIsPageUsed(Page) == FALSE || PageFrameCacheFind(Cache, Page) < Cache->Count) {
+        Result = FALSE;
+    } else {
+        if (Cache->Count >= PAGE_FRAME_CACHE_HIGH) {
+            // Full: the coldest pages go back to the buddy allocator
+            DrainCount = PAGE_FRAME_CACHE_BATCH;
+            MemoryCopy(Drained, Cache->Pages, DrainCount * sizeof(PHYSICAL));
+            MemoryMove(Cache->Pages, Cache->Pages + DrainCount, (Cache->Count - DrainCount) * sizeof(PHYSICAL));
+            Cache->Count -= DrainCount;
+            Cache->Drains++;
+        }
+
+        if (Cold) {
+            MemoryMove(Cache->Pages + 1, Cache->Pages, Cache->Count * sizeof(PHYSICAL));
+            Cache->Pages[0] = Page;
+        } else {
+            Cache->Pages[Cache->Count] = Page;
+        }
+
+        Cache->Count++;
+        Cache->Frees++;
+    }
+
+    RestoreFlags(&Flags);
+
+    PageFrameCacheReleaseToBuddy(Drained, DrainCount);
+
+    return Result;
+}
+
+/************************************************************************/
+
+BOOL PageFrameCacheClaim(PHYSICAL Page) {
+    BOOL Found = FALSE;
+    U32 Flags;
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    for (UINT Cpu = 0; Cpu < PAGE_FRAME_CACHE_MAX_CPUS && Found == FALSE; Cpu++) {
+        LPPAGE_FRAME_CACHE Cache = &(PageFrameCaches[Cpu]);
+        UINT Index = PageFrameCacheFind(Cache, Page);
+
+        if (Index < Cache->Count) {
+            MemoryMove(Cache->Pages + Index, Cache->Pages + Index + 1, (Cache->Count - Index - 1) * sizeof(PHYSICAL));
+            Cache->Count--;
+            Found = TRUE;
+        }
+    }
+
+    RestoreFlags(&Flags);
+
+    return Found;
+}
+
+/************************************************************************/
+
+void PageFrameCacheDrainAll(void) {
+    PHYSICAL Drained[PAGE_FRAME_CACHE_HIGH];
+
+    for (UINT Cpu = 0; Cpu < PAGE_FRAME_CACHE_MAX_CPUS; Cpu++) {
+        LPPAGE_FRAME_CACHE Cache = &(PageFrameCaches[Cpu]);
+        UINT Count;
+        U32 Flags;
+
+        SaveFlags(&Flags);
+        DisableInterrupts();
+
+        Count = Cache->Count;
+        MemoryCopy(Drained, Cache->Pages, Count * sizeof(PHYSICAL));
+        Cache->Count = 0;
+
+        if (Count != 0) {
+            Cache->Drains++;
+        }
+
+        RestoreFlags(&Flags);
+
+        PageFrameCacheReleaseToBuddy(Drained, Count);
+    }
+}
+
+/************************************************************************/
+
+UINT PageFrameCacheGetCachedCount(void) {
+    UINT Count = 0;
+
+    for (UINT Cpu = 0; Cpu < PAGE_FRAME_CACHE_MAX_CPUS; Cpu++) {
+        Count += PageFrameCaches[Cpu].Count;
+    }
+
+    return Count;
+}
+
+/************************************************************************/
+
+BOOL PageFrameCacheGetInfo(UINT Cpu, LPPAGE_FRAME_CACHE_INFO Info) {
+    LPPAGE_FRAME_CACHE Cache;
+
+    if (Info == NULL || Cpu >= PAGE_FRAME_CACHE_MAX_CPUS) {
+        return FALSE;
+    }
+
+    Cache = &(PageFrameCaches[Cpu]);
+
+    Info->Count = Cache->Count;
+    Info->Hits = Cache->Hits;
+    Info->Refills = Cache->Refills;
+    Info->Drains = Cache->Drains;
+    Info->Frees = Cache->Frees;
+
+    return TRUE;
+}
@@ -0,0 +1,315 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Slab caches and magazines
+
+\************************************************************************/
+
+#include "memory/Slab.h"
+
+#include "Arch.h"
+#include "log/Log.h"
+#include "memory/Heap.h"
+#include "memory/Memory.h"
+#include "text/CoreString.h"
+
+/************************************************************************/
+
+static LPSLAB_CACHE DATA_SECTION SlabCaches[SLAB_MAX_CACHES];
+static UINT DATA_SECTION SlabCacheCount = 0;
+
+/************************************************************************/
+
+LPVOID SlabMagazinePop(LPSLAB_MAGAZINE Magazine) {
+    LPVOID Object = NULL;
+    U32 Flags;
+
+    if (Magazine == NULL) {
+        return NULL;
+    }
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    if (Magazine->Count > 0) {
+        Magazine->Count--;
+        Object = Magazine->Objects[Magazine->Count];
+        Magazine->Objects[Magazine->Count] = NULL;
+    }
+
+    RestoreFlags(&Flags);
+
+    return Object;
+}
+
+/************************************************************************/
+
+BOOL SlabMagazinePush(LPSLAB_MAGAZINE Magazine, LPVOID Object) {
+    BOOL Result = FALSE;
+    U32 Flags;
+
+    if (Magazine == NULL || Object == NULL) {
+        return FALSE;
+    }
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    if (Magazine->Count < SLAB_MAGAZINE_SIZE) {
+        Result = TRUE;
+
+        for (UINT Index = 0; Index < Magazine->Count; Index++) {
+            if (Magazine->Objects[Index] == Object) {
+                Result = FALSE;
+                break;
+            }
+        }
+
+        if (Result) {
+            Magazine->Objects[Magazine->Count] = Object;
+            Magazine->Count++;
+        }
+    }
+
+    RestoreFlags(&Flags);
+
+    return Result;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Create the slabs of a cache and register it, once.
+ *
+ * Must be called with the cache mutex held.
+ *
+ * @param Cache Cache to prepare.
+ * @return TRUE when the slabs can be used.
+ */
+static BOOL SlabCacheEnsureReady(LPSLAB_CACHE Cache) {
+    UINT ObjectSize;
+    BOOL Registered = FALSE;
+    U32 Flags;
+
+    if (Cache->Ready) {
+        return TRUE;
+    }
+
+    ObjectSize = (Cache->ObjectSize + SLAB_OBJECT_ALIGNMENT - 1) & ~(SLAB_OBJECT_ALIGNMENT - 1);
+
+    if (BlockListInit(&(Cache->Objects), ObjectSize, 0, 0, 0) == FALSE) {
+        ERROR(TEXT("[SlabCacheEnsureReady] BlockListInit failed for %s"), Cache->Name);
+        return FALSE;
+    }
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    if (SlabCacheCount < SLAB_MAX_CACHES) {
+        SlabCaches[SlabCacheCount] = Cache;
+        SlabCacheCount++;
+        Registered = TRUE;
+    }
+
+    RestoreFlags(&Flags);
+
+    if (Registered == FALSE) {
+        WARNING(TEXT("[SlabCacheEnsureReady] Too many caches, %s uses the kernel heap"), Cache->Name);
+        BlockListFinalize(&(Cache->Objects));
+        return FALSE;
+    }
+
+    Cache->Ready = TRUE;
+
+    DEBUG(TEXT("[SlabCacheEnsureReady] %s: size=%u stride=%u per slab=%u"), Cache->Name, Cache->ObjectSize,
+        Cache->Objects.ObjectStride, Cache->Objects.ObjectsPerSlab);
+
+    return TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Find the cache whose slabs contain an address.
+ * @param Pointer Object address.
+ * @return Owning cache, or NULL.
+ */
+static LPSLAB_CACHE SlabFindCache(LPCVOID Pointer) {
+    LINEAR Address = (LINEAR)Pointer;
+
+    if (Pointer == NULL) {
+        return NULL;
+    }
+
+    for (UINT Index = 0; Index < SlabCacheCount; Index++) {
+        LPSLAB_CACHE Cache = SlabCaches[Index];
+        LINEAR Base = Cache->Objects.RegionBase;
+
+        if (Base != 0 && Address >= Base && Address < Base + Cache->Objects.RegionSize) {
+            return Cache;
+        }
+    }
+
+    return NULL;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Return every magazine object of a cache to its slabs.
+ *
+ * Must be called with the cache mutex held.
+ *
+ * @param Cache Cache to drain.
+ */
+static void SlabCacheDrainMagazine(LPSLAB_CACHE Cache) {
+    LPVOID Object;
+
+    while ((Object = SlabMagazinePop(&(Cache->Magazine))) != NULL) {
+        BlockListFree(&(Cache->Objects), (LINEAR)Object);
+    }
+}
+
+/************************************************************************/
+
+LPVOID SlabCacheAlloc(LPSLAB_CACHE Cache) {
+    LPVOID Object;
+
+    if (Cache == NULL || Cache->ObjectSize == 0) {
+        return NULL;
+    }
+
+    Object = SlabMagazinePop(&(Cache->Magazine));
+
+    if (Object != NULL) {
+        Cache->Hits++;
+        MemorySet(Object, 0, Cache->ObjectSize);
+        return Object;
+    }
+
+    LockMutex(&(Cache->Mutex), INFINITY);
+
+    if (SlabCacheEnsureReady(Cache)) {
+        Object = (LPVOID)BlockListAllocate(&(Cache->Objects));
+
+        if (Object != NULL) {
+            Cache->Misses++;
+
+            // Preload half a magazine so that a burst of allocations stays lock-free
+            while (Cache->Magazine.Count < SLAB_MAGAZINE_SIZE / 2 &&
+                   Cache->Objects.FreeCount > 0) {
+                LINEAR Spare = BlockListAllocate(&(Cache->Objects));
+
+                if (Spare == 0) break;
+
+                if (SlabMagazinePush(&(Cache->Magazine), (LPVOID)Spare) == FALSE) {
+                    BlockListFree(&(Cache->Objects), Spare);
+                    break;
+                }
+            }
+        }
+    }
+
+    UnlockMutex(&(Cache->Mutex));
+
+    if (Object != NULL) {
+        return Object;
+    }
+
+    Object = KernelHeapAlloc(Cache->ObjectSize);
+
+    SAFE_USE(Object) {
+        Cache->Fallbacks++;
+        MemorySet(Object, 0, Cache->ObjectSize);
+    }
+
+    return Object;
+}
+
+/************************************************************************/
+
+BOOL SlabCacheFree(LPVOID Pointer) {
+    LPSLAB_CACHE Cache = SlabFindCache(Pointer);
+
+    if (Cache == NULL) {
+        return FALSE;
+    }
+
+    Cache->Frees++;
+
+    if (SlabMagazinePush(&(Cache->Magazine), Pointer)) {
+        return TRUE;
+    }
+
+    // Magazine full (or Pointer already in it): hand everything back to the slabs
+    LockMutex(&(Cache->Mutex), INFINITY);
+    SlabCacheDrainMagazine(Cache);
+    BlockListFree(&(Cache->Objects), (LINEAR)Pointer);
+    UnlockMutex(&(Cache->Mutex));
+
+    return TRUE;
+}
+
+/************************************************************************/
+
+UINT SlabCacheGetObjectSize(LPCVOID Pointer) {
+    LPSLAB_CACHE Cache = SlabFindCache(Pointer);
+
+    if (Cache == NULL) {
+        return 0;
+    }
+
+    return Cache->ObjectSize;
+}
+
+/************************************************************************/
+
+UINT SlabGetCacheCount(void) { return SlabCacheCount; }
+
+/************************************************************************/
+
+BOOL SlabGetCacheInfo(UINT Index, LPSLAB_CACHE_INFO Info) {
+    LPSLAB_CACHE Cache;
+    UINT Used;
+
+    if (Info == NULL || Index >= SlabCacheCount) {
+        return FALSE;
+    }
+
+    Cache = SlabCaches[Index];
+
+    LockMutex(&(Cache->Mutex), INFINITY);
+
+    Used = BlockListGetUsage(&(Cache->Objects));
+
+    Info->Name = Cache->Name;
+    Info->ObjectSize = Cache->ObjectSize;
+    Info->Hits = Cache->Hits;
+    Info->Misses = Cache->Misses;
+    Info->Fallbacks = Cache->Fallbacks;
+    Info->Frees = Cache->Frees;
+    Info->MagazineCount = Cache->Magazine.Count;
+    Info->InUse = (Used > Info->MagazineCount) ? Used - Info->MagazineCount : 0;
+    Info->Capacity = BlockListGetCapacity(&(Cache->Objects));
+    Info->SlabCount = BlockListGetSlabCount(&(Cache->Objects));
+
+    UnlockMutex(&(Cache->Mutex));
+
+    return TRUE;
+}
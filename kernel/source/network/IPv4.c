@@ -46,6 +46,10 @@ static U16 NextID = 1; // IPv4 packet identification counter
 
 #define IPV4_MAX_PROTOCOLS 256
 #define IPV4_DEFAULT_TTL 64
+#define IPV4_MTU 1500
+#define IPV4_TCP_HEADER_MIN 20
+#define IPV4_TCP_DATA_OFFSET_FIELD 12   // Data offset byte in the TCP header
+#define IPV4_TCP_CHECKSUM_FIELD 16      // Checksum word in the TCP header
 
 /************************************************************************/
 // Global state
@@ -108,13 +112,55 @@ int IPv4_ValidateChecksum(IPV4_HEADER* Header) {
 /**
  * @brief Sends a raw Ethernet frame.
  *
- * @param Data   Pointer to frame data.
- * @param Length Frame length in bytes.
+ * @param Data    Pointer to frame data.
+ * @param Length  Frame length in bytes.
+ * @param Offload Work left to the NIC, NULL for none.
  * @return 1 on success, otherwise 0.
  */
-static INT IPv4_SendEthernetFrame(LPIPV4_CONTEXT Context, const U8* Data, U32 Length) {
+static INT IPv4_SendEthernetFrame(LPIPV4_CONTEXT Context, const U8* Data, U32 Length, const NETWORK_OFFLOAD* Offload) {
     if (Context == NULL) return 0;
-    return Network_SendRawFrame(Context->Device, Data, Length);
+    return Network_SendFrame(Context->Device, Data, Length, Offload);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Leaves the TCP checksum, and segmentation when asked, to the NIC.
+ *
+ * Writes the folded pseudo-header sum in the checksum field. The length is
+ * left out of it for segmentation, the NIC adds the length of each segment.
+ *
+ * @param Frame Ethernet frame holding an IPv4 packet with a TCP segment.
+ * @param NetworkOffset Offset of the IPv4 header.
+ * @param SegmentLength Length of the TCP header and payload.
+ * @param Segment TRUE to request segmentation.
+ * @param Offload Receives the offload description.
+ */
+static void IPv4_PrepareTcpOffload(U8* Frame, U32 NetworkOffset, U32 SegmentLength, BOOL Segment, LPNETWORK_OFFLOAD Offload) {
+    const IPV4_HEADER* Header = (const IPV4_HEADER*)(Frame + NetworkOffset);
+    U32 TransportOffset = NetworkOffset + sizeof(IPV4_HEADER);
+    U32 TcpHeaderLength = ((Frame[TransportOffset + IPV4_TCP_DATA_OFFSET_FIELD] >> 4) & 0x0F) * 4;
+    U32 Accumulator = 0;
+    U8 PseudoHeader[12];
+    U16 Seed;
+
+    MemoryCopy(PseudoHeader, &(Header->SourceAddress), 4);
+    MemoryCopy(PseudoHeader + 4, &(Header->DestinationAddress), 4);
+    PseudoHeader[8] = 0;
+    PseudoHeader[9] = IPV4_PROTOCOL_TCP;
+    PseudoHeader[10] = Segment ? 0 : (U8)(SegmentLength >> 8);
+    PseudoHeader[11] = Segment ? 0 : (U8)(SegmentLength & 0xFF);
+
+    Accumulator = NetworkChecksum_Calculate_Accumulate(PseudoHeader, sizeof(PseudoHeader), Accumulator);
+    Seed = NetworkChecksum_Fold(Accumulator);
+    MemoryCopy(Frame + TransportOffset + IPV4_TCP_CHECKSUM_FIELD, &Seed, sizeof(U16));
+
+    Offload->Flags = NETWORK_OFFLOAD_TRANSPORT_CHECKSUM | (Segment ? NETWORK_OFFLOAD_TCP_SEGMENTATION : 0);
+    Offload->NetworkOffset = (U8)NetworkOffset;
+    Offload->TransportOffset = (U8)TransportOffset;
+    Offload->ChecksumOffset = (U8)(TransportOffset + IPV4_TCP_CHECKSUM_FIELD);
+    Offload->HeaderLength = (U8)(TransportOffset + TcpHeaderLength);
+    Offload->SegmentSize = (U16)(IPV4_MTU - sizeof(IPV4_HEADER) - TcpHeaderLength);
 }
 
 /************************************************************************/
@@ -187,9 +233,14 @@ static INT IPv4_SendResolvedPacket(
     U32 EthernetHeaderSize;
     U32 TotalFrameSize;
     U8 FrameBuffer[1514];
+    U8* Frame = FrameBuffer;
     U8 SourceMAC[6];
     ETHERNET_HEADER* EthernetHeader;
     IPV4_HEADER* IPv4Header;
+    NETWORK_OFFLOAD Offload;
+    const NETWORK_OFFLOAD* FrameOffload = NULL;
+    BOOL Segment = FALSE;
+    INT Result;
 
     if (Context == NULL || DestinationMAC == NULL) return 0;
     if (Context->Device == NULL) return 0;
@@ -198,15 +249,29 @@ static INT IPv4_SendResolvedPacket(
     IPv4HeaderSize = sizeof(IPV4_HEADER);
     EthernetHeaderSize = sizeof(ETHERNET_HEADER);
     TotalFrameSize = EthernetHeaderSize + IPv4HeaderSize + PayloadLength;
-    if (TotalFrameSize > sizeof(FrameBuffer)) return 0;
+
+    if (TotalFrameSize > sizeof(FrameBuffer)) {
+        // Only a TCP segment that the NIC splits itself may exceed the MTU
+        if (Protocol != IPV4_PROTOCOL_TCP || (Context->DeviceCaps & NETWORK_CAP_TSO) == 0 ||
+            (Context->DeviceCaps & NETWORK_CAP_TX_CHECKSUM) == 0 || IPv4HeaderSize + PayloadLength > MAX_U16) {
+            return 0;
+        }
+        Segment = TRUE;
+    }
+
     if (!IPv4_GetSourceMACAddress(Context->Device, SourceMAC)) return 0;
 
-    EthernetHeader = (ETHERNET_HEADER*)FrameBuffer;
+    if (Segment) {
+        Frame = (U8*)KernelHeapAlloc(TotalFrameSize);
+        if (Frame == NULL) return 0;
+    }
+
+    EthernetHeader = (ETHERNET_HEADER*)Frame;
     MemoryCopy(EthernetHeader->Destination, DestinationMAC, 6);
     MemoryCopy(EthernetHeader->Source, SourceMAC, 6);
     EthernetHeader->EthType = Htons(ETHTYPE_IPV4);
 
-    IPv4Header = (IPV4_HEADER*)(FrameBuffer + EthernetHeaderSize);
+    IPv4Header = (IPV4_HEADER*)(Frame + EthernetHeaderSize);
     MemorySet(IPv4Header, 0, sizeof(IPV4_HEADER));
     IPv4Header->VersionIHL = 0x45;
     IPv4Header->TypeOfService = 0;
@@ -222,10 +287,22 @@ static INT IPv4_SendResolvedPacket(
     IPv4Header->HeaderChecksum = IPv4_CalculateChecksum(IPv4Header);
 
     if (PayloadLength > 0) {
-        MemoryCopy(FrameBuffer + EthernetHeaderSize + IPv4HeaderSize, Payload, PayloadLength);
+        MemoryCopy(Frame + EthernetHeaderSize + IPv4HeaderSize, Payload, PayloadLength);
+    }
+
+    if (Protocol == IPV4_PROTOCOL_TCP && (Context->DeviceCaps & NETWORK_CAP_TX_CHECKSUM) != 0 &&
+        PayloadLength >= IPV4_TCP_HEADER_MIN) {
+        IPv4_PrepareTcpOffload(Frame, EthernetHeaderSize, PayloadLength, Segment, &Offload);
+        FrameOffload = &Offload;
     }
 
-    return IPv4_SendEthernetFrame(Context, FrameBuffer, TotalFrameSize);
+    Result = IPv4_SendEthernetFrame(Context, Frame, TotalFrameSize, FrameOffload);
+
+    if (Frame != FrameBuffer) {
+        KernelHeapFree(Frame);
+    }
+
+    return Result;
 }
 
 /************************************************************************/
@@ -236,8 +313,9 @@ static INT IPv4_SendResolvedPacket(
  *
  * @param Packet      Pointer to the IPv4 header.
  * @param TotalLength Total packet length including header.
+ * @param Flags       NETWORK_RX_* flags of the frame.
  */
-static void IPv4_HandlePacket(LPIPV4_CONTEXT Context, const IPV4_HEADER* Packet, U32 TotalLength) {
+static void IPv4_HandlePacket(LPIPV4_CONTEXT Context, const IPV4_HEADER* Packet, U32 TotalLength, U32 Flags) {
     if (Context == NULL) return;
     U8 Version = (Packet->VersionIHL >> 4) & 0x0F;
     U8 IHL = Packet->VersionIHL & 0x0F;
@@ -265,8 +343,8 @@ static void IPv4_HandlePacket(LPIPV4_CONTEXT Context, const IPV4_HEADER* Packet,
         return;
     }
 
-    // Validate checksum
-    if (!IPv4_ValidateChecksum((IPV4_HEADER*)Packet)) {
+    // Validate checksum, unless the NIC already did
+    if ((Flags & NETWORK_RX_IPV4_CHECKSUM_OK) == 0 && !IPv4_ValidateChecksum((IPV4_HEADER*)Packet)) {
         return;
     }
 
@@ -298,7 +376,7 @@ static void IPv4_HandlePacket(LPIPV4_CONTEXT Context, const IPV4_HEADER* Packet,
     // Dispatch to protocol handler
     IPv4_ProtocolHandler Handler = Context->ProtocolHandlers[Packet->Protocol];
     if (Handler) {
-        Handler(Payload, PayloadLength, Packet->SourceAddress, Packet->DestinationAddress);
+        Handler(Payload, PayloadLength, Packet->SourceAddress, Packet->DestinationAddress, Flags);
     } else {
     }
 }
@@ -319,6 +397,7 @@ void IPv4_Initialize(LPDEVICE Device, U32 LocalIPv4_Be) {
     Context->LocalIPv4_Be = LocalIPv4_Be;
     Context->NetmaskBe = 0;
     Context->DefaultGatewayBe = 0;
+    Context->DeviceCaps = Network_GetCaps(Device);
 
     // Clear protocol handlers
     for (i = 0; i < IPV4_MAX_PROTOCOLS; i++) {
@@ -344,6 +423,25 @@ void IPv4_Initialize(LPDEVICE Device, U32 LocalIPv4_Be) {
 
 /************************************************************************/
 
+/**
+ * @brief Returns the offload capabilities of the device under an IPv4 context.
+ *
+ * TCP leaves its checksum to IPv4 and the NIC when NETWORK_CAP_TX_CHECKSUM
+ * is set, and builds segments larger than the MTU when NETWORK_CAP_TSO is.
+ *
+ * @param Device Network device.
+ * @return NETWORK_CAP_* flags, 0 without an IPv4 context.
+ */
+U32 IPv4_GetDeviceCaps(LPDEVICE Device) {
+    LPIPV4_CONTEXT Context = IPv4_GetContext(Device);
+
+    if (Context == NULL) return 0;
+
+    return Context->DeviceCaps;
+}
+
+/************************************************************************/
+
 void IPv4_Destroy(LPDEVICE Device) {
     LPIPV4_CONTEXT Context;
 
@@ -523,8 +621,9 @@ static int IPv4_SendDirect(LPIPV4_CONTEXT Context, U32 DestinationIP, U32 NextHo
  *
  * @param Frame  Pointer to Ethernet frame data.
  * @param Length Frame length in bytes.
+ * @param Flags  NETWORK_RX_* flags reported by the driver.
  */
-void IPv4_OnEthernetFrame(LPDEVICE Device, const U8* Frame, U32 Length) {
+void IPv4_OnEthernetFrame(LPDEVICE Device, const U8* Frame, U32 Length, U32 Flags) {
     LPIPV4_CONTEXT Context;
 
     if (Device == NULL || Frame == NULL) {
@@ -549,7 +648,7 @@ void IPv4_OnEthernetFrame(LPDEVICE Device, const U8* Frame, U32 Length) {
     const IPV4_HEADER* IPv4Hdr = (const IPV4_HEADER*)(Frame + sizeof(ETHERNET_HEADER));
     U32 IPv4Length = Length - sizeof(ETHERNET_HEADER);
 
-    IPv4_HandlePacket(Context, IPv4Hdr, IPv4Length);
+    IPv4_HandlePacket(Context, IPv4Hdr, IPv4Length, Flags);
 }
 
 /************************************************************************/
@@ -38,6 +38,21 @@
  * @return 1 on success, 0 otherwise.
  */
 INT Network_SendRawFrame(LPDEVICE Device, const U8 *Data, U32 Length) {
+    return Network_SendFrame(Device, Data, Length, NULL);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Send an Ethernet frame with work left to the NIC.
+ *
+ * @param Device Target network device.
+ * @param Data Pointer to frame buffer.
+ * @param Length Frame length in bytes.
+ * @param Offload Offloads to apply, NULL for none.
+ * @return 1 on success, 0 otherwise.
+ */
+INT Network_SendFrame(LPDEVICE Device, const U8 *Data, U32 Length, const NETWORK_OFFLOAD *Offload) {
     NETWORK_SEND Send;
     INT Result = 0;
 
@@ -52,6 +67,7 @@ INT Network_SendRawFrame(LPDEVICE Device, const U8 *Data, U32 Length) {
     Send.Device = (LPPCI_DEVICE)Device;
     Send.Data = Data;
     Send.Length = Length;
+    Send.Offload = Offload;
     SAFE_USE_VALID_ID(Device, KOID_PCIDEVICE) {
         SAFE_USE_VALID_ID(((LPPCI_DEVICE)Device)->Driver, KOID_DRIVER) {
             Result =
@@ -64,3 +80,78 @@ INT Network_SendRawFrame(LPDEVICE Device, const U8 *Data, U32 Length) {
 }
 
 /************************************************************************/
+
+/**
+ * @brief Query the offload capabilities of a network device.
+ *
+ * @param Device Network device.
+ * @return NETWORK_CAP_* flags, 0 when the driver has none.
+ */
+U32 Network_GetCaps(LPDEVICE Device) {
+    U32 Caps = 0;
+
+    if (Device == NULL) return 0;
+
+    SAFE_USE_VALID_ID(Device, KOID_PCIDEVICE) {
+        SAFE_USE_VALID_ID(((LPPCI_DEVICE)Device)->Driver, KOID_DRIVER) {
+            Caps = ((LPPCI_DEVICE)Device)->Driver->Command(DF_GET_CAPS, 0);
+        }
+    }
+
+    return Caps;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Send several raw Ethernet frames through a network device.
+ *
+ * Uses DF_NT_SEND_BATCH when the driver implements it, otherwise sends
+ * the frames one by one.
+ *
+ * @param Device Target network device.
+ * @param Frames Frames to send, in order.
+ * @param Count Number of frames.
+ * @return Number of frames accepted, counted from the first one.
+ */
+U32 Network_SendRawFrames(LPDEVICE Device, const NETWORK_FRAME *Frames, U32 Count) {
+    NETWORK_SEND_BATCH Batch;
+    NETWORK_SEND Send;
+    U32 Result = DF_RETURN_NOT_IMPLEMENTED;
+    U32 Sent = 0;
+
+    if (Device == NULL || Frames == NULL || Count == 0) return 0;
+
+    LockMutex(&(Device->Mutex), INFINITY);
+
+    SAFE_USE_VALID_ID(Device, KOID_PCIDEVICE) {
+        SAFE_USE_VALID_ID(((LPPCI_DEVICE)Device)->Driver, KOID_DRIVER) {
+            Batch.Device = (LPPCI_DEVICE)Device;
+            Batch.Frames = Frames;
+            Batch.Count = Count;
+            Batch.Sent = 0;
+
+            Result = ((LPPCI_DEVICE)Device)->Driver->Command(DF_NT_SEND_BATCH, (UINT)(LPVOID)&Batch);
+            Sent = Batch.Sent;
+
+            if (Result == DF_RETURN_NOT_IMPLEMENTED) {
+                Send.Device = (LPPCI_DEVICE)Device;
+
+                for (Sent = 0; Sent < Count; Sent++) {
+                    Send.Data = Frames[Sent].Data;
+                    Send.Length = Frames[Sent].Length;
+                    Send.Offload = Frames[Sent].Offload;
+
+                    if (((LPPCI_DEVICE)Device)->Driver->Command(DF_NT_SEND, (UINT)(LPVOID)&Send) != DF_RETURN_SUCCESS) {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    UnlockMutex(&(Device->Mutex));
+    return Sent;
+}
+
+/************************************************************************/
@@ -148,16 +148,17 @@ static U32 NetworkManager_GetDeviceConfigIP(LPCSTR deviceName, LPCSTR configKey,
 /************************************************************************/
 
 // Forward declaration
-static void NetworkManager_RxCallback(const U8 *Frame, U32 Length, LPVOID UserData);
+static void NetworkManager_RxCallback(const U8 *Frame, U32 Length, U32 Flags, LPVOID UserData);
 
 /**
  * @brief Internal frame reception handler that dispatches to protocol layers.
  *
  * @param Frame Pointer to the received ethernet frame
  * @param Length Length of the frame in bytes
+ * @param Flags NETWORK_RX_* flags reported by the driver
  * @param UserData Pointer to the NETWORK_DEVICE_CONTEXT
  */
-static void NetworkManager_RxCallback(const U8 *Frame, U32 Length, LPVOID UserData) {
+static void NetworkManager_RxCallback(const U8 *Frame, U32 Length, U32 Flags, LPVOID UserData) {
     LPNETWORK_DEVICE_CONTEXT Context = (LPNETWORK_DEVICE_CONTEXT)UserData;
     LPDEVICE Device = NULL;
 
@@ -177,7 +178,7 @@ static void NetworkManager_RxCallback(const U8 *Frame, U32 Length, LPVOID UserDa
             ARP_OnEthernetFrame(Device, Frame, Length);
             break;
         case ETHTYPE_IPV4:
-            IPv4_OnEthernetFrame(Device, Frame, Length);
+            IPv4_OnEthernetFrame(Device, Frame, Length, Flags);
             break;
         default:
             break;
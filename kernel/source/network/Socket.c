@@ -36,6 +36,9 @@
 #include "network/TCP.h"
 #include "network/UDP.h"
 #include "utils/CircularBuffer.h"
+#include "process/Schedule.h"
+#include "process/Task.h"
+#include "Arch.h"
 
 /************************************************************************/
 // Global socket management
@@ -45,25 +48,355 @@ typedef struct tag_SOCKET_UDP_DATAGRAM_HEADER {
     U32 PayloadLength;
 } SOCKET_UDP_DATAGRAM_HEADER, *LPSOCKET_UDP_DATAGRAM_HEADER;
 
+#define SOCKET_PORT_BUCKETS 64      // Power of two
+
+// Waiters of one SocketPoll call
+typedef struct tag_SOCKET_POLL_WAIT {
+    LPSOCKET_WAITER Waiters;
+    U32 Count;
+} SOCKET_POLL_WAIT, *LPSOCKET_POLL_WAIT;
+
+// Bound sockets by local port, chained by PortNext
+static LPSOCKET DATA_SECTION SocketPortTable[SOCKET_PORT_BUCKETS];
+
 /************************************************************************/
 
-static BOOL Socket_IsUDPPortInUseByAnotherSocket(LPSOCKET ExcludedSocket, U16 PortBe) {
-    LPLIST SocketList = GetSocketList();
-    LPSOCKET Current = (LPSOCKET)(SocketList != NULL ? SocketList->First : NULL);
-
-    while (Current) {
-        SAFE_USE(Current) {
-            if (Current != ExcludedSocket &&
-                Current->SocketType == SOCKET_TYPE_DGRAM &&
-                Current->State >= SOCKET_STATE_BOUND &&
-                Current->State != SOCKET_STATE_CLOSED &&
-                Current->LocalAddress.Port == PortBe) {
-                return TRUE;
+/**
+ * @brief Compute the bound port table bucket of a port.
+ * @param PortBe Port, network byte order.
+ * @return Bucket index.
+ */
+static U32 Socket_PortBucket(U16 PortBe) {
+    return (U32)Ntohs(PortBe) & (SOCKET_PORT_BUCKETS - 1);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Add a bound socket to the bound port table.
+ * @param Socket Socket with its local address set.
+ */
+static void Socket_LinkPort(LPSOCKET Socket) {
+    U32 Bucket = Socket_PortBucket(Socket->LocalAddress.Port);
+
+    if (Socket->PortLinked) return;
+
+    Socket->PortNext = SocketPortTable[Bucket];
+    SocketPortTable[Bucket] = Socket;
+    Socket->PortLinked = TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Remove a socket from the bound port table.
+ * @param Socket Socket, ignored when not linked.
+ */
+static void Socket_UnlinkPort(LPSOCKET Socket) {
+    LPSOCKET* Link;
+
+    if (Socket->PortLinked == FALSE) return;
+
+    Link = &(SocketPortTable[Socket_PortBucket(Socket->LocalAddress.Port)]);
+    while (*Link != NULL && *Link != Socket) Link = &((*Link)->PortNext);
+    if (*Link != NULL) *Link = Socket->PortNext;
+
+    Socket->PortNext = NULL;
+    Socket->PortLinked = FALSE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Link a waiter on a socket.
+ * @param Socket Socket to wait on.
+ * @param Waiter Waiter with its task set.
+ */
+static void Socket_AddWaiter(LPSOCKET Socket, LPSOCKET_WAITER Waiter) {
+    U32 Flags;
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    Waiter->Socket = Socket;
+    Waiter->Next = Socket->Waiters;
+    Socket->Waiters = Waiter;
+
+    RestoreFlags(&Flags);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Unlink a waiter from its socket.
+ * @param Waiter Waiter, ignored when the socket already dropped it.
+ */
+static void Socket_RemoveWaiter(LPSOCKET_WAITER Waiter) {
+    LPSOCKET_WAITER* Link;
+    LPSOCKET Socket;
+    U32 Flags;
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    Socket = (LPSOCKET)Waiter->Socket;
+    if (Socket != NULL) {
+        Link = &(Socket->Waiters);
+        while (*Link != NULL && *Link != Waiter) Link = &((*Link)->Next);
+        if (*Link != NULL) *Link = Waiter->Next;
+
+        Waiter->Socket = NULL;
+        Waiter->Next = NULL;
+    }
+
+    RestoreFlags(&Flags);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Wake every task sleeping on a socket.
+ * @param Socket Socket that changed.
+ */
+static void Socket_Wake(LPSOCKET Socket) {
+    LPSOCKET_WAITER Waiter;
+    U32 Flags;
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    for (Waiter = Socket->Waiters; Waiter != NULL; Waiter = Waiter->Next) {
+        Waiter->Signaled = TRUE;
+        WakeUpTask((LPTASK)Waiter->Task);
+    }
+
+    RestoreFlags(&Flags);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Wake and drop every waiter of a socket that goes away.
+ * @param Socket Socket being destroyed.
+ */
+static void Socket_DetachWaiters(LPSOCKET Socket) {
+    LPSOCKET_WAITER Waiter;
+    U32 Flags;
+
+    Socket_Wake(Socket);
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    while (Socket->Waiters != NULL) {
+        Waiter = Socket->Waiters;
+        Socket->Waiters = Waiter->Next;
+        Waiter->Socket = NULL;
+        Waiter->Next = NULL;
+    }
+
+    RestoreFlags(&Flags);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Turn a socket timeout option into a wait limit.
+ * @param Option Timeout option in milliseconds, 0 for none.
+ * @return Wait limit in milliseconds, or INFINITY.
+ */
+static U32 Socket_GetTimeOut(U32 Option) {
+    return (Option > 0) ? Option : INFINITY;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Get the part of a wait limit that is left.
+ * @param Start Time the wait started.
+ * @param TimeOut Wait limit in milliseconds, or INFINITY.
+ * @return Milliseconds left, 0 once elapsed, or INFINITY.
+ */
+static U32 Socket_GetTimeLeft(UINT Start, U32 TimeOut) {
+    UINT Elapsed;
+
+    if (TimeOut == INFINITY) return INFINITY;
+
+    Elapsed = GetSystemTime() - Start;
+    return (Elapsed >= TimeOut) ? 0 : TimeOut - (U32)Elapsed;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Bring the state of a stream socket in line with its connection.
+ * @param Socket Stream socket.
+ */
+static void Socket_SyncState(LPSOCKET Socket) {
+    if (Socket->SocketType != SOCKET_TYPE_STREAM || Socket->TCPConnection == NULL) return;
+
+    switch (TCP_GetState(Socket->TCPConnection)) {
+        case TCP_STATE_ESTABLISHED:
+        case TCP_STATE_CLOSE_WAIT:
+            if (Socket->State == SOCKET_STATE_CONNECTING) {
+                Socket->State = SOCKET_STATE_CONNECTED;
             }
+            break;
 
-            Current = (LPSOCKET)Current->Next;
-        } else {
+        case TCP_STATE_CLOSED:
+            if (Socket->State == SOCKET_STATE_CONNECTING) {
+                Socket->PendingError = SOCKET_ERROR_CONNREFUSED;
+            }
+            if (Socket->State != SOCKET_STATE_CLOSED) {
+                Socket->State = SOCKET_STATE_CLOSED;
+            }
             break;
+    }
+}
+
+/************************************************************************/
+
+/**
+ * @brief Compute the poll events a socket is ready for.
+ * @param Socket Target socket.
+ * @return Mask of SOCKET_POLL_xxx.
+ */
+static U32 Socket_GetReadyEvents(LPSOCKET Socket) {
+    LPTCP_CONNECTION Connection = Socket->TCPConnection;
+    U32 Events = 0;
+
+    if (Socket->SocketType == SOCKET_TYPE_DGRAM) {
+        if (CircularBuffer_GetAvailableData(&Socket->ReceiveBuffer) > 0 || Socket->ReceiveOverflow) {
+            Events |= SOCKET_POLL_READ;
+        }
+        if (Socket->State != SOCKET_STATE_CLOSED) {
+            Events |= SOCKET_POLL_WRITE;
+        }
+        return Events;
+    }
+
+    Socket_SyncState(Socket);
+
+    if (Socket->PendingError != SOCKET_ERROR_NONE) {
+        Events |= SOCKET_POLL_ERROR;
+    }
+
+    if (Socket->State == SOCKET_STATE_LISTENING) {
+        if (Socket->PendingConnections != NULL && Socket->PendingConnections->NumItems > 0) {
+            Events |= SOCKET_POLL_READ | SOCKET_POLL_ACCEPT;
+        }
+        return Events;
+    }
+
+    if (Connection == NULL) {
+        if (Socket->State == SOCKET_STATE_CLOSED) {
+            Events |= SOCKET_POLL_HANGUP;
+        }
+        return Events;
+    }
+
+    if (TCP_GetReceiveAvailable(Connection) > 0) {
+        Events |= SOCKET_POLL_READ;
+    }
+
+    // End of stream: a receive returns 0 at once
+    if (Socket->State != SOCKET_STATE_CONNECTING && TCP_CanReceive(Connection) == FALSE) {
+        Events |= SOCKET_POLL_READ | SOCKET_POLL_HANGUP;
+    }
+
+    if (TCP_GetState(Connection) == TCP_STATE_ESTABLISHED && TCP_GetSendSpace(Connection) > 0) {
+        Events |= SOCKET_POLL_WRITE;
+    }
+
+    return Events;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Compute the ready events of a poll entry.
+ * @param Entry Poll entry.
+ * @return Requested events that are ready, plus the ones always reported.
+ */
+static U32 Socket_GetEntryEvents(LPSOCKET_POLL_ENTRY Entry) {
+    LPSOCKET Socket = (LPSOCKET)Entry->SocketHandle;
+
+    SAFE_USE_VALID_ID(Socket, KOID_SOCKET) {
+        return Socket_GetReadyEvents(Socket) & (Entry->Events | SOCKET_POLL_ERROR | SOCKET_POLL_HANGUP);
+    }
+
+    return SOCKET_POLL_INVALID;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Tell whether a socket of a poll call changed, SleepUntil condition.
+ * @param Context SOCKET_POLL_WAIT of the call.
+ * @return TRUE when a waiter was signaled since the last scan.
+ */
+static BOOL Socket_PollSignaled(LPVOID Context) {
+    LPSOCKET_POLL_WAIT Wait = (LPSOCKET_POLL_WAIT)Context;
+
+    for (U32 Index = 0; Index < Wait->Count; Index++) {
+        if (Wait->Waiters[Index].Signaled) return TRUE;
+    }
+
+    return FALSE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Sleep until a socket is ready for some events.
+ * @param Socket Target socket.
+ * @param Events Mask of SOCKET_POLL_xxx.
+ * @param TimeOut Longest wait in milliseconds, or INFINITY.
+ * @return Ready events, 0 on time out.
+ */
+static U32 Socket_WaitReady(LPSOCKET Socket, U32 Events, U32 TimeOut) {
+    SOCKET_POLL_ENTRY Entry;
+
+    Entry.SocketHandle = (SOCKET_HANDLE)Socket;
+    Entry.Events = Events;
+    Entry.ReadyEvents = 0;
+
+    if (SocketPoll(&Entry, 1, TimeOut) <= 0) return 0;
+
+    return Entry.ReadyEvents;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Close and free a connection queued on a listening socket.
+ * @param Item SOCKET_PENDING_CONNECTION to free.
+ */
+static void Socket_PendingConnectionDestructor(LPVOID Item) {
+    LPSOCKET_PENDING_CONNECTION Pending = (LPSOCKET_PENDING_CONNECTION)Item;
+
+    SAFE_USE(Pending) {
+        SAFE_USE_VALID_ID(Pending->TCPConnection, KOID_TCP) {
+            TCP_Close(Pending->TCPConnection);
+            TCP_DestroyConnection(Pending->TCPConnection);
+        }
+
+        KernelHeapFree(Pending);
+    }
+}
+
+/************************************************************************/
+
+static BOOL Socket_IsUDPPortInUseByAnotherSocket(LPSOCKET ExcludedSocket, U16 PortBe) {
+    LPSOCKET Current;
+
+    for (Current = SocketPortTable[Socket_PortBucket(PortBe)]; Current != NULL; Current = Current->PortNext) {
+        if (Current != ExcludedSocket &&
+            Current->SocketType == SOCKET_TYPE_DGRAM &&
+            Current->State >= SOCKET_STATE_BOUND &&
+            Current->State != SOCKET_STATE_CLOSED &&
+            Current->LocalAddress.Port == PortBe) {
+            return TRUE;
         }
     }
 
@@ -133,6 +466,7 @@ static BOOL Socket_QueueUDPDatagram(LPSOCKET Socket, U32 SourceIP_Be, U16 Source
         }
 
         Socket->PacketsReceived++;
+        Socket_Wake(Socket);
         return TRUE;
     }
 
@@ -142,28 +476,20 @@ static BOOL Socket_QueueUDPDatagram(LPSOCKET Socket, U32 SourceIP_Be, U16 Source
 /************************************************************************/
 
 static void Socket_UDPPortHandler(U32 SourceIP, U16 SourcePort, U16 DestinationPort, const U8* Payload, U32 PayloadLength) {
-    LPLIST SocketList = GetSocketList();
-    LPSOCKET Socket = (LPSOCKET)(SocketList != NULL ? SocketList->First : NULL);
+    LPSOCKET Socket;
 
-    while (Socket) {
-        SAFE_USE(Socket) {
-            if (Socket->SocketType == SOCKET_TYPE_DGRAM &&
-                Socket->State >= SOCKET_STATE_BOUND &&
-                Socket->State != SOCKET_STATE_CLOSED &&
-                Ntohs(Socket->LocalAddress.Port) == DestinationPort) {
-                if (!Socket_QueueUDPDatagram(Socket, SourceIP, SourcePort, Payload, PayloadLength)) {
-                    WARNING(TEXT("[Socket_UDPPortHandler] UDP datagram dropped for socket %p on port %u"),
-                            Socket, DestinationPort);
-                }
-                return;
+    for (Socket = SocketPortTable[Socket_PortBucket(Htons(DestinationPort))]; Socket != NULL; Socket = Socket->PortNext) {
+        if (Socket->SocketType == SOCKET_TYPE_DGRAM &&
+            Socket->State >= SOCKET_STATE_BOUND &&
+            Socket->State != SOCKET_STATE_CLOSED &&
+            Ntohs(Socket->LocalAddress.Port) == DestinationPort) {
+            if (!Socket_QueueUDPDatagram(Socket, SourceIP, SourcePort, Payload, PayloadLength)) {
+                WARNING(TEXT("[Socket_UDPPortHandler] UDP datagram dropped for socket %p on port %u"),
+                        Socket, DestinationPort);
             }
-
-            Socket = (LPSOCKET)Socket->Next;
-        } else {
             return;
         }
     }
-
 }
 
 /************************************************************************/
@@ -172,8 +498,8 @@ static void Socket_UDPPortHandler(U32 SourceIP, U16 SourcePort, U16 DestinationP
  * @brief Destructor function for socket control blocks
  *
  * This function is called when a socket control block is being destroyed.
- * It cleans up any allocated resources including pending connections list
- * and TCP connections.
+ * It wakes the tasks sleeping on it and cleans up any allocated resources
+ * including pending connections list and TCP connections.
  *
  * @param Item Pointer to the socket control block to destroy
  */
@@ -181,6 +507,9 @@ void SocketDestructor(LPVOID Item) {
     LPSOCKET Socket = (LPSOCKET)Item;
 
     SAFE_USE_VALID_ID(Socket, KOID_SOCKET) {
+        Socket_DetachWaiters(Socket);
+        Socket_UnlinkPort(Socket);
+
         if (Socket->PendingConnections) {
             DeleteList(Socket->PendingConnections);
         }
@@ -251,7 +580,7 @@ SOCKET_HANDLE SocketCreate(U16 AddressFamily, U16 SocketType, U16 Protocol) {
     Socket->NoDelay = FALSE;
     Socket->ReceiveTimeout = 0;
     Socket->SendTimeout = 0;
-    Socket->ReceiveTimeoutStartTime = 0;
+    Socket->PendingError = SOCKET_ERROR_NONE;
 
     // Initialize buffers
     CircularBuffer_Initialize(&Socket->ReceiveBuffer, Socket->ReceiveBufferData, SOCKET_BUFFER_SIZE, SOCKET_MAXIMUM_BUFFER_SIZE);
@@ -346,6 +675,7 @@ U32 SocketShutdown(SOCKET_HANDLE SocketHandle, U32 How) {
         if (Socket->SocketType == SOCKET_TYPE_STREAM && Socket->TCPConnection != NULL) {
             TCP_Close(Socket->TCPConnection);
             Socket->State = SOCKET_STATE_CLOSING;
+            Socket_Wake(Socket);
         } else {
         }
 
@@ -441,25 +771,8 @@ void SocketUpdate(void) {
         LPSOCKET NextSocket = (LPSOCKET)Socket->Next;
 
         SAFE_USE(Socket) {
-            // Handle timeouts and state transitions
-            if (Socket->SocketType == SOCKET_TYPE_STREAM && Socket->TCPConnection != NULL) {
-                SM_STATE TCPState = TCP_GetState(Socket->TCPConnection);
-
-                // Update socket state based on TCP state
-                switch (TCPState) {
-                    case TCP_STATE_ESTABLISHED:
-                        if (Socket->State == SOCKET_STATE_CONNECTING) {
-                            Socket->State = SOCKET_STATE_CONNECTED;
-                        }
-                        break;
-
-                    case TCP_STATE_CLOSED:
-                        if (Socket->State != SOCKET_STATE_CLOSED) {
-                            Socket->State = SOCKET_STATE_CLOSED;
-                        }
-                        break;
-                }
-            }
+            // Update socket state based on TCP state
+            Socket_SyncState(Socket);
         }
 
         Socket = NextSocket;
@@ -512,37 +825,33 @@ U32 SocketBind(SOCKET_HANDLE SocketHandle, LPSOCKET_ADDRESS Address, U32 Address
             InetAddress.Port = Htons(EphemeralPort);
         }
 
-        // Check if address is already in use (simple check)
-        LPLIST SocketList = GetSocketList();
-        LPSOCKET ExistingSocket = (LPSOCKET)(SocketList != NULL ? SocketList->First : NULL);
-
-        while (ExistingSocket) {
-            SAFE_USE(ExistingSocket) {
-                if (ExistingSocket != Socket &&
-                    ExistingSocket->State >= SOCKET_STATE_BOUND &&
-                    ExistingSocket->LocalAddress.Port == InetAddress.Port &&
-                    (ExistingSocket->LocalAddress.Address == InetAddress.Address ||
-                     ExistingSocket->LocalAddress.Address == 0 ||
-                     InetAddress.Address == 0)) {
-                    if (!Socket->ReuseAddress) {
-                        ERROR(TEXT("[SocketBind] Address already in use"));
-                        return SOCKET_ERROR_INUSE;
-                    }
+        // Check if address is already in use
+        LPSOCKET ExistingSocket = SocketPortTable[Socket_PortBucket(InetAddress.Port)];
+
+        for (; ExistingSocket != NULL; ExistingSocket = ExistingSocket->PortNext) {
+            if (ExistingSocket != Socket &&
+                ExistingSocket->State >= SOCKET_STATE_BOUND &&
+                ExistingSocket->LocalAddress.Port == InetAddress.Port &&
+                (ExistingSocket->LocalAddress.Address == InetAddress.Address ||
+                 ExistingSocket->LocalAddress.Address == 0 ||
+                 InetAddress.Address == 0)) {
+                if (!Socket->ReuseAddress) {
+                    ERROR(TEXT("[SocketBind] Address already in use"));
+                    return SOCKET_ERROR_INUSE;
                 }
-                ExistingSocket = (LPSOCKET)ExistingSocket->Next;
-            } else {
-                break;
             }
         }
 
         // Bind the address
         MemoryCopy(&Socket->LocalAddress, &InetAddress, sizeof(SOCKET_ADDRESS_INET));
         Socket->State = SOCKET_STATE_BOUND;
+        Socket_LinkPort(Socket);
 
         if (Socket->SocketType == SOCKET_TYPE_DGRAM) {
             NetworkDevice = (LPDEVICE)NetworkManager_GetPrimaryDevice();
             if (NetworkDevice == NULL) {
                 ERROR(TEXT("[SocketBind] No network device available for UDP bind"));
+                Socket_UnlinkPort(Socket);
                 Socket->State = SOCKET_STATE_CREATED;
                 MemorySet(&Socket->LocalAddress, 0, sizeof(SOCKET_ADDRESS_INET));
                 return SOCKET_ERROR_INVALID;
@@ -587,7 +896,7 @@ U32 SocketListen(SOCKET_HANDLE SocketHandle, U32 Backlog) {
 
         // Create pending connections queue
         if (!Socket->PendingConnections) {
-            Socket->PendingConnections = NewList(NULL, KernelHeapAlloc, KernelHeapFree);
+            Socket->PendingConnections = NewList(Socket_PendingConnectionDestructor, KernelHeapAlloc, KernelHeapFree);
             if (!Socket->PendingConnections) {
                 ERROR(TEXT("[SocketListen] Failed to create pending connections queue"));
                 return SOCKET_ERROR_NOMEM;
@@ -606,6 +915,8 @@ U32 SocketListen(SOCKET_HANDLE SocketHandle, U32 Backlog) {
             return SOCKET_ERROR_INVALID;
         }
 
+        TCP_SetOwner(Socket->TCPConnection, Socket);
+
         // Start listening
         if (TCP_Listen(Socket->TCPConnection) != 0) {
             ERROR(TEXT("[SocketListen] Failed to start TCP listening"));
@@ -629,7 +940,8 @@ U32 SocketListen(SOCKET_HANDLE SocketHandle, U32 Backlog) {
  * @brief Accept an incoming connection
  *
  * This function accepts a pending connection on a listening socket and
- * creates a new socket for the established connection.
+ * creates a new socket for the established connection. It sleeps until a
+ * connection completes its handshake, up to the receive timeout if set.
  *
  * @param SocketHandle The listening socket descriptor
  * @param Address Pointer to store the remote address of the accepted connection
@@ -641,43 +953,50 @@ SOCKET_HANDLE SocketAccept(SOCKET_HANDLE SocketHandle, LPSOCKET_ADDRESS Address,
     LPSOCKET ListenSocket = (LPSOCKET)SocketHandle;
 
     SAFE_USE_VALID_ID(ListenSocket, KOID_SOCKET) {
-        if (ListenSocket->State != SOCKET_STATE_LISTENING) {
+        U32 TimeOut = Socket_GetTimeOut(ListenSocket->ReceiveTimeout);
+        UINT Start = GetSystemTime();
+        U32 TimeLeft;
+
+        if (ListenSocket->State != SOCKET_STATE_LISTENING || ListenSocket->PendingConnections == NULL) {
             ERROR(TEXT("[SocketAccept] Socket %p not listening"), (LPVOID)SocketHandle);
             return (SOCKET_HANDLE)SOCKET_ERROR_NOTLISTENING;
         }
 
-        // Check for pending connections
-        if (!ListenSocket->PendingConnections || ListenSocket->PendingConnections->NumItems == 0) {
-            // No pending connections, would block
-            return (SOCKET_HANDLE)SOCKET_ERROR_WOULDBLOCK;
-        }
+        // Sleep until a connection completes its handshake
+        while (ListenSocket->PendingConnections->NumItems == 0) {
+            TimeLeft = Socket_GetTimeLeft(Start, TimeOut);
+            if (TimeLeft == 0) {
+                return (SOCKET_HANDLE)SOCKET_ERROR_TIMEOUT;
+            }
 
-        // Get the first pending connection
-        LPSOCKET PendingSocket = (LPSOCKET)ListenSocket->PendingConnections->First;
-        if (!PendingSocket) {
-            ERROR(TEXT("[SocketAccept] No pending connection found"));
-            return (SOCKET_HANDLE)SOCKET_ERROR_WOULDBLOCK;
+            Socket_WaitReady(ListenSocket, SOCKET_POLL_ACCEPT, TimeLeft);
+
+            if (ListenSocket->State != SOCKET_STATE_LISTENING) {
+                return (SOCKET_HANDLE)SOCKET_ERROR_NOTLISTENING;
+            }
         }
 
-        // Remove from pending queue
-        ListRemove(ListenSocket->PendingConnections, PendingSocket);
+        // Get the first pending connection
+        LPSOCKET_PENDING_CONNECTION Pending = (LPSOCKET_PENDING_CONNECTION)ListenSocket->PendingConnections->First;
+        ListRemove(ListenSocket->PendingConnections, Pending);
 
         // Create new socket for the accepted connection
         SOCKET_HANDLE NewSocketDescriptor = SocketCreate(SOCKET_AF_INET, SOCKET_TYPE_STREAM, SOCKET_PROTOCOL_TCP);
-        if (NewSocketDescriptor == (SOCKET_HANDLE)SOCKET_ERROR_INVALID) {
-            ERROR(TEXT("[SocketAccept] Failed to create new socket for accepted connection"));
-            KernelHeapFree(PendingSocket);
-            return (SOCKET_HANDLE)SOCKET_ERROR_NOMEM;
-        }
-
         LPSOCKET NewSocket = (LPSOCKET)NewSocketDescriptor;
 
         SAFE_USE_VALID_ID(NewSocket, KOID_SOCKET) {
+            LPTCP_CONNECTION Connection = Pending->TCPConnection;
+
             // Copy connection information
-            MemoryCopy(&NewSocket->LocalAddress, &ListenSocket->LocalAddress, sizeof(SOCKET_ADDRESS_INET));
-            MemoryCopy(&NewSocket->RemoteAddress, &PendingSocket->RemoteAddress, sizeof(SOCKET_ADDRESS_INET));
-            NewSocket->TCPConnection = PendingSocket->TCPConnection;
+            SocketAddressInetMake(Connection->LocalIP, Connection->LocalPort, &NewSocket->LocalAddress);
+            MemoryCopy(&NewSocket->RemoteAddress, &Pending->RemoteAddress, sizeof(SOCKET_ADDRESS_INET));
+            NewSocket->TCPConnection = Connection;
             NewSocket->State = SOCKET_STATE_CONNECTED;
+            Socket_LinkPort(NewSocket);
+            TCP_SetOwner(Connection, NewSocket);
+            NewSocket->NoDelay = ListenSocket->NoDelay;
+            TCP_SetNoDelay(Connection, NewSocket->NoDelay);
+            Socket_SyncState(NewSocket);
 
             // Return remote address if requested
             if (Address && AddressLength && *AddressLength >= sizeof(SOCKET_ADDRESS_INET)) {
@@ -685,16 +1004,14 @@ SOCKET_HANDLE SocketAccept(SOCKET_HANDLE SocketHandle, LPSOCKET_ADDRESS Address,
                 *AddressLength = sizeof(SOCKET_ADDRESS_INET);
             }
 
-            KernelHeapFree(PendingSocket);
+            KernelHeapFree(Pending);
 
             return NewSocketDescriptor;
-        } else {
-            // SAFE_USE_VALID_ID failed, cleanup and return error
-            SocketClose(NewSocketDescriptor);
-            KernelHeapFree(PendingSocket);
-            ERROR(TEXT("[SocketAccept] Failed to validate new socket"));
-            return (SOCKET_HANDLE)SOCKET_ERROR_INVALID;
         }
+
+        ERROR(TEXT("[SocketAccept] Failed to create new socket for accepted connection"));
+        Socket_PendingConnectionDestructor(Pending);
+        return (SOCKET_HANDLE)SOCKET_ERROR_NOMEM;
     }
 
     return (SOCKET_HANDLE)SOCKET_ERROR_INVALID;
@@ -706,7 +1023,8 @@ SOCKET_HANDLE SocketAccept(SOCKET_HANDLE SocketHandle, LPSOCKET_ADDRESS Address,
  * @brief Connect a socket to a remote address
  *
  * This function initiates a connection to a remote address. For TCP sockets,
- * this performs the three-way handshake to establish a connection.
+ * this performs the three-way handshake to establish a connection and sleeps
+ * until it completes or fails, up to the send timeout if set.
  *
  * @param SocketHandle The socket descriptor to connect
  * @param Address Pointer to the remote address to connect to
@@ -785,6 +1103,9 @@ U32 SocketConnect(SOCKET_HANDLE SocketHandle, LPSOCKET_ADDRESS Address, U32 Addr
             return SOCKET_ERROR_INVALID;
         }
 
+        TCP_SetNoDelay(Socket->TCPConnection, Socket->NoDelay);
+        TCP_SetOwner(Socket->TCPConnection, Socket);
+
         // Register for TCP connection events
         if (TCP_RegisterCallback(Socket->TCPConnection, NOTIF_EVENT_TCP_CONNECTED, SocketTCPNotificationCallback, Socket) != 0) {
             ERROR(TEXT("[SocketConnect] Failed to register TCP notification"));
@@ -803,6 +1124,25 @@ U32 SocketConnect(SOCKET_HANDLE SocketHandle, LPSOCKET_ADDRESS Address, U32 Addr
 
         Socket->State = SOCKET_STATE_CONNECTING;
 
+        // Sleep until the handshake completes or fails
+        UINT Start = GetSystemTime();
+        U32 TimeOut = Socket_GetTimeOut(Socket->SendTimeout);
+        U32 TimeLeft;
+
+        while (Socket->State == SOCKET_STATE_CONNECTING) {
+            TimeLeft = Socket_GetTimeLeft(Start, TimeOut);
+            if (TimeLeft == 0) {
+                return SOCKET_ERROR_TIMEOUT;
+            }
+
+            Socket_WaitReady(Socket, SOCKET_POLL_WRITE, TimeLeft);
+        }
+
+        if (Socket->State != SOCKET_STATE_CONNECTED) {
+            I32 Error = (Socket->PendingError != SOCKET_ERROR_NONE) ? Socket->PendingError : SOCKET_ERROR_CONNREFUSED;
+            Socket->PendingError = SOCKET_ERROR_NONE;
+            return Error;
+        }
 
         return SOCKET_ERROR_NONE;
     }
@@ -816,16 +1156,16 @@ U32 SocketConnect(SOCKET_HANDLE SocketHandle, LPSOCKET_ADDRESS Address, U32 Addr
  * @brief Send data on a connected socket
  *
  * This function sends data on a connected socket. For TCP sockets,
- * the data is sent reliably and in order.
+ * the data is sent reliably and in order. While the send buffer is full the
+ * call sleeps, unless SOCKET_MSG_DONTWAIT is set.
  *
  * @param SocketHandle The socket descriptor to send data on
  * @param Buffer Pointer to the data to send
  * @param Length Number of bytes to send
- * @param Flags Send flags (currently unused)
+ * @param Flags Send flags (SOCKET_MSG_DONTWAIT)
  * @return Number of bytes sent on success, or negative error code on failure
  */
 I32 SocketSend(SOCKET_HANDLE SocketHandle, LPCVOID Buffer, U32 Length, U32 Flags) {
-    UNUSED(Flags);
     if (!Buffer || Length == 0) {
         ERROR(TEXT("[SocketSend] Invalid buffer or length"));
         return SOCKET_ERROR_INVALID;
@@ -840,13 +1180,33 @@ I32 SocketSend(SOCKET_HANDLE SocketHandle, LPCVOID Buffer, U32 Length, U32 Flags
         }
 
         if (Socket->SocketType == SOCKET_TYPE_STREAM && Socket->TCPConnection != NULL) {
-            // Send via TCP
-            I32 Result = TCP_Send(Socket->TCPConnection, (const U8*)Buffer, Length);
-            if (Result > 0) {
-                Socket->BytesSent += Result;
-                Socket->PacketsSent++;
+            UINT Start = GetSystemTime();
+            U32 TimeOut = Socket_GetTimeOut(Socket->SendTimeout);
+            U32 TimeLeft;
+
+            FOREVER {
+                // Send via TCP
+                I32 Result = TCP_Send(Socket->TCPConnection, (const U8*)Buffer, Length);
+                if (Result > 0) {
+                    Socket->BytesSent += Result;
+                    Socket->PacketsSent++;
+                }
+                if (Result != 0) {
+                    return Result;
+                }
+
+                // The send buffer is full, acknowledgements make room
+                if (Flags & SOCKET_MSG_DONTWAIT) {
+                    return SOCKET_ERROR_WOULDBLOCK;
+                }
+
+                TimeLeft = Socket_GetTimeLeft(Start, TimeOut);
+                if (TimeLeft == 0) {
+                    return SOCKET_ERROR_TIMEOUT;
+                }
+
+                Socket_WaitReady(Socket, SOCKET_POLL_WRITE, TimeLeft);
             }
-            return Result;
         } else {
             ERROR(TEXT("[SocketSend] Unsupported socket type for send"));
             return SOCKET_ERROR_INVALID;
@@ -889,16 +1249,17 @@ static void SocketReceiveLogRateLimited(LPSOCKET Socket, LPCSTR Reason, I32 Erro
  * @brief Receive data from a connected socket
  *
  * This function receives data from a connected socket. For TCP sockets,
- * data is received from the internal buffer.
+ * data is read from the receive buffer of the connection. While it is empty
+ * the call sleeps until data arrives, the peer closes or the receive timeout
+ * elapses, unless SOCKET_MSG_DONTWAIT is set.
  *
  * @param SocketHandle The socket descriptor to receive data from
  * @param Buffer Pointer to the buffer to store received data
  * @param Length Maximum number of bytes to receive
- * @param Flags Receive flags (currently unused)
- * @return Number of bytes received on success, or negative error code on failure
+ * @param Flags Receive flags (SOCKET_MSG_DONTWAIT)
+ * @return Number of bytes received, 0 at end of stream, or negative error code on failure
  */
 I32 SocketReceive(SOCKET_HANDLE SocketHandle, LPVOID Buffer, U32 Length, U32 Flags) {
-    UNUSED(Flags);
     if (!Buffer || Length == 0) {
         ERROR(TEXT("[SocketReceive] Invalid buffer or length"));
         return SOCKET_ERROR_INVALID;
@@ -913,52 +1274,48 @@ I32 SocketReceive(SOCKET_HANDLE SocketHandle, LPVOID Buffer, U32 Length, U32 Fla
         }
 
         if (Socket->SocketType == SOCKET_TYPE_STREAM && Socket->TCPConnection != NULL) {
-            if (Socket->ReceiveOverflow || Socket->ReceiveBuffer.Overflowed) {
-                if (Socket->ReceiveOverflow) {
-                    WARNING(TEXT("[SocketReceive] Receive buffer overflow detected on socket %p"), (LPVOID)SocketHandle);
-                    Socket->ReceiveOverflow = FALSE;
+            LPTCP_CONNECTION Connection = Socket->TCPConnection;
+            UINT Start = GetSystemTime();
+            U32 TimeOut = Socket_GetTimeOut(Socket->ReceiveTimeout);
+            U32 TimeLeft;
+            I32 BytesReceived;
+
+            FOREVER {
+                TimeLeft = Socket_GetTimeLeft(Start, TimeOut);
+
+                if ((Flags & SOCKET_MSG_DONTWAIT) || TimeLeft == 0 || TCP_CanReceive(Connection) == FALSE) {
+                    BytesReceived = TCP_Receive(Connection, (U8*)Buffer, Length);
+                } else {
+                    // Sleep on the connection, arriving bytes may land straight in Buffer
+                    BytesReceived = TCP_WaitReceive(Connection, (U8*)Buffer, Length, TimeLeft);
                 }
-                return SOCKET_ERROR_OVERFLOW;
-            }
-
-            // Check receive buffer first
-            U32 AvailableData = CircularBuffer_GetAvailableData(&Socket->ReceiveBuffer);
-            if (AvailableData > 0) {
-                U32 BytesToCopy = CircularBuffer_Read(&Socket->ReceiveBuffer, (U8*)Buffer, Length);
-
-                Socket->BytesReceived += BytesToCopy;
-                Socket->ReceiveTimeoutStartTime = 0; // Reset timeout so user space can continue waiting after new data arrives
 
-                if (Socket->TCPConnection != NULL && BytesToCopy > 0) {
-                    TCP_HandleApplicationRead(Socket->TCPConnection, BytesToCopy);
+                if (BytesReceived > 0) {
+                    Socket->BytesReceived += (U32)BytesReceived;
+                    return BytesReceived;
                 }
 
-                return BytesToCopy;
-            } else {
-                // No data available - check timeout
-                if (Socket->ReceiveTimeout > 0) {
-                    UINT CurrentTime = GetSystemTime();
+                if (BytesReceived < 0) {
+                    return SOCKET_ERROR_INVALID;
+                }
 
-                    // Initialize timeout start time on first call
-                    if (Socket->ReceiveTimeoutStartTime == 0) {
-                        Socket->ReceiveTimeoutStartTime = CurrentTime;
-                    }
+                // The peer closed and every byte was read
+                if (TCP_CanReceive(Connection) == FALSE) {
+                    return 0; // EOF
+                }
 
-                    // Check if timeout exceeded
-                    if ((CurrentTime - Socket->ReceiveTimeoutStartTime) >= Socket->ReceiveTimeout) {
-                        Socket->ReceiveTimeoutStartTime = 0; // Reset for next operation
-                        SocketReceiveLogRateLimited(Socket, TEXT("receive time out"), SOCKET_ERROR_TIMEOUT);
-                        return SOCKET_ERROR_TIMEOUT;
-                    }
+                if (Flags & SOCKET_MSG_DONTWAIT) {
+                    return SOCKET_ERROR_WOULDBLOCK;
                 }
 
-                // No data available - check if connection is closed
-                if (Socket->State == SOCKET_STATE_CLOSED) {
-                    return 0; // EOF
+                TimeLeft = Socket_GetTimeLeft(Start, TimeOut);
+                if (TimeLeft == 0) {
+                    SocketReceiveLogRateLimited(Socket, TEXT("receive time out"), SOCKET_ERROR_TIMEOUT);
+                    return SOCKET_ERROR_TIMEOUT;
                 }
 
-                // No data available, would block
-                return SOCKET_ERROR_WOULDBLOCK;
+                // Another reader holds the connection, sleep on the socket
+                Socket_WaitReady(Socket, SOCKET_POLL_READ, TimeLeft);
             }
         } else {
             ERROR(TEXT("[SocketReceive] Unsupported socket type for receive"));
@@ -1071,21 +1428,23 @@ I32 SocketSendTo(SOCKET_HANDLE SocketHandle, LPCVOID Buffer, U32 Length, U32 Fla
  * @brief Receive data from any address (UDP)
  *
  * This function receives data from any source address without requiring
- * an established connection. Currently not implemented.
+ * an established connection. While no datagram is queued the call sleeps,
+ * up to the receive timeout if set, unless SOCKET_MSG_DONTWAIT is set.
  *
  * @param SocketHandle The socket descriptor to receive data from
  * @param Buffer Pointer to the buffer to store received data
  * @param Length Maximum number of bytes to receive
- * @param Flags Receive flags (currently unused)
+ * @param Flags Receive flags (SOCKET_MSG_DONTWAIT)
  * @param SourceAddress Pointer to store the source address of received data
  * @param AddressLength Pointer to the size of the source address buffer
  * @return Number of bytes received on success, or negative error code on failure
  */
 I32 SocketReceiveFrom(SOCKET_HANDLE SocketHandle, LPVOID Buffer, U32 Length, U32 Flags,
                       LPSOCKET_ADDRESS SourceAddress, U32* AddressLength) {
-    UNUSED(Flags);
     LPSOCKET Socket = (LPSOCKET)SocketHandle;
     SOCKET_UDP_DATAGRAM_HEADER DatagramHeader;
+    UINT Start = GetSystemTime();
+    U32 TimeLeft;
     U32 AvailableData;
     U32 SourceAddressLengthRequired = sizeof(SOCKET_ADDRESS_INET);
     U32 BytesToCopy;
@@ -1108,35 +1467,36 @@ I32 SocketReceiveFrom(SOCKET_HANDLE SocketHandle, LPVOID Buffer, U32 Length, U32
             return SOCKET_ERROR_NOTBOUND;
         }
 
-        if (Socket->ReceiveOverflow || Socket->ReceiveBuffer.Overflowed) {
-            if (Socket->ReceiveOverflow) {
-                WARNING(TEXT("[SocketReceiveFrom] Receive buffer overflow detected on socket %p"), (LPVOID)SocketHandle);
-                Socket->ReceiveOverflow = FALSE;
+        FOREVER {
+            if (Socket->ReceiveOverflow || Socket->ReceiveBuffer.Overflowed) {
+                if (Socket->ReceiveOverflow) {
+                    WARNING(TEXT("[SocketReceiveFrom] Receive buffer overflow detected on socket %p"), (LPVOID)SocketHandle);
+                    Socket->ReceiveOverflow = FALSE;
+                }
+                return SOCKET_ERROR_OVERFLOW;
+            }
+
+            AvailableData = CircularBuffer_GetAvailableData(&Socket->ReceiveBuffer);
+            if (AvailableData >= sizeof(SOCKET_UDP_DATAGRAM_HEADER)) {
+                break;
             }
-            return SOCKET_ERROR_OVERFLOW;
-        }
 
-        AvailableData = CircularBuffer_GetAvailableData(&Socket->ReceiveBuffer);
-        if (AvailableData < sizeof(SOCKET_UDP_DATAGRAM_HEADER)) {
             if (AvailableData > 0) {
                 ERROR(TEXT("[SocketReceiveFrom] Invalid UDP datagram queue state, resetting buffer"));
                 CircularBuffer_Reset(&Socket->ReceiveBuffer);
                 return SOCKET_ERROR_INVALID;
             }
 
-            if (Socket->ReceiveTimeout > 0) {
-                UINT CurrentTime = GetSystemTime();
-                if (Socket->ReceiveTimeoutStartTime == 0) {
-                    Socket->ReceiveTimeoutStartTime = CurrentTime;
-                }
+            if (Flags & SOCKET_MSG_DONTWAIT) {
+                return SOCKET_ERROR_WOULDBLOCK;
+            }
 
-                if ((CurrentTime - Socket->ReceiveTimeoutStartTime) >= Socket->ReceiveTimeout) {
-                    Socket->ReceiveTimeoutStartTime = 0;
-                    return SOCKET_ERROR_TIMEOUT;
-                }
+            TimeLeft = Socket_GetTimeLeft(Start, Socket_GetTimeOut(Socket->ReceiveTimeout));
+            if (TimeLeft == 0) {
+                return SOCKET_ERROR_TIMEOUT;
             }
 
-            return SOCKET_ERROR_WOULDBLOCK;
+            Socket_WaitReady(Socket, SOCKET_POLL_READ, TimeLeft);
         }
 
         if (CircularBuffer_Read(&Socket->ReceiveBuffer, (U8*)&DatagramHeader, sizeof(SOCKET_UDP_DATAGRAM_HEADER)) !=
@@ -1176,7 +1536,6 @@ I32 SocketReceiveFrom(SOCKET_HANDLE SocketHandle, LPVOID Buffer, U32 Length, U32
         }
 
         Socket->BytesReceived += BytesToCopy;
-        Socket->ReceiveTimeoutStartTime = 0;
 
         if (BytesToCopy < DatagramHeader.PayloadLength) {
             WARNING(TEXT("[SocketReceiveFrom] Datagram truncated on socket %p (%u/%u bytes)"),
@@ -1191,6 +1550,75 @@ I32 SocketReceiveFrom(SOCKET_HANDLE SocketHandle, LPVOID Buffer, U32 Length, U32
 
 /************************************************************************/
 
+/**
+ * @brief Wait until some sockets are ready
+ *
+ * This function sleeps until at least one entry is ready for one of its
+ * events or the timeout elapses. The task is linked on every socket while it
+ * waits, the receive and state paths of the sockets wake it.
+ *
+ * @param Entries Sockets and requested events, ReadyEvents is filled
+ * @param Count Number of entries, up to SOCKET_POLL_MAX_ENTRIES
+ * @param TimeOut Longest wait in milliseconds, 0 to check only, INFINITY to wait for ever
+ * @return Number of ready entries, 0 on timeout, or negative error code on failure
+ */
+I32 SocketPoll(LPSOCKET_POLL_ENTRY Entries, U32 Count, U32 TimeOut) {
+    SOCKET_WAITER Waiters[SOCKET_POLL_MAX_ENTRIES];
+    SOCKET_POLL_WAIT Wait;
+    LPVOID Task = GetCurrentTask();
+    UINT Start = GetSystemTime();
+    U32 TimeLeft;
+    U32 Index;
+    I32 ReadyCount;
+
+    if (Entries == NULL || Count == 0 || Count > SOCKET_POLL_MAX_ENTRIES) {
+        ERROR(TEXT("[SocketPoll] Invalid entries (count=%u)"), Count);
+        return SOCKET_ERROR_INVALID;
+    }
+
+    MemorySet(Waiters, 0, Count * sizeof(SOCKET_WAITER));
+    Wait.Waiters = Waiters;
+    Wait.Count = Count;
+
+    for (Index = 0; Index < Count; Index++) {
+        LPSOCKET Socket = (LPSOCKET)Entries[Index].SocketHandle;
+
+        Waiters[Index].Task = Task;
+
+        SAFE_USE_VALID_ID(Socket, KOID_SOCKET) {
+            Socket_AddWaiter(Socket, &(Waiters[Index]));
+        }
+    }
+
+    FOREVER {
+        for (Index = 0; Index < Count; Index++) {
+            Waiters[Index].Signaled = FALSE;
+        }
+
+        ReadyCount = 0;
+        for (Index = 0; Index < Count; Index++) {
+            Entries[Index].ReadyEvents = Socket_GetEntryEvents(&(Entries[Index]));
+            if (Entries[Index].ReadyEvents != 0) ReadyCount++;
+        }
+
+        if (ReadyCount > 0) break;
+
+        TimeLeft = Socket_GetTimeLeft(Start, TimeOut);
+        if (TimeLeft == 0) break;
+
+        // Returns at once when a socket changed during the scan
+        SleepUntil(Socket_PollSignaled, &Wait, TimeLeft);
+    }
+
+    for (Index = 0; Index < Count; Index++) {
+        Socket_RemoveWaiter(&(Waiters[Index]));
+    }
+
+    return ReadyCount;
+}
+
+/************************************************************************/
+
 /**
  * @brief TCP receive callback function
  *
@@ -1212,44 +1640,96 @@ void SocketTCPNotificationCallback(LPNOTIFICATION_DATA NotificationData, LPVOID
     }
 }
 
-U32 SocketTCPReceiveCallback(LPTCP_CONNECTION TCPConnection, const U8* Data, U32 DataLength) {
-    if (!Data || DataLength == 0) {
-        return 0;
+/************************************************************************/
+
+/**
+ * @brief Account for bytes queued on the connection of a stream socket.
+ * @param TCPConnection TCP connection that received the bytes.
+ * @param DataLength Number of bytes received.
+ */
+void SocketTCPReceiveCallback(LPTCP_CONNECTION TCPConnection, U32 DataLength) {
+    if (DataLength == 0) {
+        return;
     }
 
-    LPLIST SocketList = GetSocketList();
-    LPSOCKET Socket = (LPSOCKET)(SocketList != NULL ? SocketList->First : NULL);
-    while (Socket) {
-        SAFE_USE(Socket) {
+    SAFE_USE_VALID_ID(TCPConnection, KOID_TCP) {
+        LPSOCKET Socket = (LPSOCKET)TCPConnection->Owner;
+
+        SAFE_USE_VALID_ID(Socket, KOID_SOCKET) {
             if (Socket->TCPConnection == TCPConnection) {
-                // Copy data to receive buffer using CircularBuffer
-                U32 BytesToCopy = CircularBuffer_Write(&Socket->ReceiveBuffer, Data, DataLength);
+                // The bytes stay in the receive buffer of the connection, which drives its window
+                Socket->PacketsReceived++;
+                Socket_Wake(Socket);
+            }
+        }
+    }
+}
 
-                if (BytesToCopy > 0) {
-                    Socket->PacketsReceived++;
-                }
+/************************************************************************/
 
-                if (BytesToCopy < DataLength) {
-                    Socket->ReceiveOverflow = TRUE;
-                    WARNING(TEXT("[SocketTCPReceiveCallback] Receive buffer overflow for socket %p (%u/%u bytes stored, size=%u, max=%u)"),
-                            Socket,
-                            BytesToCopy,
-                            DataLength,
-                            Socket->ReceiveBuffer.Size,
-                            Socket->ReceiveBuffer.MaximumSize);
-                }
+/**
+ * @brief Follow a state change or new send space of a stream connection.
+ * @param TCPConnection TCP connection that changed.
+ */
+void SocketTCPStateCallback(LPTCP_CONNECTION TCPConnection) {
+    SAFE_USE_VALID_ID(TCPConnection, KOID_TCP) {
+        LPSOCKET Socket = (LPSOCKET)TCPConnection->Owner;
+
+        SAFE_USE_VALID_ID(Socket, KOID_SOCKET) {
+            if (Socket->TCPConnection == TCPConnection) {
+                Socket_SyncState(Socket);
+                Socket_Wake(Socket);
+            }
+        }
+    }
+}
+
+/************************************************************************/
 
-                // NOTE: TCP window is now calculated automatically based on TCP buffer usage
+/**
+ * @brief Queue a connection established by a listener on its socket.
+ * @param Listener Listening TCP connection.
+ * @param TCPConnection Child connection that completed the handshake.
+ * @return TRUE when the socket took the connection, FALSE when its queue is full.
+ */
+BOOL SocketTCPAcceptCallback(LPTCP_CONNECTION Listener, LPTCP_CONNECTION TCPConnection) {
+    LPSOCKET_PENDING_CONNECTION Pending;
+    U32 Backlog;
+
+    SAFE_USE_VALID_ID_2(Listener, TCPConnection, KOID_TCP) {
+        LPSOCKET Socket = (LPSOCKET)Listener->Owner;
 
-                return BytesToCopy;
+        SAFE_USE_VALID_ID(Socket, KOID_SOCKET) {
+            if (Socket->State != SOCKET_STATE_LISTENING || Socket->PendingConnections == NULL) {
+                return FALSE;
             }
-            Socket = (LPSOCKET)Socket->Next;
-        } else {
-            return 0;
+
+            Backlog = (Socket->ListenBacklog > 0) ? Socket->ListenBacklog : 1;
+            if (Socket->PendingConnections->NumItems >= Backlog) {
+                return FALSE;
+            }
+
+            Pending = (LPSOCKET_PENDING_CONNECTION)KernelHeapAlloc(sizeof(SOCKET_PENDING_CONNECTION));
+            if (Pending == NULL) {
+                ERROR(TEXT("[SocketTCPAcceptCallback] Failed to allocate pending connection"));
+                return FALSE;
+            }
+
+            MemorySet(Pending, 0, sizeof(SOCKET_PENDING_CONNECTION));
+            Pending->TCPConnection = TCPConnection;
+            SocketAddressInetMake(TCPConnection->RemoteIP, TCPConnection->RemotePort, &Pending->RemoteAddress);
+
+            if (ListAddTail(Socket->PendingConnections, Pending) == 0) {
+                KernelHeapFree(Pending);
+                return FALSE;
+            }
+
+            Socket_Wake(Socket);
+            return TRUE;
         }
     }
 
-    return 0;
+    return FALSE;
 }
 
 /************************************************************************/
@@ -1291,8 +1771,8 @@ U32 SocketGetOption(SOCKET_HANDLE SocketHandle, U32 Level, U32 OptionName, LPVOI
 /**
  * @brief Set socket option
  *
- * This function sets the value of a socket option.
- * Currently not implemented.
+ * This function sets the value of a socket option. Supported options are
+ * SO_RCVTIMEO at SOL_SOCKET level and TCP_NODELAY at IPPROTO_TCP level.
  *
  * @param SocketHandle The socket descriptor
  * @param Level The protocol level (SOL_SOCKET, IPPROTO_TCP, etc.)
@@ -1328,6 +1808,23 @@ U32 SocketSetOption(SOCKET_HANDLE SocketHandle, U32 Level, U32 OptionName, LPCVO
                     ERROR(TEXT("[SocketSetOption] Unsupported socket option %u"), OptionName);
                     return SOCKET_ERROR_INVALID;
             }
+        } else if (Level == IPPROTO_TCP) {
+            switch (OptionName) {
+                case TCP_NODELAY: {
+                    if (OptionLength != sizeof(U32)) {
+                        ERROR(TEXT("[SocketSetOption] Invalid option length for TCP_NODELAY"));
+                        return SOCKET_ERROR_INVALID;
+                    }
+                    Socket->NoDelay = (*(const U32*)OptionValue != 0);
+                    if (Socket->TCPConnection != NULL) {
+                        TCP_SetNoDelay(Socket->TCPConnection, Socket->NoDelay);
+                    }
+                    return SOCKET_ERROR_NONE;
+                }
+                default:
+                    ERROR(TEXT("[SocketSetOption] Unsupported TCP option %u"), OptionName);
+                    return SOCKET_ERROR_INVALID;
+            }
         } else {
             ERROR(TEXT("[SocketSetOption] Unsupported option level %u"), Level);
             return SOCKET_ERROR_INVALID;
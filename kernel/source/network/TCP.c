@@ -37,6 +37,9 @@
 #include "utils/NetworkChecksum.h"
 #include "utils/Hysteresis.h"
 #include "core/Device.h"
+#include "process/Schedule.h"
+#include "process/Task.h"
+#include "Arch.h"
 
 /************************************************************************/
 // Configuration
@@ -85,6 +88,7 @@ typedef struct tag_TCP_GLOBAL_STATE {
     U16 NextEphemeralPort;
     UINT SendBufferSize;
     UINT ReceiveBufferSize;
+    TCP_DEMUX Demux;        // Lookup tables of every connection
 } TCP_GLOBAL_STATE, *LPTCP_GLOBAL_STATE;
 
 TCP_GLOBAL_STATE DATA_SECTION GlobalTCP;
@@ -97,6 +101,13 @@ TCP_GLOBAL_STATE DATA_SECTION GlobalTCP;
 #define TCP_RETRANSMIT_TIMEOUT_MIN          500
 #define TCP_RETRANSMIT_TIMEOUT_MAX          60000
 #define TCP_DUPLICATE_ACK_THRESHOLD         3
+#define TCP_DELAYED_ACK_TIMEOUT             100     // Longest delay of an ACK (ms)
+#define TCP_DELAYED_ACK_SEGMENTS            2       // Segments acknowledged by one ACK
+#define TCP_MAX_WINDOW_SCALE                14      // RFC 7323 limit
+#define TCP_TIMESTAMP_OPTION_SPACE          12      // NOP, NOP, kind, length, TSval, TSecr
+#define TCP_SACK_OPTION_SPACE(Blocks)       (4 + ((Blocks) * 8))
+#define TCP_TSO_MAX_SEGMENTS                8       // MSS-sized segments handed to the NIC at once
+#define TCP_LISTEN_MAX_HALF_OPEN            16      // Children of a listener in the handshake
 
 /************************************************************************/
 // State machine definitions
@@ -119,6 +130,7 @@ static void TCP_ActionSendSyn(STATE_MACHINE* SM, LPVOID EventData);
 static void TCP_ActionSendSynAck(STATE_MACHINE* SM, LPVOID EventData);
 static void TCP_ActionSendAck(STATE_MACHINE* SM, LPVOID EventData);
 static void TCP_ActionSendFin(STATE_MACHINE* SM, LPVOID EventData);
+static void TCP_ActionReceiveFin(STATE_MACHINE* SM, LPVOID EventData);
 // static void TCP_ActionSendRst(STATE_MACHINE* SM, LPVOID EventData);
 static void TCP_IPv4PacketSentCallback(LPNOTIFICATION_DATA NotificationData, LPVOID UserData);
 static void TCP_ActionProcessData(STATE_MACHINE* SM, LPVOID EventData);
@@ -131,15 +143,23 @@ static int TCP_SendPacket(LPTCP_CONNECTION Conn, U8 Flags, const U8* Payload, U3
 
 // Forward declarations of retransmission helpers
 static U32 TCP_GetSegmentSequenceLength(U8 Flags, U32 PayloadLength);
+static BOOL TCP_SequenceBefore(U32 Left, U32 Right);
 static BOOL TCP_ShouldTrackRetransmission(U8 Flags, U32 PayloadLength);
 static void TCP_ClearRetransmissionState(LPTCP_CONNECTION Conn);
 static void TCP_OnCongestionNewAck(LPTCP_CONNECTION Conn);
 static void TCP_OnCongestionTimeoutLoss(LPTCP_CONNECTION Conn);
 static void TCP_OnCongestionFastLoss(LPTCP_CONNECTION Conn);
-static void TCP_StartTrackedRetransmission(LPTCP_CONNECTION Conn, U8 Flags, const U8* Payload, U32 PayloadLength, U32 SequenceStart);
-static BOOL TCP_RetransmitTrackedSegment(LPTCP_CONNECTION Conn, BOOL FastRetransmit);
+static void TCP_QueueSegment(LPTCP_CONNECTION Conn, U8 Flags, U32 PayloadLength, U32 SequenceStart);
+static BOOL TCP_RetransmitSegment(LPTCP_CONNECTION Conn, U32 Index);
+static BOOL TCP_RetransmitOldestSegment(LPTCP_CONNECTION Conn);
+static BOOL TCP_RetransmitFirstHole(LPTCP_CONNECTION Conn, BOOL Force);
+static void TCP_ApplySackBlocks(LPTCP_CONNECTION Conn, const TCP_OPTIONS* Options);
+static void TCP_ReleaseAcknowledgedSegments(LPTCP_CONNECTION Conn, U32 AckNum, U32 EchoedTime);
+static U32 TCP_GetAdvertisedWindow(LPTCP_CONNECTION Conn);
 static void TCP_HandleAcknowledgement(LPTCP_CONNECTION Conn, LPTCP_PACKET_EVENT Event);
 static U32 TCP_GetAllowedSendBytes(LPTCP_CONNECTION Conn);
+static int TCP_TransmitQueuedData(LPTCP_CONNECTION Conn);
+static int TCP_TransmitSegment(LPTCP_CONNECTION Conn, U32 Sequence, U8 Flags, const U8* Payload, U32 PayloadLength);
 
 // State definitions
 static SM_STATE_DEFINITION TCP_States[] = {
@@ -181,16 +201,18 @@ static SM_TRANSITION TCP_Transitions[] = {
     { TCP_STATE_ESTABLISHED, TCP_EVENT_RCV_DATA, TCP_STATE_ESTABLISHED, NULL, TCP_ActionProcessData },
     { TCP_STATE_ESTABLISHED, TCP_EVENT_RCV_ACK, TCP_STATE_ESTABLISHED, TCP_ConditionValidAck, NULL },
     { TCP_STATE_ESTABLISHED, TCP_EVENT_CLOSE, TCP_STATE_FIN_WAIT_1, NULL, TCP_ActionSendFin },
-    { TCP_STATE_ESTABLISHED, TCP_EVENT_RCV_FIN, TCP_STATE_CLOSE_WAIT, NULL, TCP_ActionSendAck },
+    { TCP_STATE_ESTABLISHED, TCP_EVENT_RCV_FIN, TCP_STATE_CLOSE_WAIT, NULL, TCP_ActionReceiveFin },
     { TCP_STATE_ESTABLISHED, TCP_EVENT_RCV_RST, TCP_STATE_CLOSED, NULL, NULL },
 
-    // From FIN_WAIT_1
+    // From FIN_WAIT_1, the peer may still send data
+    { TCP_STATE_FIN_WAIT_1, TCP_EVENT_RCV_DATA, TCP_STATE_FIN_WAIT_1, NULL, TCP_ActionProcessData },
     { TCP_STATE_FIN_WAIT_1, TCP_EVENT_RCV_ACK, TCP_STATE_FIN_WAIT_2, TCP_ConditionValidAck, NULL },
-    { TCP_STATE_FIN_WAIT_1, TCP_EVENT_RCV_FIN, TCP_STATE_CLOSING, NULL, TCP_ActionSendAck },
+    { TCP_STATE_FIN_WAIT_1, TCP_EVENT_RCV_FIN, TCP_STATE_CLOSING, NULL, TCP_ActionReceiveFin },
     { TCP_STATE_FIN_WAIT_1, TCP_EVENT_RCV_RST, TCP_STATE_CLOSED, NULL, NULL },
 
     // From FIN_WAIT_2
-    { TCP_STATE_FIN_WAIT_2, TCP_EVENT_RCV_FIN, TCP_STATE_TIME_WAIT, NULL, TCP_ActionSendAck },
+    { TCP_STATE_FIN_WAIT_2, TCP_EVENT_RCV_DATA, TCP_STATE_FIN_WAIT_2, NULL, TCP_ActionProcessData },
+    { TCP_STATE_FIN_WAIT_2, TCP_EVENT_RCV_FIN, TCP_STATE_TIME_WAIT, NULL, TCP_ActionReceiveFin },
     { TCP_STATE_FIN_WAIT_2, TCP_EVENT_RCV_RST, TCP_STATE_CLOSED, NULL, NULL },
 
     // From CLOSE_WAIT
@@ -211,15 +233,25 @@ static SM_TRANSITION TCP_Transitions[] = {
 /************************************************************************/
 
 static BOOL TCP_IsPortInUse(U16 port, U32 localIP) {
-    LPLIST ConnectionList = GetTCPConnectionList();
-    LPTCP_CONNECTION conn = (LPTCP_CONNECTION)(ConnectionList != NULL ? ConnectionList->First : NULL);
-    while (conn != NULL) {
-        if (conn->LocalPort == Htons(port) && conn->LocalIP == localIP) {
-            return TRUE;
-        }
-        conn = (LPTCP_CONNECTION)conn->Next;
-    }
-    return FALSE;
+    return TCP_DemuxIsPortInUse(&GlobalTCP.Demux, localIP, Htons(port));
+}
+
+/************************************************************************/
+
+/**
+ * @brief Move a connection to the lookup table slots of its current endpoints.
+ * @param Conn Connection whose addresses or ports changed.
+ */
+static void TCP_Rehash(LPTCP_CONNECTION Conn) {
+    TCP_DemuxRemove(&GlobalTCP.Demux, &Conn->Demux);
+
+    Conn->Demux.LocalIP = Conn->LocalIP;
+    Conn->Demux.LocalPort = Conn->LocalPort;
+    Conn->Demux.RemoteIP = Conn->RemoteIP;
+    Conn->Demux.RemotePort = Conn->RemotePort;
+    Conn->Demux.Connection = Conn;
+
+    TCP_DemuxInsert(&GlobalTCP.Demux, &Conn->Demux);
 }
 
 /************************************************************************/
@@ -285,6 +317,18 @@ static U32 TCP_GetSegmentSequenceLength(U8 Flags, U32 PayloadLength) {
 
 /************************************************************************/
 
+/**
+ * @brief Compares two sequence numbers across wrap-around.
+ * @param Left First sequence number.
+ * @param Right Second sequence number.
+ * @return TRUE if Left comes before Right.
+ */
+static BOOL TCP_SequenceBefore(U32 Left, U32 Right) {
+    return ((I32)(Left - Right) < 0);
+}
+
+/************************************************************************/
+
 /**
  * @brief Determines if a segment must be tracked for retransmission.
  * @param Flags TCP segment flags.
@@ -306,20 +350,17 @@ static BOOL TCP_ShouldTrackRetransmission(U8 Flags, U32 PayloadLength) {
 /************************************************************************/
 
 /**
- * @brief Clears tracked retransmission metadata for a connection.
+ * @brief Drops the retransmission queue and the send buffer of a connection.
  * @param Conn Target TCP connection.
  */
 static void TCP_ClearRetransmissionState(LPTCP_CONNECTION Conn) {
     SAFE_USE_VALID_ID(Conn, KOID_TCP) {
-        Conn->RetransmitPending = FALSE;
-        Conn->RetransmitPayloadLength = 0;
-        Conn->RetransmitFlags = 0;
-        Conn->RetransmitSequenceStart = 0;
-        Conn->RetransmitSequenceEnd = 0;
-        Conn->RetransmitTimestamp = 0;
+        Conn->SegmentCount = 0;
+        Conn->SendBufferUsed = 0;
+        Conn->SendBufferSent = 0;
+        Conn->FinPending = FALSE;
         Conn->RetransmitTimer = 0;
         Conn->RetransmitCount = 0;
-        Conn->RetransmitWasRetried = FALSE;
     }
 }
 
@@ -359,6 +400,10 @@ static void TCP_OnCongestionNewAck(LPTCP_CONNECTION Conn) {
 
 /**
  * @brief Applies congestion state transition for timeout loss.
+ *
+ * Every segment sent so far is then recovered one partial ACK at a time,
+ * up to the recovery point.
+ *
  * @param Conn Target TCP connection.
  */
 static void TCP_OnCongestionTimeoutLoss(LPTCP_CONNECTION Conn) {
@@ -373,7 +418,7 @@ static void TCP_OnCongestionTimeoutLoss(LPTCP_CONNECTION Conn) {
         Conn->SlowStartThreshold = HalfWindow;
         Conn->CongestionWindow = TCP_CONGESTION_INITIAL_WINDOW;
         Conn->InFastRecovery = FALSE;
-        Conn->FastRecoverySequence = 0;
+        Conn->FastRecoverySequence = Conn->SendNext;
     }
 }
 
@@ -402,91 +447,118 @@ static void TCP_OnCongestionFastLoss(LPTCP_CONNECTION Conn) {
 /************************************************************************/
 
 /**
- * @brief Starts retransmission tracking for a freshly transmitted segment.
+ * @brief Appends a freshly transmitted segment to the retransmission queue.
+ *
+ * The payload of a data segment is the tail of the send buffer that was not
+ * sent yet, so only its length is recorded.
+ *
  * @param Conn Target TCP connection.
  * @param Flags Segment flags.
- * @param Payload Segment payload pointer.
  * @param PayloadLength Segment payload length.
  * @param SequenceStart Segment sequence start number.
  */
-static void TCP_StartTrackedRetransmission(LPTCP_CONNECTION Conn, U8 Flags, const U8* Payload, U32 PayloadLength, U32 SequenceStart) {
+static void TCP_QueueSegment(LPTCP_CONNECTION Conn, U8 Flags, U32 PayloadLength, U32 SequenceStart) {
     SAFE_USE_VALID_ID(Conn, KOID_TCP) {
-        U32 TrackedLength = PayloadLength;
-        U32 SequenceLength = TCP_GetSegmentSequenceLength(Flags, PayloadLength);
-
-        if (TrackedLength > TCP_MAX_RETRANSMIT_PAYLOAD) {
-            TrackedLength = TCP_MAX_RETRANSMIT_PAYLOAD;
+        if (Conn->SegmentCount >= TCP_MAX_SEND_SEGMENTS) {
+            WARNING(TEXT("[TCP_QueueSegment] Retransmission queue full, segment %u not tracked"), SequenceStart);
+            return;
         }
 
-        Conn->RetransmitFlags = Flags;
-        Conn->RetransmitPayloadLength = TrackedLength;
-        Conn->RetransmitSequenceStart = SequenceStart;
-        Conn->RetransmitSequenceEnd = SequenceStart + SequenceLength;
-        Conn->RetransmitTimestamp = GetSystemTime();
-        Conn->RetransmitTimer = Conn->RetransmitTimestamp + Conn->RetransmitCurrentTimeout;
-        Conn->RetransmitCount = 0;
-        Conn->RetransmitPending = TRUE;
-        Conn->RetransmitWasRetried = FALSE;
+        LPTCP_SEGMENT Segment = &(Conn->Segments[Conn->SegmentCount]);
 
-        if (TrackedLength > 0 && Payload != NULL) {
-            MemoryCopy(Conn->RetransmitPayload, Payload, TrackedLength);
+        if (Conn->SegmentCount == 0) {
+            Conn->SendUnacked = SequenceStart;
+            Conn->RetransmitCount = 0;
+            Conn->RetransmitTimer = GetSystemTime() + Conn->RetransmitCurrentTimeout;
         }
+
+        Segment->SequenceStart = SequenceStart;
+        Segment->Length = PayloadLength;
+        Segment->SentTime = GetSystemTime();
+        Segment->Flags = Flags;
+        Segment->Retransmitted = FALSE;
+        Segment->Sacked = FALSE;
+
+        Conn->SegmentCount++;
+        Conn->SendBufferSent += PayloadLength;
     }
 }
 
 /************************************************************************/
 
 /**
- * @brief Retransmits the tracked segment.
+ * @brief Retransmits one queued segment.
  * @param Conn Target TCP connection.
- * @param FastRetransmit Indicates a duplicate-ACK-triggered retransmit.
+ * @param Index Position of the segment in the queue.
  * @return TRUE if retransmission succeeded.
  */
-static BOOL TCP_RetransmitTrackedSegment(LPTCP_CONNECTION Conn, BOOL FastRetransmit) {
+static BOOL TCP_RetransmitSegment(LPTCP_CONNECTION Conn, U32 Index) {
     SAFE_USE_VALID_ID(Conn, KOID_TCP) {
-        if (Conn->RetransmitPending == FALSE) {
+        if (Index >= Conn->SegmentCount) {
             return FALSE;
         }
 
-        U32 PreviousSendNext = Conn->SendNext;
-        U32 PreviousSendUnacked = Conn->SendUnacked;
-        U32 PreviousSequenceStart = Conn->RetransmitSequenceStart;
-        U32 PreviousRetransmitCount = Conn->RetransmitCount;
-        U32 PreviousRetransmitTimeout = Conn->RetransmitCurrentTimeout;
-        U32 PayloadLength = Conn->RetransmitPayloadLength;
-        U8 Flags = Conn->RetransmitFlags;
-        const U8* Payload = (PayloadLength > 0) ? Conn->RetransmitPayload : NULL;
+        LPTCP_SEGMENT Segment = &(Conn->Segments[Index]);
+        U32 Offset = 0;
+        U32 Scan;
 
-        Conn->SendNext = PreviousSequenceStart;
-        I32 SendResult = TCP_SendPacket(Conn, Flags, Payload, PayloadLength);
-        Conn->SendNext = PreviousSendNext;
-        Conn->SendUnacked = PreviousSendUnacked;
+        for (Scan = 0; Scan < Index; Scan++) {
+            Offset += Conn->Segments[Scan].Length;
+        }
+
+        const U8* Payload = (Segment->Length > 0) ? (Conn->SendBuffer + Offset) : NULL;
 
-        if (SendResult < 0) {
+        if (TCP_TransmitSegment(Conn, Segment->SequenceStart, Segment->Flags, Payload, Segment->Length) < 0) {
             return FALSE;
         }
 
-        Conn->RetransmitWasRetried = TRUE;
-        Conn->RetransmitCount = PreviousRetransmitCount;
-        Conn->RetransmitCurrentTimeout = PreviousRetransmitTimeout;
-        Conn->RetransmitTimestamp = GetSystemTime();
+        Segment->Retransmitted = TRUE;
+        Segment->SentTime = GetSystemTime();
 
-        if (FastRetransmit) {
-            Conn->RetransmitTimer = Conn->RetransmitTimestamp + Conn->RetransmitCurrentTimeout;
-        } else {
-            Conn->RetransmitCount++;
+        return TRUE;
+    }
 
-            if (Conn->RetransmitCurrentTimeout < TCP_RETRANSMIT_TIMEOUT_MAX) {
-                U32 NextTimeout = Conn->RetransmitCurrentTimeout << 1;
-                if (NextTimeout < Conn->RetransmitCurrentTimeout || NextTimeout > TCP_RETRANSMIT_TIMEOUT_MAX) {
-                    NextTimeout = TCP_RETRANSMIT_TIMEOUT_MAX;
-                }
-                Conn->RetransmitCurrentTimeout = NextTimeout;
-            }
+    return FALSE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Retransmits the oldest queued segment after a timeout.
+ *
+ * SACK information is discarded first since the receiver may renege on it.
+ *
+ * @param Conn Target TCP connection.
+ * @return TRUE if retransmission succeeded.
+ */
+static BOOL TCP_RetransmitOldestSegment(LPTCP_CONNECTION Conn) {
+    SAFE_USE_VALID_ID(Conn, KOID_TCP) {
+        U32 Index;
+
+        if (Conn->SegmentCount == 0) {
+            return FALSE;
+        }
+
+        for (Index = 0; Index < Conn->SegmentCount; Index++) {
+            Conn->Segments[Index].Sacked = FALSE;
+        }
 
-            Conn->RetransmitTimer = Conn->RetransmitTimestamp + Conn->RetransmitCurrentTimeout;
+        if (TCP_RetransmitSegment(Conn, 0) == FALSE) {
+            return FALSE;
         }
 
+        Conn->RetransmitCount++;
+
+        if (Conn->RetransmitCurrentTimeout < TCP_RETRANSMIT_TIMEOUT_MAX) {
+            U32 NextTimeout = Conn->RetransmitCurrentTimeout << 1;
+            if (NextTimeout < Conn->RetransmitCurrentTimeout || NextTimeout > TCP_RETRANSMIT_TIMEOUT_MAX) {
+                NextTimeout = TCP_RETRANSMIT_TIMEOUT_MAX;
+            }
+            Conn->RetransmitCurrentTimeout = NextTimeout;
+        }
+
+        Conn->RetransmitTimer = GetSystemTime() + Conn->RetransmitCurrentTimeout;
+
         return TRUE;
     }
 
@@ -495,6 +567,183 @@ static BOOL TCP_RetransmitTrackedSegment(LPTCP_CONNECTION Conn, BOOL FastRetrans
 
 /************************************************************************/
 
+/**
+ * @brief Retransmits the first hole of the queue during loss recovery.
+ *
+ * A hole is a segment that was neither SACKed nor retransmitted since it was
+ * queued. Without SACK only the oldest segment qualifies; with SACK any
+ * segment below the highest SACKed one does, so several losses in one
+ * window are repaired without waiting for the timeout.
+ *
+ * @param Conn Target TCP connection.
+ * @param Force Retransmit the oldest unSACKed segment even if already retransmitted.
+ * @return TRUE if a segment was retransmitted.
+ */
+static BOOL TCP_RetransmitFirstHole(LPTCP_CONNECTION Conn, BOOL Force) {
+    SAFE_USE_VALID_ID(Conn, KOID_TCP) {
+        U32 HighestSacked = 0;
+        U32 Index;
+
+        for (Index = 0; Index < Conn->SegmentCount; Index++) {
+            if (Conn->Segments[Index].Sacked) {
+                HighestSacked = Index + 1;
+            }
+        }
+
+        if (HighestSacked == 0) {
+            HighestSacked = 1;
+        }
+
+        for (Index = 0; Index < HighestSacked && Index < Conn->SegmentCount; Index++) {
+            LPTCP_SEGMENT Segment = &(Conn->Segments[Index]);
+
+            if (Segment->Sacked) {
+                continue;
+            }
+
+            if (Segment->Retransmitted && Force == FALSE) {
+                continue;
+            }
+
+            if (TCP_RetransmitSegment(Conn, Index)) {
+                Conn->RetransmitTimer = GetSystemTime() + Conn->RetransmitCurrentTimeout;
+                return TRUE;
+            }
+
+            return FALSE;
+        }
+    }
+
+    return FALSE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Marks the queued segments covered by the SACK blocks of an ACK.
+ * @param Conn Target TCP connection.
+ * @param Options Options of the received segment.
+ */
+static void TCP_ApplySackBlocks(LPTCP_CONNECTION Conn, const TCP_OPTIONS* Options) {
+    SAFE_USE_VALID_ID(Conn, KOID_TCP) {
+        U32 Block;
+        U32 Index;
+
+        if (Options == NULL || Options->SackCount == 0 || Conn->SackPermitted == FALSE) {
+            return;
+        }
+
+        for (Block = 0; Block < Options->SackCount; Block++) {
+            U32 Start = Options->SackStart[Block];
+            U32 End = Options->SackEnd[Block];
+
+            for (Index = 0; Index < Conn->SegmentCount; Index++) {
+                LPTCP_SEGMENT Segment = &(Conn->Segments[Index]);
+                U32 SegmentEnd = Segment->SequenceStart + TCP_GetSegmentSequenceLength(Segment->Flags, Segment->Length);
+
+                if (TCP_SequenceBefore(Segment->SequenceStart, Start) == FALSE &&
+                    TCP_SequenceBefore(End, SegmentEnd) == FALSE) {
+                    Segment->Sacked = TRUE;
+                }
+            }
+        }
+    }
+}
+
+/************************************************************************/
+
+/**
+ * @brief Removes acknowledged bytes from the queue and the send buffer.
+ *
+ * Takes one RTT sample from the echoed timestamp when there is one, else
+ * from the newest fully acknowledged segment that was sent only once
+ * (Karn's rule).
+ *
+ * @param Conn Target TCP connection.
+ * @param AckNum Cumulative acknowledgement number.
+ * @param EchoedTime Timestamp echoed by the peer, 0 if none.
+ */
+static void TCP_ReleaseAcknowledgedSegments(LPTCP_CONNECTION Conn, U32 AckNum, U32 EchoedTime) {
+    SAFE_USE_VALID_ID(Conn, KOID_TCP) {
+        U32 Now = GetSystemTime();
+        U32 SampleTime = EchoedTime;
+        BOOL HasSample = (EchoedTime != 0);
+        U32 Released = 0;
+        U32 DataAcked = 0;
+
+        while (Released < Conn->SegmentCount) {
+            LPTCP_SEGMENT Segment = &(Conn->Segments[Released]);
+            U32 SegmentEnd = Segment->SequenceStart + TCP_GetSegmentSequenceLength(Segment->Flags, Segment->Length);
+
+            if (TCP_SequenceBefore(AckNum, SegmentEnd) == FALSE) {
+                if (Segment->Retransmitted == FALSE && EchoedTime == 0) {
+                    SampleTime = Segment->SentTime;
+                    HasSample = TRUE;
+                }
+
+                DataAcked += Segment->Length;
+                Released++;
+                continue;
+            }
+
+            if (TCP_SequenceBefore(Segment->SequenceStart, AckNum)) {
+                U32 Covered = AckNum - Segment->SequenceStart;
+
+                if ((Segment->Flags & TCP_FLAG_SYN) != 0) {
+                    Segment->Flags &= (U8)~TCP_FLAG_SYN;
+                    Segment->SequenceStart++;
+                    Covered--;
+                }
+
+                if (Covered > Segment->Length) {
+                    Covered = Segment->Length;
+                }
+
+                Segment->SequenceStart += Covered;
+                Segment->Length -= Covered;
+                DataAcked += Covered;
+            }
+
+            break;
+        }
+
+        if (Released > 0) {
+            Conn->SegmentCount -= Released;
+            if (Conn->SegmentCount > 0) {
+                MemoryMove(Conn->Segments, Conn->Segments + Released, Conn->SegmentCount * sizeof(TCP_SEGMENT));
+            }
+        }
+
+        if (DataAcked > 0) {
+            if (DataAcked > Conn->SendBufferUsed) {
+                DataAcked = Conn->SendBufferUsed;
+            }
+
+            Conn->SendBufferUsed -= DataAcked;
+            Conn->SendBufferSent = (Conn->SendBufferSent > DataAcked) ? (Conn->SendBufferSent - DataAcked) : 0;
+
+            if (Conn->SendBufferUsed > 0) {
+                MemoryMove(Conn->SendBuffer, Conn->SendBuffer + DataAcked, Conn->SendBufferUsed);
+            }
+        }
+
+        if (HasSample && Now >= SampleTime) {
+            U32 SampleRTT = Now - SampleTime;
+            U32 Smoothed = ((Conn->RetransmitBaseTimeout * 7) + SampleRTT) / 8;
+
+            if (Smoothed < TCP_RETRANSMIT_TIMEOUT_MIN) {
+                Smoothed = TCP_RETRANSMIT_TIMEOUT_MIN;
+            } else if (Smoothed > TCP_RETRANSMIT_TIMEOUT_MAX) {
+                Smoothed = TCP_RETRANSMIT_TIMEOUT_MAX;
+            }
+
+            Conn->RetransmitBaseTimeout = Smoothed;
+        }
+    }
+}
+
+/************************************************************************/
+
 /**
  * @brief Processes ACK progression for retransmission and congestion control.
  * @param Conn Target TCP connection.
@@ -507,56 +756,75 @@ static void TCP_HandleAcknowledgement(LPTCP_CONNECTION Conn, LPTCP_PACKET_EVENT
         }
 
         U32 AckNum = Ntohl(Event->Header->AckNumber);
-        U32 Now = GetSystemTime();
         BOOL IsDuplicateAck = FALSE;
         BOOL HasNoPayload = (Event->PayloadLength == 0);
 
-        if (AckNum == Conn->LastAckNumber && HasNoPayload) {
-            IsDuplicateAck = TRUE;
+        U32 EchoedTime = 0;
+
+        if ((Event->Header->Flags & TCP_FLAG_SYN) != 0) {
+            TCP_NegotiateOptions(Conn, Event->Options);
+
+            // The window of a SYN is never scaled
+            Conn->SendWindow = Ntohs(Event->Header->WindowSize);
+        } else {
+            Conn->SendWindow = (U32)Ntohs(Event->Header->WindowSize) << Conn->SendWindowScale;
+        }
+
+        if (Conn->TimestampsEnabled && Event->Options != NULL && Event->Options->HasTimestamp) {
+            EchoedTime = Event->Options->TSEcr;
         }
 
-        if (AckNum > Conn->SendUnacked) {
-            Conn->SendUnacked = AckNum;
+        TCP_ApplySackBlocks(Conn, Event->Options);
+
+        if (AckNum == Conn->LastAckNumber && HasNoPayload && Conn->SegmentCount > 0) {
+            IsDuplicateAck = TRUE;
         }
 
         if (IsDuplicateAck) {
             Conn->DuplicateAckCount++;
-            if (Conn->DuplicateAckCount >= TCP_DUPLICATE_ACK_THRESHOLD &&
-                Conn->RetransmitPending &&
-                AckNum == Conn->RetransmitSequenceStart) {
+
+            if (Conn->DuplicateAckCount == TCP_DUPLICATE_ACK_THRESHOLD && Conn->InFastRecovery == FALSE) {
                 TCP_OnCongestionFastLoss(Conn);
-                if (TCP_RetransmitTrackedSegment(Conn, TRUE) == TRUE) {
-                }
+                TCP_RetransmitFirstHole(Conn, TRUE);
+            } else if (Conn->InFastRecovery) {
+                Conn->CongestionWindow += TCP_MAX_RETRANSMIT_PAYLOAD;
+                TCP_RetransmitFirstHole(Conn, FALSE);
             }
+
+            TCP_TransmitQueuedData(Conn);
             return;
         }
 
+        if (TCP_SequenceBefore(Conn->SendUnacked, AckNum) == FALSE) {
+            TCP_TransmitQueuedData(Conn);
+            return;
+        }
+
+        Conn->SendUnacked = AckNum;
         Conn->DuplicateAckCount = 0;
         Conn->LastAckNumber = AckNum;
 
-        if (Conn->InFastRecovery && AckNum >= Conn->FastRecoverySequence) {
-            Conn->InFastRecovery = FALSE;
-            Conn->CongestionWindow = Conn->SlowStartThreshold;
-        }
-
-        if (Conn->RetransmitPending && AckNum >= Conn->RetransmitSequenceEnd) {
-            if (Conn->RetransmitWasRetried == FALSE && Conn->RetransmitTimestamp > 0 && Now >= Conn->RetransmitTimestamp) {
-                U32 SampleRTT = Now - Conn->RetransmitTimestamp;
-                U32 Smoothed = ((Conn->RetransmitBaseTimeout * 7) + SampleRTT) / 8;
+        TCP_ReleaseAcknowledgedSegments(Conn, AckNum, EchoedTime);
 
-                if (Smoothed < TCP_RETRANSMIT_TIMEOUT_MIN) {
-                    Smoothed = TCP_RETRANSMIT_TIMEOUT_MIN;
-                } else if (Smoothed > TCP_RETRANSMIT_TIMEOUT_MAX) {
-                    Smoothed = TCP_RETRANSMIT_TIMEOUT_MAX;
-                }
+        Conn->RetransmitCurrentTimeout = Conn->RetransmitBaseTimeout;
+        Conn->RetransmitCount = 0;
+        Conn->RetransmitTimer = (Conn->SegmentCount > 0) ? (GetSystemTime() + Conn->RetransmitCurrentTimeout) : 0;
 
-                Conn->RetransmitBaseTimeout = Smoothed;
+        if (Conn->FastRecoverySequence != 0 && TCP_SequenceBefore(AckNum, Conn->FastRecoverySequence)) {
+            // Partial ACK: the next hole is lost as well
+            TCP_RetransmitFirstHole(Conn, FALSE);
+        } else {
+            if (Conn->InFastRecovery) {
+                Conn->CongestionWindow = Conn->SlowStartThreshold;
+            } else {
+                TCP_OnCongestionNewAck(Conn);
             }
 
-            Conn->RetransmitCurrentTimeout = Conn->RetransmitBaseTimeout;
-            TCP_ClearRetransmissionState(Conn);
-            TCP_OnCongestionNewAck(Conn);
+            Conn->InFastRecovery = FALSE;
+            Conn->FastRecoverySequence = 0;
         }
+
+        TCP_TransmitQueuedData(Conn);
     }
 }
 
@@ -564,61 +832,607 @@ static void TCP_HandleAcknowledgement(LPTCP_CONNECTION Conn, LPTCP_PACKET_EVENT
 
 /**
  * @brief Returns the allowed send bytes according to congestion state.
+ *
+ * The limit is the smaller of the congestion window and the peer window,
+ * minus the bytes in flight that were not SACKed. A closed peer window
+ * still allows a single byte when nothing is in flight, which serves as a
+ * window probe.
+ *
  * @param Conn Target TCP connection.
  * @return Number of bytes allowed to be sent immediately.
  */
 static U32 TCP_GetAllowedSendBytes(LPTCP_CONNECTION Conn) {
     SAFE_USE_VALID_ID(Conn, KOID_TCP) {
-        if (Conn->RetransmitPending && Conn->SendNext > Conn->SendUnacked) {
-            return 0;
+        U32 Window = Conn->CongestionWindow;
+        U32 InFlight = Conn->SendNext - Conn->SendUnacked;
+        U32 Index;
+
+        if (Conn->SegmentCount == 0) {
+            InFlight = 0;
         }
 
-        U32 InFlight = Conn->SendNext - Conn->SendUnacked;
+        for (Index = 0; Index < Conn->SegmentCount; Index++) {
+            if (Conn->Segments[Index].Sacked && InFlight >= Conn->Segments[Index].Length) {
+                InFlight -= Conn->Segments[Index].Length;
+            }
+        }
 
-        if (Conn->CongestionWindow <= InFlight) {
+        if ((U32)Conn->SendWindow < Window) {
+            Window = Conn->SendWindow;
+        }
+
+        if (Window == 0 && InFlight == 0) {
+            return 1;
+        }
+
+        if (Window <= InFlight) {
             return 0;
         }
 
-        return Conn->CongestionWindow - InFlight;
+        return Window - InFlight;
+    }
+
+    return 0;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Returns the payload that fits in one segment next to the options.
+ *
+ * Timestamps are carried by every segment, so they come out of the MSS.
+ * SACK blocks are only added when they fit in what is left.
+ *
+ * @param Conn Target TCP connection.
+ * @return Maximum payload bytes per segment.
+ */
+static U32 TCP_GetSendMss(LPTCP_CONNECTION Conn) {
+    if (Conn->TimestampsEnabled) {
+        return TCP_MAX_RETRANSMIT_PAYLOAD - TCP_TIMESTAMP_OPTION_SPACE;
+    }
+
+    return TCP_MAX_RETRANSMIT_PAYLOAD;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Sends the queued data and a pending FIN as far as the windows allow.
+ * @param Conn Target TCP connection.
+ * @return Number of payload bytes sent, or a negative value on send failure.
+ */
+static int TCP_TransmitQueuedData(LPTCP_CONNECTION Conn) {
+    SAFE_USE_VALID_ID(Conn, KOID_TCP) {
+        int TotalSent = 0;
+        U32 Mss = TCP_GetSendMss(Conn);
+        U32 MaxChunk = Mss;
+
+        // The NIC splits larger segments itself
+        if ((IPv4_GetDeviceCaps(Conn->Device) & (NETWORK_CAP_TSO | NETWORK_CAP_TX_CHECKSUM)) ==
+            (NETWORK_CAP_TSO | NETWORK_CAP_TX_CHECKSUM)) {
+            MaxChunk = Mss * TCP_TSO_MAX_SEGMENTS;
+        }
+
+        while (Conn->SendBufferSent < Conn->SendBufferUsed && Conn->SegmentCount < TCP_MAX_SEND_SEGMENTS) {
+            U32 Allowed = TCP_GetAllowedSendBytes(Conn);
+            U32 ChunkSize = (U32)(Conn->SendBufferUsed - Conn->SendBufferSent);
+            U8 Flags = TCP_FLAG_ACK;
+
+            // Nagle: a segment below MSS waits until the data in flight is acknowledged
+            if (ChunkSize < Mss && Conn->SendBufferSent > 0 &&
+                Conn->NoDelay == FALSE && Conn->FinPending == FALSE) {
+                break;
+            }
+
+            if (ChunkSize > MaxChunk) {
+                ChunkSize = MaxChunk;
+            }
+            if (ChunkSize > Allowed) {
+                ChunkSize = Allowed;
+            }
+            if (ChunkSize == 0) {
+                break;
+            }
+
+            if (Conn->SendBufferSent + ChunkSize == Conn->SendBufferUsed) {
+                Flags |= TCP_FLAG_PSH;
+            }
+
+            if (TCP_SendPacket(Conn, Flags, Conn->SendBuffer + Conn->SendBufferSent, ChunkSize) < 0) {
+                ERROR(TEXT("[TCP_TransmitQueuedData] Failed to send %u bytes chunk"), ChunkSize);
+                return (TotalSent > 0) ? TotalSent : -1;
+            }
+
+            TotalSent += (int)ChunkSize;
+        }
+
+        if (Conn->FinPending && Conn->SendBufferSent == Conn->SendBufferUsed &&
+            Conn->SegmentCount < TCP_MAX_SEND_SEGMENTS) {
+            Conn->FinPending = FALSE;
+
+            if (TCP_SendPacket(Conn, TCP_FLAG_FIN | TCP_FLAG_ACK, NULL, 0) < 0) {
+                return -1;
+            }
+        }
+
+        return TotalSent;
+    }
+
+    return -1;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Free room of the receive buffer, the base of the advertised window.
+ * @param Conn Target TCP connection.
+ * @return Bytes the buffer may still take.
+ */
+static UINT TCP_GetReceiveSpace(LPTCP_CONNECTION Conn) {
+    UINT Used = CircularBuffer_GetAvailableData(&(Conn->RecvBuffer));
+
+    return (Conn->RecvBufferCapacity > Used) ? (Conn->RecvBufferCapacity - Used) : 0;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Wake the reader sleeping on a connection, if any.
+ * @param Conn Target TCP connection.
+ */
+static void TCP_WakeReader(LPTCP_CONNECTION Conn) {
+    WakeUpTask((LPTASK)Conn->RecvRequest.Waiter);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Tell the socket and the reader of a connection that it changed.
+ *
+ * Called when the state changes or acknowledged bytes leave the send
+ * buffer, so that tasks sleeping on the socket look at it again.
+ *
+ * @param Conn Target TCP connection.
+ */
+static void TCP_NotifyOwner(LPTCP_CONNECTION Conn) {
+    SocketTCPStateCallback(Conn);
+    TCP_WakeReader(Conn);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Hands in-order bytes to the reader and the receive buffer.
+ *
+ * Each byte is copied once: straight into the buffer of a sleeping reader
+ * while nothing older waits in the receive buffer, into the receive buffer
+ * otherwise.
+ *
+ * @param Conn Target TCP connection.
+ * @param Data Bytes starting at RecvNext.
+ * @param Length Number of bytes.
+ * @return Number of bytes accepted.
+ */
+static U32 TCP_DeliverData(LPTCP_CONNECTION Conn, const U8* Data, U32 Length) {
+    LPTCP_RECV_REQUEST Request = &(Conn->RecvRequest);
+    U32 BytesAccepted = 0;
+    U32 CopyLength;
+    U32 Flags;
+
+    // The reader may give up its request at any time, take it with interrupts off
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    if (Request->Buffer != NULL && Request->Filled < Request->Length &&
+        CircularBuffer_GetAvailableData(&(Conn->RecvBuffer)) == 0) {
+        CopyLength = Request->Length - Request->Filled;
+        if (CopyLength > Length) CopyLength = Length;
+
+        MemoryCopy(Request->Buffer + Request->Filled, Data, CopyLength);
+        Request->Filled += CopyLength;
+        BytesAccepted = CopyLength;
+    }
+
+    RestoreFlags(&Flags);
+
+    CopyLength = Length - BytesAccepted;
+    if (CopyLength > (U32)TCP_GetReceiveSpace(Conn)) CopyLength = (U32)TCP_GetReceiveSpace(Conn);
+
+    if (CopyLength > 0) {
+        BytesAccepted += CircularBuffer_Write(&(Conn->RecvBuffer), Data + BytesAccepted, CopyLength);
+    }
+
+    if (BytesAccepted > 0) {
+        SocketTCPReceiveCallback(Conn, BytesAccepted);
+        TCP_WakeReader(Conn);
+    }
+
+    return BytesAccepted;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Adds a sequence range to the out-of-order list.
+ *
+ * The list stays sorted; overlapping and adjacent ranges are merged.
+ *
+ * @param Conn Target TCP connection.
+ * @param Start First sequence number.
+ * @param End Sequence number after the last byte.
+ * @return TRUE if the range is recorded, FALSE if the list is full.
+ */
+static BOOL TCP_InsertRecvRange(LPTCP_CONNECTION Conn, U32 Start, U32 End) {
+    U32 Index = 0;
+
+    while (Index < Conn->RecvRangeCount) {
+        LPTCP_RECV_RANGE Range = &(Conn->RecvRanges[Index]);
+
+        if (TCP_SequenceBefore(Range->End, Start) == FALSE && TCP_SequenceBefore(End, Range->Start) == FALSE) {
+            if (TCP_SequenceBefore(Range->Start, Start)) {
+                Start = Range->Start;
+            }
+            if (TCP_SequenceBefore(End, Range->End)) {
+                End = Range->End;
+            }
+
+            Conn->RecvRangeCount--;
+            MemoryMove(Range, Range + 1, (Conn->RecvRangeCount - Index) * sizeof(TCP_RECV_RANGE));
+            continue;
+        }
+
+        Index++;
+    }
+
+    if (Conn->RecvRangeCount >= TCP_MAX_RECV_RANGES) {
+        return FALSE;
+    }
+
+    for (Index = 0; Index < Conn->RecvRangeCount; Index++) {
+        if (TCP_SequenceBefore(Start, Conn->RecvRanges[Index].Start)) {
+            break;
+        }
+    }
+
+    MemoryMove(Conn->RecvRanges + Index + 1, Conn->RecvRanges + Index,
+        (Conn->RecvRangeCount - Index) * sizeof(TCP_RECV_RANGE));
+    Conn->RecvRanges[Index].Start = Start;
+    Conn->RecvRanges[Index].End = End;
+    Conn->RecvRangeCount++;
+
+    return TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Keeps a segment that arrived past a hole.
+ *
+ * Bytes beyond the advertised window are dropped.
+ *
+ * @param Conn Target TCP connection.
+ * @param SeqNum Sequence number of the first byte, after RecvNext.
+ * @param Data Segment payload.
+ * @param Length Payload length.
+ */
+static void TCP_StoreOutOfOrder(LPTCP_CONNECTION Conn, U32 SeqNum, const U8* Data, U32 Length) {
+    U32 WindowEnd = Conn->RecvNext + (U32)TCP_GetReceiveSpace(Conn);
+    U32 Offset = 0;
+
+    if (TCP_SequenceBefore(SeqNum, WindowEnd) == FALSE) {
+        return;
+    }
+
+    if (TCP_SequenceBefore(WindowEnd, SeqNum + Length)) {
+        Length = WindowEnd - SeqNum;
+    }
+
+    if (TCP_InsertRecvRange(Conn, SeqNum, SeqNum + Length) == FALSE) {
+        return;
+    }
+
+    while (Offset < Length) {
+        U32 Position = (SeqNum + Offset) & (Conn->RecvBufferCapacity - 1);
+        U32 Chunk = Conn->RecvBufferCapacity - Position;
+
+        if (Chunk > Length - Offset) {
+            Chunk = Length - Offset;
+        }
+
+        MemoryCopy(Conn->ReorderBuffer + Position, Data + Offset, Chunk);
+        Offset += Chunk;
+    }
+
+    Conn->RecvLatestSequence = SeqNum;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Delivers the out-of-order ranges made contiguous by new data.
+ *
+ * If the socket layer refuses part of a range, the remaining ranges are
+ * dropped and left to the peer retransmissions.
+ *
+ * @param Conn Target TCP connection.
+ * @param Sequence Sequence number following the delivered data.
+ * @return Sequence number following the data delivered from the ranges.
+ */
+static U32 TCP_DeliverOutOfOrder(LPTCP_CONNECTION Conn, U32 Sequence) {
+    while (Conn->RecvRangeCount > 0) {
+        TCP_RECV_RANGE Range = Conn->RecvRanges[0];
+
+        if (TCP_SequenceBefore(Sequence, Range.Start)) {
+            break;
+        }
+
+        Conn->RecvRangeCount--;
+        MemoryMove(Conn->RecvRanges, Conn->RecvRanges + 1, Conn->RecvRangeCount * sizeof(TCP_RECV_RANGE));
+
+        while (TCP_SequenceBefore(Sequence, Range.End)) {
+            U32 Position = Sequence & (Conn->RecvBufferCapacity - 1);
+            U32 Chunk = Conn->RecvBufferCapacity - Position;
+            U32 Accepted;
+
+            if (Chunk > Range.End - Sequence) {
+                Chunk = Range.End - Sequence;
+            }
+
+            Accepted = TCP_DeliverData(Conn, Conn->ReorderBuffer + Position, Chunk);
+            Sequence += Accepted;
+
+            if (Accepted < Chunk) {
+                Conn->RecvRangeCount = 0;
+                return Sequence;
+            }
+        }
+    }
+
+    return Sequence;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Writes a SACK option describing the out-of-order ranges.
+ *
+ * The range holding the most recent segment comes first (RFC 2018).
+ *
+ * @param Conn Target TCP connection.
+ * @param Options Destination, room for two NOPs and MaxBlocks blocks.
+ * @param MaxBlocks Maximum number of blocks to report.
+ * @return Number of option bytes written.
+ */
+static U32 TCP_BuildSackOption(LPTCP_CONNECTION Conn, U8* Options, U32 MaxBlocks) {
+    U32 Order[TCP_MAX_RECV_RANGES];
+    U32 Count = 0;
+    U32 Index;
+
+    for (Index = 0; Index < Conn->RecvRangeCount; Index++) {
+        LPTCP_RECV_RANGE Range = &(Conn->RecvRanges[Index]);
+
+        if (TCP_SequenceBefore(Conn->RecvLatestSequence, Range->Start) == FALSE &&
+            TCP_SequenceBefore(Conn->RecvLatestSequence, Range->End)) {
+            Order[Count++] = Index;
+            break;
+        }
+    }
+
+    for (Index = 0; Index < Conn->RecvRangeCount; Index++) {
+        if (Count > 0 && Order[0] == Index) {
+            continue;
+        }
+        Order[Count++] = Index;
+    }
+
+    if (Count > MaxBlocks) {
+        Count = MaxBlocks;
+    }
+
+    if (Count == 0) {
+        return 0;
+    }
+
+    Options[0] = 1;    // NOP
+    Options[1] = 1;    // NOP
+    Options[2] = 5;    // SACK option type
+    Options[3] = (U8)(2 + (Count * 8));
+
+    for (Index = 0; Index < Count; Index++) {
+        U32 Start = Htonl(Conn->RecvRanges[Order[Index]].Start);
+        U32 End = Htonl(Conn->RecvRanges[Order[Index]].End);
+
+        MemoryCopy(Options + 4 + (Index * 8), &Start, sizeof(U32));
+        MemoryCopy(Options + 8 + (Index * 8), &End, sizeof(U32));
+    }
+
+    return 4 + (Count * 8);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Returns the receive window to advertise, in bytes.
+ *
+ * The value is a multiple of the window scale unit and fits the 16-bit
+ * header field once shifted.
+ *
+ * @param Conn Target TCP connection.
+ * @return Window in bytes.
+ */
+static U32 TCP_GetAdvertisedWindow(LPTCP_CONNECTION Conn) {
+    U32 Window = (U32)TCP_GetReceiveSpace(Conn) >> Conn->RecvWindowScale;
+
+    if (Window > 0xFFFFU) {
+        Window = 0xFFFFU;
+    }
+
+    return Window << Conn->RecvWindowScale;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Returns the value of the window field of an outgoing segment.
+ *
+ * The window of a SYN is never scaled (RFC 7323), so it is capped to
+ * 64 KiB; later segments carry the advertised window shifted right.
+ *
+ * @param Conn Target TCP connection.
+ * @param Flags Flags of the segment.
+ * @return Window field, host byte order.
+ */
+U16 TCP_GetWindowField(LPTCP_CONNECTION Conn, U8 Flags) {
+    U32 Window = TCP_GetAdvertisedWindow(Conn);
+
+    if (Flags & TCP_FLAG_SYN) {
+        return (U16)((Window > 0xFFFFU) ? 0xFFFFU : Window);
+    }
+
+    return (U16)(Window >> Conn->RecvWindowScale);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Records the options the peer announced in its SYN.
+ *
+ * Window scaling and timestamps are only used when both ends announced
+ * them (RFC 7323), SACK likewise (RFC 2018).
+ *
+ * @param Conn Target TCP connection.
+ * @param Options Options of the SYN, or NULL.
+ */
+void TCP_NegotiateOptions(LPTCP_CONNECTION Conn, const TCP_OPTIONS* Options) {
+    Conn->SackPermitted = (Options != NULL && Options->SackPermitted);
+    Conn->WindowScaleEnabled = (Options != NULL && Options->HasWindowScale);
+    Conn->TimestampsEnabled = (Options != NULL && Options->HasTimestamp);
+
+    if (Conn->WindowScaleEnabled) {
+        Conn->SendWindowScale = (Options->WindowScale > TCP_MAX_WINDOW_SCALE) ? TCP_MAX_WINDOW_SCALE : Options->WindowScale;
+    } else {
+        Conn->SendWindowScale = 0;
+        Conn->RecvWindowScale = 0;
+    }
+
+    if (Conn->TimestampsEnabled) {
+        Conn->TimestampRecent = Options->TSVal;
+    }
+}
+
+/************************************************************************/
+
+/**
+ * @brief Returns the window scale needed to advertise the whole receive buffer.
+ * @param Capacity Receive buffer capacity.
+ * @return Shift count.
+ */
+U8 TCP_GetWindowScaleForCapacity(UINT Capacity) {
+    U8 Scale = 0;
+
+    while (Scale < TCP_MAX_WINDOW_SCALE && ((U32)Capacity >> Scale) > 0xFFFFU) {
+        Scale++;
     }
 
-    return 0;
+    return Scale;
 }
 
 /************************************************************************/
 
-static int TCP_SendPacket(LPTCP_CONNECTION Conn, U8 Flags, const U8* Payload, U32 PayloadLength) {
+/**
+ * @brief Builds and sends one segment without touching the send state.
+ * @param Conn Target TCP connection.
+ * @param Sequence Sequence number of the segment.
+ * @param Flags Segment flags.
+ * @param Payload Payload pointer.
+ * @param PayloadLength Payload length.
+ * @return IPv4 send result, negative on failure.
+ */
+static int TCP_TransmitSegment(LPTCP_CONNECTION Conn, U32 Sequence, U8 Flags, const U8* Payload, U32 PayloadLength) {
     TCP_HEADER Header;
-    U8 Options[4] = {0}; // MSS option: 4 bytes
+    U8 Options[40] = {0}; // MSS, window scale, SACK permitted and timestamps on SYN, timestamps and SACK otherwise
     U32 OptionsLength = 0;
 
-    // Add MSS option for SYN packets
+    // Options of a SYN are offered on an active open and accepted on a passive one
+    BOOL Offer = ((Flags & TCP_FLAG_ACK) == 0);
+
     if (Flags & TCP_FLAG_SYN) {
         Options[0] = 2;    // MSS option type
         Options[1] = 4;    // MSS option length
         Options[2] = 0x05; // MSS = 1460 (0x05B4) in network byte order
         Options[3] = 0xB4;
         OptionsLength = 4;
+
+        if (Offer || Conn->WindowScaleEnabled) {
+            Options[OptionsLength + 0] = 1;    // NOP
+            Options[OptionsLength + 1] = 3;    // Window scale option type
+            Options[OptionsLength + 2] = 3;    // Window scale option length
+            Options[OptionsLength + 3] = Conn->RecvWindowScale;
+            OptionsLength += 4;
+        }
+
+        if (Offer || Conn->SackPermitted) {
+            Options[OptionsLength + 0] = 1;    // NOP
+            Options[OptionsLength + 1] = 1;    // NOP
+            Options[OptionsLength + 2] = 4;    // SACK permitted option type
+            Options[OptionsLength + 3] = 2;    // SACK permitted option length
+            OptionsLength += 4;
+        }
+    }
+
+    if ((Flags & TCP_FLAG_SYN) ? (Offer || Conn->TimestampsEnabled) : Conn->TimestampsEnabled) {
+        U32 Value = Htonl((U32)GetSystemTime());
+        U32 Echo = Htonl(Conn->TimestampRecent);
+
+        Options[OptionsLength + 0] = 1;    // NOP
+        Options[OptionsLength + 1] = 1;    // NOP
+        Options[OptionsLength + 2] = 8;    // Timestamp option type
+        Options[OptionsLength + 3] = 10;   // Timestamp option length
+        MemoryCopy(Options + OptionsLength + 4, &Value, sizeof(U32));
+        MemoryCopy(Options + OptionsLength + 8, &Echo, sizeof(U32));
+        OptionsLength += 12;
+    }
+
+    if ((Flags & (TCP_FLAG_SYN | TCP_FLAG_ACK)) == TCP_FLAG_ACK && Conn->SackPermitted && Conn->RecvRangeCount > 0) {
+        U32 MaxBlocks = Conn->TimestampsEnabled ? (TCP_MAX_SACK_BLOCKS - 1) : TCP_MAX_SACK_BLOCKS;
+
+        // A segment that fits the MTU must still fit it with the blocks, TSO segments are cut to fit
+        if (PayloadLength <= TCP_MAX_RETRANSMIT_PAYLOAD - OptionsLength) {
+            while (MaxBlocks > 0 &&
+                   OptionsLength + TCP_SACK_OPTION_SPACE(MaxBlocks) + PayloadLength > TCP_MAX_RETRANSMIT_PAYLOAD) {
+                MaxBlocks--;
+            }
+        }
+
+        if (MaxBlocks > 0) {
+            OptionsLength += TCP_BuildSackOption(Conn, Options + OptionsLength, MaxBlocks);
+        }
     }
 
     U32 HeaderLength = sizeof(TCP_HEADER) + OptionsLength;
     U32 TotalLength = HeaderLength + PayloadLength;
-    U8 Packet[TotalLength];
+    U8 StackPacket[sizeof(TCP_HEADER) + sizeof(Options) + TCP_MAX_RETRANSMIT_PAYLOAD];
+    U8* Packet = StackPacket;
+
+    // Only TSO segments outgrow the MTU, they are built on the heap
+    if (TotalLength > sizeof(StackPacket)) {
+        Packet = (U8*)KernelHeapAlloc(TotalLength);
+        if (Packet == NULL) {
+            return -1;
+        }
+    }
 
     // Fill TCP header (ports already in network byte order)
     Header.SourcePort = Conn->LocalPort;
     Header.DestinationPort = Conn->RemotePort;
-    Header.SequenceNumber = Htonl(Conn->SendNext);
+    Header.SequenceNumber = Htonl(Sequence);
     Header.AckNumber = Htonl(Conn->RecvNext);
     Header.DataOffset = ((HeaderLength / 4) << 4); // Data offset in 4-byte words, shifted to upper nibble
     Header.Flags = Flags;
     // Always calculate window based on actual TCP buffer space, not cached value
-    UINT AvailableSpace = (Conn->RecvBufferCapacity > Conn->RecvBufferUsed)
-                          ? (Conn->RecvBufferCapacity - Conn->RecvBufferUsed)
-                          : 0;
-    U16 ActualWindow = (AvailableSpace > 0xFFFFU) ? 0xFFFFU : (U16)AvailableSpace;
-    Header.WindowSize = Htons(ActualWindow);
-    Conn->LastAdvertisedWindow = ActualWindow;
+    U16 WindowField = TCP_GetWindowField(Conn, Flags);
+    Header.WindowSize = Htons(WindowField);
+    Conn->LastAdvertisedWindow = (Flags & TCP_FLAG_SYN) ? (U32)WindowField : ((U32)WindowField << Conn->RecvWindowScale);
     Header.UrgentPointer = 0;
     Header.Checksum = 0;
 
@@ -631,39 +1445,55 @@ static int TCP_SendPacket(LPTCP_CONNECTION Conn, U8 Flags, const U8* Payload, U3
         MemoryCopy(Packet + HeaderLength, Payload, PayloadLength);
     }
 
-    // Calculate checksum
-    ((LPTCP_HEADER)Packet)->Checksum = TCP_CalculateChecksum((LPTCP_HEADER)Packet,
-        Payload, PayloadLength, Conn->LocalIP, Conn->RemoteIP);
-
-    // Debug: Show the actual TCP header being sent (convert from network to host order for display)
-    LPTCP_HEADER TcpHdr = (LPTCP_HEADER)Packet;
-    UNUSED(TcpHdr);
-
-
     // Send via IPv4 through connection's network device
     I32 SendResult = 0;
-    U32 SequenceStart = Conn->SendNext;
-    U32 SequenceLength = TCP_GetSegmentSequenceLength(Flags, PayloadLength);
     LPDEVICE Device = Conn->Device;
 
     if (Device == NULL) {
+        if (Packet != StackPacket) KernelHeapFree(Packet);
         return 0;
     }
 
+    // IPv4 seeds the checksum field when the NIC inserts the checksum
+    if ((IPv4_GetDeviceCaps(Device) & NETWORK_CAP_TX_CHECKSUM) == 0) {
+        ((LPTCP_HEADER)Packet)->Checksum = TCP_CalculateChecksum((LPTCP_HEADER)Packet,
+            Payload, PayloadLength, Conn->LocalIP, Conn->RemoteIP);
+    }
+
     LockMutex(&(Device->Mutex), INFINITY);
     SendResult = IPv4_Send(Device, Conn->RemoteIP, IPV4_PROTOCOL_TCP, Packet, HeaderLength + PayloadLength);
     UnlockMutex(&(Device->Mutex));
 
+    if (Packet != StackPacket) KernelHeapFree(Packet);
+
+    // Every segment carries the ACK, nothing is left to delay
+    if (SendResult >= 0 && (Flags & TCP_FLAG_ACK) != 0) {
+        Conn->AckPendingSegments = 0;
+        Conn->DelayedAckTimer = 0;
+    }
+
+    return SendResult;
+}
+
+/************************************************************************/
+
+static int TCP_SendPacket(LPTCP_CONNECTION Conn, U8 Flags, const U8* Payload, U32 PayloadLength) {
+    U32 SequenceStart = Conn->SendNext;
+    U32 SequenceLength = TCP_GetSegmentSequenceLength(Flags, PayloadLength);
+
+    if (Conn->Device == NULL) {
+        return 0;
+    }
+
+    I32 SendResult = TCP_TransmitSegment(Conn, SequenceStart, Flags, Payload, PayloadLength);
+
     if (SendResult < 0) {
         return SendResult;
     }
 
     // Track retransmission only for sequence-bearing segments
     if (TCP_ShouldTrackRetransmission(Flags, PayloadLength)) {
-        TCP_StartTrackedRetransmission(Conn, Flags, Payload, PayloadLength, SequenceStart);
-        if (Conn->SendUnacked == 0 || Conn->SendUnacked > SequenceStart) {
-            Conn->SendUnacked = SequenceStart;
-        }
+        TCP_QueueSegment(Conn, Flags, PayloadLength, SequenceStart);
     }
 
     // Update sequence number if data was sent
@@ -685,13 +1515,22 @@ static void TCP_OnEnterClosed(STATE_MACHINE* SM) {
     Conn->DuplicateAckCount = 0;
     Conn->TimeWaitTimer = 0;
     Conn->InFastRecovery = FALSE;
+    Conn->RecvRangeCount = 0;
+    Conn->FinReceived = FALSE;
+    Conn->AckPendingSegments = 0;
+    Conn->DelayedAckTimer = 0;
 
     // Note: We don't need to unregister from global IPv4 notifications
     // as the callback will check the connection state
 }
 
 static void TCP_OnEnterListen(STATE_MACHINE* SM) {
-    (void)SM;
+    LPTCP_CONNECTION Conn = (LPTCP_CONNECTION)SM_GetContext(SM);
+
+    // A child back from SYN_RECEIVED failed its handshake, TCP_Update frees it
+    if (Conn->Listener != NULL && SM->PreviousState == TCP_STATE_SYN_RECEIVED) {
+        TCP_DemuxRemove(&GlobalTCP.Demux, &Conn->Demux);
+    }
 }
 
 static void TCP_OnEnterSynSent(STATE_MACHINE* SM) {
@@ -710,6 +1549,15 @@ static void TCP_OnEnterEstablished(STATE_MACHINE* SM) {
     if (Conn->NotificationContext != NULL && SM->PreviousState != TCP_STATE_ESTABLISHED) {
         Notification_Send(Conn->NotificationContext, NOTIF_EVENT_TCP_CONNECTED, NULL, 0);
     }
+
+    // Passive open: queue the child on the socket of its listener
+    LPTCP_CONNECTION Listener = (LPTCP_CONNECTION)Conn->Listener;
+    SAFE_USE_VALID_ID(Listener, KOID_TCP) {
+        if (SocketTCPAcceptCallback(Listener, Conn)) {
+            if (Listener->HalfOpenCount > 0) Listener->HalfOpenCount--;
+            Conn->Listener = NULL;
+        }
+    }
 }
 
 static void TCP_OnEnterFinWait1(STATE_MACHINE* SM) {
@@ -747,6 +1595,12 @@ static void TCP_ActionSendSyn(STATE_MACHINE* SM, LPVOID EventData) {
 
     Conn->SendNext = 1000; // Initial sequence number
     Conn->SendUnacked = Conn->SendNext;
+    Conn->SackPermitted = FALSE;
+    Conn->WindowScaleEnabled = FALSE;
+    Conn->TimestampsEnabled = FALSE;
+    Conn->TimestampRecent = 0;
+    Conn->SendWindowScale = 0;
+    Conn->RecvWindowScale = TCP_GetWindowScaleForCapacity(Conn->RecvBufferCapacity);
     Conn->LastAckNumber = Conn->SendUnacked;
     Conn->RetransmitCount = 0;
     Conn->DuplicateAckCount = 0;
@@ -764,7 +1618,11 @@ static void TCP_ActionSendSynAck(STATE_MACHINE* SM, LPVOID EventData) {
     LPTCP_PACKET_EVENT Event = (LPTCP_PACKET_EVENT)EventData;
 
     Conn->SendNext = 2000; // Initial sequence number
+    Conn->SendUnacked = Conn->SendNext;
+    Conn->LastAckNumber = Conn->SendUnacked;
     Conn->RecvNext = Ntohl(Event->Header->SequenceNumber) + 1;
+    Conn->RecvWindowScale = TCP_GetWindowScaleForCapacity(Conn->RecvBufferCapacity);
+    TCP_NegotiateOptions(Conn, Event->Options);
 
     int SendResult = TCP_SendPacket(Conn, TCP_FLAG_SYN | TCP_FLAG_ACK, NULL, 0);
     if (SendResult < 0) {
@@ -803,7 +1661,10 @@ static void TCP_ActionSendFin(STATE_MACHINE* SM, LPVOID EventData) {
     (void)EventData;
     LPTCP_CONNECTION Conn = (LPTCP_CONNECTION)SM_GetContext(SM);
 
-    int SendResult = TCP_SendPacket(Conn, TCP_FLAG_FIN | TCP_FLAG_ACK, NULL, 0);
+    // The FIN follows the queued data, it leaves once all of it is sent
+    Conn->FinPending = TRUE;
+
+    int SendResult = TCP_TransmitQueuedData(Conn);
     if (SendResult < 0) {
         ERROR(TEXT("[TCP_ActionSendFin] Failed to send FIN packet"));
         SM_ProcessEvent(SM, TCP_EVENT_RCV_RST, NULL);
@@ -812,6 +1673,27 @@ static void TCP_ActionSendFin(STATE_MACHINE* SM, LPVOID EventData) {
 
 /************************************************************************/
 
+/**
+ * @brief Acknowledges the FIN of the peer.
+ *
+ * Runs once RecvNext reached the recorded FinSequence, so every byte sent
+ * before the FIN was received.
+ */
+static void TCP_ActionReceiveFin(STATE_MACHINE* SM, LPVOID EventData) {
+    (void)EventData;
+    LPTCP_CONNECTION Conn = (LPTCP_CONNECTION)SM_GetContext(SM);
+
+    Conn->RecvNext = Conn->FinSequence + 1;
+
+    int SendResult = TCP_SendPacket(Conn, TCP_FLAG_ACK, NULL, 0);
+    if (SendResult < 0) {
+        ERROR(TEXT("[TCP_ActionReceiveFin] Failed to send ACK packet"));
+        SM_ProcessEvent(SM, TCP_EVENT_RCV_RST, NULL);
+    }
+}
+
+/************************************************************************/
+
 /*
 static void TCP_ActionSendRst(STATE_MACHINE* SM, LPVOID EventData) {
     (void)EventData;
@@ -836,9 +1718,10 @@ static void TCP_ActionProcessData(STATE_MACHINE* SM, LPVOID EventData) {
     U32 BytesAccepted = 0;
     const U8* PayloadPtr = Event->Payload;
     U32 PayloadLength = Event->PayloadLength;
+    BOOL HadHole = (Conn->RecvRangeCount > 0);
 
     if (PayloadLength > 0 && PayloadPtr) {
-        if (SeqNum < Conn->RecvNext) {
+        if (TCP_SequenceBefore(SeqNum, Conn->RecvNext)) {
             U32 AlreadyAcked = Conn->RecvNext - SeqNum;
             if (AlreadyAcked >= PayloadLength) {
 
@@ -855,7 +1738,9 @@ static void TCP_ActionProcessData(STATE_MACHINE* SM, LPVOID EventData) {
             PayloadLength -= AlreadyAcked;
         }
 
-        if (SeqNum > Conn->RecvNext) {
+        if (TCP_SequenceBefore(Conn->RecvNext, SeqNum)) {
+            // Keep it for reassembly, the duplicate ACK carries the SACK blocks
+            TCP_StoreOutOfOrder(Conn, SeqNum, PayloadPtr, PayloadLength);
 
             int SendResult = TCP_SendPacket(Conn, TCP_FLAG_ACK, NULL, 0);
             if (SendResult < 0) {
@@ -866,7 +1751,7 @@ static void TCP_ActionProcessData(STATE_MACHINE* SM, LPVOID EventData) {
         }
 
 
-        if (Conn->RecvBufferUsed >= Conn->RecvBufferCapacity) {
+        if (TCP_GetReceiveSpace(Conn) == 0) {
             WARNING(TEXT("[TCP_ActionProcessData] Receive buffer full, advertising zero window"));
 
             int SendResult = TCP_SendPacket(Conn, TCP_FLAG_ACK, NULL, 0);
@@ -877,19 +1762,7 @@ static void TCP_ActionProcessData(STATE_MACHINE* SM, LPVOID EventData) {
             return;
         }
 
-        UINT SpaceAvailable = (Conn->RecvBufferCapacity > Conn->RecvBufferUsed)
-                              ? (Conn->RecvBufferCapacity - Conn->RecvBufferUsed)
-                              : 0;
-        U32 CopyLength = (PayloadLength > (U32)SpaceAvailable) ? (U32)SpaceAvailable : PayloadLength;
-
-        if (CopyLength > 0) {
-            BytesAccepted = SocketTCPReceiveCallback(Conn, PayloadPtr, CopyLength);
-
-            if (BytesAccepted > 0) {
-                MemoryCopy(Conn->RecvBuffer + Conn->RecvBufferUsed, PayloadPtr, BytesAccepted);
-                Conn->RecvBufferUsed += BytesAccepted;
-            }
-        }
+        BytesAccepted = TCP_DeliverData(Conn, PayloadPtr, PayloadLength);
 
         if (BytesAccepted == 0) {
         }
@@ -897,21 +1770,47 @@ static void TCP_ActionProcessData(STATE_MACHINE* SM, LPVOID EventData) {
 
     if (BytesAccepted > 0) {
         U32 Candidate = SeqNum + BytesAccepted;
-        if (Candidate > AckTarget) {
+        if (TCP_SequenceBefore(AckTarget, Candidate)) {
             AckTarget = Candidate;
         }
+
+        // The hole may be filled, append what was waiting behind it
+        if (BytesAccepted == PayloadLength && Conn->RecvRangeCount > 0) {
+            AckTarget = TCP_DeliverOutOfOrder(Conn, AckTarget);
+        }
     }
 
-    if ((Flags & (TCP_FLAG_SYN | TCP_FLAG_FIN)) != 0) {
+    // The FIN is counted by TCP_ActionReceiveFin
+    if ((Flags & TCP_FLAG_SYN) != 0) {
         if (PayloadLength == 0 || BytesAccepted == PayloadLength) {
             AckTarget++;
         }
     }
 
-    if (AckTarget > Conn->RecvNext) {
+    if (TCP_SequenceBefore(Conn->RecvNext, AckTarget)) {
         Conn->RecvNext = AckTarget;
     }
 
+    // The FIN is now in order, its ACK covers this data too
+    if (Conn->FinReceived && Conn->RecvNext == Conn->FinSequence) {
+        return;
+    }
+
+    // Delayed ACK: one ACK every TCP_DELAYED_ACK_SEGMENTS segments or after
+    // TCP_DELAYED_ACK_TIMEOUT, but at once around holes, refused data and SYN/FIN
+    Conn->AckPendingSegments++;
+
+    BOOL AckNow = (HadHole || Conn->RecvRangeCount > 0 || BytesAccepted < PayloadLength ||
+                   (Flags & (TCP_FLAG_SYN | TCP_FLAG_FIN)) != 0 ||
+                   Conn->AckPendingSegments >= TCP_DELAYED_ACK_SEGMENTS);
+
+    if (AckNow == FALSE) {
+        if (Conn->DelayedAckTimer == 0) {
+            Conn->DelayedAckTimer = GetSystemTime() + TCP_DELAYED_ACK_TIMEOUT;
+        }
+        return;
+    }
+
     int SendResult = TCP_SendPacket(Conn, TCP_FLAG_ACK, NULL, 0);
     if (SendResult < 0) {
         ERROR(TEXT("[TCP_ActionProcessData] Failed to send ACK packet"));
@@ -948,10 +1847,8 @@ static void TCP_IPv4PacketSentCallback(LPNOTIFICATION_DATA NotificationData, LPV
 
     // Check if this packet is for our connection
     if (PacketData->DestinationIP == Conn->RemoteIP && PacketData->Protocol == IPV4_PROTOCOL_TCP) {
-        if (Conn->RetransmitPending) {
-            U32 Now = GetSystemTime();
-            Conn->RetransmitTimestamp = Now;
-            Conn->RetransmitTimer = Now + Conn->RetransmitCurrentTimeout;
+        if (Conn->SegmentCount > 0) {
+            Conn->RetransmitTimer = GetSystemTime() + Conn->RetransmitCurrentTimeout;
         }
     }
 }
@@ -959,7 +1856,7 @@ static void TCP_IPv4PacketSentCallback(LPNOTIFICATION_DATA NotificationData, LPV
 /************************************************************************/
 // Helper function to validate sequence numbers within receive window
 
-static BOOL TCP_IsSequenceInWindow(U32 SequenceNumber, U32 WindowStart, U16 WindowSize) {
+static BOOL TCP_IsSequenceInWindow(U32 SequenceNumber, U32 WindowStart, U32 WindowSize) {
     // Handle sequence number wrap-around by using modular arithmetic
     U32 WindowEnd = WindowStart + WindowSize;
 
@@ -1011,6 +1908,12 @@ static BOOL TCP_ConditionValidAck(STATE_MACHINE* SM, LPVOID EventData) {
 
     if (Valid) {
         TCP_HandleAcknowledgement(Conn, Event);
+
+        // Leaving these states requires the FIN itself to be acknowledged
+        SM_STATE State = SM_GetCurrentState(&Conn->StateMachine);
+        if (State == TCP_STATE_FIN_WAIT_1 || State == TCP_STATE_CLOSING || State == TCP_STATE_LAST_ACK) {
+            Valid = (Conn->FinPending == FALSE && Conn->SegmentCount == 0);
+        }
     }
 
     return Valid;
@@ -1048,16 +1951,6 @@ static BOOL TCP_ConditionValidSyn(STATE_MACHINE* SM, LPVOID EventData) {
 /************************************************************************/
 // TCP Options parsing
 
-typedef struct tag_TCP_OPTIONS {
-    BOOL HasMSS;
-    U16 MSS;
-    BOOL HasWindowScale;
-    U8 WindowScale;
-    BOOL HasTimestamp;
-    U32 TSVal;
-    U32 TSEcr;
-} TCP_OPTIONS, *LPTCP_OPTIONS;
-
 static void TCP_ParseOptions(const U8* OptionsData, U32 OptionsLength, LPTCP_OPTIONS ParsedOptions) {
     MemorySet(ParsedOptions, 0, sizeof(TCP_OPTIONS));
 
@@ -1101,6 +1994,28 @@ static void TCP_ParseOptions(const U8* OptionsData, U32 OptionsLength, LPTCP_OPT
                 }
                 break;
 
+            case 4: // SACK permitted
+                if (OptionLength == 2) {
+                    ParsedOptions->SackPermitted = TRUE;
+                }
+                break;
+
+            case 5: // SACK blocks
+                if (OptionLength >= 10 && ((OptionLength - 2) % 8) == 0) {
+                    U32 Block;
+                    U32 BlockCount = (U32)(OptionLength - 2) / 8;
+
+                    for (Block = 0; Block < BlockCount && ParsedOptions->SackCount < TCP_MAX_SACK_BLOCKS; Block++) {
+                        const U8* Edge = OptionsData + Offset + 2 + (Block * 8);
+                        ParsedOptions->SackStart[ParsedOptions->SackCount] =
+                            ((U32)Edge[0] << 24) | ((U32)Edge[1] << 16) | ((U32)Edge[2] << 8) | Edge[3];
+                        ParsedOptions->SackEnd[ParsedOptions->SackCount] =
+                            ((U32)Edge[4] << 24) | ((U32)Edge[5] << 16) | ((U32)Edge[6] << 8) | Edge[7];
+                        ParsedOptions->SackCount++;
+                    }
+                }
+                break;
+
             case 8: // Timestamp
                 if (OptionLength == 10 && Offset + 10 <= OptionsLength) {
                     ParsedOptions->HasTimestamp = TRUE;
@@ -1218,6 +2133,24 @@ static void TCP_SendRstToUnknownConnection(LPDEVICE Device, U32 LocalIP, U16 Loc
 
 /************************************************************************/
 
+/**
+ * @brief Frees the receive and reorder buffers of a connection.
+ * @param Conn Target TCP connection.
+ */
+static void TCP_FreeReceiveBuffers(LPTCP_CONNECTION Conn) {
+    SAFE_USE(Conn->RecvBufferData) {
+        KernelHeapFree(Conn->RecvBufferData);
+        Conn->RecvBufferData = NULL;
+    }
+
+    SAFE_USE(Conn->ReorderBuffer) {
+        KernelHeapFree(Conn->ReorderBuffer);
+        Conn->ReorderBuffer = NULL;
+    }
+}
+
+/************************************************************************/
+
 // Public API implementation
 
 void TCP_Initialize(void) {
@@ -1228,7 +2161,12 @@ void TCP_Initialize(void) {
                                                           TCP_SEND_BUFFER_SIZE);
     GlobalTCP.ReceiveBufferSize = TCP_GetConfiguredBufferSize(TEXT(CONFIG_TCP_RECEIVE_BUFFER_SIZE),
                                                              TCP_RECV_BUFFER_SIZE,
-                                                             TCP_RECV_BUFFER_SIZE);
+                                                             TCP_RECV_BUFFER_MAX_SIZE);
+
+    // The reorder buffer is indexed by sequence number, keep it a power of two
+    while ((GlobalTCP.ReceiveBufferSize & (GlobalTCP.ReceiveBufferSize - 1)) != 0) {
+        GlobalTCP.ReceiveBufferSize &= GlobalTCP.ReceiveBufferSize - 1;
+    }
 
 
     // TCP protocol handler will be registered later when devices are initialized
@@ -1270,15 +2208,25 @@ LPTCP_CONNECTION TCP_CreateConnection(LPDEVICE Device, U32 LocalIP, U16 LocalPor
     Conn->RemotePort = RemotePort; // RemotePort should already be in network byte order from socket layer
     Conn->SendBufferCapacity = GlobalTCP.SendBufferSize;
     Conn->RecvBufferCapacity = GlobalTCP.ReceiveBufferSize;
-    Conn->SendWindow = (Conn->SendBufferCapacity > 0xFFFFU) ? 0xFFFFU : (U16)Conn->SendBufferCapacity;
-    Conn->RecvWindow = (Conn->RecvBufferCapacity > 0xFFFFU) ? 0xFFFFU : (U16)Conn->RecvBufferCapacity;
+    Conn->RecvBufferData = (U8*)KernelHeapAlloc(Conn->RecvBufferCapacity);
+    Conn->ReorderBuffer = (U8*)KernelHeapAlloc(Conn->RecvBufferCapacity);
+    if (Conn->RecvBufferData == NULL || Conn->ReorderBuffer == NULL) {
+        ERROR(TEXT("[TCP_CreateConnection] Failed to allocate %u byte receive buffers"), Conn->RecvBufferCapacity);
+        TCP_FreeReceiveBuffers(Conn);
+        KernelHeapFree(Conn);
+        return NULL;
+    }
+    CircularBuffer_Initialize(&(Conn->RecvBuffer), Conn->RecvBufferData, Conn->RecvBufferCapacity, Conn->RecvBufferCapacity);
+    Conn->SendWindow = (Conn->SendBufferCapacity > 0xFFFFU) ? 0xFFFFU : (U32)Conn->SendBufferCapacity;
+    Conn->RecvWindow = (U32)Conn->RecvBufferCapacity;
+    Conn->RecvWindowScale = TCP_GetWindowScaleForCapacity(Conn->RecvBufferCapacity);
     Conn->LastAdvertisedWindow = Conn->RecvWindow;
     Conn->RetransmitTimer = 0;
     Conn->RetransmitCount = 0;
     Conn->RetransmitBaseTimeout = TCP_RETRANSMIT_TIMEOUT;
     Conn->RetransmitCurrentTimeout = TCP_RETRANSMIT_TIMEOUT;
-    Conn->RetransmitPending = FALSE;
-    Conn->RetransmitWasRetried = FALSE;
+    Conn->SegmentCount = 0;
+    Conn->FinPending = FALSE;
     Conn->DuplicateAckCount = 0;
     Conn->LastAckNumber = 0;
     Conn->InFastRecovery = FALSE;
@@ -1293,6 +2241,7 @@ LPTCP_CONNECTION TCP_CreateConnection(LPDEVICE Device, U32 LocalIP, U16 LocalPor
     Conn->NotificationContext = Notification_CreateContext();
     if (Conn->NotificationContext == NULL) {
         ERROR(TEXT("[TCP_CreateConnection] Failed to create notification context"));
+        TCP_FreeReceiveBuffers(Conn);
         KernelHeapFree(Conn);
         return NULL;
     }
@@ -1315,6 +2264,8 @@ LPTCP_CONNECTION TCP_CreateConnection(LPDEVICE Device, U32 LocalIP, U16 LocalPor
         ListAddTail(ConnectionList, Conn);
     }
 
+    TCP_Rehash(Conn);
+
     // Convert to host byte order for debug display
     U32 LocalIPHost = Ntohl(LocalIP);
     U32 RemoteIPHost = Ntohl(RemoteIP);
@@ -1328,6 +2279,25 @@ LPTCP_CONNECTION TCP_CreateConnection(LPDEVICE Device, U32 LocalIP, U16 LocalPor
 
 void TCP_DestroyConnection(LPTCP_CONNECTION Connection) {
     SAFE_USE_VALID_ID(Connection, KOID_TCP) {
+        LPTCP_CONNECTION Listener = (LPTCP_CONNECTION)Connection->Listener;
+
+        // A child gives its slot back to its listener, a listener takes its children along
+        SAFE_USE_VALID_ID(Listener, KOID_TCP) {
+            if (Listener->HalfOpenCount > 0) Listener->HalfOpenCount--;
+        }
+        Connection->Listener = NULL;
+
+        if (Connection->HalfOpenCount > 0) {
+            LPLIST ChildList = GetTCPConnectionList();
+            LPTCP_CONNECTION Child = (LPTCP_CONNECTION)(ChildList != NULL ? ChildList->First : NULL);
+
+            while (Child != NULL) {
+                LPTCP_CONNECTION NextChild = (LPTCP_CONNECTION)Child->Next;
+                if (Child->Listener == Connection) TCP_DestroyConnection(Child);
+                Child = NextChild;
+            }
+        }
+
         SM_Destroy(&Connection->StateMachine);
 
         // Destroy notification context
@@ -1336,14 +2306,16 @@ void TCP_DestroyConnection(LPTCP_CONNECTION Connection) {
             Connection->NotificationContext = NULL;
         }
 
-        // Remove from connections list
+        // Remove from connections list and lookup tables
         LPLIST ConnectionList = GetTCPConnectionList();
         ListRemove(ConnectionList, Connection);
+        TCP_DemuxRemove(&GlobalTCP.Demux, &Connection->Demux);
 
         // Mark ID
         Connection->TypeID = KOID_NONE;
 
         // Free the connection memory
+        TCP_FreeReceiveBuffers(Connection);
         KernelHeapFree(Connection);
 
     }
@@ -1377,47 +2349,60 @@ int TCP_Send(LPTCP_CONNECTION Connection, const U8* Data, U32 Length) {
             return -1;
         }
 
-        UINT Capacity = Connection->SendBufferCapacity;
-        U32 MaxChunk = TCP_MAX_RETRANSMIT_PAYLOAD;
-        if (Capacity > 0 && Capacity < MaxChunk) {
-            MaxChunk = (U32)Capacity;
-        }
-        if (MaxChunk == 0) {
-            MaxChunk = TCP_MAX_RETRANSMIT_PAYLOAD;
+        UINT Space = (Connection->SendBufferCapacity > Connection->SendBufferUsed)
+                     ? (Connection->SendBufferCapacity - Connection->SendBufferUsed)
+                     : 0;
+        U32 Accepted = (Length > (U32)Space) ? (U32)Space : Length;
+
+        if (Accepted == 0) {
+            return 0;
         }
 
-        const U8* CurrentData = Data;
-        U32 Remaining = Length;
-        U32 TotalSent = 0;
+        // Queue the data, then send what the congestion and peer windows allow
+        MemoryCopy(Connection->SendBuffer + Connection->SendBufferUsed, Data, Accepted);
+        Connection->SendBufferUsed += Accepted;
 
-        while (Remaining > 0) {
-            U32 Allowed = TCP_GetAllowedSendBytes(Connection);
-            if (Allowed == 0) {
-                break;
-            }
+        if (TCP_TransmitQueuedData(Connection) < 0 && Connection->SegmentCount == 0) {
+            Connection->SendBufferUsed -= Accepted;
+            return -1;
+        }
 
-            U32 ChunkSize = (Remaining > MaxChunk) ? MaxChunk : Remaining;
-            if (ChunkSize > Allowed) {
-                ChunkSize = Allowed;
-            }
-            if (ChunkSize == 0) {
-                break;
-            }
+        return (I32)Accepted;
+    }
+    return -1;
+}
 
-            I32 SendResult = TCP_SendPacket(Connection, TCP_FLAG_PSH | TCP_FLAG_ACK, CurrentData, ChunkSize);
-            if (SendResult < 0) {
-                ERROR(TEXT("[TCP_Send] Failed to send %u bytes chunk"), ChunkSize);
-                return (TotalSent > 0) ? (I32)TotalSent : -1;
-            }
+/************************************************************************/
+
+/**
+ * @brief Enables or disables the Nagle algorithm.
+ *
+ * Disabling it sends the small segments held back so far.
+ *
+ * @param Connection Target TCP connection.
+ * @param NoDelay TRUE to send small segments at once.
+ */
+void TCP_SetNoDelay(LPTCP_CONNECTION Connection, BOOL NoDelay) {
+    SAFE_USE_VALID_ID(Connection, KOID_TCP) {
+        Connection->NoDelay = NoDelay;
 
-            CurrentData += ChunkSize;
-            Remaining -= ChunkSize;
-            TotalSent += ChunkSize;
+        if (NoDelay && SM_GetCurrentState(&Connection->StateMachine) != TCP_STATE_CLOSED) {
+            TCP_TransmitQueuedData(Connection);
         }
+    }
+}
+
+/************************************************************************/
 
-        return (I32)TotalSent;
+/**
+ * @brief Attach the socket that receives the data of a connection.
+ * @param Connection Target TCP connection.
+ * @param Owner Socket, or NULL to detach.
+ */
+void TCP_SetOwner(LPTCP_CONNECTION Connection, LPVOID Owner) {
+    SAFE_USE_VALID_ID(Connection, KOID_TCP) {
+        Connection->Owner = Owner;
     }
-    return -1;
 }
 
 /************************************************************************/
@@ -1426,26 +2411,127 @@ int TCP_Receive(LPTCP_CONNECTION Connection, U8* Buffer, U32 BufferSize) {
     if (!Buffer || BufferSize == 0) return -1;
 
     SAFE_USE_VALID_ID(Connection, KOID_TCP) {
-        if (Connection->RecvBufferUsed == 0) return 0;
+        U32 CopyLength = CircularBuffer_Read(&(Connection->RecvBuffer), Buffer, BufferSize);
+
+        TCP_HandleApplicationRead(Connection, CopyLength);
+
+        return CopyLength;
+    }
+    return -1;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Tell whether a connection may still receive data.
+ * @param Connection Target TCP connection.
+ * @return TRUE until the peer sent FIN or the connection closed.
+ */
+BOOL TCP_CanReceive(LPTCP_CONNECTION Connection) {
+    SM_STATE State = TCP_GetState(Connection);
+
+    return State == TCP_STATE_SYN_SENT || State == TCP_STATE_SYN_RECEIVED || State == TCP_STATE_ESTABLISHED ||
+           State == TCP_STATE_FIN_WAIT_1 || State == TCP_STATE_FIN_WAIT_2;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Tell whether a sleeping reader has something to return, SleepUntil condition.
+ * @param Context Target TCP connection.
+ * @return TRUE once data arrived or the connection can no longer receive.
+ */
+static BOOL TCP_ReceiveReady(LPVOID Context) {
+    LPTCP_CONNECTION Connection = (LPTCP_CONNECTION)Context;
 
-        UINT Used = Connection->RecvBufferUsed;
-        U32 CopyLength = (Used > BufferSize) ? BufferSize : (U32)Used;
-        MemoryCopy(Buffer, Connection->RecvBuffer, CopyLength);
+    return Connection->RecvRequest.Filled > 0 || CircularBuffer_GetAvailableData(&(Connection->RecvBuffer)) > 0 ||
+           TCP_CanReceive(Connection) == FALSE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Receive data, sleeping while the receive buffer is empty.
+ *
+ * While it sleeps the reader posts its buffer on the connection, so that
+ * segments arriving meanwhile are copied straight into it. Only buffers in
+ * kernel space are posted, the receive path does not run in the address
+ * space of the reader; other readers are woken and read the receive buffer.
+ *
+ * @param Connection Target TCP connection.
+ * @param Buffer Destination buffer.
+ * @param BufferSize Size of Buffer.
+ * @param TimeOut Longest sleep in milliseconds, or INFINITY.
+ * @return Bytes received, 0 on time out or end of stream, -1 on error.
+ */
+int TCP_WaitReceive(LPTCP_CONNECTION Connection, U8* Buffer, U32 BufferSize, U32 TimeOut) {
+    if (!Buffer || BufferSize == 0) return -1;
+
+    SAFE_USE_VALID_ID(Connection, KOID_TCP) {
+        LPTCP_RECV_REQUEST Request = &(Connection->RecvRequest);
+        U32 Filled;
+        U32 Flags;
 
-        // Move remaining data to beginning of buffer
-        if (CopyLength < Used) {
-            MemoryMove(Connection->RecvBuffer, Connection->RecvBuffer + CopyLength, (U32)(Used - CopyLength));
+        if (CircularBuffer_GetAvailableData(&(Connection->RecvBuffer)) > 0 || Request->Waiter != NULL) {
+            return TCP_Receive(Connection, Buffer, BufferSize);
         }
 
-        TCP_HandleApplicationRead(Connection, CopyLength);
+        SaveFlags(&Flags);
+        DisableInterrupts();
+        Request->Buffer = ((LINEAR)Buffer >= VMA_KERNEL) ? Buffer : NULL;
+        Request->Length = BufferSize;
+        Request->Filled = 0;
+        Request->Waiter = GetCurrentTask();
+        RestoreFlags(&Flags);
 
-        return CopyLength;
+        // The receive path and state changes wake the reader
+        SleepUntil(TCP_ReceiveReady, Connection, TimeOut);
+
+        SaveFlags(&Flags);
+        DisableInterrupts();
+        Filled = Request->Filled;
+        MemorySet(Request, 0, sizeof(TCP_RECV_REQUEST));
+        RestoreFlags(&Flags);
+
+        if (Filled > 0) return (int)Filled;
+
+        return TCP_Receive(Connection, Buffer, BufferSize);
     }
     return -1;
 }
 
 /************************************************************************/
 
+/**
+ * @brief Get the number of bytes waiting in the receive buffer.
+ * @param Connection Target TCP connection.
+ * @return Readable bytes.
+ */
+U32 TCP_GetReceiveAvailable(LPTCP_CONNECTION Connection) {
+    SAFE_USE_VALID_ID(Connection, KOID_TCP) {
+        return CircularBuffer_GetAvailableData(&(Connection->RecvBuffer));
+    }
+    return 0;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Get the number of bytes the send buffer may still take.
+ * @param Connection Target TCP connection.
+ * @return Free bytes of the send buffer.
+ */
+U32 TCP_GetSendSpace(LPTCP_CONNECTION Connection) {
+    SAFE_USE_VALID_ID(Connection, KOID_TCP) {
+        return (Connection->SendBufferCapacity > Connection->SendBufferUsed)
+                   ? (U32)(Connection->SendBufferCapacity - Connection->SendBufferUsed)
+                   : 0;
+    }
+    return 0;
+}
+
+/************************************************************************/
+
 int TCP_Close(LPTCP_CONNECTION Connection) {
     SAFE_USE_VALID_ID(Connection, KOID_TCP) {
         BOOL result = SM_ProcessEvent(&Connection->StateMachine, TCP_EVENT_CLOSE, NULL);
@@ -1466,7 +2552,49 @@ SM_STATE TCP_GetState(LPTCP_CONNECTION Connection) {
 
 /************************************************************************/
 
-void TCP_OnIPv4Packet(const U8* Payload, U32 PayloadLength, U32 SourceIP, U32 DestinationIP) {
+/**
+ * @brief Create the connection that answers a SYN received by a listener.
+ *
+ * The listener keeps listening. The child goes through the handshake on
+ * its own and is handed to the socket of the listener once established.
+ *
+ * @param Listener Listening connection.
+ * @param LocalIP Destination address of the SYN.
+ * @param LocalPort Destination port of the SYN, network byte order.
+ * @param RemoteIP Source address of the SYN.
+ * @param RemotePort Source port of the SYN, network byte order.
+ * @return Child in LISTEN state, or NULL when the listener is full.
+ */
+static LPTCP_CONNECTION TCP_CreateChild(LPTCP_CONNECTION Listener, U32 LocalIP, U16 LocalPort, U32 RemoteIP,
+                                        U16 RemotePort) {
+    LPTCP_CONNECTION Child;
+
+    if (Listener->HalfOpenCount >= TCP_LISTEN_MAX_HALF_OPEN) {
+        WARNING(TEXT("[TCP_CreateChild] Listener %p full, SYN dropped"), (LPVOID)Listener);
+        return NULL;
+    }
+
+    Child = TCP_CreateConnection(Listener->Device, LocalIP, LocalPort, RemoteIP, RemotePort);
+    if (Child == NULL) {
+        ERROR(TEXT("[TCP_CreateChild] Failed to create connection"));
+        return NULL;
+    }
+
+    Child->Listener = Listener;
+    Child->NoDelay = Listener->NoDelay;
+    Listener->HalfOpenCount++;
+
+    if (TCP_Listen(Child) != 0) {
+        TCP_DestroyConnection(Child);
+        return NULL;
+    }
+
+    return Child;
+}
+
+/************************************************************************/
+
+void TCP_OnIPv4Packet(const U8* Payload, U32 PayloadLength, U32 SourceIP, U32 DestinationIP, U32 Flags) {
     if (PayloadLength < sizeof(TCP_HEADER)) {
         return;
     }
@@ -1493,25 +2621,18 @@ void TCP_OnIPv4Packet(const U8* Payload, U32 PayloadLength, U32 SourceIP, U32 De
     }
 
 
-    // Validate checksum
-    if (!TCP_ValidateChecksum((TCP_HEADER*)Header, Data, DataLength, SourceIP, DestinationIP)) {
+    // Validate checksum, unless the NIC already did
+    if ((Flags & NETWORK_RX_TRANSPORT_CHECKSUM_OK) == 0 &&
+        !TCP_ValidateChecksum((TCP_HEADER*)Header, Data, DataLength, SourceIP, DestinationIP)) {
         return;
     }
 
-    // Find matching connection
+    // Find matching connection, or the listener of the port
     LPTCP_CONNECTION Conn = NULL;
-    LPLIST ConnectionList = GetTCPConnectionList();
-    LPTCP_CONNECTION Current =
-        (LPTCP_CONNECTION)(ConnectionList != NULL ? ConnectionList->First : NULL);
-    while (Current != NULL) {
-        if (Current->LocalPort == Header->DestinationPort &&
-            Current->RemotePort == Header->SourcePort &&
-            Current->RemoteIP == SourceIP &&
-            Current->LocalIP == DestinationIP) {
-            Conn = Current;
-            break;
-        }
-        Current = (LPTCP_CONNECTION)Current->Next;
+    LPTCP_DEMUX_NODE Node =
+        TCP_DemuxLookup(&GlobalTCP.Demux, DestinationIP, Header->DestinationPort, SourceIP, Header->SourcePort);
+    SAFE_USE(Node) {
+        Conn = (LPTCP_CONNECTION)Node->Connection;
     }
 
     if (Conn == NULL) {
@@ -1530,40 +2651,83 @@ void TCP_OnIPv4Packet(const U8* Payload, U32 PayloadLength, U32 SourceIP, U32 De
         return;
     }
 
+    // Passive open: each SYN gets its own connection, the listener keeps listening
+    if (Conn->Listener == NULL && SM_GetCurrentState(&Conn->StateMachine) == TCP_STATE_LISTEN &&
+        (Header->Flags & (TCP_FLAG_SYN | TCP_FLAG_ACK | TCP_FLAG_RST)) == TCP_FLAG_SYN) {
+        Conn = TCP_CreateChild(Conn, DestinationIP, Header->DestinationPort, SourceIP, Header->SourcePort);
+        if (Conn == NULL) return;
+    }
+
+    // Remember the timestamp to echo, only from segments that do not start past RecvNext
+    if (Conn->TimestampsEnabled && ParsedOptions.HasTimestamp &&
+        TCP_SequenceBefore(Conn->RecvNext, Ntohl(Header->SequenceNumber)) == FALSE &&
+        TCP_SequenceBefore(ParsedOptions.TSVal, Conn->TimestampRecent) == FALSE) {
+        Conn->TimestampRecent = ParsedOptions.TSVal;
+    }
+
     // Create event data
     TCP_PACKET_EVENT Event;
     Event.Header = Header;
+    Event.Options = &ParsedOptions;
     Event.Payload = Data;
     Event.PayloadLength = DataLength;
     Event.SourceIP = SourceIP;
     Event.DestinationIP = DestinationIP;
 
+    // Sleepers on the socket look again when the state or the send space changes
+    SM_STATE PreviousState = SM_GetCurrentState(&Conn->StateMachine);
+    UINT PreviousSendUsed = Conn->SendBufferUsed;
+
     // Determine event type based on flags and data length
-    U8 Flags = Header->Flags;
+    U8 SegmentFlags = Header->Flags;
     SM_EVENT EventType = TCP_EVENT_RCV_DATA;
     BOOL ProcessResult = FALSE;
 
+    // Record the FIN, it is acted on once every byte before it arrived
+    if ((SegmentFlags & (TCP_FLAG_FIN | TCP_FLAG_SYN | TCP_FLAG_RST)) == TCP_FLAG_FIN &&
+        TCP_SequenceBefore(Ntohl(Header->SequenceNumber) + DataLength, Conn->RecvNext) == FALSE) {
+        Conn->FinReceived = TRUE;
+        Conn->FinSequence = Ntohl(Header->SequenceNumber) + DataLength;
+    }
+
     if (DataLength > 0) {
         // Process data
         EventType = TCP_EVENT_RCV_DATA;
         ProcessResult = SM_ProcessEvent(&Conn->StateMachine, EventType, &Event);
     }
 
-    if (Flags & TCP_FLAG_RST) {
+    if (SegmentFlags & TCP_FLAG_RST) {
         EventType = TCP_EVENT_RCV_RST;
-    } else if ((Flags & (TCP_FLAG_SYN | TCP_FLAG_ACK)) == (TCP_FLAG_SYN | TCP_FLAG_ACK)) {
+    } else if ((SegmentFlags & (TCP_FLAG_SYN | TCP_FLAG_ACK)) == (TCP_FLAG_SYN | TCP_FLAG_ACK)) {
         EventType = TCP_EVENT_RCV_ACK;
-    } else if (Flags & TCP_FLAG_SYN) {
+    } else if (SegmentFlags & TCP_FLAG_SYN) {
         EventType = TCP_EVENT_RCV_SYN;
-    } else if (Flags & TCP_FLAG_FIN) {
-        EventType = TCP_EVENT_RCV_FIN;
-    } else if (Flags & TCP_FLAG_ACK) {
+    } else if (SegmentFlags & TCP_FLAG_FIN) {
+        if (Conn->FinReceived && Conn->RecvNext == Conn->FinSequence) {
+            EventType = TCP_EVENT_RCV_FIN;
+        } else {
+            // FIN past a hole or already acknowledged: duplicate ACK, the data path sent it already
+            if (DataLength == 0 && TCP_SendPacket(Conn, TCP_FLAG_ACK, NULL, 0) < 0) {
+                ERROR(TEXT("[TCP_OnIPv4Packet] Failed to send ACK for out-of-order FIN"));
+            }
+            EventType = TCP_EVENT_RCV_ACK;
+        }
+    } else if (SegmentFlags & TCP_FLAG_ACK) {
         EventType = TCP_EVENT_RCV_ACK;
     }
 
     ProcessResult = SM_ProcessEvent(&Conn->StateMachine, EventType, &Event);
     UNUSED(ProcessResult);
 
+    // Data that filled the hole before a recorded FIN
+    if (EventType != TCP_EVENT_RCV_FIN && Conn->FinReceived && Conn->RecvNext == Conn->FinSequence) {
+        SM_ProcessEvent(&Conn->StateMachine, TCP_EVENT_RCV_FIN, &Event);
+    }
+
+    if (SM_GetCurrentState(&Conn->StateMachine) != PreviousState || Conn->SendBufferUsed < PreviousSendUsed) {
+        TCP_NotifyOwner(Conn);
+    }
+
 }
 
 /************************************************************************/
@@ -1590,12 +2754,12 @@ void TCP_Update(void) {
             SM_ProcessEvent(&Conn->StateMachine, TCP_EVENT_TIMEOUT, NULL);
         }
 
-        if (Conn->RetransmitPending &&
+        if (Conn->SegmentCount > 0 &&
             Conn->RetransmitTimer > 0 &&
             CurrentTime >= Conn->RetransmitTimer) {
             if (Conn->RetransmitCount < TCP_MAX_RETRANSMITS) {
                 TCP_OnCongestionTimeoutLoss(Conn);
-                if (TCP_RetransmitTrackedSegment(Conn, FALSE) == FALSE) {
+                if (TCP_RetransmitOldestSegment(Conn) == FALSE) {
                     Conn->RetransmitTimer = CurrentTime + Conn->RetransmitCurrentTimeout;
                 }
             } else {
@@ -1609,9 +2773,35 @@ void TCP_Update(void) {
             }
         }
 
+        // Send a delayed ACK that found no segment to ride on
+        if (Conn->DelayedAckTimer > 0 && CurrentTime >= Conn->DelayedAckTimer) {
+            Conn->DelayedAckTimer = 0;
+            if (TCP_SendPacket(Conn, TCP_FLAG_ACK, NULL, 0) < 0) {
+                ERROR(TEXT("[TCP_Update] Failed to send delayed ACK"));
+            }
+        }
+
         // Update state machine
         SM_Update(&Conn->StateMachine);
 
+        if (SM_GetCurrentState(&Conn->StateMachine) != CurrentState) {
+            TCP_NotifyOwner(Conn);
+        }
+
+        // Children the socket of the listener did not take
+        if (Conn->Listener != NULL) {
+            SM_STATE ChildState = SM_GetCurrentState(&Conn->StateMachine);
+            SM_STATE ChildPreviousState = SM_GetPreviousState(&Conn->StateMachine);
+
+            if ((ChildState == TCP_STATE_CLOSED && ChildPreviousState != SM_INVALID_STATE) ||
+                (ChildState == TCP_STATE_LISTEN && ChildPreviousState == TCP_STATE_SYN_RECEIVED)) {
+                TCP_DestroyConnection(Conn);
+            } else if (ChildState == TCP_STATE_ESTABLISHED || ChildState == TCP_STATE_CLOSE_WAIT) {
+                WARNING(TEXT("[TCP_Update] Accept queue full, closing connection %p"), (LPVOID)Conn);
+                TCP_Close(Conn);
+            }
+        }
+
         Conn = Next;
     }
 }
@@ -1673,11 +2863,8 @@ void TCP_InitSlidingWindow(LPTCP_CONNECTION Connection) {
 void TCP_ProcessDataConsumption(LPTCP_CONNECTION Connection, U32 DataConsumed) {
     UNUSED(DataConsumed);
     SAFE_USE_VALID_ID(Connection, KOID_TCP) {
-        // NOTE: RecvBufferUsed is already updated by caller, just calculate window
-        UINT AvailableSpace = (Connection->RecvBufferCapacity > Connection->RecvBufferUsed)
-                              ? (Connection->RecvBufferCapacity - Connection->RecvBufferUsed)
-                              : 0;
-        U16 NewWindow = (AvailableSpace > 0xFFFFU) ? 0xFFFFU : (U16)AvailableSpace;
+        // NOTE: The bytes already left the receive buffer, just calculate window
+        U32 NewWindow = TCP_GetAdvertisedWindow(Connection);
 
         // Update hysteresis with new window size
         BOOL StateChanged = Hysteresis_Update(&Connection->WindowHysteresis, NewWindow);
@@ -1720,33 +2907,20 @@ void TCP_HandleApplicationRead(LPTCP_CONNECTION Connection, U32 BytesConsumed) {
     }
 
     SAFE_USE_VALID_ID(Connection, KOID_TCP) {
-        UINT PreviousUsed = Connection->RecvBufferUsed;
-
-        if (BytesConsumed > (U32)PreviousUsed) {
-            BytesConsumed = (U32)PreviousUsed;
-        }
-
-        if (BytesConsumed == 0) {
-            return;
-        }
-
-        Connection->RecvBufferUsed -= BytesConsumed;
+        UINT Used = CircularBuffer_GetAvailableData(&(Connection->RecvBuffer));
+        UINT PreviousUsed = Used + BytesConsumed;
 
         TCP_ProcessDataConsumption(Connection, BytesConsumed);
 
         BOOL ShouldSend = TCP_ShouldSendWindowUpdate(Connection);
-        UINT AvailableSpace = (Connection->RecvBufferCapacity > Connection->RecvBufferUsed)
-                              ? (Connection->RecvBufferCapacity - Connection->RecvBufferUsed)
-                              : 0;
-        U16 NewWindow = (AvailableSpace > 0xFFFFU) ? 0xFFFFU : (U16)AvailableSpace;
+        U32 NewWindow = TCP_GetAdvertisedWindow(Connection);
         if (!ShouldSend && NewWindow > Connection->LastAdvertisedWindow) {
-            U16 Delta = (U16)(NewWindow - Connection->LastAdvertisedWindow);
+            U32 Delta = NewWindow - Connection->LastAdvertisedWindow;
             if (Connection->LastAdvertisedWindow == 0 || Delta >= TCP_MAX_RETRANSMIT_PAYLOAD) {
                 ShouldSend = TRUE;
             }
         }
-        if (!ShouldSend && PreviousUsed == Connection->RecvBufferCapacity &&
-            Connection->RecvBufferUsed < Connection->RecvBufferCapacity) {
+        if (!ShouldSend && PreviousUsed >= Connection->RecvBufferCapacity && Used < Connection->RecvBufferCapacity) {
             ShouldSend = TRUE;
         }
 
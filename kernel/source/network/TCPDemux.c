@@ -0,0 +1,176 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    TCP Demultiplexing - Connection lookup tables
+
+\************************************************************************/
+
+#include "network/TCPDemux.h"
+
+#include "text/CoreString.h"
+
+/************************************************************************/
+
+/**
+ * @brief Compute the 4-tuple bucket of a key.
+ * @param LocalIP Local address.
+ * @param LocalPort Local port.
+ * @param RemoteIP Remote address.
+ * @param RemotePort Remote port.
+ * @return Bucket index.
+ */
+static U32 TCP_DemuxTupleBucket(U32 LocalIP, U16 LocalPort, U32 RemoteIP, U16 RemotePort) {
+    U32 Hash = RemoteIP * 0x9E3779B1;
+
+    Hash ^= LocalIP + (((U32)LocalPort << 16) | RemotePort);
+    Hash ^= Hash >> 15;
+    Hash *= 0x85EBCA6B;
+    Hash ^= Hash >> 13;
+
+    return Hash & (TCP_DEMUX_TUPLE_BUCKETS - 1);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Compute the port bucket of a local port.
+ * @param LocalPort Local port, network byte order.
+ * @return Bucket index.
+ */
+static U32 TCP_DemuxPortBucket(U16 LocalPort) {
+    return (U32)Ntohs(LocalPort) & (TCP_DEMUX_PORT_BUCKETS - 1);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Tell whether an entry is a listener.
+ * @param Node Entry.
+ * @return TRUE when the entry has no remote endpoint.
+ */
+static BOOL TCP_DemuxIsListener(LPTCP_DEMUX_NODE Node) {
+    return Node->RemoteIP == 0 && Node->RemotePort == 0;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Retrieve the port or listener bucket head of an entry.
+ * @param Demux Tables.
+ * @param Node Entry.
+ * @return Address of the bucket head.
+ */
+static LPTCP_DEMUX_NODE* TCP_DemuxPortHead(LPTCP_DEMUX Demux, LPTCP_DEMUX_NODE Node) {
+    U32 Bucket = TCP_DemuxPortBucket(Node->LocalPort);
+
+    return TCP_DemuxIsListener(Node) ? &(Demux->Listeners[Bucket]) : &(Demux->Ports[Bucket]);
+}
+
+/************************************************************************/
+
+void TCP_DemuxInit(LPTCP_DEMUX Demux) {
+    MemorySet(Demux, 0, sizeof(TCP_DEMUX));
+}
+
+/************************************************************************/
+
+void TCP_DemuxInsert(LPTCP_DEMUX Demux, LPTCP_DEMUX_NODE Node) {
+    LPTCP_DEMUX_NODE* Head;
+    U32 Bucket;
+
+    if (Node->Linked) return;
+
+    Head = TCP_DemuxPortHead(Demux, Node);
+    Node->PortNext = *Head;
+    *Head = Node;
+
+    Node->TupleNext = NULL;
+    if (TCP_DemuxIsListener(Node) == FALSE) {
+        Bucket = TCP_DemuxTupleBucket(Node->LocalIP, Node->LocalPort, Node->RemoteIP, Node->RemotePort);
+        Node->TupleNext = Demux->Tuples[Bucket];
+        Demux->Tuples[Bucket] = Node;
+    }
+
+    Node->Linked = TRUE;
+    Demux->Count++;
+}
+
+/************************************************************************/
+
+void TCP_DemuxRemove(LPTCP_DEMUX Demux, LPTCP_DEMUX_NODE Node) {
+    LPTCP_DEMUX_NODE* Link;
+
+    if (Node->Linked == FALSE) return;
+
+    Link = TCP_DemuxPortHead(Demux, Node);
+    while (*Link != NULL && *Link != Node) Link = &((*Link)->PortNext);
+    if (*Link != NULL) *Link = Node->PortNext;
+
+    if (TCP_DemuxIsListener(Node) == FALSE) {
+        Link = &(Demux->Tuples[TCP_DemuxTupleBucket(Node->LocalIP, Node->LocalPort, Node->RemoteIP, Node->RemotePort)]);
+        while (*Link != NULL && *Link != Node) Link = &((*Link)->TupleNext);
+        if (*Link != NULL) *Link = Node->TupleNext;
+    }
+
+    Node->PortNext = NULL;
+    Node->TupleNext = NULL;
+    Node->Linked = FALSE;
+    Demux->Count--;
+}
+
+/************************************************************************/
+
+LPTCP_DEMUX_NODE TCP_DemuxLookup(LPTCP_DEMUX Demux, U32 LocalIP, U16 LocalPort, U32 RemoteIP, U16 RemotePort) {
+    LPTCP_DEMUX_NODE Node = Demux->Tuples[TCP_DemuxTupleBucket(LocalIP, LocalPort, RemoteIP, RemotePort)];
+    LPTCP_DEMUX_NODE Wildcard = NULL;
+
+    for (; Node != NULL; Node = Node->TupleNext) {
+        if (Node->LocalPort == LocalPort && Node->RemotePort == RemotePort && Node->RemoteIP == RemoteIP &&
+            Node->LocalIP == LocalIP) {
+            return Node;
+        }
+    }
+
+    // A listener bound to the destination address beats one bound to any address
+    for (Node = Demux->Listeners[TCP_DemuxPortBucket(LocalPort)]; Node != NULL; Node = Node->PortNext) {
+        if (Node->LocalPort != LocalPort) continue;
+
+        if (Node->LocalIP == LocalIP) return Node;
+        if (Node->LocalIP == 0 && Wildcard == NULL) Wildcard = Node;
+    }
+
+    return Wildcard;
+}
+
+/************************************************************************/
+
+BOOL TCP_DemuxIsPortInUse(LPTCP_DEMUX Demux, U32 LocalIP, U16 LocalPort) {
+    U32 Bucket = TCP_DemuxPortBucket(LocalPort);
+    LPTCP_DEMUX_NODE Node;
+
+    for (Node = Demux->Ports[Bucket]; Node != NULL; Node = Node->PortNext) {
+        if (Node->LocalPort == LocalPort && Node->LocalIP == LocalIP) return TRUE;
+    }
+
+    for (Node = Demux->Listeners[Bucket]; Node != NULL; Node = Node->PortNext) {
+        if (Node->LocalPort == LocalPort && Node->LocalIP == LocalIP) return TRUE;
+    }
+
+    return FALSE;
+}
@@ -289,9 +289,10 @@ int UDP_Send(LPDEVICE Device, U32 DestinationIP, U16 SourcePort, U16 Destination
  * @param PayloadLength Length of UDP packet in bytes.
  * @param SourceIP      Source IPv4 address (big-endian).
  * @param DestinationIP Destination IPv4 address (big-endian).
+ * @param Flags         NETWORK_RX_* flags of the frame.
  */
 
-void UDP_OnIPv4Packet(const U8* Payload, U32 PayloadLength, U32 SourceIP, U32 DestinationIP) {
+void UDP_OnIPv4Packet(const U8* Payload, U32 PayloadLength, U32 SourceIP, U32 DestinationIP, U32 Flags) {
     LPUDP_CONTEXT Context;
     LPUDP_HEADER UDPHeader;
     U16 SourcePort, DestinationPort, Length, Checksum;
@@ -329,8 +330,8 @@ void UDP_OnIPv4Packet(const U8* Payload, U32 PayloadLength, U32 SourceIP, U32 De
             return;
         }
 
-        // Checksum validation (skip if checksum is 0 - checksum disabled)
-        if (Checksum != 0) {
+        // Checksum validation (skip if checksum is 0 - checksum disabled, or verified by the NIC)
+        if (Checksum != 0 && (Flags & NETWORK_RX_TRANSPORT_CHECKSUM_OK) == 0) {
             U16 CalculatedChecksum = UDP_CalculateChecksum(SourceIP, DestinationIP, UDPHeader,
                                                             Payload + sizeof(UDP_HEADER),
                                                             Length - sizeof(UDP_HEADER));
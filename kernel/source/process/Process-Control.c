@@ -25,6 +25,7 @@
 
 #include "log/Log.h"
 #include "memory/Memory.h"
+#include "process/Schedule.h"
 
 /************************************************************************/
 
@@ -96,6 +97,7 @@ BOOL ProcessControlSetPaused(LPPROCESS Process, BOOL Paused) {
 
         LockMutex(&(Process->Mutex), INFINITY);
         Process->SchedulerState.Paused = Paused ? TRUE : FALSE;
+        SchedulerUpdateProcessTasks(Process);
         UnlockMutex(&(Process->Mutex));
         return TRUE;
     }
@@ -116,6 +118,7 @@ BOOL ProcessControlTogglePaused(LPPROCESS Process) {
         LockMutex(&(Process->Mutex), INFINITY);
         Process->SchedulerState.Paused = Process->SchedulerState.Paused ? FALSE : TRUE;
         Paused = Process->SchedulerState.Paused;
+        SchedulerUpdateProcessTasks(Process);
         UnlockMutex(&(Process->Mutex));
 
         DEBUG(TEXT("[ProcessControlTogglePaused] Process %s is %s"), Process->FileName, Paused ? TEXT("paused") : TEXT("running"));
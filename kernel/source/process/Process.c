@@ -119,7 +119,8 @@ void InitializeKernelProcess(void) {
     LINEAR HeapBase = AllocRegion(HeapPreferredBase,
                                   0,
                                   KernelProcess.HeapSize,
-                                  ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE | ALLOC_PAGES_AT_OR_OVER,
+                                  ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE | ALLOC_PAGES_AT_OR_OVER |
+                                      ALLOC_PAGES_LARGE,
                                   TEXT("KernelHeap"));
 
     DEBUG(TEXT("[InitializeKernelProcess] HeapPreferredBase : %p"), (LINEAR)HeapPreferredBase);
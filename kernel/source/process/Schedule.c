@@ -24,6 +24,7 @@
 
 #include "Base.h"
 #include "system/Clock.h"
+#include "system/ClockEvent.h"
 #include "core/ID.h"
 #include "core/Kernel.h"
 #include "core/KernelEvent.h"
@@ -36,31 +37,51 @@
 #include "process/Stack.h"
 #include "system/System.h"
 #include "process/Task.h"
+#include "utils/TimerWheel.h"
 
 /***************************************************************************/
 
+typedef struct tag_SCHEDULER_QUEUE {
+    LPTASK First;
+    LPTASK Last;
+    UINT Count;
+} SCHEDULER_QUEUE, *LPSCHEDULER_QUEUE;
+
 typedef struct tag_TASKLIST {
     volatile U32 Freeze;
-    volatile U32 SchedulerTime;
-    volatile UINT NumTasks;
-    volatile UINT CurrentIndex;  // Index of current task instead of pointer
-    LPTASK Tasks[NUM_TASKS];
+    volatile U32 SchedulerTime;                        // Milliseconds the current task has run
+    UINT SliceStart;                                   // System time when the current task was switched in
+    volatile UINT NumTasks;                            // Tasks held by any scheduler queue
+    volatile UINT ReadyCount;                          // Tasks held by the ready queues
+    volatile U32 ReadyBitmap;                          // One bit per non-empty ready level
+    U32 ReadySequence;                                 // Arrival counter of the ready queues
+    LPTASK Current;                                    // Task currently executing
+    SCHEDULER_QUEUE Ready[SCHEDULER_PRIORITY_LEVELS];  // Runnable tasks, one FIFO per priority level
+    SCHEDULER_QUEUE Sleeping;                          // Tasks waiting for their wake-up time
+    SCHEDULER_QUEUE Blocked;                           // Waiting, suspended or paused tasks
+    SCHEDULER_QUEUE Dead;                              // Dead tasks awaiting removal at next switch
 } TASKLIST, *LPTASKLIST;
 
 /***************************************************************************/
 
 #define SCHEDULER_TICK_MAX_CALLBACKS 16
+#define SCHEDULER_TICK_PERIOD_MS 10
+#define SCHEDULER_TIMER_RESOLUTION_MS 1
+#define SCHEDULER_RESCHEDULE_DELAY_MS 1
 
 typedef struct tag_SCHEDULER_TICK_SLOT {
     SCHEDULER_TICK_CALLBACK Callback;
     LPVOID Context;
+    UINT Period;                // Milliseconds between runs
+    TIMER_WHEEL_ENTRY Timer;    // Armed with the next run time while InUse
     BOOL InUse;
 } SCHEDULER_TICK_SLOT, *LPSCHEDULER_TICK_SLOT;
 
 /***************************************************************************/
 
-static TASKLIST DATA_SECTION TaskList = {.Freeze = 0, .SchedulerTime = 0, .NumTasks = 0, .CurrentIndex = 0, .Tasks = {NULL}};
+static TASKLIST DATA_SECTION TaskList = {.Freeze = 0, .SchedulerTime = 0, .SliceStart = 0, .NumTasks = 0, .ReadyCount = 0, .ReadyBitmap = 0, .Current = NULL};
 static SCHEDULER_TICK_SLOT DATA_SECTION SchedulerTickSlots[SCHEDULER_TICK_MAX_CALLBACKS];
+static TIMER_WHEEL DATA_SECTION SchedulerTimers = {.Resolution = SCHEDULER_TIMER_RESOLUTION_MS, .CurrentTick = 0, .Count = 0};
 
 /***************************************************************************/
 
@@ -89,154 +110,481 @@ static BOOL ScheduleGetProcessState(LPPROCESS Process, LPPROCESS_SCHEDULER_STATE
 /***************************************************************************/
 
 /**
- * @brief Run registered lightweight scheduler tick callbacks.
+ * @brief Map a task priority to its ready queue level.
  *
- * Callbacks execute in scheduler context and must not block, lock mutexes or
- * perform heavy work. They are intended for cheap state sampling and deferred
- * work signaling only.
+ * Priorities step by 4 (TASK_PRIORITY_LOWEST..TASK_PRIORITY_HIGHEST), so the
+ * two low bits are dropped. Anything above the last level shares it.
+ *
+ * @param Priority Task priority.
+ * @return Ready queue level.
+ */
+static U32 ScheduleGetPriorityLevel(U32 Priority) {
+    U32 Level = (Priority & 0xFF) >> 2;
+
+    if (Level >= SCHEDULER_PRIORITY_LEVELS) {
+        Level = SCHEDULER_PRIORITY_LEVELS - 1;
+    }
+
+    return Level;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Return the ready level whose head has waited the longest.
+ *
+ * Each level is a FIFO, so the oldest head across the non-empty levels is
+ * the oldest runnable task. Only the levels flagged in the bitmap are
+ * visited.
+ *
+ * @param Bitmap Ready bitmap, must not be zero.
+ * @return Non-empty ready level holding the oldest task.
  */
-static void RunSchedulerTickCallbacks(void) {
-    for (UINT Index = 0; Index < SCHEDULER_TICK_MAX_CALLBACKS; Index++) {
-        SCHEDULER_TICK_CALLBACK Callback = SchedulerTickSlots[Index].Callback;
-        LPVOID Context = SchedulerTickSlots[Index].Context;
+static U32 ScheduleGetOldestLevel(U32 Bitmap) {
+    U32 Oldest = SCHEDULER_PRIORITY_LEVELS;
+    U32 OldestSequence = 0;
+
+    for (U32 Level = 0; Bitmap != 0; Level++, Bitmap >>= 1) {
+        U32 Sequence;
+
+        if ((Bitmap & 1) == 0) continue;
+
+        Sequence = TaskList.Ready[Level].First->SchedulerLink.ReadySequence;
 
-        if (SchedulerTickSlots[Index].InUse == FALSE || Callback == NULL) {
-            continue;
+        // Signed difference keeps the order across counter wraparound
+        if (Oldest == SCHEDULER_PRIORITY_LEVELS || (I32)(Sequence - OldestSequence) < 0) {
+            Oldest = Level;
+            OldestSequence = Sequence;
         }
+    }
+
+    return Oldest;
+}
+
+/***************************************************************************/
 
-        Callback(Context);
+/**
+ * @brief Resolve one scheduler queue identifier.
+ * @param Queue Queue identifier (SCHEDULER_QUEUE_*).
+ * @param Level Ready level, used for SCHEDULER_QUEUE_READY only.
+ * @return Queue pointer, or NULL for SCHEDULER_QUEUE_NONE.
+ */
+static LPSCHEDULER_QUEUE ScheduleGetQueue(U32 Queue, U32 Level) {
+    switch (Queue) {
+        case SCHEDULER_QUEUE_READY:
+            return &(TaskList.Ready[Level]);
+        case SCHEDULER_QUEUE_SLEEPING:
+            return &(TaskList.Sleeping);
+        case SCHEDULER_QUEUE_BLOCKED:
+            return &(TaskList.Blocked);
+        case SCHEDULER_QUEUE_DEAD:
+            return &(TaskList.Dead);
     }
+
+    return NULL;
 }
 
 /***************************************************************************/
 
 /**
- * @brief Wakes up tasks whose sleep time has expired.
+ * @brief Arm the sleep timer of one sleeping task with its wake-up time.
+ *
+ * A task sleeping without deadline stays unarmed until something wakes it.
+ * Caller must have interrupts disabled.
  *
- * Centralized function to check and wake sleeping tasks. Should be called
- * periodically by the scheduler or timer interrupt.
+ * @param Task Sleeping task.
  */
-static void WakeUpExpiredTasks(void) {
-    UINT CurrentTime = GetSystemTime();
+static void ScheduleArmSleepTimer(LPTASK Task) {
+    UINT WakeUpTime = Task->SchedulerState.WakeUpTime;
+
+    if (WakeUpTime == INFINITY) {
+        TimerWheelDisarm(&SchedulerTimers, &(Task->SchedulerLink.SleepTimer));
+        return;
+    }
 
-    for (UINT Index = 0; Index < TaskList.NumTasks; Index++) {
-        LPTASK Task = TaskList.Tasks[Index];
-        TASK_SCHEDULER_STATE State;
+    TimerWheelArm(&SchedulerTimers, &(Task->SchedulerLink.SleepTimer), WakeUpTime);
+    ClockEventRequest(WakeUpTime);
+}
 
-        if (ScheduleGetTaskState(Task, &State) == FALSE) continue;
+/***************************************************************************/
 
-        if (State.Status == TASK_STATUS_SLEEPING && State.WakeUpTime != INFINITY &&
-            CurrentTime >= State.WakeUpTime) {
-            (void)SetTaskSchedulerStatus(Task, TASK_STATUS_RUNNING);
-        }
+/**
+ * @brief Append one unqueued task at the tail of a scheduler queue.
+ *
+ * Caller must have interrupts disabled.
+ *
+ * @param Task Task to append.
+ * @param Queue Destination queue (SCHEDULER_QUEUE_*).
+ * @param Level Ready level, used for SCHEDULER_QUEUE_READY only.
+ */
+static void ScheduleQueueAppend(LPTASK Task, U32 Queue, U32 Level) {
+    LPSCHEDULER_QUEUE List = ScheduleGetQueue(Queue, Level);
+
+    if (List == NULL) return;
+
+    Task->SchedulerLink.Next = NULL;
+    Task->SchedulerLink.Previous = List->Last;
+
+    if (List->Last != NULL) {
+        List->Last->SchedulerLink.Next = Task;
+    } else {
+        List->First = Task;
+    }
+
+    List->Last = Task;
+    List->Count++;
+
+    Task->SchedulerLink.Queue = Queue;
+    Task->SchedulerLink.Level = Level;
+
+    if (Queue == SCHEDULER_QUEUE_READY) {
+        Task->SchedulerLink.ReadySequence = TaskList.ReadySequence++;
+        TaskList.ReadyBitmap |= ((U32)1 << Level);
+        TaskList.ReadyCount++;
+    }
+
+    if (Queue == SCHEDULER_QUEUE_SLEEPING) {
+        ScheduleArmSleepTimer(Task);
     }
 }
 
 /***************************************************************************/
 
 /**
- * @brief Removes dead tasks from the scheduler queue during context switches.
+ * @brief Unlink one task from the scheduler queue that holds it.
  *
- * Called when switching TO a task that is not dead. Removes all dead tasks
- * from the queue to prevent them from being scheduled again. This is done
- * during context switches to avoid silent CurrentIndex adjustments.
+ * Caller must have interrupts disabled.
  *
- * @param ExceptTask Task pointer we're switching to (don't remove it)
- * @return New index of ExceptTask after removals
+ * @param Task Task to unlink.
  */
-static UINT RemoveDeadTasksFromQueue(LPTASK ExceptTask) {
-    UINT NewExceptIndex = INFINITY;
-    TASK_SCHEDULER_STATE State;
+static void ScheduleQueueRemove(LPTASK Task) {
+    U32 Queue = Task->SchedulerLink.Queue;
+    U32 Level = Task->SchedulerLink.Level;
+    LPSCHEDULER_QUEUE List = ScheduleGetQueue(Queue, Level);
 
-    // Search backwards to handle array compaction safely
-    for (I32 Index = (I32)(TaskList.NumTasks - 1); Index >= 0; Index--) {
-        LPTASK Task = TaskList.Tasks[Index];
+    if (List == NULL) return;
 
-        if (Task == ExceptTask) continue;
-        if (ScheduleGetTaskState(Task, &State) == FALSE) continue;
+    if (Task->SchedulerLink.Previous != NULL) {
+        Task->SchedulerLink.Previous->SchedulerLink.Next = Task->SchedulerLink.Next;
+    } else {
+        List->First = Task->SchedulerLink.Next;
+    }
 
-        if (State.Status == TASK_STATUS_DEAD) {
-            FINE_DEBUG(TEXT("[RemoveDeadTasksFromQueue] Removing dead task %s at index %d"), Task->Name, Index);
+    if (Task->SchedulerLink.Next != NULL) {
+        Task->SchedulerLink.Next->SchedulerLink.Previous = Task->SchedulerLink.Previous;
+    } else {
+        List->Last = Task->SchedulerLink.Previous;
+    }
 
-            // Shift remaining tasks down
-            for (UINT ShiftIndex = (UINT)Index; ShiftIndex < TaskList.NumTasks - 1; ShiftIndex++) {
-                TaskList.Tasks[ShiftIndex] = TaskList.Tasks[ShiftIndex + 1];
-            }
+    List->Count--;
 
-            TaskList.NumTasks--;
-            TaskList.Tasks[TaskList.NumTasks] = NULL;  // Clear last slot
+    if (Queue == SCHEDULER_QUEUE_READY) {
+        TaskList.ReadyCount--;
+
+        if (List->First == NULL) {
+            TaskList.ReadyBitmap &= ~((U32)1 << Level);
         }
     }
 
-    // Find new index of ExceptTask
-    for (UINT Index = 0; Index < TaskList.NumTasks; Index++) {
-        if (TaskList.Tasks[Index] == ExceptTask) {
-            NewExceptIndex = Index;
-            break;
+    if (Queue == SCHEDULER_QUEUE_SLEEPING) {
+        TimerWheelDisarm(&SchedulerTimers, &(Task->SchedulerLink.SleepTimer));
+    }
+
+    Task->SchedulerLink.Next = NULL;
+    Task->SchedulerLink.Previous = NULL;
+    Task->SchedulerLink.Queue = SCHEDULER_QUEUE_NONE;
+    Task->SchedulerLink.Level = 0;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Compute the scheduler queue matching one task's current state.
+ * @param Task Target task.
+ * @return Queue identifier (SCHEDULER_QUEUE_*), never SCHEDULER_QUEUE_NONE.
+ */
+static U32 ScheduleClassifyTask(LPTASK Task) {
+    TASK_SCHEDULER_STATE State;
+    PROCESS_SCHEDULER_STATE ProcessState;
+
+    if (ScheduleGetTaskState(Task, &State) == FALSE) return SCHEDULER_QUEUE_BLOCKED;
+
+    if (State.Status == TASK_STATUS_DEAD) return SCHEDULER_QUEUE_DEAD;
+
+    // Sleeping tasks keep their wake-up deadline even while suspended
+    if (State.Status == TASK_STATUS_SLEEPING) return SCHEDULER_QUEUE_SLEEPING;
+
+    if ((State.Status == TASK_STATUS_READY || State.Status == TASK_STATUS_RUNNING) && State.Suspended == FALSE &&
+        ScheduleGetProcessState(Task->OwnerProcess, &ProcessState) != FALSE && ProcessState.Paused == FALSE) {
+        return SCHEDULER_QUEUE_READY;
+    }
+
+    return SCHEDULER_QUEUE_BLOCKED;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief File one task in the scheduler queue matching its current state.
+ *
+ * A task already in the right queue keeps its position. Caller must have
+ * interrupts disabled.
+ *
+ * @param Task Target task.
+ */
+static void SchedulePlaceTask(LPTASK Task) {
+    U32 Queue = ScheduleClassifyTask(Task);
+    U32 Level = (Queue == SCHEDULER_QUEUE_READY) ? ScheduleGetPriorityLevel(Task->Priority) : 0;
+
+    if (Task->SchedulerLink.Queue == Queue && Task->SchedulerLink.Level == Level) {
+        // Still sleeping, follow a wake-up time change
+        if (Queue == SCHEDULER_QUEUE_SLEEPING &&
+            (TimerWheelIsArmed(&(Task->SchedulerLink.SleepTimer)) == FALSE ||
+             Task->SchedulerLink.SleepTimer.Deadline != Task->SchedulerState.WakeUpTime)) {
+            ScheduleArmSleepTimer(Task);
         }
+        return;
+    }
+
+    ScheduleQueueRemove(Task);
+    ScheduleQueueAppend(Task, Queue, Level);
+
+    // The choice of task changed, let a one-shot clock reach the scheduler soon
+    if ((Queue == SCHEDULER_QUEUE_READY && Task != TaskList.Current) ||
+        (Queue != SCHEDULER_QUEUE_READY && Task == TaskList.Current && TaskList.ReadyCount != 0)) {
+        ClockEventRequest(GetSystemTime() + SCHEDULER_RESCHEDULE_DELAY_MS);
+    }
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Move one runnable task to the tail of the ready order.
+ *
+ * Caller must have interrupts disabled.
+ *
+ * @param Task Target task.
+ */
+static void ScheduleRotateTask(LPTASK Task) {
+    U32 Level;
+
+    if (Task->SchedulerLink.Queue != SCHEDULER_QUEUE_READY) return;
+
+    Level = Task->SchedulerLink.Level;
+    ScheduleQueueRemove(Task);
+    ScheduleQueueAppend(Task, SCHEDULER_QUEUE_READY, Level);
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Timer wheel callback for one registered scheduler tick callback.
+ *
+ * Callbacks execute in scheduler context and must not block, lock mutexes or
+ * perform heavy work. They are intended for cheap state sampling and deferred
+ * work signaling only. The slot is re-armed one period later before the
+ * callback runs, so the callback may unregister itself.
+ *
+ * @param Entry Slot timer.
+ * @param Context Slot pointer.
+ */
+static void ScheduleTickTimerExpired(LPTIMER_WHEEL_ENTRY Entry, LPVOID Context) {
+    LPSCHEDULER_TICK_SLOT Slot = (LPSCHEDULER_TICK_SLOT)Context;
+    SCHEDULER_TICK_CALLBACK Callback;
+    UINT CurrentTime = GetSystemTime();
+    UINT NextTime = Entry->Deadline + Slot->Period;
+
+    if (Slot->InUse == FALSE || Slot->Callback == NULL) return;
+
+    // Missed whole periods are dropped rather than replayed
+    if (NextTime <= CurrentTime) {
+        NextTime = CurrentTime + Slot->Period;
     }
 
-    return NewExceptIndex;
+    Callback = Slot->Callback;
+    TimerWheelArm(&SchedulerTimers, Entry, NextTime);
+    ClockEventRequest(NextTime);
+
+    Callback(Slot->Context);
 }
 
 /***************************************************************************/
 
 /**
- * @brief Counts the number of tasks that are ready to run.
+ * @brief Timer wheel callback that wakes up one sleeping task.
  *
- * Also wakes up any sleeping tasks whose wake-up time has expired.
+ * Woken tasks move to their ready level through SetTaskSchedulerStatus.
  *
- * @return Number of runnable tasks
+ * @param Entry Task sleep timer.
+ * @param Context Task pointer.
  */
-static UINT CountRunnableTasks(void) {
-    UINT RunnableCount = 0;
+static void ScheduleSleepTimerExpired(LPTIMER_WHEEL_ENTRY Entry, LPVOID Context) {
+    LPTASK Task = (LPTASK)Context;
+    TASK_SCHEDULER_STATE State;
+
+    UNUSED(Entry);
 
-    for (UINT Index = 0; Index < TaskList.NumTasks; Index++) {
-        LPTASK Task = TaskList.Tasks[Index];
-        TASK_SCHEDULER_STATE State;
-        PROCESS_SCHEDULER_STATE ProcessState;
+    if (ScheduleGetTaskState(Task, &State) == FALSE) return;
 
-        if (ScheduleGetTaskState(Task, &State) == FALSE) continue;
-        if (ScheduleGetProcessState(Task->OwnerProcess, &ProcessState) == FALSE) continue;
+    if (State.Status != TASK_STATUS_SLEEPING) {
+        SchedulePlaceTask(Task);
+    } else if (State.WakeUpTime != INFINITY && GetSystemTime() >= State.WakeUpTime) {
+        (void)SetTaskSchedulerStatus(Task, TASK_STATUS_RUNNING);
+    } else {
+        ScheduleArmSleepTimer(Task);
+    }
+}
+
+/***************************************************************************/
 
-        if ((State.Status == TASK_STATUS_READY || State.Status == TASK_STATUS_RUNNING) &&
-            State.Suspended == FALSE && ProcessState.Paused == FALSE) {
-            RunnableCount++;
+/**
+ * @brief Runs expired scheduler timers.
+ *
+ * Sleeping tasks and tick callbacks share one timer wheel, so only the
+ * buckets reached since the previous tick are visited.
+ */
+static void RunExpiredTimers(void) {
+    (void)TimerWheelAdvance(&SchedulerTimers, GetSystemTime());
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Programs the next clock event from the pending scheduler work.
+ *
+ * The next event is the earliest timer, or one scheduling period away when
+ * several tasks compete for the CPU. No-op with a periodic clock.
+ */
+static void ScheduleProgramNextEvent(void) {
+    UINT Deadline = TimerWheelGetNextDeadline(&SchedulerTimers);
+
+    if (TaskList.ReadyCount > 1) {
+        UINT SliceEnd = GetSystemTime() + GetMinimumQuantum() + SCHEDULER_TICK_PERIOD_MS;
+
+        if (SliceEnd < Deadline) {
+            Deadline = SliceEnd;
         }
     }
 
-    return RunnableCount;
+    ClockEventSetNext(Deadline);
 }
 
 /***************************************************************************/
 
 /**
- * @brief Finds the next runnable task starting from a given index.
+ * @brief Removes dead tasks from the scheduler queues during context switches.
  *
- * Performs round-robin search through the task list, skipping dead and sleeping tasks.
- * Returns the index of the next runnable task.
+ * Called when switching TO a task that is not dead. Dead tasks are already
+ * gathered on their own queue, so this only drains it.
+ */
+static void RemoveDeadTasksFromQueue(void) {
+    while (TaskList.Dead.First != NULL) {
+        LPTASK Task = TaskList.Dead.First;
+
+        FINE_DEBUG(TEXT("[RemoveDeadTasksFromQueue] Removing dead task %s"), Task->Name);
+
+        ScheduleQueueRemove(Task);
+        TaskList.NumTasks--;
+    }
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Picks the next runnable task.
  *
- * @param StartIndex Index to start searching from
- * @return Index of next runnable task, or INFINITY if none found
+ * Takes the oldest head among the non-empty ready levels, so every runnable
+ * task gets its turn whatever its priority, which only sets its quantum. A
+ * head whose state changed without notifying the scheduler is refiled and
+ * the search resumes. Caller must have interrupts disabled.
+ *
+ * @return Next runnable task, or NULL if none found
  */
-UINT FindNextRunnableTask(UINT StartIndex) {
-    for (UINT Attempts = 0; Attempts < TaskList.NumTasks; Attempts++) {
-        UINT Index = (StartIndex + Attempts) % TaskList.NumTasks;
-        LPTASK Task = TaskList.Tasks[Index];
-        TASK_SCHEDULER_STATE State;
-        PROCESS_SCHEDULER_STATE ProcessState;
+static LPTASK PickNextRunnableTask(void) {
+    while (TaskList.ReadyBitmap != 0) {
+        U32 Level = ScheduleGetOldestLevel(TaskList.ReadyBitmap);
+        LPTASK Task = TaskList.Ready[Level].First;
 
-        // Skip dead tasks - they will be removed during context switch
-        if (ScheduleGetTaskState(Task, &State) == FALSE) continue;
-        if (ScheduleGetProcessState(Task->OwnerProcess, &ProcessState) == FALSE) continue;
+        if (ScheduleClassifyTask(Task) == SCHEDULER_QUEUE_READY) {
+            return Task;
+        }
 
-        if ((State.Status == TASK_STATUS_READY || State.Status == TASK_STATUS_RUNNING) &&
-            State.Suspended == FALSE && ProcessState.Paused == FALSE) {
-            return Index;
+        SchedulePlaceTask(Task);
+    }
+
+    return NULL;  // No runnable task found
+}
+
+/************************************************************************/
+
+/**
+ * @brief Moves a queued task to the scheduler queue matching its current state.
+ *
+ * Must be called after any change to a task status, suspension flag or
+ * priority. Tasks that are not in the scheduler are left alone.
+ *
+ * @param Task Target task.
+ */
+void SchedulerUpdateTask(LPTASK Task) {
+    U32 Flags;
+
+    SAFE_USE_VALID_ID(Task, KOID_TASK) {
+        SaveFlags(&Flags);
+        DisableInterrupts();
+
+        if (Task->SchedulerLink.Queue != SCHEDULER_QUEUE_NONE) {
+            SchedulePlaceTask(Task);
         }
+
+        RestoreFlags(&Flags);
+    }
+}
+
+/************************************************************************/
+
+/**
+ * @brief Refile one queue's tasks owned by a process.
+ * @param List Queue to walk.
+ * @param Process Owner process.
+ */
+static void ScheduleUpdateQueueForProcess(LPSCHEDULER_QUEUE List, LPPROCESS Process) {
+    LPTASK Task = List->First;
+
+    while (Task != NULL) {
+        LPTASK Next = Task->SchedulerLink.Next;
+
+        if (Task->OwnerProcess == Process) {
+            SchedulePlaceTask(Task);
+        }
+
+        Task = Next;
+    }
+}
+
+/************************************************************************/
+
+/**
+ * @brief Moves every queued task of a process to the queue matching its state.
+ *
+ * Called when the process-wide paused state changes.
+ *
+ * @param Process Target process.
+ */
+void SchedulerUpdateProcessTasks(LPPROCESS Process) {
+    U32 Flags;
+
+    if (Process == NULL) return;
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    for (UINT Level = 0; Level < SCHEDULER_PRIORITY_LEVELS; Level++) {
+        ScheduleUpdateQueueForProcess(&(TaskList.Ready[Level]), Process);
     }
 
-    return INFINITY;  // No runnable task found
+    ScheduleUpdateQueueForProcess(&(TaskList.Blocked), Process);
+
+    RestoreFlags(&Flags);
 }
 
 /************************************************************************/
@@ -244,9 +592,9 @@ UINT FindNextRunnableTask(UINT StartIndex) {
 /**
  * @brief Adds a task to the scheduler's execution queue.
  *
- * Validates the task, checks for duplicates and capacity, then adds the task
- * to the scheduling queue. Calculates and assigns the task's quantum time
- * based on its priority. If this is the first task, makes it current.
+ * Validates the task, checks for duplicates and capacity, then files the task
+ * in the queue matching its state. Calculates and assigns the task's quantum
+ * time based on its priority. If this is the first task, makes it current.
  *
  * @param NewTask Pointer to task to add to scheduler queue
  * @return TRUE if task added successfully, FALSE on error or capacity exceeded
@@ -254,6 +602,8 @@ UINT FindNextRunnableTask(UINT StartIndex) {
 BOOL AddTaskToQueue(LPTASK NewTask) {
     TRACED_FUNCTION;
 
+    U32 Flags;
+
     FINE_DEBUG(TEXT("[AddTaskToQueue] NewTask = %p"), NewTask);
 
     FreezeScheduler();
@@ -270,30 +620,34 @@ BOOL AddTaskToQueue(LPTASK NewTask) {
         }
 
         // Check if task already in task queue
-        for (UINT Index = 0; Index < TaskList.NumTasks; Index++) {
-            if (TaskList.Tasks[Index] == NewTask) {
-                UnfreezeScheduler();
+        if (NewTask->SchedulerLink.Queue != SCHEDULER_QUEUE_NONE) {
+            UnfreezeScheduler();
 
-                TRACED_EPILOGUE("AddTaskToQueue");
-                return TRUE;  // Already present, success
-            }
+            TRACED_EPILOGUE("AddTaskToQueue");
+            return TRUE;  // Already present, success
         }
 
         // Add task to queue
         FINE_DEBUG(TEXT("[AddTaskToQueue] Adding %p"), NewTask);
 
-        TaskList.Tasks[TaskList.NumTasks] = NewTask;
-
         // Set quantum time for this task
         SetTaskWakeUpTime(NewTask, ComputeTaskQuantumTime(NewTask->Priority));
 
+        SaveFlags(&Flags);
+        DisableInterrupts();
+
+        TimerWheelEntryInitialize(&(NewTask->SchedulerLink.SleepTimer), ScheduleSleepTimerExpired, NewTask);
+        SchedulePlaceTask(NewTask);
+
         // If this is the first task, make it current
-        if (TaskList.NumTasks == 0) {
-            TaskList.CurrentIndex = 0;
+        if (TaskList.Current == NULL) {
+            TaskList.Current = NewTask;
         }
 
         TaskList.NumTasks++;
 
+        RestoreFlags(&Flags);
+
         UnfreezeScheduler();
 
         TRACED_EPILOGUE("AddTaskToQueue");
@@ -310,8 +664,8 @@ BOOL AddTaskToQueue(LPTASK NewTask) {
 /**
  * @brief Removes a task from the scheduler's execution queue.
  *
- * Searches for the task in the queue and removes it, compacting the array.
- * Adjusts the current task index appropriately to maintain scheduling order.
+ * Unlinks the task from whichever scheduler queue holds it. If it was the
+ * current task, the next runnable task becomes current.
  *
  * @param OldTask Pointer to task to remove from scheduler queue
  * @return TRUE if task removed successfully, FALSE if not found
@@ -319,45 +673,34 @@ BOOL AddTaskToQueue(LPTASK NewTask) {
 BOOL RemoveTaskFromQueue(LPTASK OldTask) {
     TRACED_FUNCTION;
 
-    FreezeScheduler();
-
-    for (UINT Index = 0; Index < TaskList.NumTasks; Index++) {
-        if (TaskList.Tasks[Index] == OldTask) {
-            // If removing current task, adjust current index
-            if (Index == TaskList.CurrentIndex) {
-                // Find next runnable task or wrap around
-                if (TaskList.NumTasks > 1) {
-                    TaskList.CurrentIndex = FindNextRunnableTask((Index + 1) % TaskList.NumTasks);
+    U32 Flags;
+    BOOL Removed = FALSE;
 
-                    if (TaskList.CurrentIndex >= TaskList.NumTasks - 1) {
-                        TaskList.CurrentIndex = 0;  // Wrap to beginning
-                    }
-                } else {
-                    TaskList.CurrentIndex = 0;
-                }
-            } else if (Index < TaskList.CurrentIndex) {
-                TaskList.CurrentIndex--;  // Adjust index after removal
-            }
+    FreezeScheduler();
 
-            // Shift remaining tasks
-            for (UINT ShiftIndex = Index; ShiftIndex < TaskList.NumTasks - 1; ShiftIndex++) {
-                TaskList.Tasks[ShiftIndex] = TaskList.Tasks[ShiftIndex + 1];
-            }
+    SAFE_USE(OldTask) {
+        SaveFlags(&Flags);
+        DisableInterrupts();
 
+        if (OldTask->SchedulerLink.Queue != SCHEDULER_QUEUE_NONE) {
+            ScheduleQueueRemove(OldTask);
             TaskList.NumTasks--;
-            TaskList.Tasks[TaskList.NumTasks] = NULL;  // Clear last slot
 
-            UnfreezeScheduler();
+            // If removing current task, move on to the next runnable one
+            if (TaskList.Current == OldTask) {
+                TaskList.Current = PickNextRunnableTask();
+            }
 
-            TRACED_EPILOGUE("RemoveTaskFromQueue");
-            return TRUE;
+            Removed = TRUE;
         }
+
+        RestoreFlags(&Flags);
     }
 
     UnfreezeScheduler();
 
     TRACED_EPILOGUE("RemoveTaskFromQueue");
-    return FALSE;
+    return Removed;
 }
 
 /***************************************************************************/
@@ -381,16 +724,7 @@ LPPROCESS GetCurrentProcess(void) {
  * @return Pointer to current task, or NULL if no tasks are scheduled
  */
 LPTASK GetCurrentTask(void) {
-    LPTASK Task = NULL;
-
-    FreezeScheduler();
-    if (TaskList.NumTasks == 0 || TaskList.CurrentIndex >= TaskList.NumTasks) {
-    } else {
-        Task = TaskList.Tasks[TaskList.CurrentIndex];
-    }
-    UnfreezeScheduler();
-
-    return Task;
+    return TaskList.Current;
 }
 
 /***************************************************************************/
@@ -452,26 +786,42 @@ BOOL IsSchedulerFrozen(void) {
 /************************************************************************/
 
 /**
- * @brief Register one scheduler tick callback.
+ * @brief Register one periodic scheduler callback.
+ *
+ * The callback is armed in the scheduler timer wheel and costs nothing on
+ * the ticks where it is not due.
+ *
  * @param Callback Lightweight callback to run from scheduler context.
  * @param Context Opaque callback context.
+ * @param PeriodMilliSeconds Time between runs, 0 for SCHEDULER_TICK_PERIOD_MS.
  * @return Registration handle or SCHEDULER_TICK_INVALID_HANDLE.
  */
-U32 SchedulerRegisterTickCallback(SCHEDULER_TICK_CALLBACK Callback, LPVOID Context) {
+U32 SchedulerRegisterPeriodicCallback(SCHEDULER_TICK_CALLBACK Callback, LPVOID Context, UINT PeriodMilliSeconds) {
     UINT Flags;
 
     if (Callback == NULL) {
         return SCHEDULER_TICK_INVALID_HANDLE;
     }
 
+    if (PeriodMilliSeconds == 0) {
+        PeriodMilliSeconds = SCHEDULER_TICK_PERIOD_MS;
+    }
+
     for (U32 Index = 0; Index < SCHEDULER_TICK_MAX_CALLBACKS; Index++) {
         SaveFlags(&Flags);
         DisableInterrupts();
 
         if (SchedulerTickSlots[Index].InUse == FALSE) {
-            SchedulerTickSlots[Index].Callback = Callback;
-            SchedulerTickSlots[Index].Context = Context;
-            SchedulerTickSlots[Index].InUse = TRUE;
+            LPSCHEDULER_TICK_SLOT Slot = &(SchedulerTickSlots[Index]);
+
+            Slot->Callback = Callback;
+            Slot->Context = Context;
+            Slot->Period = PeriodMilliSeconds;
+            Slot->InUse = TRUE;
+
+            TimerWheelEntryInitialize(&(Slot->Timer), ScheduleTickTimerExpired, Slot);
+            TimerWheelArm(&SchedulerTimers, &(Slot->Timer), GetSystemTime() + PeriodMilliSeconds);
+            ClockEventRequest(Slot->Timer.Deadline);
 
             RestoreFlags(&Flags);
             return Index;
@@ -480,12 +830,24 @@ U32 SchedulerRegisterTickCallback(SCHEDULER_TICK_CALLBACK Callback, LPVOID Conte
         RestoreFlags(&Flags);
     }
 
-    ERROR(TEXT("[SchedulerRegisterTickCallback] No free scheduler tick callback slots"));
+    ERROR(TEXT("[SchedulerRegisterPeriodicCallback] No free scheduler tick callback slots"));
     return SCHEDULER_TICK_INVALID_HANDLE;
 }
 
 /************************************************************************/
 
+/**
+ * @brief Register one scheduler tick callback.
+ * @param Callback Lightweight callback to run from scheduler context.
+ * @param Context Opaque callback context.
+ * @return Registration handle or SCHEDULER_TICK_INVALID_HANDLE.
+ */
+U32 SchedulerRegisterTickCallback(SCHEDULER_TICK_CALLBACK Callback, LPVOID Context) {
+    return SchedulerRegisterPeriodicCallback(Callback, Context, 0);
+}
+
+/************************************************************************/
+
 /**
  * @brief Unregister one scheduler tick callback.
  * @param Handle Registration handle returned by SchedulerRegisterTickCallback.
@@ -500,8 +862,13 @@ void SchedulerUnregisterTickCallback(U32 Handle) {
     SaveFlags(&Flags);
     DisableInterrupts();
 
+    if (SchedulerTickSlots[Handle].InUse != FALSE) {
+        TimerWheelDisarm(&SchedulerTimers, &(SchedulerTickSlots[Handle].Timer));
+    }
+
     SchedulerTickSlots[Handle].Callback = NULL;
     SchedulerTickSlots[Handle].Context = NULL;
+    SchedulerTickSlots[Handle].Period = 0;
     SchedulerTickSlots[Handle].InUse = FALSE;
 
     RestoreFlags(&Flags);
@@ -509,6 +876,28 @@ void SchedulerUnregisterTickCallback(U32 Handle) {
 
 /************************************************************************/
 
+/**
+ * @brief Return the earliest pending scheduler deadline.
+ *
+ * Covers sleeping task wake-ups and periodic callbacks. The idle path can use
+ * it to know how long the CPU will stay idle when nothing else happens.
+ *
+ * @return Absolute time in milliseconds, or INFINITY when nothing is armed.
+ */
+UINT SchedulerGetNextDeadline(void) {
+    UINT Flags;
+    UINT Deadline;
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+    Deadline = TimerWheelGetNextDeadline(&SchedulerTimers);
+    RestoreFlags(&Flags);
+
+    return Deadline;
+}
+
+/************************************************************************/
+
 void SwitchToNextTask(LPTASK CurrentTask, LPTASK NextTask) {
     TASK_SCHEDULER_STATE NextTaskState;
 
@@ -635,7 +1024,6 @@ void SwitchToNextTask_3(register LPTASK CurrentTask, register LPTASK NextTask) {
  */
 void Scheduler(void) {
     TASK_SCHEDULER_STATE CurrentTaskState;
-    TASK_SCHEDULER_STATE NextTaskState;
     PROCESS_SCHEDULER_STATE CurrentProcessState;
     U32 Flags = 0;
     SaveFlags(&Flags);
@@ -648,8 +1036,12 @@ void Scheduler(void) {
         return;
     }
 
-    TaskList.SchedulerTime += 10;
-    RunSchedulerTickCallbacks();
+    // Ticks are not evenly spaced with a one-shot clock, measure the slice
+    TaskList.SchedulerTime = GetSystemTime() - TaskList.SliceStart;
+
+    // Wake up expired sleeping tasks and run due tick callbacks
+    RunExpiredTimers();
+    ScheduleProgramNextEvent();
 
     // Check for stack overflow - kill dangerous tasks immediately
     /*
@@ -672,7 +1064,7 @@ void Scheduler(void) {
     }
 
     // Check if current task quantum has expired
-    LPTASK CurrentTask = (TaskList.CurrentIndex < TaskList.NumTasks) ? TaskList.Tasks[TaskList.CurrentIndex] : NULL;
+    LPTASK CurrentTask = TaskList.Current;
     BOOL HasCurrentTaskSnapshot = FALSE;
     BOOL QuantumExpired = FALSE;
 
@@ -682,14 +1074,8 @@ void Scheduler(void) {
             CurrentTaskState.WakeUpTime != INFINITY && GetSystemTime() >= CurrentTaskState.WakeUpTime;
     }
 
-    // Wake up expired sleeping tasks first
-    WakeUpExpiredTasks();
-
-    // Update sleeping tasks status
-    UINT RunnableCount = CountRunnableTasks();
-
     // No runnable tasks - system idle
-    if (RunnableCount == 0) {
+    if (TaskList.ReadyCount == 0) {
         FINE_DEBUG(TEXT("[Scheduler] No runnable tasks"));
 
         return;
@@ -705,44 +1091,32 @@ void Scheduler(void) {
         return;
     }
 
-    // Time to switch - find next runnable task
-    UINT NextIndex = FindNextRunnableTask((TaskList.CurrentIndex + 1) % TaskList.NumTasks);
+    // Time to switch - current task goes behind every ready task, then take the oldest one
+    SAFE_USE(CurrentTask) {
+        ScheduleRotateTask(CurrentTask);
+    }
 
-    if (TaskList.CurrentIndex != NextIndex) {
-        // Get task pointers BEFORE any queue manipulation
-        LPTASK CurrentTask = (TaskList.CurrentIndex < TaskList.NumTasks) ? TaskList.Tasks[TaskList.CurrentIndex] : NULL;
-        LPTASK NextTask = TaskList.Tasks[NextIndex];
+    LPTASK NextTask = PickNextRunnableTask();
 
-        FINE_DEBUG(TEXT("[Scheduler] Switch between task index %u (%s @ %s) and %u (%s @ %s)"),
-            TaskList.CurrentIndex, CurrentTask ? CurrentTask->Name : TEXT("NULL"),
-            CurrentTask ? CurrentTask->OwnerProcess->FileName : TEXT("NULL"), NextIndex, NextTask->Name,
-            NextTask->OwnerProcess->FileName);
+    if (NextTask == NULL) {
+        // Ready queues only held stale entries
+        FINE_DEBUG(TEXT("[Scheduler] No next task found"));
 
-        if (NextIndex >= TaskList.NumTasks) {
-            // Should not happen if RunnableCount > 0, but safety check
-            FINE_DEBUG(TEXT("[Scheduler] No next task found"));
+        return;
+    }
 
-            return;
-        }
+    if (NextTask != CurrentTask) {
+        FINE_DEBUG(TEXT("[Scheduler] Switch between task %s @ %s and %s @ %s"),
+            CurrentTask ? CurrentTask->Name : TEXT("NULL"),
+            CurrentTask ? CurrentTask->OwnerProcess->FileName : TEXT("NULL"), NextTask->Name,
+            NextTask->OwnerProcess->FileName);
 
         // Remove dead tasks from queue now that we're switching TO a non-dead task
-        // This prevents silent CurrentIndex adjustments and phantom task changes
-        if (ScheduleGetTaskState(NextTask, &NextTaskState) == FALSE) {
-            return;
-        }
+        RemoveDeadTasksFromQueue();
 
-        if (NextTaskState.Status != TASK_STATUS_DEAD) {
-            NextIndex = RemoveDeadTasksFromQueue(NextTask);
-
-            if (NextIndex == INFINITY) {
-                // NextTask was somehow removed - this should not happen
-                ERROR(TEXT("[Scheduler] NextTask was removed during cleanup!"));
-                return;
-            }
-        }
-
-        TaskList.CurrentIndex = NextIndex;
+        TaskList.Current = NextTask;
         TaskList.SchedulerTime = 0;
+        TaskList.SliceStart = GetSystemTime();
 
         if (CurrentTask && CurrentTask->OwnerProcess != NextTask->OwnerProcess &&
             CurrentTask->OwnerProcess->Privilege != NextTask->OwnerProcess->Privilege) {
@@ -895,9 +1269,18 @@ U32 Wait(LPWAIT_INFO WaitInfo) {
             LastDebugTime = CurrentTime;
         }
 
-        SetTaskStatus(CurrentTask, TASK_STATUS_SLEEPING);
-        Sleep(50);
-        SetTaskStatus(CurrentTask, TASK_STATUS_RUNNING);
+        // Sleep until the next poll or the timeout, whichever comes first
+        UINT SleepTime = 50;
+
+        if (WaitInfo->MilliSeconds != MAX_U32) {
+            UINT Remaining = WaitInfo->MilliSeconds - (CurrentTime - StartTime);
+
+            if (Remaining < SleepTime) {
+                SleepTime = Remaining;
+            }
+        }
+
+        Sleep(SleepTime);
     }
 
     return WAIT_TIMEOUT;
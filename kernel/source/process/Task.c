@@ -190,6 +190,7 @@ LPTASK NewTask(void) {
     This->SchedulerState.Status = TASK_STATUS_READY;
     This->SchedulerState.WakeUpTime = INFINITY;
     This->SchedulerState.Suspended = FALSE;
+    MemorySet(&(This->SchedulerLink), 0, sizeof(TASK_SCHEDULER_LINK));
     This->WaitingMutex = NULL;
     This->WaitingSince = 0;
     This->HeldMutexClassDepth = 0;
@@ -594,6 +595,7 @@ BOOL SuspendTaskExecution(LPTASK Task) {
         LockMutex(&(Task->Mutex), INFINITY);
         FreezeScheduler();
         Task->SchedulerState.Suspended = TRUE;
+        SchedulerUpdateTask(Task);
         UnfreezeScheduler();
         UnlockMutex(&(Task->Mutex));
         return TRUE;
@@ -614,6 +616,7 @@ BOOL ResumeTaskExecution(LPTASK Task) {
         LockMutex(&(Task->Mutex), INFINITY);
         FreezeScheduler();
         Task->SchedulerState.Suspended = FALSE;
+        SchedulerUpdateTask(Task);
         UnfreezeScheduler();
         UnlockMutex(&(Task->Mutex));
         return TRUE;
@@ -742,6 +745,7 @@ U32 SetTaskPriority(LPTASK Task, U32 Priority) {
 
         OldPriority = Task->Priority;
         Task->Priority = Priority;
+        SchedulerUpdateTask(Task);
 
         UnlockMutex(MUTEX_KERNEL);
     }
@@ -788,8 +792,9 @@ void Sleep(U32 MilliSeconds) {
             DeadCPU();
         }
 
-        SetTaskStatus(Task, TASK_STATUS_SLEEPING);
+        // Wake-up time first, the scheduler arms its timer when the task sleeps
         SetTaskWakeUpTime(Task, MilliSeconds);
+        SetTaskStatus(Task, TASK_STATUS_SLEEPING);
 
         UnlockMutex(MUTEX_TASK);
 
@@ -820,6 +825,105 @@ void Sleep(U32 MilliSeconds) {
 
 /************************************************************************/
 
+/**
+ * @brief Suspends the current task until a condition holds.
+ *
+ * The task is marked sleeping before the condition is checked again, both
+ * with interrupts disabled, so a WakeUpTask issued once the condition
+ * became true always finds it sleeping and no wake is lost. The condition
+ * runs with interrupts disabled and must not block.
+ *
+ * @param Condition Function telling whether the wait is over
+ * @param Context Parameter passed to Condition
+ * @param TimeOut Longest wait in milliseconds, or INFINITY
+ * @return TRUE when the condition holds, FALSE on timeout
+ */
+BOOL SleepUntil(TASK_WAIT_CONDITION Condition, LPVOID Context, UINT TimeOut) {
+    LPTASK Task = GetCurrentTask();
+    UINT Start = GetSystemTime();
+    UINT Deadline = (TimeOut == INFINITY || Start + TimeOut < Start) ? INFINITY : Start + TimeOut;
+    BOOL Result = FALSE;
+    BOOL Slept = FALSE;
+    U32 Flags;
+
+    if (Condition == NULL) return FALSE;
+
+    if (IsSystemTimeOperational() == FALSE || Task == NULL) {
+        // No scheduler yet, poll the condition
+        for (UINT Waited = 0; Condition(Context) == FALSE; Waited++) {
+            if (TimeOut != INFINITY && Waited >= TimeOut) return FALSE;
+            BusyWaitMilliseconds(1);
+        }
+
+        return TRUE;
+    }
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    FOREVER {
+        if (Condition(Context)) {
+            Result = TRUE;
+            break;
+        }
+
+        if (Task->SchedulerState.Status == TASK_STATUS_DEAD) break;
+        if (Deadline != INFINITY && GetSystemTime() >= Deadline) break;
+
+        Task->SchedulerState.WakeUpTime = Deadline;
+        SetTaskStatusDirect(Task, TASK_STATUS_SLEEPING);
+        Slept = TRUE;
+
+        // A waker that changed the condition before the task slept did not see it sleeping
+        if (Condition(Context)) {
+            SetTaskStatusDirect(Task, TASK_STATUS_RUNNING);
+            Result = TRUE;
+            break;
+        }
+
+        while (Task->SchedulerState.Status == TASK_STATUS_SLEEPING) {
+            IdleCPU();            // IdleCPU enables interrupts
+            DisableInterrupts();  // Disable immediately after
+        }
+    }
+
+    // Woken before its deadline, the task must not keep it as quantum end
+    if (Slept && Task->SchedulerState.Status != TASK_STATUS_DEAD) {
+        Task->SchedulerState.WakeUpTime = GetSystemTime();
+    }
+
+    RestoreFlags(&Flags);
+
+    return Result;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Wakes a task sleeping in Sleep or SleepUntil.
+ *
+ * Does not take the task mutex, so it may be called with interrupts
+ * disabled. No-op when the task does not sleep.
+ *
+ * @param Task Task to wake, may be NULL
+ */
+void WakeUpTask(LPTASK Task) {
+    U32 Flags;
+
+    SAFE_USE_VALID_ID(Task, KOID_TASK) {
+        SaveFlags(&Flags);
+        DisableInterrupts();
+
+        if (Task->SchedulerState.Status == TASK_STATUS_SLEEPING) {
+            (void)SetTaskSchedulerStatus(Task, TASK_STATUS_RUNNING);
+        }
+
+        RestoreFlags(&Flags);
+    }
+}
+
+/************************************************************************/
+
 /**
  * @brief Retrieves the current status of a task.
  *
@@ -904,6 +1008,7 @@ void SetTaskStatus(LPTASK Task, U32 Status) {
         FreezeScheduler();
 
         Task->SchedulerState.Status = Status;
+        SchedulerUpdateTask(Task);
 
         if (Task->SchedulerState.Status == TASK_STATUS_DEAD) {
             // Store termination state in cache before task is destroyed
@@ -933,6 +1038,7 @@ void SetTaskStatusDirect(LPTASK Task, U32 Status) {
         UNUSED(OldStatus);
 
         Task->SchedulerState.Status = Status;
+        SchedulerUpdateTask(Task);
 
         FINE_DEBUG(TEXT("[SetTaskStatusDirect] Task %p (%s): %u -> %u"), Task, Task->Name, OldStatus, Status);
     }
@@ -997,6 +1103,8 @@ void SetTaskWakeUpTime(LPTASK Task, UINT WakeupTime) {
     }
 
     UnlockMutex(&(Task->Mutex));
+
+    SchedulerUpdateTask(Task);
 }
 
 /***************************************************************************/
@@ -24,6 +24,7 @@
 
 #include "shell/Shell-Commands-Private.h"
 #include "shell/Shell-EmbeddedScripts.h"
+#include "fs/BlockIO.h"
 #include "utils/SizeFormat.h"
 
 /***************************************************************************/
@@ -214,6 +215,213 @@ U32 CMD_disk(LPSHELLCONTEXT Context) {
 
 /***************************************************************************/
 
+#define DISK_BENCH_DEFAULT_MIB 8
+#define DISK_BENCH_MAX_REQUEST N_1MB
+#define DISK_BENCH_ASYNC_REQUEST N_64KB
+#define DISK_BENCH_ASYNC_DEPTH 8
+
+/**
+ * @brief Read a span of sectors sequentially with a fixed request size.
+ * @param Disk Disk to read.
+ * @param FirstSector First sector of the span.
+ * @param SectorCount Number of sectors in the span.
+ * @param RequestSectors Sectors per read request.
+ * @param Buffer Buffer of at least RequestSectors sectors.
+ * @param Elapsed Receives the elapsed time in milliseconds.
+ * @return DF_RETURN_SUCCESS or the first driver error.
+ */
+static U32 DiskBenchPass(
+    LPSTORAGE_UNIT Disk, U32 FirstSector, U32 SectorCount, U32 RequestSectors, LPVOID Buffer, UINT* Elapsed) {
+    IOCONTROL Control;
+    UINT Start = GetSystemTime();
+    U32 Done = 0;
+
+    while (Done < SectorCount) {
+        U32 Count = SectorCount - Done;
+        U32 Result;
+
+        if (Count > RequestSectors) Count = RequestSectors;
+
+        Control.TypeID = KOID_IOCONTROL;
+        Control.Disk = Disk;
+        Control.SectorLow = FirstSector + Done;
+        Control.SectorHigh = 0;
+        Control.NumSectors = Count;
+        Control.Buffer = Buffer;
+        Control.BufferSize = Count * SECTOR_SIZE;
+
+        Result = Disk->Driver->Command(DF_DISK_READ, (UINT)&Control);
+        if (Result != DF_RETURN_SUCCESS) return Result;
+
+        Done += Count;
+    }
+
+    *Elapsed = GetSystemTime() - Start;
+    return DF_RETURN_SUCCESS;
+}
+
+/***************************************************************************/
+
+/**
+ * @brief Read a span of sectors with several asynchronous requests in flight.
+ *
+ * Adjacent requests are submitted together so that the block I/O queue can
+ * merge them into larger driver commands.
+ *
+ * @param Disk Disk to read.
+ * @param FirstSector First sector of the span.
+ * @param SectorCount Number of sectors in the span.
+ * @param Buffer Buffer of at least DISK_BENCH_ASYNC_DEPTH requests.
+ * @param Elapsed Receives the elapsed time in milliseconds.
+ * @return DF_RETURN_SUCCESS or the first driver error.
+ */
+static U32 DiskBenchAsyncPass(LPSTORAGE_UNIT Disk, U32 FirstSector, U32 SectorCount, LPVOID Buffer, UINT* Elapsed) {
+    BLOCK_REQUEST Requests[DISK_BENCH_ASYNC_DEPTH];
+    U32 RequestSectors = DISK_BENCH_ASYNC_REQUEST / SECTOR_SIZE;
+    UINT Start = GetSystemTime();
+    U32 Done = 0;
+
+    while (Done < SectorCount) {
+        U32 Result = DF_RETURN_SUCCESS;
+        UINT Submitted = 0;
+
+        for (; Submitted < DISK_BENCH_ASYNC_DEPTH && Done < SectorCount; Submitted++) {
+            U32 Count = SectorCount - Done;
+
+            if (Count > RequestSectors) Count = RequestSectors;
+
+            BlockRequestInit(&(Requests[Submitted]), Disk, FirstSector + Done, 0, Count,
+                (U8*)Buffer + (Submitted * DISK_BENCH_ASYNC_REQUEST), Count * SECTOR_SIZE, FALSE, 0);
+            BlockIOSubmit(&(Requests[Submitted]));
+
+            Done += Count;
+        }
+
+        for (UINT Index = 0; Index < Submitted; Index++) {
+            BlockIOWait(&(Requests[Index]), INFINITY);
+            if (Result == DF_RETURN_SUCCESS) Result = Requests[Index].Result;
+            BlockRequestRelease(&(Requests[Index]));
+        }
+
+        if (Result != DF_RETURN_SUCCESS) return Result;
+    }
+
+    *Elapsed = GetSystemTime() - Start;
+    return DF_RETURN_SUCCESS;
+}
+
+/***************************************************************************/
+
+U32 CMD_diskbench(LPSHELLCONTEXT Context) {
+    static const U32 RequestBytes[] = {N_4KB, N_64KB, N_1MB};
+    LPLIST DiskList = GetDiskList();
+    LPSTORAGE_UNIT Disk;
+    DISKINFO Info;
+    LINEAR Buffer;
+    U32 DiskIndex = 0;
+    U32 MegaBytes = DISK_BENCH_DEFAULT_MIB;
+    U32 PassSectors;
+    U32 DiskSectors;
+    BOOL Failed = FALSE;
+
+    ParseNextCommandLineComponent(Context);
+    if (StringLength(Context->Command) != 0) {
+        DiskIndex = StringToU32(Context->Command);
+
+        ParseNextCommandLineComponent(Context);
+        if (StringLength(Context->Command) != 0) {
+            MegaBytes = StringToU32(Context->Command);
+        }
+    }
+
+    Disk = (LPSTORAGE_UNIT)ListGetItem(DiskList, DiskIndex);
+    if (Disk == NULL || Disk->Driver == NULL || MegaBytes == 0) {
+        ConsolePrint(TEXT("Usage: disk_bench [DiskIndex] [MiB]\n"));
+        return DF_RETURN_SUCCESS;
+    }
+
+    Info.Disk = Disk;
+    if (Disk->Driver->Command(DF_DISK_GETINFO, (UINT)&Info) != DF_RETURN_SUCCESS ||
+        Info.BytesPerSector != SECTOR_SIZE) {
+        ConsolePrint(TEXT("Unable to query disk %u\n"), DiskIndex);
+        return DF_RETURN_SUCCESS;
+    }
+
+    // Each pass reads its own span so that no pass is served by a cache
+    DiskSectors = U64_ToU32_Clip(Info.NumSectors);
+    PassSectors = MegaBytes * (N_1MB / SECTOR_SIZE);
+    if (PassSectors > DiskSectors / 4) {
+        PassSectors = (DiskSectors / 4) & ~((N_1MB / SECTOR_SIZE) - 1);
+    }
+
+    if (PassSectors == 0) {
+        ConsolePrint(TEXT("Disk %u is too small\n"), DiskIndex);
+        return DF_RETURN_SUCCESS;
+    }
+
+    Buffer = AllocKernelRegion(
+        0, DISK_BENCH_MAX_REQUEST, ALLOC_PAGES_COMMIT | ALLOC_PAGES_READWRITE, TEXT("DiskBench"));
+    if (Buffer == 0) {
+        ConsolePrint(TEXT("Out of memory\n"));
+        return DF_RETURN_SUCCESS;
+    }
+
+    ConsolePrint(TEXT("Disk %u (%s): %u KiB per pass\n"), DiskIndex, Disk->Driver->Product,
+        PassSectors / (N_1KB / SECTOR_SIZE));
+
+    for (UINT Pass = 0; Pass < sizeof(RequestBytes) / sizeof(RequestBytes[0]); Pass++) {
+        UINT Elapsed = 0;
+        U32 Result = DiskBenchPass(
+            Disk, Pass * PassSectors, PassSectors, RequestBytes[Pass] / SECTOR_SIZE, (LPVOID)Buffer, &Elapsed);
+
+        if (Result != DF_RETURN_SUCCESS) {
+            ConsolePrint(TEXT("%u KiB requests: read error %x\n"), RequestBytes[Pass] / N_1KB, Result);
+            Failed = TRUE;
+            break;
+        }
+
+        if (Elapsed == 0) Elapsed = 1;
+
+        ConsolePrint(TEXT("%u KiB requests: %u ms, %u KiB/s\n"), RequestBytes[Pass] / N_1KB, Elapsed,
+            ((PassSectors / (N_1KB / SECTOR_SIZE)) * 1000) / Elapsed);
+    }
+
+    // Last span: queued requests, merged by the block I/O layer
+    if (Failed == FALSE) {
+        BLOCK_IO_INFO Before;
+        BLOCK_IO_INFO After;
+        UINT Elapsed = 0;
+        U32 Pass = sizeof(RequestBytes) / sizeof(RequestBytes[0]);
+        U32 Result;
+
+        MemorySet(&Before, 0, sizeof(Before));
+        MemorySet(&After, 0, sizeof(After));
+        BlockIOGetInfo(Disk, &Before);
+
+        Result = DiskBenchAsyncPass(Disk, Pass * PassSectors, PassSectors, (LPVOID)Buffer, &Elapsed);
+
+        if (Result != DF_RETURN_SUCCESS) {
+            ConsolePrint(TEXT("%u x %u KiB queued: read error %x\n"), DISK_BENCH_ASYNC_DEPTH,
+                DISK_BENCH_ASYNC_REQUEST / N_1KB, Result);
+        } else {
+            if (Elapsed == 0) Elapsed = 1;
+
+            BlockIOGetInfo(Disk, &After);
+
+            ConsolePrint(TEXT("%u x %u KiB queued: %u ms, %u KiB/s, %u commands, %u merged\n"),
+                DISK_BENCH_ASYNC_DEPTH, DISK_BENCH_ASYNC_REQUEST / N_1KB, Elapsed,
+                ((PassSectors / (N_1KB / SECTOR_SIZE)) * 1000) / Elapsed, After.Commands - Before.Commands,
+                After.Merged - Before.Merged);
+        }
+    }
+
+    FreeRegion(Buffer, DISK_BENCH_MAX_REQUEST);
+
+    return DF_RETURN_SUCCESS;
+}
+
+/***************************************************************************/
+
 U32 CMD_filesystem(LPSHELLCONTEXT Context) {
     BOOL LongMode;
 
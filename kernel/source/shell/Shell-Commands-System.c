@@ -25,6 +25,7 @@
 #include "shell/Shell-Commands-Private.h"
 #include "shell/Shell-EmbeddedScripts.h"
 #include "autotest/Autotest.h"
+#include "memory/Slab.h"
 #include "utils/SizeFormat.h"
 
 /***************************************************************************/
@@ -213,6 +214,51 @@ U32 CMD_shutdown(LPSHELLCONTEXT Context) {
 
 /************************************************************************/
 
+/**
+ * @brief Print the hit and miss counters of every slab cache.
+ * @param Context Shell context.
+ * @return DF_RETURN_SUCCESS.
+ */
+U32 CMD_slab(LPSHELLCONTEXT Context) {
+    SLAB_CACHE_INFO Info;
+    UINT Count = SlabGetCacheCount();
+
+    UNUSED(Context);
+
+    if (Count == 0) {
+        ConsolePrint(TEXT("No slab cache in use.\n"));
+    }
+
+    for (UINT Index = 0; Index < Count; Index++) {
+        if (SlabGetCacheInfo(Index, &Info) == FALSE) {
+            continue;
+        }
+
+        ConsolePrint(
+            TEXT("%-14s size=%u hits=%u misses=%u fallbacks=%u frees=%u used=%u/%u slabs=%u magazine=%u\n"),
+            Info.Name,
+            Info.ObjectSize,
+            Info.Hits,
+            Info.Misses,
+            Info.Fallbacks,
+            Info.Frees,
+            Info.InUse,
+            Info.Capacity,
+            Info.SlabCount,
+            Info.MagazineCount);
+    }
+
+    ConsolePrint(TEXT("Kernel heap magazines:"));
+    for (UINT SizeClass = 0; SizeClass < HEAP_MAGAZINE_CLASSES; SizeClass++) {
+        ConsolePrint(TEXT(" %u"), KernelProcess.HeapMagazines[SizeClass].Count);
+    }
+    ConsolePrint(TEXT("\n"));
+
+    return DF_RETURN_SUCCESS;
+}
+
+/************************************************************************/
+
 /**
  * @brief Print one profiling snapshot entry.
  * @param Entry Snapshot entry to print.
@@ -303,17 +349,20 @@ U32 CMD_autotest(LPSHELLCONTEXT Context) {
 
     ParseNextCommandLineComponent(Context);
 
-    if (StringLength(Context->Command) == 0 || StringCompareNC(Context->Command, TEXT("stack")) != 0) {
-        ConsolePrint(TEXT("Usage: autotest stack\n"));
+    if (StringLength(Context->Command) != 0 && StringCompareNC(Context->Command, TEXT("stack")) == 0) {
+        Result = RunSingleTestByName(TEXT("TestCopyStack"));
+    } else if (StringLength(Context->Command) != 0 && StringCompareNC(Context->Command, TEXT("memory")) == 0) {
+        // Latency percentiles go to the kernel log
+        Result = RunSingleTestByName(TEXT("TestMemoryStress"));
+    } else {
+        ConsolePrint(TEXT("Usage: autotest stack|memory\n"));
         return DF_RETURN_SUCCESS;
     }
 
-    Result = RunSingleTestByName(TEXT("TestCopyStack"));
-
     if (Result) {
-        ConsolePrint(TEXT("autotest stack: passed\n"));
+        ConsolePrint(TEXT("autotest %s: passed\n"), Context->Command);
     } else {
-        ConsolePrint(TEXT("autotest stack: failed\n"));
+        ConsolePrint(TEXT("autotest %s: failed\n"), Context->Command);
     }
 
     return DF_RETURN_SUCCESS;
@@ -27,7 +27,7 @@
 
 SHELL_COMMAND_ENTRY COMMANDS[] = {
     {"add_user", "new_user", "username", "Create user account", CMD_adduser},
-    {"autotest", "autotest", "stack", "Run built-in tests", CMD_autotest},
+    {"autotest", "autotest", "stack|memory", "Run built-in tests", CMD_autotest},
     {"cd", "cd", "Name", "Change current folder", CMD_cd},
     {"clear", "cls", "", "Clear console screen", CMD_cls},
     {"commands", "help", "", "List available commands", CMD_commands},
@@ -37,6 +37,7 @@ SHELL_COMMAND_ENTRY COMMANDS[] = {
     {"del_user", "delete_user", "username", "Remove user account", CMD_deluser},
     {"dis", "disasm", "Address InstructionCount", "Disassemble memory range", CMD_disasm},
     {"disk", "disk", "", "Show disk information", CMD_disk},
+    {"disk_bench", "disk_bench", "[DiskIndex] [MiB]", "Measure sequential disk read throughput", CMD_diskbench},
     {"drv", "driver", "list|Alias", "Show driver details", CMD_driver},
     {"desktop", "desktop", "show|status|theme <path-or-name>", "Control desktop and theme runtime", CMD_desktop},
     {"edit", "edit", "Name", "Open text editor", CMD_edit},
@@ -59,6 +60,7 @@ SHELL_COMMAND_ENTRY COMMANDS[] = {
     {"reboot", "reboot", "", "Reboot system", CMD_reboot},
     {"run", "launch", "Name [-b|--background]", "Launch executable", CMD_run},
     {"shutdown", "power_off", "", "Power off system", CMD_shutdown},
+    {"slab", "slab_info", "", "Show slab cache statistics", CMD_slab},
     {"sys", "sys_info", "", "Show system information", CMD_sysinfo},
     {"task", "task", "list", "List visible tasks", CMD_task},
     {"type", "show", "", "Show file content", CMD_type},
@@ -297,8 +297,8 @@ UINT LockMutex(LPMUTEX Mutex, UINT TimeOut) {
                             //-------------------------------------
                             // Sleep with proper interrupt handling
 
-                            SetTaskStatusDirect(Task, TASK_STATUS_SLEEPING);
                             Task->SchedulerState.WakeUpTime = GetSystemTime() + MUTEX_WAIT_SLEEP_INTERVAL_MS;
+                            SetTaskStatusDirect(Task, TASK_STATUS_SLEEPING);
 
                             // Keep interrupts disabled during critical section
                             while (Task->SchedulerState.Status == TASK_STATUS_SLEEPING) {
@@ -29,6 +29,7 @@
 #include "core/Kernel.h"
 #include "log/Log.h"
 #include "process/Schedule.h"
+#include "system/ClockEvent.h"
 #include "text/CoreString.h"
 #include "system/System.h"
 #include "text/Text.h"
@@ -69,12 +70,10 @@ LPDRIVER ClockGetDriver(void) {
 // Timer resolution
 
 #define DIVISOR 11932
-#define MILLIS 10
 #define SCHEDULING_PERIOD_MILLIS 10
 
 /************************************************************************/
 
-static UINT DATA_SECTION SystemUpTime = 0;
 static UINT DATA_SECTION SchedulerTime = 0;
 static BOOL DATA_SECTION SystemTimeOperational = FALSE;
 static DATETIME DATA_SECTION CurrentTime;
@@ -139,12 +138,14 @@ void InitializeClock(void) {
 
     EnableInterrupt(0);
     InitializeLocalTime();
+
+    // Hand over to the local APIC timer when possible
+    InitializeClockEvents();
 }
 
 /************************************************************************/
 
 void ManageLocalTime(void) {
-    CurrentTime.Milli -= 1000;
     CurrentTime.Second++;
 
     if (CurrentTime.Second >= 60) {
@@ -180,7 +181,11 @@ void ManageLocalTime(void) {
 /************************************************************************/
 
 /**
- * @brief Increment the internal millisecond counter.
+ * @brief Account elapsed time and run the scheduler.
+ *
+ * With the PIT the scheduler runs every minimum quantum. With a one-shot
+ * device every interrupt is a scheduling point and the scheduler programs the
+ * next one.
  */
 void ClockHandler(void) {
 #if SCHEDULING_DEBUG_OUTPUT == 1
@@ -191,14 +196,27 @@ void ClockHandler(void) {
     }
 #endif
 
-    SystemUpTime += MILLIS;
-    SchedulerTime += MILLIS;
-    CurrentTime.Milli += MILLIS;
+    UINT Elapsed = ClockEventUpdate();
+    UINT Milli = CurrentTime.Milli + Elapsed;
+
+    SchedulerTime += Elapsed;
 
-    if (CurrentTime.Milli >= 1000) {
+    while (Milli >= 1000) {
+        Milli -= 1000;
         ManageLocalTime();
     }
 
+    CurrentTime.Milli = Milli;
+
+    if (ClockEventIsOneShot()) {
+        // Keep ticking if the scheduler is frozen and does not program anything
+        ClockEventSetNext(GetSystemTime() + SCHEDULING_PERIOD_MILLIS);
+
+        SchedulerTime = 0;
+        Scheduler();
+        return;
+    }
+
     UINT MinimumQuantum = GetMinimumQuantum();
 
     if (SchedulerTime >= (MinimumQuantum + SCHEDULING_PERIOD_MILLIS)) {
@@ -206,11 +224,6 @@ void ClockHandler(void) {
         Scheduler();
     }
 
-    /*
-    if (SystemUpTime % 1000 == 0) {
-        DEBUG(TEXT("[ClockHandler] Time = %d"), SystemUpTime);
-    }
-    */
 }
 
 /************************************************************************/
@@ -219,7 +232,18 @@ void ClockHandler(void) {
  * @brief Retrieve the current system time in milliseconds.
  * @return Number of milliseconds since startup.
  */
-UINT GetSystemTime(void) { return SystemUpTime; }
+UINT GetSystemTime(void) { return ClockEventGetMilliseconds(); }
+
+/************************************************************************/
+
+/**
+ * @brief Retrieve the current system time in microseconds.
+ *
+ * Sub-millisecond precision requires the TSC, see ClockEvent.c.
+ *
+ * @return Number of microseconds since startup.
+ */
+U64 GetSystemTimeMicroseconds(void) { return ClockEventGetMicroseconds(); }
 
 /************************************************************************/
 
@@ -0,0 +1,415 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Clock events
+
+\************************************************************************/
+
+#include "system/ClockEvent.h"
+
+#include "Arch.h"
+#include "drivers/interrupts/InterruptController.h"
+#include "drivers/interrupts/LocalAPIC.h"
+#include "log/Log.h"
+#include "system/System.h"
+
+/************************************************************************/
+
+#define CLOCK_EVENT_PIT_FREQUENCY 1193182
+#define CLOCK_EVENT_CALIBRATION_MS 50
+#define CLOCK_EVENT_CALIBRATION_LOOPS 100000000
+#define CLOCK_EVENT_MIN_DELAY_US 50
+
+// The local APIC timer shares the PIT vector, so Interrupt_Clock serves both
+#define CLOCK_EVENT_VECTOR 0x20
+
+#define CLOCK_GATE_CHANNEL2 0x01
+#define CLOCK_GATE_SPEAKER 0x02
+#define CLOCK_GATE_OUTPUT2 0x20
+
+typedef struct tag_CPUIDREGISTERS {
+    U32 reg_EAX;
+    U32 reg_EBX;
+    U32 reg_ECX;
+    U32 reg_EDX;
+} CPUIDREGISTERS, *LPCPUIDREGISTERS;
+
+typedef struct tag_CLOCK_EVENT_STATE {
+    U32 Mode;               // Active event device (CLOCK_EVENT_MODE_*)
+    BOOL TscReady;          // TSC calibrated and used as time source
+    U32 TscPerMilli;        // TSC ticks per millisecond
+    U32 TscPerMicro;        // TSC ticks per microsecond, rounded down
+    U32 LapicPerMilli;      // Local APIC timer counts per millisecond (divide by 16)
+    U64 BaseTsc;            // TSC value at BaseMilli
+    UINT BaseMilli;         // Milliseconds since boot at BaseTsc
+    UINT TickMilli;         // Milliseconds counted by PIT interrupts, used without TSC
+    UINT LastMilli;         // Time seen by the previous ClockEventUpdate
+    UINT NextDeadline;      // Programmed one-shot deadline, INFINITY when none
+} CLOCK_EVENT_STATE, *LPCLOCK_EVENT_STATE;
+
+/************************************************************************/
+
+static CLOCK_EVENT_STATE DATA_SECTION ClockEvents = {
+    .Mode = CLOCK_EVENT_MODE_PIT_PERIODIC,
+    .TscReady = FALSE,
+    .TscPerMilli = 0,
+    .TscPerMicro = 0,
+    .LapicPerMilli = 0,
+    .BaseMilli = 0,
+    .TickMilli = 0,
+    .LastMilli = 0,
+    .NextDeadline = INFINITY};
+
+/************************************************************************/
+
+/**
+ * @brief Fold whole elapsed milliseconds of the TSC into the time base.
+ *
+ * Caller must have interrupts disabled.
+ *
+ * @return TSC ticks elapsed since the last whole millisecond.
+ */
+static U32 ClockEventRebase(void) {
+    U64 Delta = U64_Sub(ReadTimeStampCounter(), ClockEvents.BaseTsc);
+    U32 Remainder;
+    UINT Milli;
+
+    if (U64_High32(Delta) == 0) {
+        Milli = U64_Low32(Delta) / ClockEvents.TscPerMilli;
+        Remainder = U64_Low32(Delta) % ClockEvents.TscPerMilli;
+    } else {
+        Milli = U64_ToUINT(U64_DIV_U32(Delta, ClockEvents.TscPerMilli, &Remainder));
+    }
+
+    if (Milli != 0) {
+        ClockEvents.BaseMilli += Milli;
+        ClockEvents.BaseTsc = U64_Add(ClockEvents.BaseTsc, U64_MUL_U32((U32)Milli, ClockEvents.TscPerMilli));
+    }
+
+    return Remainder;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Measure the TSC and local APIC timer rates against PIT channel 2.
+ *
+ * Channel 2 runs once in mode 0 for CLOCK_EVENT_CALIBRATION_MS with the
+ * speaker disconnected, its output bit rises on terminal count.
+ *
+ * @param UseLocalApic TRUE to measure the local APIC timer too.
+ * @return TRUE when the PIT reached terminal count.
+ */
+static BOOL ClockEventCalibrate(BOOL UseLocalApic) {
+    U32 PitCount = (CLOCK_EVENT_PIT_FREQUENCY / 1000) * CLOCK_EVENT_CALIBRATION_MS;
+    U8 Gate = (U8)InPortByte(CLOCK_GATE_CONTROL);
+    U64 TscStart;
+    U64 TscDelta;
+    U32 LapicEnd = 0;
+    UINT Loops = 0;
+
+    OutPortByte(CLOCK_GATE_CONTROL, (U8)((Gate & ~CLOCK_GATE_SPEAKER) | CLOCK_GATE_CHANNEL2));
+
+    // Channel 2, low then high byte, mode 0 (interrupt on terminal count)
+    OutPortByte(CLOCK_COMMAND, 0xB0);
+    OutPortByte(CLOCK_CHANNEL2_DATA, (U8)(PitCount >> 0));
+    OutPortByte(CLOCK_CHANNEL2_DATA, (U8)(PitCount >> 8));
+
+    if (UseLocalApic) {
+        WriteLocalAPICRegister(LOCAL_APIC_TIMER_DCR, LOCAL_APIC_TIMER_DIVIDE_BY_16);
+        WriteLocalAPICRegister(LOCAL_APIC_LVT_TIMER, LOCAL_APIC_LVT_MASK | CLOCK_EVENT_VECTOR);
+        WriteLocalAPICRegister(LOCAL_APIC_TIMER_ICR, 0xFFFFFFFF);
+    }
+
+    TscStart = ReadTimeStampCounter();
+
+    while ((InPortByte(CLOCK_GATE_CONTROL) & CLOCK_GATE_OUTPUT2) == 0) {
+        if (++Loops >= CLOCK_EVENT_CALIBRATION_LOOPS) break;
+    }
+
+    TscDelta = U64_Sub(ReadTimeStampCounter(), TscStart);
+
+    if (UseLocalApic) {
+        LapicEnd = ReadLocalAPICRegister(LOCAL_APIC_TIMER_CCR);
+        WriteLocalAPICRegister(LOCAL_APIC_TIMER_ICR, 0);
+    }
+
+    OutPortByte(CLOCK_GATE_CONTROL, Gate);
+
+    if (Loops >= CLOCK_EVENT_CALIBRATION_LOOPS) {
+        WARNING(TEXT("[ClockEventCalibrate] PIT channel 2 did not expire"));
+        return FALSE;
+    }
+
+    ClockEvents.TscPerMilli = U64_ToUINT(U64_DIV_U32(TscDelta, CLOCK_EVENT_CALIBRATION_MS, NULL));
+    ClockEvents.TscPerMicro = ClockEvents.TscPerMilli / 1000;
+
+    if (UseLocalApic) {
+        ClockEvents.LapicPerMilli = (0xFFFFFFFF - LapicEnd) / CLOCK_EVENT_CALIBRATION_MS;
+    }
+
+    return TRUE;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Calibrate the clock sources and select the event device.
+ *
+ * The TSC becomes the time source when present. The local APIC timer takes
+ * over from the PIT only in I/O APIC mode, where the clock interrupt is
+ * acknowledged at the local APIC, using TSC-deadline mode when the CPU has
+ * it. The PIT keeps its 10 ms period otherwise.
+ */
+void InitializeClockEvents(void) {
+    CPUIDREGISTERS Regs[4];
+    LPLOCAL_APIC_CONFIG LocalApic = GetLocalAPICConfig();
+    BOOL HasTsc;
+    BOOL HasTscDeadline;
+    BOOL UseLocalApic;
+    U32 Flags;
+
+    GetCPUID(Regs);
+
+    HasTsc = (Regs[1].reg_EDX & INTEL_CPU_FEAT_TSC) != 0;
+    HasTscDeadline = (Regs[1].reg_ECX & INTEL_CPU_FEAT_ECX_TSC_DEADLINE) != 0;
+    UseLocalApic = (LocalApic != NULL && LocalApic->Present && IsIOAPICModeActive());
+
+    if (HasTsc == FALSE) {
+        DEBUG(TEXT("[InitializeClockEvents] No TSC, keeping the PIT"));
+        return;
+    }
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    if (ClockEventCalibrate(UseLocalApic) == FALSE || ClockEvents.TscPerMicro == 0) {
+        RestoreFlags(&Flags);
+        return;
+    }
+
+    // Continue from the time already counted by the PIT
+    ClockEvents.BaseTsc = ReadTimeStampCounter();
+    ClockEvents.BaseMilli = ClockEvents.TickMilli;
+    ClockEvents.LastMilli = ClockEvents.TickMilli;
+    ClockEvents.TscReady = TRUE;
+
+    if (UseLocalApic && HasTscDeadline) {
+        ClockEvents.Mode = CLOCK_EVENT_MODE_TSC_DEADLINE;
+        WriteLocalAPICRegister(LOCAL_APIC_LVT_TIMER, LOCAL_APIC_LVT_TIMER_TSC_DEADLINE | CLOCK_EVENT_VECTOR);
+    } else if (UseLocalApic && ClockEvents.LapicPerMilli != 0) {
+        ClockEvents.Mode = CLOCK_EVENT_MODE_LAPIC_ONESHOT;
+        WriteLocalAPICRegister(LOCAL_APIC_TIMER_DCR, LOCAL_APIC_TIMER_DIVIDE_BY_16);
+        WriteLocalAPICRegister(LOCAL_APIC_LVT_TIMER, LOCAL_APIC_LVT_TIMER_ONESHOT | CLOCK_EVENT_VECTOR);
+    }
+
+    if (ClockEvents.Mode != CLOCK_EVENT_MODE_PIT_PERIODIC) {
+        DisableInterrupt(0);
+        ClockEventSetNext(ClockEvents.BaseMilli + CLOCK_EVENT_PIT_PERIOD_MS);
+    }
+
+    RestoreFlags(&Flags);
+
+    DEBUG(TEXT("[InitializeClockEvents] Mode %u, TSC %u kHz, LAPIC timer %u counts/ms"), ClockEvents.Mode,
+        ClockEvents.TscPerMilli, ClockEvents.LapicPerMilli);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Return the active event device.
+ * @return CLOCK_EVENT_MODE_* value.
+ */
+U32 ClockEventGetMode(void) { return ClockEvents.Mode; }
+
+/************************************************************************/
+
+/**
+ * @brief Tell whether events are programmed one at a time.
+ * @return TRUE for the local APIC modes.
+ */
+BOOL ClockEventIsOneShot(void) { return ClockEvents.Mode != CLOCK_EVENT_MODE_PIT_PERIODIC; }
+
+/************************************************************************/
+
+/**
+ * @brief Return the calibrated TSC frequency.
+ * @return Frequency in kHz, 0 when the TSC is not the time source.
+ */
+U32 ClockEventGetTscKHz(void) { return ClockEvents.TscReady ? ClockEvents.TscPerMilli : 0; }
+
+/************************************************************************/
+
+/**
+ * @brief Account one clock interrupt.
+ *
+ * Called from the clock interrupt with interrupts disabled. A fired one-shot
+ * event is considered consumed until the next ClockEventSetNext.
+ *
+ * @return Milliseconds elapsed since the previous call.
+ */
+UINT ClockEventUpdate(void) {
+    UINT Now;
+    UINT Elapsed;
+
+    if (ClockEvents.TscReady) {
+        (void)ClockEventRebase();
+        Now = ClockEvents.BaseMilli;
+    } else {
+        ClockEvents.TickMilli += CLOCK_EVENT_PIT_PERIOD_MS;
+        Now = ClockEvents.TickMilli;
+    }
+
+    Elapsed = Now - ClockEvents.LastMilli;
+    ClockEvents.LastMilli = Now;
+    ClockEvents.NextDeadline = INFINITY;
+
+    return Elapsed;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Return the monotonic time in milliseconds.
+ *
+ * Reads the TSC when calibrated, so the value keeps moving between clock
+ * interrupts even when none is due for a long time.
+ *
+ * @return Milliseconds since startup.
+ */
+UINT ClockEventGetMilliseconds(void) {
+    U32 Flags;
+    UINT Now;
+
+    if (ClockEvents.TscReady == FALSE) return ClockEvents.TickMilli;
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+    (void)ClockEventRebase();
+    Now = ClockEvents.BaseMilli;
+    RestoreFlags(&Flags);
+
+    return Now;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Return the monotonic time in microseconds.
+ *
+ * Without TSC the value only moves by whole PIT periods.
+ *
+ * @return Microseconds since startup.
+ */
+U64 ClockEventGetMicroseconds(void) {
+    U32 Flags;
+    U32 Remainder;
+    U32 Micro;
+    UINT Milli;
+
+    if (ClockEvents.TscReady == FALSE) return U64_MUL_U32((U32)ClockEvents.TickMilli, 1000);
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+    Remainder = ClockEventRebase();
+    Milli = ClockEvents.BaseMilli;
+    RestoreFlags(&Flags);
+
+    Micro = Remainder / ClockEvents.TscPerMicro;
+    if (Micro > 999) Micro = 999;
+
+    return U64_Add(U64_MUL_U32((U32)Milli, 1000), U64_FromU32(Micro));
+}
+
+/************************************************************************/
+
+/**
+ * @brief Program the next one-shot event.
+ *
+ * Deadlines in the past fire after CLOCK_EVENT_MIN_DELAY_US, deadlines past
+ * CLOCK_EVENT_MAX_INTERVAL_MS are clamped to it. No-op with the PIT.
+ *
+ * @param Deadline Absolute time in milliseconds, INFINITY for none.
+ */
+void ClockEventSetNext(UINT Deadline) {
+    U32 Flags;
+    U32 Remainder;
+    UINT Now;
+
+    if (ClockEventIsOneShot() == FALSE) return;
+
+    SaveFlags(&Flags);
+    DisableInterrupts();
+
+    Remainder = ClockEventRebase();
+    Now = ClockEvents.BaseMilli;
+
+    if (Deadline == INFINITY || (Deadline > Now && Deadline - Now > CLOCK_EVENT_MAX_INTERVAL_MS)) {
+        Deadline = Now + CLOCK_EVENT_MAX_INTERVAL_MS;
+    }
+
+    ClockEvents.NextDeadline = Deadline;
+
+    if (ClockEvents.Mode == CLOCK_EVENT_MODE_TSC_DEADLINE) {
+        U64 Target;
+
+        if (Deadline > Now) {
+            Target = U64_Add(ClockEvents.BaseTsc, U64_MUL_U32((U32)(Deadline - Now), ClockEvents.TscPerMilli));
+        } else {
+            Target = U64_Add(ClockEvents.BaseTsc, U64_FromU32(Remainder + ClockEvents.TscPerMicro * CLOCK_EVENT_MIN_DELAY_US));
+        }
+
+        WriteMSR64(IA32_TSC_DEADLINE_MSR, U64_Low32(Target), U64_High32(Target));
+    } else {
+        U32 DelayMicro = CLOCK_EVENT_MIN_DELAY_US;
+        U32 Count;
+
+        if (Deadline > Now) {
+            U32 Elapsed = Remainder / ClockEvents.TscPerMicro;
+            U32 Total = (U32)(Deadline - Now) * 1000;
+
+            if (Total > Elapsed + CLOCK_EVENT_MIN_DELAY_US) DelayMicro = Total - Elapsed;
+        }
+
+        Count = (DelayMicro / 1000) * ClockEvents.LapicPerMilli + ((DelayMicro % 1000) * ClockEvents.LapicPerMilli) / 1000;
+        if (Count == 0) Count = 1;
+
+        WriteLocalAPICRegister(LOCAL_APIC_TIMER_ICR, Count);
+    }
+
+    RestoreFlags(&Flags);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Bring the next one-shot event forward.
+ *
+ * Used when a timer is armed outside the clock interrupt, so a CPU idling
+ * until a later event still wakes up in time. No-op with the PIT.
+ *
+ * @param Deadline Absolute time in milliseconds.
+ */
+void ClockEventRequest(UINT Deadline) {
+    if (ClockEventIsOneShot() == FALSE) return;
+
+    if (Deadline < ClockEvents.NextDeadline) {
+        ClockEventSetNext(Deadline);
+    }
+}
@@ -3422,6 +3422,24 @@ UINT SysCall_SocketGetSocketName(UINT Parameter) {
 
 /************************************************************************/
 
+/**
+ * @brief Wait until some sockets are ready for the requested events.
+ *
+ * @param Parameter Pointer to SOCKET_POLL_INFO buffer, ReadyEvents is filled.
+ * @return UINT Number of ready entries, 0 on time out, or error code.
+ */
+UINT SysCall_SocketPoll(UINT Parameter) {
+    LPSOCKET_POLL_INFO Info = (LPSOCKET_POLL_INFO)Parameter;
+
+    SAFE_USE_INPUT_POINTER(Info, SOCKET_POLL_INFO) {
+        return SocketPoll(Info->Entries, Info->Count, Info->TimeOut);
+    }
+
+    return DF_RETURN_BAD_PARAMETER;
+}
+
+/************************************************************************/
+
 UINT SystemCallHandler(U32 Function, UINT Parameter) {
     if (Function >= SYSCALL_Last || SysCallTable[Function].Function == NULL) {
         return 0;
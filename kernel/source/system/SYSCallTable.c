@@ -61,6 +61,7 @@ void InitializeSystemCallTable(void) {
     SysCallTable[SYSCALL_SocketSetOption] = (SYSCALL_ENTRY){SysCall_SocketSetOption, EXOS_PRIVILEGE_USER};
     SysCallTable[SYSCALL_SocketGetPeerName] = (SYSCALL_ENTRY){SysCall_SocketGetPeerName, EXOS_PRIVILEGE_USER};
     SysCallTable[SYSCALL_SocketGetSocketName] = (SYSCALL_ENTRY){SysCall_SocketGetSocketName, EXOS_PRIVILEGE_USER};
+    SysCallTable[SYSCALL_SocketPoll] = (SYSCALL_ENTRY){SysCall_SocketPoll, EXOS_PRIVILEGE_USER};
 
     // Time Services
     SysCallTable[SYSCALL_GetSystemTime] = (SYSCALL_ENTRY){SysCall_GetSystemTime, EXOS_PRIVILEGE_USER};
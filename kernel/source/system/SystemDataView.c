@@ -33,6 +33,8 @@
 #include "drivers/storage/USBStorage.h"
 #include "drivers/usb/XHCI-Internal.h"
 #include "core/KernelData.h"
+#include "fs/BlockCache.h"
+#include "memory/PageFrameCache.h"
 #include "network/Network.h"
 #include "network/NetworkManager.h"
 #include "process/Task.h"
@@ -44,7 +46,7 @@
 /************************************************************************/
 // Macros
 
-#define SYSTEM_DATA_VIEW_PAGE_COUNT 14
+#define SYSTEM_DATA_VIEW_PAGE_COUNT 16
 #define SYSTEM_DATA_VIEW_OUTPUT_BUFFER_SIZE 32768
 #define SYSTEM_DATA_VIEW_OUTPUT_MAX_LINES 1024
 #define SYSTEM_DATA_VIEW_VALUE_COLUMN 24
@@ -2131,6 +2133,83 @@ static void SystemDataViewDrawPageGdt(LPSYSTEM_DATA_VIEW_CONTEXT Context, U8 Pag
 
 /************************************************************************/
 
+/**
+ * @brief Draw the physical page cache page for System Data View.
+ *
+ * @param Context Output context.
+ * @param PageIndex Page index.
+ */
+static void SystemDataViewDrawPagePageFrameCache(LPSYSTEM_DATA_VIEW_CONTEXT Context, U8 PageIndex) {
+    SystemDataViewDrawPageHeader(Context, TEXT("Page Frame Cache"), PageIndex);
+    SystemDataViewWriteFormat(Context, SYSTEM_DATA_VIEW_VALUE_COLUMN, TEXT("Physical Used"),
+        TEXT("%u KB\n"), (U32)(GetPhysicalMemoryUsed() >> 10));
+    SystemDataViewWriteFormat(Context, SYSTEM_DATA_VIEW_VALUE_COLUMN, TEXT("Capacity"),
+        TEXT("%u pages (batch %u)\n"), (U32)PAGE_FRAME_CACHE_HIGH, (U32)PAGE_FRAME_CACHE_BATCH);
+
+    for (UINT Cpu = 0; Cpu < PAGE_FRAME_CACHE_MAX_CPUS; Cpu++) {
+        PAGE_FRAME_CACHE_INFO Info;
+        STR Label[24];
+
+        if (PageFrameCacheGetInfo(Cpu, &Info) == FALSE) {
+            continue;
+        }
+
+        StringPrintFormat(Label, TEXT("CPU %u"), (U32)Cpu);
+        SystemDataViewWriteFormat(Context, SYSTEM_DATA_VIEW_VALUE_COLUMN, Label,
+            TEXT("Cached=%u Hits=%u Frees=%u Refills=%u Drains=%u\n"),
+            (U32)Info.Count,
+            (U32)Info.Hits,
+            (U32)Info.Frees,
+            (U32)Info.Refills,
+            (U32)Info.Drains);
+    }
+
+    SystemDataViewDrawFooter(Context);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Draw the block cache page for System Data View.
+ *
+ * @param Context Output context.
+ * @param PageIndex Page index.
+ */
+static void SystemDataViewDrawPageBlockCache(LPSYSTEM_DATA_VIEW_CONTEXT Context, U8 PageIndex) {
+    BLOCK_CACHE_INFO Info;
+    U32 Lookups;
+    U32 HitRate = 0;
+
+    BlockCacheGetInfo(&Info);
+    Lookups = (U32)(Info.Hits + Info.Misses);
+
+    if (Lookups >= 0x01000000) {
+        HitRate = (U32)Info.Hits / (Lookups / 100);
+    } else if (Lookups != 0) {
+        HitRate = ((U32)Info.Hits * 100) / Lookups;
+    }
+
+    SystemDataViewDrawPageHeader(Context, TEXT("Block Cache"), PageIndex);
+    SystemDataViewWriteFormat(Context, SYSTEM_DATA_VIEW_VALUE_COLUMN, TEXT("Pages"),
+        TEXT("%u / %u (%u dirty)\n"), (U32)Info.UsedPages, (U32)Info.Capacity, (U32)Info.DirtyPages);
+    SystemDataViewWriteFormat(Context, SYSTEM_DATA_VIEW_VALUE_COLUMN, TEXT("Sector hits"),
+        TEXT("%u\n"), (U32)Info.Hits);
+    SystemDataViewWriteFormat(Context, SYSTEM_DATA_VIEW_VALUE_COLUMN, TEXT("Sector misses"),
+        TEXT("%u\n"), (U32)Info.Misses);
+    SystemDataViewWriteFormat(Context, SYSTEM_DATA_VIEW_VALUE_COLUMN, TEXT("Hit rate"),
+        TEXT("%u%%\n"), HitRate);
+    SystemDataViewWriteFormat(Context, SYSTEM_DATA_VIEW_VALUE_COLUMN, TEXT("Bypassed"),
+        TEXT("%u requests\n"), (U32)Info.Bypassed);
+    SystemDataViewWriteFormat(Context, SYSTEM_DATA_VIEW_VALUE_COLUMN, TEXT("Evictions"),
+        TEXT("%u\n"), (U32)Info.Evictions);
+    SystemDataViewWriteFormat(Context, SYSTEM_DATA_VIEW_VALUE_COLUMN, TEXT("Write-backs"),
+        TEXT("%u (%u errors)\n"), (U32)Info.WriteBacks, (U32)Info.WriteBackErrors);
+
+    SystemDataViewDrawFooter(Context);
+}
+
+/************************************************************************/
+
 /**
  * @brief Draw a System Data View page by index.
  *
@@ -2179,9 +2258,15 @@ static void SystemDataViewDrawPage(LPSYSTEM_DATA_VIEW_CONTEXT Context, U8 PageIn
             SystemDataViewDrawPageIdt(Context, PageIndex);
             break;
         case 13:
-        default:
             SystemDataViewDrawPageGdt(Context, PageIndex);
             break;
+        case 14:
+            SystemDataViewDrawPagePageFrameCache(Context, PageIndex);
+            break;
+        case 15:
+        default:
+            SystemDataViewDrawPageBlockCache(Context, PageIndex);
+            break;
     }
 }
 
@@ -44,7 +44,6 @@
 
 static U32 UserSessionDeferredHandle = DEFERRED_WORK_INVALID_HANDLE;
 static U32 UserSessionSchedulerTickHandle = SCHEDULER_TICK_INVALID_HANDLE;
-static UINT UserSessionLastDispatchTime = 0;
 
 /************************************************************************/
 
@@ -80,24 +79,16 @@ static void UserSessionDeferredTimeoutWork(LPVOID Context) {
 /************************************************************************/
 
 /**
- * @brief Lightweight scheduler tick hook for session timeout dispatch.
+ * @brief Periodic scheduler hook for session timeout dispatch.
  * @param Context Unused.
  */
 static void UserSessionSchedulerTick(LPVOID Context) {
-    UINT CurrentTime;
-
     UNUSED(Context);
 
     if (UserSessionDeferredHandle == DEFERRED_WORK_INVALID_HANDLE) {
         return;
     }
 
-    CurrentTime = GetSystemTime();
-    if ((CurrentTime - UserSessionLastDispatchTime) < SESSION_TIMEOUT_DISPATCH_PERIOD_MS) {
-        return;
-    }
-
-    UserSessionLastDispatchTime = CurrentTime;
     DeferredWorkSignal(UserSessionDeferredHandle);
 }
 
@@ -160,7 +151,6 @@ BOOL InitializeSessionSystem(void) {
     }
 
     SetUserSessionList(SessionList);
-    UserSessionLastDispatchTime = GetSystemTime();
 
     MemorySet(&Registration, 0, sizeof(Registration));
     Registration.WorkCallback = UserSessionDeferredTimeoutWork;
@@ -175,7 +165,8 @@ BOOL InitializeSessionSystem(void) {
         return FALSE;
     }
 
-    UserSessionSchedulerTickHandle = SchedulerRegisterTickCallback(UserSessionSchedulerTick, NULL);
+    UserSessionSchedulerTickHandle = SchedulerRegisterPeriodicCallback(
+        UserSessionSchedulerTick, NULL, SESSION_TIMEOUT_DISPATCH_PERIOD_MS);
     if (UserSessionSchedulerTickHandle == SCHEDULER_TICK_INVALID_HANDLE) {
         ERROR(TEXT("[InitializeSessionSystem] Failed to register scheduler session timeout hook"));
         DeferredWorkUnregister(UserSessionDeferredHandle);
@@ -225,7 +216,6 @@ void ShutdownSessionSystem(void) {
 
         DeleteList(SessionList);
         SetUserSessionList(NULL);
-        UserSessionLastDispatchTime = 0;
 
         UnlockMutex(MUTEX_SESSION);
     }
@@ -35,13 +35,62 @@ static void CacheResetEntryLocked(LPCACHE_ENTRY Entry) {
     Entry->Data = NULL;
     Entry->ExpirationTime = 0;
     Entry->TTL = 0;
-    Entry->Score = 0;
+    Entry->Key = 0;
+    Entry->Next = CACHE_NO_ENTRY;
+    Entry->Referenced = FALSE;
     Entry->Dirty = FALSE;
     Entry->Valid = FALSE;
 }
 
 /************************************************************************/
 
+static UINT CacheBucketOf(LPCACHE Cache, U32 Key) {
+    return (UINT)(Key & (Cache->BucketCount - 1));
+}
+
+/************************************************************************/
+
+static LPMUTEX CacheStripeOf(LPCACHE Cache, UINT Bucket) {
+    return &(Cache->Stripes[Bucket & (CACHE_LOCK_STRIPES - 1)]);
+}
+
+/************************************************************************/
+
+static void CacheLinkEntryLocked(LPCACHE Cache, UINT Index) {
+    LPCACHE_ENTRY Entry = &Cache->Entries[Index];
+    UINT Bucket = CacheBucketOf(Cache, Entry->Key);
+    LPMUTEX Stripe = CacheStripeOf(Cache, Bucket);
+
+    LockMutex(Stripe, INFINITY);
+    Entry->Next = Cache->Buckets[Bucket];
+    Cache->Buckets[Bucket] = Index;
+    UnlockMutex(Stripe);
+}
+
+/************************************************************************/
+
+static void CacheUnlinkEntryLocked(LPCACHE Cache, UINT Index) {
+    LPCACHE_ENTRY Entry = &Cache->Entries[Index];
+    UINT Bucket = CacheBucketOf(Cache, Entry->Key);
+    LPMUTEX Stripe = CacheStripeOf(Cache, Bucket);
+    UINT* Link;
+
+    LockMutex(Stripe, INFINITY);
+
+    for (Link = &Cache->Buckets[Bucket]; *Link != CACHE_NO_ENTRY; Link = &Cache->Entries[*Link].Next) {
+        if (*Link == Index) {
+            *Link = Entry->Next;
+            break;
+        }
+    }
+
+    Entry->Next = CACHE_NO_ENTRY;
+
+    UnlockMutex(Stripe);
+}
+
+/************************************************************************/
+
 static BOOL CacheFlushEntryLocked(LPCACHE Cache, LPCACHE_ENTRY Entry) {
     if (Cache == NULL || Entry == NULL || !Entry->Valid) return FALSE;
     if (!Entry->Dirty) return TRUE;
@@ -78,6 +127,8 @@ static void CacheReleaseDataLocked(LPCACHE Cache, LPVOID Data, BOOL Dirty) {
 /************************************************************************/
 
 static BOOL CacheReleaseEntryLocked(LPCACHE Cache, LPCACHE_ENTRY Entry, BOOL FlushIfDirty) {
+    UINT Index;
+
     if (Cache == NULL || Entry == NULL) return FALSE;
     if (!Entry->Valid) return TRUE;
 
@@ -87,9 +138,15 @@ static BOOL CacheReleaseEntryLocked(LPCACHE Cache, LPCACHE_ENTRY Entry, BOOL Flu
         }
     }
 
+    Index = (UINT)(Entry - Cache->Entries);
+    CacheUnlinkEntryLocked(Cache, Index);
+
     CacheReleaseDataLocked(Cache, Entry->Data, Entry->Dirty);
     CacheResetEntryLocked(Entry);
 
+    Entry->Next = Cache->FreeList;
+    Cache->FreeList = Index;
+
     if (Cache->Count > 0) {
         Cache->Count--;
     }
@@ -99,38 +156,43 @@ static BOOL CacheReleaseEntryLocked(LPCACHE Cache, LPCACHE_ENTRY Entry, BOOL Flu
 
 /************************************************************************/
 
-static BOOL CacheEvictOneEntryLocked(LPCACHE Cache) {
-    LPCACHE_ENTRY LowestCleanEntry = NULL;
-
-    for (UINT Index = 0; Index < Cache->Capacity; Index++) {
-        if (!Cache->Entries[Index].Valid) {
-            continue;
-        }
+/**
+ * @brief Evict one entry with a CLOCK sweep.
+ *
+ * The hand clears the reference bit of recently used entries and evicts the
+ * first entry found without it. Expired entries go first. Dirty entries are
+ * only flushed and evicted when no clean entry can be evicted.
+ *
+ * @param Cache Cache structure, Mutex held.
+ * @param CurrentTime Current system time.
+ * @return TRUE when an entry was freed.
+ */
+static BOOL CacheEvictOneEntryLocked(LPCACHE Cache, UINT CurrentTime) {
+    if (Cache->Capacity == 0) return FALSE;
 
-        if (Cache->Entries[Index].Dirty) {
-            continue;
-        }
+    for (UINT Pass = 0; Pass < 2; Pass++) {
+        for (UINT Step = 0; Step < Cache->Capacity * 2; Step++) {
+            LPCACHE_ENTRY Entry = &Cache->Entries[Cache->ClockHand];
 
-        if (LowestCleanEntry == NULL || Cache->Entries[Index].Score < LowestCleanEntry->Score) {
-            LowestCleanEntry = &Cache->Entries[Index];
-        }
-    }
+            Cache->ClockHand++;
+            if (Cache->ClockHand >= Cache->Capacity) Cache->ClockHand = 0;
 
-    if (LowestCleanEntry != NULL) {
-        return CacheReleaseEntryLocked(Cache, LowestCleanEntry, FALSE);
-    }
+            if (!Entry->Valid) {
+                continue;
+            }
 
-    for (UINT Index = 0; Index < Cache->Capacity; Index++) {
-        if (!Cache->Entries[Index].Valid) {
-            continue;
-        }
+            if (Entry->Referenced && CurrentTime < Entry->ExpirationTime) {
+                Entry->Referenced = FALSE;
+                continue;
+            }
 
-        if (!Cache->Entries[Index].Dirty) {
-            continue;
-        }
+            if (Entry->Dirty && Pass == 0) {
+                continue;
+            }
 
-        if (CacheFlushEntryLocked(Cache, &Cache->Entries[Index])) {
-            return CacheReleaseEntryLocked(Cache, &Cache->Entries[Index], FALSE);
+            if (CacheReleaseEntryLocked(Cache, Entry, TRUE)) {
+                return TRUE;
+            }
         }
     }
 
@@ -139,30 +201,49 @@ static BOOL CacheEvictOneEntryLocked(LPCACHE Cache) {
 
 /************************************************************************/
 
-static void CacheDecayScoresLocked(LPCACHE Cache) {
-    for (UINT Index = 0; Index < Cache->Capacity; Index++) {
-        if (Cache->Entries[Index].Valid && Cache->Entries[Index].Score > 0) {
-            Cache->Entries[Index].Score--;
-        }
-    }
-}
+/**
+ * @brief Look for a live entry in one bucket.
+ * @param Cache Cache structure.
+ * @param Bucket Bucket index.
+ * @param Key Key to compare when UseKey is TRUE.
+ * @param UseKey TRUE to skip entries with another key.
+ * @param Matcher Optional matcher, NULL accepts any entry.
+ * @param Context Context passed to the matcher.
+ * @param CurrentTime Current system time.
+ * @return Pointer to data if found, NULL otherwise.
+ */
+static LPVOID CacheFindInBucket(
+    LPCACHE Cache, UINT Bucket, U32 Key, BOOL UseKey, CACHE_MATCHER Matcher, LPVOID Context, UINT CurrentTime) {
+    LPMUTEX Stripe = CacheStripeOf(Cache, Bucket);
+    LPVOID Result = NULL;
 
-/************************************************************************/
+    LockMutex(Stripe, INFINITY);
 
-static LPCACHE_ENTRY CacheFindLowestScoreEntryInternal(LPCACHE Cache) {
-    LPCACHE_ENTRY LowestEntry = NULL;
+    for (UINT Index = Cache->Buckets[Bucket]; Index != CACHE_NO_ENTRY; Index = Cache->Entries[Index].Next) {
+        LPCACHE_ENTRY Entry = &Cache->Entries[Index];
 
-    for (UINT Index = 0; Index < Cache->Capacity; Index++) {
-        if (!Cache->Entries[Index].Valid) {
+        if (UseKey && Entry->Key != Key) {
             continue;
         }
 
-        if (LowestEntry == NULL || Cache->Entries[Index].Score < LowestEntry->Score) {
-            LowestEntry = &Cache->Entries[Index];
+        // Expired entries are left to eviction and cleanup, which may flush them
+        if (CurrentTime >= Entry->ExpirationTime) {
+            continue;
         }
+
+        if (Matcher != NULL && !Matcher(Entry->Data, Context)) {
+            continue;
+        }
+
+        Entry->Referenced = TRUE;
+        Entry->ExpirationTime = (UINT)(CurrentTime + Entry->TTL);
+        Result = Entry->Data;
+        break;
     }
 
-    return LowestEntry;
+    UnlockMutex(Stripe);
+
+    return Result;
 }
 
 /************************************************************************/
@@ -173,23 +254,51 @@ static LPCACHE_ENTRY CacheFindLowestScoreEntryInternal(LPCACHE Cache) {
  * @param Capacity Maximum number of entries
  */
 void CacheInit(LPCACHE Cache, UINT Capacity) {
-    UINT AllocationSize = (UINT)(Capacity * sizeof(CACHE_ENTRY));
+    UINT BucketCount = 1;
+
+    while (BucketCount < Capacity) {
+        BucketCount <<= 1;
+    }
 
     InitMutex(&Cache->Mutex);
+
+    for (UINT Index = 0; Index < CACHE_LOCK_STRIPES; Index++) {
+        InitMutex(&Cache->Stripes[Index]);
+    }
+
     Cache->Capacity = Capacity;
     Cache->Count = 0;
+    Cache->BucketCount = BucketCount;
+    Cache->FreeList = CACHE_NO_ENTRY;
+    Cache->ClockHand = 0;
     Cache->WritePolicy = CACHE_WRITE_POLICY_READ_ONLY;
     Cache->FlushCallback = NULL;
     Cache->ReleaseCallback = NULL;
     Cache->CallbackContext = NULL;
-    Cache->Entries = (LPCACHE_ENTRY)KernelHeapAlloc(AllocationSize);
+    Cache->Entries = (LPCACHE_ENTRY)KernelHeapAlloc((UINT)(Capacity * sizeof(CACHE_ENTRY)));
+    Cache->Buckets = (UINT*)KernelHeapAlloc((UINT)(BucketCount * sizeof(UINT)));
 
-    if (Cache->Entries == NULL) {
+    if (Cache->Entries == NULL || Cache->Buckets == NULL) {
         ERROR(TEXT("[CacheInit] KernelHeapAlloc failed"));
+
+        if (Cache->Entries != NULL) KernelHeapFree(Cache->Entries);
+        if (Cache->Buckets != NULL) KernelHeapFree(Cache->Buckets);
+
+        Cache->Entries = NULL;
+        Cache->Buckets = NULL;
+        Cache->Capacity = 0;
+        return;
+    }
+
+    for (UINT Index = 0; Index < BucketCount; Index++) {
+        Cache->Buckets[Index] = CACHE_NO_ENTRY;
     }
 
-    for (UINT Index = 0; Index < Capacity; Index++) {
-        CacheResetEntryLocked(&Cache->Entries[Index]);
+    // Chain every entry in the free list, lowest index first
+    for (UINT Index = Capacity; Index > 0; Index--) {
+        CacheResetEntryLocked(&Cache->Entries[Index - 1]);
+        Cache->Entries[Index - 1].Next = Cache->FreeList;
+        Cache->FreeList = Index - 1;
     }
 }
 
@@ -223,7 +332,15 @@ void CacheDeinit(LPCACHE Cache) {
         Cache->Entries = NULL;
     }
 
+    if (Cache->Buckets) {
+        KernelHeapFree(Cache->Buckets);
+        Cache->Buckets = NULL;
+    }
+
     Cache->Count = 0;
+    Cache->Capacity = 0;
+    Cache->FreeList = CACHE_NO_ENTRY;
+    Cache->ClockHand = 0;
     Cache->WritePolicy = CACHE_WRITE_POLICY_READ_ONLY;
     Cache->FlushCallback = NULL;
     Cache->ReleaseCallback = NULL;
@@ -264,122 +381,147 @@ void CacheSetWritePolicy(
 /************************************************************************/
 
 /**
- * @brief Add an entry to the cache with TTL.
+ * @brief Mix a value into a cache key.
+ *
+ * Callers build the key of their entries by mixing each of their key fields,
+ * starting from 0.
+ *
+ * @param Hash Current key.
+ * @param Value Value to mix in.
+ * @return New key.
+ */
+U32 CacheHashMix(U32 Hash, U32 Value) {
+    Hash ^= Value * 0x9E3779B1;
+    Hash ^= Hash >> 15;
+    Hash *= 0x85EBCA6B;
+    Hash ^= Hash >> 13;
+
+    return Hash;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Add an entry to the cache with a hash key and a TTL.
+ *
+ * When the cache is full, one entry is evicted by the CLOCK sweep.
+ *
  * @param Cache Cache structure
+ * @param Key Hash of the entry key, see CacheHashMix
  * @param Data Pointer to data to store (will be managed by caller)
  * @param TTL_MS Time to live in milliseconds
  * @return TRUE if added successfully, FALSE otherwise
  */
-BOOL CacheAdd(LPCACHE Cache, LPVOID Data, UINT TTL_MS) {
+BOOL CacheAddKey(LPCACHE Cache, U32 Key, LPVOID Data, UINT TTL_MS) {
     UINT CurrentTime = GetSystemTime();
-    UINT FreeIndex = MAX_UINT;
+    LPCACHE_ENTRY Entry;
+    UINT Index;
 
     if (Cache == NULL || Data == NULL) return FALSE;
 
     LockMutex(&Cache->Mutex, INFINITY);
 
-    CacheDecayScoresLocked(Cache);
-
-    // Find first free slot
-    for (UINT Index = 0; Index < Cache->Capacity; Index++) {
-        if (!Cache->Entries[Index].Valid) {
-            FreeIndex = Index;
-            break;
-        }
-
-        if (CurrentTime >= Cache->Entries[Index].ExpirationTime) {
-            if (CacheReleaseEntryLocked(Cache, &Cache->Entries[Index], TRUE)) {
-                if (FreeIndex == MAX_UINT) {
-                    FreeIndex = Index;
-                }
-            } else {
-                Cache->Entries[Index].ExpirationTime =
-                    (UINT)(CurrentTime + Cache->Entries[Index].TTL);
-            }
-        }
+    if (Cache->Entries == NULL) {
+        UnlockMutex(&Cache->Mutex);
+        return FALSE;
     }
 
-    if (FreeIndex == MAX_UINT) {
-        if (!CacheEvictOneEntryLocked(Cache)) {
-            DEBUG(TEXT("[CacheAdd] Cache full and no entry available"));
+    if (Cache->FreeList == CACHE_NO_ENTRY) {
+        if (!CacheEvictOneEntryLocked(Cache, CurrentTime)) {
+            DEBUG(TEXT("[CacheAddKey] Cache full and no entry available"));
             UnlockMutex(&Cache->Mutex);
             return FALSE;
         }
-
-        for (UINT Index = 0; Index < Cache->Capacity; Index++) {
-            if (!Cache->Entries[Index].Valid) {
-                FreeIndex = Index;
-                break;
-            }
-        }
     }
 
-    if (FreeIndex == MAX_UINT) {
-        UnlockMutex(&Cache->Mutex);
-        return FALSE;
-    }
+    Index = Cache->FreeList;
+    Entry = &Cache->Entries[Index];
+    Cache->FreeList = Entry->Next;
 
-    Cache->Entries[FreeIndex].Data = Data;
-    Cache->Entries[FreeIndex].ExpirationTime = (UINT)(CurrentTime + TTL_MS);
-    Cache->Entries[FreeIndex].TTL = TTL_MS;
-    Cache->Entries[FreeIndex].Score = 1;
-    Cache->Entries[FreeIndex].Dirty = FALSE;
-    Cache->Entries[FreeIndex].Valid = TRUE;
+    Entry->Data = Data;
+    Entry->ExpirationTime = (UINT)(CurrentTime + TTL_MS);
+    Entry->TTL = TTL_MS;
+    Entry->Key = Key;
+    Entry->Referenced = FALSE;
+    Entry->Dirty = FALSE;
+    Entry->Valid = TRUE;
     Cache->Count++;
 
+    CacheLinkEntryLocked(Cache, Index);
+
     UnlockMutex(&Cache->Mutex);
     return TRUE;
 }
 
 /************************************************************************/
 
+/**
+ * @brief Add an entry to the cache with TTL.
+ *
+ * The entry has no key and is only found by CacheFind.
+ *
+ * @param Cache Cache structure
+ * @param Data Pointer to data to store (will be managed by caller)
+ * @param TTL_MS Time to live in milliseconds
+ * @return TRUE if added successfully, FALSE otherwise
+ */
+BOOL CacheAdd(LPCACHE Cache, LPVOID Data, UINT TTL_MS) {
+    return CacheAddKey(Cache, 0, Data, TTL_MS);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Find an entry in the bucket of a hash key.
+ * @param Cache Cache structure
+ * @param Key Hash of the entry key
+ * @param Matcher Function comparing the full key, NULL when the hash is exact
+ * @param Context Context passed to matcher
+ * @return Pointer to data if found, NULL otherwise
+ */
+LPVOID CacheFindKey(LPCACHE Cache, U32 Key, CACHE_MATCHER Matcher, LPVOID Context) {
+    if (Cache == NULL || Cache->Buckets == NULL) return NULL;
+
+    return CacheFindInBucket(Cache, CacheBucketOf(Cache, Key), Key, TRUE, Matcher, Context, GetSystemTime());
+}
+
+/************************************************************************/
+
 /**
  * @brief Find an entry in the cache using a matcher function.
+ *
+ * Every bucket is searched, so entries added with or without a key are found.
+ *
  * @param Cache Cache structure
  * @param Matcher Function to match entries
  * @param Context Context passed to matcher
  * @return Pointer to data if found, NULL otherwise
  */
-LPVOID CacheFind(LPCACHE Cache, BOOL (*Matcher)(LPVOID Data, LPVOID Context), LPVOID Context) {
-    if (Cache == NULL || Matcher == NULL) return NULL;
+LPVOID CacheFind(LPCACHE Cache, CACHE_MATCHER Matcher, LPVOID Context) {
+    UINT CurrentTime;
 
-    LockMutex(&Cache->Mutex, INFINITY);
+    if (Cache == NULL || Matcher == NULL || Cache->Buckets == NULL) return NULL;
 
-    UINT CurrentTime = GetSystemTime();
+    CurrentTime = GetSystemTime();
 
-    for (UINT Index = 0; Index < Cache->Capacity; Index++) {
-        if (Cache->Entries[Index].Valid) {
-            // Check if expired
-            if (CurrentTime >= Cache->Entries[Index].ExpirationTime) {
-                if (CacheReleaseEntryLocked(Cache, &Cache->Entries[Index], TRUE)) {
-                    continue;
-                }
+    for (UINT Bucket = 0; Bucket < Cache->BucketCount; Bucket++) {
+        LPVOID Result;
 
-                Cache->Entries[Index].ExpirationTime =
-                    (UINT)(CurrentTime + Cache->Entries[Index].TTL);
-            }
+        if (Cache->Buckets[Bucket] == CACHE_NO_ENTRY) {
+            continue;
+        }
 
-            if (Matcher(Cache->Entries[Index].Data, Context)) {
-                LPVOID Result = Cache->Entries[Index].Data;
-                Cache->Entries[Index].Score++;
-                Cache->Entries[Index].ExpirationTime =
-                    (UINT)(CurrentTime + Cache->Entries[Index].TTL);
-                UnlockMutex(&Cache->Mutex);
-                return Result;
-            }
+        Result = CacheFindInBucket(Cache, Bucket, 0, FALSE, Matcher, Context, CurrentTime);
 
-            if (Cache->Entries[Index].Score > 0) {
-                Cache->Entries[Index].Score--;
-            }
+        if (Result != NULL) {
+            return Result;
         }
     }
 
-    UnlockMutex(&Cache->Mutex);
     return NULL;
 }
 
 /************************************************************************/
-
 /**
  * @brief Mark one cache entry as dirty.
  *
@@ -486,8 +628,6 @@ void CacheCleanup(LPCACHE Cache, UINT CurrentTime) {
 
     LockMutex(&Cache->Mutex, INFINITY);
 
-    CacheDecayScoresLocked(Cache);
-
     for (UINT Index = 0; Index < Cache->Capacity; Index++) {
         if (Cache->Entries[Index].Valid) {
             if (CurrentTime >= Cache->Entries[Index].ExpirationTime) {
@@ -504,14 +644,38 @@ void CacheCleanup(LPCACHE Cache, UINT CurrentTime) {
 
 /************************************************************************/
 
+/**
+ * @brief Return the entry the next eviction would pick.
+ *
+ * Kept for callers of the former score based cache: the entry is the first
+ * valid one after the CLOCK hand without its reference bit.
+ *
+ * @param Cache Cache structure.
+ * @return Entry pointer, NULL when the cache is empty.
+ */
 LPCACHE_ENTRY CacheFindLowestScoreEntry(LPCACHE Cache) {
-    LPCACHE_ENTRY Result;
+    LPCACHE_ENTRY Result = NULL;
 
     if (Cache == NULL) return NULL;
 
     LockMutex(&Cache->Mutex, INFINITY);
 
-    Result = CacheFindLowestScoreEntryInternal(Cache);
+    for (UINT Step = 0; Step < Cache->Capacity; Step++) {
+        LPCACHE_ENTRY Entry = &Cache->Entries[(Cache->ClockHand + Step) % Cache->Capacity];
+
+        if (!Entry->Valid) {
+            continue;
+        }
+
+        if (Result == NULL) {
+            Result = Entry;
+        }
+
+        if (!Entry->Referenced) {
+            Result = Entry;
+            break;
+        }
+    }
 
     UnlockMutex(&Cache->Mutex);
 
@@ -37,6 +37,24 @@ typedef struct tag_CHUNK_CACHE_MATCH_CONTEXT {
 
 /************************************************************************/
 
+/**
+ * @brief Compute the cache key of an owner/chunk/size triple.
+ * @param Owner Namespace owner key.
+ * @param ChunkIndex Chunk index key.
+ * @param DataSize Payload size in bytes.
+ * @return Hash key for the generic cache.
+ */
+static U32 ChunkCacheKey(LPCVOID Owner, U64 ChunkIndex, UINT DataSize) {
+    U32 Key = CacheHashMix(0, (U32)(LINEAR)Owner);
+
+    Key = CacheHashMix(Key, U64_Low32(ChunkIndex));
+    Key = CacheHashMix(Key, U64_High32(ChunkIndex));
+
+    return CacheHashMix(Key, DataSize);
+}
+
+/************************************************************************/
+
 /**
  * @brief Match one chunk cache entry against owner/chunk/size keys.
  * @param Data Cache entry payload.
@@ -139,7 +157,8 @@ BOOL ChunkCacheStore(LPCHUNK_CACHE ChunkCache,
     Context.ChunkIndex = ChunkIndex;
     Context.DataSize = DataSize;
 
-    Entry = (LPCHUNK_CACHE_ENTRY)CacheFind(&ChunkCache->Cache, ChunkCacheMatcher, &Context);
+    Entry = (LPCHUNK_CACHE_ENTRY)CacheFindKey(
+        &ChunkCache->Cache, ChunkCacheKey(Owner, ChunkIndex, Context.DataSize), ChunkCacheMatcher, &Context);
     if (Entry != NULL) {
         MemoryCopy(Entry->Data, Data, DataSize);
         return TRUE;
@@ -156,7 +175,8 @@ BOOL ChunkCacheStore(LPCHUNK_CACHE ChunkCache,
     Entry->DataSize = DataSize;
     MemoryCopy(Entry->Data, Data, DataSize);
 
-    if (!CacheAdd(&ChunkCache->Cache, Entry, ChunkCache->DefaultTimeToLive)) {
+    if (!CacheAddKey(&ChunkCache->Cache, ChunkCacheKey(Owner, ChunkIndex, DataSize), Entry,
+            ChunkCache->DefaultTimeToLive)) {
         KernelHeapFree(Entry);
         return FALSE;
     }
@@ -195,7 +215,8 @@ BOOL ChunkCacheRead(LPCHUNK_CACHE ChunkCache,
     Context.ChunkIndex = ChunkIndex;
     Context.DataSize = BufferSize;
 
-    Entry = (LPCHUNK_CACHE_ENTRY)CacheFind(&ChunkCache->Cache, ChunkCacheMatcher, &Context);
+    Entry = (LPCHUNK_CACHE_ENTRY)CacheFindKey(
+        &ChunkCache->Cache, ChunkCacheKey(Owner, ChunkIndex, Context.DataSize), ChunkCacheMatcher, &Context);
     if (Entry == NULL) {
         return FALSE;
     }
@@ -52,15 +52,14 @@ BOOL DMABufferAllocate(LPDMA_BUFFER Buffer, UINT Size, BOOL RequireContiguous, L
 
     PhysicalBase = 0;
     if (RequireContiguous) {
-        PHYSICAL MaximumBaseAddress;
-
         if (AllocatedSize > MAX_U32) {
             ERROR(TEXT("[DMABufferAllocate] DMA size exceeds low-32-bit window (%u)"), AllocatedSize);
             return FALSE;
         }
 
-        MaximumBaseAddress = (PHYSICAL)(MAX_U32 - (AllocatedSize - 1));
-        if (!FindAvailableMemoryRangeInWindow((PHYSICAL)N_1MB, MaximumBaseAddress, 0, 0, AllocatedSize, &PhysicalBase)) {
+        // One buddy allocation, below 4 GB for 32-bit DMA engines
+        PhysicalBase = AllocPhysicalContiguous(AllocatedSize >> PAGE_SIZE_MUL, PAGE_SIZE, (PHYSICAL)MAX_U32);
+        if (PhysicalBase == 0) {
             ERROR(TEXT("[DMABufferAllocate] No contiguous DMA range found for %s size=%u"), Tag, AllocatedSize);
             return FALSE;
         }
@@ -76,6 +75,11 @@ BOOL DMABufferAllocate(LPDMA_BUFFER Buffer, UINT Size, BOOL RequireContiguous, L
               Tag,
               AllocatedSize,
               RequireContiguous ? 1 : 0);
+
+        if (PhysicalBase != 0) {
+            FreePhysicalPageRange(PhysicalBase, AllocatedSize >> PAGE_SIZE_MUL);
+        }
+
         return FALSE;
     }
 
@@ -96,24 +100,15 @@ BOOL DMABufferAllocate(LPDMA_BUFFER Buffer, UINT Size, BOOL RequireContiguous, L
  * @param Buffer DMA buffer description to release.
  */
 void DMABufferRelease(LPDMA_BUFFER Buffer) {
-    UINT Index;
-    UINT PageCount;
-
     if (Buffer == NULL) {
         return;
     }
 
+    // FreeRegion returns the backing pages, contiguous or not
     if (Buffer->LinearBase != 0 && Buffer->AllocatedSize != 0) {
         FreeRegion(Buffer->LinearBase, Buffer->AllocatedSize);
     }
 
-    if (Buffer->IsContiguous && Buffer->PhysicalBase != 0 && Buffer->AllocatedSize != 0) {
-        PageCount = Buffer->AllocatedSize >> PAGE_SIZE_MUL;
-        for (Index = 0; Index < PageCount; Index++) {
-            FreePhysicalPage(Buffer->PhysicalBase + (PHYSICAL)(Index << PAGE_SIZE_MUL));
-        }
-    }
-
     MemorySet(Buffer, 0, sizeof(DMA_BUFFER));
 }
 
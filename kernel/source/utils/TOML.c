@@ -26,10 +26,15 @@
 
 #include "core/Kernel.h"
 #include "log/Log.h"
+#include "memory/Slab.h"
 #include "text/CoreString.h"
 
 /***************************************************************************/
 
+static SLAB_CACHE DATA_SECTION TomlItemCache = SLAB_CACHE_INIT(TEXT("TomlItem"), sizeof(TOMLITEM));
+
+/***************************************************************************/
+
 /**
  * @brief Parses a TOML formatted string into a structured data object.
  *
@@ -171,7 +176,7 @@ LPTOML TomlParse(LPCSTR Source) {
         StringConcat(FullKey, Key);
 
         // Allocate new TOML item structure
-        Item = (LPTOMLITEM)KernelHeapAlloc(sizeof(TOMLITEM));
+        Item = (LPTOMLITEM)SlabCacheAlloc(&TomlItemCache);
         if (Item == NULL) continue;
         Item->Next = NULL;
 
@@ -0,0 +1,359 @@
+/************************************************************************\
+
+    EXOS Kernel
+    Copyright (c) 1999-2025 Jango73
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+    Hierarchical Timer Wheel
+
+\************************************************************************/
+
+#include "utils/TimerWheel.h"
+
+#include "text/CoreString.h"
+
+/************************************************************************/
+
+/**
+ * @brief Convert a time to the first tick at which it has elapsed.
+ * @param Wheel Timer wheel.
+ * @param Time Time in milliseconds.
+ * @return Tick index, rounded up.
+ */
+static UINT TimerWheelGetTick(LPTIMER_WHEEL Wheel, UINT Time) {
+    return (Time / Wheel->Resolution) + ((Time % Wheel->Resolution) != 0 ? 1 : 0);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Link one entry at the head of a slot.
+ * @param Wheel Timer wheel.
+ * @param Entry Unarmed entry.
+ * @param Level Wheel level.
+ * @param Index Slot index in the level.
+ */
+static void TimerWheelLink(LPTIMER_WHEEL Wheel, LPTIMER_WHEEL_ENTRY Entry, U32 Level, U32 Index) {
+    LPTIMER_WHEEL_ENTRY* Head = &(Wheel->Slots[Level][Index]);
+
+    Entry->Previous = NULL;
+    Entry->Next = *Head;
+
+    if (*Head != NULL) {
+        (*Head)->Previous = Entry;
+    }
+
+    *Head = Entry;
+    Entry->Slot = (Level << TIMER_WHEEL_SLOT_BITS) | Index;
+    Wheel->SlotBitmap[Level] |= ((U32)1 << Index);
+    Wheel->Count++;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Unlink one armed entry from its slot.
+ * @param Wheel Timer wheel.
+ * @param Entry Armed entry.
+ */
+static void TimerWheelUnlink(LPTIMER_WHEEL Wheel, LPTIMER_WHEEL_ENTRY Entry) {
+    U32 Level = Entry->Slot >> TIMER_WHEEL_SLOT_BITS;
+    U32 Index = Entry->Slot & TIMER_WHEEL_SLOT_MASK;
+
+    if (Entry->Previous != NULL) {
+        Entry->Previous->Next = Entry->Next;
+    } else {
+        Wheel->Slots[Level][Index] = Entry->Next;
+    }
+
+    if (Entry->Next != NULL) {
+        Entry->Next->Previous = Entry->Previous;
+    }
+
+    if (Wheel->Slots[Level][Index] == NULL) {
+        Wheel->SlotBitmap[Level] &= ~((U32)1 << Index);
+    }
+
+    Entry->Next = NULL;
+    Entry->Previous = NULL;
+    Entry->Slot = TIMER_WHEEL_UNARMED;
+    Wheel->Count--;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Detach a whole slot, leaving its entries chained but unarmed.
+ * @param Wheel Timer wheel.
+ * @param Level Wheel level.
+ * @param Index Slot index in the level.
+ * @return First detached entry, or NULL.
+ */
+static LPTIMER_WHEEL_ENTRY TimerWheelDetachSlot(LPTIMER_WHEEL Wheel, U32 Level, U32 Index) {
+    LPTIMER_WHEEL_ENTRY List = Wheel->Slots[Level][Index];
+
+    Wheel->Slots[Level][Index] = NULL;
+    Wheel->SlotBitmap[Level] &= ~((U32)1 << Index);
+
+    for (LPTIMER_WHEEL_ENTRY Entry = List; Entry != NULL; Entry = Entry->Next) {
+        Entry->Slot = TIMER_WHEEL_UNARMED;
+        Wheel->Count--;
+    }
+
+    return List;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Link one unarmed entry in the slot matching its deadline.
+ *
+ * Near deadlines land in level 0, one slot per tick. Each further level
+ * covers TIMER_WHEEL_SLOTS times the span of the previous one. Deadlines
+ * past the last level are parked in its farthest slot and re-placed when
+ * they cascade down.
+ *
+ * @param Wheel Timer wheel.
+ * @param Entry Unarmed entry.
+ */
+static void TimerWheelPlace(LPTIMER_WHEEL Wheel, LPTIMER_WHEEL_ENTRY Entry) {
+    UINT ExpiresTick = TimerWheelGetTick(Wheel, Entry->Deadline);
+    UINT Delta;
+    U32 Level;
+
+    if (ExpiresTick < Wheel->CurrentTick) {
+        ExpiresTick = Wheel->CurrentTick;
+    }
+
+    Delta = ExpiresTick - Wheel->CurrentTick;
+
+    for (Level = 0; Level < TIMER_WHEEL_LEVELS - 1; Level++) {
+        if (Delta < ((UINT)1 << ((Level + 1) * TIMER_WHEEL_SLOT_BITS))) {
+            break;
+        }
+    }
+
+    if (Level == TIMER_WHEEL_LEVELS - 1) {
+        UINT Span = (UINT)1 << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS);
+
+        if (Delta >= Span) {
+            ExpiresTick = Wheel->CurrentTick + Span - 1;
+        }
+    }
+
+    TimerWheelLink(Wheel, Entry, Level, (U32)(ExpiresTick >> (Level * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK);
+}
+
+/************************************************************************/
+
+/**
+ * @brief Re-place every entry of one upper-level slot into lower levels.
+ * @param Wheel Timer wheel.
+ * @param Level Wheel level, greater than zero.
+ * @param Index Slot index in the level.
+ */
+static void TimerWheelCascade(LPTIMER_WHEEL Wheel, U32 Level, U32 Index) {
+    LPTIMER_WHEEL_ENTRY List = TimerWheelDetachSlot(Wheel, Level, Index);
+
+    while (List != NULL) {
+        LPTIMER_WHEEL_ENTRY Entry = List;
+        List = Entry->Next;
+
+        TimerWheelPlace(Wheel, Entry);
+    }
+}
+
+/************************************************************************/
+
+/**
+ * @brief Find the next tick worth visiting after a drained level-0 slot.
+ *
+ * That is the next occupied level-0 slot of the current lap, or the start of
+ * the next lap where upper levels cascade. Empty ticks in between are
+ * skipped so long idle gaps cost one step per lap, not one per tick.
+ *
+ * @param Wheel Timer wheel, CurrentTick on the drained slot.
+ * @return Next tick to process.
+ */
+static UINT TimerWheelGetNextTick(LPTIMER_WHEEL Wheel) {
+    UINT Tick = Wheel->CurrentTick;
+    U32 Index = (U32)Tick & TIMER_WHEEL_SLOT_MASK;
+    U32 Pending = Wheel->SlotBitmap[0] & ~(((U32)2 << Index) - 1);
+    U32 Next = TIMER_WHEEL_SLOTS;
+
+    if (Pending != 0) {
+        for (Next = Index + 1; (Pending & ((U32)1 << Next)) == 0; Next++) {
+        }
+    }
+
+    return Tick - Index + Next;
+}
+
+/************************************************************************/
+
+void TimerWheelInitialize(LPTIMER_WHEEL Wheel, UINT Resolution, UINT Now) {
+    if (Wheel == NULL) return;
+
+    MemorySet(Wheel, 0, sizeof(TIMER_WHEEL));
+    Wheel->Resolution = (Resolution != 0) ? Resolution : 1;
+    Wheel->CurrentTick = Now / Wheel->Resolution;
+}
+
+/************************************************************************/
+
+void TimerWheelEntryInitialize(LPTIMER_WHEEL_ENTRY Entry, TIMER_WHEEL_CALLBACK Callback, LPVOID Context) {
+    if (Entry == NULL) return;
+
+    Entry->Next = NULL;
+    Entry->Previous = NULL;
+    Entry->Deadline = 0;
+    Entry->Slot = TIMER_WHEEL_UNARMED;
+    Entry->Callback = Callback;
+    Entry->Context = Context;
+}
+
+/************************************************************************/
+
+void TimerWheelArm(LPTIMER_WHEEL Wheel, LPTIMER_WHEEL_ENTRY Entry, UINT Deadline) {
+    if (Wheel == NULL || Entry == NULL) return;
+
+    if (Entry->Slot != TIMER_WHEEL_UNARMED) {
+        TimerWheelUnlink(Wheel, Entry);
+    }
+
+    Entry->Deadline = Deadline;
+    TimerWheelPlace(Wheel, Entry);
+}
+
+/************************************************************************/
+
+void TimerWheelDisarm(LPTIMER_WHEEL Wheel, LPTIMER_WHEEL_ENTRY Entry) {
+    if (Wheel == NULL || Entry == NULL) return;
+
+    if (Entry->Slot != TIMER_WHEEL_UNARMED) {
+        TimerWheelUnlink(Wheel, Entry);
+    }
+}
+
+/************************************************************************/
+
+BOOL TimerWheelIsArmed(LPTIMER_WHEEL_ENTRY Entry) {
+    return (Entry != NULL && Entry->Slot != TIMER_WHEEL_UNARMED);
+}
+
+/************************************************************************/
+
+UINT TimerWheelAdvance(LPTIMER_WHEEL Wheel, UINT Now) {
+    UINT NowTick;
+    UINT Fired = 0;
+
+    if (Wheel == NULL) return 0;
+
+    NowTick = Now / Wheel->Resolution;
+
+    while (Wheel->CurrentTick <= NowTick) {
+        UINT Tick = Wheel->CurrentTick;
+        U32 Index = (U32)Tick & TIMER_WHEEL_SLOT_MASK;
+
+        // Nothing armed, jump straight to the present
+        if (Wheel->Count == 0) {
+            Wheel->CurrentTick = NowTick + 1;
+            break;
+        }
+
+        // Level 0 wrapped, pull the next span down from the upper levels
+        if (Index == 0) {
+            for (U32 Level = 1; Level < TIMER_WHEEL_LEVELS; Level++) {
+                U32 LevelIndex = (U32)(Tick >> (Level * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK;
+
+                TimerWheelCascade(Wheel, Level, LevelIndex);
+
+                if (LevelIndex != 0) break;
+            }
+        }
+
+        // Pop one entry at a time, callbacks may arm or disarm other entries.
+        // CurrentTick stays on the drained slot until it is empty, so entries
+        // re-armed one lap ahead land in an upper level and not back here.
+        while (Wheel->Slots[0][Index] != NULL) {
+            LPTIMER_WHEEL_ENTRY Entry = Wheel->Slots[0][Index];
+
+            TimerWheelUnlink(Wheel, Entry);
+
+            // Parked beyond the wheel span, not due yet
+            if (Entry->Deadline > Now) {
+                TimerWheelPlace(Wheel, Entry);
+                continue;
+            }
+
+            Fired++;
+
+            if (Entry->Callback != NULL) {
+                Entry->Callback(Entry, Entry->Context);
+            }
+        }
+
+        Wheel->CurrentTick = TimerWheelGetNextTick(Wheel);
+    }
+
+    // Skipped past the present, come back to the first unprocessed tick
+    if (Wheel->CurrentTick > NowTick + 1) {
+        Wheel->CurrentTick = NowTick + 1;
+    }
+
+    return Fired;
+}
+
+/************************************************************************/
+
+UINT TimerWheelGetNextDeadline(LPTIMER_WHEEL Wheel) {
+    UINT Best = INFINITY;
+
+    if (Wheel == NULL || Wheel->Count == 0) return INFINITY;
+
+    for (U32 Level = 0; Level < TIMER_WHEEL_LEVELS; Level++) {
+        U32 Bitmap = Wheel->SlotBitmap[Level];
+        U32 Current;
+        U32 Start;
+
+        if (Bitmap == 0) continue;
+
+        // Once the current span has been cascaded, the slot at the current
+        // index only holds the next lap, so check it last
+        Current = (U32)(Wheel->CurrentTick >> (Level * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK;
+        Start = Current;
+
+        if ((Wheel->CurrentTick & (((UINT)1 << (Level * TIMER_WHEEL_SLOT_BITS)) - 1)) != 0) {
+            Start = Current + 1;
+        }
+
+        for (U32 Step = 0; Step < TIMER_WHEEL_SLOTS; Step++) {
+            U32 Index = (Start + Step) & TIMER_WHEEL_SLOT_MASK;
+
+            if ((Bitmap & ((U32)1 << Index)) == 0) continue;
+
+            for (LPTIMER_WHEEL_ENTRY Entry = Wheel->Slots[Level][Index]; Entry != NULL; Entry = Entry->Next) {
+                if (Entry->Deadline < Best) {
+                    Best = Entry->Deadline;
+                }
+            }
+
+            break;
+        }
+    }
+
+    return Best;
+}
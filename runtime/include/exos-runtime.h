@@ -116,6 +116,44 @@ struct sockaddr_in {
 // Socket option constants
 #define SOL_SOCKET                1
 #define SO_RCVTIMEO               20
+#define IPPROTO_TCP               6
+#define TCP_NODELAY               1
+
+// Send and receive flags
+#define MSG_DONTWAIT              SOCKET_MSG_DONTWAIT
+
+// Poll events
+#define POLLIN                    0x0001
+#define POLLOUT                   0x0004
+#define POLLERR                   0x0008
+#define POLLHUP                   0x0010
+#define POLLNVAL                  0x0020
+
+struct pollfd {
+    int fd;
+    short events;
+    short revents;
+};
+
+typedef unsigned int nfds_t;
+
+// Socket descriptors are not small integers, so a set lists its descriptors
+#define FD_SETSIZE                SOCKET_POLL_MAX_ENTRIES
+
+typedef struct fd_set {
+    unsigned int fd_count;
+    int fd_array[FD_SETSIZE];
+} fd_set;
+
+#define FD_ZERO(set)              ((set)->fd_count = 0)
+#define FD_SET(fd, set)           fd_set_add((fd), (set))
+#define FD_CLR(fd, set)           fd_set_remove((fd), (set))
+#define FD_ISSET(fd, set)         fd_set_contains((fd), (set))
+
+struct timeval {
+    long tv_sec;
+    long tv_usec;
+};
 
 /************************************************************************/
 // Byte order inline functions
@@ -256,6 +294,11 @@ int     getsockopt(int sockfd, int level, int optname, void *optval, socklen_t *
 int     setsockopt(int sockfd, int level, int optname, const void *optval, socklen_t optlen);
 int     getpeername(int sockfd, struct sockaddr *addr, socklen_t *addrlen);
 int     getsockname(int sockfd, struct sockaddr *addr, socklen_t *addrlen);
+int     poll(struct pollfd *fds, nfds_t nfds, int timeout);
+int     select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout);
+void    fd_set_add(int fd, fd_set *set);
+void    fd_set_remove(int fd, fd_set *set);
+int     fd_set_contains(int fd, const fd_set *set);
 
 #ifdef __cplusplus
 }
@@ -145,6 +145,7 @@ U32 SocketGetOption(SOCKET_HANDLE SocketHandle, U32 Level, U32 OptionName, LPVOI
 U32 SocketSetOption(SOCKET_HANDLE SocketHandle, U32 Level, U32 OptionName, LPCVOID OptionValue, U32 OptionLength);
 U32 SocketGetPeerName(SOCKET_HANDLE SocketHandle, LPSOCKET_ADDRESS Address, U32* AddressLength);
 U32 SocketGetSocketName(SOCKET_HANDLE SocketHandle, LPSOCKET_ADDRESS Address, U32* AddressLength);
+I32 SocketPoll(LPSOCKET_POLL_ENTRY Entries, U32 Count, U32 TimeOut);
 
 // Address utility functions
 U32 InternetAddressFromString(LPCSTR IPString);
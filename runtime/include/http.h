@@ -27,7 +27,6 @@
 
 #include "../include/exos-runtime.h"
 #include "../include/exos.h"
-#include "../../kernel/include/utils/AdaptiveDelay.h"
 
 /************************************************************************/
 
@@ -97,7 +96,6 @@ typedef struct tag_HTTP_CONNECTION {
     unsigned char ReceiveBuffer[4096]; // HTTP receive buffer
     unsigned int ReceiveBufferUsed; // Buffer usage
     unsigned int ReceiveState;      // Parsing state
-    ADAPTIVE_DELAY_STATE DelayState; // Exponential backoff for connection attempts
 } HTTP_CONNECTION;
 
 /***************************************************************************/
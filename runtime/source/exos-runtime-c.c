@@ -854,6 +854,190 @@ int getsockname(int sockfd, struct sockaddr *addr, socklen_t *addrlen) {
     return result;
 }
 
+/************************************************************************/
+
+void fd_set_add(int fd, fd_set *set) {
+    if (fd_set_contains(fd, set) == 0 && set->fd_count < FD_SETSIZE) {
+        set->fd_array[set->fd_count++] = fd;
+    }
+}
+
+/************************************************************************/
+
+void fd_set_remove(int fd, fd_set *set) {
+    unsigned int index;
+
+    for (index = 0; index < set->fd_count; index++) {
+        if (set->fd_array[index] == fd) {
+            set->fd_array[index] = set->fd_array[--set->fd_count];
+            return;
+        }
+    }
+}
+
+/************************************************************************/
+
+int fd_set_contains(int fd, const fd_set *set) {
+    unsigned int index;
+
+    for (index = 0; index < set->fd_count; index++) {
+        if (set->fd_array[index] == fd) return 1;
+    }
+
+    return 0;
+}
+
+/************************************************************************/
+
+int poll(struct pollfd *fds, nfds_t nfds, int timeout) {
+    SOCKET_POLL_ENTRY entries[SOCKET_POLL_MAX_ENTRIES];
+    nfds_t index;
+    int result;
+
+    if (fds == NULL || nfds == 0 || nfds > SOCKET_POLL_MAX_ENTRIES) return -1;
+
+    for (index = 0; index < nfds; index++) {
+        entries[index].SocketHandle = SocketDescriptorToHandle(fds[index].fd);
+        entries[index].Events = 0;
+        entries[index].ReadyEvents = 0;
+        if (fds[index].events & POLLIN) entries[index].Events |= SOCKET_POLL_READ | SOCKET_POLL_ACCEPT;
+        if (fds[index].events & POLLOUT) entries[index].Events |= SOCKET_POLL_WRITE;
+    }
+
+    result = (int)SocketPoll(entries, (U32)nfds, (timeout < 0) ? INFINITY : (U32)timeout);
+    if (result < 0) return -1;
+
+    for (index = 0; index < nfds; index++) {
+        U32 ready = entries[index].ReadyEvents;
+        short revents = 0;
+
+        if (ready & (SOCKET_POLL_READ | SOCKET_POLL_ACCEPT)) revents |= POLLIN;
+        if (ready & SOCKET_POLL_WRITE) revents |= POLLOUT;
+        if (ready & SOCKET_POLL_ERROR) revents |= POLLERR;
+        if (ready & SOCKET_POLL_HANGUP) revents |= POLLHUP;
+        if (ready & SOCKET_POLL_INVALID) revents |= POLLNVAL;
+
+        fds[index].revents = revents;
+    }
+
+    return result;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Add the events of a descriptor to a poll list, merging duplicates.
+ * @param entries Poll list.
+ * @param count Number of entries in the list, updated.
+ * @param fd Socket descriptor.
+ * @param events SOCKET_POLL_* events to wait for.
+ * @return 0 on success, -1 when the list is full.
+ */
+static int SelectAddEntry(LPSOCKET_POLL_ENTRY entries, U32 *count, int fd, U32 events) {
+    SOCKET_HANDLE handle = SocketDescriptorToHandle(fd);
+    U32 index;
+
+    for (index = 0; index < *count; index++) {
+        if (entries[index].SocketHandle == handle) {
+            entries[index].Events |= events;
+            return 0;
+        }
+    }
+
+    if (*count >= SOCKET_POLL_MAX_ENTRIES) return -1;
+
+    entries[*count].SocketHandle = handle;
+    entries[*count].Events = events;
+    entries[*count].ReadyEvents = 0;
+    (*count)++;
+
+    return 0;
+}
+
+/************************************************************************/
+
+/**
+ * @brief Keep in a descriptor set only the descriptors that are ready.
+ * @param set Descriptor set, may be NULL.
+ * @param entries Poll list after the wait.
+ * @param count Number of entries in the list.
+ * @param mask SOCKET_POLL_* events that make a descriptor ready for this set.
+ * @return Number of descriptors left in the set.
+ */
+static int SelectFilterSet(fd_set *set, LPSOCKET_POLL_ENTRY entries, U32 count, U32 mask) {
+    unsigned int kept = 0;
+    unsigned int index;
+    U32 entry;
+
+    if (set == NULL) return 0;
+
+    for (index = 0; index < set->fd_count; index++) {
+        SOCKET_HANDLE handle = SocketDescriptorToHandle(set->fd_array[index]);
+
+        for (entry = 0; entry < count; entry++) {
+            if (entries[entry].SocketHandle == handle) break;
+        }
+
+        if (entry < count && (entries[entry].ReadyEvents & mask)) {
+            set->fd_array[kept++] = set->fd_array[index];
+        }
+    }
+
+    set->fd_count = kept;
+    return (int)kept;
+}
+
+/************************************************************************/
+
+int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout) {
+    SOCKET_POLL_ENTRY entries[SOCKET_POLL_MAX_ENTRIES];
+    U32 count = 0;
+    U32 milliseconds = INFINITY;
+    unsigned int index;
+    int result;
+
+    // Sets list their descriptors, the highest descriptor is not needed
+    UNUSED(nfds);
+
+    if (timeout != NULL) {
+        if (timeout->tv_sec < 0 || timeout->tv_usec < 0) return -1;
+        milliseconds = (U32)timeout->tv_sec * 1000 + (U32)timeout->tv_usec / 1000;
+    }
+
+    for (index = 0; readfds != NULL && index < readfds->fd_count; index++) {
+        if (SelectAddEntry(entries, &count, readfds->fd_array[index], SOCKET_POLL_READ | SOCKET_POLL_ACCEPT)) return -1;
+    }
+
+    for (index = 0; writefds != NULL && index < writefds->fd_count; index++) {
+        if (SelectAddEntry(entries, &count, writefds->fd_array[index], SOCKET_POLL_WRITE)) return -1;
+    }
+
+    // Errors are always reported, an exception-only descriptor waits for nothing else
+    for (index = 0; exceptfds != NULL && index < exceptfds->fd_count; index++) {
+        if (SelectAddEntry(entries, &count, exceptfds->fd_array[index], 0)) return -1;
+    }
+
+    if (count == 0) {
+        if (milliseconds != INFINITY) sleep(milliseconds);
+        return 0;
+    }
+
+    result = (int)SocketPoll(entries, count, milliseconds);
+    if (result < 0) return -1;
+
+    for (index = 0; index < count; index++) {
+        if (entries[index].ReadyEvents & SOCKET_POLL_INVALID) return -1;
+    }
+
+    // A readable descriptor also reports end of stream and errors, so the next call does not block
+    result = SelectFilterSet(readfds, entries, count,
+        SOCKET_POLL_READ | SOCKET_POLL_ACCEPT | SOCKET_POLL_HANGUP | SOCKET_POLL_ERROR);
+    result += SelectFilterSet(writefds, entries, count, SOCKET_POLL_WRITE | SOCKET_POLL_ERROR);
+    result += SelectFilterSet(exceptfds, entries, count, SOCKET_POLL_ERROR);
+
+    return result;
+}
+
 #endif
 
 /************************************************************************/
@@ -1117,6 +1117,33 @@ U32 SocketGetSocketName(SOCKET_HANDLE SocketHandle, LPSOCKET_ADDRESS Address, U3
 
 /***************************************************************************/
 
+I32 SocketPoll(LPSOCKET_POLL_ENTRY Entries, U32 Count, U32 TimeOut) {
+    SOCKET_POLL_INFO Info;
+    U32 Index;
+    I32 Result;
+
+    if (Entries == NULL || Count == 0 || Count > SOCKET_POLL_MAX_ENTRIES) return SOCKET_ERROR_INVALID;
+
+    Info.Header.Size = sizeof(SOCKET_POLL_INFO);
+    Info.Header.Version = EXOS_ABI_VERSION;
+    Info.Header.Flags = 0;
+    Info.Count = Count;
+    Info.TimeOut = TimeOut;
+    for (Index = 0; Index < Count; Index++) {
+        Info.Entries[Index] = Entries[Index];
+    }
+
+    Result = (I32)exoscall(SYSCALL_SocketPoll, EXOS_PARAM(&Info));
+
+    for (Index = 0; Index < Count; Index++) {
+        Entries[Index].ReadyEvents = Info.Entries[Index].ReadyEvents;
+    }
+
+    return Result;
+}
+
+/***************************************************************************/
+
 U32 InternetAddressFromString(LPCSTR IPString) {
     U32 result = 0;
     U32 octet = 0;
@@ -577,46 +577,18 @@ HTTP_CONNECTION* HTTP_CreateConnection(const char* Host, unsigned short Port) {
     // Connect to server
     result = connect(connection->SocketHandle, (struct sockaddr*)&serverAddr, sizeof(serverAddr));
 
+    // connect() returns once the TCP handshake completed or failed
     if (result != 0) {
         shutdown(connection->SocketHandle, SOCKET_SHUTDOWN_BOTH);
         free(connection);
-        HTTP_SetLastErrorMessage("connect() failed to initiate handshake");
+        HTTP_SetLastErrorMessage(result == SOCKET_ERROR_TIMEOUT ? "Timed out waiting for TCP handshake"
+                                                                : "connect() failed");
         return NULL;
     }
 
-    // Wait for connection to be established using adaptive delay
-    // In EXOS, connect() is non-blocking, so we need to wait for TCP handshake
-    AdaptiveDelay_Initialize(&(connection->DelayState));
-
-    // Override defaults for HTTP connection timeout
-    connection->DelayState.MinDelay = 50;      // 50 ticks minimum
-    connection->DelayState.MaxDelay = 2000;    // 2000 ticks maximum
-    connection->DelayState.MaxAttempts = 10;   // 10 attempts max
-
-    while (AdaptiveDelay_ShouldContinue(&(connection->DelayState))) {
-        struct sockaddr_in peerAddr;
-        socklen_t peerAddrLen = sizeof(peerAddr);
-
-        // Try to get peer address - this succeeds only if connection is established
-        if (getpeername(connection->SocketHandle, (struct sockaddr*)&peerAddr, &peerAddrLen) == 0) {
-            connection->Connected = 1;
-            AdaptiveDelay_OnSuccess(&(connection->DelayState));
-            HTTP_SetLastErrorMessage("Success");
-            return connection;
-        }
-
-        // Get next delay and sleep
-        U32 delayTicks = AdaptiveDelay_GetNextDelay(&connection->DelayState);
-        if (delayTicks > 0) {
-            sleep(delayTicks);
-            AdaptiveDelay_OnFailure(&(connection->DelayState));
-        }
-    }
-
-    shutdown(connection->SocketHandle, SOCKET_SHUTDOWN_BOTH);
-    free(connection);
-    HTTP_SetLastErrorMessage("Timed out waiting for TCP handshake");
-    return NULL;
+    connection->Connected = 1;
+    HTTP_SetLastErrorMessage("Success");
+    return connection;
 }
 
 /***************************************************************************/